@@ -3,6 +3,252 @@
 /*******************************************************************************
  *  Private API
  ******************************************************************************/
+/* Where consecutive strips of the stream are saved by snapshot_chained() */
+typedef struct strip_layout {
+    uint8_t                                     *base;       /* Address of strip 0 */
+    size_t                                      strip_pitch; /* Distance between 2 strips in bytes */
+    uint32_t                                    ring_strips; /* Strips wrap around after ring_strips strips */
+    const cmos_sensor_acquisition_tiled_layout  *tiled;       /* Tiled layout (overrides the above if not NULL) */
+    const cmos_sensor_acquisition_planar_layout *planar;      /* Planar layout (overrides the above if not NULL) */
+} strip_layout;
+
+static uint8_t write_burst_count(msgdma_dev *msgdma, void *buffer, size_t size);
+static int queue_st_to_mm_descriptor(msgdma_dev *msgdma, void *buffer, size_t size, uint16_t sequence_number);
+static uint32_t completed_strips(msgdma_dev *msgdma, uint32_t queued_strips);
+static size_t strip_length(size_t frame_size, size_t strip_size, uint32_t strip_index);
+static uint8_t *strip_address(const strip_layout *layout, uint32_t strip_index);
+static bool snapshot_chained(cmos_sensor_acquisition_dev *dev, const strip_layout *layout, size_t strip_size, cmos_sensor_acquisition_strip_callback callback, void *context);
+static bool whole_output_words(cmos_sensor_acquisition_dev *dev, uint32_t pixels);
+
+/*
+ * write_burst_count
+ *
+ * Returns the write burst count to program in an extended descriptor which
+ * saves size bytes in buffer.
+ *
+ * The largest power-of-2 burst (up to the msgdma's maximum burst count) that
+ * starts on a burst-sized boundary of buffer and fits in the transfer is
+ * selected, so that the write master issues full, aligned bursts to memory.
+ * Returns 0 (the hardware's maximum burst count) if bursts are not
+ * programmable or if the maximum can be used.
+ */
+static uint8_t write_burst_count(msgdma_dev *msgdma, void *buffer, size_t size) {
+    if (!msgdma->burst_enable || !msgdma->programmable_burst_enable) {
+        return 0;
+    }
+
+    size_t word_size = msgdma->data_width / 8;
+    uint32_t burst_count = msgdma->max_burst_count;
+
+    while (burst_count > 1 && ((((size_t) buffer) % (burst_count * word_size)) != 0 || size < burst_count * word_size)) {
+        burst_count /= 2;
+    }
+
+    /* the descriptor's burst count field is only 8 bits wide */
+    if (burst_count == msgdma->max_burst_count || burst_count > UINT8_MAX) {
+        return 0;
+    }
+
+    return burst_count;
+}
+
+/*
+ * queue_st_to_mm_descriptor
+ *
+ * Queues a st_to_mm descriptor which saves the next size bytes of the stream
+ * in buffer.
+ *
+ * If the msgdma has its enhanced features enabled, an extended descriptor is
+ * used, tagged with sequence_number and with a write burst count tuned for
+ * buffer (see write_burst_count()). A standard descriptor is used otherwise.
+ *
+ * The transfer also ends at the last word of a frame (endofpacket), so a frame
+ * shorter than size (sparse or compressed output) does not spill into the next
+ * one. Frames of a fixed size always end exactly at the end of their last
+ * descriptor.
+ *
+ * Returns 0 on success, and a negative error code from the msgdma otherwise.
+ */
+static int queue_st_to_mm_descriptor(msgdma_dev *msgdma, void *buffer, size_t size, uint16_t sequence_number) {
+    int err = 0;
+
+    if (msgdma->enhanced_features) {
+        msgdma_extended_descriptor desc;
+        err = msgdma_construct_extended_st_to_mm_descriptor(msgdma, &desc, buffer, size, MSGDMA_DESCRIPTOR_CONTROL_END_ON_EOP_MASK, sequence_number, write_burst_count(msgdma, buffer, size), 1);
+        if (!err) {
+            err = msgdma_extended_descriptor_async_transfer(msgdma, &desc);
+        }
+    } else {
+        msgdma_standard_descriptor desc;
+        err = msgdma_construct_standard_st_to_mm_descriptor(msgdma, &desc, buffer, size, MSGDMA_DESCRIPTOR_CONTROL_END_ON_EOP_MASK);
+        if (!err) {
+            err = msgdma_standard_descriptor_async_transfer(msgdma, &desc);
+        }
+    }
+
+    return err;
+}
+
+/*
+ * completed_strips
+ *
+ * Returns the number of strips (out of the queued_strips queued so far) that
+ * the msgdma has finished writing to memory.
+ *
+ * Descriptors still waiting in the write descriptor FIFO have not started, and
+ * at most one more is being processed while the msgdma is busy. The fill level
+ * is read before the busy flag, so the result can only lag behind the hardware,
+ * never run ahead of it.
+ */
+static uint32_t completed_strips(msgdma_dev *msgdma, uint32_t queued_strips) {
+    uint32_t pending = msgdma_write_descriptor_fill_level(msgdma);
+
+    if (msgdma_busy(msgdma)) {
+        pending++;
+    }
+
+    return (pending < queued_strips) ? (queued_strips - pending) : 0;
+}
+
+/*
+ * strip_length
+ *
+ * Returns the number of bytes of strip strip_index of a frame_size byte frame
+ * cut in strips of strip_size bytes (only the last strip may be shorter).
+ */
+static size_t strip_length(size_t frame_size, size_t strip_size, uint32_t strip_index) {
+    size_t remaining = frame_size - strip_index * strip_size;
+    return (remaining < strip_size) ? remaining : strip_size;
+}
+
+/*
+ * strip_address
+ *
+ * Returns the address at which strip strip_index is saved in layout.
+ *
+ * For a raster layout, strip i is saved at (base + (i % ring_strips) *
+ * strip_pitch). For a tiled layout, each strip is one row of one tile, in
+ * stream order (all tiles of a frame row, then the next frame row). For a
+ * planar layout, each strip is one half of a split frame row, which is one row
+ * of one plane.
+ */
+static uint8_t *strip_address(const strip_layout *layout, uint32_t strip_index) {
+    const cmos_sensor_acquisition_tiled_layout *tiled = layout->tiled;
+    const cmos_sensor_acquisition_planar_layout *planar = layout->planar;
+
+    if (planar) {
+        uint32_t row = strip_index / 2;
+        uint32_t plane = (row % 2) * 2 + (strip_index % 2);
+
+        return planar->planes[plane] + (row / 2) * planar->plane_row_size;
+    }
+
+    if (!tiled) {
+        return layout->base + (strip_index % layout->ring_strips) * layout->strip_pitch;
+    }
+
+    uint32_t row = strip_index / tiled->tiles_per_row;
+    uint32_t tile_x = strip_index % tiled->tiles_per_row;
+    uint32_t tile_y = row / tiled->tile_height;
+
+    return tiled->base + (tile_y * tiled->tiles_per_row + tile_x) * tiled->tile_size + (row % tiled->tile_height) * tiled->tile_row_size;
+}
+
+/*
+ * snapshot_chained
+ *
+ * Performs a blocking snapshot operation in which the frame is cut in strips
+ * of strip_size bytes (only the last one may be shorter), and each strip is
+ * saved at the address given by layout (see strip_address()). One descriptor
+ * per strip is chained in the msgdma, bounded by the layout's ring size and the
+ * msgdma's descriptor FIFO depth. If callback is not NULL, it is called as soon
+ * as each strip has landed in memory, and the strip's buffer is reused once it
+ * returns.
+ *
+ * The SNAPSHOT command is queued behind any command already pending in the
+ * cmos_sensor_input unit, but the strips are tracked with the msgdma's fill
+ * level, so captures queued with cmos_sensor_acquisition_snapshot_enqueue()
+ * should have completed first.
+ *
+ * Returns true if the whole frame was successfully saved, and false otherwise
+ * (the msgdma is then reset). Also returns false, without capturing anything,
+ * if strip_size is 0, if the main stream carries no frame (stats-only mode) or
+ * if the cmos_sensor_input command fifo is full.
+ */
+static bool snapshot_chained(cmos_sensor_acquisition_dev *dev, const strip_layout *layout, size_t strip_size, cmos_sensor_acquisition_strip_callback callback, void *context) {
+    size_t frame_size = cmos_sensor_acquisition_frame_size(dev);
+
+    if (frame_size == 0 || strip_size == 0 || cmos_sensor_input_status_cmd_fifo_full(&dev->cmos_sensor_input)) {
+        return false;
+    }
+
+    uint32_t num_strips = 1 + ((frame_size - 1) / strip_size);
+    uint32_t max_queued_strips = (layout->ring_strips < dev->msgdma.descriptor_fifo_depth) ? layout->ring_strips : dev->msgdma.descriptor_fifo_depth;
+    uint32_t queued_strips = 0;
+    uint32_t done_strips = 0;
+
+    /* send async dma transfer commands for the first strips to have the dma
+     * unit ready for data in the fifo */
+    while (queued_strips < num_strips && queued_strips < max_queued_strips) {
+        uint8_t *strip = strip_address(layout, queued_strips);
+        if (queue_st_to_mm_descriptor(&dev->msgdma, strip, strip_length(frame_size, strip_size, queued_strips), queued_strips)) {
+            msgdma_init(&dev->msgdma);
+            return false;
+        }
+        queued_strips++;
+    }
+
+    /* start cmos_sensor_input capture logic (the fifo cannot have filled up
+     * since it was checked) */
+    cmos_sensor_input_command_snapshot_enqueue(&dev->cmos_sensor_input);
+
+    while (done_strips < num_strips) {
+        if (cmos_sensor_input_status_fifo_ovfl(&dev->cmos_sensor_input)) {
+            msgdma_init(&dev->msgdma);
+            return false;
+        }
+
+        uint32_t completed = completed_strips(&dev->msgdma, queued_strips);
+        while (done_strips < completed) {
+            if (callback) {
+                uint8_t *strip = strip_address(layout, done_strips);
+                callback(strip, strip_length(frame_size, strip_size, done_strips), done_strips, context);
+            }
+            done_strips++;
+        }
+
+        /* refill the buffers released by the callbacks */
+        while (queued_strips < num_strips && queued_strips - done_strips < max_queued_strips) {
+            uint8_t *strip = strip_address(layout, queued_strips);
+            if (queue_st_to_mm_descriptor(&dev->msgdma, strip, strip_length(frame_size, strip_size, queued_strips), queued_strips)) {
+                msgdma_init(&dev->msgdma);
+                return false;
+            }
+            queued_strips++;
+        }
+    }
+
+    return cmos_sensor_input_wait_until_idle(&dev->cmos_sensor_input);
+}
+
+/*
+ * whole_output_words
+ *
+ * Returns true if the given number of consecutive pixels of the main stream
+ * fills a whole number of output words. The packer packs pixels across row
+ * boundaries, so a run of pixels that does not fill its last word shifts all
+ * the following ones within their words.
+ */
+static bool whole_output_words(cmos_sensor_acquisition_dev *dev, uint32_t pixels) {
+    cmos_sensor_input_dev *input = &dev->cmos_sensor_input;
+
+    if (!input->packer_enable) {
+        return true;
+    }
+
+    uint32_t pixels_per_word = input->output_width / cmos_sensor_input_output_pix_bits(input);
+    return (pixels % pixels_per_word) == 0;
+}
 
 /*******************************************************************************
  *  Public API
@@ -18,8 +264,18 @@ cmos_sensor_acquisition_dev cmos_sensor_acquisition_inst(void     *cmos_sensor_i
                                                          uint32_t cmos_sensor_Input_max_height,
                                                          uint32_t cmos_sensor_input_output_width,
                                                          uint32_t cmos_sensor_input_fifo_depth,
+                                                         bool     cmos_sensor_input_downscaler_enable,
+                                                         bool     cmos_sensor_input_preview_enable,
+                                                         bool     cmos_sensor_input_planar_enable,
+                                                         bool     cmos_sensor_input_depth_reducer_enable,
+                                                         uint8_t  cmos_sensor_input_reduced_pix_depth,
                                                          bool     cmos_sensor_input_debayer_enable,
+                                                         bool     cmos_sensor_input_color_converter_enable,
                                                          bool     cmos_sensor_input_pack_enable,
+                                                         uint8_t  cmos_sensor_input_stage_count,
+                                                         uint8_t  cmos_sensor_input_blob_count,
+                                                         bool     cmos_sensor_input_sparse_enable,
+                                                         bool     cmos_sensor_input_compressor_enable,
                                                          void     *msgdma_csr_base,
                                                          void     *msgdma_descriptor_base,
                                                          uint32_t msgdma_descriptor_fifo_depth,
@@ -41,8 +297,18 @@ cmos_sensor_acquisition_dev cmos_sensor_acquisition_inst(void     *cmos_sensor_i
                                                                      cmos_sensor_Input_max_height,
                                                                      cmos_sensor_input_output_width,
                                                                      cmos_sensor_input_fifo_depth,
+                                                                     cmos_sensor_input_downscaler_enable,
+                                                                     cmos_sensor_input_preview_enable,
+                                                                     cmos_sensor_input_planar_enable,
+                                                                     cmos_sensor_input_depth_reducer_enable,
+                                                                     cmos_sensor_input_reduced_pix_depth,
                                                                      cmos_sensor_input_debayer_enable,
-                                                                     cmos_sensor_input_pack_enable);
+                                                                     cmos_sensor_input_color_converter_enable,
+                                                                     cmos_sensor_input_pack_enable,
+                                                                     cmos_sensor_input_stage_count,
+                                                                     cmos_sensor_input_blob_count,
+                                                                     cmos_sensor_input_sparse_enable,
+                                                                     cmos_sensor_input_compressor_enable);
 
     msgdma_dev msgdma = msgdma_csr_descriptor_inst(msgdma_csr_base,
                                                    msgdma_descriptor_base,
@@ -63,9 +329,24 @@ cmos_sensor_acquisition_dev cmos_sensor_acquisition_inst(void     *cmos_sensor_i
     dev.cmos_sensor_input = cmos_sensor_input;
     dev.msgdma = msgdma;
 
+    /* the preview msgdma is attached separately, see
+     * cmos_sensor_acquisition_attach_preview_msgdma() */
+    dev.msgdma_preview.csr_base = NULL;
+    dev.msgdma_preview.descriptor_base = NULL;
+
     return dev;
 }
 
+/*
+ * cmos_sensor_acquisition_attach_preview_msgdma
+ *
+ * Attaches the msgdma connected to the preview stream of the cmos_sensor_input
+ * unit to the device. Must be called before cmos_sensor_acquisition_init().
+ */
+void cmos_sensor_acquisition_attach_preview_msgdma(cmos_sensor_acquisition_dev *dev, msgdma_dev msgdma_preview) {
+    dev->msgdma_preview = msgdma_preview;
+}
+
 /*
  * cmos_sensor_acquisition_init
  *
@@ -73,13 +354,17 @@ cmos_sensor_acquisition_dev cmos_sensor_acquisition_inst(void     *cmos_sensor_i
  *
  * This routine configures the cmos_sensor_input to disable interrupts and sets
  * the debayering unit (if enabled) to RGGB mode.
- * The Modular Scatter-Gather DMA core is configured to disable interrupts and
- * descriptor processing.
+ * The Modular Scatter-Gather DMA cores (main and preview, if attached) are
+ * configured to disable interrupts and descriptor processing.
  *
  */
 void cmos_sensor_acquisition_init(cmos_sensor_acquisition_dev *dev) {
     cmos_sensor_input_init(&dev->cmos_sensor_input);
     msgdma_init(&dev->msgdma);
+
+    if (dev->msgdma_preview.csr_base != NULL) {
+        msgdma_init(&dev->msgdma_preview);
+    }
 }
 
 /*
@@ -111,51 +396,529 @@ size_t cmos_sensor_acquisition_frame_size(cmos_sensor_acquisition_dev *dev) {
 /*
  * cmos_sensor_acquisition_frame_width
  *
- * Returns the width of a frame in pixels (determined by the cmos_sensor_input
- * unit).
+ * Returns the width of a captured frame in pixels (determined by the
+ * cmos_sensor_input unit, after downscaling).
  */
 uint32_t cmos_sensor_acquisition_frame_width(cmos_sensor_acquisition_dev *dev) {
-    return cmos_sensor_input_frame_info_frame_width(&dev->cmos_sensor_input);
+    return cmos_sensor_input_output_frame_width(&dev->cmos_sensor_input);
 }
 
 /*
  * cmos_sensor_acquisition_frame_height
  *
- * Returns the height of a frame in pixels (determined by the cmos_sensor_input
- * unit).
+ * Returns the height of a captured frame in pixels (determined by the
+ * cmos_sensor_input unit, after downscaling).
  */
 uint32_t cmos_sensor_acquisition_frame_height(cmos_sensor_acquisition_dev *dev) {
-    return cmos_sensor_input_frame_info_frame_height(&dev->cmos_sensor_input);
+    return cmos_sensor_input_output_frame_height(&dev->cmos_sensor_input);
 }
 
 /*
  * cmos_sensor_acquisition_snapshot
  *
- * Performs a blocking snapshot operation.
+ * Performs a blocking snapshot operation: queues the capture with
+ * cmos_sensor_acquisition_snapshot_enqueue(), then waits for it (and for any
+ * capture queued before it) with cmos_sensor_acquisition_wait_snapshots().
  *
  * Returns true if the frame was successfully saved, and false otherwise.
  *
  * A frame is considered successfully saved if and only if the msgdma can handle
  * the required frame size in a single descriptor and if the FIFO in the
  * cmos_sensor_input did not overflow.
+ *
+ * In the blob unit's stats-only mode, the main stream carries no data (not
+ * even the end of the frame), so no descriptor is queued: the snapshot only
+ * analyzes the frame, and frame is left untouched. The statistics can be read
+ * with cmos_sensor_input_read_blobs() once it returns.
  */
 bool cmos_sensor_acquisition_snapshot(cmos_sensor_acquisition_dev *dev, void *frame, size_t frame_size) {
-    msgdma_standard_descriptor desc;
-    if (msgdma_construct_standard_st_to_mm_descriptor(&dev->msgdma, &desc, frame, frame_size, 0)) {
+    if (!cmos_sensor_acquisition_snapshot_enqueue(dev, frame, frame_size)) {
         return false;
     }
 
-    /* send async dma transfer command to have the dma unit ready for data in
-     * the fifo */
-    if (msgdma_standard_descriptor_async_transfer(&dev->msgdma, &desc)) {
+    return cmos_sensor_acquisition_wait_snapshots(dev);
+}
+
+/*
+ * cmos_sensor_acquisition_snapshot_enqueue
+ *
+ * Queues a snapshot which saves a frame in frame, and returns without waiting
+ * for it. The msgdma descriptor is queued first, then a SNAPSHOT command is
+ * queued in the cmos_sensor_input unit's command fifo. Captures queued this way
+ * run back to back, each one on the first frame after the previous one, and
+ * land in memory in the order they were queued.
+ *
+ * Use cmos_sensor_acquisition_snapshot_pending() to poll for the frames that
+ * have landed, or cmos_sensor_acquisition_wait_snapshots() to wait for all of
+ * them. If the msgdma has its enhanced features enabled, an extended descriptor
+ * with a write burst count tuned to the frame's alignment is used.
+ *
+ * Returns true if the capture was queued. Returns false, without queuing
+ * anything, if frame_size is 0 or if the command fifo is full. Also returns
+ * false if the msgdma cannot take the descriptor (its descriptor FIFO is full,
+ * or the frame is too large for a single descriptor).
+ *
+ * In the blob unit's stats-only mode, only the SNAPSHOT command is queued, and
+ * frame is left untouched.
+ */
+bool cmos_sensor_acquisition_snapshot_enqueue(cmos_sensor_acquisition_dev *dev, void *frame, size_t frame_size) {
+    if (cmos_sensor_input_status_cmd_fifo_full(&dev->cmos_sensor_input)) {
+        return false;
+    }
+
+    if (cmos_sensor_input_config_blob_stats_only(&dev->cmos_sensor_input)) {
+        return cmos_sensor_input_command_snapshot_enqueue(&dev->cmos_sensor_input);
+    }
+
+    if (frame_size == 0) {
         return false;
     }
 
-    /* start cmos_sensor_input capture logic */
-    if (!cmos_sensor_input_command_snapshot_sync(&dev->cmos_sensor_input)) {
+    /* the descriptor goes first, to have the dma unit ready for data in the
+     * fifo */
+    if (queue_st_to_mm_descriptor(&dev->msgdma, frame, frame_size, 0)) {
+        return false;
+    }
+
+    /* the command fifo only drains since it was checked */
+    return cmos_sensor_input_command_snapshot_enqueue(&dev->cmos_sensor_input);
+}
+
+/*
+ * cmos_sensor_acquisition_snapshot_pending
+ *
+ * Returns the number of captures queued with
+ * cmos_sensor_acquisition_snapshot_enqueue() whose frame has not landed in
+ * memory yet. Frames land in the order they were queued, so if n captures were
+ * queued and this returns p, the first (n - p) frames are complete.
+ *
+ * The count can only lag behind the hardware (see completed_strips()). Captures
+ * queued in the stats-only mode have no descriptor and are not counted.
+ */
+uint32_t cmos_sensor_acquisition_snapshot_pending(cmos_sensor_acquisition_dev *dev) {
+    uint32_t pending = msgdma_write_descriptor_fill_level(&dev->msgdma);
+
+    if (msgdma_busy(&dev->msgdma)) {
+        pending++;
+    }
+
+    return pending;
+}
+
+/*
+ * cmos_sensor_acquisition_wait_snapshots
+ *
+ * Waits until every queued capture has completed and its frame has landed in
+ * memory.
+ *
+ * Returns true if all frames were successfully saved. Returns false if the
+ * cmos_sensor_input FIFO overflowed: the capture in progress is then lost, and
+ * the msgdma is reset, dropping the descriptors of the captures still queued.
+ */
+bool cmos_sensor_acquisition_wait_snapshots(cmos_sensor_acquisition_dev *dev) {
+    if (!cmos_sensor_input_wait_until_idle(&dev->cmos_sensor_input)) {
+        msgdma_init(&dev->msgdma);
         return false;
     }
 
     msgdma_wait_until_idle(&dev->msgdma);
     return true;
 }
+
+/*
+ * cmos_sensor_acquisition_preview_frame_size
+ *
+ * Returns the total size of a frame in bytes outputted by the cmos_sensor_input
+ * unit on its preview stream in its current configuration (0 if the preview
+ * stream is disabled).
+ */
+size_t cmos_sensor_acquisition_preview_frame_size(cmos_sensor_acquisition_dev *dev) {
+    return cmos_sensor_input_preview_frame_size(&dev->cmos_sensor_input);
+}
+
+/*
+ * cmos_sensor_acquisition_preview_frame_width
+ *
+ * Returns the width of a captured preview frame in pixels.
+ */
+uint32_t cmos_sensor_acquisition_preview_frame_width(cmos_sensor_acquisition_dev *dev) {
+    return cmos_sensor_input_preview_frame_width(&dev->cmos_sensor_input);
+}
+
+/*
+ * cmos_sensor_acquisition_preview_frame_height
+ *
+ * Returns the height of a captured preview frame in pixels.
+ */
+uint32_t cmos_sensor_acquisition_preview_frame_height(cmos_sensor_acquisition_dev *dev) {
+    return cmos_sensor_input_preview_frame_height(&dev->cmos_sensor_input);
+}
+
+/*
+ * cmos_sensor_acquisition_snapshot_dual
+ *
+ * Performs a blocking snapshot operation which saves the full resolution frame
+ * in frame and the downscaled preview frame in preview. Both streams come from
+ * the same sensor frame.
+ *
+ * Returns true if both frames were successfully saved, and false otherwise.
+ *
+ * Both msgdmas are programmed before the capture starts, as the
+ * cmos_sensor_input unit stops as soon as either of its output FIFOs overflows.
+ *
+ * The SNAPSHOT command is queued behind any command already pending in the
+ * cmos_sensor_input unit, and the call returns once every queued capture has
+ * completed. Returns false, without capturing anything, if the command fifo is
+ * full.
+ *
+ * In the blob unit's stats-only mode, only the preview is saved (the main
+ * stream carries no data) and frame is left untouched.
+ */
+bool cmos_sensor_acquisition_snapshot_dual(cmos_sensor_acquisition_dev *dev, void *frame, size_t frame_size, void *preview, size_t preview_size) {
+    bool stats_only = cmos_sensor_input_config_blob_stats_only(&dev->cmos_sensor_input);
+
+    if (!dev->cmos_sensor_input.preview_enable || dev->msgdma_preview.csr_base == NULL) {
+        return false;
+    }
+
+    if (preview_size == 0 || (!stats_only && frame_size == 0) || cmos_sensor_input_status_cmd_fifo_full(&dev->cmos_sensor_input)) {
+        return false;
+    }
+
+    if (!stats_only && queue_st_to_mm_descriptor(&dev->msgdma, frame, frame_size, 0)) {
+        return false;
+    }
+
+    if (queue_st_to_mm_descriptor(&dev->msgdma_preview, preview, preview_size, 0)) {
+        /* drop the descriptor already queued for the main stream */
+        msgdma_init(&dev->msgdma);
+        return false;
+    }
+
+    /* start cmos_sensor_input capture logic (the fifo cannot have filled up
+     * since it was checked) */
+    cmos_sensor_input_command_snapshot_enqueue(&dev->cmos_sensor_input);
+
+    if (!cmos_sensor_input_wait_until_idle(&dev->cmos_sensor_input)) {
+        msgdma_init(&dev->msgdma);
+        msgdma_init(&dev->msgdma_preview);
+        return false;
+    }
+
+    if (!stats_only) {
+        msgdma_wait_until_idle(&dev->msgdma);
+    }
+    msgdma_wait_until_idle(&dev->msgdma_preview);
+    return true;
+}
+
+/*
+ * cmos_sensor_acquisition_strip_size
+ *
+ * Returns the size in bytes of a strip of the given number of lines of a
+ * captured frame, to be used with cmos_sensor_acquisition_snapshot_strips().
+ */
+size_t cmos_sensor_acquisition_strip_size(cmos_sensor_acquisition_dev *dev, uint32_t lines) {
+    return cmos_sensor_input_strip_size(&dev->cmos_sensor_input, lines);
+}
+
+/*
+ * cmos_sensor_acquisition_snapshot_strips
+ *
+ * Performs a blocking snapshot operation in which the frame is saved strip by
+ * strip in a ring of ring_strips buffers of strip_size bytes each, laid out
+ * contiguously starting at ring. The last strip of the frame may be shorter
+ * than strip_size.
+ *
+ * callback is called with the strip's address, size and index in the frame as
+ * soon as the strip has landed in memory. The strip's buffer is reused for a
+ * later strip once the callback returns, so the callback must be done with its
+ * contents by then. One descriptor per strip is chained in the msgdma, bounded
+ * by the ring size and the msgdma's descriptor FIFO depth.
+ *
+ * Returns true if the whole frame was successfully saved, and false otherwise.
+ *
+ * The cmos_sensor_input FIFO overflows if the callbacks cannot keep up with the
+ * sensor. The capture is then aborted and the msgdma reset.
+ */
+bool cmos_sensor_acquisition_snapshot_strips(cmos_sensor_acquisition_dev *dev, void *ring, uint32_t ring_strips, size_t strip_size, cmos_sensor_acquisition_strip_callback callback, void *context) {
+    if (ring_strips == 0 || strip_size == 0) {
+        return false;
+    }
+
+    strip_layout layout = {(uint8_t *) ring, strip_size, ring_strips, NULL, NULL};
+    return snapshot_chained(dev, &layout, strip_size, callback, context);
+}
+
+/*
+ * cmos_sensor_acquisition_snapshot_pitched
+ *
+ * Performs a blocking snapshot operation in which row i of the frame is saved
+ * at (base + i * pitch), e.g. directly inside a padded framebuffer or a larger
+ * canvas. pitch must be a multiple of the msgdma's data width (in bytes) and at
+ * least cmos_sensor_acquisition_strip_size(dev, 1).
+ *
+ * Returns true if the frame was successfully saved, and false otherwise. The
+ * sparse, compressed and stats-only outputs have no fixed row size, and are
+ * always rejected. So are packed rows which do not fill a whole number of
+ * output words, as the next row then starts within the last word of a row.
+ *
+ * The msgdma's write stride skips words between every beat, not rows, so one
+ * descriptor per row is chained instead (as for strips). If pitch equals the
+ * row size, the frame is contiguous and a single descriptor is used.
+ */
+bool cmos_sensor_acquisition_snapshot_pitched(cmos_sensor_acquisition_dev *dev, void *base, size_t pitch) {
+    size_t row_size = cmos_sensor_acquisition_strip_size(dev, 1);
+    size_t word_size = dev->msgdma.data_width / 8;
+
+    if (row_size == 0 || pitch < row_size || (pitch % word_size) != 0 || !whole_output_words(dev, cmos_sensor_acquisition_frame_width(dev))) {
+        return false;
+    }
+
+    if (pitch == row_size) {
+        return cmos_sensor_acquisition_snapshot(dev, base, cmos_sensor_acquisition_frame_size(dev));
+    }
+
+    strip_layout layout = {(uint8_t *) base, pitch, cmos_sensor_acquisition_frame_height(dev), NULL, NULL};
+    return snapshot_chained(dev, &layout, row_size, NULL, NULL);
+}
+
+/*
+ * cmos_sensor_acquisition_tiled_layout_init
+ *
+ * Initializes layout to describe a frame of the current configuration saved in
+ * tiles of tile_width x tile_height pixels at base. Each tile is contiguous in
+ * memory (row after row) and tiles are stored row of tiles after row of tiles.
+ * The last row of tiles is padded if the frame height is not a multiple of
+ * tile_height. Use cmos_sensor_acquisition_tiled_frame_size() to size the
+ * buffer, base can be set later if it is not known yet.
+ *
+ * Returns false if the output has no fixed row size (sparse, compressed or
+ * stats-only), if the frame width is not a multiple of tile_width, or if a row
+ * of a tile does not fill a whole number of output words or does not end on a
+ * msgdma word boundary.
+ */
+bool cmos_sensor_acquisition_tiled_layout_init(cmos_sensor_acquisition_dev *dev, cmos_sensor_acquisition_tiled_layout *layout, void *base, uint32_t tile_width, uint32_t tile_height) {
+    uint32_t frame_width = cmos_sensor_acquisition_frame_width(dev);
+    uint32_t frame_height = cmos_sensor_acquisition_frame_height(dev);
+    size_t row_size = cmos_sensor_acquisition_strip_size(dev, 1);
+    size_t word_size = dev->msgdma.data_width / 8;
+
+    if (row_size == 0 || tile_width == 0 || tile_height == 0 || (frame_width % tile_width) != 0 || !whole_output_words(dev, tile_width)) {
+        return false;
+    }
+
+    uint32_t tiles_per_row = frame_width / tile_width;
+    if ((row_size % tiles_per_row) != 0 || ((row_size / tiles_per_row) % word_size) != 0) {
+        return false;
+    }
+
+    layout->base = (uint8_t *) base;
+    layout->frame_width = frame_width;
+    layout->frame_height = frame_height;
+    layout->tile_width = tile_width;
+    layout->tile_height = tile_height;
+    layout->tiles_per_row = tiles_per_row;
+    layout->tiles_per_column = 1 + ((frame_height - 1) / tile_height);
+    layout->tile_row_size = row_size / tiles_per_row;
+    layout->tile_size = layout->tile_row_size * tile_height;
+
+    return true;
+}
+
+/*
+ * cmos_sensor_acquisition_tiled_frame_size
+ *
+ * Returns the size in bytes of a frame saved with layout.
+ */
+size_t cmos_sensor_acquisition_tiled_frame_size(const cmos_sensor_acquisition_tiled_layout *layout) {
+    return layout->tile_size * layout->tiles_per_row * layout->tiles_per_column;
+}
+
+/*
+ * cmos_sensor_acquisition_snapshot_tiled
+ *
+ * Performs a blocking snapshot operation in which the frame is saved in the
+ * tiled layout described by layout.
+ *
+ * Returns true if the frame was successfully saved, and false otherwise.
+ *
+ * One descriptor is chained per row of each tile, so the CPU must keep the
+ * msgdma fed with a new descriptor every tile_width pixels. Tiles should be
+ * wide enough (32 pixels or more) for this to keep up with the sensor.
+ */
+bool cmos_sensor_acquisition_snapshot_tiled(cmos_sensor_acquisition_dev *dev, const cmos_sensor_acquisition_tiled_layout *layout) {
+    strip_layout chained = {NULL, 0, layout->tiles_per_row * layout->frame_height, layout, NULL};
+    return snapshot_chained(dev, &chained, layout->tile_row_size, NULL, NULL);
+}
+
+/*
+ * cmos_sensor_acquisition_tiled_row
+ *
+ * Returns the address of the row segment of the tile containing pixel (x, y).
+ * The segment holds the tile_width pixels of frame row y starting at column
+ * (x - x % tile_width).
+ */
+void *cmos_sensor_acquisition_tiled_row(const cmos_sensor_acquisition_tiled_layout *layout, uint32_t x, uint32_t y) {
+    uint32_t tile_x = x / layout->tile_width;
+    uint32_t tile_y = y / layout->tile_height;
+
+    return layout->base + (tile_y * layout->tiles_per_row + tile_x) * layout->tile_size + (y % layout->tile_height) * layout->tile_row_size;
+}
+
+/*
+ * cmos_sensor_acquisition_tile_iterator_init
+ *
+ * Initializes it to iterate over the tiles of layout in memory order. Call
+ * cmos_sensor_acquisition_tile_iterator_next() to move to the first tile.
+ */
+void cmos_sensor_acquisition_tile_iterator_init(cmos_sensor_acquisition_tile_iterator *it, const cmos_sensor_acquisition_tiled_layout *layout) {
+    it->layout = layout;
+    it->index = 0;
+    it->tile = NULL;
+    it->x = 0;
+    it->y = 0;
+    it->width = 0;
+    it->height = 0;
+}
+
+/*
+ * cmos_sensor_acquisition_tile_iterator_next
+ *
+ * Moves it to the next tile. it->tile then points to the tile, (it->x, it->y)
+ * are the frame coordinates of its top-left pixel, and it->width x it->height
+ * are the dimensions of its valid part (only tiles of the last row of tiles can
+ * be partially valid). Rows of a tile are it->layout->tile_row_size bytes
+ * apart.
+ *
+ * Returns false once all tiles have been visited.
+ */
+bool cmos_sensor_acquisition_tile_iterator_next(cmos_sensor_acquisition_tile_iterator *it) {
+    const cmos_sensor_acquisition_tiled_layout *layout = it->layout;
+
+    if (it->index >= layout->tiles_per_row * layout->tiles_per_column) {
+        return false;
+    }
+
+    it->tile = layout->base + it->index * layout->tile_size;
+    it->x = (it->index % layout->tiles_per_row) * layout->tile_width;
+    it->y = (it->index / layout->tiles_per_row) * layout->tile_height;
+    it->width = layout->tile_width;
+    it->height = (layout->frame_height - it->y < layout->tile_height) ? (layout->frame_height - it->y) : layout->tile_height;
+    it->index++;
+
+    return true;
+}
+
+/*
+ * cmos_sensor_acquisition_planar_layout_init
+ *
+ * Initializes layout to describe a raw Bayer frame of the current
+ * configuration saved as 4 planes of (frame_width / 2) x (frame_height / 2)
+ * pixels, one per Bayer channel. The planes are stored one after the other at
+ * base. Use cmos_sensor_acquisition_planar_frame_size() to size the buffer, base
+ * can be set later if it is not known yet. The planes can also be moved to 4
+ * separate buffers of layout->plane_size bytes by overwriting layout->planes[]
+ * (each plane must start on a msgdma word boundary).
+ *
+ * Returns false if the Bayer plane splitter is disabled, if the frame is
+ * debayered, if the output has no rows to split (sparse, compressed or
+ * stats-only), if the frame dimensions are not even, or if a row of a plane
+ * does not fill a whole number of output words or does not end on a msgdma
+ * word boundary.
+ */
+bool cmos_sensor_acquisition_planar_layout_init(cmos_sensor_acquisition_dev *dev, cmos_sensor_acquisition_planar_layout *layout, void *base) {
+    uint32_t frame_width = cmos_sensor_acquisition_frame_width(dev);
+    uint32_t frame_height = cmos_sensor_acquisition_frame_height(dev);
+    size_t row_size = cmos_sensor_acquisition_strip_size(dev, 1);
+    size_t word_size = dev->msgdma.data_width / 8;
+
+    if (!dev->cmos_sensor_input.planar_enable || dev->cmos_sensor_input.debayer_enable) {
+        return false;
+    }
+
+    if (cmos_sensor_input_config_sparse_enabled(&dev->cmos_sensor_input) || cmos_sensor_input_config_compressor(&dev->cmos_sensor_input) || row_size == 0) {
+        return false;
+    }
+
+    if ((frame_width % 2) != 0 || (frame_height % 2) != 0 || !whole_output_words(dev, frame_width / 2)) {
+        return false;
+    }
+
+    if ((row_size % 2) != 0 || ((row_size / 2) % word_size) != 0) {
+        return false;
+    }
+
+    layout->frame_width = frame_width;
+    layout->frame_height = frame_height;
+    layout->plane_width = frame_width / 2;
+    layout->plane_height = frame_height / 2;
+    layout->plane_row_size = row_size / 2;
+    layout->plane_size = layout->plane_row_size * layout->plane_height;
+
+    for (uint32_t i = 0; i < 4; i++) {
+        layout->planes[i] = (base == NULL) ? NULL : ((uint8_t *) base) + i * layout->plane_size;
+    }
+
+    return true;
+}
+
+/*
+ * cmos_sensor_acquisition_planar_frame_size
+ *
+ * Returns the size in bytes of a frame saved with layout (all 4 planes).
+ */
+size_t cmos_sensor_acquisition_planar_frame_size(const cmos_sensor_acquisition_planar_layout *layout) {
+    return 4 * layout->plane_size;
+}
+
+/*
+ * cmos_sensor_acquisition_snapshot_planar
+ *
+ * Performs a blocking snapshot operation in which the 4 Bayer channels of the
+ * frame are saved in the planes described by layout. Row splitting is enabled
+ * in the cmos_sensor_input for the duration of the snapshot.
+ *
+ * Returns true if the frame was successfully saved, and false otherwise.
+ *
+ * Each row is split in 2 halves by the hardware, and one descriptor is chained
+ * per half row, so the CPU must keep the msgdma fed with a new descriptor every
+ * (frame_width / 2) pixels.
+ */
+bool cmos_sensor_acquisition_snapshot_planar(cmos_sensor_acquisition_dev *dev, const cmos_sensor_acquisition_planar_layout *layout) {
+    strip_layout chained = {NULL, 0, 2 * layout->frame_height, NULL, layout};
+
+    cmos_sensor_input_configure_planar(&dev->cmos_sensor_input, true);
+    bool success = snapshot_chained(dev, &chained, layout->plane_row_size, NULL, NULL);
+    cmos_sensor_input_configure_planar(&dev->cmos_sensor_input, false);
+
+    return success;
+}
+
+/*
+ * cmos_sensor_acquisition_planar_plane
+ *
+ * Returns the address of the plane of layout holding the given Bayer channel
+ * of a frame captured with the given Bayer pattern.
+ */
+void *cmos_sensor_acquisition_planar_plane(const cmos_sensor_acquisition_planar_layout *layout, cmos_sensor_input_debayer_pattern pattern, cmos_sensor_acquisition_bayer_channel channel) {
+    /* plane index of each channel (R, G1, G2, B) for each pattern */
+    static const uint8_t plane_index[4][4] = {
+        {0, 1, 2, 3}, /* RGGB */
+        {3, 2, 1, 0}, /* BGGR */
+        {1, 0, 3, 2}, /* GRBG */
+        {2, 3, 0, 1}  /* GBRG */
+    };
+
+    return layout->planes[plane_index[pattern][channel]];
+}
+
+/*
+ * cmos_sensor_acquisition_planar_row
+ *
+ * Returns the address of row y (0 <= y < layout->plane_height) of plane
+ * plane (0 to 3) of layout.
+ */
+void *cmos_sensor_acquisition_planar_row(const cmos_sensor_acquisition_planar_layout *layout, uint32_t plane, uint32_t y) {
+    return layout->planes[plane] + y * layout->plane_row_size;
+}
@@ -0,0 +1,392 @@
+#include <string.h>
+
+#include "cmos_sensor_acquisition_fanout.h"
+
+/*
+ * Every frame of the pool has a handle counting its holders: the producer
+ * between cmos_sensor_acquisition_fanout_acquire() and the end of
+ * cmos_sensor_acquisition_fanout_dispatch(), each consumer the frame is queued
+ * for until its callback returns, and whoever called
+ * cmos_sensor_acquisition_fanout_retain(). The frame goes back to the pool
+ * with the last release, so all consumers read the same buffer and none of
+ * them copies it.
+ *
+ * With threads (Linux), every consumer has a worker thread and a bounded
+ * queue. A consumer whose queue is full skips the frame, so it holds at most
+ * queue_depth + 1 frames (its queue and the frame its callback handles, plus
+ * the ones it retained) and a slow consumer can never starve the producer of
+ * frames: a pool of at least the sum of the queue depths, plus 1 frame per
+ * consumer, plus 1 frame always has a free frame for the next capture. Without
+ * threads (Nios II HAL), the consumers are called one after the other from
+ * cmos_sensor_acquisition_fanout_dispatch().
+ */
+
+/*******************************************************************************
+ *  Private API
+ ******************************************************************************/
+static void lock(cmos_sensor_acquisition_fanout *fanout);
+static void unlock(cmos_sensor_acquisition_fanout *fanout);
+static void ref_add(cmos_sensor_acquisition_frame *frame);
+static bool ref_sub(cmos_sensor_acquisition_frame *frame);
+static void deliver(cmos_sensor_acquisition_fanout_consumer *consumer, cmos_sensor_acquisition_frame *frame);
+#if defined(CMOS_SENSOR_ACQUISITION_FANOUT_THREADS)
+static void *consumer_thread(void *arg);
+static void stop_threads(cmos_sensor_acquisition_fanout *fanout, uint32_t count);
+#endif
+
+/*
+ * lock
+ *
+ * Takes the dispatcher's lock (no-op without threads).
+ */
+static void lock(cmos_sensor_acquisition_fanout *fanout) {
+#if defined(CMOS_SENSOR_ACQUISITION_FANOUT_THREADS)
+    pthread_mutex_lock(&fanout->lock);
+#else
+    (void) fanout;
+#endif
+}
+
+/*
+ * unlock
+ *
+ * Releases the dispatcher's lock (no-op without threads).
+ */
+static void unlock(cmos_sensor_acquisition_fanout *fanout) {
+#if defined(CMOS_SENSOR_ACQUISITION_FANOUT_THREADS)
+    pthread_mutex_unlock(&fanout->lock);
+#else
+    (void) fanout;
+#endif
+}
+
+/*
+ * ref_add
+ *
+ * Adds a holder to a frame.
+ */
+static void ref_add(cmos_sensor_acquisition_frame *frame) {
+#if defined(CMOS_SENSOR_ACQUISITION_FANOUT_THREADS)
+    __atomic_add_fetch(&frame->refs, 1, __ATOMIC_RELAXED);
+#else
+    frame->refs++;
+#endif
+}
+
+/*
+ * ref_sub
+ *
+ * Removes a holder from a frame.
+ *
+ * Returns true if it was the last one.
+ */
+static bool ref_sub(cmos_sensor_acquisition_frame *frame) {
+#if defined(CMOS_SENSOR_ACQUISITION_FANOUT_THREADS)
+    /* the last holder must see everything the others did with the frame */
+    return __atomic_sub_fetch(&frame->refs, 1, __ATOMIC_ACQ_REL) == 0;
+#else
+    return --frame->refs == 0;
+#endif
+}
+
+/*
+ * deliver
+ *
+ * Hands a frame the consumer holds to its callback, then releases it.
+ */
+static void deliver(cmos_sensor_acquisition_fanout_consumer *consumer, cmos_sensor_acquisition_frame *frame) {
+    consumer->callback(frame, consumer->context);
+    cmos_sensor_acquisition_fanout_release(frame);
+}
+
+#if defined(CMOS_SENSOR_ACQUISITION_FANOUT_THREADS)
+/*
+ * consumer_thread
+ *
+ * Worker thread of a consumer: handles its queued frames, oldest first, until
+ * the dispatcher is stopped.
+ */
+static void *consumer_thread(void *arg) {
+    cmos_sensor_acquisition_fanout_consumer *consumer = arg;
+    cmos_sensor_acquisition_fanout *fanout = consumer->fanout;
+
+    lock(fanout);
+    for (;;) {
+        while (fanout->running && consumer->queue_count == 0) {
+            pthread_cond_wait(&consumer->wakeup, &fanout->lock);
+        }
+
+        if (!fanout->running) {
+            break;
+        }
+
+        cmos_sensor_acquisition_frame *frame = consumer->queue[consumer->queue_head];
+        consumer->queue_head = (consumer->queue_head + 1) % CMOS_SENSOR_ACQUISITION_FANOUT_MAX_QUEUE_DEPTH;
+        consumer->queue_count--;
+        unlock(fanout);
+
+        deliver(consumer, frame);
+
+        lock(fanout);
+        consumer->processed++;
+    }
+    unlock(fanout);
+
+    return NULL;
+}
+
+/*
+ * stop_threads
+ *
+ * Stops the worker threads of the first count consumers.
+ */
+static void stop_threads(cmos_sensor_acquisition_fanout *fanout, uint32_t count) {
+    lock(fanout);
+    fanout->running = false;
+    for (uint32_t i = 0; i < count; i++) {
+        pthread_cond_signal(&fanout->consumers[i].wakeup);
+    }
+    unlock(fanout);
+
+    for (uint32_t i = 0; i < count; i++) {
+        pthread_join(fanout->consumers[i].thread, NULL);
+    }
+}
+#endif
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+
+/*
+ * cmos_sensor_acquisition_fanout_init
+ *
+ * Initializes a dispatcher handing out the frames of pool. Once the dispatcher
+ * is started, the pool must only be accessed through it.
+ *
+ * Returns true on success, and false otherwise.
+ */
+bool cmos_sensor_acquisition_fanout_init(cmos_sensor_acquisition_fanout *fanout, cmos_sensor_acquisition_frame_pool *pool) {
+    memset(fanout, 0, sizeof(*fanout));
+    fanout->pool = pool;
+
+    for (uint32_t i = 0; i < pool->num_frames; i++) {
+        fanout->frames[i].data = pool->frames + i * pool->frame_stride;
+        fanout->frames[i].fanout = fanout;
+    }
+
+#if defined(CMOS_SENSOR_ACQUISITION_FANOUT_THREADS)
+    if (pthread_mutex_init(&fanout->lock, NULL) != 0) {
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+/*
+ * cmos_sensor_acquisition_fanout_add_consumer
+ *
+ * Registers a consumer, before the dispatcher is started. callback receives
+ * every dispatched frame, unless queue_depth (1 to
+ * CMOS_SENSOR_ACQUISITION_FANOUT_MAX_QUEUE_DEPTH) frames are already waiting
+ * for it. It must not modify the frame, which other consumers read at the same
+ * time, and can keep it beyond its return with
+ * cmos_sensor_acquisition_fanout_retain().
+ *
+ * Returns true if the consumer was registered, and false otherwise.
+ */
+bool cmos_sensor_acquisition_fanout_add_consumer(cmos_sensor_acquisition_fanout *fanout, cmos_sensor_acquisition_fanout_callback callback, void *context, uint32_t queue_depth) {
+    if (fanout->running ||
+        fanout->consumer_count == CMOS_SENSOR_ACQUISITION_FANOUT_MAX_CONSUMERS ||
+        callback == NULL ||
+        queue_depth == 0 || queue_depth > CMOS_SENSOR_ACQUISITION_FANOUT_MAX_QUEUE_DEPTH) {
+        return false;
+    }
+
+    cmos_sensor_acquisition_fanout_consumer *consumer = &fanout->consumers[fanout->consumer_count];
+    memset(consumer, 0, sizeof(*consumer));
+    consumer->callback = callback;
+    consumer->context = context;
+    consumer->queue_depth = queue_depth;
+    consumer->fanout = fanout;
+
+    fanout->consumer_count++;
+
+    return true;
+}
+
+/*
+ * cmos_sensor_acquisition_fanout_start
+ *
+ * Starts the consumers' worker threads.
+ *
+ * Returns true on success, and false otherwise.
+ */
+bool cmos_sensor_acquisition_fanout_start(cmos_sensor_acquisition_fanout *fanout) {
+    if (fanout->running) {
+        return false;
+    }
+
+    fanout->running = true;
+
+#if defined(CMOS_SENSOR_ACQUISITION_FANOUT_THREADS)
+    for (uint32_t i = 0; i < fanout->consumer_count; i++) {
+        cmos_sensor_acquisition_fanout_consumer *consumer = &fanout->consumers[i];
+
+        if (pthread_cond_init(&consumer->wakeup, NULL) != 0) {
+            stop_threads(fanout, i);
+            return false;
+        }
+
+        if (pthread_create(&consumer->thread, NULL, consumer_thread, consumer) != 0) {
+            pthread_cond_destroy(&consumer->wakeup);
+            stop_threads(fanout, i);
+            return false;
+        }
+    }
+#endif
+
+    return true;
+}
+
+/*
+ * cmos_sensor_acquisition_fanout_stop
+ *
+ * Stops the consumers, and returns the frames still queued for them to the
+ * pool (they count as dropped). Frames retained by consumers go back to the
+ * pool when they release them. The dispatcher can then be destroyed by
+ * dropping it.
+ */
+void cmos_sensor_acquisition_fanout_stop(cmos_sensor_acquisition_fanout *fanout) {
+    if (!fanout->running) {
+        return;
+    }
+
+#if defined(CMOS_SENSOR_ACQUISITION_FANOUT_THREADS)
+    stop_threads(fanout, fanout->consumer_count);
+#endif
+    fanout->running = false;
+
+    for (uint32_t i = 0; i < fanout->consumer_count; i++) {
+        cmos_sensor_acquisition_fanout_consumer *consumer = &fanout->consumers[i];
+
+        while (consumer->queue_count > 0) {
+            cmos_sensor_acquisition_frame *frame = consumer->queue[consumer->queue_head];
+            consumer->queue_head = (consumer->queue_head + 1) % CMOS_SENSOR_ACQUISITION_FANOUT_MAX_QUEUE_DEPTH;
+            consumer->queue_count--;
+            consumer->dropped++;
+
+            cmos_sensor_acquisition_fanout_release(frame);
+        }
+
+#if defined(CMOS_SENSOR_ACQUISITION_FANOUT_THREADS)
+        pthread_cond_destroy(&consumer->wakeup);
+#endif
+    }
+}
+
+/*
+ * cmos_sensor_acquisition_fanout_acquire
+ *
+ * Takes a free frame of the pool, for the producer to capture into (see
+ * cmos_sensor_acquisition_frame_pool_acquire()). The producer holds the frame
+ * until it dispatches it.
+ *
+ * Returns the frame, or NULL if all frames are in use.
+ */
+cmos_sensor_acquisition_frame *cmos_sensor_acquisition_fanout_acquire(cmos_sensor_acquisition_fanout *fanout) {
+    cmos_sensor_acquisition_frame_pool *pool = fanout->pool;
+
+    lock(fanout);
+    uint8_t *data = cmos_sensor_acquisition_frame_pool_acquire(pool);
+    unlock(fanout);
+
+    if (data == NULL) {
+        return NULL;
+    }
+
+    cmos_sensor_acquisition_frame *frame = &fanout->frames[(data - pool->frames) / pool->frame_stride];
+    frame->refs = 1;
+    frame->size = 0;
+
+    return frame;
+}
+
+/*
+ * cmos_sensor_acquisition_fanout_dispatch
+ *
+ * Hands a frame the producer filled with size bytes to all consumers, and
+ * drops the producer's hold on it. If the msgdma wrote the frame through the
+ * data cache, cmos_sensor_acquisition_frame_pool_dma_done() must have been
+ * called first. Never blocks on a consumer with threads, and calls every
+ * consumer in turn without threads.
+ */
+void cmos_sensor_acquisition_fanout_dispatch(cmos_sensor_acquisition_fanout *fanout, cmos_sensor_acquisition_frame *frame, size_t size, uint64_t timestamp) {
+    frame->size = size;
+    frame->timestamp = timestamp;
+    frame->sequence = fanout->sequence;
+    fanout->sequence++;
+
+#if defined(CMOS_SENSOR_ACQUISITION_FANOUT_THREADS)
+    lock(fanout);
+    for (uint32_t i = 0; i < fanout->consumer_count; i++) {
+        cmos_sensor_acquisition_fanout_consumer *consumer = &fanout->consumers[i];
+
+        if (!fanout->running || consumer->queue_count == consumer->queue_depth) {
+            consumer->dropped++;
+            continue;
+        }
+
+        ref_add(frame);
+        consumer->queue[(consumer->queue_head + consumer->queue_count) % CMOS_SENSOR_ACQUISITION_FANOUT_MAX_QUEUE_DEPTH] = frame;
+        consumer->queue_count++;
+        pthread_cond_signal(&consumer->wakeup);
+    }
+    unlock(fanout);
+#else
+    for (uint32_t i = 0; i < fanout->consumer_count; i++) {
+        cmos_sensor_acquisition_fanout_consumer *consumer = &fanout->consumers[i];
+
+        if (!fanout->running) {
+            consumer->dropped++;
+            continue;
+        }
+
+        ref_add(frame);
+        deliver(consumer, frame);
+        consumer->processed++;
+    }
+#endif
+
+    cmos_sensor_acquisition_fanout_release(frame);
+}
+
+/*
+ * cmos_sensor_acquisition_fanout_retain
+ *
+ * Adds a holder to a frame, for a consumer to keep it after its callback
+ * returns (for instance until a network send completes). Every retain must be
+ * matched by a cmos_sensor_acquisition_fanout_release().
+ */
+void cmos_sensor_acquisition_fanout_retain(cmos_sensor_acquisition_frame *frame) {
+    ref_add(frame);
+}
+
+/*
+ * cmos_sensor_acquisition_fanout_release
+ *
+ * Removes a holder from a frame. The last one returns the frame to the pool.
+ * Can be called from any thread.
+ */
+void cmos_sensor_acquisition_fanout_release(cmos_sensor_acquisition_frame *frame) {
+    if (!ref_sub(frame)) {
+        return;
+    }
+
+    cmos_sensor_acquisition_fanout *fanout = frame->fanout;
+
+    lock(fanout);
+    cmos_sensor_acquisition_frame_pool_release(fanout->pool, frame->data);
+    unlock(fanout);
+}
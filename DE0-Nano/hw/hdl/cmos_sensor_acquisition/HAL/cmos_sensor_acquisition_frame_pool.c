@@ -0,0 +1,210 @@
+#include <stdlib.h>
+
+#include "cmos_sensor_acquisition_frame_pool.h"
+
+#ifdef __nios2_arch__
+#include <sys/alt_cache.h>
+
+#include "system.h"
+
+#else
+
+/* host build (Linux): the frames are coherent, there is nothing to maintain */
+#define alt_remap_uncached(ptr, len)              ((void *) (ptr))
+#define alt_dcache_flush(start, len)              ((void) (start), (void) (len))
+#define alt_dcache_flush_no_writeback(start, len) ((void) (start), (void) (len))
+
+#endif
+
+#ifndef NIOS2_DCACHE_LINE_SIZE
+#define NIOS2_DCACHE_LINE_SIZE (32)
+#endif
+
+/*******************************************************************************
+ *  Private API
+ ******************************************************************************/
+static size_t round_up(size_t x, size_t alignment);
+static int32_t frame_index(cmos_sensor_acquisition_frame_pool *pool, void *frame);
+
+/*
+ * round_up
+ *
+ * Rounds x up to the next multiple of alignment (which must be a power of 2).
+ */
+static size_t round_up(size_t x, size_t alignment) {
+    return (x + alignment - 1) & ~(alignment - 1);
+}
+
+/*
+ * frame_index
+ *
+ * Returns the index of frame in the pool, or -1 if frame does not belong to
+ * the pool.
+ */
+static int32_t frame_index(cmos_sensor_acquisition_frame_pool *pool, void *frame) {
+    uint8_t *address = (uint8_t *) frame;
+
+    if (address < pool->frames) {
+        return -1;
+    }
+
+    size_t offset = address - pool->frames;
+    if ((offset % pool->frame_stride) != 0 || (offset / pool->frame_stride) >= pool->num_frames) {
+        return -1;
+    }
+
+    return offset / pool->frame_stride;
+}
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+/*
+ * cmos_sensor_acquisition_frame_pool_alignment
+ *
+ * Returns the alignment to use for frames written by the msgdma of dev: the
+ * largest of the data cache line size and the msgdma's maximum burst size (in
+ * bytes), so that no cache line is shared between a frame and other data, and
+ * no burst crosses a burst boundary.
+ */
+size_t cmos_sensor_acquisition_frame_pool_alignment(cmos_sensor_acquisition_dev *dev) {
+    size_t alignment = NIOS2_DCACHE_LINE_SIZE;
+    size_t burst_size = dev->msgdma.data_width / 8;
+
+    if (dev->msgdma.burst_enable) {
+        burst_size *= dev->msgdma.max_burst_count;
+    }
+
+    if (burst_size > alignment) {
+        alignment = burst_size;
+    }
+
+    return alignment;
+}
+
+/*
+ * cmos_sensor_acquisition_frame_pool_init
+ *
+ * Allocates num_frames frames of frame_size bytes in a single block. Every
+ * frame starts on an alignment byte boundary (alignment must be a power of 2,
+ * see cmos_sensor_acquisition_frame_pool_alignment()). The memory is not
+ * cleared.
+ *
+ * If uncached is true, the frames are handed out through their uncached alias
+ * and no cache maintenance is needed afterwards. Otherwise, the frames are
+ * handed out as cached addresses and the data cache is invalidated over a frame
+ * whenever it passes from the msgdma to the CPU (or back to the pool).
+ *
+ * Returns true if the pool could be allocated, and false otherwise.
+ */
+bool cmos_sensor_acquisition_frame_pool_init(cmos_sensor_acquisition_frame_pool *pool, size_t frame_size, uint32_t num_frames, size_t alignment, bool uncached) {
+    if (num_frames == 0 || num_frames > CMOS_SENSOR_ACQUISITION_FRAME_POOL_MAX_FRAMES || frame_size == 0) {
+        return false;
+    }
+
+    if (alignment < NIOS2_DCACHE_LINE_SIZE) {
+        alignment = NIOS2_DCACHE_LINE_SIZE;
+    }
+
+    if ((alignment & (alignment - 1)) != 0) {
+        return false;
+    }
+
+    size_t frame_stride = round_up(frame_size, alignment);
+    size_t pool_size = frame_stride * num_frames;
+
+    void *memory = malloc(pool_size + alignment);
+    if (!memory) {
+        return false;
+    }
+
+    uint8_t *frames = (uint8_t *) round_up((size_t) memory, alignment);
+
+    if (uncached) {
+        /* also flushes the data cache over the whole pool */
+        frames = (uint8_t *) alt_remap_uncached(frames, pool_size);
+    } else {
+        /* nothing the CPU wrote before must be evicted over a DMA transfer */
+        alt_dcache_flush(frames, pool_size);
+    }
+
+    pool->memory = memory;
+    pool->frames = frames;
+    pool->frame_size = frame_size;
+    pool->frame_stride = frame_stride;
+    pool->num_frames = num_frames;
+    pool->free_mask = (num_frames == 32) ? 0xffffffff : ((1u << num_frames) - 1);
+    pool->uncached = uncached;
+
+    return true;
+}
+
+/*
+ * cmos_sensor_acquisition_frame_pool_destroy
+ *
+ * Frees the memory used by the pool. All frames must have been released.
+ */
+void cmos_sensor_acquisition_frame_pool_destroy(cmos_sensor_acquisition_frame_pool *pool) {
+    free(pool->memory);
+
+    pool->memory = NULL;
+    pool->frames = NULL;
+    pool->num_frames = 0;
+    pool->free_mask = 0;
+}
+
+/*
+ * cmos_sensor_acquisition_frame_pool_acquire
+ *
+ * Returns a free frame of the pool, ready to be used as msgdma target, or NULL
+ * if all frames are in use. Does not allocate memory.
+ */
+void *cmos_sensor_acquisition_frame_pool_acquire(cmos_sensor_acquisition_frame_pool *pool) {
+    for (uint32_t i = 0; i < pool->num_frames; i++) {
+        if (pool->free_mask & (1u << i)) {
+            pool->free_mask &= ~(1u << i);
+            return pool->frames + i * pool->frame_stride;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * cmos_sensor_acquisition_frame_pool_dma_done
+ *
+ * Hands frame over from the msgdma to the CPU once the msgdma has written size
+ * bytes to it. Invalidates the data cache over these bytes only, so that the
+ * CPU does not read stale lines. Nothing is done for uncached pools.
+ */
+void cmos_sensor_acquisition_frame_pool_dma_done(cmos_sensor_acquisition_frame_pool *pool, void *frame, size_t size) {
+    if (pool->uncached) {
+        return;
+    }
+
+    if (size > pool->frame_size) {
+        size = pool->frame_size;
+    }
+
+    alt_dcache_flush_no_writeback(frame, size);
+}
+
+/*
+ * cmos_sensor_acquisition_frame_pool_release
+ *
+ * Returns frame to the pool. Any data the CPU wrote to the frame is discarded
+ * from the data cache, so that it cannot be written back over the next DMA
+ * transfer into the frame.
+ */
+void cmos_sensor_acquisition_frame_pool_release(cmos_sensor_acquisition_frame_pool *pool, void *frame) {
+    int32_t index = frame_index(pool, frame);
+    if (index < 0) {
+        return;
+    }
+
+    if (!pool->uncached) {
+        alt_dcache_flush_no_writeback(frame, pool->frame_stride);
+    }
+
+    pool->free_mask |= (1u << index);
+}
@@ -11,55 +11,147 @@
 
 /* cmos_sensor_input device structure */
 typedef struct cmos_sensor_input_dev {
-    void     *base;          /* Base address of component */
-    uint8_t  pix_depth;      /* Depth of each pixel sample */
-    uint32_t max_width;      /* Maximum input frame width */
-    uint32_t max_height;     /* Maximum input frame height */
-    uint32_t output_width;   /* Bus output width */
-    uint32_t fifo_depth;     /* Output FIFO depth */
-    bool     debayer_enable; /* Debayering enabled */
-    bool     packer_enable;  /* Packer enabled */
+    void     *base;                  /* Base address of component */
+    uint8_t  pix_depth;              /* Depth of each pixel sample */
+    uint32_t max_width;              /* Maximum input frame width */
+    uint32_t max_height;             /* Maximum input frame height */
+    uint32_t output_width;           /* Bus output width */
+    uint32_t fifo_depth;             /* Output FIFO depth */
+    bool     downscaler_enable;      /* Downscaler enabled */
+    bool     preview_enable;         /* Downscaled preview stream enabled */
+    bool     planar_enable;          /* Bayer plane splitter enabled */
+    bool     depth_reducer_enable;   /* Pixel depth reducer enabled */
+    uint8_t  reduced_pix_depth;      /* Depth of each pixel sample once reduced */
+    bool     debayer_enable;         /* Debayering enabled */
+    bool     color_converter_enable; /* Output color format converter enabled */
+    bool     packer_enable;          /* Packer enabled */
+    uint8_t  stage_count;            /* Number of processing stages */
+    uint8_t  blob_count;             /* Number of blobs tracked per frame */
+    bool     sparse_enable;          /* Sparse (x, y, value) output enabled */
+    bool     compressor_enable;      /* Lossless compressor enabled */
 } cmos_sensor_input_dev;
 
 typedef enum cmos_sensor_input_debayer_pattern {RGGB, BGGR, GRBG, GBRG} cmos_sensor_input_debayer_pattern;
+typedef enum cmos_sensor_input_downscale_factor {DOWNSCALE_1X1, DOWNSCALE_2X2, DOWNSCALE_4X4} cmos_sensor_input_downscale_factor;
+typedef enum cmos_sensor_input_downscale_mode {DOWNSCALE_DECIMATE, DOWNSCALE_BIN} cmos_sensor_input_downscale_mode;
+typedef enum cmos_sensor_input_depth_mode {DEPTH_FULL, DEPTH_SHIFT, DEPTH_LUT} cmos_sensor_input_depth_mode;
+typedef enum cmos_sensor_input_output_format {OUTPUT_FORMAT_RGB, OUTPUT_FORMAT_RGB565, OUTPUT_FORMAT_RGB888, OUTPUT_FORMAT_YCBCR422} cmos_sensor_input_output_format;
+typedef enum cmos_sensor_input_conv3x3_preset {CONV3X3_IDENTITY, CONV3X3_BOX, CONV3X3_SHARPEN, CONV3X3_SOBEL_X, CONV3X3_SOBEL_Y} cmos_sensor_input_conv3x3_preset;
+
+/* CONV3X3 processing stage parameters */
+typedef struct cmos_sensor_input_conv3x3 {
+    int16_t coef[9]; /* Kernel coefficients, row-major */
+    uint8_t shift;   /* Arithmetic right shift of the sum (0 to 31) */
+    bool    abs;     /* Absolute value of the shifted sum */
+    int16_t bias;    /* Added to the result before saturation */
+} cmos_sensor_input_conv3x3;
+
+/* Blob statistics */
+typedef struct cmos_sensor_input_blob {
+    uint32_t pixels;    /* Number of lit pixels */
+    uint32_t sum_x;     /* Sum of the column index of the pixels */
+    uint32_t sum_y;     /* Sum of the row index of the pixels */
+    uint32_t sum_value; /* Sum of the pixel values */
+    uint16_t x_min;     /* Bounding box */
+    uint16_t x_max;
+    uint16_t y_min;
+    uint16_t y_max;
+} cmos_sensor_input_blob;
+
+/* Sparse output record */
+typedef struct cmos_sensor_input_sparse_pixel {
+    uint16_t x;     /* Column index (in split order if planar output is configured) */
+    uint16_t y;     /* Row index */
+    uint32_t value; /* Pixel value (reduced if the depth reducer is active) */
+} cmos_sensor_input_sparse_pixel;
 
 /*******************************************************************************
  *  Public API
  ******************************************************************************/
-cmos_sensor_input_dev cmos_sensor_input_inst(void *base, uint8_t pix_depth, uint32_t max_width, uint32_t max_height, uint32_t output_width, uint32_t fifo_depth, bool debayer_enable, bool packer_enable);
+cmos_sensor_input_dev cmos_sensor_input_inst(void *base, uint8_t pix_depth, uint32_t max_width, uint32_t max_height, uint32_t output_width, uint32_t fifo_depth, bool downscaler_enable, bool preview_enable, bool planar_enable, bool depth_reducer_enable, uint8_t reduced_pix_depth, bool debayer_enable, bool color_converter_enable, bool packer_enable, uint8_t stage_count, uint8_t blob_count, bool sparse_enable, bool compressor_enable);
 
 /*
  * Helper macro for easily constructing device structures. The user needs to
  * provide the component's prefix, and the corresponding device structure is
  * returned.
  */
-#define CMOS_SENSOR_INPUT_INST(prefix)                 \
-    cmos_sensor_input_inst(((void *) prefix ## _BASE), \
-                           prefix ## _PIX_DEPTH,       \
-                           prefix ## _MAX_WIDTH,       \
-                           prefix ## _MAX_HEIGHT,      \
-                           prefix ## _OUTPUT_WIDTH,    \
-                           prefix ## _FIFO_DEPTH,      \
-                           prefix ## _DEBAYER_ENABLE,  \
-                           prefix ## _PACKER_ENABLE)
+#define CMOS_SENSOR_INPUT_INST(prefix)                        \
+    cmos_sensor_input_inst(((void *) prefix ## _BASE),        \
+                           prefix ## _PIX_DEPTH,              \
+                           prefix ## _MAX_WIDTH,              \
+                           prefix ## _MAX_HEIGHT,             \
+                           prefix ## _OUTPUT_WIDTH,           \
+                           prefix ## _FIFO_DEPTH,             \
+                           prefix ## _DOWNSCALER_ENABLE,      \
+                           prefix ## _PREVIEW_ENABLE,         \
+                           prefix ## _PLANAR_ENABLE,          \
+                           prefix ## _DEPTH_REDUCER_ENABLE,   \
+                           prefix ## _REDUCED_PIX_DEPTH,      \
+                           prefix ## _DEBAYER_ENABLE,         \
+                           prefix ## _COLOR_CONVERTER_ENABLE, \
+                           prefix ## _PACKER_ENABLE,          \
+                           prefix ## _STAGE_COUNT,            \
+                           prefix ## _BLOB_COUNT,             \
+                           prefix ## _SPARSE_ENABLE,          \
+                           prefix ## _COMPRESSOR_ENABLE)
 
 void cmos_sensor_input_init(cmos_sensor_input_dev *dev);
 
 void cmos_sensor_input_configure(cmos_sensor_input_dev *dev, bool irq, cmos_sensor_input_debayer_pattern pattern);
 bool cmos_sensor_input_config_irq_enabled(cmos_sensor_input_dev *dev);
 cmos_sensor_input_debayer_pattern cmos_sensor_input_config_debayer_pattern(cmos_sensor_input_dev *dev);
+void cmos_sensor_input_configure_downscaler(cmos_sensor_input_dev *dev, cmos_sensor_input_downscale_factor factor, cmos_sensor_input_downscale_mode mode);
+cmos_sensor_input_downscale_factor cmos_sensor_input_config_downscale_factor(cmos_sensor_input_dev *dev);
+cmos_sensor_input_downscale_mode cmos_sensor_input_config_downscale_mode(cmos_sensor_input_dev *dev);
+void cmos_sensor_input_configure_planar(cmos_sensor_input_dev *dev, bool planar);
+bool cmos_sensor_input_config_planar(cmos_sensor_input_dev *dev);
+void cmos_sensor_input_configure_depth_mode(cmos_sensor_input_dev *dev, cmos_sensor_input_depth_mode mode);
+cmos_sensor_input_depth_mode cmos_sensor_input_config_depth_mode(cmos_sensor_input_dev *dev);
+bool cmos_sensor_input_load_depth_lut(cmos_sensor_input_dev *dev, const uint16_t *lut);
+uint8_t cmos_sensor_input_output_pix_depth(cmos_sensor_input_dev *dev);
+void cmos_sensor_input_configure_output_format(cmos_sensor_input_dev *dev, cmos_sensor_input_output_format format);
+cmos_sensor_input_output_format cmos_sensor_input_config_output_format(cmos_sensor_input_dev *dev);
+uint32_t cmos_sensor_input_output_pix_bits(cmos_sensor_input_dev *dev);
+bool cmos_sensor_input_stage_write(cmos_sensor_input_dev *dev, uint8_t stage, uint8_t word, const uint32_t *values, uint32_t count);
+bool cmos_sensor_input_configure_stage(cmos_sensor_input_dev *dev, uint8_t stage, bool enable);
+bool cmos_sensor_input_configure_stage_gain(cmos_sensor_input_dev *dev, uint8_t stage, uint16_t gain, uint16_t offset);
+bool cmos_sensor_input_configure_stage_conv3x3(cmos_sensor_input_dev *dev, uint8_t stage, const cmos_sensor_input_conv3x3 *conv);
+cmos_sensor_input_conv3x3 cmos_sensor_input_conv3x3_preset_kernel(cmos_sensor_input_conv3x3_preset preset);
+void cmos_sensor_input_conv3x3_reference(const uint16_t *src, uint16_t *dst, uint32_t width, uint32_t height, uint8_t pix_depth, const cmos_sensor_input_conv3x3 *conv);
+bool cmos_sensor_input_configure_blob(cmos_sensor_input_dev *dev, uint16_t threshold, bool stats_only);
+uint16_t cmos_sensor_input_config_blob_threshold(cmos_sensor_input_dev *dev);
+bool cmos_sensor_input_config_blob_stats_only(cmos_sensor_input_dev *dev);
+uint32_t cmos_sensor_input_read_blobs(cmos_sensor_input_dev *dev, cmos_sensor_input_blob *blobs, uint32_t max_blobs, bool *overflow);
+bool cmos_sensor_input_configure_sparse(cmos_sensor_input_dev *dev, uint16_t threshold, bool enable);
+uint16_t cmos_sensor_input_config_sparse_threshold(cmos_sensor_input_dev *dev);
+bool cmos_sensor_input_config_sparse_enabled(cmos_sensor_input_dev *dev);
+uint32_t cmos_sensor_input_sparse_decode(cmos_sensor_input_dev *dev, const void *buffer, size_t size, cmos_sensor_input_sparse_pixel *pixels, uint32_t max_pixels, bool *complete);
+void cmos_sensor_input_configure_compressor(cmos_sensor_input_dev *dev, bool compress);
+bool cmos_sensor_input_config_compressor(cmos_sensor_input_dev *dev);
+size_t cmos_sensor_input_compressed_size_bound(cmos_sensor_input_dev *dev, uint32_t frame_width, uint32_t frame_height);
+bool cmos_sensor_input_compressed_decode(cmos_sensor_input_dev *dev, const void *buffer, size_t size, uint16_t *pixels, uint32_t width, uint32_t height);
 void cmos_sensor_input_command_get_frame_info_sync(cmos_sensor_input_dev *dev);
 void cmos_sensor_input_command_get_frame_info_async(cmos_sensor_input_dev *dev);
 bool cmos_sensor_input_command_snapshot_sync(cmos_sensor_input_dev *dev);
 void cmos_sensor_input_command_snapshot_async(cmos_sensor_input_dev *dev);
+bool cmos_sensor_input_command_get_frame_info_enqueue(cmos_sensor_input_dev *dev);
+bool cmos_sensor_input_command_snapshot_enqueue(cmos_sensor_input_dev *dev);
 void cmos_sensor_input_command_irq_ack(cmos_sensor_input_dev *dev);
 void cmos_sensor_input_command_stop_and_reset(cmos_sensor_input_dev *dev);
 bool cmos_sensor_input_status_idle(cmos_sensor_input_dev *dev);
 bool cmos_sensor_input_status_fifo_ovfl(cmos_sensor_input_dev *dev);
 uint32_t cmos_sensor_input_status_fifo_fill_level(cmos_sensor_input_dev *dev);
+uint32_t cmos_sensor_input_status_cmd_fifo_fill_level(cmos_sensor_input_dev *dev);
+bool cmos_sensor_input_status_cmd_fifo_full(cmos_sensor_input_dev *dev);
 uint32_t cmos_sensor_input_frame_info_frame_width(cmos_sensor_input_dev *dev);
 uint32_t cmos_sensor_input_frame_info_frame_height(cmos_sensor_input_dev *dev);
+uint32_t cmos_sensor_input_output_frame_width(cmos_sensor_input_dev *dev);
+uint32_t cmos_sensor_input_output_frame_height(cmos_sensor_input_dev *dev);
 bool cmos_sensor_input_wait_until_idle(cmos_sensor_input_dev *dev);
 size_t cmos_sensor_input_frame_size(cmos_sensor_input_dev *dev);
+size_t cmos_sensor_input_strip_size(cmos_sensor_input_dev *dev, uint32_t lines);
+uint32_t cmos_sensor_input_preview_frame_width(cmos_sensor_input_dev *dev);
+uint32_t cmos_sensor_input_preview_frame_height(cmos_sensor_input_dev *dev);
+size_t cmos_sensor_input_preview_frame_size(cmos_sensor_input_dev *dev);
 
 #endif /* __CMOS_SENSOR_INPUT_H__ */
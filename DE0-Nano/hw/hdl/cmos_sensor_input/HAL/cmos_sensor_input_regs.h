@@ -44,62 +44,209 @@ static uint32_t mask_ofst(uint32_t mask) {
     return log2_of_pow_2(mask & (~mask + 1));
 }
 
-#define CMOS_SENSOR_INPUT_CONFIG_OFST                       (0 * 4) /* RW */
-#define CMOS_SENSOR_INPUT_COMMAND_OFST                      (1 * 4) /* WO */
-#define CMOS_SENSOR_INPUT_STATUS_OFST                       (2 * 4) /* RO */
-#define CMOS_SENSOR_INPUT_FRAME_INFO_OFST                   (3 * 4) /* RO */
-
-#define CMOS_SENSOR_INPUT_CONFIG_ADDR(base)                 ((void *) ((uint8_t *) (base) + CMOS_SENSOR_INPUT_CONFIG_OFST))
-#define CMOS_SENSOR_INPUT_COMMAND_ADDR(base)                ((void *) ((uint8_t *) (base) + CMOS_SENSOR_INPUT_COMMAND_OFST))
-#define CMOS_SENSOR_INPUT_STATUS_ADDR(base)                 ((void *) ((uint8_t *) (base) + CMOS_SENSOR_INPUT_STATUS_OFST))
-#define CMOS_SENSOR_INPUT_FRAME_INFO_ADDR(base)             ((void *) ((uint8_t *) (base) + CMOS_SENSOR_INPUT_FRAME_INFO_OFST))
-
-#define CMOS_SENSOR_INPUT_CONFIG_IRQ_MASK                   (0x00000001)
-#define CMOS_SENSOR_INPUT_CONFIG_IRQ_OFST                   (mask_ofst(CMOS_SENSOR_INPUT_CONFIG_IRQ_MASK))
-#define CMOS_SENSOR_INPUT_CONFIG_IRQ_DISABLE                (0)
-#define CMOS_SENSOR_INPUT_CONFIG_IRQ_ENABLE                 (1)
-#define CMOS_SENSOR_INPUT_CONFIG_IRQ_DISABLE_MASK           (CMOS_SENSOR_INPUT_CONFIG_IRQ_DISABLE << CMOS_SENSOR_INPUT_CONFIG_IRQ_OFST)
-#define CMOS_SENSOR_INPUT_CONFIG_IRQ_ENABLE_MASK            (CMOS_SENSOR_INPUT_CONFIG_IRQ_ENABLE << CMOS_SENSOR_INPUT_CONFIG_IRQ_OFST)
-#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_MASK       (0x00000006)
-#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_OFST       (mask_ofst(CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_MASK))
-#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_RGGB       (0)
-#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_BGGR       (1)
-#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_GRBG       (2)
-#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_GBRG       (3)
-#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_RGGB_MASK  (0 << CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_OFST)
-#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_BGGR_MASK  (1 << CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_OFST)
-#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_GRBG_MASK  (2 << CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_OFST)
-#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_GBRG_MASK  (3 << CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_OFST)
-
-#define CMOS_SENSOR_INPUT_COMMAND_GET_FRAME_INFO            (0)
-#define CMOS_SENSOR_INPUT_COMMAND_SNAPSHOT                  (1)
-#define CMOS_SENSOR_INPUT_COMMAND_IRQ_ACK                   (2)
-#define CMOS_SENSOR_INPUT_COMMAND_STOP_AND_RESET            (3)
-
-#define CMOS_SENSOR_INPUT_STATUS_STATE_MASK                 (0x00000001)
-#define CMOS_SENSOR_INPUT_STATUS_STATE_OFST                 (mask_ofst(CMOS_SENSOR_INPUT_STATUS_STATE_MASK))
-#define CMOS_SENSOR_INPUT_STATUS_STATE_IDLE                 (0)
-#define CMOS_SENSOR_INPUT_STATUS_STATE_BUSY                 (1)
-#define CMOS_SENSOR_INPUT_STATUS_STATE_IDLE_MASK            (0 << CMOS_SENSOR_INPUT_STATUS_STATE_OFST)
-#define CMOS_SENSOR_INPUT_STATUS_STATE_BUSY_MASK            (1 << CMOS_SENSOR_INPUT_STATUS_STATE_OFST)
-#define CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_MASK             (0x00000002)
-#define CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_OFST             (mask_ofst(CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_MASK))
-#define CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_NO_OVERFLOW      (0)
-#define CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_OVERFLOW         (1)
-#define CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_NO_OVERFLOW_MASK (CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_NO_OVERFLOW << CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_OFST)
-#define CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_OVERFLOW_MASK    (CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_OVERFLOW << CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_OFST)
-#define CMOS_SENSOR_INPUT_STATUS_FIFO_USEDW_MASK            (0x00001ffc)
-#define CMOS_SENSOR_INPUT_STATUS_FIFO_USEDW_OFST            (mask_ofst(CMOS_SENSOR_INPUT_STATUS_FIFO_USEDW_MASK))
-
-#define CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_WIDTH_MASK       (0x0000ffff)
-#define CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_WIDTH_OFST       (mask_ofst(CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_WIDTH_MASK))
-#define CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_HEIGHT_MASK      (0xffff0000)
-#define CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_HEIGHT_OFST      (mask_ofst(CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_HEIGHT_MASK))
-
-#define CMOS_SENSOR_INPUT_WR_CONFIG(base, data)             cmos_sensor_input_write_word(CMOS_SENSOR_INPUT_CONFIG_ADDR((base)), (data))
-#define CMOS_SENSOR_INPUT_WR_COMMAND(base, data)            cmos_sensor_input_write_word(CMOS_SENSOR_INPUT_COMMAND_ADDR((base)), (data))
-#define CMOS_SENSOR_INPUT_RD_CONFIG(base)                   cmos_sensor_input_read_word(CMOS_SENSOR_INPUT_CONFIG_ADDR((base)))
-#define CMOS_SENSOR_INPUT_RD_STATUS(base)                   cmos_sensor_input_read_word(CMOS_SENSOR_INPUT_STATUS_ADDR((base)))
-#define CMOS_SENSOR_INPUT_RD_FRAME_INFO(base)               cmos_sensor_input_read_word(CMOS_SENSOR_INPUT_FRAME_INFO_ADDR((base)))
+#define CMOS_SENSOR_INPUT_CMD_FIFO_DEPTH                      (4)
+#define CMOS_SENSOR_INPUT_MAX_STAGE_COUNT                     (4)
+#define CMOS_SENSOR_INPUT_MAX_BLOB_COUNT                      (8)
+#define CMOS_SENSOR_INPUT_COMPRESS_ESCAPE_Q                   (8)
+#define CMOS_SENSOR_INPUT_COMPRESS_ACC_SHIFT                  (4)
+
+#define CMOS_SENSOR_INPUT_CONFIG_OFST                         (0 * 4) /* RW */
+#define CMOS_SENSOR_INPUT_COMMAND_OFST                        (1 * 4) /* WO */
+#define CMOS_SENSOR_INPUT_STATUS_OFST                         (2 * 4) /* RO */
+#define CMOS_SENSOR_INPUT_FRAME_INFO_OFST                     (3 * 4) /* RO */
+#define CMOS_SENSOR_INPUT_DEPTH_LUT_OFST                      (4 * 4) /* WO */
+#define CMOS_SENSOR_INPUT_STAGE_ADDR_OFST                     (5 * 4) /* RW */
+#define CMOS_SENSOR_INPUT_STAGE_DATA_OFST                     (6 * 4) /* WO */
+#define CMOS_SENSOR_INPUT_BLOB_CONFIG_OFST                    (7 * 4) /* RW */
+#define CMOS_SENSOR_INPUT_BLOB_ADDR_OFST                      (8 * 4) /* RW */
+#define CMOS_SENSOR_INPUT_BLOB_DATA_OFST                      (9 * 4) /* RO */
+#define CMOS_SENSOR_INPUT_SPARSE_CONFIG_OFST                  (10 * 4) /* RW */
+
+#define CMOS_SENSOR_INPUT_CONFIG_ADDR(base)                   ((void *) ((uint8_t *) (base) + CMOS_SENSOR_INPUT_CONFIG_OFST))
+#define CMOS_SENSOR_INPUT_COMMAND_ADDR(base)                  ((void *) ((uint8_t *) (base) + CMOS_SENSOR_INPUT_COMMAND_OFST))
+#define CMOS_SENSOR_INPUT_STATUS_ADDR(base)                   ((void *) ((uint8_t *) (base) + CMOS_SENSOR_INPUT_STATUS_OFST))
+#define CMOS_SENSOR_INPUT_FRAME_INFO_ADDR(base)               ((void *) ((uint8_t *) (base) + CMOS_SENSOR_INPUT_FRAME_INFO_OFST))
+#define CMOS_SENSOR_INPUT_DEPTH_LUT_ADDR(base)                ((void *) ((uint8_t *) (base) + CMOS_SENSOR_INPUT_DEPTH_LUT_OFST))
+#define CMOS_SENSOR_INPUT_STAGE_ADDR_ADDR(base)               ((void *) ((uint8_t *) (base) + CMOS_SENSOR_INPUT_STAGE_ADDR_OFST))
+#define CMOS_SENSOR_INPUT_STAGE_DATA_ADDR(base)               ((void *) ((uint8_t *) (base) + CMOS_SENSOR_INPUT_STAGE_DATA_OFST))
+#define CMOS_SENSOR_INPUT_BLOB_CONFIG_ADDR(base)              ((void *) ((uint8_t *) (base) + CMOS_SENSOR_INPUT_BLOB_CONFIG_OFST))
+#define CMOS_SENSOR_INPUT_BLOB_ADDR_ADDR(base)                ((void *) ((uint8_t *) (base) + CMOS_SENSOR_INPUT_BLOB_ADDR_OFST))
+#define CMOS_SENSOR_INPUT_BLOB_DATA_ADDR(base)                ((void *) ((uint8_t *) (base) + CMOS_SENSOR_INPUT_BLOB_DATA_OFST))
+#define CMOS_SENSOR_INPUT_SPARSE_CONFIG_ADDR(base)            ((void *) ((uint8_t *) (base) + CMOS_SENSOR_INPUT_SPARSE_CONFIG_OFST))
+
+#define CMOS_SENSOR_INPUT_CONFIG_IRQ_MASK                     (0x00000001)
+#define CMOS_SENSOR_INPUT_CONFIG_IRQ_OFST                     (mask_ofst(CMOS_SENSOR_INPUT_CONFIG_IRQ_MASK))
+#define CMOS_SENSOR_INPUT_CONFIG_IRQ_DISABLE                  (0)
+#define CMOS_SENSOR_INPUT_CONFIG_IRQ_ENABLE                   (1)
+#define CMOS_SENSOR_INPUT_CONFIG_IRQ_DISABLE_MASK             (CMOS_SENSOR_INPUT_CONFIG_IRQ_DISABLE << CMOS_SENSOR_INPUT_CONFIG_IRQ_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_IRQ_ENABLE_MASK              (CMOS_SENSOR_INPUT_CONFIG_IRQ_ENABLE << CMOS_SENSOR_INPUT_CONFIG_IRQ_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_MASK         (0x00000006)
+#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_OFST         (mask_ofst(CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_MASK))
+#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_RGGB         (0)
+#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_BGGR         (1)
+#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_GRBG         (2)
+#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_GBRG         (3)
+#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_RGGB_MASK    (0 << CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_BGGR_MASK    (1 << CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_GRBG_MASK    (2 << CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_GBRG_MASK    (3 << CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_MASK          (0x00000008)
+#define CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_OFST          (mask_ofst(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_MASK))
+#define CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_DECIMATE      (0)
+#define CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_BIN           (1)
+#define CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_DECIMATE_MASK (CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_DECIMATE << CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_BIN_MASK      (CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_BIN << CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_MASK        (0x00000030)
+#define CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_OFST        (mask_ofst(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_MASK))
+#define CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_1X1         (0)
+#define CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_2X2         (1)
+#define CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_4X4         (2)
+#define CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_1X1_MASK    (0 << CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_2X2_MASK    (1 << CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_4X4_MASK    (2 << CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_PLANAR_MASK                  (0x00000040)
+#define CMOS_SENSOR_INPUT_CONFIG_PLANAR_OFST                  (mask_ofst(CMOS_SENSOR_INPUT_CONFIG_PLANAR_MASK))
+#define CMOS_SENSOR_INPUT_CONFIG_PLANAR_DISABLE               (0)
+#define CMOS_SENSOR_INPUT_CONFIG_PLANAR_ENABLE                (1)
+#define CMOS_SENSOR_INPUT_CONFIG_PLANAR_DISABLE_MASK          (CMOS_SENSOR_INPUT_CONFIG_PLANAR_DISABLE << CMOS_SENSOR_INPUT_CONFIG_PLANAR_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_PLANAR_ENABLE_MASK           (CMOS_SENSOR_INPUT_CONFIG_PLANAR_ENABLE << CMOS_SENSOR_INPUT_CONFIG_PLANAR_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_MASK              (0x00000180)
+#define CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_OFST              (mask_ofst(CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_MASK))
+#define CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_FULL              (0)
+#define CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_SHIFT             (1)
+#define CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_LUT               (2)
+#define CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_FULL_MASK         (0 << CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_SHIFT_MASK        (1 << CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_LUT_MASK          (2 << CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_MASK           (0x00000600)
+#define CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_OFST           (mask_ofst(CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_MASK))
+#define CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB            (0)
+#define CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB565         (1)
+#define CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB888         (2)
+#define CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_YCBCR422       (3)
+#define CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB_MASK       (0 << CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB565_MASK    (1 << CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB888_MASK    (2 << CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_YCBCR422_MASK  (3 << CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_COMPRESS_MASK                (0x00000800)
+#define CMOS_SENSOR_INPUT_CONFIG_COMPRESS_OFST                (mask_ofst(CMOS_SENSOR_INPUT_CONFIG_COMPRESS_MASK))
+#define CMOS_SENSOR_INPUT_CONFIG_COMPRESS_DISABLE             (0)
+#define CMOS_SENSOR_INPUT_CONFIG_COMPRESS_ENABLE              (1)
+#define CMOS_SENSOR_INPUT_CONFIG_COMPRESS_DISABLE_MASK        (CMOS_SENSOR_INPUT_CONFIG_COMPRESS_DISABLE << CMOS_SENSOR_INPUT_CONFIG_COMPRESS_OFST)
+#define CMOS_SENSOR_INPUT_CONFIG_COMPRESS_ENABLE_MASK         (CMOS_SENSOR_INPUT_CONFIG_COMPRESS_ENABLE << CMOS_SENSOR_INPUT_CONFIG_COMPRESS_OFST)
+
+#define CMOS_SENSOR_INPUT_COMMAND_GET_FRAME_INFO              (0)
+#define CMOS_SENSOR_INPUT_COMMAND_SNAPSHOT                    (1)
+#define CMOS_SENSOR_INPUT_COMMAND_IRQ_ACK                     (2)
+#define CMOS_SENSOR_INPUT_COMMAND_STOP_AND_RESET              (3)
+
+#define CMOS_SENSOR_INPUT_STATUS_STATE_MASK                   (0x00000001)
+#define CMOS_SENSOR_INPUT_STATUS_STATE_OFST                   (mask_ofst(CMOS_SENSOR_INPUT_STATUS_STATE_MASK))
+#define CMOS_SENSOR_INPUT_STATUS_STATE_IDLE                   (0)
+#define CMOS_SENSOR_INPUT_STATUS_STATE_BUSY                   (1)
+#define CMOS_SENSOR_INPUT_STATUS_STATE_IDLE_MASK              (0 << CMOS_SENSOR_INPUT_STATUS_STATE_OFST)
+#define CMOS_SENSOR_INPUT_STATUS_STATE_BUSY_MASK              (1 << CMOS_SENSOR_INPUT_STATUS_STATE_OFST)
+#define CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_MASK               (0x00000002)
+#define CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_OFST               (mask_ofst(CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_MASK))
+#define CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_NO_OVERFLOW        (0)
+#define CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_OVERFLOW           (1)
+#define CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_NO_OVERFLOW_MASK   (CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_NO_OVERFLOW << CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_OFST)
+#define CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_OVERFLOW_MASK      (CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_OVERFLOW << CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_OFST)
+#define CMOS_SENSOR_INPUT_STATUS_FIFO_USEDW_MASK              (0x00001ffc)
+#define CMOS_SENSOR_INPUT_STATUS_FIFO_USEDW_OFST              (mask_ofst(CMOS_SENSOR_INPUT_STATUS_FIFO_USEDW_MASK))
+#define CMOS_SENSOR_INPUT_STATUS_CMD_FIFO_USEDW_MASK          (0x0000e000)
+#define CMOS_SENSOR_INPUT_STATUS_CMD_FIFO_USEDW_OFST          (mask_ofst(CMOS_SENSOR_INPUT_STATUS_CMD_FIFO_USEDW_MASK))
+
+#define CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_WIDTH_MASK         (0x0000ffff)
+#define CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_WIDTH_OFST         (mask_ofst(CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_WIDTH_MASK))
+#define CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_HEIGHT_MASK        (0xffff0000)
+#define CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_HEIGHT_OFST        (mask_ofst(CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_HEIGHT_MASK))
+
+#define CMOS_SENSOR_INPUT_DEPTH_LUT_VALUE_MASK                (0x0000ffff)
+#define CMOS_SENSOR_INPUT_DEPTH_LUT_VALUE_OFST                (mask_ofst(CMOS_SENSOR_INPUT_DEPTH_LUT_VALUE_MASK))
+#define CMOS_SENSOR_INPUT_DEPTH_LUT_INDEX_MASK                (0xffff0000)
+#define CMOS_SENSOR_INPUT_DEPTH_LUT_INDEX_OFST                (mask_ofst(CMOS_SENSOR_INPUT_DEPTH_LUT_INDEX_MASK))
+
+#define CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_MASK                (0x000000ff)
+#define CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_OFST                (mask_ofst(CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_MASK))
+#define CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_MASK               (0x0000ff00)
+#define CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_OFST               (mask_ofst(CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_MASK))
+
+#define CMOS_SENSOR_INPUT_STAGE_CONTROL_WORD                  (0)
+#define CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_MASK           (0x00000001)
+#define CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_OFST           (mask_ofst(CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_MASK))
+#define CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_BYPASS         (0)
+#define CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_PROCESS        (1)
+#define CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_BYPASS_MASK    (CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_BYPASS << CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_OFST)
+#define CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_PROCESS_MASK   (CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_PROCESS << CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_OFST)
+
+#define CMOS_SENSOR_INPUT_STAGE_GAIN_WORD                     (1)
+#define CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_MASK                (0x0000ffff)
+#define CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_OFST                (mask_ofst(CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_MASK))
+#define CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_ONE                 (0x0100)
+#define CMOS_SENSOR_INPUT_STAGE_GAIN_OFFSET_MASK              (0xffff0000)
+#define CMOS_SENSOR_INPUT_STAGE_GAIN_OFFSET_OFST              (mask_ofst(CMOS_SENSOR_INPUT_STAGE_GAIN_OFFSET_MASK))
+
+#define CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_WORD             (1)
+#define CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_COUNT            (9)
+#define CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_MASK             (0x0000ffff)
+#define CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_OFST             (mask_ofst(CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_MASK))
+
+#define CMOS_SENSOR_INPUT_STAGE_CONV3X3_POST_WORD             (10)
+#define CMOS_SENSOR_INPUT_STAGE_CONV3X3_SHIFT_MASK            (0x0000001f)
+#define CMOS_SENSOR_INPUT_STAGE_CONV3X3_SHIFT_OFST            (mask_ofst(CMOS_SENSOR_INPUT_STAGE_CONV3X3_SHIFT_MASK))
+#define CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_MASK              (0x00000100)
+#define CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_OFST              (mask_ofst(CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_MASK))
+#define CMOS_SENSOR_INPUT_STAGE_CONV3X3_BIAS_MASK             (0xffff0000)
+#define CMOS_SENSOR_INPUT_STAGE_CONV3X3_BIAS_OFST             (mask_ofst(CMOS_SENSOR_INPUT_STAGE_CONV3X3_BIAS_MASK))
+
+#define CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_MASK          (0x0000ffff)
+#define CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_OFST          (mask_ofst(CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_MASK))
+#define CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_MASK         (0x00010000)
+#define CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_OFST         (mask_ofst(CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_MASK))
+
+#define CMOS_SENSOR_INPUT_BLOB_ADDR_WORD_MASK                 (0x000000ff)
+#define CMOS_SENSOR_INPUT_BLOB_ADDR_WORD_OFST                 (mask_ofst(CMOS_SENSOR_INPUT_BLOB_ADDR_WORD_MASK))
+
+#define CMOS_SENSOR_INPUT_BLOB_STATUS_WORD                    (0)
+#define CMOS_SENSOR_INPUT_BLOB_STATUS_COUNT_MASK              (0x000000ff)
+#define CMOS_SENSOR_INPUT_BLOB_STATUS_COUNT_OFST              (mask_ofst(CMOS_SENSOR_INPUT_BLOB_STATUS_COUNT_MASK))
+#define CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_MASK           (0x00000100)
+#define CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_OFST           (mask_ofst(CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_MASK))
+
+#define CMOS_SENSOR_INPUT_BLOB_RECORD_WORD                    (8)
+#define CMOS_SENSOR_INPUT_BLOB_RECORD_SIZE                    (8)
+#define CMOS_SENSOR_INPUT_BLOB_PIXELS_WORD                    (0)
+#define CMOS_SENSOR_INPUT_BLOB_SUM_X_WORD                     (1)
+#define CMOS_SENSOR_INPUT_BLOB_SUM_Y_WORD                     (2)
+#define CMOS_SENSOR_INPUT_BLOB_SUM_VALUE_WORD                 (3)
+#define CMOS_SENSOR_INPUT_BLOB_X_WORD                         (4)
+#define CMOS_SENSOR_INPUT_BLOB_Y_WORD                         (5)
+#define CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_MASK                (0x0000ffff)
+#define CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_OFST                (mask_ofst(CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_MASK))
+#define CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_MASK                (0xffff0000)
+#define CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_OFST                (mask_ofst(CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_MASK))
+
+#define CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_MASK        (0x0000ffff)
+#define CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_OFST        (mask_ofst(CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_MASK))
+#define CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_MASK           (0x00010000)
+#define CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_OFST           (mask_ofst(CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_MASK))
+
+#define CMOS_SENSOR_INPUT_WR_CONFIG(base,                     data)             cmos_sensor_input_write_word(CMOS_SENSOR_INPUT_CONFIG_ADDR((base)), (data))
+#define CMOS_SENSOR_INPUT_WR_COMMAND(base,                    data)            cmos_sensor_input_write_word(CMOS_SENSOR_INPUT_COMMAND_ADDR((base)), (data))
+#define CMOS_SENSOR_INPUT_WR_DEPTH_LUT(base,                  data)            cmos_sensor_input_write_word(CMOS_SENSOR_INPUT_DEPTH_LUT_ADDR((base)), (data))
+#define CMOS_SENSOR_INPUT_WR_STAGE_ADDR(base,                 data)            cmos_sensor_input_write_word(CMOS_SENSOR_INPUT_STAGE_ADDR_ADDR((base)), (data))
+#define CMOS_SENSOR_INPUT_WR_STAGE_DATA(base,                 data)            cmos_sensor_input_write_word(CMOS_SENSOR_INPUT_STAGE_DATA_ADDR((base)), (data))
+#define CMOS_SENSOR_INPUT_WR_BLOB_CONFIG(base,                data)            cmos_sensor_input_write_word(CMOS_SENSOR_INPUT_BLOB_CONFIG_ADDR((base)), (data))
+#define CMOS_SENSOR_INPUT_WR_BLOB_ADDR(base,                  data)            cmos_sensor_input_write_word(CMOS_SENSOR_INPUT_BLOB_ADDR_ADDR((base)), (data))
+#define CMOS_SENSOR_INPUT_WR_SPARSE_CONFIG(base,              data)            cmos_sensor_input_write_word(CMOS_SENSOR_INPUT_SPARSE_CONFIG_ADDR((base)), (data))
+#define CMOS_SENSOR_INPUT_RD_CONFIG(base)                     cmos_sensor_input_read_word(CMOS_SENSOR_INPUT_CONFIG_ADDR((base)))
+#define CMOS_SENSOR_INPUT_RD_STATUS(base)                     cmos_sensor_input_read_word(CMOS_SENSOR_INPUT_STATUS_ADDR((base)))
+#define CMOS_SENSOR_INPUT_RD_FRAME_INFO(base)                 cmos_sensor_input_read_word(CMOS_SENSOR_INPUT_FRAME_INFO_ADDR((base)))
+#define CMOS_SENSOR_INPUT_RD_STAGE_ADDR(base)                 cmos_sensor_input_read_word(CMOS_SENSOR_INPUT_STAGE_ADDR_ADDR((base)))
+#define CMOS_SENSOR_INPUT_RD_BLOB_CONFIG(base)                cmos_sensor_input_read_word(CMOS_SENSOR_INPUT_BLOB_CONFIG_ADDR((base)))
+#define CMOS_SENSOR_INPUT_RD_BLOB_ADDR(base)                  cmos_sensor_input_read_word(CMOS_SENSOR_INPUT_BLOB_ADDR_ADDR((base)))
+#define CMOS_SENSOR_INPUT_RD_BLOB_DATA(base)                  cmos_sensor_input_read_word(CMOS_SENSOR_INPUT_BLOB_DATA_ADDR((base)))
+#define CMOS_SENSOR_INPUT_RD_SPARSE_CONFIG(base)              cmos_sensor_input_read_word(CMOS_SENSOR_INPUT_SPARSE_CONFIG_ADDR((base)))
 
 #endif /* __CMOS_SENSOR_INPUT_REGS_H__ */
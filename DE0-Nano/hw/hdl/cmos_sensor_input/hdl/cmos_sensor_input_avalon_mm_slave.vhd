@@ -6,120 +6,336 @@ use work.cmos_sensor_input_constants.all;
 
 entity cmos_sensor_input_avalon_mm_slave is
     generic(
-        DEBAYER_ENABLE : boolean;
-        FIFO_DEPTH     : positive;
-        MAX_WIDTH      : positive;
-        MAX_HEIGHT     : positive
+        DEBAYER_ENABLE         : boolean;
+        DOWNSCALER_ENABLE      : boolean;
+        PLANAR_ENABLE          : boolean;
+        DEPTH_REDUCER_ENABLE   : boolean;
+        COLOR_CONVERTER_ENABLE : boolean;
+        STAGE_COUNT            : natural;
+        BLOB_COUNT             : natural;
+        SPARSE_ENABLE          : boolean;
+        COMPRESSOR_ENABLE      : boolean;
+        FIFO_DEPTH             : positive;
+        MAX_WIDTH              : positive;
+        MAX_HEIGHT             : positive
     );
     port(
-        clk             : in  std_logic;
-        reset           : in  std_logic;
+        clk              : in  std_logic;
+        reset            : in  std_logic;
 
         -- Avalon-MM Slave
-        addr            : in  std_logic_vector(1 downto 0);
-        read            : in  std_logic;
-        write           : in  std_logic;
-        rddata          : out std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
-        wrdata          : in  std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+        addr             : in  std_logic_vector(CMOS_SENSOR_INPUT_MM_S_ADDR_WIDTH - 1 downto 0);
+        read             : in  std_logic;
+        write            : in  std_logic;
+        rddata           : out std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+        wrdata           : in  std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
 
         -- Avalon Interrupt Sender
-        irq             : out std_logic;
+        irq              : out std_logic;
 
         -- sampler
-        idle            : in  std_logic;
-        snapshot        : out std_logic;
-        get_frame_info  : out std_logic;
-        irq_en          : out std_logic;
-        irq_ack         : out std_logic;
-        wait_irq_ack    : in  std_logic;
-        frame_width     : in  std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
-        frame_height    : in  std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+        idle             : in  std_logic;
+        config_latch     : in  std_logic;
+        snapshot         : out std_logic;
+        get_frame_info   : out std_logic;
+        irq_en           : out std_logic;
+        irq_ack          : out std_logic;
+        wait_irq_ack     : in  std_logic;
+        frame_width      : in  std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+        frame_height     : in  std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
 
         -- debayer
-        debayer_pattern : out std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_WIDTH - 1 downto 0);
+        debayer_pattern  : out std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_WIDTH - 1 downto 0);
+
+        -- downscaler
+        downscale_mode   : out std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_WIDTH - 1 downto 0);
+        downscale_factor : out std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_WIDTH - 1 downto 0);
+
+        -- planar
+        planar           : out std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_PLANAR_WIDTH - 1 downto 0);
+
+        -- depth_reducer
+        depth_mode       : out std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_WIDTH - 1 downto 0);
+        depth_lut_write  : out std_logic;
+        depth_lut_index  : out std_logic_vector(CMOS_SENSOR_INPUT_DEPTH_LUT_INDEX_WIDTH - 1 downto 0);
+        depth_lut_value  : out std_logic_vector(CMOS_SENSOR_INPUT_DEPTH_LUT_VALUE_WIDTH - 1 downto 0);
+
+        -- color_converter
+        output_format    : out std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_WIDTH - 1 downto 0);
+
+        -- stage_chain
+        stage_write      : out std_logic;
+        stage_index      : out std_logic_vector(CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_WIDTH - 1 downto 0);
+        stage_word       : out std_logic_vector(CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_WIDTH - 1 downto 0);
+        stage_data       : out std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+
+        -- blob
+        blob_threshold   : out std_logic_vector(CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_WIDTH - 1 downto 0);
+        blob_stats_only  : out std_logic_vector(CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_WIDTH - 1 downto 0);
+        blob_word        : out std_logic_vector(CMOS_SENSOR_INPUT_BLOB_ADDR_WORD_WIDTH - 1 downto 0);
+        blob_data        : in  std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+
+        -- sparse
+        sparse_threshold : out std_logic_vector(CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_WIDTH - 1 downto 0);
+        sparse_enable    : out std_logic_vector(CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_WIDTH - 1 downto 0);
+
+        -- compressor
+        compress         : out std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_COMPRESS_WIDTH - 1 downto 0);
 
         -- fifo
-        fifo_usedw      : in  std_logic_vector(bit_width(FIFO_DEPTH) - 1 downto 0);
-        fifo_overflow   : in  std_logic;
+        fifo_usedw       : in  std_logic_vector(bit_width(FIFO_DEPTH) - 1 downto 0);
+        fifo_overflow    : in  std_logic;
 
-        -- sampler / debayer / packer / fifo / st_source
-        stop_and_reset  : out std_logic
+        -- sampler / downscaler / stage_chain / blob / planar / depth_reducer / debayer / color_converter / sparse / compressor / packer / fifo / st_source
+        stop_and_reset   : out std_logic
     );
 end entity cmos_sensor_input_avalon_mm_slave;
 
 architecture rtl of cmos_sensor_input_avalon_mm_slave is
 
     -- MM_WRITE
-    signal reg_snapshot        : std_logic;
-    signal reg_get_frame_info  : std_logic;
-    signal reg_irq_en          : std_logic;
-    signal reg_irq_ack         : std_logic;
-    signal reg_debayer_pattern : std_logic_vector(debayer_pattern'range);
-    signal reg_stop_and_reset  : std_logic;
+    signal reg_snapshot         : std_logic;
+    signal reg_get_frame_info   : std_logic;
+    signal reg_irq_en           : std_logic;
+    signal reg_irq_ack          : std_logic;
+    signal reg_debayer_pattern  : std_logic_vector(debayer_pattern'range);
+    signal reg_downscale_mode   : std_logic_vector(downscale_mode'range);
+    signal reg_downscale_factor : std_logic_vector(downscale_factor'range);
+    signal reg_planar           : std_logic_vector(planar'range);
+    signal reg_depth_mode       : std_logic_vector(depth_mode'range);
+    signal reg_depth_lut_write  : std_logic;
+    signal reg_depth_lut_index  : std_logic_vector(depth_lut_index'range);
+    signal reg_depth_lut_value  : std_logic_vector(depth_lut_value'range);
+    signal reg_output_format    : std_logic_vector(output_format'range);
+    signal reg_stage_write      : std_logic;
+    signal reg_stage_index      : std_logic_vector(stage_index'range);
+    signal reg_stage_word       : std_logic_vector(stage_word'range);
+    signal reg_stage_data       : std_logic_vector(stage_data'range);
+    signal reg_blob_threshold   : std_logic_vector(blob_threshold'range);
+    signal reg_blob_stats_only  : std_logic_vector(blob_stats_only'range);
+    signal reg_sparse_threshold : std_logic_vector(sparse_threshold'range);
+    signal reg_sparse_enable    : std_logic_vector(sparse_enable'range);
+    signal reg_compress         : std_logic_vector(compress'range);
+    signal reg_stop_and_reset   : std_logic;
+
+    -- STAGE_ADDR register. The word index is incremented after every write to
+    -- STAGE_DATA, so consecutive parameter words can be written in sequence.
+    signal reg_stage_addr_stage : std_logic_vector(stage_index'range);
+    signal reg_stage_addr_word  : unsigned(stage_word'range);
+
+    -- BLOB_ADDR register. The word index is incremented after every read of
+    -- BLOB_DATA, so the result words can be read in sequence.
+    signal reg_blob_addr_word : unsigned(blob_word'range);
+
+    -- CONFIG shadow registers. Software writes only go to the shadow copies,
+    -- which are transferred to the active registers above when the sampler
+    -- asserts config_latch (while idle, or at the start of a frame). Any new
+    -- CONFIG-like setting must follow the same scheme so that a frame is
+    -- always processed with a consistent configuration.
+    signal reg_irq_en_shadow           : std_logic;
+    signal reg_debayer_pattern_shadow  : std_logic_vector(debayer_pattern'range);
+    signal reg_downscale_mode_shadow   : std_logic_vector(downscale_mode'range);
+    signal reg_downscale_factor_shadow : std_logic_vector(downscale_factor'range);
+    signal reg_planar_shadow           : std_logic_vector(planar'range);
+    signal reg_depth_mode_shadow       : std_logic_vector(depth_mode'range);
+    signal reg_output_format_shadow    : std_logic_vector(output_format'range);
+    signal reg_blob_threshold_shadow   : std_logic_vector(blob_threshold'range);
+    signal reg_blob_stats_only_shadow  : std_logic_vector(blob_stats_only'range);
+    signal reg_sparse_threshold_shadow : std_logic_vector(sparse_threshold'range);
+    signal reg_sparse_enable_shadow    : std_logic_vector(sparse_enable'range);
+    signal reg_compress_shadow         : std_logic_vector(compress'range);
+
+    -- command fifo ('1' = SNAPSHOT, '0' = GET_FRAME_INFO)
+    signal reg_cmd_fifo       : std_logic_vector(CMOS_SENSOR_INPUT_CMD_FIFO_DEPTH - 1 downto 0);
+    signal reg_cmd_fifo_rdptr : unsigned(ceil_log2(CMOS_SENSOR_INPUT_CMD_FIFO_DEPTH) - 1 downto 0);
+    signal reg_cmd_fifo_wrptr : unsigned(ceil_log2(CMOS_SENSOR_INPUT_CMD_FIFO_DEPTH) - 1 downto 0);
+    signal reg_cmd_fifo_usedw : unsigned(bit_width(CMOS_SENSOR_INPUT_CMD_FIFO_DEPTH) - 1 downto 0);
+
+    -- sampler is idle and no command is pending (queued or being issued)
+    signal unit_idle : std_logic;
 
 begin
     -- registered outputs
-    irq             <= wait_irq_ack;
-    irq_en          <= reg_irq_en;
-    irq_ack         <= reg_irq_ack;
-    snapshot        <= reg_snapshot;
-    get_frame_info  <= reg_get_frame_info;
-    debayer_pattern <= reg_debayer_pattern;
-    stop_and_reset  <= reg_stop_and_reset;
+    irq              <= wait_irq_ack;
+    irq_en           <= reg_irq_en;
+    irq_ack          <= reg_irq_ack;
+    snapshot         <= reg_snapshot;
+    get_frame_info   <= reg_get_frame_info;
+    debayer_pattern  <= reg_debayer_pattern;
+    downscale_mode   <= reg_downscale_mode;
+    downscale_factor <= reg_downscale_factor;
+    planar           <= reg_planar;
+    depth_mode       <= reg_depth_mode;
+    depth_lut_write  <= reg_depth_lut_write;
+    depth_lut_index  <= reg_depth_lut_index;
+    depth_lut_value  <= reg_depth_lut_value;
+    output_format    <= reg_output_format;
+    stage_write      <= reg_stage_write;
+    stage_index      <= reg_stage_index;
+    stage_word       <= reg_stage_word;
+    stage_data       <= reg_stage_data;
+    blob_threshold   <= reg_blob_threshold;
+    blob_stats_only  <= reg_blob_stats_only;
+    blob_word        <= std_logic_vector(reg_blob_addr_word);
+    sparse_threshold <= reg_sparse_threshold;
+    sparse_enable    <= reg_sparse_enable;
+    compress         <= reg_compress;
+    stop_and_reset   <= reg_stop_and_reset;
+
+    unit_idle <= '1' when idle = '1' and reg_cmd_fifo_usedw = 0 and reg_snapshot = '0' and reg_get_frame_info = '0' else '0';
 
     MM_WRITE : process(clk, reset)
-        variable wrdata_config_irq             : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_IRQ_WIDTH - 1 downto 0);
-        variable wrdata_config_debayer_pattern : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_WIDTH - 1 downto 0);
-        variable wrdata_command                : std_logic_vector(CMOS_SENSOR_INPUT_COMMAND_WIDTH - 1 downto 0);
+        variable wrdata_config_irq              : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_IRQ_WIDTH - 1 downto 0);
+        variable wrdata_config_debayer_pattern  : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_WIDTH - 1 downto 0);
+        variable wrdata_config_downscale_mode   : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_WIDTH - 1 downto 0);
+        variable wrdata_config_downscale_factor : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_WIDTH - 1 downto 0);
+        variable wrdata_config_planar           : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_PLANAR_WIDTH - 1 downto 0);
+        variable wrdata_config_depth_mode       : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_WIDTH - 1 downto 0);
+        variable wrdata_config_output_format    : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_WIDTH - 1 downto 0);
+        variable wrdata_config_compress         : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_COMPRESS_WIDTH - 1 downto 0);
+        variable wrdata_blob_config_stats_only  : std_logic_vector(CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_WIDTH - 1 downto 0);
+        variable wrdata_sparse_config_enable    : std_logic_vector(CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_WIDTH - 1 downto 0);
+        variable wrdata_command                 : std_logic_vector(CMOS_SENSOR_INPUT_COMMAND_WIDTH - 1 downto 0);
+        variable cmd_fifo_push                  : boolean;
+        variable cmd_fifo_push_snapshot         : std_logic;
+        variable cmd_fifo_pop                   : boolean;
+        variable cmd_fifo_flush                 : boolean;
     begin
         if reset = '1' then
+            reg_snapshot                <= '0';
+            reg_get_frame_info          <= '0';
+            reg_irq_en                  <= '0';
+            reg_irq_ack                 <= '0';
+            reg_debayer_pattern         <= CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_RGGB;
+            reg_downscale_mode          <= CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_DECIMATE;
+            reg_downscale_factor        <= CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_1X1;
+            reg_planar                  <= CMOS_SENSOR_INPUT_CONFIG_PLANAR_DISABLE;
+            reg_depth_mode              <= CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_FULL;
+            reg_depth_lut_write         <= '0';
+            reg_depth_lut_index         <= (others => '0');
+            reg_depth_lut_value         <= (others => '0');
+            reg_output_format           <= CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB;
+            reg_stage_write             <= '0';
+            reg_stage_index             <= (others => '0');
+            reg_stage_word              <= (others => '0');
+            reg_stage_data              <= (others => '0');
+            reg_stage_addr_stage        <= (others => '0');
+            reg_stage_addr_word         <= (others => '0');
+            reg_blob_threshold          <= (others => '1');
+            reg_blob_stats_only         <= CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_DISABLE;
+            reg_blob_addr_word          <= (others => '0');
+            reg_sparse_threshold        <= (others => '0');
+            reg_sparse_enable           <= CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_DISABLE;
+            reg_compress                <= CMOS_SENSOR_INPUT_CONFIG_COMPRESS_DISABLE;
+            reg_stop_and_reset          <= '0';
+            reg_irq_en_shadow           <= '0';
+            reg_debayer_pattern_shadow  <= CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_RGGB;
+            reg_downscale_mode_shadow   <= CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_DECIMATE;
+            reg_downscale_factor_shadow <= CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_1X1;
+            reg_planar_shadow           <= CMOS_SENSOR_INPUT_CONFIG_PLANAR_DISABLE;
+            reg_depth_mode_shadow       <= CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_FULL;
+            reg_output_format_shadow    <= CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB;
+            reg_blob_threshold_shadow   <= (others => '1');
+            reg_blob_stats_only_shadow  <= CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_DISABLE;
+            reg_sparse_threshold_shadow <= (others => '0');
+            reg_sparse_enable_shadow    <= CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_DISABLE;
+            reg_compress_shadow         <= CMOS_SENSOR_INPUT_CONFIG_COMPRESS_DISABLE;
+            reg_cmd_fifo                <= (others => '0');
+            reg_cmd_fifo_rdptr          <= (others => '0');
+            reg_cmd_fifo_wrptr          <= (others => '0');
+            reg_cmd_fifo_usedw          <= (others => '0');
+        elsif rising_edge(clk) then
             reg_snapshot        <= '0';
             reg_get_frame_info  <= '0';
-            reg_irq_en          <= '0';
             reg_irq_ack         <= '0';
-            reg_debayer_pattern <= CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_RGGB;
+            reg_depth_lut_write <= '0';
+            reg_stage_write     <= '0';
             reg_stop_and_reset  <= '0';
-        elsif rising_edge(clk) then
-            reg_snapshot       <= '0';
-            reg_get_frame_info <= '0';
-            reg_irq_ack        <= '0';
-            reg_stop_and_reset <= '0';
+
+            cmd_fifo_push          := false;
+            cmd_fifo_push_snapshot := '0';
+            cmd_fifo_flush         := false;
+
+            -- issue the oldest queued command once the sampler is idle. The
+            -- sampler only leaves its idle state on the cycle after a command
+            -- pulse, so no command may be issued while a pulse is in flight.
+            cmd_fifo_pop := idle = '1' and reg_cmd_fifo_usedw /= 0 and reg_snapshot = '0' and reg_get_frame_info = '0';
 
             if write = '1' then
                 case addr is
                     when CMOS_SENSOR_INPUT_CONFIG_OFST =>
-                        -- prevent changing config when unit is running
-                        if idle = '1' then
-                            wrdata_config_irq             := wrdata(CMOS_SENSOR_INPUT_CONFIG_IRQ_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_IRQ_LOW_BIT_OFST);
-                            wrdata_config_debayer_pattern := wrdata(CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_LOW_BIT_OFST);
-
-                            -- irq
-                            if wrdata_config_irq = CMOS_SENSOR_INPUT_CONFIG_IRQ_ENABLE then
-                                reg_irq_en <= '1';
-                            elsif wrdata_config_irq = CMOS_SENSOR_INPUT_CONFIG_IRQ_DISABLE then
-                                reg_irq_en <= '0';
+                        -- config can be changed at any time, as only the shadow registers are written
+                        wrdata_config_irq              := wrdata(CMOS_SENSOR_INPUT_CONFIG_IRQ_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_IRQ_LOW_BIT_OFST);
+                        wrdata_config_debayer_pattern  := wrdata(CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_LOW_BIT_OFST);
+                        wrdata_config_downscale_mode   := wrdata(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_LOW_BIT_OFST);
+                        wrdata_config_downscale_factor := wrdata(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_LOW_BIT_OFST);
+                        wrdata_config_planar           := wrdata(CMOS_SENSOR_INPUT_CONFIG_PLANAR_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_PLANAR_LOW_BIT_OFST);
+                        wrdata_config_depth_mode       := wrdata(CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_LOW_BIT_OFST);
+                        wrdata_config_output_format    := wrdata(CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_LOW_BIT_OFST);
+                        wrdata_config_compress         := wrdata(CMOS_SENSOR_INPUT_CONFIG_COMPRESS_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_COMPRESS_LOW_BIT_OFST);
+
+                        -- irq
+                        if wrdata_config_irq = CMOS_SENSOR_INPUT_CONFIG_IRQ_ENABLE then
+                            reg_irq_en_shadow <= '1';
+                        elsif wrdata_config_irq = CMOS_SENSOR_INPUT_CONFIG_IRQ_DISABLE then
+                            reg_irq_en_shadow <= '0';
+                        end if;
+
+                        -- debayer
+                        reg_debayer_pattern_shadow <= (others => '0'); -- needed to avoid latch generation if DEBAYER_ENABLE = false
+                        if DEBAYER_ENABLE then
+                            reg_debayer_pattern_shadow <= wrdata_config_debayer_pattern;
+                        end if;
+
+                        -- downscaler
+                        reg_downscale_mode_shadow   <= CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_DECIMATE; -- needed to avoid latch generation if DOWNSCALER_ENABLE = false
+                        reg_downscale_factor_shadow <= CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_1X1;
+                        if DOWNSCALER_ENABLE then
+                            reg_downscale_mode_shadow <= wrdata_config_downscale_mode;
+
+                            -- reserved factor encoding is treated as 1x1
+                            if wrdata_config_downscale_factor = CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_2X2 or wrdata_config_downscale_factor = CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_4X4 then
+                                reg_downscale_factor_shadow <= wrdata_config_downscale_factor;
                             end if;
+                        end if;
+
+                        -- planar
+                        reg_planar_shadow <= CMOS_SENSOR_INPUT_CONFIG_PLANAR_DISABLE; -- needed to avoid latch generation if PLANAR_ENABLE = false
+                        if PLANAR_ENABLE then
+                            reg_planar_shadow <= wrdata_config_planar;
+                        end if;
 
-                            -- debayer
-                            reg_debayer_pattern <= (others => '0'); -- needed to avoid latch generation if DEBAYER_ENABLE = false
-                            if DEBAYER_ENABLE then
-                                reg_debayer_pattern <= wrdata_config_debayer_pattern;
+                        -- depth_reducer
+                        reg_depth_mode_shadow <= CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_FULL; -- needed to avoid latch generation if DEPTH_REDUCER_ENABLE = false
+                        if DEPTH_REDUCER_ENABLE then
+                            -- reserved mode encoding is treated as FULL
+                            if wrdata_config_depth_mode = CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_SHIFT or wrdata_config_depth_mode = CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_LUT then
+                                reg_depth_mode_shadow <= wrdata_config_depth_mode;
                             end if;
                         end if;
 
+                        -- color_converter
+                        reg_output_format_shadow <= CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB; -- needed to avoid latch generation if COLOR_CONVERTER_ENABLE = false
+                        if COLOR_CONVERTER_ENABLE then
+                            reg_output_format_shadow <= wrdata_config_output_format;
+                        end if;
+
+                        -- compressor
+                        reg_compress_shadow <= CMOS_SENSOR_INPUT_CONFIG_COMPRESS_DISABLE; -- needed to avoid latch generation if COMPRESSOR_ENABLE = false
+                        if COMPRESSOR_ENABLE then
+                            reg_compress_shadow <= wrdata_config_compress;
+                        end if;
+
                     when CMOS_SENSOR_INPUT_COMMAND_OFST =>
                         wrdata_command := wrdata(CMOS_SENSOR_INPUT_COMMAND_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_COMMAND_LOW_BIT_OFST);
 
+                        -- SNAPSHOT and GET_FRAME_INFO are queued, and are dropped if the command fifo is full
                         if wrdata_command = CMOS_SENSOR_INPUT_COMMAND_SNAPSHOT then
-                            -- only allow state change when unit is idle
-                            if idle = '1' then
-                                reg_snapshot <= '1';
-                            end if;
+                            cmd_fifo_push          := true;
+                            cmd_fifo_push_snapshot := '1';
                         elsif wrdata_command = CMOS_SENSOR_INPUT_COMMAND_GET_FRAME_INFO then
-                            -- only allow frame info to change when unit is idle
-                            if idle = '1' then
-                                reg_get_frame_info <= '1';
-                            end if;
+                            cmd_fifo_push          := true;
+                            cmd_fifo_push_snapshot := '0';
                         elsif wrdata_command = CMOS_SENSOR_INPUT_COMMAND_IRQ_ACK then
                             -- will only accept an irq acknowledgement if irq is enabled
                             if reg_irq_en = '1' then
@@ -127,6 +343,58 @@ begin
                             end if;
                         elsif wrdata_command = CMOS_SENSOR_INPUT_COMMAND_STOP_AND_RESET then
                             reg_stop_and_reset <= '1';
+                            cmd_fifo_flush     := true;
+                        end if;
+
+                    when CMOS_SENSOR_INPUT_DEPTH_LUT_OFST =>
+                        -- the lut is not shadowed, software must only load it while the unit is idle
+                        if DEPTH_REDUCER_ENABLE then
+                            reg_depth_lut_write <= '1';
+                            reg_depth_lut_index <= wrdata(CMOS_SENSOR_INPUT_DEPTH_LUT_INDEX_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_DEPTH_LUT_INDEX_LOW_BIT_OFST);
+                            reg_depth_lut_value <= wrdata(CMOS_SENSOR_INPUT_DEPTH_LUT_VALUE_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_DEPTH_LUT_VALUE_LOW_BIT_OFST);
+                        end if;
+
+                    when CMOS_SENSOR_INPUT_STAGE_ADDR_OFST =>
+                        if STAGE_COUNT > 0 then
+                            reg_stage_addr_stage <= wrdata(CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_LOW_BIT_OFST);
+                            reg_stage_addr_word  <= unsigned(wrdata(CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_LOW_BIT_OFST));
+                        end if;
+
+                    when CMOS_SENSOR_INPUT_STAGE_DATA_OFST =>
+                        -- stage parameters are shadowed by the stages themselves, so they can be written at any time
+                        if STAGE_COUNT > 0 then
+                            reg_stage_write     <= '1';
+                            reg_stage_index     <= reg_stage_addr_stage;
+                            reg_stage_word      <= std_logic_vector(reg_stage_addr_word);
+                            reg_stage_data      <= wrdata;
+                            reg_stage_addr_word <= reg_stage_addr_word + 1;
+                        end if;
+
+                    when CMOS_SENSOR_INPUT_BLOB_CONFIG_OFST =>
+                        -- like CONFIG, only the shadow registers are written
+                        wrdata_blob_config_stats_only := wrdata(CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_LOW_BIT_OFST);
+
+                        reg_blob_threshold_shadow  <= (others => '1'); -- needed to avoid latch generation if BLOB_COUNT = 0
+                        reg_blob_stats_only_shadow <= CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_DISABLE;
+                        if BLOB_COUNT > 0 then
+                            reg_blob_threshold_shadow  <= wrdata(CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_LOW_BIT_OFST);
+                            reg_blob_stats_only_shadow <= wrdata_blob_config_stats_only;
+                        end if;
+
+                    when CMOS_SENSOR_INPUT_BLOB_ADDR_OFST =>
+                        if BLOB_COUNT > 0 then
+                            reg_blob_addr_word <= unsigned(wrdata(CMOS_SENSOR_INPUT_BLOB_ADDR_WORD_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_BLOB_ADDR_WORD_LOW_BIT_OFST));
+                        end if;
+
+                    when CMOS_SENSOR_INPUT_SPARSE_CONFIG_OFST =>
+                        -- like CONFIG, only the shadow registers are written
+                        wrdata_sparse_config_enable := wrdata(CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_LOW_BIT_OFST);
+
+                        reg_sparse_threshold_shadow <= (others => '0'); -- needed to avoid latch generation if SPARSE_ENABLE = false
+                        reg_sparse_enable_shadow    <= CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_DISABLE;
+                        if SPARSE_ENABLE then
+                            reg_sparse_threshold_shadow <= wrdata(CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_LOW_BIT_OFST);
+                            reg_sparse_enable_shadow    <= wrdata_sparse_config_enable;
                         end if;
 
                     when others =>
@@ -134,6 +402,60 @@ begin
                 end case;
             end if;
 
+            -- BLOB_DATA reads advance the result word index
+            if read = '1' and addr = CMOS_SENSOR_INPUT_BLOB_DATA_OFST then
+                if BLOB_COUNT > 0 then
+                    reg_blob_addr_word <= reg_blob_addr_word + 1;
+                end if;
+            end if;
+
+            -- transfer shadow config to active config
+            if config_latch = '1' then
+                reg_irq_en           <= reg_irq_en_shadow;
+                reg_debayer_pattern  <= reg_debayer_pattern_shadow;
+                reg_downscale_mode   <= reg_downscale_mode_shadow;
+                reg_downscale_factor <= reg_downscale_factor_shadow;
+                reg_planar           <= reg_planar_shadow;
+                reg_depth_mode       <= reg_depth_mode_shadow;
+                reg_output_format    <= reg_output_format_shadow;
+                reg_blob_threshold   <= reg_blob_threshold_shadow;
+                reg_blob_stats_only  <= reg_blob_stats_only_shadow;
+                reg_sparse_threshold <= reg_sparse_threshold_shadow;
+                reg_sparse_enable    <= reg_sparse_enable_shadow;
+                reg_compress         <= reg_compress_shadow;
+            end if;
+
+            -- command fifo
+            if cmd_fifo_pop then
+                if reg_cmd_fifo(to_integer(reg_cmd_fifo_rdptr)) = '1' then
+                    reg_snapshot <= '1';
+                else
+                    reg_get_frame_info <= '1';
+                end if;
+
+                reg_cmd_fifo_rdptr <= reg_cmd_fifo_rdptr + 1;
+            end if;
+
+            if cmd_fifo_push and (reg_cmd_fifo_usedw /= CMOS_SENSOR_INPUT_CMD_FIFO_DEPTH or cmd_fifo_pop) then
+                reg_cmd_fifo(to_integer(reg_cmd_fifo_wrptr)) <= cmd_fifo_push_snapshot;
+                reg_cmd_fifo_wrptr                           <= reg_cmd_fifo_wrptr + 1;
+
+                if not cmd_fifo_pop then
+                    reg_cmd_fifo_usedw <= reg_cmd_fifo_usedw + 1;
+                end if;
+            elsif cmd_fifo_pop then
+                reg_cmd_fifo_usedw <= reg_cmd_fifo_usedw - 1;
+            end if;
+
+            -- STOP_AND_RESET flushes all pending commands
+            if cmd_fifo_flush then
+                reg_snapshot       <= '0';
+                reg_get_frame_info <= '0';
+                reg_cmd_fifo_rdptr <= (others => '0');
+                reg_cmd_fifo_wrptr <= (others => '0');
+                reg_cmd_fifo_usedw <= (others => '0');
+            end if;
+
         end if;
     end process;
 
@@ -148,18 +470,39 @@ begin
             if read = '1' then
                 case addr is
                     when CMOS_SENSOR_INPUT_CONFIG_OFST =>
-                        if reg_irq_en = '1' then
+                        if reg_irq_en_shadow = '1' then
                             rddata(CMOS_SENSOR_INPUT_CONFIG_IRQ_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_IRQ_LOW_BIT_OFST) <= CMOS_SENSOR_INPUT_CONFIG_IRQ_ENABLE;
                         else
                             rddata(CMOS_SENSOR_INPUT_CONFIG_IRQ_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_IRQ_LOW_BIT_OFST) <= CMOS_SENSOR_INPUT_CONFIG_IRQ_DISABLE;
                         end if;
 
                         if DEBAYER_ENABLE then
-                            rddata(CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_LOW_BIT_OFST) <= reg_debayer_pattern;
+                            rddata(CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_LOW_BIT_OFST) <= reg_debayer_pattern_shadow;
+                        end if;
+
+                        if DOWNSCALER_ENABLE then
+                            rddata(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_LOW_BIT_OFST)     <= reg_downscale_mode_shadow;
+                            rddata(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_LOW_BIT_OFST) <= reg_downscale_factor_shadow;
+                        end if;
+
+                        if PLANAR_ENABLE then
+                            rddata(CMOS_SENSOR_INPUT_CONFIG_PLANAR_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_PLANAR_LOW_BIT_OFST) <= reg_planar_shadow;
+                        end if;
+
+                        if DEPTH_REDUCER_ENABLE then
+                            rddata(CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_LOW_BIT_OFST) <= reg_depth_mode_shadow;
+                        end if;
+
+                        if COLOR_CONVERTER_ENABLE then
+                            rddata(CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_LOW_BIT_OFST) <= reg_output_format_shadow;
+                        end if;
+
+                        if COMPRESSOR_ENABLE then
+                            rddata(CMOS_SENSOR_INPUT_CONFIG_COMPRESS_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_COMPRESS_LOW_BIT_OFST) <= reg_compress_shadow;
                         end if;
 
                     when CMOS_SENSOR_INPUT_STATUS_OFST =>
-                        if idle = '1' then
+                        if unit_idle = '1' then
                             rddata(CMOS_SENSOR_INPUT_STATUS_STATE_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STATUS_STATE_LOW_BIT_OFST) <= CMOS_SENSOR_INPUT_STATUS_STATE_IDLE;
                         else
                             rddata(CMOS_SENSOR_INPUT_STATUS_STATE_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STATUS_STATE_LOW_BIT_OFST) <= CMOS_SENSOR_INPUT_STATUS_STATE_BUSY;
@@ -173,10 +516,36 @@ begin
 
                         rddata(CMOS_SENSOR_INPUT_STATUS_FIFO_USEDW_HIGH_BIT_0FST downto CMOS_SENSOR_INPUT_STATUS_FIFO_USEDW_LOW_BIT_OFST) <= std_logic_vector(resize(unsigned(fifo_usedw), CMOS_SENSOR_INPUT_STATUS_FIFO_USEDW_WIDTH));
 
+                        rddata(CMOS_SENSOR_INPUT_STATUS_CMD_FIFO_USEDW_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STATUS_CMD_FIFO_USEDW_LOW_BIT_OFST) <= std_logic_vector(resize(reg_cmd_fifo_usedw, CMOS_SENSOR_INPUT_STATUS_CMD_FIFO_USEDW_WIDTH));
+
                     when CMOS_SENSOR_INPUT_FRAME_INFO_OFST =>
                         rddata(CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_WIDTH_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_WIDTH_LOW_BIT_OFST)   <= std_logic_vector(resize(unsigned(frame_width), CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_WIDTH_WIDTH));
                         rddata(CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_HEIGHT_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_HEIGHT_LOW_BIT_OFST) <= std_logic_vector(resize(unsigned(frame_height), CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_HEIGHT_WIDTH));
 
+                    when CMOS_SENSOR_INPUT_STAGE_ADDR_OFST =>
+                        rddata(CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_LOW_BIT_OFST) <= reg_stage_addr_stage;
+                        rddata(CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_LOW_BIT_OFST)   <= std_logic_vector(reg_stage_addr_word);
+
+                    when CMOS_SENSOR_INPUT_BLOB_CONFIG_OFST =>
+                        if BLOB_COUNT > 0 then
+                            rddata(CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_LOW_BIT_OFST)   <= reg_blob_threshold_shadow;
+                            rddata(CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_LOW_BIT_OFST) <= reg_blob_stats_only_shadow;
+                        end if;
+
+                    when CMOS_SENSOR_INPUT_BLOB_ADDR_OFST =>
+                        rddata(CMOS_SENSOR_INPUT_BLOB_ADDR_WORD_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_BLOB_ADDR_WORD_LOW_BIT_OFST) <= std_logic_vector(reg_blob_addr_word);
+
+                    when CMOS_SENSOR_INPUT_BLOB_DATA_OFST =>
+                        if BLOB_COUNT > 0 then
+                            rddata <= blob_data;
+                        end if;
+
+                    when CMOS_SENSOR_INPUT_SPARSE_CONFIG_OFST =>
+                        if SPARSE_ENABLE then
+                            rddata(CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_LOW_BIT_OFST) <= reg_sparse_threshold_shadow;
+                            rddata(CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_LOW_BIT_OFST)       <= reg_sparse_enable_shadow;
+                        end if;
+
                     when others =>
                         null;
                 end case;
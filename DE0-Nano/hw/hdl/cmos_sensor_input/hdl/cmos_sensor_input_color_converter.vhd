@@ -0,0 +1,201 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.cmos_sensor_input_constants.all;
+
+-- Output color format converter.
+--
+-- Converts the RGB pixels produced by the debayer (R & G & B, with R in the
+-- most significant bits and PIX_DEPTH bits per channel) to one of the
+-- following display or codec friendly formats:
+--
+--   RGB565   : 16 bits, R in bits 15:11, G in bits 10:5, B in bits 4:0.
+--   RGB888   : 24 bits, R in bits 23:16, G in bits 15:8, B in bits 7:0.
+--   YCBCR422 : 16 bits, Y in bits 15:8 and a chroma sample in bits 7:0. Even
+--              pixels carry Cb, odd pixels carry Cr, both computed from the
+--              even pixel of the pair (co-sited). Frame widths must be even.
+--
+-- Each channel is first reduced to (or extended to) 8 bits. YCbCr uses the
+-- full-range BT.601 coefficients (as in JFIF) scaled by 256.
+--
+-- 16-bit formats are output in the LSBs of data_out. The output is delayed by
+-- 2 cycles. The stage is held in reset if output_format is set to RGB, in which
+-- case the top level bypasses it.
+entity cmos_sensor_input_color_converter is
+    generic(
+        PIX_DEPTH : positive
+    );
+    port(
+        clk                : in  std_logic;
+        reset              : in  std_logic;
+
+        -- avalon_mm_slave
+        stop_and_reset     : in  std_logic;
+        output_format      : in  std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_WIDTH - 1 downto 0);
+
+        -- debayer
+        valid_in           : in  std_logic;
+        data_in            : in  std_logic_vector(3 * PIX_DEPTH - 1 downto 0);
+        start_of_frame_in  : in  std_logic;
+        end_of_frame_in    : in  std_logic;
+
+        -- packer / fifo
+        valid_out          : out std_logic;
+        data_out           : out std_logic_vector(23 downto 0);
+        start_of_frame_out : out std_logic;
+        end_of_frame_out   : out std_logic
+    );
+end entity cmos_sensor_input_color_converter;
+
+architecture rtl of cmos_sensor_input_color_converter is
+    -- keeps the 8 most significant bits of a channel, or left-aligns it if it
+    -- is narrower than 8 bits
+    function to_8_bits(channel : std_logic_vector) return unsigned is
+        variable result : unsigned(7 downto 0);
+    begin
+        if channel'length >= 8 then
+            result := unsigned(channel(channel'high downto channel'high - 7));
+        else
+            result := shift_left(resize(unsigned(channel), 8), 8 - channel'length);
+        end if;
+        return result;
+    end function to_8_bits;
+
+    -- returns the 8 bits of sum / 256, saturated to 255
+    function saturate(sum : unsigned(16 downto 0)) return unsigned is
+    begin
+        if sum(16) = '1' then
+            return to_unsigned(255, 8);
+        end if;
+        return sum(15 downto 8);
+    end function saturate;
+
+    signal r : unsigned(7 downto 0);
+    signal g : unsigned(7 downto 0);
+    signal b : unsigned(7 downto 0);
+
+    -- stage 1 : 8-bit channels and scaled luma / chroma sums
+    signal reg_r      : unsigned(7 downto 0);
+    signal reg_g      : unsigned(7 downto 0);
+    signal reg_b      : unsigned(7 downto 0);
+    signal reg_y_sum  : unsigned(16 downto 0);
+    signal reg_cb_sum : unsigned(16 downto 0);
+    signal reg_cr_sum : unsigned(16 downto 0);
+    signal reg_odd    : std_logic;
+    signal reg_valid  : std_logic;
+    signal reg_sof    : std_logic;
+    signal reg_eof    : std_logic;
+
+    -- parity of the next input pixel in the frame
+    signal reg_next_odd : std_logic;
+
+    -- Cr of the last even pixel, output with the following odd pixel
+    signal reg_cr_even : unsigned(7 downto 0);
+
+    -- stage 2 : formatted pixel
+    signal reg_data_out           : std_logic_vector(data_out'range);
+    signal reg_valid_out          : std_logic;
+    signal reg_start_of_frame_out : std_logic;
+    signal reg_end_of_frame_out   : std_logic;
+
+begin
+    valid_out          <= reg_valid_out;
+    data_out           <= reg_data_out;
+    start_of_frame_out <= reg_start_of_frame_out;
+    end_of_frame_out   <= reg_end_of_frame_out;
+
+    r <= to_8_bits(data_in(3 * PIX_DEPTH - 1 downto 2 * PIX_DEPTH));
+    g <= to_8_bits(data_in(2 * PIX_DEPTH - 1 downto PIX_DEPTH));
+    b <= to_8_bits(data_in(PIX_DEPTH - 1 downto 0));
+
+    CONVERT : process(clk, reset)
+        variable y  : unsigned(7 downto 0);
+        variable cb : unsigned(7 downto 0);
+        variable cr : unsigned(7 downto 0);
+    begin
+        if reset = '1' then
+            reg_r                  <= (others => '0');
+            reg_g                  <= (others => '0');
+            reg_b                  <= (others => '0');
+            reg_y_sum              <= (others => '0');
+            reg_cb_sum             <= (others => '0');
+            reg_cr_sum             <= (others => '0');
+            reg_odd                <= '0';
+            reg_valid              <= '0';
+            reg_sof                <= '0';
+            reg_eof                <= '0';
+            reg_next_odd           <= '0';
+            reg_cr_even            <= (others => '0');
+            reg_data_out           <= (others => '0');
+            reg_valid_out          <= '0';
+            reg_start_of_frame_out <= '0';
+            reg_end_of_frame_out   <= '0';
+
+        elsif rising_edge(clk) then
+            reg_valid              <= '0';
+            reg_sof                <= '0';
+            reg_eof                <= '0';
+            reg_valid_out          <= '0';
+            reg_start_of_frame_out <= '0';
+            reg_end_of_frame_out   <= '0';
+
+            if stop_and_reset = '1' or output_format = CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB then
+                reg_next_odd <= '0';
+            else
+                -- stage 1
+                if valid_in = '1' then
+                    reg_r <= r;
+                    reg_g <= g;
+                    reg_b <= b;
+
+                    -- Y  =       0.299 R + 0.587 G + 0.114 B
+                    -- Cb = 128 - 0.169 R - 0.331 G + 0.500 B
+                    -- Cr = 128 + 0.500 R - 0.419 G - 0.081 B
+                    -- 128 is added to each sum to round to nearest, and the
+                    -- chroma sums never go negative
+                    reg_y_sum  <= resize(77 * r, 17) + resize(150 * g, 17) + resize(29 * b, 17) + 128;
+                    reg_cb_sum <= to_unsigned(32896, 17) + resize(128 * b, 17) - resize(43 * r, 17) - resize(85 * g, 17);
+                    reg_cr_sum <= to_unsigned(32896, 17) + resize(128 * r, 17) - resize(107 * g, 17) - resize(21 * b, 17);
+
+                    if start_of_frame_in = '1' then
+                        reg_odd      <= '0';
+                        reg_next_odd <= '1';
+                    else
+                        reg_odd      <= reg_next_odd;
+                        reg_next_odd <= not reg_next_odd;
+                    end if;
+
+                    reg_valid <= '1';
+                    reg_sof   <= start_of_frame_in;
+                    reg_eof   <= end_of_frame_in;
+                end if;
+
+                -- stage 2
+                if reg_valid = '1' then
+                    y  := saturate(reg_y_sum);
+                    cb := saturate(reg_cb_sum);
+                    cr := saturate(reg_cr_sum);
+
+                    reg_data_out <= (others => '0');
+
+                    if output_format = CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB565 then
+                        reg_data_out(15 downto 0) <= std_logic_vector(reg_r(7 downto 3) & reg_g(7 downto 2) & reg_b(7 downto 3));
+                    elsif output_format = CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB888 then
+                        reg_data_out <= std_logic_vector(reg_r & reg_g & reg_b);
+                    elsif reg_odd = '0' then
+                        reg_data_out(15 downto 0) <= std_logic_vector(y & cb);
+                        reg_cr_even               <= cr;
+                    else
+                        reg_data_out(15 downto 0) <= std_logic_vector(y & reg_cr_even);
+                    end if;
+
+                    reg_valid_out          <= '1';
+                    reg_start_of_frame_out <= reg_sof;
+                    reg_end_of_frame_out   <= reg_eof;
+                end if;
+            end if;
+        end if;
+    end process;
+
+end architecture rtl;
@@ -0,0 +1,298 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.cmos_sensor_input_constants.all;
+
+-- Lossless compressor.
+--
+-- Replaces the pixel stream by a bitstream of adaptive Golomb-Rice codes of
+-- horizontal deltas taken within each Bayer channel. With D = PIX_DEPTH,
+-- ESC = CMOS_SENSOR_INPUT_COMPRESS_ESCAPE_Q and S = CMOS_SENSOR_INPUT_COMPRESS_ACC_SHIFT,
+-- every pixel p at (x, y) is coded as follows:
+--
+--   pred = 2^(D - 1) if x < 2, else the pixel at (x - 2, y)
+--   d    = (p - pred) mod 2^D, taken as a signed D-bit value
+--   u    = zigzag(d) = (d << 1) xor (d >> (D - 1)) (D bits)
+--   ctx  = 2 * (y mod 2) + (x mod 2) (one context per Bayer channel)
+--   k    = min(bit_length(acc[ctx] >> (S + 1)), D - 1)
+--   q    = u >> k
+--
+--   q < ESC:  q ones, a zero, then the k low bits of u (q + 1 + k bits)
+--   q >= ESC: ESC ones, then the D bits of u (ESC + D bits)
+--
+--   acc[ctx] = acc[ctx] - (acc[ctx] >> S) + u
+--
+-- The four accumulators are cleared at the start of each frame. Codes are
+-- packed LSB first into OUTPUT_WIDTH-bit words (the first code starts at bit 0
+-- of the first word), and the last word of a frame is padded with zeros and
+-- carries end_of_frame. A frame of N pixels therefore never produces more than
+-- ceil(N * (ESC + D) / OUTPUT_WIDTH) words.
+--
+-- The Avalon-ST source byte-swaps the words and the msgdma writes their
+-- high-order byte first, so memory holds the bitstream in byte order: byte 0
+-- holds bits 7..0 of the first word.
+--
+-- When the last code of a frame overflows a word, the padded remainder is
+-- flushed on the next cycle, and the packer cannot append a code of the next
+-- frame on that same cycle. The input must therefore not be valid on the cycle
+-- right after the one carrying end_of_frame_in: the next frame's first pixel
+-- comes 2 cycles after the last one at the earliest. This always holds in
+-- cmos_sensor_input, where the sampler only starts a new snapshot once the end
+-- of frame has left the output FIFO, and it is checked in simulation.
+entity cmos_sensor_input_compressor is
+    generic(
+        PIX_DEPTH    : positive; -- must be <= 16
+        MAX_WIDTH    : positive;
+        MAX_HEIGHT   : positive;
+        OUTPUT_WIDTH : positive -- must be >= PIX_DEPTH + CMOS_SENSOR_INPUT_COMPRESS_ESCAPE_Q
+    );
+    port(
+        clk               : in  std_logic;
+        reset             : in  std_logic;
+
+        -- avalon_mm_slave
+        stop_and_reset    : in  std_logic;
+
+        -- sampler / downscaler
+        frame_width       : in  std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+
+        -- planar / depth_reducer
+        valid_in          : in  std_logic;
+        data_in           : in  std_logic_vector(PIX_DEPTH - 1 downto 0);
+        start_of_frame_in : in  std_logic;
+        end_of_frame_in   : in  std_logic;
+
+        -- fifo
+        valid_out         : out std_logic;
+        data_out          : out std_logic_vector(OUTPUT_WIDTH - 1 downto 0);
+        end_of_frame_out  : out std_logic
+    );
+end entity cmos_sensor_input_compressor;
+
+architecture rtl of cmos_sensor_input_compressor is
+    constant COORD_WIDTH : positive := bit_width(max(MAX_WIDTH, MAX_HEIGHT));
+    constant ESC         : positive := CMOS_SENSOR_INPUT_COMPRESS_ESCAPE_Q;
+    constant ACC_SHIFT   : positive := CMOS_SENSOR_INPUT_COMPRESS_ACC_SHIFT;
+
+    -- the accumulators settle around 2^ACC_SHIFT times the mean of u
+    constant ACC_WIDTH  : positive := PIX_DEPTH + ACC_SHIFT + 1;
+    constant K_WIDTH    : positive := bit_width(PIX_DEPTH - 1);
+    constant CODE_WIDTH : positive := ESC + PIX_DEPTH;
+    constant LEN_WIDTH  : positive := bit_width(CODE_WIDTH);
+    constant BITS_WIDTH : positive := OUTPUT_WIDTH + CODE_WIDTH;
+    constant FILL_WIDTH : positive := bit_width(BITS_WIDTH);
+
+    type acc_array is array (0 to 3) of unsigned(ACC_WIDTH - 1 downto 0);
+
+    -- model
+    signal reg_next_x : unsigned(COORD_WIDTH - 1 downto 0);
+    signal reg_next_y : unsigned(COORD_WIDTH - 1 downto 0);
+    signal reg_prev1  : unsigned(PIX_DEPTH - 1 downto 0);
+    signal reg_prev2  : unsigned(PIX_DEPTH - 1 downto 0);
+    signal reg_acc    : acc_array;
+
+    signal reg_model_valid        : std_logic;
+    signal reg_model_u            : unsigned(PIX_DEPTH - 1 downto 0);
+    signal reg_model_k            : unsigned(K_WIDTH - 1 downto 0);
+    signal reg_model_end_of_frame : std_logic;
+
+    -- code
+    signal reg_code_valid        : std_logic;
+    signal reg_code_bits         : unsigned(CODE_WIDTH - 1 downto 0);
+    signal reg_code_len          : unsigned(LEN_WIDTH - 1 downto 0);
+    signal reg_code_end_of_frame : std_logic;
+
+    -- packer
+    signal reg_bits  : unsigned(BITS_WIDTH - 1 downto 0);
+    signal reg_fill  : unsigned(FILL_WIDTH - 1 downto 0);
+    signal reg_flush : std_logic;
+
+    -- number of bits needed to represent v (0 for v = 0)
+    function bit_length(v : unsigned) return natural is
+    begin
+        for i in v'high downto v'low loop
+            if v(i) = '1' then
+                return i - v'low + 1;
+            end if;
+        end loop;
+        return 0;
+    end function bit_length;
+
+begin
+    assert PIX_DEPTH <= 16
+        report "cmos_sensor_input_compressor: PIX_DEPTH must be <= 16"
+        severity failure;
+
+    assert CODE_WIDTH <= OUTPUT_WIDTH
+        report "cmos_sensor_input_compressor: an escape code does not fit in OUTPUT_WIDTH bits"
+        severity failure;
+
+    process(clk, reset)
+        variable x    : unsigned(COORD_WIDTH - 1 downto 0);
+        variable y    : unsigned(COORD_WIDTH - 1 downto 0);
+        variable acc  : acc_array;
+        variable ctx  : natural range 0 to 3;
+        variable pred : unsigned(PIX_DEPTH - 1 downto 0);
+        variable d    : unsigned(PIX_DEPTH - 1 downto 0);
+        variable u    : unsigned(PIX_DEPTH - 1 downto 0);
+        variable k    : natural range 0 to PIX_DEPTH - 1;
+        variable q    : unsigned(PIX_DEPTH - 1 downto 0);
+        variable code : unsigned(CODE_WIDTH - 1 downto 0);
+        variable bits : unsigned(BITS_WIDTH - 1 downto 0);
+        variable fill : unsigned(FILL_WIDTH - 1 downto 0);
+    begin
+        if reset = '1' then
+            reg_next_x             <= (others => '0');
+            reg_next_y             <= (others => '0');
+            reg_prev1              <= (others => '0');
+            reg_prev2              <= (others => '0');
+            reg_acc                <= (others => (others => '0'));
+            reg_model_valid        <= '0';
+            reg_model_u            <= (others => '0');
+            reg_model_k            <= (others => '0');
+            reg_model_end_of_frame <= '0';
+            reg_code_valid         <= '0';
+            reg_code_bits          <= (others => '0');
+            reg_code_len           <= (others => '0');
+            reg_code_end_of_frame  <= '0';
+            reg_bits               <= (others => '0');
+            reg_fill               <= (others => '0');
+            reg_flush              <= '0';
+            valid_out              <= '0';
+            data_out               <= (others => '0');
+            end_of_frame_out       <= '0';
+
+        elsif rising_edge(clk) then
+            assert not (valid_in = '1' and reg_model_valid = '1' and reg_model_end_of_frame = '1')
+                report "cmos_sensor_input_compressor: valid_in on the cycle following end_of_frame_in"
+                severity error;
+
+            reg_model_valid        <= '0';
+            reg_model_end_of_frame <= '0';
+            reg_code_valid         <= '0';
+            reg_code_end_of_frame  <= '0';
+            reg_flush              <= '0';
+            valid_out              <= '0';
+            data_out               <= (others => '0');
+            end_of_frame_out       <= '0';
+
+            if stop_and_reset = '1' then
+                reg_next_x <= (others => '0');
+                reg_next_y <= (others => '0');
+                reg_acc    <= (others => (others => '0'));
+                reg_bits   <= (others => '0');
+                reg_fill   <= (others => '0');
+            else
+                -- model: residual, zigzag and Rice parameter of the context
+                if valid_in = '1' then
+                    if start_of_frame_in = '1' then
+                        x   := (others => '0');
+                        y   := (others => '0');
+                        acc := (others => (others => '0'));
+                    else
+                        x   := reg_next_x;
+                        y   := reg_next_y;
+                        acc := reg_acc;
+                    end if;
+
+                    ctx := to_integer(y(0 downto 0) & x(0 downto 0));
+
+                    if x < 2 then
+                        pred := (others => '0');
+                        pred(PIX_DEPTH - 1) := '1';
+                    else
+                        pred := reg_prev2;
+                    end if;
+
+                    d := unsigned(data_in) - pred;
+                    u := shift_left(d, 1) xor unsigned'(u'range => d(PIX_DEPTH - 1));
+
+                    k := bit_length(shift_right(acc(ctx), ACC_SHIFT + 1));
+                    if k > PIX_DEPTH - 1 then
+                        k := PIX_DEPTH - 1;
+                    end if;
+
+                    acc(ctx) := acc(ctx) - shift_right(acc(ctx), ACC_SHIFT) + resize(u, ACC_WIDTH);
+
+                    reg_acc                <= acc;
+                    reg_prev2              <= reg_prev1;
+                    reg_prev1              <= unsigned(data_in);
+                    reg_model_valid        <= '1';
+                    reg_model_u            <= u;
+                    reg_model_k            <= to_unsigned(k, K_WIDTH);
+                    reg_model_end_of_frame <= end_of_frame_in;
+
+                    if end_of_frame_in = '1' then
+                        reg_next_x <= (others => '0');
+                        reg_next_y <= (others => '0');
+                    elsif x = unsigned(frame_width) - 1 then
+                        reg_next_x <= (others => '0');
+                        reg_next_y <= y + 1;
+                    else
+                        reg_next_x <= x + 1;
+                        reg_next_y <= y;
+                    end if;
+                end if;
+
+                -- code: unary quotient and binary remainder, or escape
+                if reg_model_valid = '1' then
+                    k := to_integer(reg_model_k);
+                    q := shift_right(reg_model_u, k);
+
+                    if q < ESC then
+                        code := shift_left(resize(reg_model_u and (shift_left(to_unsigned(1, PIX_DEPTH), k) - 1), CODE_WIDTH), to_integer(q) + 1) or
+                                (shift_left(to_unsigned(1, CODE_WIDTH), to_integer(q)) - 1);
+                        reg_code_len <= resize(q, LEN_WIDTH) + 1 + k;
+                    else
+                        code := shift_left(resize(reg_model_u, CODE_WIDTH), ESC) or to_unsigned(2 ** ESC - 1, CODE_WIDTH);
+                        reg_code_len <= to_unsigned(CODE_WIDTH, LEN_WIDTH);
+                    end if;
+
+                    reg_code_valid        <= '1';
+                    reg_code_bits         <= code;
+                    reg_code_end_of_frame <= reg_model_end_of_frame;
+                end if;
+
+                -- packer: append the code and output full words
+                if reg_flush = '1' then
+                    valid_out        <= '1';
+                    data_out         <= std_logic_vector(reg_bits(OUTPUT_WIDTH - 1 downto 0));
+                    end_of_frame_out <= '1';
+                    reg_bits         <= (others => '0');
+                    reg_fill         <= (others => '0');
+                end if;
+
+                if reg_code_valid = '1' then
+                    bits := reg_bits or shift_left(resize(reg_code_bits, BITS_WIDTH), to_integer(reg_fill));
+                    fill := reg_fill + reg_code_len;
+
+                    if fill >= OUTPUT_WIDTH then
+                        valid_out <= '1';
+                        data_out  <= std_logic_vector(bits(OUTPUT_WIDTH - 1 downto 0));
+                        bits      := shift_right(bits, OUTPUT_WIDTH);
+                        fill      := fill - OUTPUT_WIDTH;
+
+                        if reg_code_end_of_frame = '1' then
+                            if fill = 0 then
+                                end_of_frame_out <= '1';
+                            else
+                                reg_flush <= '1';
+                            end if;
+                        end if;
+                    elsif reg_code_end_of_frame = '1' then
+                        valid_out        <= '1';
+                        data_out         <= std_logic_vector(bits(OUTPUT_WIDTH - 1 downto 0));
+                        end_of_frame_out <= '1';
+                        bits             := (others => '0');
+                        fill             := (others => '0');
+                    end if;
+
+                    reg_bits <= bits;
+                    reg_fill <= fill;
+                end if;
+            end if;
+        end if;
+    end process;
+
+end architecture rtl;
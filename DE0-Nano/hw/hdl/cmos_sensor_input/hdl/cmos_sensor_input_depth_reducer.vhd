@@ -0,0 +1,103 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.cmos_sensor_input_constants.all;
+
+-- Pixel depth reducer.
+--
+-- Reduces each PIX_DEPTH-bit raw sample to REDUCED_PIX_DEPTH bits, either by
+-- keeping its most significant bits (SHIFT), or by looking it up in a table of
+-- 2 ** PIX_DEPTH entries loaded over the Avalon-MM slave (LUT), which allows
+-- any monotonic curve (gamma, log, ...) to be applied on the fly.
+--
+-- The output is registered, so pixels are delayed by one cycle in both modes.
+-- The stage is held in reset if depth_mode is set to FULL, in which case the
+-- top level bypasses it.
+--
+-- The table is written directly (it is not shadowed like the CONFIG register),
+-- so it must only be loaded while the unit is idle.
+entity cmos_sensor_input_depth_reducer is
+    generic(
+        PIX_DEPTH         : positive;
+        REDUCED_PIX_DEPTH : positive
+    );
+    port(
+        clk                : in  std_logic;
+        reset              : in  std_logic;
+
+        -- avalon_mm_slave
+        stop_and_reset     : in  std_logic;
+        depth_mode         : in  std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_WIDTH - 1 downto 0);
+        lut_write          : in  std_logic;
+        lut_index          : in  std_logic_vector(CMOS_SENSOR_INPUT_DEPTH_LUT_INDEX_WIDTH - 1 downto 0);
+        lut_value          : in  std_logic_vector(CMOS_SENSOR_INPUT_DEPTH_LUT_VALUE_WIDTH - 1 downto 0);
+
+        -- sampler / downscaler / planar
+        valid_in           : in  std_logic;
+        data_in            : in  std_logic_vector(PIX_DEPTH - 1 downto 0);
+        start_of_frame_in  : in  std_logic;
+        end_of_frame_in    : in  std_logic;
+
+        -- packer / fifo
+        valid_out          : out std_logic;
+        data_out           : out std_logic_vector(REDUCED_PIX_DEPTH - 1 downto 0);
+        start_of_frame_out : out std_logic;
+        end_of_frame_out   : out std_logic
+    );
+end entity cmos_sensor_input_depth_reducer;
+
+architecture rtl of cmos_sensor_input_depth_reducer is
+    type lut_type is array (0 to 2 ** PIX_DEPTH - 1) of std_logic_vector(REDUCED_PIX_DEPTH - 1 downto 0);
+
+    signal lut   : lut_type;
+    signal lut_q : std_logic_vector(data_out'range);
+
+    -- SHIFT mode output
+    signal reg_shifted : std_logic_vector(data_out'range);
+
+    -- flags of the pixel being reduced
+    signal reg_valid          : std_logic;
+    signal reg_start_of_frame : std_logic;
+    signal reg_end_of_frame   : std_logic;
+
+begin
+    valid_out          <= reg_valid;
+    data_out           <= lut_q when depth_mode = CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_LUT else reg_shifted;
+    start_of_frame_out <= reg_start_of_frame;
+    end_of_frame_out   <= reg_end_of_frame;
+
+    LUT_RAM : process(clk)
+    begin
+        if rising_edge(clk) then
+            if lut_write = '1' then
+                lut(to_integer(unsigned(lut_index(PIX_DEPTH - 1 downto 0)))) <= lut_value(data_out'range);
+            end if;
+
+            lut_q <= lut(to_integer(unsigned(data_in)));
+        end if;
+    end process;
+
+    REDUCE : process(clk, reset)
+    begin
+        if reset = '1' then
+            reg_shifted        <= (others => '0');
+            reg_valid          <= '0';
+            reg_start_of_frame <= '0';
+            reg_end_of_frame   <= '0';
+
+        elsif rising_edge(clk) then
+            reg_valid          <= '0';
+            reg_start_of_frame <= '0';
+            reg_end_of_frame   <= '0';
+
+            if stop_and_reset = '0' and depth_mode /= CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_FULL then
+                reg_shifted        <= data_in(PIX_DEPTH - 1 downto PIX_DEPTH - REDUCED_PIX_DEPTH);
+                reg_valid          <= valid_in;
+                reg_start_of_frame <= valid_in and start_of_frame_in;
+                reg_end_of_frame   <= valid_in and end_of_frame_in;
+            end if;
+        end if;
+    end process;
+
+end architecture rtl;
@@ -0,0 +1,338 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.cmos_sensor_input_constants.all;
+
+-- Bayer-preserving downscaler.
+--
+-- The frame is divided into blocks of (2 * F) x (2 * F) pixels, where F is the
+-- downscaling factor (1, 2 or 4). Each block contains F x F samples of each of
+-- the 4 Bayer channels, and is reduced to a single 2 x 2 Bayer quad, so the
+-- output is a valid Bayer mosaic with the same pattern as the input.
+--
+-- A pixel is output for every input pixel whose position inside its block is
+-- (2 * F - 2) or (2 * F - 1) along both axes, which is the last sample of its
+-- channel in the block. In DECIMATE mode, this last sample is output as is. In
+-- BIN mode, the average of the F x F samples of the channel in the block is
+-- output instead. Horizontal sums are kept in 2 accumulators (one per column
+-- parity), and vertical sums in a line buffer (one line per row parity).
+--
+-- Output frame dimensions are therefore
+--     floor(n / (2 * F)) * 2 + max(0, (n mod (2 * F)) - (2 * F - 2))
+-- for each input frame dimension n. The output frame width is also provided to
+-- the stages that follow, which need it to locate row boundaries. The last
+-- output pixel of a frame can only be identified once end_of_frame_in is seen,
+-- so output pixels are held for one output pixel before being forwarded.
+entity cmos_sensor_input_downscaler is
+    generic(
+        PIX_DEPTH  : positive;
+        MAX_WIDTH  : positive;
+        MAX_HEIGHT : positive
+    );
+    port(
+        clk                : in  std_logic;
+        reset              : in  std_logic;
+
+        -- avalon_mm_slave
+        stop_and_reset     : in  std_logic;
+        downscale_mode     : in  std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_WIDTH - 1 downto 0);
+        downscale_factor   : in  std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_WIDTH - 1 downto 0);
+
+        -- sampler
+        frame_width        : in  std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+        valid_in           : in  std_logic;
+        data_in            : in  std_logic_vector(PIX_DEPTH - 1 downto 0);
+        start_of_frame_in  : in  std_logic;
+        end_of_frame_in    : in  std_logic;
+
+        -- debayer / packer / fifo
+        valid_out          : out std_logic;
+        data_out           : out std_logic_vector(PIX_DEPTH - 1 downto 0);
+        start_of_frame_out : out std_logic;
+        end_of_frame_out   : out std_logic;
+
+        -- planar
+        output_frame_width : out std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0)
+    );
+end entity cmos_sensor_input_downscaler;
+
+architecture rtl of cmos_sensor_input_downscaler is
+    -- largest factor is 4x4 --> 16 samples per accumulated value
+    constant ACC_WIDTH : positive := PIX_DEPTH + 4;
+
+    -- one line buffer entry per output column (at most half the input columns), for each row parity
+    constant LINE_BUFFER_ADDR_WIDTH : positive := ceil_log2(max(floor_div(MAX_WIDTH + 1, 2), 2));
+
+    type h_acc_type is array (0 to 1) of unsigned(ACC_WIDTH - 1 downto 0);
+    type line_buffer_type is array (0 to 2 ** (LINE_BUFFER_ADDR_WIDTH + 1) - 1) of unsigned(ACC_WIDTH - 1 downto 0);
+
+    signal factor_log2 : natural range 0 to 2;
+
+    -- stage 0 (input pixel position)
+    signal reg_x     : unsigned(frame_width'range);
+    signal reg_y     : unsigned(frame_width'range);
+    signal reg_ox    : unsigned(LINE_BUFFER_ADDR_WIDTH - 1 downto 0);
+    signal reg_h_acc : h_acc_type;
+
+    signal cur_x     : unsigned(frame_width'range);
+    signal cur_y     : unsigned(frame_width'range);
+    signal cur_ox    : unsigned(LINE_BUFFER_ADDR_WIDTH - 1 downto 0);
+    signal col_end   : boolean;
+    signal row_start : boolean;
+    signal row_end   : boolean;
+    signal h_sum     : unsigned(ACC_WIDTH - 1 downto 0);
+
+    -- stage 1 (vertical accumulation)
+    signal reg_s1_valid     : std_logic;
+    signal reg_s1_data      : std_logic_vector(data_in'range);
+    signal reg_s1_h_sum     : unsigned(ACC_WIDTH - 1 downto 0);
+    signal reg_s1_col_end   : boolean;
+    signal reg_s1_row_start : boolean;
+    signal reg_s1_row_end   : boolean;
+    signal reg_s1_addr      : unsigned(LINE_BUFFER_ADDR_WIDTH downto 0);
+    signal reg_s1_sof       : std_logic;
+    signal reg_s1_eof       : std_logic;
+
+    signal v_sum     : unsigned(ACC_WIDTH - 1 downto 0);
+    signal emit      : boolean;
+    signal emit_data : std_logic_vector(data_in'range);
+
+    -- line buffer
+    signal line_buffer    : line_buffer_type;
+    signal line_buffer_we : std_logic;
+    signal line_buffer_q  : unsigned(ACC_WIDTH - 1 downto 0);
+
+    -- output (last emitted pixel is held until the next one, or until end of frame)
+    signal reg_first_pending : std_logic;
+    signal reg_hold_valid    : std_logic;
+    signal reg_hold_data     : std_logic_vector(data_in'range);
+    signal reg_hold_sof      : std_logic;
+    signal reg_flush         : std_logic;
+
+begin
+    factor_log2 <= 1 when downscale_factor = CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_2X2 else
+                   2 when downscale_factor = CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_4X4 else
+                   0;
+
+    -- floor(n / (2 * F)) * 2 + max(0, (n mod (2 * F)) - (2 * F - 2)), where the
+    -- second term is 1 if (n mod (2 * F)) = 2 * F - 1, and 0 otherwise
+    OUTPUT_FRAME_WIDTH_COMB : process(factor_log2, frame_width)
+        variable block_mask : unsigned(3 downto 0);
+        variable n          : unsigned(frame_width'range);
+        variable width      : unsigned(frame_width'range);
+    begin
+        block_mask := shift_left(to_unsigned(2, block_mask'length), factor_log2) - 1;
+        n          := unsigned(frame_width);
+
+        width := shift_left(shift_right(n, factor_log2 + 1), 1);
+        if (resize(n, block_mask'length) and block_mask) = block_mask then
+            width := width + 1;
+        end if;
+
+        output_frame_width <= std_logic_vector(width);
+    end process;
+
+    STAGE_0_COMB : process(data_in, factor_log2, reg_h_acc, reg_ox, reg_x, reg_y, start_of_frame_in)
+        variable block_size : unsigned(3 downto 0);
+        variable pos_x      : unsigned(3 downto 0);
+        variable pos_y      : unsigned(3 downto 0);
+    begin
+        cur_x  <= reg_x;
+        cur_y  <= reg_y;
+        cur_ox <= reg_ox;
+        if start_of_frame_in = '1' then
+            cur_x  <= (others => '0');
+            cur_y  <= (others => '0');
+            cur_ox <= (others => '0');
+        end if;
+
+        block_size := shift_left(to_unsigned(2, block_size'length), factor_log2);
+
+        if start_of_frame_in = '1' then
+            pos_x := (others => '0');
+            pos_y := (others => '0');
+        else
+            pos_x := resize(reg_x, pos_x'length) and (block_size - 1);
+            pos_y := resize(reg_y, pos_y'length) and (block_size - 1);
+        end if;
+
+        col_end   <= pos_x >= block_size - 2;
+        row_start <= pos_y < 2;
+        row_end   <= pos_y >= block_size - 2;
+
+        if pos_x < 2 then
+            h_sum <= resize(unsigned(data_in), ACC_WIDTH);
+        else
+            h_sum <= reg_h_acc(to_integer(pos_x(0 downto 0))) + resize(unsigned(data_in), ACC_WIDTH);
+        end if;
+    end process;
+
+    STAGE_0 : process(clk, reset)
+    begin
+        if reset = '1' then
+            reg_x            <= (others => '0');
+            reg_y            <= (others => '0');
+            reg_ox           <= (others => '0');
+            reg_h_acc        <= (others => (others => '0'));
+            reg_s1_valid     <= '0';
+            reg_s1_data      <= (others => '0');
+            reg_s1_h_sum     <= (others => '0');
+            reg_s1_col_end   <= false;
+            reg_s1_row_start <= false;
+            reg_s1_row_end   <= false;
+            reg_s1_addr      <= (others => '0');
+            reg_s1_sof       <= '0';
+            reg_s1_eof       <= '0';
+
+        elsif rising_edge(clk) then
+            reg_s1_valid <= '0';
+            reg_s1_sof   <= '0';
+            reg_s1_eof   <= '0';
+
+            if stop_and_reset = '1' then
+                reg_x     <= (others => '0');
+                reg_y     <= (others => '0');
+                reg_ox    <= (others => '0');
+                reg_h_acc <= (others => (others => '0'));
+            elsif valid_in = '1' then
+                reg_h_acc(to_integer(cur_x(0 downto 0))) <= h_sum;
+
+                reg_s1_valid     <= '1';
+                reg_s1_data      <= data_in;
+                reg_s1_h_sum     <= h_sum;
+                reg_s1_col_end   <= col_end;
+                reg_s1_row_start <= row_start;
+                reg_s1_row_end   <= row_end;
+                reg_s1_addr      <= cur_y(0) & cur_ox;
+                reg_s1_sof       <= start_of_frame_in;
+                reg_s1_eof       <= end_of_frame_in;
+
+                if cur_x = unsigned(frame_width) - 1 then
+                    reg_x  <= (others => '0');
+                    reg_y  <= cur_y + 1;
+                    reg_ox <= (others => '0');
+                else
+                    reg_x  <= cur_x + 1;
+                    reg_y  <= cur_y;
+                    reg_ox <= cur_ox;
+                    if col_end then
+                        reg_ox <= cur_ox + 1;
+                    end if;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    STAGE_1_COMB : process(downscale_mode, factor_log2, line_buffer_q, reg_s1_col_end, reg_s1_data, reg_s1_h_sum, reg_s1_row_end, reg_s1_row_start, reg_s1_valid)
+        variable v_sum_var : unsigned(ACC_WIDTH - 1 downto 0);
+    begin
+        if reg_s1_row_start then
+            v_sum_var := reg_s1_h_sum;
+        else
+            v_sum_var := line_buffer_q + reg_s1_h_sum;
+        end if;
+        v_sum <= v_sum_var;
+
+        emit           <= reg_s1_valid = '1' and reg_s1_col_end and reg_s1_row_end;
+        line_buffer_we <= '0';
+        if reg_s1_valid = '1' and reg_s1_col_end and not reg_s1_row_end then
+            line_buffer_we <= '1';
+        end if;
+
+        if downscale_mode = CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_BIN then
+            emit_data <= std_logic_vector(resize(shift_right(v_sum_var, 2 * factor_log2), PIX_DEPTH));
+        else
+            emit_data <= reg_s1_data;
+        end if;
+    end process;
+
+    LINE_BUFFER : process(clk)
+    begin
+        if rising_edge(clk) then
+            if line_buffer_we = '1' then
+                line_buffer(to_integer(reg_s1_addr)) <= v_sum;
+            end if;
+
+            line_buffer_q <= line_buffer(to_integer(cur_y(0) & cur_ox));
+        end if;
+    end process;
+
+    OUTPUT : process(clk, reset)
+    begin
+        if reset = '1' then
+            valid_out          <= '0';
+            data_out           <= (others => '0');
+            start_of_frame_out <= '0';
+            end_of_frame_out   <= '0';
+            reg_first_pending  <= '0';
+            reg_hold_valid     <= '0';
+            reg_hold_data      <= (others => '0');
+            reg_hold_sof       <= '0';
+            reg_flush          <= '0';
+
+        elsif rising_edge(clk) then
+            valid_out          <= '0';
+            data_out           <= (others => '0');
+            start_of_frame_out <= '0';
+            end_of_frame_out   <= '0';
+
+            if stop_and_reset = '1' then
+                reg_first_pending <= '0';
+                reg_hold_valid    <= '0';
+                reg_hold_data     <= (others => '0');
+                reg_hold_sof      <= '0';
+                reg_flush         <= '0';
+            elsif reg_flush = '1' then
+                -- last emitted pixel of the frame
+                valid_out          <= '1';
+                data_out           <= reg_hold_data;
+                start_of_frame_out <= reg_hold_sof;
+                end_of_frame_out   <= '1';
+
+                reg_hold_valid <= '0';
+                reg_flush      <= '0';
+            elsif reg_s1_valid = '1' then
+                if reg_s1_sof = '1' then
+                    reg_first_pending <= '1';
+                    reg_hold_valid    <= '0';
+                end if;
+
+                if emit then
+                    -- forward previously held pixel, and hold the new one
+                    if reg_hold_valid = '1' and reg_s1_sof = '0' then
+                        valid_out          <= '1';
+                        data_out           <= reg_hold_data;
+                        start_of_frame_out <= reg_hold_sof;
+                    end if;
+
+                    reg_hold_valid    <= '1';
+                    reg_hold_data     <= emit_data;
+                    reg_hold_sof      <= reg_first_pending or reg_s1_sof;
+                    reg_first_pending <= '0';
+
+                    if reg_s1_eof = '1' then
+                        reg_flush <= '1';
+                    end if;
+
+                elsif reg_s1_eof = '1' then
+                    valid_out        <= '1';
+                    end_of_frame_out <= '1';
+
+                    if reg_hold_valid = '1' and reg_s1_sof = '0' then
+                        data_out           <= reg_hold_data;
+                        start_of_frame_out <= reg_hold_sof;
+                    else
+                        -- frame too small to contain a single block: output its last pixel to terminate it
+                        data_out           <= reg_s1_data;
+                        start_of_frame_out <= '1';
+                    end if;
+
+                    reg_hold_valid    <= '0';
+                    reg_first_pending <= '0';
+                end if;
+            end if;
+        end if;
+    end process;
+
+end architecture rtl;
@@ -0,0 +1,162 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.cmos_sensor_input_constants.all;
+
+-- Processing stage slot of the stage chain.
+--
+-- Instantiates the stage implementation selected by STAGE_TYPE, and handles
+-- the parts that are common to all stage types:
+--
+--   * parameter word CMOS_SENSOR_INPUT_STAGE_CONTROL_WORD, whose ENABLE bit
+--     selects whether the stage processes the stream or is bypassed. It is
+--     shadowed like the CONFIG register, and only takes effect when
+--     config_latch is asserted. Stages are bypassed after reset.
+--   * the bypass itself. A bypassed stage forwards its input unmodified (no
+--     delay), and its implementation is held in reset.
+--
+-- All other parameter words are forwarded to the implementation, which must
+-- shadow them in the same way.
+--
+-- Every stage implementation uses the same data format for its input and its
+-- output (PIX_DEPTH-bit raw samples with valid, start_of_frame and
+-- end_of_frame), and must output exactly one pixel for every input pixel, in
+-- the same order and never faster than the input rate. It may delay pixels
+-- (even past end_of_frame_in, as long as the last pixel carries
+-- end_of_frame_out), but must not change the frame dimensions.
+--
+-- To add a new stage type, create its implementation with the same ports as
+-- cmos_sensor_input_stage_gain (plus frame_width if it needs it), add a
+-- generate block for it below, and add its name to the allowed values of the
+-- STAGE_<n>_TYPE parameters in the _hw.tcl file.
+entity cmos_sensor_input_stage is
+    generic(
+        PIX_DEPTH  : positive;
+        MAX_WIDTH  : positive;
+        MAX_HEIGHT : positive;
+        STAGE_TYPE : string
+    );
+    port(
+        clk                : in  std_logic;
+        reset              : in  std_logic;
+
+        -- avalon_mm_slave
+        stop_and_reset     : in  std_logic;
+        param_write        : in  std_logic;
+        param_word         : in  std_logic_vector(CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_WIDTH - 1 downto 0);
+        param_data         : in  std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+
+        -- sampler / downscaler
+        config_latch       : in  std_logic;
+        frame_width        : in  std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+
+        -- previous stage
+        valid_in           : in  std_logic;
+        data_in            : in  std_logic_vector(PIX_DEPTH - 1 downto 0);
+        start_of_frame_in  : in  std_logic;
+        end_of_frame_in    : in  std_logic;
+
+        -- next stage
+        valid_out          : out std_logic;
+        data_out           : out std_logic_vector(PIX_DEPTH - 1 downto 0);
+        start_of_frame_out : out std_logic;
+        end_of_frame_out   : out std_logic
+    );
+end entity cmos_sensor_input_stage;
+
+architecture rtl of cmos_sensor_input_stage is
+    signal reg_enable        : std_logic_vector(CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_WIDTH - 1 downto 0);
+    signal reg_enable_shadow : std_logic_vector(CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_WIDTH - 1 downto 0);
+
+    -- implementation held in reset while bypassed
+    signal impl_stop_and_reset : std_logic;
+
+    signal impl_valid_out          : std_logic;
+    signal impl_data_out           : std_logic_vector(data_out'range);
+    signal impl_start_of_frame_out : std_logic;
+    signal impl_end_of_frame_out   : std_logic;
+
+begin
+    assert STAGE_TYPE = "GAIN" or STAGE_TYPE = "CONV3X3"
+        report "unknown STAGE_TYPE " & STAGE_TYPE
+        severity failure;
+
+    CONTROL : process(clk, reset)
+    begin
+        if reset = '1' then
+            reg_enable        <= CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_BYPASS;
+            reg_enable_shadow <= CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_BYPASS;
+
+        elsif rising_edge(clk) then
+            if param_write = '1' and unsigned(param_word) = CMOS_SENSOR_INPUT_STAGE_CONTROL_WORD then
+                reg_enable_shadow <= param_data(CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_LOW_BIT_OFST);
+            end if;
+
+            if config_latch = '1' then
+                reg_enable <= reg_enable_shadow;
+            end if;
+        end if;
+    end process;
+
+    impl_stop_and_reset <= '1' when stop_and_reset = '1' or reg_enable = CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_BYPASS else '0';
+
+    gain_inst : if STAGE_TYPE = "GAIN" generate
+        cmos_sensor_input_stage_gain_inst : entity work.cmos_sensor_input_stage_gain
+            generic map(PIX_DEPTH => PIX_DEPTH)
+            port map(clk                => clk,
+                     reset              => reset,
+                     stop_and_reset     => impl_stop_and_reset,
+                     config_latch       => config_latch,
+                     param_write        => param_write,
+                     param_word         => param_word,
+                     param_data         => param_data,
+                     valid_in           => valid_in,
+                     data_in            => data_in,
+                     start_of_frame_in  => start_of_frame_in,
+                     end_of_frame_in    => end_of_frame_in,
+                     valid_out          => impl_valid_out,
+                     data_out           => impl_data_out,
+                     start_of_frame_out => impl_start_of_frame_out,
+                     end_of_frame_out   => impl_end_of_frame_out);
+    end generate gain_inst;
+
+    conv3x3_inst : if STAGE_TYPE = "CONV3X3" generate
+        cmos_sensor_input_stage_conv3x3_inst : entity work.cmos_sensor_input_stage_conv3x3
+            generic map(PIX_DEPTH  => PIX_DEPTH,
+                        MAX_WIDTH  => MAX_WIDTH,
+                        MAX_HEIGHT => MAX_HEIGHT)
+            port map(clk                => clk,
+                     reset              => reset,
+                     stop_and_reset     => impl_stop_and_reset,
+                     config_latch       => config_latch,
+                     param_write        => param_write,
+                     param_word         => param_word,
+                     param_data         => param_data,
+                     frame_width        => frame_width,
+                     valid_in           => valid_in,
+                     data_in            => data_in,
+                     start_of_frame_in  => start_of_frame_in,
+                     end_of_frame_in    => end_of_frame_in,
+                     valid_out          => impl_valid_out,
+                     data_out           => impl_data_out,
+                     start_of_frame_out => impl_start_of_frame_out,
+                     end_of_frame_out   => impl_end_of_frame_out);
+    end generate conv3x3_inst;
+
+    OUTPUT : process(data_in, end_of_frame_in, impl_data_out, impl_end_of_frame_out, impl_start_of_frame_out, impl_valid_out, reg_enable, start_of_frame_in, valid_in)
+    begin
+        if reg_enable = CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_PROCESS then
+            valid_out          <= impl_valid_out;
+            data_out           <= impl_data_out;
+            start_of_frame_out <= impl_start_of_frame_out;
+            end_of_frame_out   <= impl_end_of_frame_out;
+        else
+            valid_out          <= valid_in;
+            data_out           <= data_in;
+            start_of_frame_out <= start_of_frame_in;
+            end_of_frame_out   <= end_of_frame_in;
+        end if;
+    end process;
+
+end architecture rtl;
@@ -0,0 +1,115 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.cmos_sensor_input_constants.all;
+
+-- Processing stage chain.
+--
+-- Connects STAGE_COUNT processing stages in series on the raw bayer stream,
+-- stage 0 receiving the output of the sampler (or downscaler) and the last
+-- stage feeding the rest of the pipeline. The type of stage n is selected by
+-- the STAGE_<n>_TYPE generic, and generics of slots >= STAGE_COUNT are
+-- ignored. See cmos_sensor_input_stage for the interface all stage types
+-- follow.
+--
+-- Stage parameters are written through the STAGE_ADDR and STAGE_DATA
+-- registers of the Avalon-MM slave, which forwards each write to the chain
+-- along with the index of the stage and of the parameter word it targets.
+entity cmos_sensor_input_stage_chain is
+    generic(
+        PIX_DEPTH    : positive;
+        MAX_WIDTH    : positive;
+        MAX_HEIGHT   : positive;
+        STAGE_COUNT  : positive range 1 to CMOS_SENSOR_INPUT_MAX_STAGE_COUNT;
+        STAGE_0_TYPE : string;
+        STAGE_1_TYPE : string;
+        STAGE_2_TYPE : string;
+        STAGE_3_TYPE : string
+    );
+    port(
+        clk                : in  std_logic;
+        reset              : in  std_logic;
+
+        -- avalon_mm_slave
+        stop_and_reset     : in  std_logic;
+        stage_write        : in  std_logic;
+        stage_index        : in  std_logic_vector(CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_WIDTH - 1 downto 0);
+        stage_word         : in  std_logic_vector(CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_WIDTH - 1 downto 0);
+        stage_data         : in  std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+
+        -- sampler / downscaler
+        config_latch       : in  std_logic;
+        frame_width        : in  std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+        valid_in           : in  std_logic;
+        data_in            : in  std_logic_vector(PIX_DEPTH - 1 downto 0);
+        start_of_frame_in  : in  std_logic;
+        end_of_frame_in    : in  std_logic;
+
+        -- planar / depth_reducer / debayer / packer / fifo
+        valid_out          : out std_logic;
+        data_out           : out std_logic_vector(PIX_DEPTH - 1 downto 0);
+        start_of_frame_out : out std_logic;
+        end_of_frame_out   : out std_logic
+    );
+end entity cmos_sensor_input_stage_chain;
+
+architecture rtl of cmos_sensor_input_stage_chain is
+    type data_array is array (0 to STAGE_COUNT) of std_logic_vector(PIX_DEPTH - 1 downto 0);
+
+    -- link n is the input of stage n, link STAGE_COUNT is the chain output
+    signal link_valid          : std_logic_vector(0 to STAGE_COUNT);
+    signal link_data           : data_array;
+    signal link_start_of_frame : std_logic_vector(0 to STAGE_COUNT);
+    signal link_end_of_frame   : std_logic_vector(0 to STAGE_COUNT);
+
+    signal stage_param_write : std_logic_vector(0 to STAGE_COUNT - 1);
+
+    function stage_type(index : natural) return string is
+    begin
+        case index is
+            when 0      => return STAGE_0_TYPE;
+            when 1      => return STAGE_1_TYPE;
+            when 2      => return STAGE_2_TYPE;
+            when others => return STAGE_3_TYPE;
+        end case;
+    end function stage_type;
+
+begin
+    link_valid(0)          <= valid_in;
+    link_data(0)           <= data_in;
+    link_start_of_frame(0) <= start_of_frame_in;
+    link_end_of_frame(0)   <= end_of_frame_in;
+
+    valid_out          <= link_valid(STAGE_COUNT);
+    data_out           <= link_data(STAGE_COUNT);
+    start_of_frame_out <= link_start_of_frame(STAGE_COUNT);
+    end_of_frame_out   <= link_end_of_frame(STAGE_COUNT);
+
+    stage_inst : for i in 0 to STAGE_COUNT - 1 generate
+        stage_param_write(i) <= '1' when stage_write = '1' and unsigned(stage_index) = i else '0';
+
+        cmos_sensor_input_stage_inst : entity work.cmos_sensor_input_stage
+            generic map(PIX_DEPTH  => PIX_DEPTH,
+                        MAX_WIDTH  => MAX_WIDTH,
+                        MAX_HEIGHT => MAX_HEIGHT,
+                        STAGE_TYPE => stage_type(i))
+            port map(clk                => clk,
+                     reset              => reset,
+                     stop_and_reset     => stop_and_reset,
+                     param_write        => stage_param_write(i),
+                     param_word         => stage_word,
+                     param_data         => stage_data,
+                     config_latch       => config_latch,
+                     frame_width        => frame_width,
+                     valid_in           => link_valid(i),
+                     data_in            => link_data(i),
+                     start_of_frame_in  => link_start_of_frame(i),
+                     end_of_frame_in    => link_end_of_frame(i),
+                     valid_out          => link_valid(i + 1),
+                     data_out           => link_data(i + 1),
+                     start_of_frame_out => link_start_of_frame(i + 1),
+                     end_of_frame_out   => link_end_of_frame(i + 1));
+    end generate stage_inst;
+
+end architecture rtl;
@@ -0,0 +1,477 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.cmos_sensor_input_constants.all;
+
+-- 3x3 convolution stage (STAGE_TYPE = "CONV3X3").
+--
+-- Convolves the frame with a 3x3 kernel of signed 16-bit coefficients K, and
+-- post-processes the sum before saturating it to the sample range:
+--
+--   sum      = sum of K(r, c) * p(y + r - 1, x + c - 1) for r, c in 0 .. 2
+--   v        = sum >> SHIFT (arithmetic shift)
+--   v        = abs(v) if ABS is set
+--   data_out = min(max(v + BIAS, 0), 2 ** PIX_DEPTH - 1)
+--
+-- Pixels outside of the frame are replaced by the nearest edge pixel. The
+-- kernel is held in parameter words CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_WORD
+-- to CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_WORD + 8 (row-major), and SHIFT, ABS
+-- and BIAS in parameter word CMOS_SENSOR_INPUT_STAGE_CONV3X3_POST_WORD. They
+-- are shadowed like the CONFIG register, and only take effect when
+-- config_latch is asserted. The reset kernel is the identity.
+--
+-- The previous 2 rows are kept in a row buffer (one entry per column holding
+-- both rows), and the 3x3 window is shifted by one column for every input
+-- pixel. The output pixel centred on column x - 1 of the previous row is
+-- produced when pixel x of the current row arrives, and the last pixel of the
+-- previous row when the first pixel of the next row arrives, so the output is
+-- delayed by one row and one pixel (plus 3 pipeline cycles) and never exceeds
+-- the input rate. After end_of_frame_in, the last row and a half are flushed
+-- at one pixel per cycle by replaying the last row from the row buffer.
+entity cmos_sensor_input_stage_conv3x3 is
+    generic(
+        PIX_DEPTH  : positive;
+        MAX_WIDTH  : positive;
+        MAX_HEIGHT : positive
+    );
+    port(
+        clk                : in  std_logic;
+        reset              : in  std_logic;
+
+        -- stage
+        stop_and_reset     : in  std_logic;
+        config_latch       : in  std_logic;
+        param_write        : in  std_logic;
+        param_word         : in  std_logic_vector(CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_WIDTH - 1 downto 0);
+        param_data         : in  std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+        frame_width        : in  std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+
+        valid_in           : in  std_logic;
+        data_in            : in  std_logic_vector(PIX_DEPTH - 1 downto 0);
+        start_of_frame_in  : in  std_logic;
+        end_of_frame_in    : in  std_logic;
+
+        valid_out          : out std_logic;
+        data_out           : out std_logic_vector(PIX_DEPTH - 1 downto 0);
+        start_of_frame_out : out std_logic;
+        end_of_frame_out   : out std_logic
+    );
+end entity cmos_sensor_input_stage_conv3x3;
+
+architecture rtl of cmos_sensor_input_stage_conv3x3 is
+    constant ROW_BUFFER_ADDR_WIDTH : positive := ceil_log2(MAX_WIDTH);
+    constant COEF_WIDTH            : positive := CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_WIDTH;
+    constant PRODUCT_WIDTH         : positive := PIX_DEPTH + 1 + COEF_WIDTH;
+    -- 9 products
+    constant SUM_WIDTH             : positive := PRODUCT_WIDTH + 4;
+
+    -- window taps and coefficients are stored in row-major order
+    type tap_array is array (0 to 8) of unsigned(PIX_DEPTH - 1 downto 0);
+    type coef_array is array (0 to 8) of signed(COEF_WIDTH - 1 downto 0);
+    type product_array is array (0 to 8) of signed(PRODUCT_WIDTH - 1 downto 0);
+
+    -- each entry holds the pixels of a column in the 2 previous rows (older
+    -- row in the most significant bits)
+    type row_buffer_type is array (0 to 2 ** ROW_BUFFER_ADDR_WIDTH - 1) of std_logic_vector(2 * PIX_DEPTH - 1 downto 0);
+
+    constant IDENTITY_KERNEL : coef_array := (4 => to_signed(1, COEF_WIDTH), others => (others => '0'));
+
+    signal reg_coef          : coef_array;
+    signal reg_shift         : unsigned(CMOS_SENSOR_INPUT_STAGE_CONV3X3_SHIFT_WIDTH - 1 downto 0);
+    signal reg_abs           : std_logic_vector(CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_WIDTH - 1 downto 0);
+    signal reg_bias          : signed(CMOS_SENSOR_INPUT_STAGE_CONV3X3_BIAS_WIDTH - 1 downto 0);
+    signal reg_coef_shadow   : coef_array;
+    signal reg_shift_shadow  : unsigned(CMOS_SENSOR_INPUT_STAGE_CONV3X3_SHIFT_WIDTH - 1 downto 0);
+    signal reg_abs_shadow    : std_logic_vector(CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_WIDTH - 1 downto 0);
+    signal reg_bias_shadow   : signed(CMOS_SENSOR_INPUT_STAGE_CONV3X3_BIAS_WIDTH - 1 downto 0);
+
+    -- input pixel position (rows are counted up to 3, which is all the window
+    -- needs to know to handle the top edge)
+    signal reg_x   : unsigned(frame_width'range);
+    signal reg_row : unsigned(1 downto 0);
+    signal cur_x   : unsigned(frame_width'range);
+    signal cur_row : unsigned(1 downto 0);
+
+    -- replay of the last row after end_of_frame_in. reg_flush_x goes up to
+    -- frame_width, the last step only outputting the last pixel of the frame.
+    signal reg_flush   : std_logic;
+    signal reg_flush_x : unsigned(frame_width'range);
+
+    -- first output pixel gets start_of_frame
+    signal reg_sof_pending : std_logic;
+
+    -- row buffer
+    signal row_buffer    : row_buffer_type;
+    signal rd_addr       : unsigned(ROW_BUFFER_ADDR_WIDTH - 1 downto 0);
+    signal row_buffer_q  : std_logic_vector(2 * PIX_DEPTH - 1 downto 0);
+    signal row_buffer_we : std_logic;
+    signal wr_data       : std_logic_vector(2 * PIX_DEPTH - 1 downto 0);
+
+    -- step being shifted into the window (stage 1)
+    signal reg_step_valid  : std_logic; -- input (or replayed) pixel
+    signal reg_step_final  : std_logic; -- last flush step
+    signal reg_step_replay : std_logic;
+    signal reg_step_addr   : unsigned(ROW_BUFFER_ADDR_WIDTH - 1 downto 0);
+    signal reg_step_x_zero : std_logic;
+    signal reg_step_x_one  : std_logic;
+    signal reg_step_row    : unsigned(1 downto 0);
+    signal reg_step_data   : unsigned(PIX_DEPTH - 1 downto 0);
+
+    -- 3x3 window, column 2 being the newest
+    signal reg_window : tap_array;
+
+    -- selected taps (stage 2)
+    signal reg_taps       : tap_array;
+    signal reg_taps_valid : std_logic;
+    signal reg_taps_sof   : std_logic;
+    signal reg_taps_eof   : std_logic;
+
+    -- products (stage 3)
+    signal reg_products       : product_array;
+    signal reg_products_valid : std_logic;
+    signal reg_products_sof   : std_logic;
+    signal reg_products_eof   : std_logic;
+
+    -- output (stage 4)
+    signal reg_data_out           : std_logic_vector(data_out'range);
+    signal reg_valid_out          : std_logic;
+    signal reg_start_of_frame_out : std_logic;
+    signal reg_end_of_frame_out   : std_logic;
+
+    function next_row(row : unsigned(1 downto 0)) return unsigned is
+    begin
+        if row = 3 then
+            return row;
+        end if;
+        return row + 1;
+    end function next_row;
+
+begin
+    valid_out          <= reg_valid_out;
+    data_out           <= reg_data_out;
+    start_of_frame_out <= reg_start_of_frame_out;
+    end_of_frame_out   <= reg_end_of_frame_out;
+
+    PARAMS : process(clk, reset)
+        variable word : natural;
+    begin
+        if reset = '1' then
+            reg_coef         <= IDENTITY_KERNEL;
+            reg_shift        <= (others => '0');
+            reg_abs          <= CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_DISABLE;
+            reg_bias         <= (others => '0');
+            reg_coef_shadow  <= IDENTITY_KERNEL;
+            reg_shift_shadow <= (others => '0');
+            reg_abs_shadow   <= CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_DISABLE;
+            reg_bias_shadow  <= (others => '0');
+
+        elsif rising_edge(clk) then
+            word := to_integer(unsigned(param_word));
+
+            if param_write = '1' then
+                if word >= CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_WORD and word <= CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_WORD + 8 then
+                    reg_coef_shadow(word - CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_WORD) <= signed(param_data(CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_LOW_BIT_OFST));
+                elsif word = CMOS_SENSOR_INPUT_STAGE_CONV3X3_POST_WORD then
+                    reg_shift_shadow <= unsigned(param_data(CMOS_SENSOR_INPUT_STAGE_CONV3X3_SHIFT_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STAGE_CONV3X3_SHIFT_LOW_BIT_OFST));
+                    reg_abs_shadow   <= param_data(CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_LOW_BIT_OFST);
+                    reg_bias_shadow  <= signed(param_data(CMOS_SENSOR_INPUT_STAGE_CONV3X3_BIAS_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STAGE_CONV3X3_BIAS_LOW_BIT_OFST));
+                end if;
+            end if;
+
+            if config_latch = '1' then
+                reg_coef  <= reg_coef_shadow;
+                reg_shift <= reg_shift_shadow;
+                reg_abs   <= reg_abs_shadow;
+                reg_bias  <= reg_bias_shadow;
+            end if;
+        end if;
+    end process;
+
+    INPUT_POSITION : process(reg_row, reg_x, start_of_frame_in)
+    begin
+        cur_x   <= reg_x;
+        cur_row <= reg_row;
+        if start_of_frame_in = '1' then
+            cur_x   <= (others => '0');
+            cur_row <= (others => '0');
+        end if;
+    end process;
+
+    rd_addr <= resize(reg_flush_x, ROW_BUFFER_ADDR_WIDTH) when reg_flush = '1' else resize(cur_x, ROW_BUFFER_ADDR_WIDTH);
+
+    -- the column of the current step replaces the oldest row. Replayed steps
+    -- use the last row as their own data, which replicates it below the frame.
+    row_buffer_we <= reg_step_valid;
+    wr_data       <= row_buffer_q(PIX_DEPTH - 1 downto 0) & std_logic_vector(reg_step_data) when reg_step_replay = '0' else row_buffer_q(PIX_DEPTH - 1 downto 0) & row_buffer_q(PIX_DEPTH - 1 downto 0);
+
+    -- consecutive steps never use the same column (frames have at least 2
+    -- columns), so the entry being written is never the one being read
+    ROW_BUFFER_RAM : process(clk)
+    begin
+        if rising_edge(clk) then
+            if row_buffer_we = '1' then
+                row_buffer(to_integer(reg_step_addr)) <= wr_data;
+            end if;
+
+            row_buffer_q <= row_buffer(to_integer(rd_addr));
+        end if;
+    end process;
+
+    CONTROL : process(clk, reset)
+        variable new_column : tap_array;
+        variable taps       : tap_array;
+        variable centre     : natural range 0 to 2;
+        variable top        : natural range 0 to 2;
+        variable step_out   : std_logic;
+    begin
+        if reset = '1' then
+            reg_x           <= (others => '0');
+            reg_row         <= (others => '0');
+            reg_flush       <= '0';
+            reg_flush_x     <= (others => '0');
+            reg_sof_pending <= '0';
+            reg_step_valid  <= '0';
+            reg_step_final  <= '0';
+            reg_step_replay <= '0';
+            reg_step_addr   <= (others => '0');
+            reg_step_x_zero <= '0';
+            reg_step_x_one  <= '0';
+            reg_step_row    <= (others => '0');
+            reg_step_data   <= (others => '0');
+            reg_window      <= (others => (others => '0'));
+            reg_taps        <= (others => (others => '0'));
+            reg_taps_valid  <= '0';
+            reg_taps_sof    <= '0';
+            reg_taps_eof    <= '0';
+
+        elsif rising_edge(clk) then
+            reg_step_valid <= '0';
+            reg_step_final <= '0';
+            reg_taps_valid <= '0';
+            reg_taps_sof   <= '0';
+            reg_taps_eof   <= '0';
+
+            if stop_and_reset = '1' then
+                reg_x           <= (others => '0');
+                reg_row         <= (others => '0');
+                reg_flush       <= '0';
+                reg_flush_x     <= (others => '0');
+                reg_sof_pending <= '0';
+            else
+                -- stage 1 : accept a pixel (or replay one), and read the
+                -- previous rows at its column
+                if reg_flush = '1' then
+                    -- no input pixels arrive until the frame has been output
+                    reg_step_replay <= '1';
+                    reg_step_addr   <= resize(reg_flush_x, ROW_BUFFER_ADDR_WIDTH);
+                    reg_step_row    <= reg_row;
+
+                    if reg_flush_x = 0 then
+                        reg_step_x_zero <= '1';
+                    else
+                        reg_step_x_zero <= '0';
+                    end if;
+
+                    if reg_flush_x = 1 then
+                        reg_step_x_one <= '1';
+                    else
+                        reg_step_x_one <= '0';
+                    end if;
+
+                    if reg_flush_x = unsigned(frame_width) then
+                        -- behaves as the first pixel of one more row
+                        reg_step_final  <= '1';
+                        reg_step_x_zero <= '1';
+                        reg_step_row    <= next_row(reg_row);
+                        reg_flush       <= '0';
+                    else
+                        reg_step_valid <= '1';
+                        reg_flush_x    <= reg_flush_x + 1;
+                    end if;
+
+                elsif valid_in = '1' then
+                    reg_step_valid  <= '1';
+                    reg_step_replay <= '0';
+                    reg_step_addr   <= resize(cur_x, ROW_BUFFER_ADDR_WIDTH);
+                    reg_step_row    <= cur_row;
+                    reg_step_data   <= unsigned(data_in);
+
+                    if cur_x = 0 then
+                        reg_step_x_zero <= '1';
+                    else
+                        reg_step_x_zero <= '0';
+                    end if;
+
+                    if cur_x = 1 then
+                        reg_step_x_one <= '1';
+                    else
+                        reg_step_x_one <= '0';
+                    end if;
+
+                    if end_of_frame_in = '1' then
+                        -- replay the last row as one more row
+                        reg_flush   <= '1';
+                        reg_flush_x <= (others => '0');
+                        reg_x       <= (others => '0');
+                        reg_row     <= next_row(cur_row);
+                    elsif cur_x = unsigned(frame_width) - 1 then
+                        reg_x   <= (others => '0');
+                        reg_row <= next_row(cur_row);
+                    else
+                        reg_x   <= cur_x + 1;
+                        reg_row <= cur_row;
+                    end if;
+                end if;
+
+                -- stage 2 : shift the new column into the window, and select
+                -- the taps of the output pixel, replicating edge pixels
+                if reg_step_valid = '1' or reg_step_final = '1' then
+                    -- rows of the new column, oldest first
+                    new_column(0) := unsigned(row_buffer_q(2 * PIX_DEPTH - 1 downto PIX_DEPTH));
+                    new_column(1) := unsigned(row_buffer_q(PIX_DEPTH - 1 downto 0));
+                    if reg_step_replay = '1' then
+                        new_column(2) := unsigned(row_buffer_q(PIX_DEPTH - 1 downto 0));
+                    else
+                        new_column(2) := reg_step_data;
+                    end if;
+
+                    if reg_step_x_zero = '1' then
+                        -- last pixel of the row before the previous one, from
+                        -- the window before it is shifted (the right column
+                        -- replicates the last column)
+                        step_out := '0';
+                        if reg_step_row >= 2 then
+                            step_out := '1';
+                        end if;
+
+                        for r in 0 to 2 loop
+                            taps(3 * r + 0) := reg_window(3 * r + 1);
+                            taps(3 * r + 1) := reg_window(3 * r + 2);
+                            taps(3 * r + 2) := reg_window(3 * r + 2);
+                        end loop;
+
+                        -- the top row replicates the centre row on the first row
+                        if reg_step_row = 2 then
+                            taps(0) := taps(3);
+                            taps(1) := taps(4);
+                            taps(2) := taps(5);
+                        end if;
+                    else
+                        -- pixel x - 1 of the previous row, from the window
+                        -- once shifted (the left column replicates the centre
+                        -- column on the first column)
+                        step_out := '0';
+                        if reg_step_row >= 1 then
+                            step_out := '1';
+                        end if;
+
+                        for r in 0 to 2 loop
+                            if reg_step_x_one = '1' then
+                                taps(3 * r + 0) := reg_window(3 * r + 2);
+                            else
+                                taps(3 * r + 0) := reg_window(3 * r + 1);
+                            end if;
+                            taps(3 * r + 1) := reg_window(3 * r + 2);
+                            taps(3 * r + 2) := new_column(r);
+                        end loop;
+
+                        if reg_step_row = 1 then
+                            taps(0) := taps(3);
+                            taps(1) := taps(4);
+                            taps(2) := taps(5);
+                        end if;
+                    end if;
+
+                    if reg_step_valid = '1' then
+                        for r in 0 to 2 loop
+                            reg_window(3 * r + 0) <= reg_window(3 * r + 1);
+                            reg_window(3 * r + 1) <= reg_window(3 * r + 2);
+                            reg_window(3 * r + 2) <= new_column(r);
+                        end loop;
+                    end if;
+
+                    if step_out = '1' then
+                        reg_taps        <= taps;
+                        reg_taps_valid  <= '1';
+                        reg_taps_sof    <= reg_sof_pending;
+                        reg_taps_eof    <= reg_step_final;
+                        reg_sof_pending <= '0';
+                    end if;
+                end if;
+
+                -- after stage 2, which may output the last pixel of the
+                -- previous frame in the same cycle
+                if reg_flush = '0' and valid_in = '1' and start_of_frame_in = '1' then
+                    reg_sof_pending <= '1';
+                end if;
+            end if;
+        end if;
+    end process;
+
+    APPLY_KERNEL : process(clk, reset)
+        variable sum    : signed(SUM_WIDTH - 1 downto 0);
+        variable result : signed(SUM_WIDTH - 1 downto 0);
+    begin
+        if reset = '1' then
+            reg_products           <= (others => (others => '0'));
+            reg_products_valid     <= '0';
+            reg_products_sof       <= '0';
+            reg_products_eof       <= '0';
+            reg_data_out           <= (others => '0');
+            reg_valid_out          <= '0';
+            reg_start_of_frame_out <= '0';
+            reg_end_of_frame_out   <= '0';
+
+        elsif rising_edge(clk) then
+            reg_products_valid     <= '0';
+            reg_products_sof       <= '0';
+            reg_products_eof       <= '0';
+            reg_valid_out          <= '0';
+            reg_start_of_frame_out <= '0';
+            reg_end_of_frame_out   <= '0';
+
+            if stop_and_reset = '0' then
+                -- stage 3 : products
+                if reg_taps_valid = '1' then
+                    for i in 0 to 8 loop
+                        reg_products(i) <= resize(signed('0' & reg_taps(i)) * reg_coef(i), PRODUCT_WIDTH);
+                    end loop;
+
+                    reg_products_valid <= '1';
+                    reg_products_sof   <= reg_taps_sof;
+                    reg_products_eof   <= reg_taps_eof;
+                end if;
+
+                -- stage 4 : sum, post-processing and saturation
+                if reg_products_valid = '1' then
+                    sum := (others => '0');
+                    for i in 0 to 8 loop
+                        sum := sum + resize(reg_products(i), SUM_WIDTH);
+                    end loop;
+
+                    result := shift_right(sum, to_integer(reg_shift));
+
+                    if reg_abs = CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_ENABLE then
+                        result := abs(result);
+                    end if;
+
+                    result := result + resize(reg_bias, SUM_WIDTH);
+
+                    if result < 0 then
+                        reg_data_out <= (others => '0');
+                    elsif result(result'high downto PIX_DEPTH) /= 0 then
+                        reg_data_out <= (others => '1');
+                    else
+                        reg_data_out <= std_logic_vector(result(data_out'range));
+                    end if;
+
+                    reg_valid_out          <= '1';
+                    reg_start_of_frame_out <= reg_products_sof;
+                    reg_end_of_frame_out   <= reg_products_eof;
+                end if;
+            end if;
+        end if;
+    end process;
+
+end architecture rtl;
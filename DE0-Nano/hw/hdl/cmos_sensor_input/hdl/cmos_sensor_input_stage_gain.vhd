@@ -0,0 +1,130 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.cmos_sensor_input_constants.all;
+
+-- Gain stage (STAGE_TYPE = "GAIN").
+--
+-- Subtracts a black level offset from each sample, and multiplies the result
+-- by an unsigned 8.8 fixed point gain:
+--
+--   data_out = min((max(data_in - offset, 0) * gain) / 256, 2 ** PIX_DEPTH - 1)
+--
+-- Both values are held in parameter word CMOS_SENSOR_INPUT_STAGE_GAIN_WORD,
+-- which is shadowed like the CONFIG register and only takes effect when
+-- config_latch is asserted. The reset value is a gain of 1 and no offset.
+--
+-- The output is registered, so pixels are delayed by one cycle.
+entity cmos_sensor_input_stage_gain is
+    generic(
+        PIX_DEPTH : positive
+    );
+    port(
+        clk                : in  std_logic;
+        reset              : in  std_logic;
+
+        -- stage
+        stop_and_reset     : in  std_logic;
+        config_latch       : in  std_logic;
+        param_write        : in  std_logic;
+        param_word         : in  std_logic_vector(CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_WIDTH - 1 downto 0);
+        param_data         : in  std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+
+        valid_in           : in  std_logic;
+        data_in            : in  std_logic_vector(PIX_DEPTH - 1 downto 0);
+        start_of_frame_in  : in  std_logic;
+        end_of_frame_in    : in  std_logic;
+
+        valid_out          : out std_logic;
+        data_out           : out std_logic_vector(PIX_DEPTH - 1 downto 0);
+        start_of_frame_out : out std_logic;
+        end_of_frame_out   : out std_logic
+    );
+end entity cmos_sensor_input_stage_gain;
+
+architecture rtl of cmos_sensor_input_stage_gain is
+    constant GAIN_ONE : unsigned(CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_WIDTH - 1 downto 0) := to_unsigned(256, CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_WIDTH);
+
+    signal reg_gain          : unsigned(CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_WIDTH - 1 downto 0);
+    signal reg_offset        : unsigned(CMOS_SENSOR_INPUT_STAGE_GAIN_OFFSET_WIDTH - 1 downto 0);
+    signal reg_gain_shadow   : unsigned(CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_WIDTH - 1 downto 0);
+    signal reg_offset_shadow : unsigned(CMOS_SENSOR_INPUT_STAGE_GAIN_OFFSET_WIDTH - 1 downto 0);
+
+    signal reg_data_out           : std_logic_vector(data_out'range);
+    signal reg_valid_out          : std_logic;
+    signal reg_start_of_frame_out : std_logic;
+    signal reg_end_of_frame_out   : std_logic;
+
+begin
+    valid_out          <= reg_valid_out;
+    data_out           <= reg_data_out;
+    start_of_frame_out <= reg_start_of_frame_out;
+    end_of_frame_out   <= reg_end_of_frame_out;
+
+    PARAMS : process(clk, reset)
+    begin
+        if reset = '1' then
+            reg_gain          <= GAIN_ONE;
+            reg_offset        <= (others => '0');
+            reg_gain_shadow   <= GAIN_ONE;
+            reg_offset_shadow <= (others => '0');
+
+        elsif rising_edge(clk) then
+            if param_write = '1' and unsigned(param_word) = CMOS_SENSOR_INPUT_STAGE_GAIN_WORD then
+                reg_gain_shadow   <= unsigned(param_data(CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_LOW_BIT_OFST));
+                reg_offset_shadow <= unsigned(param_data(CMOS_SENSOR_INPUT_STAGE_GAIN_OFFSET_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STAGE_GAIN_OFFSET_LOW_BIT_OFST));
+            end if;
+
+            if config_latch = '1' then
+                reg_gain   <= reg_gain_shadow;
+                reg_offset <= reg_offset_shadow;
+            end if;
+        end if;
+    end process;
+
+    APPLY_GAIN : process(clk, reset)
+        variable sample  : unsigned(max(PIX_DEPTH, CMOS_SENSOR_INPUT_STAGE_GAIN_OFFSET_WIDTH) - 1 downto 0);
+        variable offset  : unsigned(sample'range);
+        variable product : unsigned(sample'length + reg_gain'length - 1 downto 0);
+        variable result  : unsigned(product'length - 8 - 1 downto 0);
+    begin
+        if reset = '1' then
+            reg_data_out           <= (others => '0');
+            reg_valid_out          <= '0';
+            reg_start_of_frame_out <= '0';
+            reg_end_of_frame_out   <= '0';
+
+        elsif rising_edge(clk) then
+            reg_valid_out          <= '0';
+            reg_start_of_frame_out <= '0';
+            reg_end_of_frame_out   <= '0';
+
+            if stop_and_reset = '0' and valid_in = '1' then
+                sample := resize(unsigned(data_in), sample'length);
+                offset := resize(reg_offset, offset'length);
+
+                if sample > offset then
+                    sample := sample - offset;
+                else
+                    sample := (others => '0');
+                end if;
+
+                product := sample * reg_gain;
+                result  := product(product'high downto 8);
+
+                -- saturate
+                if result(result'high downto PIX_DEPTH) /= 0 then
+                    reg_data_out <= (others => '1');
+                else
+                    reg_data_out <= std_logic_vector(result(data_out'range));
+                end if;
+
+                reg_valid_out          <= '1';
+                reg_start_of_frame_out <= start_of_frame_in;
+                reg_end_of_frame_out   <= end_of_frame_in;
+            end if;
+        end if;
+    end process;
+
+end architecture rtl;
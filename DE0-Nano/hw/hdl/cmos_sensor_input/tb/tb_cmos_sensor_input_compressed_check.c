@@ -0,0 +1,119 @@
+/*
+ * tb_cmos_sensor_input_compressed_check.c
+ *
+ * Decodes the compressed frame recorded by tb_cmos_sensor_input.vhd (with
+ * COMPRESSOR_ENABLE set) with the software decoder of the HAL
+ * (cmos_sensor_input_compressed_decode()), and compares it with the pixels
+ * that entered the compressor.
+ *
+ * The simulation writes tb_cmos_sensor_input_compressed.txt in its working
+ * directory. Then build and run from this directory:
+ *
+ *   gcc -std=gnu99 -I../HAL -o tb_cmos_sensor_input_compressed_check tb_cmos_sensor_input_compressed_check.c ../HAL/cmos_sensor_input.c
+ *   ./tb_cmos_sensor_input_compressed_check tb_cmos_sensor_input_compressed.txt
+ *
+ * File format (written by the testbench):
+ *
+ *   PIX_DEPTH OUTPUT_WIDTH
+ *   width height
+ *   width * height input samples
+ *   byte count
+ *   output bytes, in memory order (the high-order byte of each data_out word
+ *   first, as the msgdma writes them)
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cmos_sensor_input.h"
+
+#define MAX_PIXELS (1024 * 1024)
+
+static uint16_t expected[MAX_PIXELS];
+static uint16_t decoded[MAX_PIXELS];
+static uint8_t bytes[4 * MAX_PIXELS];
+
+int main(int argc, char *argv[]) {
+    const char *path = (argc > 1) ? argv[1] : "tb_cmos_sensor_input_compressed.txt";
+    unsigned pix_depth = 0;
+    unsigned output_width = 0;
+    unsigned width = 0;
+    unsigned height = 0;
+    unsigned byte_count = 0;
+
+    FILE *dump = fopen(path, "r");
+    if (dump == NULL) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+
+    if (fscanf(dump, "%u %u %u %u", &pix_depth, &output_width, &width, &height) != 4 ||
+        pix_depth == 0 || pix_depth > 16 || output_width == 0 || (output_width % 8) != 0 ||
+        width == 0 || height == 0 || (uint64_t) width * height > MAX_PIXELS) {
+        fprintf(stderr, "%s: bad header\n", path);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t pixel_count = width * height;
+    for (uint32_t i = 0; i < pixel_count; i++) {
+        unsigned value;
+        if (fscanf(dump, "%u", &value) != 1) {
+            fprintf(stderr, "%s: missing pixels\n", path);
+            return EXIT_FAILURE;
+        }
+        expected[i] = (uint16_t) value;
+    }
+
+    if (fscanf(dump, "%u", &byte_count) != 1 || byte_count > sizeof(bytes)) {
+        fprintf(stderr, "%s: bad byte count\n", path);
+        return EXIT_FAILURE;
+    }
+
+    for (uint32_t i = 0; i < byte_count; i++) {
+        unsigned value;
+        if (fscanf(dump, "%u", &value) != 1) {
+            fprintf(stderr, "%s: missing bytes\n", path);
+            return EXIT_FAILURE;
+        }
+        bytes[i] = (uint8_t) value;
+    }
+
+    fclose(dump);
+
+    /* the decoder only reads the instance parameters, not the registers */
+    cmos_sensor_input_dev dev = cmos_sensor_input_inst(NULL, pix_depth, width, height, output_width, 1,
+                                                       false, false, false, false, pix_depth, false, false, false,
+                                                       0, 0, false, true);
+
+    if (byte_count > cmos_sensor_input_compressed_size_bound(&dev, width, height)) {
+        fprintf(stderr, "%u bytes exceed the compressed size bound\n", byte_count);
+        printf("FAILED\n");
+        return EXIT_FAILURE;
+    }
+
+    if (!cmos_sensor_input_compressed_decode(&dev, bytes, byte_count, decoded, width, height)) {
+        fprintf(stderr, "stream ends before the last pixel\n");
+        printf("FAILED\n");
+        return EXIT_FAILURE;
+    }
+
+    uint32_t errors = 0;
+    for (uint32_t i = 0; i < pixel_count; i++) {
+        if (decoded[i] != expected[i]) {
+            fprintf(stderr, "pixel (%u, %u): decoded %u, expected %u\n", i % width, i / width, decoded[i], expected[i]);
+            errors++;
+        }
+    }
+
+    printf("%u pixels, %u bytes\n", pixel_count, byte_count);
+
+    if (errors != 0) {
+        printf("FAILED\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("PASSED\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,367 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.textio.all;
+
+library osvvm;
+use osvvm.RandomPkg.all;
+
+use work.cmos_sensor_input_constants.all;
+
+-- Checks a CONV3X3 processing stage against the software model of the HAL
+-- (cmos_sensor_input_conv3x3_reference()).
+--
+-- The test vectors are generated by tb_cmos_sensor_input_stage_conv3x3_ref.c
+-- (see its header for how to build and run both). Each test case configures
+-- the stage, streams one frame into it with random gaps between pixels, and
+-- compares every output pixel, as well as the start_of_frame and end_of_frame
+-- flags, with the expected frame. Cases with the stage disabled check the
+-- bypass.
+entity tb_cmos_sensor_input_stage_conv3x3 is
+end tb_cmos_sensor_input_stage_conv3x3;
+
+architecture test of tb_cmos_sensor_input_stage_conv3x3 is
+    -- 10 MHz -> 100 ns period. Duty cycle = 1/2.
+    constant CLK_PERIOD      : time := 100 ns;
+    constant CLK_HIGH_PERIOD : time := 50 ns;
+    constant CLK_LOW_PERIOD  : time := 50 ns;
+
+    signal clk   : std_logic;
+    signal reset : std_logic;
+
+    signal sim_finished : boolean := false;
+
+    -- simulation parameters ---------------------------------------------------
+    constant PIX_DEPTH  : positive := 8;
+    constant MAX_WIDTH  : positive := 64;
+    constant MAX_HEIGHT : positive := 64;
+
+    constant VECTORS_FILE : string := "tb_cmos_sensor_input_stage_conv3x3_vectors.txt";
+
+    constant INPUT_IDLE_THRESHOLD : natural range 0 to 100 := 30;
+
+    -- cmos_sensor_input_stage -------------------------------------------------
+    signal stage_stop_and_reset     : std_logic;
+    signal stage_param_write        : std_logic;
+    signal stage_param_word         : std_logic_vector(CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_WIDTH - 1 downto 0);
+    signal stage_param_data         : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+    signal stage_config_latch       : std_logic;
+    signal stage_frame_width        : std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+    signal stage_valid_in           : std_logic;
+    signal stage_data_in            : std_logic_vector(PIX_DEPTH - 1 downto 0);
+    signal stage_start_of_frame_in  : std_logic;
+    signal stage_end_of_frame_in    : std_logic;
+    signal stage_valid_out          : std_logic;
+    signal stage_data_out           : std_logic_vector(PIX_DEPTH - 1 downto 0);
+    signal stage_start_of_frame_out : std_logic;
+    signal stage_end_of_frame_out   : std_logic;
+
+    -- handshake between the driver and the checker, toggled at the end of
+    -- each case
+    signal case_started : boolean := false;
+    signal case_checked : boolean := false;
+
+    -- reads the header of the next case, returns false at the end of the file
+    procedure read_case(file f          : text;
+                        variable l      : inout line;
+                        variable width  : out natural;
+                        variable height : out natural;
+                        variable enable : out natural;
+                        variable found  : out boolean) is
+        variable good : boolean;
+    begin
+        found := false;
+
+        while not endfile(f) loop
+            readline(f, l);
+            read(l, width, good);
+            if good then
+                read(l, height);
+                read(l, enable);
+                found := true;
+                return;
+            end if;
+        end loop;
+    end procedure read_case;
+
+begin
+    clk_generation : process
+    begin
+        if not sim_finished then
+            clk <= '1';
+            wait for CLK_HIGH_PERIOD;
+            clk <= '0';
+            wait for CLK_LOW_PERIOD;
+        else
+            wait;
+        end if;
+    end process clk_generation;
+
+    cmos_sensor_input_stage_inst : entity work.cmos_sensor_input_stage
+        generic map(PIX_DEPTH  => PIX_DEPTH,
+                    MAX_WIDTH  => MAX_WIDTH,
+                    MAX_HEIGHT => MAX_HEIGHT,
+                    STAGE_TYPE => "CONV3X3")
+        port map(clk                => clk,
+                 reset              => reset,
+                 stop_and_reset     => stage_stop_and_reset,
+                 param_write        => stage_param_write,
+                 param_word         => stage_param_word,
+                 param_data         => stage_param_data,
+                 config_latch       => stage_config_latch,
+                 frame_width        => stage_frame_width,
+                 valid_in           => stage_valid_in,
+                 data_in            => stage_data_in,
+                 start_of_frame_in  => stage_start_of_frame_in,
+                 end_of_frame_in    => stage_end_of_frame_in,
+                 valid_out          => stage_valid_out,
+                 data_out           => stage_data_out,
+                 start_of_frame_out => stage_start_of_frame_out,
+                 end_of_frame_out   => stage_end_of_frame_out);
+
+    -- configures the stage and streams the input frame of each case
+    driver : process
+        file     vectors  : text;
+        variable l        : line;
+        variable rand_gen : RandomPType;
+        variable depth    : natural;
+        variable width    : natural;
+        variable height   : natural;
+        variable enable   : natural;
+        variable found    : boolean;
+        variable value    : integer;
+        variable shift    : natural;
+        variable abs_bit  : natural;
+        variable bias     : integer;
+        variable cases    : natural := 0;
+
+        procedure write_param(constant word : in natural;
+                              constant data : in std_logic_vector) is
+        begin
+            wait until falling_edge(clk);
+            stage_param_write <= '1';
+            stage_param_word  <= std_logic_vector(to_unsigned(word, stage_param_word'length));
+            stage_param_data  <= data;
+
+            wait until falling_edge(clk);
+            stage_param_write <= '0';
+            stage_param_word  <= (others => '0');
+            stage_param_data  <= (others => '0');
+        end procedure write_param;
+
+        procedure latch_config is
+        begin
+            wait until falling_edge(clk);
+            stage_config_latch <= '1';
+
+            wait until falling_edge(clk);
+            stage_config_latch <= '0';
+        end procedure latch_config;
+
+        procedure configure_stage is
+            variable data : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+        begin
+            -- CONTROL
+            data := (others => '0');
+            if enable = 1 then
+                data(CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_LOW_BIT_OFST) := CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_PROCESS;
+            else
+                data(CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_LOW_BIT_OFST) := CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_BYPASS;
+            end if;
+            write_param(CMOS_SENSOR_INPUT_STAGE_CONTROL_WORD, data);
+
+            -- coefficients
+            readline(vectors, l);
+            for i in 0 to 8 loop
+                read(l, value);
+                data := (others => '0');
+                data(CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_LOW_BIT_OFST) := std_logic_vector(to_signed(value, CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_WIDTH));
+                write_param(CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_WORD + i, data);
+            end loop;
+
+            -- shift, abs and bias
+            readline(vectors, l);
+            read(l, shift);
+            read(l, abs_bit);
+            read(l, bias);
+            data := (others => '0');
+            data(CMOS_SENSOR_INPUT_STAGE_CONV3X3_SHIFT_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STAGE_CONV3X3_SHIFT_LOW_BIT_OFST) := std_logic_vector(to_unsigned(shift, CMOS_SENSOR_INPUT_STAGE_CONV3X3_SHIFT_WIDTH));
+            if abs_bit = 1 then
+                data(CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_LOW_BIT_OFST) := CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_ENABLE;
+            else
+                data(CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_LOW_BIT_OFST) := CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_DISABLE;
+            end if;
+            data(CMOS_SENSOR_INPUT_STAGE_CONV3X3_BIAS_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_STAGE_CONV3X3_BIAS_LOW_BIT_OFST) := std_logic_vector(to_signed(bias, CMOS_SENSOR_INPUT_STAGE_CONV3X3_BIAS_WIDTH));
+            write_param(CMOS_SENSOR_INPUT_STAGE_CONV3X3_POST_WORD, data);
+
+            stage_frame_width <= std_logic_vector(to_unsigned(width, stage_frame_width'length));
+            latch_config;
+        end procedure configure_stage;
+
+        procedure stream_frame is
+        begin
+            readline(vectors, l);
+            for i in 0 to width * height - 1 loop
+                -- random gaps between pixels
+                while rand_gen.RandInt(0, 100) < INPUT_IDLE_THRESHOLD loop
+                    wait until falling_edge(clk);
+                    stage_valid_in          <= '0';
+                    stage_data_in           <= (others => '0');
+                    stage_start_of_frame_in <= '0';
+                    stage_end_of_frame_in   <= '0';
+                end loop;
+
+                read(l, value);
+
+                wait until falling_edge(clk);
+                stage_valid_in          <= '1';
+                stage_data_in           <= std_logic_vector(to_unsigned(value, PIX_DEPTH));
+                stage_start_of_frame_in <= '0';
+                stage_end_of_frame_in   <= '0';
+                if i = 0 then
+                    stage_start_of_frame_in <= '1';
+                end if;
+                if i = width * height - 1 then
+                    stage_end_of_frame_in <= '1';
+                end if;
+            end loop;
+
+            wait until falling_edge(clk);
+            stage_valid_in          <= '0';
+            stage_data_in           <= (others => '0');
+            stage_start_of_frame_in <= '0';
+            stage_end_of_frame_in   <= '0';
+
+            -- expected frame, read by the checker
+            readline(vectors, l);
+        end procedure stream_frame;
+
+    begin
+        rand_gen.InitSeed(rand_gen'instance_name);
+        rand_gen.SetRandomParm(UNIFORM);
+
+        reset                   <= '0';
+        stage_stop_and_reset    <= '0';
+        stage_param_write       <= '0';
+        stage_param_word        <= (others => '0');
+        stage_param_data        <= (others => '0');
+        stage_config_latch      <= '0';
+        stage_frame_width       <= (others => '0');
+        stage_valid_in          <= '0';
+        stage_data_in           <= (others => '0');
+        stage_start_of_frame_in <= '0';
+        stage_end_of_frame_in   <= '0';
+
+        wait until rising_edge(clk);
+        wait for CLK_PERIOD / 4;
+        reset <= '1';
+        wait for CLK_PERIOD / 2;
+        reset <= '0';
+
+        file_open(vectors, VECTORS_FILE, read_mode);
+
+        readline(vectors, l);
+        read(l, depth);
+        assert depth = PIX_DEPTH
+            report "test vectors were generated for PIX_DEPTH " & integer'image(depth)
+            severity failure;
+
+        loop
+            read_case(vectors, l, width, height, enable, found);
+            exit when not found;
+
+            assert width >= 2 and width <= MAX_WIDTH and height >= 1 and height <= MAX_HEIGHT
+                report "invalid frame size in test vectors"
+                severity failure;
+
+            configure_stage;
+
+            case_started <= not case_started;
+            stream_frame;
+
+            -- the next frame only starts once the current one has been output
+            wait on case_checked;
+            cases := cases + 1;
+        end loop;
+
+        file_close(vectors);
+
+        report "tb_cmos_sensor_input_stage_conv3x3: " & integer'image(cases) & " cases passed" severity note;
+        sim_finished <= true;
+        wait;
+    end process driver;
+
+    -- compares the output of the stage with the expected frame of each case
+    checker : process
+        file     vectors  : text;
+        variable l        : line;
+        variable depth    : natural;
+        variable width    : natural;
+        variable height   : natural;
+        variable enable   : natural;
+        variable found    : boolean;
+        variable expected : integer;
+        variable index    : natural;
+        variable cases    : natural := 0;
+    begin
+        file_open(vectors, VECTORS_FILE, read_mode);
+
+        readline(vectors, l);
+        read(l, depth);
+
+        loop
+            read_case(vectors, l, width, height, enable, found);
+            exit when not found;
+
+            -- coefficients, post-processing and input frame
+            readline(vectors, l);
+            readline(vectors, l);
+            readline(vectors, l);
+
+            -- expected frame
+            readline(vectors, l);
+
+            wait on case_started;
+
+            index := 0;
+            while index < width * height loop
+                wait until rising_edge(clk);
+
+                if stage_valid_out = '1' then
+                    read(l, expected);
+
+                    assert to_integer(unsigned(stage_data_out)) = expected
+                        report "case " & integer'image(cases) & ": pixel " & integer'image(index) & " is " & integer'image(to_integer(unsigned(stage_data_out))) & ", expected " & integer'image(expected)
+                        severity error;
+
+                    assert (stage_start_of_frame_out = '1') = (index = 0)
+                        report "case " & integer'image(cases) & ": start_of_frame_out on pixel " & integer'image(index)
+                        severity error;
+
+                    assert (stage_end_of_frame_out = '1') = (index = width * height - 1)
+                        report "case " & integer'image(cases) & ": end_of_frame_out on pixel " & integer'image(index)
+                        severity error;
+
+                    index := index + 1;
+                end if;
+            end loop;
+
+            -- no pixels after the end of the frame
+            for i in 0 to 15 loop
+                wait until rising_edge(clk);
+                assert stage_valid_out = '0'
+                    report "case " & integer'image(cases) & ": extra pixel after end_of_frame_out"
+                    severity error;
+            end loop;
+
+            cases        := cases + 1;
+            case_checked <= not case_checked;
+        end loop;
+
+        file_close(vectors);
+        wait;
+    end process checker;
+
+end architecture test;
@@ -0,0 +1,134 @@
+/*
+ * tb_cmos_sensor_input_stage_conv3x3_ref.c
+ *
+ * Generates the test vectors of tb_cmos_sensor_input_stage_conv3x3.vhd with
+ * the software model of the CONV3X3 processing stage in the HAL
+ * (cmos_sensor_input_conv3x3_reference()).
+ *
+ * Build and run from this directory:
+ *
+ *   gcc -std=gnu99 -I../HAL -o tb_cmos_sensor_input_stage_conv3x3_ref tb_cmos_sensor_input_stage_conv3x3_ref.c ../HAL/cmos_sensor_input.c
+ *   ./tb_cmos_sensor_input_stage_conv3x3_ref > tb_cmos_sensor_input_stage_conv3x3_vectors.txt
+ *
+ *   ghdl -i --std=08 -P<osvvm library> ../hdl/cmos_sensor_input*.vhd tb_cmos_sensor_input_stage_conv3x3.vhd
+ *   ghdl -m --std=08 -P<osvvm library> tb_cmos_sensor_input_stage_conv3x3
+ *   ghdl -r --std=08 tb_cmos_sensor_input_stage_conv3x3 --assert-level=error
+ *
+ * File format (one record per line, the testbench reads the same layout):
+ *
+ *   PIX_DEPTH
+ *   then for each case:
+ *     width height enable
+ *     coef[0] ... coef[8]
+ *     shift abs bias
+ *     width * height input samples
+ *     width * height expected samples (the input if enable is 0)
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cmos_sensor_input.h"
+
+#define PIX_DEPTH  (8)   /* must match the testbench */
+#define MAX_WIDTH  (64)  /* must match the testbench */
+#define MAX_HEIGHT (64)  /* must match the testbench */
+
+static uint16_t src[MAX_WIDTH * MAX_HEIGHT];
+static uint16_t dst[MAX_WIDTH * MAX_HEIGHT];
+
+/*
+ * write_case
+ *
+ * Fills a width x height frame with random samples (or a ramp if ramp is set),
+ * and writes it along with the parameters and the expected output.
+ */
+static void write_case(uint32_t width, uint32_t height, bool enable, bool ramp, const cmos_sensor_input_conv3x3 *conv) {
+    uint32_t max_value = (1 << PIX_DEPTH) - 1;
+
+    for (uint32_t i = 0; i < width * height; i++) {
+        src[i] = ramp ? (uint16_t) ((i * 37) & max_value) : (uint16_t) (rand() & max_value);
+    }
+
+    if (enable) {
+        cmos_sensor_input_conv3x3_reference(src, dst, width, height, PIX_DEPTH, conv);
+    } else {
+        for (uint32_t i = 0; i < width * height; i++) {
+            dst[i] = src[i];
+        }
+    }
+
+    printf("%u %u %u\n", width, height, enable ? 1 : 0);
+
+    for (uint32_t i = 0; i < 9; i++) {
+        printf("%d%c", conv->coef[i], i == 8 ? '\n' : ' ');
+    }
+
+    printf("%u %u %d\n", conv->shift, conv->abs ? 1 : 0, conv->bias);
+
+    for (uint32_t i = 0; i < width * height; i++) {
+        printf("%u%c", src[i], i == width * height - 1 ? '\n' : ' ');
+    }
+
+    for (uint32_t i = 0; i < width * height; i++) {
+        printf("%u%c", dst[i], i == width * height - 1 ? '\n' : ' ');
+    }
+}
+
+int main(void) {
+    const cmos_sensor_input_conv3x3_preset presets[] = {CONV3X3_IDENTITY, CONV3X3_BOX, CONV3X3_SHARPEN, CONV3X3_SOBEL_X, CONV3X3_SOBEL_Y};
+    const uint32_t sizes[][2] = {{2, 1}, {2, 2}, {3, 3}, {5, 4}, {13, 7}, {MAX_WIDTH, 3}};
+
+    srand(1);
+
+    printf("%u\n", PIX_DEPTH);
+
+    /* presets on all frame sizes, including the smallest ones */
+    for (uint32_t p = 0; p < sizeof(presets) / sizeof(presets[0]); p++) {
+        cmos_sensor_input_conv3x3 conv = cmos_sensor_input_conv3x3_preset_kernel(presets[p]);
+
+        for (uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            write_case(sizes[s][0], sizes[s][1], true, false, &conv);
+        }
+    }
+
+    /* asymmetric kernel on a ramp, to catch swapped taps */
+    cmos_sensor_input_conv3x3 asym = {.coef = {1, 2, 3, 4, 5, 6, 7, 8, 9}, .shift = 6, .abs = false, .bias = 0};
+    write_case(9, 6, true, true, &asym);
+
+    /* saturation at both ends, negative bias and full scale coefficients */
+    cmos_sensor_input_conv3x3 high = {.coef = {0, 0, 0, 0, 32767, 0, 0, 0, 0}, .shift = 0, .abs = false, .bias = 0};
+    write_case(6, 5, true, false, &high);
+
+    cmos_sensor_input_conv3x3 low = {.coef = {-32768, 0, 0, 0, 0, 0, 0, 0, -32768}, .shift = 31, .abs = false, .bias = -32768};
+    write_case(6, 5, true, false, &low);
+
+    cmos_sensor_input_conv3x3 sobel_bias = cmos_sensor_input_conv3x3_preset_kernel(CONV3X3_SOBEL_X);
+    sobel_bias.abs = false;
+    sobel_bias.bias = 128;
+    write_case(11, 8, true, false, &sobel_bias);
+
+    /* random kernels */
+    for (uint32_t i = 0; i < 8; i++) {
+        cmos_sensor_input_conv3x3 conv;
+
+        for (uint32_t c = 0; c < 9; c++) {
+            conv.coef[c] = (int16_t) ((rand() % 513) - 256);
+        }
+
+        conv.shift = (uint8_t) (rand() % 12);
+        conv.abs = rand() % 2;
+        conv.bias = (int16_t) ((rand() % 513) - 256);
+
+        write_case(2 + rand() % 20, 1 + rand() % 10, true, false, &conv);
+    }
+
+    /* bypass, then enabled again to check that the stage restarts cleanly */
+    cmos_sensor_input_conv3x3 box = cmos_sensor_input_conv3x3_preset_kernel(CONV3X3_BOX);
+    write_case(7, 5, false, false, &box);
+    write_case(7, 5, true, false, &box);
+
+    return EXIT_SUCCESS;
+}
@@ -11,16 +11,68 @@
 typedef struct cmos_sensor_acquisition_dev {
     cmos_sensor_input_dev cmos_sensor_input;
     msgdma_dev            msgdma;
+    msgdma_dev            msgdma_preview;
 } cmos_sensor_acquisition_dev;
 
+/* tiled frame layout */
+typedef struct cmos_sensor_acquisition_tiled_layout {
+    uint8_t  *base;            /* Address of the first tile */
+    uint32_t frame_width;      /* Frame width in pixels */
+    uint32_t frame_height;     /* Frame height in pixels */
+    uint32_t tile_width;       /* Tile width in pixels */
+    uint32_t tile_height;      /* Tile height in pixels */
+    uint32_t tiles_per_row;    /* Number of tiles in a row of tiles */
+    uint32_t tiles_per_column; /* Number of rows of tiles */
+    size_t   tile_row_size;    /* Size of a row of a tile in bytes */
+    size_t   tile_size;        /* Size of a tile in bytes */
+} cmos_sensor_acquisition_tiled_layout;
+
+/* iterator over the tiles of a tiled frame */
+typedef struct cmos_sensor_acquisition_tile_iterator {
+    const cmos_sensor_acquisition_tiled_layout *layout; /* Layout being iterated over */
+    uint32_t                                   index;   /* Index of the next tile */
+    uint8_t                                    *tile;   /* Address of the current tile */
+    uint32_t                                   x;       /* Frame column of the current tile's top-left pixel */
+    uint32_t                                   y;       /* Frame row of the current tile's top-left pixel */
+    uint32_t                                   width;   /* Valid width of the current tile in pixels */
+    uint32_t                                   height;  /* Valid height of the current tile in pixels */
+} cmos_sensor_acquisition_tile_iterator;
+
+/* Bayer channels, G1 is the green channel on red rows and G2 on blue rows */
+typedef enum cmos_sensor_acquisition_bayer_channel {BAYER_R, BAYER_G1, BAYER_G2, BAYER_B} cmos_sensor_acquisition_bayer_channel;
+
+/* planar frame layout (plane i holds the pixels of rows of parity (i / 2) and columns of parity (i % 2)) */
+typedef struct cmos_sensor_acquisition_planar_layout {
+    uint8_t  *planes[4];     /* Address of each plane */
+    uint32_t frame_width;    /* Frame width in pixels */
+    uint32_t frame_height;   /* Frame height in pixels */
+    uint32_t plane_width;    /* Plane width in pixels */
+    uint32_t plane_height;   /* Plane height in pixels */
+    size_t   plane_row_size; /* Size of a row of a plane in bytes */
+    size_t   plane_size;     /* Size of a plane in bytes */
+} cmos_sensor_acquisition_planar_layout;
+
+/* Strip completion callback type definition */
+typedef void (*cmos_sensor_acquisition_strip_callback)(void *strip, size_t strip_size, uint32_t strip_index, void *context);
+
 cmos_sensor_acquisition_dev cmos_sensor_acquisition_inst(void     *cmos_sensor_input_base,
                                                          uint8_t  cmos_sensor_input_pix_depth,
                                                          uint32_t cmos_sensor_input_max_width,
                                                          uint32_t cmos_sensor_Input_max_height,
                                                          uint32_t cmos_sensor_input_output_width,
                                                          uint32_t cmos_sensor_input_fifo_depth,
+                                                         bool     cmos_sensor_input_downscaler_enable,
+                                                         bool     cmos_sensor_input_preview_enable,
+                                                         bool     cmos_sensor_input_planar_enable,
+                                                         bool     cmos_sensor_input_depth_reducer_enable,
+                                                         uint8_t  cmos_sensor_input_reduced_pix_depth,
                                                          bool     cmos_sensor_input_debayer_enable,
+                                                         bool     cmos_sensor_input_color_converter_enable,
                                                          bool     cmos_sensor_input_pack_enable,
+                                                         uint8_t  cmos_sensor_input_stage_count,
+                                                         uint8_t  cmos_sensor_input_blob_count,
+                                                         bool     cmos_sensor_input_sparse_enable,
+                                                         bool     cmos_sensor_input_compressor_enable,
                                                          void     *msgdma_csr_base,
                                                          void     *msgdma_descriptor_base,
                                                          uint32_t msgdma_descriptor_fifo_depth,
@@ -48,8 +100,18 @@ cmos_sensor_acquisition_dev cmos_sensor_acquisition_inst(void     *cmos_sensor_i
                                  prefix_cmos_sensor_input ## _MAX_HEIGHT,                  \
                                  prefix_cmos_sensor_input ## _OUTPUT_WIDTH,                \
                                  prefix_cmos_sensor_input ## _FIFO_DEPTH,                  \
+                                 prefix_cmos_sensor_input ## _DOWNSCALER_ENABLE,           \
+                                 prefix_cmos_sensor_input ## _PREVIEW_ENABLE,              \
+                                 prefix_cmos_sensor_input ## _PLANAR_ENABLE,               \
+                                 prefix_cmos_sensor_input ## _DEPTH_REDUCER_ENABLE,        \
+                                 prefix_cmos_sensor_input ## _REDUCED_PIX_DEPTH,           \
                                  prefix_cmos_sensor_input ## _DEBAYER_ENABLE,              \
+                                 prefix_cmos_sensor_input ## _COLOR_CONVERTER_ENABLE,      \
                                  prefix_cmos_sensor_input ## _PACKER_ENABLE,               \
+                                 prefix_cmos_sensor_input ## _STAGE_COUNT,                 \
+                                 prefix_cmos_sensor_input ## _BLOB_COUNT,                  \
+                                 prefix_cmos_sensor_input ## _SPARSE_ENABLE,               \
+                                 prefix_cmos_sensor_input ## _COMPRESSOR_ENABLE,           \
                                  ((void *) prefix_msgdma ## _CSR_BASE),                    \
                                  ((void *) prefix_msgdma ## _DESCRIPTOR_SLAVE_BASE),       \
                                  prefix_msgdma ## _DESCRIPTOR_SLAVE_DESCRIPTOR_FIFO_DEPTH, \
@@ -65,6 +127,16 @@ cmos_sensor_acquisition_dev cmos_sensor_acquisition_inst(void     *cmos_sensor_i
                                  prefix_msgdma ## _CSR_ENHANCED_FEATURES,                  \
                                  prefix_msgdma ## _CSR_RESPONSE_PORT)
 
+void cmos_sensor_acquisition_attach_preview_msgdma(cmos_sensor_acquisition_dev *dev, msgdma_dev msgdma_preview);
+
+/*
+ * Helper macro for attaching the msgdma connected to the preview stream. The
+ * user needs to provide the msgdma's prefix. Must be called before
+ * cmos_sensor_acquisition_init().
+ */
+#define CMOS_SENSOR_ACQUISITION_ATTACH_PREVIEW_MSGDMA(dev, prefix_msgdma) \
+    cmos_sensor_acquisition_attach_preview_msgdma((dev), MSGDMA_CSR_DESCRIPTOR_INST(prefix_msgdma))
+
 void cmos_sensor_acquisition_init(cmos_sensor_acquisition_dev *dev);
 
 void cmos_sensor_acquisition_configure(cmos_sensor_acquisition_dev *dev);
@@ -72,5 +144,26 @@ size_t cmos_sensor_acquisition_frame_size(cmos_sensor_acquisition_dev *dev);
 uint32_t cmos_sensor_acquisition_frame_width(cmos_sensor_acquisition_dev *dev);
 uint32_t cmos_sensor_acquisition_frame_height(cmos_sensor_acquisition_dev *dev);
 bool cmos_sensor_acquisition_snapshot(cmos_sensor_acquisition_dev *dev, void *frame, size_t frame_size);
+bool cmos_sensor_acquisition_snapshot_enqueue(cmos_sensor_acquisition_dev *dev, void *frame, size_t frame_size);
+uint32_t cmos_sensor_acquisition_snapshot_pending(cmos_sensor_acquisition_dev *dev);
+bool cmos_sensor_acquisition_wait_snapshots(cmos_sensor_acquisition_dev *dev);
+bool cmos_sensor_acquisition_tiled_layout_init(cmos_sensor_acquisition_dev *dev, cmos_sensor_acquisition_tiled_layout *layout, void *base, uint32_t tile_width, uint32_t tile_height);
+size_t cmos_sensor_acquisition_tiled_frame_size(const cmos_sensor_acquisition_tiled_layout *layout);
+bool cmos_sensor_acquisition_snapshot_tiled(cmos_sensor_acquisition_dev *dev, const cmos_sensor_acquisition_tiled_layout *layout);
+void *cmos_sensor_acquisition_tiled_row(const cmos_sensor_acquisition_tiled_layout *layout, uint32_t x, uint32_t y);
+void cmos_sensor_acquisition_tile_iterator_init(cmos_sensor_acquisition_tile_iterator *it, const cmos_sensor_acquisition_tiled_layout *layout);
+bool cmos_sensor_acquisition_tile_iterator_next(cmos_sensor_acquisition_tile_iterator *it);
+size_t cmos_sensor_acquisition_strip_size(cmos_sensor_acquisition_dev *dev, uint32_t lines);
+bool cmos_sensor_acquisition_snapshot_pitched(cmos_sensor_acquisition_dev *dev, void *base, size_t pitch);
+bool cmos_sensor_acquisition_snapshot_strips(cmos_sensor_acquisition_dev *dev, void *ring, uint32_t ring_strips, size_t strip_size, cmos_sensor_acquisition_strip_callback callback, void *context);
+size_t cmos_sensor_acquisition_preview_frame_size(cmos_sensor_acquisition_dev *dev);
+uint32_t cmos_sensor_acquisition_preview_frame_width(cmos_sensor_acquisition_dev *dev);
+uint32_t cmos_sensor_acquisition_preview_frame_height(cmos_sensor_acquisition_dev *dev);
+bool cmos_sensor_acquisition_planar_layout_init(cmos_sensor_acquisition_dev *dev, cmos_sensor_acquisition_planar_layout *layout, void *base);
+size_t cmos_sensor_acquisition_planar_frame_size(const cmos_sensor_acquisition_planar_layout *layout);
+bool cmos_sensor_acquisition_snapshot_planar(cmos_sensor_acquisition_dev *dev, const cmos_sensor_acquisition_planar_layout *layout);
+void *cmos_sensor_acquisition_planar_plane(const cmos_sensor_acquisition_planar_layout *layout, cmos_sensor_input_debayer_pattern pattern, cmos_sensor_acquisition_bayer_channel channel);
+void *cmos_sensor_acquisition_planar_row(const cmos_sensor_acquisition_planar_layout *layout, uint32_t plane, uint32_t y);
+bool cmos_sensor_acquisition_snapshot_dual(cmos_sensor_acquisition_dev *dev, void *frame, size_t frame_size, void *preview, size_t preview_size);
 
 #endif /* __CMOS_SENSOR_ACQUISITION_H__ */
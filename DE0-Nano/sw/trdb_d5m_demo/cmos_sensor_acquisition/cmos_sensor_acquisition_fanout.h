@@ -0,0 +1,80 @@
+#ifndef __CMOS_SENSOR_ACQUISITION_FANOUT_H__
+#define __CMOS_SENSOR_ACQUISITION_FANOUT_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#define CMOS_SENSOR_ACQUISITION_FANOUT_THREADS
+#endif
+
+#include "cmos_sensor_acquisition_frame_pool.h"
+
+/* Maximum number of consumers of a dispatcher */
+#define CMOS_SENSOR_ACQUISITION_FANOUT_MAX_CONSUMERS   (8)
+
+/* Maximum number of frames queued for a consumer */
+#define CMOS_SENSOR_ACQUISITION_FANOUT_MAX_QUEUE_DEPTH (8)
+
+struct cmos_sensor_acquisition_fanout;
+
+/* Reference-counted frame of a pool */
+typedef struct cmos_sensor_acquisition_frame {
+    void                                  *data;     /* Frame contents */
+    size_t                                size;      /* Number of valid bytes */
+    uint32_t                              sequence;  /* Frame number */
+    uint64_t                              timestamp; /* Capture time */
+    uint32_t                              refs;      /* Number of holders (0 while the frame is in the pool) */
+    struct cmos_sensor_acquisition_fanout *fanout;   /* Dispatcher owning the frame */
+} cmos_sensor_acquisition_frame;
+
+/* Called for every frame a consumer receives */
+typedef void (*cmos_sensor_acquisition_fanout_callback)(cmos_sensor_acquisition_frame *frame, void *context);
+
+/* Consumer of a dispatcher */
+typedef struct cmos_sensor_acquisition_fanout_consumer {
+    cmos_sensor_acquisition_fanout_callback callback;                                               /* Frame handler */
+    void                                    *context;                                               /* Context of the frame handler */
+    uint32_t                                queue_depth;                                            /* Maximum number of queued frames */
+    cmos_sensor_acquisition_frame           *queue[CMOS_SENSOR_ACQUISITION_FANOUT_MAX_QUEUE_DEPTH]; /* Ring of queued frames */
+    uint32_t                                queue_head;                                             /* Index of the oldest queued frame */
+    uint32_t                                queue_count;                                            /* Number of queued frames */
+    uint64_t                                processed;                                              /* Frames handled so far */
+    uint64_t                                dropped;                                                /* Frames skipped because the queue was full */
+    struct cmos_sensor_acquisition_fanout   *fanout;                                                /* Dispatcher of the consumer */
+#if defined(CMOS_SENSOR_ACQUISITION_FANOUT_THREADS)
+    pthread_t                               thread;                                                 /* Worker thread */
+    pthread_cond_t                          wakeup;                                                 /* Signaled when a frame is queued */
+#endif
+} cmos_sensor_acquisition_fanout_consumer;
+
+/* Frame dispatcher */
+typedef struct cmos_sensor_acquisition_fanout {
+    cmos_sensor_acquisition_frame_pool      *pool;                                                 /* Frames handed out */
+    cmos_sensor_acquisition_frame           frames[CMOS_SENSOR_ACQUISITION_FRAME_POOL_MAX_FRAMES]; /* Handle of each frame of the pool */
+    cmos_sensor_acquisition_fanout_consumer consumers[CMOS_SENSOR_ACQUISITION_FANOUT_MAX_CONSUMERS];
+    uint32_t                                consumer_count;                                        /* Number of consumers */
+    uint32_t                                sequence;                                              /* Sequence of the next dispatched frame */
+    bool                                    running;                                               /* Consumers accept frames */
+#if defined(CMOS_SENSOR_ACQUISITION_FANOUT_THREADS)
+    pthread_mutex_t                         lock;                                                  /* Protects the pool and the queues */
+#endif
+} cmos_sensor_acquisition_fanout;
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+bool cmos_sensor_acquisition_fanout_init(cmos_sensor_acquisition_fanout *fanout, cmos_sensor_acquisition_frame_pool *pool);
+bool cmos_sensor_acquisition_fanout_add_consumer(cmos_sensor_acquisition_fanout *fanout, cmos_sensor_acquisition_fanout_callback callback, void *context, uint32_t queue_depth);
+bool cmos_sensor_acquisition_fanout_start(cmos_sensor_acquisition_fanout *fanout);
+void cmos_sensor_acquisition_fanout_stop(cmos_sensor_acquisition_fanout *fanout);
+
+cmos_sensor_acquisition_frame *cmos_sensor_acquisition_fanout_acquire(cmos_sensor_acquisition_fanout *fanout);
+void cmos_sensor_acquisition_fanout_dispatch(cmos_sensor_acquisition_fanout *fanout, cmos_sensor_acquisition_frame *frame, size_t size, uint64_t timestamp);
+
+void cmos_sensor_acquisition_fanout_retain(cmos_sensor_acquisition_frame *frame);
+void cmos_sensor_acquisition_fanout_release(cmos_sensor_acquisition_frame *frame);
+
+#endif /* __CMOS_SENSOR_ACQUISITION_FANOUT_H__ */
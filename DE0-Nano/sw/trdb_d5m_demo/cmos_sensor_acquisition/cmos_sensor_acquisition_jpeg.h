@@ -0,0 +1,53 @@
+#ifndef __CMOS_SENSOR_ACQUISITION_JPEG_H__
+#define __CMOS_SENSOR_ACQUISITION_JPEG_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cmos_sensor_acquisition.h"
+
+/* Size of a minimum coded unit (4:2:0: 4 luma blocks and 1 block of each chroma component) */
+#define CMOS_SENSOR_ACQUISITION_JPEG_MCU_SIZE   (16)
+
+/* Boundary separating the frames of a multipart MJPEG stream */
+#define CMOS_SENSOR_ACQUISITION_JPEG_MJPEG_BOUNDARY "trdb_d5m_frame"
+
+/* Baseline 4:2:0 JPEG encoder */
+typedef struct cmos_sensor_acquisition_jpeg_encoder {
+    uint32_t                        width;             /* Frame width in pixels */
+    uint32_t                        height;            /* Frame height in pixels */
+    cmos_sensor_input_output_format format;            /* Format of the input pixels */
+    uint8_t                         pix_depth;         /* Depth of each channel for OUTPUT_FORMAT_RGB */
+    size_t                          pixel_size;        /* Size of an input pixel in bytes */
+    uint8_t                         quant[2][64];      /* Luma and chroma quantization tables, natural order */
+    uint32_t                        reciprocal[2][64]; /* 2^16 / divisor, natural order */
+    uint16_t                        divisor[2][64];    /* Quantizer divisors (quant scaled by the DCT's output scale) */
+    uint32_t                        padded_width;      /* Width rounded up to a multiple of the MCU size */
+    uint8_t                         *planes;           /* Y, Cb and Cr rows of the current MCU row, full resolution */
+    uint32_t                        buffered_lines;    /* Lines of the current MCU row received so far */
+    uint32_t                        lines_done;        /* Lines of the frame received so far */
+    int32_t                         dc[3];             /* Last DC coefficient of each component */
+    uint8_t                         *out;              /* Output buffer */
+    size_t                          out_size;          /* Size of the output buffer in bytes */
+    size_t                          out_used;          /* Number of bytes written to the output buffer */
+    uint32_t                        bits;              /* Pending output bits, MSB first */
+    uint32_t                        bit_count;         /* Number of pending output bits */
+    bool                            error;             /* The output buffer was too small */
+} cmos_sensor_acquisition_jpeg_encoder;
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+size_t cmos_sensor_acquisition_jpeg_pixel_size(cmos_sensor_acquisition_dev *dev);
+size_t cmos_sensor_acquisition_jpeg_bound(uint32_t width, uint32_t height);
+
+bool cmos_sensor_acquisition_jpeg_encoder_init(cmos_sensor_acquisition_jpeg_encoder *enc, uint32_t width, uint32_t height, cmos_sensor_input_output_format format, uint8_t pix_depth, size_t pixel_size, uint8_t quality);
+bool cmos_sensor_acquisition_jpeg_encoder_begin(cmos_sensor_acquisition_jpeg_encoder *enc, void *out, size_t out_size);
+bool cmos_sensor_acquisition_jpeg_encoder_push(cmos_sensor_acquisition_jpeg_encoder *enc, const void *rows, size_t pitch_bytes, uint32_t lines);
+size_t cmos_sensor_acquisition_jpeg_encoder_finish(cmos_sensor_acquisition_jpeg_encoder *enc);
+void cmos_sensor_acquisition_jpeg_encoder_destroy(cmos_sensor_acquisition_jpeg_encoder *enc);
+
+size_t cmos_sensor_acquisition_jpeg_mjpeg_part_header(char *buffer, size_t buffer_size, size_t jpeg_size);
+
+#endif /* __CMOS_SENSOR_ACQUISITION_JPEG_H__ */
@@ -14,8 +14,24 @@
 static uint32_t ceil_div(uint32_t x, uint32_t y);
 static uint32_t read_config_reg_irq_flag(cmos_sensor_input_dev *dev);
 static uint32_t read_config_reg_debayer_pattern_flag(cmos_sensor_input_dev *dev);
-static void write_config_reg_irq_flag(cmos_sensor_input_dev *dev, bool irq_enabled);
-static void write_config_reg_debayer_pattern_flag(cmos_sensor_input_dev *dev, cmos_sensor_input_debayer_pattern pattern);
+static uint32_t set_config_reg_irq_flag(uint32_t config_reg, bool irq_enabled);
+static uint32_t set_config_reg_debayer_pattern_flag(uint32_t config_reg, cmos_sensor_input_debayer_pattern pattern);
+static uint32_t read_config_reg_downscale_factor_flag(cmos_sensor_input_dev *dev);
+static uint32_t read_config_reg_downscale_mode_flag(cmos_sensor_input_dev *dev);
+static uint32_t set_config_reg_downscale_factor_flag(uint32_t config_reg, cmos_sensor_input_downscale_factor factor);
+static uint32_t set_config_reg_downscale_mode_flag(uint32_t config_reg, cmos_sensor_input_downscale_mode mode);
+static uint32_t read_config_reg_planar_flag(cmos_sensor_input_dev *dev);
+static uint32_t set_config_reg_planar_flag(uint32_t config_reg, bool planar);
+static uint32_t read_config_reg_depth_mode_flag(cmos_sensor_input_dev *dev);
+static uint32_t set_config_reg_depth_mode_flag(uint32_t config_reg, cmos_sensor_input_depth_mode mode);
+static uint32_t read_config_reg_output_format_flag(cmos_sensor_input_dev *dev);
+static uint32_t set_config_reg_output_format_flag(uint32_t config_reg, cmos_sensor_input_output_format format);
+static uint32_t read_config_reg_compress_flag(cmos_sensor_input_dev *dev);
+static uint32_t set_config_reg_compress_flag(uint32_t config_reg, bool compress);
+static uint32_t downscaled_dimension(uint32_t dimension, cmos_sensor_input_downscale_factor factor);
+static size_t stream_size(cmos_sensor_input_dev *dev, uint32_t frame_width, uint32_t frame_height, uint32_t pix_bits);
+static uint32_t clamp_index(int64_t index, uint32_t count);
+static uint32_t sparse_coord_width(cmos_sensor_input_dev *dev);
 static void write_command_reg_get_frame_info(cmos_sensor_input_dev *dev);
 static void write_command_reg_snapshot(cmos_sensor_input_dev *dev);
 static void write_command_reg_irq_ack(cmos_sensor_input_dev *dev);
@@ -23,6 +39,7 @@ static void write_command_reg_stop_and_reset(cmos_sensor_input_dev *dev);
 static uint32_t read_status_reg_state_flag(cmos_sensor_input_dev *dev);
 static uint32_t read_status_reg_fifo_ovfl_flag(cmos_sensor_input_dev *dev);
 static uint32_t read_status_reg_fifo_fill_level_flag(cmos_sensor_input_dev *dev);
+static uint32_t read_status_reg_cmd_fifo_fill_level_flag(cmos_sensor_input_dev *dev);
 static uint32_t read_frame_info_reg_frame_width_flag(cmos_sensor_input_dev *dev);
 static uint32_t read_frame_info_reg_frame_height_flag(cmos_sensor_input_dev *dev);
 
@@ -67,13 +84,12 @@ static uint32_t read_config_reg_debayer_pattern_flag(cmos_sensor_input_dev *dev)
 }
 
 /*
- * write_config_reg_irq_flag
+ * set_config_reg_irq_flag
  *
- * Enables interrupt generation if irq_enable is true.
- * Disables interrupt generation if irq_enable is false.
+ * Returns config_reg with interrupt generation enabled if irq_enable is true.
+ * Returns config_reg with interrupt generation disabled if irq_enable is false.
  */
-static void write_config_reg_irq_flag(cmos_sensor_input_dev *dev, bool irq_enabled) {
-    uint32_t config_reg = CMOS_SENSOR_INPUT_RD_CONFIG(dev->base);
+static uint32_t set_config_reg_irq_flag(uint32_t config_reg, bool irq_enabled) {
     config_reg &= ~CMOS_SENSOR_INPUT_CONFIG_IRQ_MASK;
 
     if (irq_enabled) {
@@ -82,16 +98,15 @@ static void write_config_reg_irq_flag(cmos_sensor_input_dev *dev, bool irq_enabl
         config_reg |= CMOS_SENSOR_INPUT_CONFIG_IRQ_DISABLE_MASK;
     }
 
-    CMOS_SENSOR_INPUT_WR_CONFIG(dev->base, config_reg);
+    return config_reg;
 }
 
 /*
- * write_config_reg_debayer_pattern_flag
+ * set_config_reg_debayer_pattern_flag
  *
- * Sets the debayering pattern to be used.
+ * Returns config_reg with the debayering pattern set to pattern.
  */
-static void write_config_reg_debayer_pattern_flag(cmos_sensor_input_dev *dev, cmos_sensor_input_debayer_pattern pattern) {
-    uint32_t config_reg = CMOS_SENSOR_INPUT_RD_CONFIG(dev->base);
+static uint32_t set_config_reg_debayer_pattern_flag(uint32_t config_reg, cmos_sensor_input_debayer_pattern pattern) {
     config_reg &= ~CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_MASK;
 
     if (pattern == RGGB) {
@@ -104,7 +119,277 @@ static void write_config_reg_debayer_pattern_flag(cmos_sensor_input_dev *dev, cm
         config_reg |= CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_GBRG_MASK;
     }
 
-    CMOS_SENSOR_INPUT_WR_CONFIG(dev->base, config_reg);
+    return config_reg;
+}
+
+/*
+ * read_config_reg_downscale_factor_flag
+ *
+ * Returns one of the following values depending on the flag contents:
+ *  - CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_1X1
+ *  - CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_2X2
+ *  - CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_4X4
+ */
+static uint32_t read_config_reg_downscale_factor_flag(cmos_sensor_input_dev *dev) {
+    uint32_t config_reg = CMOS_SENSOR_INPUT_RD_CONFIG(dev->base);
+    uint32_t downscale_factor_flag = (config_reg & CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_MASK) >> CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_OFST;
+    return downscale_factor_flag;
+}
+
+/*
+ * read_config_reg_downscale_mode_flag
+ *
+ * Returns CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_DECIMATE if decimation is used.
+ * Returns CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_BIN if binning is used.
+ */
+static uint32_t read_config_reg_downscale_mode_flag(cmos_sensor_input_dev *dev) {
+    uint32_t config_reg = CMOS_SENSOR_INPUT_RD_CONFIG(dev->base);
+    uint32_t downscale_mode_flag = (config_reg & CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_MASK) >> CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_OFST;
+    return downscale_mode_flag;
+}
+
+/*
+ * set_config_reg_downscale_factor_flag
+ *
+ * Returns config_reg with the downscaling factor set to factor.
+ */
+static uint32_t set_config_reg_downscale_factor_flag(uint32_t config_reg, cmos_sensor_input_downscale_factor factor) {
+    config_reg &= ~CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_MASK;
+
+    if (factor == DOWNSCALE_1X1) {
+        config_reg |= CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_1X1_MASK;
+    } else if (factor == DOWNSCALE_2X2) {
+        config_reg |= CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_2X2_MASK;
+    } else if (factor == DOWNSCALE_4X4) {
+        config_reg |= CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_4X4_MASK;
+    }
+
+    return config_reg;
+}
+
+/*
+ * set_config_reg_downscale_mode_flag
+ *
+ * Returns config_reg with the downscaling mode set to mode.
+ */
+static uint32_t set_config_reg_downscale_mode_flag(uint32_t config_reg, cmos_sensor_input_downscale_mode mode) {
+    config_reg &= ~CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_MASK;
+
+    if (mode == DOWNSCALE_DECIMATE) {
+        config_reg |= CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_DECIMATE_MASK;
+    } else if (mode == DOWNSCALE_BIN) {
+        config_reg |= CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_BIN_MASK;
+    }
+
+    return config_reg;
+}
+
+/*
+ * read_config_reg_planar_flag
+ *
+ * Returns CMOS_SENSOR_INPUT_CONFIG_PLANAR_DISABLE if rows are output as is.
+ * Returns CMOS_SENSOR_INPUT_CONFIG_PLANAR_ENABLE if rows are split.
+ */
+static uint32_t read_config_reg_planar_flag(cmos_sensor_input_dev *dev) {
+    uint32_t config_reg = CMOS_SENSOR_INPUT_RD_CONFIG(dev->base);
+    uint32_t planar_flag = (config_reg & CMOS_SENSOR_INPUT_CONFIG_PLANAR_MASK) >> CMOS_SENSOR_INPUT_CONFIG_PLANAR_OFST;
+    return planar_flag;
+}
+
+/*
+ * set_config_reg_planar_flag
+ *
+ * Returns config_reg with row splitting enabled if planar is true.
+ * Returns config_reg with row splitting disabled if planar is false.
+ */
+static uint32_t set_config_reg_planar_flag(uint32_t config_reg, bool planar) {
+    config_reg &= ~CMOS_SENSOR_INPUT_CONFIG_PLANAR_MASK;
+
+    if (planar) {
+        config_reg |= CMOS_SENSOR_INPUT_CONFIG_PLANAR_ENABLE_MASK;
+    } else {
+        config_reg |= CMOS_SENSOR_INPUT_CONFIG_PLANAR_DISABLE_MASK;
+    }
+
+    return config_reg;
+}
+
+/*
+ * read_config_reg_depth_mode_flag
+ *
+ * Returns CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_FULL if samples are not reduced.
+ * Returns CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_SHIFT if samples are shifted.
+ * Returns CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_LUT if samples are looked up.
+ */
+static uint32_t read_config_reg_depth_mode_flag(cmos_sensor_input_dev *dev) {
+    uint32_t config_reg = CMOS_SENSOR_INPUT_RD_CONFIG(dev->base);
+    uint32_t depth_mode_flag = (config_reg & CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_MASK) >> CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_OFST;
+    return depth_mode_flag;
+}
+
+/*
+ * set_config_reg_depth_mode_flag
+ *
+ * Returns config_reg with the pixel depth reduction mode set to mode.
+ */
+static uint32_t set_config_reg_depth_mode_flag(uint32_t config_reg, cmos_sensor_input_depth_mode mode) {
+    config_reg &= ~CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_MASK;
+
+    if (mode == DEPTH_FULL) {
+        config_reg |= CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_FULL_MASK;
+    } else if (mode == DEPTH_SHIFT) {
+        config_reg |= CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_SHIFT_MASK;
+    } else if (mode == DEPTH_LUT) {
+        config_reg |= CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_LUT_MASK;
+    }
+
+    return config_reg;
+}
+
+/*
+ * read_config_reg_output_format_flag
+ *
+ * Returns CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB if pixels are not converted.
+ * Returns CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB565 if pixels are converted to RGB565.
+ * Returns CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB888 if pixels are converted to RGB888.
+ * Returns CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_YCBCR422 if pixels are converted to YCbCr 4:2:2.
+ */
+static uint32_t read_config_reg_output_format_flag(cmos_sensor_input_dev *dev) {
+    uint32_t config_reg = CMOS_SENSOR_INPUT_RD_CONFIG(dev->base);
+    uint32_t output_format_flag = (config_reg & CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_MASK) >> CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_OFST;
+    return output_format_flag;
+}
+
+/*
+ * set_config_reg_output_format_flag
+ *
+ * Returns config_reg with the output color format set to format.
+ */
+static uint32_t set_config_reg_output_format_flag(uint32_t config_reg, cmos_sensor_input_output_format format) {
+    config_reg &= ~CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_MASK;
+
+    if (format == OUTPUT_FORMAT_RGB) {
+        config_reg |= CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB_MASK;
+    } else if (format == OUTPUT_FORMAT_RGB565) {
+        config_reg |= CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB565_MASK;
+    } else if (format == OUTPUT_FORMAT_RGB888) {
+        config_reg |= CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB888_MASK;
+    } else if (format == OUTPUT_FORMAT_YCBCR422) {
+        config_reg |= CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_YCBCR422_MASK;
+    }
+
+    return config_reg;
+}
+
+/*
+ * read_config_reg_compress_flag
+ *
+ * Returns CMOS_SENSOR_INPUT_CONFIG_COMPRESS_DISABLE if the raw stream is output as is.
+ * Returns CMOS_SENSOR_INPUT_CONFIG_COMPRESS_ENABLE if the raw stream is compressed.
+ */
+static uint32_t read_config_reg_compress_flag(cmos_sensor_input_dev *dev) {
+    uint32_t config_reg = CMOS_SENSOR_INPUT_RD_CONFIG(dev->base);
+    uint32_t compress_flag = (config_reg & CMOS_SENSOR_INPUT_CONFIG_COMPRESS_MASK) >> CMOS_SENSOR_INPUT_CONFIG_COMPRESS_OFST;
+    return compress_flag;
+}
+
+/*
+ * set_config_reg_compress_flag
+ *
+ * Returns config_reg with compression enabled if compress is true.
+ * Returns config_reg with compression disabled if compress is false.
+ */
+static uint32_t set_config_reg_compress_flag(uint32_t config_reg, bool compress) {
+    config_reg &= ~CMOS_SENSOR_INPUT_CONFIG_COMPRESS_MASK;
+
+    if (compress) {
+        config_reg |= CMOS_SENSOR_INPUT_CONFIG_COMPRESS_ENABLE_MASK;
+    } else {
+        config_reg |= CMOS_SENSOR_INPUT_CONFIG_COMPRESS_DISABLE_MASK;
+    }
+
+    return config_reg;
+}
+
+/*
+ * downscaled_dimension
+ *
+ * Returns the number of output rows (or columns) produced by the downscaler
+ * for an input frame with the given number of rows (or columns).
+ *
+ * Each block of (2 * f) input rows is reduced to 2 output rows (one Bayer
+ * quad), where f is the downscaling factor. A trailing partial block only
+ * produces an output row for each of its rows that hold the last sample of
+ * their channel in the block.
+ */
+static uint32_t downscaled_dimension(uint32_t dimension, cmos_sensor_input_downscale_factor factor) {
+    uint32_t block = 2;
+
+    if (factor == DOWNSCALE_2X2) {
+        block = 4;
+    } else if (factor == DOWNSCALE_4X4) {
+        block = 8;
+    }
+
+    uint32_t remainder = dimension % block;
+    uint32_t partial = (remainder > block - 2) ? (remainder - (block - 2)) : 0;
+
+    return (dimension / block) * 2 + partial;
+}
+
+/*
+ * stream_size
+ *
+ * Returns the size in bytes of a frame_width x frame_height frame of
+ * pix_bits-bit pixels (3 samples per pixel if debayered, possibly converted to
+ * another color format) once it has gone through the (optional) packer of one
+ * of the unit's output streams.
+ */
+static size_t stream_size(cmos_sensor_input_dev *dev, uint32_t frame_width, uint32_t frame_height, uint32_t pix_bits) {
+    uint32_t frame_total_pixels = frame_width * frame_height;
+    uint32_t num_pixels_in_output_width = 1;
+
+    if (dev->packer_enable) {
+        num_pixels_in_output_width = dev->output_width / pix_bits;
+    }
+
+    uint32_t num_output_width_packets = ceil_div(frame_total_pixels, num_pixels_in_output_width);
+    uint32_t frame_size_in_bytes = num_output_width_packets * (dev->output_width / 8);
+
+    return frame_size_in_bytes;
+}
+
+/*
+ * sparse_coord_width
+ *
+ * Returns the width in bits of the x and y fields of a sparse record, which is
+ * the number of bits needed to represent max(max_width, max_height).
+ */
+static uint32_t sparse_coord_width(cmos_sensor_input_dev *dev) {
+    uint32_t max_dimension = (dev->max_width > dev->max_height) ? dev->max_width : dev->max_height;
+    uint32_t width = 0;
+
+    while ((max_dimension >> width) != 0) {
+        width++;
+    }
+
+    return width;
+}
+
+/*
+ * clamp_index
+ *
+ * Clamps a row (or column) index to [0, count - 1], replicating the edges of
+ * the frame.
+ */
+static uint32_t clamp_index(int64_t index, uint32_t count) {
+    if (index < 0) {
+        return 0;
+    } else if (index >= count) {
+        return count - 1;
+    }
+
+    return (uint32_t) index;
 }
 
 /*
@@ -178,6 +463,17 @@ static uint32_t read_status_reg_fifo_fill_level_flag(cmos_sensor_input_dev *dev)
     return fill_level_flag;
 }
 
+/*
+ * read_status_reg_cmd_fifo_fill_level_flag
+ *
+ * Returns the number of commands waiting in the command fifo.
+ */
+static uint32_t read_status_reg_cmd_fifo_fill_level_flag(cmos_sensor_input_dev *dev) {
+    uint32_t status_reg = CMOS_SENSOR_INPUT_RD_STATUS(dev->base);
+    uint32_t cmd_fill_level_flag = (status_reg & CMOS_SENSOR_INPUT_STATUS_CMD_FIFO_USEDW_MASK) >> CMOS_SENSOR_INPUT_STATUS_CMD_FIFO_USEDW_OFST;
+    return cmd_fill_level_flag;
+}
+
 /*
  * read_frame_info_reg_frame_width_flag
  *
@@ -208,7 +504,7 @@ static uint32_t read_frame_info_reg_frame_height_flag(cmos_sensor_input_dev *dev
  *
  * Constructs a device structure.
  */
-cmos_sensor_input_dev cmos_sensor_input_inst(void *base, uint8_t pix_depth, uint32_t max_width, uint32_t max_height, uint32_t output_width, uint32_t fifo_depth, bool debayer_enable, bool packer_enable) {
+cmos_sensor_input_dev cmos_sensor_input_inst(void *base, uint8_t pix_depth, uint32_t max_width, uint32_t max_height, uint32_t output_width, uint32_t fifo_depth, bool downscaler_enable, bool preview_enable, bool planar_enable, bool depth_reducer_enable, uint8_t reduced_pix_depth, bool debayer_enable, bool color_converter_enable, bool packer_enable, uint8_t stage_count, uint8_t blob_count, bool sparse_enable, bool compressor_enable) {
     cmos_sensor_input_dev dev;
 
     dev.base = base;
@@ -217,8 +513,18 @@ cmos_sensor_input_dev cmos_sensor_input_inst(void *base, uint8_t pix_depth, uint
     dev.max_height = max_height;
     dev.output_width = output_width;
     dev.fifo_depth = fifo_depth;
+    dev.downscaler_enable = downscaler_enable;
+    dev.preview_enable = preview_enable;
+    dev.planar_enable = planar_enable;
+    dev.depth_reducer_enable = depth_reducer_enable;
+    dev.reduced_pix_depth = reduced_pix_depth;
     dev.debayer_enable = debayer_enable;
+    dev.color_converter_enable = color_converter_enable;
     dev.packer_enable = packer_enable;
+    dev.stage_count = stage_count;
+    dev.blob_count = blob_count;
+    dev.sparse_enable = sparse_enable;
+    dev.compressor_enable = compressor_enable;
 
     return dev;
 }
@@ -228,12 +534,26 @@ cmos_sensor_input_dev cmos_sensor_input_inst(void *base, uint8_t pix_depth, uint
  *
  * Initializes the controller.
  *
- * This routine disables interrupts and sets the debayering unit (if enabled) to
- * RGGB mode.
+ * This routine disables interrupts, sets the debayering unit (if enabled) to
+ * RGGB mode, disables downscaling, row splitting, pixel depth reduction and
+ * color format conversion, bypasses all processing stages, and disables blob
+ * detection, sparse output and compression (if enabled).
  */
 void cmos_sensor_input_init(cmos_sensor_input_dev *dev) {
     cmos_sensor_input_command_stop_and_reset(dev);
     cmos_sensor_input_configure(dev, false, RGGB);
+    cmos_sensor_input_configure_downscaler(dev, DOWNSCALE_1X1, DOWNSCALE_DECIMATE);
+    cmos_sensor_input_configure_planar(dev, false);
+    cmos_sensor_input_configure_depth_mode(dev, DEPTH_FULL);
+    cmos_sensor_input_configure_output_format(dev, OUTPUT_FORMAT_RGB);
+
+    for (uint8_t stage = 0; stage < dev->stage_count; stage++) {
+        cmos_sensor_input_configure_stage(dev, stage, false);
+    }
+
+    cmos_sensor_input_configure_blob(dev, 0xffff, false);
+    cmos_sensor_input_configure_sparse(dev, 0xffff, false);
+    cmos_sensor_input_configure_compressor(dev, false);
 }
 
 /*
@@ -246,11 +566,18 @@ void cmos_sensor_input_init(cmos_sensor_input_dev *dev) {
  *
  * The pattern argument sets the debayering pattern to be used by the unit. This
  * argument is only used if debayering is enabled.
+ *
+ * This function does not wait for the controller to be idle. The new
+ * configuration is applied immediately if the controller is idle, and at the
+ * start of the next frame otherwise, so a frame is never processed with a mix
+ * of old and new settings. All fields are written with a single register
+ * access for the same reason.
  */
 void cmos_sensor_input_configure(cmos_sensor_input_dev *dev, bool irq, cmos_sensor_input_debayer_pattern pattern) {
-    cmos_sensor_input_wait_until_idle(dev);
-    write_config_reg_irq_flag(dev, irq);
-    write_config_reg_debayer_pattern_flag(dev, pattern);
+    uint32_t config_reg = CMOS_SENSOR_INPUT_RD_CONFIG(dev->base);
+    config_reg = set_config_reg_irq_flag(config_reg, irq);
+    config_reg = set_config_reg_debayer_pattern_flag(config_reg, pattern);
+    CMOS_SENSOR_INPUT_WR_CONFIG(dev->base, config_reg);
 }
 
 /*
@@ -258,6 +585,9 @@ void cmos_sensor_input_configure(cmos_sensor_input_dev *dev, bool irq, cmos_sens
  *
  * Returns true if interrupt generation is enabled.
  * Returns false if interrupt generation is disabled.
+ *
+ * The value returned is the last one written by cmos_sensor_input_configure(),
+ * which may not have been applied yet if a frame is being processed.
  */
 bool cmos_sensor_input_config_irq_enabled(cmos_sensor_input_dev *dev) {
     return read_config_reg_irq_flag(dev) == CMOS_SENSOR_INPUT_CONFIG_IRQ_ENABLE;
@@ -266,7 +596,7 @@ bool cmos_sensor_input_config_irq_enabled(cmos_sensor_input_dev *dev) {
 /*
  * cmos_sensor_input_config_debayer_pattern
  *
- * Returns the debayering pattern currently used by the unit (if applicable).
+ * Returns the debayering pattern last configured for the unit (if applicable).
  */
 cmos_sensor_input_debayer_pattern cmos_sensor_input_config_debayer_pattern(cmos_sensor_input_dev *dev) {
     uint32_t debayer_pattern = read_config_reg_debayer_pattern_flag(dev);
@@ -284,147 +614,1038 @@ cmos_sensor_input_debayer_pattern cmos_sensor_input_config_debayer_pattern(cmos_
 }
 
 /*
- * cmos_sensor_input_get_frame_info_sync
+ * cmos_sensor_input_configure_downscaler
  *
- * Instructs the controller to analyze a frame and store its properties in
- * internal registers. This function MUST be called before calling
- * cmos_sensor_input_snapshot() to ensure correct functionality.
+ * Configures the Bayer-preserving downscaler, which sits between the sampler
+ * and the debayering unit. The factor selects 1x1 (no downscaling), 2x2 or 4x4
+ * reduction of each Bayer channel, and the mode selects whether the samples of
+ * a channel are averaged (binning) or only one of them is kept (decimation).
  *
- * This function waits until the GET_FRAME_INFO command finishes before
- * returning.
+ * These settings are only used if the downscaler is enabled. As with
+ * cmos_sensor_input_configure(), they are applied at the start of the next
+ * frame if the controller is busy.
  */
-void cmos_sensor_input_command_get_frame_info_sync(cmos_sensor_input_dev *dev) {
-    cmos_sensor_input_wait_until_idle(dev);
-    write_command_reg_get_frame_info(dev);
-    cmos_sensor_input_wait_until_idle(dev);
+void cmos_sensor_input_configure_downscaler(cmos_sensor_input_dev *dev, cmos_sensor_input_downscale_factor factor, cmos_sensor_input_downscale_mode mode) {
+    uint32_t config_reg = CMOS_SENSOR_INPUT_RD_CONFIG(dev->base);
+    config_reg = set_config_reg_downscale_factor_flag(config_reg, factor);
+    config_reg = set_config_reg_downscale_mode_flag(config_reg, mode);
+    CMOS_SENSOR_INPUT_WR_CONFIG(dev->base, config_reg);
 }
 
 /*
- * cmos_sensor_input_get_frame_info_async
- *
- * Instructs the controller to analyze a frame and store its properties in
- * internal registers. This function MUST be called before calling
- * cmos_sensor_input_snapshot() to ensure correct functionality.
+ * cmos_sensor_input_config_downscale_factor
  *
- * This function returns as soon as the command is sent to the controller. It is
- * the caller's responsability to check if the controller is idle before
- * submitting any further commands.
+ * Returns the downscaling factor last configured for the unit. Always returns
+ * DOWNSCALE_1X1 if the downscaler is disabled.
  */
-void cmos_sensor_input_command_get_frame_info_async(cmos_sensor_input_dev *dev) {
-    cmos_sensor_input_wait_until_idle(dev);
-    write_command_reg_get_frame_info(dev);
+cmos_sensor_input_downscale_factor cmos_sensor_input_config_downscale_factor(cmos_sensor_input_dev *dev) {
+    uint32_t downscale_factor = read_config_reg_downscale_factor_flag(dev);
+
+    if (downscale_factor == CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_2X2) {
+        return DOWNSCALE_2X2;
+    } else if (downscale_factor == CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_4X4) {
+        return DOWNSCALE_4X4;
+    } else {
+        /* downscale_factor == CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_1X1 */
+        return DOWNSCALE_1X1;
+    }
 }
 
 /*
- * cmos_sensor_input_snapshot_sync
- *
- * Instructs the controller to capture a frame. You MUST call
- * cmos_sensor_input_get_frame_info() before calling this function to ensure
- * correct functionality.
- *
- * This function waits until the SNAPSHOT command finishes before returning.
+ * cmos_sensor_input_config_downscale_mode
  *
- * Returns true if the fifo did not overflow, and false otherwise.
+ * Returns the downscaling mode last configured for the unit (if applicable).
  */
-bool cmos_sensor_input_command_snapshot_sync(cmos_sensor_input_dev *dev) {
-    cmos_sensor_input_wait_until_idle(dev);
-    write_command_reg_snapshot(dev);
-    return cmos_sensor_input_wait_until_idle(dev);
+cmos_sensor_input_downscale_mode cmos_sensor_input_config_downscale_mode(cmos_sensor_input_dev *dev) {
+    if (read_config_reg_downscale_mode_flag(dev) == CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_BIN) {
+        return DOWNSCALE_BIN;
+    } else {
+        return DOWNSCALE_DECIMATE;
+    }
 }
 
 /*
- * cmos_sensor_input_snapshot_async
+ * cmos_sensor_input_configure_planar
  *
- * Instructs the controller to capture a frame. You MUST call
- * cmos_sensor_input_get_frame_info() before calling this function to ensure
- * correct functionality.
+ * Configures the Bayer plane splitter, which sits after the downscaler on the
+ * raw stream. If planar is true, the pixels of each row are reordered so that
+ * all even columns come first, followed by all odd columns, and each half row
+ * then holds a single Bayer channel. If planar is false, rows are output as is.
  *
- * This function returns as soon as the command is sent to the controller. It is
- * the caller's responsability to check if the fifo overflowed before submitting
- * any further commands.
+ * This setting is only used if the plane splitter is enabled. As with
+ * cmos_sensor_input_configure(), it is applied at the start of the next frame
+ * if the controller is busy.
  */
-void cmos_sensor_input_command_snapshot_async(cmos_sensor_input_dev *dev) {
-    cmos_sensor_input_wait_until_idle(dev);
-    write_command_reg_snapshot(dev);
+void cmos_sensor_input_configure_planar(cmos_sensor_input_dev *dev, bool planar) {
+    uint32_t config_reg = CMOS_SENSOR_INPUT_RD_CONFIG(dev->base);
+    config_reg = set_config_reg_planar_flag(config_reg, planar);
+    CMOS_SENSOR_INPUT_WR_CONFIG(dev->base, config_reg);
 }
 
 /*
- * cmos_sensor_input_irq_ack
+ * cmos_sensor_input_config_planar
  *
- * Instructs the controller to acknowledge any pending interrupts.
+ * Returns true if rows are split into their even and odd columns. Always
+ * returns false if the plane splitter is disabled.
  */
-void cmos_sensor_input_command_irq_ack(cmos_sensor_input_dev *dev) {
-    write_command_reg_irq_ack(dev);
+bool cmos_sensor_input_config_planar(cmos_sensor_input_dev *dev) {
+    return read_config_reg_planar_flag(dev) == CMOS_SENSOR_INPUT_CONFIG_PLANAR_ENABLE;
 }
 
 /*
- * cmos_sensor_input_stop_and_reset
+ * cmos_sensor_input_configure_depth_mode
  *
- * Instructs the controller to halt all operations and to reset all internal
- * units. This function is useful if an operation needs to be stopped midway.
+ * Configures the pixel depth reducer, which sits after the plane splitter on
+ * the raw main stream. DEPTH_SHIFT keeps the reduced_pix_depth most
+ * significant bits of each sample, DEPTH_LUT replaces each sample by its entry
+ * in the table loaded with cmos_sensor_input_load_depth_lut(), and DEPTH_FULL
+ * outputs samples as is. The preview stream is never reduced.
+ *
+ * This setting is only used if the depth reducer is enabled. As with
+ * cmos_sensor_input_configure(), it is applied at the start of the next frame
+ * if the controller is busy.
  */
-void cmos_sensor_input_command_stop_and_reset(cmos_sensor_input_dev *dev) {
-    write_command_reg_stop_and_reset(dev);
+void cmos_sensor_input_configure_depth_mode(cmos_sensor_input_dev *dev, cmos_sensor_input_depth_mode mode) {
+    uint32_t config_reg = CMOS_SENSOR_INPUT_RD_CONFIG(dev->base);
+    config_reg = set_config_reg_depth_mode_flag(config_reg, mode);
+    CMOS_SENSOR_INPUT_WR_CONFIG(dev->base, config_reg);
 }
 
 /*
- * cmos_sensor_input_status_idle
+ * cmos_sensor_input_config_depth_mode
  *
- * Returns true if the controller is idle.
- * Returns false if the controller is busy.
+ * Returns the pixel depth reduction mode last configured for the unit. Always
+ * returns DEPTH_FULL if the depth reducer is disabled.
  */
-bool cmos_sensor_input_status_idle(cmos_sensor_input_dev *dev) {
-    return read_status_reg_state_flag(dev) == CMOS_SENSOR_INPUT_STATUS_STATE_IDLE;
+cmos_sensor_input_depth_mode cmos_sensor_input_config_depth_mode(cmos_sensor_input_dev *dev) {
+    uint32_t depth_mode_flag = read_config_reg_depth_mode_flag(dev);
+
+    if (depth_mode_flag == CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_SHIFT) {
+        return DEPTH_SHIFT;
+    } else if (depth_mode_flag == CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_LUT) {
+        return DEPTH_LUT;
+    } else {
+        return DEPTH_FULL;
+    }
 }
 
 /*
- * cmos_sensor_input_status_fifo_ovfl
+ * cmos_sensor_input_load_depth_lut
  *
- * Returns true if the fifo has overflowed.
- * Returns false if the fifo has not overflowed.
+ * Loads the lookup table used by the depth reducer in DEPTH_LUT mode. lut must
+ * hold (1 << pix_depth) entries, entry i being the reduced value of sample i
+ * (only its reduced_pix_depth least significant bits are used).
+ *
+ * The table is not double-buffered like the CONFIG register, so this function
+ * waits until the controller is idle before loading it.
+ *
+ * Returns false if the depth reducer is disabled, and true otherwise.
  */
-bool cmos_sensor_input_status_fifo_ovfl(cmos_sensor_input_dev *dev) {
-    return read_status_reg_fifo_ovfl_flag(dev) == CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_OVERFLOW;
+bool cmos_sensor_input_load_depth_lut(cmos_sensor_input_dev *dev, const uint16_t *lut) {
+    if (!dev->depth_reducer_enable) {
+        return false;
+    }
+
+    cmos_sensor_input_wait_until_idle(dev);
+
+    for (uint32_t i = 0; i < (1UL << dev->pix_depth); i++) {
+        uint32_t depth_lut_reg = ((i << CMOS_SENSOR_INPUT_DEPTH_LUT_INDEX_OFST) & CMOS_SENSOR_INPUT_DEPTH_LUT_INDEX_MASK) |
+                                 ((((uint32_t) lut[i]) << CMOS_SENSOR_INPUT_DEPTH_LUT_VALUE_OFST) & CMOS_SENSOR_INPUT_DEPTH_LUT_VALUE_MASK);
+        CMOS_SENSOR_INPUT_WR_DEPTH_LUT(dev->base, depth_lut_reg);
+    }
+
+    return true;
 }
 
 /*
- * cmos_sensor_input_status_fifo_fill_level
+ * cmos_sensor_input_output_pix_depth
  *
- * Returns the fill level of the fifo.
+ * Returns the depth of the samples outputted by the unit on its main stream,
+ * which is reduced_pix_depth if the depth reducer is configured to reduce
+ * samples, and pix_depth otherwise.
  */
-uint32_t cmos_sensor_input_status_fifo_fill_level(cmos_sensor_input_dev *dev) {
-    return read_status_reg_fifo_fill_level_flag(dev);
+uint8_t cmos_sensor_input_output_pix_depth(cmos_sensor_input_dev *dev) {
+    if (dev->depth_reducer_enable && cmos_sensor_input_config_depth_mode(dev) != DEPTH_FULL) {
+        return dev->reduced_pix_depth;
+    }
+
+    return dev->pix_depth;
 }
 
 /*
- * cmos_sensor_input_frame_info_frame_width
+ * cmos_sensor_input_configure_output_format
  *
- * Returns the frame width discovered when a GET_FRAME_INFO command was sent.
+ * Configures the output color format converter, which sits between the
+ * debayering unit and the packer. OUTPUT_FORMAT_RGB outputs the debayered
+ * pixels as is (3 * pix_depth bits per pixel), OUTPUT_FORMAT_RGB565 and
+ * OUTPUT_FORMAT_RGB888 reduce them to 16 and 24 bits, and
+ * OUTPUT_FORMAT_YCBCR422 outputs a 16-bit (Y, Cb) or (Y, Cr) pair per pixel,
+ * alternating on every pixel. YCbCr 4:2:2 requires an even frame width.
+ *
+ * This setting is only used if the color converter is enabled. As with
+ * cmos_sensor_input_configure(), it is applied at the start of the next frame
+ * if the controller is busy.
  */
-uint32_t cmos_sensor_input_frame_info_frame_width(cmos_sensor_input_dev *dev) {
-    return read_frame_info_reg_frame_width_flag(dev);
+void cmos_sensor_input_configure_output_format(cmos_sensor_input_dev *dev, cmos_sensor_input_output_format format) {
+    uint32_t config_reg = CMOS_SENSOR_INPUT_RD_CONFIG(dev->base);
+    config_reg = set_config_reg_output_format_flag(config_reg, format);
+    CMOS_SENSOR_INPUT_WR_CONFIG(dev->base, config_reg);
 }
 
 /*
- * cmos_sensor_input_frame_info_frame_height
+ * cmos_sensor_input_config_output_format
  *
- * Returns the frame height discovered when a GET_FRAME_INFO command was sent.
+ * Returns the output color format last configured for the unit. Always returns
+ * OUTPUT_FORMAT_RGB if the color converter is disabled.
  */
-uint32_t cmos_sensor_input_frame_info_frame_height(cmos_sensor_input_dev *dev) {
-    return read_frame_info_reg_frame_height_flag(dev);
+cmos_sensor_input_output_format cmos_sensor_input_config_output_format(cmos_sensor_input_dev *dev) {
+    uint32_t output_format_flag = read_config_reg_output_format_flag(dev);
+
+    if (output_format_flag == CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB565) {
+        return OUTPUT_FORMAT_RGB565;
+    } else if (output_format_flag == CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB888) {
+        return OUTPUT_FORMAT_RGB888;
+    } else if (output_format_flag == CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_YCBCR422) {
+        return OUTPUT_FORMAT_YCBCR422;
+    } else {
+        return OUTPUT_FORMAT_RGB;
+    }
 }
 
 /*
- * cmos_sensor_input_wait_until_idle
+ * cmos_sensor_input_output_pix_bits
  *
- * Waits until the controller is idle.
- *
- * Returns true if the fifo did not overflow.
- * Returns false if the fifo did overflow.
+ * Returns the number of bits of each pixel outputted by the unit on its main
+ * stream: the output sample depth for raw frames, 3 samples for debayered
+ * frames, or the size of the configured color format if the color converter
+ * is active.
  */
-bool cmos_sensor_input_wait_until_idle(cmos_sensor_input_dev *dev) {
-    while (!cmos_sensor_input_status_idle(dev)) {
-        if (cmos_sensor_input_status_fifo_ovfl(dev)) {
+uint32_t cmos_sensor_input_output_pix_bits(cmos_sensor_input_dev *dev) {
+    if (!dev->debayer_enable) {
+        return cmos_sensor_input_output_pix_depth(dev);
+    }
+
+    if (dev->color_converter_enable) {
+        cmos_sensor_input_output_format format = cmos_sensor_input_config_output_format(dev);
+
+        if (format == OUTPUT_FORMAT_RGB565 || format == OUTPUT_FORMAT_YCBCR422) {
+            return 16;
+        } else if (format == OUTPUT_FORMAT_RGB888) {
+            return 24;
+        }
+    }
+
+    return 3 * dev->pix_depth;
+}
+
+/*
+ * cmos_sensor_input_stage_write
+ *
+ * Writes count consecutive parameter words of a processing stage, starting at
+ * parameter word word. The meaning of each word depends on the type of the
+ * stage, except for word CMOS_SENSOR_INPUT_STAGE_CONTROL_WORD which is common
+ * to all stages (see cmos_sensor_input_configure_stage()).
+ *
+ * Stages double-buffer their parameters like the CONFIG register, so they can
+ * be written at any time, and are applied at the start of the next frame if
+ * the controller is busy.
+ *
+ * Returns false if the stage does not exist, and true otherwise.
+ */
+bool cmos_sensor_input_stage_write(cmos_sensor_input_dev *dev, uint8_t stage, uint8_t word, const uint32_t *values, uint32_t count) {
+    if (stage >= dev->stage_count) {
+        return false;
+    }
+
+    /* the word index is incremented by the unit after each write to STAGE_DATA */
+    uint32_t stage_addr_reg = ((((uint32_t) stage) << CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_OFST) & CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_MASK) |
+                              ((((uint32_t) word) << CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_OFST) & CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_MASK);
+    CMOS_SENSOR_INPUT_WR_STAGE_ADDR(dev->base, stage_addr_reg);
+
+    for (uint32_t i = 0; i < count; i++) {
+        CMOS_SENSOR_INPUT_WR_STAGE_DATA(dev->base, values[i]);
+    }
+
+    return true;
+}
+
+/*
+ * cmos_sensor_input_configure_stage
+ *
+ * Enables or bypasses a processing stage. A bypassed stage forwards its input
+ * unmodified. All stages are bypassed after a reset.
+ *
+ * Returns false if the stage does not exist, and true otherwise.
+ */
+bool cmos_sensor_input_configure_stage(cmos_sensor_input_dev *dev, uint8_t stage, bool enable) {
+    uint32_t control_word = enable ? CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_PROCESS_MASK : CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_BYPASS_MASK;
+    return cmos_sensor_input_stage_write(dev, stage, CMOS_SENSOR_INPUT_STAGE_CONTROL_WORD, &control_word, 1);
+}
+
+/*
+ * cmos_sensor_input_configure_stage_gain
+ *
+ * Configures a GAIN processing stage. The offset is first subtracted from each
+ * sample (clamping at 0), and the result is multiplied by gain, an unsigned 8.8
+ * fixed point value (CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_ONE is a gain of 1).
+ * Results are saturated to the maximum sample value.
+ *
+ * The stage must also be enabled with cmos_sensor_input_configure_stage().
+ *
+ * Returns false if the stage does not exist, and true otherwise. The type of
+ * the stage is not checked.
+ */
+bool cmos_sensor_input_configure_stage_gain(cmos_sensor_input_dev *dev, uint8_t stage, uint16_t gain, uint16_t offset) {
+    uint32_t gain_word = ((((uint32_t) gain) << CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_OFST) & CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_MASK) |
+                         ((((uint32_t) offset) << CMOS_SENSOR_INPUT_STAGE_GAIN_OFFSET_OFST) & CMOS_SENSOR_INPUT_STAGE_GAIN_OFFSET_MASK);
+    return cmos_sensor_input_stage_write(dev, stage, CMOS_SENSOR_INPUT_STAGE_GAIN_WORD, &gain_word, 1);
+}
+
+/*
+ * cmos_sensor_input_configure_stage_conv3x3
+ *
+ * Configures a CONV3X3 processing stage, which convolves the raw frame with a
+ * 3x3 kernel. Each output sample is computed as
+ *
+ *   v = (sum of coef[3 * r + c] * p[y + r - 1][x + c - 1]) >> shift
+ *   v = abs ? |v| : v
+ *   out = clamp(v + bias, 0, 2 ^ pix_depth - 1)
+ *
+ * where pixels outside of the frame are replaced by the nearest edge pixel (see
+ * cmos_sensor_input_conv3x3_reference() for the exact arithmetic). Note that
+ * the kernel is applied to the raw bayer frame, so neighbouring samples belong
+ * to different color channels.
+ *
+ * The stage must also be enabled with cmos_sensor_input_configure_stage().
+ *
+ * Returns false if the stage does not exist, and true otherwise. The type of
+ * the stage is not checked.
+ */
+bool cmos_sensor_input_configure_stage_conv3x3(cmos_sensor_input_dev *dev, uint8_t stage, const cmos_sensor_input_conv3x3 *conv) {
+    uint32_t words[CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_COUNT + 1];
+
+    for (uint32_t i = 0; i < CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_COUNT; i++) {
+        words[i] = (((uint32_t) (uint16_t) conv->coef[i]) << CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_OFST) & CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_MASK;
+    }
+
+    /* the POST word directly follows the coefficients */
+    words[CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_COUNT] = ((((uint32_t) conv->shift) << CMOS_SENSOR_INPUT_STAGE_CONV3X3_SHIFT_OFST) & CMOS_SENSOR_INPUT_STAGE_CONV3X3_SHIFT_MASK) |
+                                                        ((((uint32_t) conv->abs) << CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_OFST) & CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_MASK) |
+                                                        ((((uint32_t) (uint16_t) conv->bias) << CMOS_SENSOR_INPUT_STAGE_CONV3X3_BIAS_OFST) & CMOS_SENSOR_INPUT_STAGE_CONV3X3_BIAS_MASK);
+
+    return cmos_sensor_input_stage_write(dev, stage, CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_WORD, words, CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_COUNT + 1);
+}
+
+/*
+ * cmos_sensor_input_conv3x3_preset_kernel
+ *
+ * Returns the parameters of a commonly used CONV3X3 kernel:
+ *
+ *   CONV3X3_IDENTITY : no change (the reset value of the stage).
+ *   CONV3X3_BOX      : 3x3 mean (28 / 256 ~ 1 / 9).
+ *   CONV3X3_SHARPEN  : 5 * centre - 4-neighbours.
+ *   CONV3X3_SOBEL_X  : horizontal gradient magnitude, divided by 4.
+ *   CONV3X3_SOBEL_Y  : vertical gradient magnitude, divided by 4.
+ */
+cmos_sensor_input_conv3x3 cmos_sensor_input_conv3x3_preset_kernel(cmos_sensor_input_conv3x3_preset preset) {
+    cmos_sensor_input_conv3x3 conv = {.coef = {0, 0, 0, 0, 1, 0, 0, 0, 0}, .shift = 0, .abs = false, .bias = 0};
+
+    switch (preset) {
+        case CONV3X3_BOX:
+            conv = (cmos_sensor_input_conv3x3) {.coef = {28, 28, 28, 28, 28, 28, 28, 28, 28}, .shift = 8, .abs = false, .bias = 0};
+            break;
+
+        case CONV3X3_SHARPEN:
+            conv = (cmos_sensor_input_conv3x3) {.coef = {0, -1, 0, -1, 5, -1, 0, -1, 0}, .shift = 0, .abs = false, .bias = 0};
+            break;
+
+        case CONV3X3_SOBEL_X:
+            conv = (cmos_sensor_input_conv3x3) {.coef = {-1, 0, 1, -2, 0, 2, -1, 0, 1}, .shift = 2, .abs = true, .bias = 0};
+            break;
+
+        case CONV3X3_SOBEL_Y:
+            conv = (cmos_sensor_input_conv3x3) {.coef = {-1, -2, -1, 0, 0, 0, 1, 2, 1}, .shift = 2, .abs = true, .bias = 0};
+            break;
+
+        case CONV3X3_IDENTITY:
+        default:
+            break;
+    }
+
+    return conv;
+}
+
+/*
+ * cmos_sensor_input_conv3x3_reference
+ *
+ * Software model of the CONV3X3 processing stage. Convolves the width x height
+ * frame src (one pix_depth-bit sample per element) and stores the result in
+ * dst, which must not overlap src. The output is bit-exact with the stage, and
+ * is used to check it in simulation.
+ */
+void cmos_sensor_input_conv3x3_reference(const uint16_t *src, uint16_t *dst, uint32_t width, uint32_t height, uint8_t pix_depth, const cmos_sensor_input_conv3x3 *conv) {
+    int64_t max_value = (((int64_t) 1) << pix_depth) - 1;
+
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            int64_t sum = 0;
+
+            for (int32_t r = 0; r < 3; r++) {
+                for (int32_t c = 0; c < 3; c++) {
+                    uint32_t sy = clamp_index(((int64_t) y) + r - 1, height);
+                    uint32_t sx = clamp_index(((int64_t) x) + c - 1, width);
+                    sum += ((int64_t) conv->coef[3 * r + c]) * src[sy * width + sx];
+                }
+            }
+
+            /* arithmetic shift (rounds towards minus infinity) */
+            int64_t value = sum >= 0 ? sum >> conv->shift : -((-sum + (((int64_t) 1) << conv->shift) - 1) >> conv->shift);
+
+            if (conv->abs && value < 0) {
+                value = -value;
+            }
+
+            value += conv->bias;
+
+            if (value < 0) {
+                value = 0;
+            } else if (value > max_value) {
+                value = max_value;
+            }
+
+            dst[y * width + x] = (uint16_t) value;
+        }
+    }
+}
+
+/*
+ * cmos_sensor_input_configure_blob
+ *
+ * Configures the blob statistics unit, which runs on the raw frame after the
+ * processing stages. A pixel is considered lit if its value is greater than or
+ * equal to threshold, and statistics are gathered on 8-connected groups of lit
+ * pixels. A threshold larger than the maximum sample value disables detection.
+ *
+ * If stats_only is true, the main stream is not outputted at all: frames are
+ * only analyzed, and snapshots complete as soon as their statistics are
+ * available. The preview stream (if enabled) is not affected.
+ *
+ * As with cmos_sensor_input_configure(), these settings are applied at the
+ * start of the next frame if the controller is busy.
+ *
+ * Returns false if the blob unit is disabled, and true otherwise.
+ */
+bool cmos_sensor_input_configure_blob(cmos_sensor_input_dev *dev, uint16_t threshold, bool stats_only) {
+    if (dev->blob_count == 0) {
+        return false;
+    }
+
+    uint32_t blob_config_reg = ((((uint32_t) threshold) << CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_OFST) & CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_MASK) |
+                               ((stats_only ? 1UL : 0UL) << CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_OFST);
+    CMOS_SENSOR_INPUT_WR_BLOB_CONFIG(dev->base, blob_config_reg);
+
+    return true;
+}
+
+/*
+ * cmos_sensor_input_config_blob_threshold
+ *
+ * Returns the threshold last configured for the blob unit. Returns 0 if the
+ * blob unit is disabled.
+ */
+uint16_t cmos_sensor_input_config_blob_threshold(cmos_sensor_input_dev *dev) {
+    if (dev->blob_count == 0) {
+        return 0;
+    }
+
+    uint32_t blob_config_reg = CMOS_SENSOR_INPUT_RD_BLOB_CONFIG(dev->base);
+    return (uint16_t) ((blob_config_reg & CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_MASK) >> CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_OFST);
+}
+
+/*
+ * cmos_sensor_input_config_blob_stats_only
+ *
+ * Returns true if the main stream is suppressed in favor of the blob
+ * statistics. Always returns false if the blob unit is disabled.
+ */
+bool cmos_sensor_input_config_blob_stats_only(cmos_sensor_input_dev *dev) {
+    if (dev->blob_count == 0) {
+        return false;
+    }
+
+    uint32_t blob_config_reg = CMOS_SENSOR_INPUT_RD_BLOB_CONFIG(dev->base);
+    return (blob_config_reg & CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_MASK) != 0;
+}
+
+/*
+ * cmos_sensor_input_read_blobs
+ *
+ * Reads the statistics of the last complete frame into blobs, which must hold
+ * max_blobs entries. Blobs are reported in the order in which their first run
+ * was seen (top to bottom, left to right). If overflow is not NULL, it is set
+ * to true if some lit pixels did not fit in the blob_count blobs tracked by
+ * the unit, and were ignored.
+ *
+ * The results are only updated at the end of a frame, so they can be read at
+ * any time once a snapshot is finished, even while the next one is running.
+ *
+ * Returns the number of blobs found in the frame, which may be larger than
+ * max_blobs (only the first max_blobs are read). Returns 0 if the blob unit is
+ * disabled.
+ */
+uint32_t cmos_sensor_input_read_blobs(cmos_sensor_input_dev *dev, cmos_sensor_input_blob *blobs, uint32_t max_blobs, bool *overflow) {
+    if (dev->blob_count == 0) {
+        if (overflow != NULL) {
+            *overflow = false;
+        }
+
+        return 0;
+    }
+
+    /* the word index is incremented by the unit after each read of BLOB_DATA */
+    CMOS_SENSOR_INPUT_WR_BLOB_ADDR(dev->base, CMOS_SENSOR_INPUT_BLOB_STATUS_WORD);
+    uint32_t blob_status_word = CMOS_SENSOR_INPUT_RD_BLOB_DATA(dev->base);
+
+    uint32_t count = (blob_status_word & CMOS_SENSOR_INPUT_BLOB_STATUS_COUNT_MASK) >> CMOS_SENSOR_INPUT_BLOB_STATUS_COUNT_OFST;
+
+    if (overflow != NULL) {
+        *overflow = (blob_status_word & CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_MASK) != 0;
+    }
+
+    CMOS_SENSOR_INPUT_WR_BLOB_ADDR(dev->base, CMOS_SENSOR_INPUT_BLOB_RECORD_WORD);
+
+    for (uint32_t i = 0; i < count && i < max_blobs; i++) {
+        uint32_t words[CMOS_SENSOR_INPUT_BLOB_RECORD_SIZE];
+
+        for (uint32_t word = 0; word < CMOS_SENSOR_INPUT_BLOB_RECORD_SIZE; word++) {
+            words[word] = CMOS_SENSOR_INPUT_RD_BLOB_DATA(dev->base);
+        }
+
+        blobs[i].pixels = words[CMOS_SENSOR_INPUT_BLOB_PIXELS_WORD];
+        blobs[i].sum_x = words[CMOS_SENSOR_INPUT_BLOB_SUM_X_WORD];
+        blobs[i].sum_y = words[CMOS_SENSOR_INPUT_BLOB_SUM_Y_WORD];
+        blobs[i].sum_value = words[CMOS_SENSOR_INPUT_BLOB_SUM_VALUE_WORD];
+        blobs[i].x_min = (uint16_t) ((words[CMOS_SENSOR_INPUT_BLOB_X_WORD] & CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_MASK) >> CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_OFST);
+        blobs[i].x_max = (uint16_t) ((words[CMOS_SENSOR_INPUT_BLOB_X_WORD] & CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_MASK) >> CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_OFST);
+        blobs[i].y_min = (uint16_t) ((words[CMOS_SENSOR_INPUT_BLOB_Y_WORD] & CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_MASK) >> CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_OFST);
+        blobs[i].y_max = (uint16_t) ((words[CMOS_SENSOR_INPUT_BLOB_Y_WORD] & CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_MASK) >> CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_OFST);
+    }
+
+    return count;
+}
+
+/*
+ * cmos_sensor_input_configure_sparse
+ *
+ * Configures the sparse output. If enable is true, the main stream only
+ * carries the pixels whose value is greater than or equal to threshold, as one
+ * (x, y, value) record per output word, and each frame is terminated by an end
+ * marker. Records are produced after the plane splitter and the depth reducer,
+ * so x is in split order if planar output is configured, and both value and
+ * threshold are reduced samples if the depth reducer is active. The packer is
+ * bypassed.
+ *
+ * Frames then have a variable length: the Avalon-ST source marks their last
+ * word with endofpacket, and cmos_sensor_input_frame_size() returns the size
+ * of the largest possible frame, which is the size of the buffer to provide.
+ * Use cmos_sensor_input_sparse_decode() to read the records back.
+ *
+ * As with cmos_sensor_input_configure(), these settings are applied at the
+ * start of the next frame if the controller is busy.
+ *
+ * Returns false if the sparse output is disabled, and true otherwise.
+ */
+bool cmos_sensor_input_configure_sparse(cmos_sensor_input_dev *dev, uint16_t threshold, bool enable) {
+    if (!dev->sparse_enable) {
+        return false;
+    }
+
+    uint32_t sparse_config_reg = ((((uint32_t) threshold) << CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_OFST) & CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_MASK) |
+                                 ((enable ? 1UL : 0UL) << CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_OFST);
+    CMOS_SENSOR_INPUT_WR_SPARSE_CONFIG(dev->base, sparse_config_reg);
+
+    return true;
+}
+
+/*
+ * cmos_sensor_input_config_sparse_threshold
+ *
+ * Returns the threshold last configured for the sparse output. Returns 0 if
+ * the sparse output is disabled.
+ */
+uint16_t cmos_sensor_input_config_sparse_threshold(cmos_sensor_input_dev *dev) {
+    if (!dev->sparse_enable) {
+        return 0;
+    }
+
+    uint32_t sparse_config_reg = CMOS_SENSOR_INPUT_RD_SPARSE_CONFIG(dev->base);
+    return (uint16_t) ((sparse_config_reg & CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_MASK) >> CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_OFST);
+}
+
+/*
+ * cmos_sensor_input_config_sparse_enabled
+ *
+ * Returns true if the main stream carries sparse records. Always returns false
+ * if the sparse output is disabled.
+ */
+bool cmos_sensor_input_config_sparse_enabled(cmos_sensor_input_dev *dev) {
+    if (!dev->sparse_enable) {
+        return false;
+    }
+
+    uint32_t sparse_config_reg = CMOS_SENSOR_INPUT_RD_SPARSE_CONFIG(dev->base);
+    return (sparse_config_reg & CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_MASK) != 0;
+}
+
+/*
+ * cmos_sensor_input_sparse_decode
+ *
+ * Decodes the sparse records of a frame written to memory by the unit. buffer
+ * holds size bytes of the main stream, starting at the first word of the
+ * frame. Records are decoded into pixels, which must hold max_pixels entries,
+ * until the end marker is found or the buffer is exhausted. If complete is not
+ * NULL, it is set to true if the end marker was found.
+ *
+ * Each record fills one output word, stored little-endian in memory. From bit
+ * 0 upwards, it holds the pixel value (PIX_DEPTH bits), then x and y
+ * (sparse_coord_width() bits each). The end marker has x and y all ones.
+ *
+ * Returns the number of records found before the end marker, which may be
+ * larger than max_pixels (only the first max_pixels are decoded). Returns 0 if
+ * the sparse output is disabled.
+ */
+uint32_t cmos_sensor_input_sparse_decode(cmos_sensor_input_dev *dev, const void *buffer, size_t size, cmos_sensor_input_sparse_pixel *pixels, uint32_t max_pixels, bool *complete) {
+    if (complete != NULL) {
+        *complete = false;
+    }
+
+    if (!dev->sparse_enable) {
+        return 0;
+    }
+
+    const uint8_t *bytes = (const uint8_t *) buffer;
+    uint32_t word_size = dev->output_width / 8;
+    uint32_t coord_width = sparse_coord_width(dev);
+    uint64_t coord_mask = (1ULL << coord_width) - 1;
+    uint64_t value_mask = (1ULL << dev->pix_depth) - 1;
+    uint32_t count = 0;
+
+    for (size_t ofst = 0; ofst + word_size <= size; ofst += word_size) {
+        /* x and y are always within the low 64 bits of the word */
+        uint64_t record = 0;
+
+        for (uint32_t i = 0; i < word_size && i < sizeof(record); i++) {
+            record |= ((uint64_t) bytes[ofst + i]) << (8 * i);
+        }
+
+        uint64_t x = (record >> dev->pix_depth) & coord_mask;
+        uint64_t y = (record >> (dev->pix_depth + coord_width)) & coord_mask;
+
+        if (x == coord_mask && y == coord_mask) {
+            if (complete != NULL) {
+                *complete = true;
+            }
+
+            break;
+        }
+
+        if (count < max_pixels) {
+            pixels[count].x = (uint16_t) x;
+            pixels[count].y = (uint16_t) y;
+            pixels[count].value = (uint32_t) (record & value_mask);
+        }
+
+        count++;
+    }
+
+    return count;
+}
+
+/*
+ * cmos_sensor_input_configure_compressor
+ *
+ * Configures the lossless compressor, which sits after the depth reducer on
+ * the raw stream. If compress is true, the main stream carries a bitstream of
+ * adaptive Golomb-Rice codes of the horizontal deltas between pixels of the
+ * same Bayer channel instead of the pixels themselves, and the packer is
+ * bypassed. The sparse output takes precedence if both are configured.
+ *
+ * Frames then have a variable length: the Avalon-ST source marks their last
+ * word with endofpacket, and cmos_sensor_input_frame_size() returns the size
+ * of the largest possible frame, which is the size of the buffer to provide.
+ * Use cmos_sensor_input_compressed_decode() to read the pixels back.
+ *
+ * This setting is only used if the compressor is enabled. As with
+ * cmos_sensor_input_configure(), it is applied at the start of the next frame
+ * if the controller is busy.
+ */
+void cmos_sensor_input_configure_compressor(cmos_sensor_input_dev *dev, bool compress) {
+    uint32_t config_reg = CMOS_SENSOR_INPUT_RD_CONFIG(dev->base);
+    config_reg = set_config_reg_compress_flag(config_reg, compress);
+    CMOS_SENSOR_INPUT_WR_CONFIG(dev->base, config_reg);
+}
+
+/*
+ * cmos_sensor_input_config_compressor
+ *
+ * Returns true if the raw stream is compressed. Always returns false if the
+ * compressor is disabled.
+ */
+bool cmos_sensor_input_config_compressor(cmos_sensor_input_dev *dev) {
+    return read_config_reg_compress_flag(dev) == CMOS_SENSOR_INPUT_CONFIG_COMPRESS_ENABLE;
+}
+
+/*
+ * cmos_sensor_input_compressed_size_bound
+ *
+ * Returns the size in bytes of the largest compressed frame_width x
+ * frame_height frame: every pixel costs at most an escape code
+ * (CMOS_SENSOR_INPUT_COMPRESS_ESCAPE_Q + PIX_DEPTH bits), and the last word is
+ * padded. Returns 0 if the compressor is disabled.
+ */
+size_t cmos_sensor_input_compressed_size_bound(cmos_sensor_input_dev *dev, uint32_t frame_width, uint32_t frame_height) {
+    if (!dev->compressor_enable) {
+        return 0;
+    }
+
+    uint64_t bits = (uint64_t) frame_width * frame_height * (CMOS_SENSOR_INPUT_COMPRESS_ESCAPE_Q + dev->pix_depth);
+    uint64_t words = (bits + dev->output_width - 1) / dev->output_width;
+
+    return (size_t) (words * (dev->output_width / 8));
+}
+
+/*
+ * cmos_sensor_input_compressed_decode
+ *
+ * Decodes a compressed frame written to memory by the unit into pixels, which
+ * must hold width * height samples (the output frame dimensions). buffer holds
+ * size bytes of the main stream, starting at the first word of the frame.
+ *
+ * The bitstream is read in memory order, LSB first in each byte: the unit
+ * byte-swaps its output words and the msgdma writes their high-order byte
+ * first, so byte 0 of buffer holds bits 7..0 of the compressor's first word,
+ * whatever OUTPUT_WIDTH is.
+ *
+ * With D = PIX_DEPTH and ESC = CMOS_SENSOR_INPUT_COMPRESS_ESCAPE_Q, each pixel
+ * is coded as q ones and a zero followed by k remainder bits (q < ESC), or as
+ * ESC ones followed by the D-bit zigzagged delta. The delta is taken to the
+ * pixel two columns to the left (the previous one of the same Bayer channel),
+ * or to 2^(D - 1) in the first two columns, and k is derived from a running
+ * average of the deltas of each Bayer channel, exactly as the hardware does
+ * (see cmos_sensor_input_compressor.vhd). Reduced samples are decoded as is if the
+ * depth reducer is active, and columns are in split order if planar output is
+ * configured.
+ *
+ * Returns false if the compressor is disabled or if the buffer ends before the
+ * last pixel, and true otherwise.
+ */
+bool cmos_sensor_input_compressed_decode(cmos_sensor_input_dev *dev, const void *buffer, size_t size, uint16_t *pixels, uint32_t width, uint32_t height) {
+    if (!dev->compressor_enable) {
+        return false;
+    }
+
+    const uint8_t *bytes = (const uint8_t *) buffer;
+    const uint8_t *bytes_end = bytes + size;
+    uint32_t depth = dev->pix_depth;
+    uint32_t pix_mask = (1UL << depth) - 1;
+    uint32_t mid = 1UL << (depth - 1);
+    uint32_t acc[4] = {0, 0, 0, 0};
+
+    /* bits are consumed from the bottom of bit_buffer, bit_count of them are valid */
+    uint64_t bit_buffer = 0;
+    uint32_t bit_count = 0;
+
+    for (uint32_t y = 0; y < height; y++) {
+        uint16_t *row = pixels + (size_t) y * width;
+        uint32_t *row_acc = acc + 2 * (y & 1);
+
+        for (uint32_t x = 0; x < width; x++) {
+            /* an escape code is the longest, at ESC + D <= 24 bits */
+            if (bit_count < CMOS_SENSOR_INPUT_COMPRESS_ESCAPE_Q + depth) {
+                while (bit_count <= 56 && bytes < bytes_end) {
+                    bit_buffer |= ((uint64_t) *bytes++) << bit_count;
+                    bit_count += 8;
+                }
+            }
+
+            uint32_t *ctx_acc = row_acc + (x & 1);
+            uint32_t scaled_acc = *ctx_acc >> (CMOS_SENSOR_INPUT_COMPRESS_ACC_SHIFT + 1);
+            uint32_t k = (scaled_acc == 0) ? 0 : 32 - __builtin_clz(scaled_acc);
+
+            if (k > depth - 1) {
+                k = depth - 1;
+            }
+
+            /* number of leading ones of the code, capped at ESC */
+            uint32_t q = __builtin_ctzll(~bit_buffer | (1ULL << CMOS_SENSOR_INPUT_COMPRESS_ESCAPE_Q));
+            uint32_t len;
+            uint32_t u;
+
+            if (q < CMOS_SENSOR_INPUT_COMPRESS_ESCAPE_Q) {
+                len = q + 1 + k;
+                u = (q << k) | ((uint32_t) (bit_buffer >> (q + 1)) & ((1UL << k) - 1));
+            } else {
+                len = CMOS_SENSOR_INPUT_COMPRESS_ESCAPE_Q + depth;
+                u = (uint32_t) (bit_buffer >> CMOS_SENSOR_INPUT_COMPRESS_ESCAPE_Q) & pix_mask;
+            }
+
+            if (len > bit_count) {
+                return false;
+            }
+
+            bit_buffer >>= len;
+            bit_count -= len;
+
+            *ctx_acc = *ctx_acc - (*ctx_acc >> CMOS_SENSOR_INPUT_COMPRESS_ACC_SHIFT) + u;
+
+            /* inverse zigzag, then the delta is added modulo 2^D */
+            uint32_t pred = (x < 2) ? mid : row[x - 2];
+            uint32_t delta = (u >> 1) ^ (0 - (u & 1));
+            row[x] = (uint16_t) ((pred + delta) & pix_mask);
+        }
+    }
+
+    return true;
+}
+
+/*
+ * cmos_sensor_input_get_frame_info_sync
+ *
+ * Instructs the controller to analyze a frame and store its properties in
+ * internal registers. This function MUST be called before calling
+ * cmos_sensor_input_snapshot() to ensure correct functionality.
+ *
+ * This function waits until the GET_FRAME_INFO command finishes before
+ * returning.
+ */
+void cmos_sensor_input_command_get_frame_info_sync(cmos_sensor_input_dev *dev) {
+    cmos_sensor_input_wait_until_idle(dev);
+    write_command_reg_get_frame_info(dev);
+    cmos_sensor_input_wait_until_idle(dev);
+}
+
+/*
+ * cmos_sensor_input_get_frame_info_async
+ *
+ * Instructs the controller to analyze a frame and store its properties in
+ * internal registers. This function MUST be called before calling
+ * cmos_sensor_input_snapshot() to ensure correct functionality.
+ *
+ * This function returns as soon as the command is sent to the controller. It is
+ * the caller's responsability to check if the controller is idle before
+ * submitting any further commands.
+ */
+void cmos_sensor_input_command_get_frame_info_async(cmos_sensor_input_dev *dev) {
+    cmos_sensor_input_wait_until_idle(dev);
+    write_command_reg_get_frame_info(dev);
+}
+
+/*
+ * cmos_sensor_input_snapshot_sync
+ *
+ * Instructs the controller to capture a frame. You MUST call
+ * cmos_sensor_input_get_frame_info() before calling this function to ensure
+ * correct functionality.
+ *
+ * This function waits until the SNAPSHOT command finishes before returning.
+ *
+ * Returns true if the fifo did not overflow, and false otherwise.
+ */
+bool cmos_sensor_input_command_snapshot_sync(cmos_sensor_input_dev *dev) {
+    cmos_sensor_input_wait_until_idle(dev);
+    write_command_reg_snapshot(dev);
+    return cmos_sensor_input_wait_until_idle(dev);
+}
+
+/*
+ * cmos_sensor_input_snapshot_async
+ *
+ * Instructs the controller to capture a frame. You MUST call
+ * cmos_sensor_input_get_frame_info() before calling this function to ensure
+ * correct functionality.
+ *
+ * This function returns as soon as the command is sent to the controller. It is
+ * the caller's responsability to check if the fifo overflowed before submitting
+ * any further commands.
+ */
+void cmos_sensor_input_command_snapshot_async(cmos_sensor_input_dev *dev) {
+    cmos_sensor_input_wait_until_idle(dev);
+    write_command_reg_snapshot(dev);
+}
+
+/*
+ * cmos_sensor_input_command_get_frame_info_enqueue
+ *
+ * Queues a GET_FRAME_INFO command in the controller's command fifo without
+ * waiting for the controller to be idle. The command is started as soon as all
+ * previously queued commands have finished.
+ *
+ * Returns true if the command was queued.
+ * Returns false if the command fifo was full (the command is not sent).
+ */
+bool cmos_sensor_input_command_get_frame_info_enqueue(cmos_sensor_input_dev *dev) {
+    if (cmos_sensor_input_status_cmd_fifo_full(dev)) {
+        return false;
+    }
+
+    write_command_reg_get_frame_info(dev);
+    return true;
+}
+
+/*
+ * cmos_sensor_input_command_snapshot_enqueue
+ *
+ * Queues a SNAPSHOT command in the controller's command fifo without waiting
+ * for the controller to be idle. The capture starts on the first frame that
+ * begins after all previously queued commands have finished, which allows
+ * back-to-back captures to be posted ahead of time.
+ *
+ * Returns true if the command was queued.
+ * Returns false if the command fifo was full (the command is not sent).
+ */
+bool cmos_sensor_input_command_snapshot_enqueue(cmos_sensor_input_dev *dev) {
+    if (cmos_sensor_input_status_cmd_fifo_full(dev)) {
+        return false;
+    }
+
+    write_command_reg_snapshot(dev);
+    return true;
+}
+
+/*
+ * cmos_sensor_input_irq_ack
+ *
+ * Instructs the controller to acknowledge any pending interrupts.
+ */
+void cmos_sensor_input_command_irq_ack(cmos_sensor_input_dev *dev) {
+    write_command_reg_irq_ack(dev);
+}
+
+/*
+ * cmos_sensor_input_stop_and_reset
+ *
+ * Instructs the controller to halt all operations and to reset all internal
+ * units. This function is useful if an operation needs to be stopped midway.
+ */
+void cmos_sensor_input_command_stop_and_reset(cmos_sensor_input_dev *dev) {
+    write_command_reg_stop_and_reset(dev);
+}
+
+/*
+ * cmos_sensor_input_status_idle
+ *
+ * Returns true if the controller is idle.
+ * Returns false if the controller is busy.
+ */
+bool cmos_sensor_input_status_idle(cmos_sensor_input_dev *dev) {
+    return read_status_reg_state_flag(dev) == CMOS_SENSOR_INPUT_STATUS_STATE_IDLE;
+}
+
+/*
+ * cmos_sensor_input_status_fifo_ovfl
+ *
+ * Returns true if the fifo has overflowed.
+ * Returns false if the fifo has not overflowed.
+ */
+bool cmos_sensor_input_status_fifo_ovfl(cmos_sensor_input_dev *dev) {
+    return read_status_reg_fifo_ovfl_flag(dev) == CMOS_SENSOR_INPUT_STATUS_FIFO_OVFL_OVERFLOW;
+}
+
+/*
+ * cmos_sensor_input_status_fifo_fill_level
+ *
+ * Returns the fill level of the fifo.
+ */
+uint32_t cmos_sensor_input_status_fifo_fill_level(cmos_sensor_input_dev *dev) {
+    return read_status_reg_fifo_fill_level_flag(dev);
+}
+
+/*
+ * cmos_sensor_input_status_cmd_fifo_fill_level
+ *
+ * Returns the number of commands waiting in the command fifo.
+ */
+uint32_t cmos_sensor_input_status_cmd_fifo_fill_level(cmos_sensor_input_dev *dev) {
+    return read_status_reg_cmd_fifo_fill_level_flag(dev);
+}
+
+/*
+ * cmos_sensor_input_status_cmd_fifo_full
+ *
+ * Returns true if no further command can be queued.
+ * Returns false if at least one more command can be queued.
+ */
+bool cmos_sensor_input_status_cmd_fifo_full(cmos_sensor_input_dev *dev) {
+    return cmos_sensor_input_status_cmd_fifo_fill_level(dev) >= CMOS_SENSOR_INPUT_CMD_FIFO_DEPTH;
+}
+
+/*
+ * cmos_sensor_input_frame_info_frame_width
+ *
+ * Returns the frame width discovered when a GET_FRAME_INFO command was sent.
+ */
+uint32_t cmos_sensor_input_frame_info_frame_width(cmos_sensor_input_dev *dev) {
+    return read_frame_info_reg_frame_width_flag(dev);
+}
+
+/*
+ * cmos_sensor_input_frame_info_frame_height
+ *
+ * Returns the frame height discovered when a GET_FRAME_INFO command was sent.
+ */
+uint32_t cmos_sensor_input_frame_info_frame_height(cmos_sensor_input_dev *dev) {
+    return read_frame_info_reg_frame_height_flag(dev);
+}
+
+/*
+ * cmos_sensor_input_output_frame_width
+ *
+ * Returns the width of the frames outputted by the unit on its main stream,
+ * which is the frame width discovered by GET_FRAME_INFO reduced by the
+ * configured downscaling factor. If the preview stream is enabled, the
+ * downscaled frames are sent to the preview stream instead and the main stream
+ * keeps the full resolution.
+ */
+uint32_t cmos_sensor_input_output_frame_width(cmos_sensor_input_dev *dev) {
+    uint32_t frame_width = cmos_sensor_input_frame_info_frame_width(dev);
+
+    if (dev->preview_enable) {
+        return frame_width;
+    }
+
+    return downscaled_dimension(frame_width, cmos_sensor_input_config_downscale_factor(dev));
+}
+
+/*
+ * cmos_sensor_input_output_frame_height
+ *
+ * Returns the height of the frames outputted by the unit on its main stream,
+ * which is the frame height discovered by GET_FRAME_INFO reduced by the
+ * configured downscaling factor. If the preview stream is enabled, the
+ * downscaled frames are sent to the preview stream instead and the main stream
+ * keeps the full resolution.
+ */
+uint32_t cmos_sensor_input_output_frame_height(cmos_sensor_input_dev *dev) {
+    uint32_t frame_height = cmos_sensor_input_frame_info_frame_height(dev);
+
+    if (dev->preview_enable) {
+        return frame_height;
+    }
+
+    return downscaled_dimension(frame_height, cmos_sensor_input_config_downscale_factor(dev));
+}
+
+/*
+ * cmos_sensor_input_wait_until_idle
+ *
+ * Waits until the controller is idle and its command fifo is empty.
+ *
+ * Returns true if the fifo did not overflow.
+ * Returns false if the fifo did overflow.
+ */
+bool cmos_sensor_input_wait_until_idle(cmos_sensor_input_dev *dev) {
+    while (!cmos_sensor_input_status_idle(dev)) {
+        if (cmos_sensor_input_status_fifo_ovfl(dev)) {
             return false;
         }
     }
@@ -436,28 +1657,106 @@ bool cmos_sensor_input_wait_until_idle(cmos_sensor_input_dev *dev) {
  * cmos_sensor_input_frame_size
  *
  * Returns the total size of a frame in bytes outputted by the cmos_sensor_input
- * unit in its current configuration.
+ * unit in its current configuration. Pixels are counted with their reduced
+ * depth or converted format if the depth reducer or color converter is active.
+ * Returns 0 if the main stream is suppressed by the blob unit's stats-only
+ * mode. If the sparse output is configured, returns the size of the largest
+ * possible frame: one record per pixel, plus the end marker. If the compressor
+ * is configured, returns cmos_sensor_input_compressed_size_bound().
+ *
+ * This function does not wait for queued commands: it reads the CONFIG
+ * register and the frame dimensions found by the last completed
+ * GET_FRAME_INFO.
  */
 size_t cmos_sensor_input_frame_size(cmos_sensor_input_dev *dev) {
-    cmos_sensor_input_wait_until_idle(dev);
+    if (cmos_sensor_input_config_blob_stats_only(dev)) {
+        return 0;
+    }
+
+    uint32_t frame_width = cmos_sensor_input_output_frame_width(dev);
+    uint32_t frame_height = cmos_sensor_input_output_frame_height(dev);
+
+    if (cmos_sensor_input_config_sparse_enabled(dev)) {
+        return ((size_t) frame_width * frame_height + 1) * (dev->output_width / 8);
+    }
+
+    if (cmos_sensor_input_config_compressor(dev)) {
+        return cmos_sensor_input_compressed_size_bound(dev, frame_width, frame_height);
+    }
+
+    return stream_size(dev, frame_width, frame_height, cmos_sensor_input_output_pix_bits(dev));
+}
+
+/*
+ * cmos_sensor_input_strip_size
+ *
+ * Returns the size in bytes of a strip of the given number of lines of the
+ * frames outputted by the unit on its main stream. A strip ends exactly on a
+ * line boundary if (lines * frame width) is a multiple of the number of pixels
+ * packed in an output word (always the case if the packer is disabled).
+ * Returns 0 in the blob unit's stats-only mode, and if the sparse output or
+ * the compressor is configured (records and codes are not aligned on lines).
+ * As cmos_sensor_input_frame_size(), does not wait for queued commands.
+ */
+size_t cmos_sensor_input_strip_size(cmos_sensor_input_dev *dev, uint32_t lines) {
+    if (cmos_sensor_input_config_blob_stats_only(dev) || cmos_sensor_input_config_sparse_enabled(dev) || cmos_sensor_input_config_compressor(dev)) {
+        return 0;
+    }
+
+    uint32_t frame_width = cmos_sensor_input_output_frame_width(dev);
+
+    return stream_size(dev, frame_width, lines, cmos_sensor_input_output_pix_bits(dev));
+}
+
+/*
+ * cmos_sensor_input_preview_frame_width
+ *
+ * Returns the width of the frames outputted by the unit on its preview stream,
+ * which is the frame width discovered by GET_FRAME_INFO reduced by the
+ * configured downscaling factor. Returns 0 if the preview stream is disabled.
+ */
+uint32_t cmos_sensor_input_preview_frame_width(cmos_sensor_input_dev *dev) {
+    if (!dev->preview_enable) {
+        return 0;
+    }
 
     uint32_t frame_width = cmos_sensor_input_frame_info_frame_width(dev);
+    return downscaled_dimension(frame_width, cmos_sensor_input_config_downscale_factor(dev));
+}
+
+/*
+ * cmos_sensor_input_preview_frame_height
+ *
+ * Returns the height of the frames outputted by the unit on its preview
+ * stream, which is the frame height discovered by GET_FRAME_INFO reduced by
+ * the configured downscaling factor. Returns 0 if the preview stream is
+ * disabled.
+ */
+uint32_t cmos_sensor_input_preview_frame_height(cmos_sensor_input_dev *dev) {
+    if (!dev->preview_enable) {
+        return 0;
+    }
+
     uint32_t frame_height = cmos_sensor_input_frame_info_frame_height(dev);
-    uint32_t frame_total_pixels = frame_width * frame_height;
-    uint32_t num_pixels_in_output_width = 0;
+    return downscaled_dimension(frame_height, cmos_sensor_input_config_downscale_factor(dev));
+}
 
-    if (!dev->debayer_enable && !dev->packer_enable) {
-        num_pixels_in_output_width = 1;
-    } else if (!dev->debayer_enable && dev->packer_enable) {
-        num_pixels_in_output_width = dev->output_width / dev->pix_depth;
-    } else if (dev->debayer_enable && !dev->packer_enable) {
-        num_pixels_in_output_width = 1;
-    } else if (dev->debayer_enable && dev->packer_enable) {
-        num_pixels_in_output_width = dev->output_width / (3 * dev->pix_depth);
+/*
+ * cmos_sensor_input_preview_frame_size
+ *
+ * Returns the total size of a frame in bytes outputted by the cmos_sensor_input
+ * unit on its preview stream in its current configuration. The preview stream
+ * always carries raw Bayer samples (it bypasses the debayering unit), but is
+ * packed if the packer is enabled. Returns 0 if the preview stream is disabled.
+ * As cmos_sensor_input_frame_size(), does not wait for queued commands.
+ */
+size_t cmos_sensor_input_preview_frame_size(cmos_sensor_input_dev *dev) {
+    if (!dev->preview_enable) {
+        return 0;
     }
 
-    uint32_t num_output_width_packets = ceil_div(frame_total_pixels, num_pixels_in_output_width);
-    uint32_t frame_size_in_bytes = num_output_width_packets * (dev->output_width / 8);
+    uint32_t frame_width = cmos_sensor_input_preview_frame_width(dev);
+    uint32_t frame_height = cmos_sensor_input_preview_frame_height(dev);
 
-    return frame_size_in_bytes;
+    return stream_size(dev, frame_width, frame_height, dev->pix_depth);
 }
@@ -3,11 +3,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "cmos_sensor_acquisition_frame_pool.h"
 #include "trdb_d5m.h"
 #include "system.h"
 
 #define I2C_FREQ (50000000) /* 50 MHz */
 
+#define NUM_FRAMES (1)
+
 #define TRDB_D5M_COLUMN_SIZE_REG_DATA (2559)
 #define TRDB_D5M_ROW_SIZE_REG_DATA    (1919)
 #define TRDB_D5M_ROW_BIN_REG_DATA     (3)
@@ -115,12 +118,15 @@ int main(void) {
      * allocate frame memory
      */
     size_t frame_size = trdb_d5m_frame_size(&trdb_d5m);
-    void *frame = calloc(frame_size, 1);
-    if (!frame) {
+    size_t frame_alignment = cmos_sensor_acquisition_frame_pool_alignment(&trdb_d5m.cmos_sensor_acquisition);
+    cmos_sensor_acquisition_frame_pool frame_pool;
+    if (!cmos_sensor_acquisition_frame_pool_init(&frame_pool, frame_size, NUM_FRAMES, frame_alignment, false)) {
         printf("Error: could not allocate memory for frame\n");
         return EXIT_FAILURE;
     }
 
+    void *frame = cmos_sensor_acquisition_frame_pool_acquire(&frame_pool);
+
     /*
      * take snapshot
      */
@@ -129,6 +135,8 @@ int main(void) {
         return EXIT_FAILURE;
     }
 
+    cmos_sensor_acquisition_frame_pool_dma_done(&frame_pool, frame, frame_size);
+
     /*
      * write image to host
      */
@@ -139,5 +147,8 @@ int main(void) {
         return EXIT_FAILURE;
     }
 
+    cmos_sensor_acquisition_frame_pool_release(&frame_pool, frame);
+    cmos_sensor_acquisition_frame_pool_destroy(&frame_pool);
+
     return EXIT_SUCCESS;
 }
@@ -21,8 +21,18 @@ trdb_d5m_dev trdb_d5m_inst(void     *cmos_sensor_acquisition_cmos_sensor_input_b
                            uint32_t cmos_sensor_acquisition_cmos_sensor_Input_max_height,
                            uint32_t cmos_sensor_acquisition_cmos_sensor_input_output_width,
                            uint32_t cmos_sensor_acquisition_cmos_sensor_input_fifo_depth,
+                           bool     cmos_sensor_acquisition_cmos_sensor_input_downscaler_enable,
+                           bool     cmos_sensor_acquisition_cmos_sensor_input_preview_enable,
+                           bool     cmos_sensor_acquisition_cmos_sensor_input_planar_enable,
+                           bool     cmos_sensor_acquisition_cmos_sensor_input_depth_reducer_enable,
+                           uint8_t  cmos_sensor_acquisition_cmos_sensor_input_reduced_pix_depth,
                            bool     cmos_sensor_acquisition_cmos_sensor_input_debayer_enable,
+                           bool     cmos_sensor_acquisition_cmos_sensor_input_color_converter_enable,
                            bool     cmos_sensor_acquisition_cmos_sensor_input_pack_enable,
+                           uint8_t  cmos_sensor_acquisition_cmos_sensor_input_stage_count,
+                           uint8_t  cmos_sensor_acquisition_cmos_sensor_input_blob_count,
+                           bool     cmos_sensor_acquisition_cmos_sensor_input_sparse_enable,
+                           bool     cmos_sensor_acquisition_cmos_sensor_input_compressor_enable,
                            void     *cmos_sensor_acquisiton_sgdma_csr_base,
                            void     *cmos_sensor_acquisiton_sgdma_descriptor_base,
                            uint32_t cmos_sensor_acquisition_msgdma_descriptor_fifo_depth,
@@ -51,8 +61,18 @@ trdb_d5m_dev trdb_d5m_inst(void     *cmos_sensor_acquisition_cmos_sensor_input_b
                       prefix_cmos_sensor_input ## _MAX_HEIGHT,                  \
                       prefix_cmos_sensor_input ## _OUTPUT_WIDTH,                \
                       prefix_cmos_sensor_input ## _FIFO_DEPTH,                  \
+                      prefix_cmos_sensor_input ## _DOWNSCALER_ENABLE,           \
+                      prefix_cmos_sensor_input ## _PREVIEW_ENABLE,              \
+                      prefix_cmos_sensor_input ## _PLANAR_ENABLE,               \
+                      prefix_cmos_sensor_input ## _DEPTH_REDUCER_ENABLE,        \
+                      prefix_cmos_sensor_input ## _REDUCED_PIX_DEPTH,           \
                       prefix_cmos_sensor_input ## _DEBAYER_ENABLE,              \
+                      prefix_cmos_sensor_input ## _COLOR_CONVERTER_ENABLE,      \
                       prefix_cmos_sensor_input ## _PACKER_ENABLE,               \
+                      prefix_cmos_sensor_input ## _STAGE_COUNT,                 \
+                      prefix_cmos_sensor_input ## _BLOB_COUNT,                  \
+                      prefix_cmos_sensor_input ## _SPARSE_ENABLE,               \
+                      prefix_cmos_sensor_input ## _COMPRESSOR_ENABLE,           \
                       ((void *) prefix_msgdma ## _CSR_BASE),                    \
                       ((void *) prefix_msgdma ## _DESCRIPTOR_SLAVE_BASE),       \
                       prefix_msgdma ## _DESCRIPTOR_SLAVE_DESCRIPTOR_FIFO_DEPTH, \
@@ -80,8 +100,18 @@ bool trdb_d5m_configure(trdb_d5m_dev *dev,
 bool trdb_d5m_write(trdb_d5m_dev *trdb_d5m, uint8_t register_offset, uint16_t data);
 bool trdb_d5m_read(trdb_d5m_dev *trdb_d5m, uint8_t register_offset, uint16_t *data);
 bool trdb_d5m_snapshot(trdb_d5m_dev *dev, void *frame, size_t frame_size);
+bool trdb_d5m_snapshot_enqueue(trdb_d5m_dev *dev, void *frame, size_t frame_size);
+uint32_t trdb_d5m_snapshot_pending(trdb_d5m_dev *dev);
+bool trdb_d5m_wait_snapshots(trdb_d5m_dev *dev);
 size_t trdb_d5m_frame_size(trdb_d5m_dev *dev);
 uint32_t trdb_d5m_frame_width(trdb_d5m_dev *dev);
 uint32_t trdb_d5m_frame_height(trdb_d5m_dev *dev);
+bool trdb_d5m_snapshot_pitched(trdb_d5m_dev *dev, void *base, size_t pitch);
+size_t trdb_d5m_strip_size(trdb_d5m_dev *dev, uint32_t lines);
+bool trdb_d5m_snapshot_strips(trdb_d5m_dev *dev, void *ring, uint32_t ring_strips, size_t strip_size, cmos_sensor_acquisition_strip_callback callback, void *context);
+bool trdb_d5m_snapshot_dual(trdb_d5m_dev *dev, void *frame, size_t frame_size, void *preview, size_t preview_size);
+size_t trdb_d5m_preview_frame_size(trdb_d5m_dev *dev);
+uint32_t trdb_d5m_preview_frame_width(trdb_d5m_dev *dev);
+uint32_t trdb_d5m_preview_frame_height(trdb_d5m_dev *dev);
 
 #endif /* __TRDB_D5M_H__ */
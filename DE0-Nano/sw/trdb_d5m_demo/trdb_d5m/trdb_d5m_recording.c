@@ -0,0 +1,635 @@
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "trdb_d5m_recording.h"
+#include "trdb_d5m_regs.h"
+
+/*
+ * File layout (all fields little-endian, every block starts at a multiple of
+ * the alignment recorded in the file header):
+ *
+ *   file header   magic "TD5MREC\0", version (4 bytes), alignment (4 bytes),
+ *                 timestamp frequency (8 bytes), record header size (4 bytes),
+ *                 reserved (4 bytes), padded to the alignment
+ *   frames        one record per frame: a record header (see
+ *                 FRAME_* offsets below) padded to the alignment, then the
+ *                 payload padded to the alignment
+ *   index         magic "INDX", frame count (4 bytes), then one entry per
+ *                 frame: record offset (8 bytes), timestamp (8 bytes),
+ *                 sequence (4 bytes), reserved (4 bytes)
+ *   footer        magic "TD5MEND\0", index offset (8 bytes), frame count (4
+ *                 bytes), version (4 bytes), reserved (8 bytes)
+ *
+ * The footer is the last 32 bytes of the file, and the index is zero padded so
+ * that the footer ends on an alignment boundary. A recording which was never
+ * closed has no index nor footer, but its frames can still be found by walking
+ * the records from the first one.
+ */
+#define FILE_MAGIC             "TD5MREC\0"
+#define FRAME_MAGIC            "FRME"
+#define INDEX_MAGIC            "INDX"
+#define FOOTER_MAGIC           "TD5MEND\0"
+
+#define FRAME_MAGIC_OFST       (0)
+#define FRAME_HEADER_SIZE_OFST (4)
+#define FRAME_SEQUENCE_OFST    (8)
+#define FRAME_FORMAT_OFST      (12)
+#define FRAME_TIMESTAMP_OFST   (16)
+#define FRAME_PAYLOAD_OFST     (24)
+#define FRAME_WIDTH_OFST       (32)
+#define FRAME_HEIGHT_OFST      (36)
+#define FRAME_PIX_DEPTH_OFST   (40)
+#define FRAME_PATTERN_OFST     (41)
+#define FRAME_REG_COUNT_OFST   (42)
+#define FRAME_EXPOSURE_OFST    (44)
+#define FRAME_GAINS_OFST       (48) /* green 1, blue, red, green 2, global (2 bytes each) */
+#define FRAME_REGISTERS_OFST   (64) /* offset (1 byte), reserved (1 byte), value (2 bytes) per register */
+
+#define INDEX_HEADER_SIZE      (8)
+
+/* Registers saved with each frame */
+static const uint8_t recorded_registers[] = {
+    TRDB_D5M_ROW_START_REG,
+    TRDB_D5M_COLUMN_START_REG,
+    TRDB_D5M_ROW_SIZE_REG,
+    TRDB_D5M_COLUMN_SIZE_REG,
+    TRDB_D5M_HORIZONTAL_BLANK_REG,
+    TRDB_D5M_VERTICAL_BLANK_REG,
+    TRDB_D5M_OUTPUT_CONTROL_REG,
+    TRDB_D5M_SHUTTER_WIDTH_UPPER_REG,
+    TRDB_D5M_SHUTTER_WIDTH_LOWER_REG,
+    TRDB_D5M_PIXEL_CLOCK_CONTROL_REG,
+    TRDB_D5M_SHUTTER_DELAY_REG,
+    TRDB_D5M_PLL_CONTROL_REG,
+    TRDB_D5M_PLL_CONFIG_1_REG,
+    TRDB_D5M_PLL_CONFIG_2_REG,
+    TRDB_D5M_READ_MODE_1_REG,
+    TRDB_D5M_READ_MODE_2_REG,
+    TRDB_D5M_ROW_ADDRESS_MODE_REG,
+    TRDB_D5M_COLUMN_ADDRESS_MODE_REG,
+    TRDB_D5M_GREEN_1_GAIN_REG,
+    TRDB_D5M_BLUE_GAIN_REG,
+    TRDB_D5M_RED_GAIN_REG,
+    TRDB_D5M_GREEN_2_GAIN_REG,
+    TRDB_D5M_GLOBAL_GAIN_REG,
+    TRDB_D5M_ROW_BLACK_TARGET_REG,
+    TRDB_D5M_ROW_BLACK_DEFAULT_OFFSET_REG,
+    TRDB_D5M_GREEN_1_OFFSET_REG,
+    TRDB_D5M_GREEN_2_OFFSET_REG,
+    TRDB_D5M_RED_OFFSET_REG,
+    TRDB_D5M_BLUE_OFFSET_REG,
+    TRDB_D5M_TEST_PATTERN_CONTROL_REG
+};
+
+/*******************************************************************************
+ *  Private API
+ ******************************************************************************/
+static size_t round_up(size_t x, size_t alignment);
+static void write_le(uint8_t *bytes, uint64_t value, uint32_t size);
+static uint64_t read_le(const uint8_t *bytes, uint32_t size);
+static uint16_t register_value(const uint8_t *offsets, const uint16_t *values, uint32_t count, uint8_t register_offset);
+static bool flush_staging(trdb_d5m_recording *rec);
+static bool stage(trdb_d5m_recording *rec, const void *data, size_t size);
+static bool pad_to_alignment(trdb_d5m_recording *rec);
+static bool write_payload(trdb_d5m_recording *rec, const void *payload, size_t size);
+static bool append_index_entry(trdb_d5m_recording *rec, uint64_t offset, uint64_t timestamp);
+static bool record_at(const trdb_d5m_recording_reader *reader, uint64_t offset, uint64_t *next_offset);
+
+/*
+ * round_up
+ *
+ * Rounds x up to the next multiple of alignment (which must be a power of 2).
+ */
+static size_t round_up(size_t x, size_t alignment) {
+    return (x + alignment - 1) & ~(alignment - 1);
+}
+
+/*
+ * write_le
+ *
+ * Writes the size low bytes of value at bytes, least significant byte first.
+ */
+static void write_le(uint8_t *bytes, uint64_t value, uint32_t size) {
+    for (uint32_t i = 0; i < size; i++) {
+        bytes[i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+/*
+ * read_le
+ *
+ * Reads a size-byte value stored least significant byte first at bytes.
+ */
+static uint64_t read_le(const uint8_t *bytes, uint32_t size) {
+    uint64_t value = 0;
+
+    for (uint32_t i = 0; i < size; i++) {
+        value |= ((uint64_t) bytes[i]) << (8 * i);
+    }
+
+    return value;
+}
+
+/*
+ * register_value
+ *
+ * Returns the value of register register_offset in a register snapshot, or 0
+ * if it is not part of the snapshot.
+ */
+static uint16_t register_value(const uint8_t *offsets, const uint16_t *values, uint32_t count, uint8_t register_offset) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (offsets[i] == register_offset) {
+            return values[i];
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * flush_staging
+ *
+ * Writes the staged bytes to the file. The number of staged bytes must be a
+ * multiple of the alignment.
+ */
+static bool flush_staging(trdb_d5m_recording *rec) {
+    size_t done = 0;
+
+    while (done < rec->staging_used) {
+        ssize_t written = write(rec->fd, rec->staging + done, rec->staging_used - done);
+        if (written <= 0) {
+            rec->error = true;
+            return false;
+        }
+        done += written;
+    }
+
+    rec->offset += rec->staging_used;
+    rec->staging_used = 0;
+
+    return true;
+}
+
+/*
+ * stage
+ *
+ * Appends size bytes to the staging buffer, writing it out every time it is
+ * full.
+ */
+static bool stage(trdb_d5m_recording *rec, const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *) data;
+
+    while (size > 0) {
+        size_t chunk = TRDB_D5M_RECORDING_STAGING_SIZE - rec->staging_used;
+        if (chunk > size) {
+            chunk = size;
+        }
+
+        memcpy(rec->staging + rec->staging_used, bytes, chunk);
+        rec->staging_used += chunk;
+        bytes += chunk;
+        size -= chunk;
+
+        if (rec->staging_used == TRDB_D5M_RECORDING_STAGING_SIZE && !flush_staging(rec)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * pad_to_alignment
+ *
+ * Zero pads the staged bytes to the next multiple of the alignment, and writes
+ * them out.
+ */
+static bool pad_to_alignment(trdb_d5m_recording *rec) {
+    size_t padded = round_up(rec->staging_used, rec->alignment);
+
+    memset(rec->staging + rec->staging_used, 0, padded - rec->staging_used);
+    rec->staging_used = padded;
+
+    return flush_staging(rec);
+}
+
+/*
+ * write_payload
+ *
+ * Writes a frame payload. When nothing is staged and the payload is aligned in
+ * memory, its whole aligned part is written straight from the frame buffer,
+ * and only the tail goes through the staging buffer.
+ */
+static bool write_payload(trdb_d5m_recording *rec, const void *payload, size_t size) {
+    const uint8_t *bytes = (const uint8_t *) payload;
+
+    if (rec->staging_used == 0 && ((size_t) bytes & (rec->alignment - 1)) == 0) {
+        size_t direct = size & ~((size_t) rec->alignment - 1);
+        size_t done = 0;
+
+        while (done < direct) {
+            ssize_t written = write(rec->fd, bytes + done, direct - done);
+            if (written <= 0) {
+                rec->error = true;
+                return false;
+            }
+            done += written;
+        }
+
+        rec->offset += direct;
+        bytes += direct;
+        size -= direct;
+    }
+
+    return stage(rec, bytes, size);
+}
+
+/*
+ * append_index_entry
+ *
+ * Adds the frame whose record starts at offset to the in-memory index,
+ * growing it as needed.
+ */
+static bool append_index_entry(trdb_d5m_recording *rec, uint64_t offset, uint64_t timestamp) {
+    if (rec->sequence == rec->index_capacity) {
+        uint32_t capacity = rec->index_capacity == 0 ? 64 : 2 * rec->index_capacity;
+        uint8_t *index = (uint8_t *) realloc(rec->index, (size_t) capacity * TRDB_D5M_RECORDING_INDEX_ENTRY_SIZE);
+        if (index == NULL) {
+            return false;
+        }
+
+        rec->index = index;
+        rec->index_capacity = capacity;
+    }
+
+    uint8_t *entry = rec->index + (size_t) rec->sequence * TRDB_D5M_RECORDING_INDEX_ENTRY_SIZE;
+    write_le(entry + 0, offset, 8);
+    write_le(entry + 8, timestamp, 8);
+    write_le(entry + 16, rec->sequence, 4);
+    write_le(entry + 20, 0, 4);
+
+    return true;
+}
+
+/*
+ * record_at
+ *
+ * Checks that a complete frame record starts at offset, and if so sets
+ * next_offset to the offset of the record which follows it.
+ */
+static bool record_at(const trdb_d5m_recording_reader *reader, uint64_t offset, uint64_t *next_offset) {
+    if (offset > reader->size || reader->size - offset < reader->alignment) {
+        return false;
+    }
+
+    const uint8_t *header = reader->data + offset;
+    if (memcmp(header + FRAME_MAGIC_OFST, FRAME_MAGIC, 4) != 0 || read_le(header + FRAME_HEADER_SIZE_OFST, 4) != reader->alignment) {
+        return false;
+    }
+
+    uint64_t payload_size = read_le(header + FRAME_PAYLOAD_OFST, 8);
+    if (payload_size > reader->size - offset - reader->alignment) {
+        return false;
+    }
+
+    *next_offset = offset + reader->alignment + round_up(payload_size, reader->alignment);
+
+    return true;
+}
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+/*
+ * trdb_d5m_recording_open
+ *
+ * Creates (or truncates) the recording file filename and writes its header.
+ * All writes to the file are multiples of alignment bytes (a power of 2 of at
+ * least 512, or 0 for TRDB_D5M_RECORDING_DEFAULT_ALIGNMENT) at offsets which
+ * are multiples of alignment, so the file is opened with O_DIRECT where the
+ * platform provides it. timestamp_frequency is the number of timestamp ticks
+ * per second of the timestamps given to trdb_d5m_recording_write_frame().
+ *
+ * Returns true if the recording was successfully created, and false otherwise.
+ */
+bool trdb_d5m_recording_open(trdb_d5m_recording *rec, const char *filename, uint32_t alignment, uint64_t timestamp_frequency) {
+    if (alignment == 0) {
+        alignment = TRDB_D5M_RECORDING_DEFAULT_ALIGNMENT;
+    }
+
+    if (alignment < TRDB_D5M_RECORDING_RECORD_HEADER_SIZE ||
+        alignment > TRDB_D5M_RECORDING_STAGING_SIZE ||
+        (alignment & (alignment - 1)) != 0) {
+        return false;
+    }
+
+    memset(rec, 0, sizeof(*rec));
+    rec->alignment = alignment;
+    rec->timestamp_frequency = timestamp_frequency;
+
+    rec->memory = malloc(TRDB_D5M_RECORDING_STAGING_SIZE + alignment - 1);
+    if (rec->memory == NULL) {
+        return false;
+    }
+    rec->staging = (uint8_t *) round_up((size_t) rec->memory, alignment);
+
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+    flags |= O_DIRECT;
+#endif
+    rec->fd = open(filename, flags, 0644);
+#ifdef O_DIRECT
+    if (rec->fd < 0) {
+        /* not all file systems support O_DIRECT */
+        rec->fd = open(filename, flags & ~O_DIRECT, 0644);
+    }
+#endif
+    if (rec->fd < 0) {
+        free(rec->memory);
+        return false;
+    }
+
+    uint8_t header[TRDB_D5M_RECORDING_FILE_HEADER_SIZE] = {0};
+    memcpy(header, FILE_MAGIC, 8);
+    write_le(header + 8, TRDB_D5M_RECORDING_VERSION, 4);
+    write_le(header + 12, alignment, 4);
+    write_le(header + 16, timestamp_frequency, 8);
+    write_le(header + 24, TRDB_D5M_RECORDING_RECORD_HEADER_SIZE, 4);
+
+    if (!stage(rec, header, sizeof(header)) || !pad_to_alignment(rec)) {
+        close(rec->fd);
+        free(rec->memory);
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * trdb_d5m_recording_snapshot_registers
+ *
+ * Reads the sensor registers which are saved with every following frame.
+ * Reading them goes through the i2c bus and takes a few milliseconds, so this
+ * should be called once after configuring the camera, and again only after
+ * changing its configuration.
+ *
+ * Returns true if all registers were successfully read, and false otherwise.
+ */
+bool trdb_d5m_recording_snapshot_registers(trdb_d5m_recording *rec, trdb_d5m_dev *dev) {
+    uint32_t count = sizeof(recorded_registers) / sizeof(recorded_registers[0]);
+
+    rec->register_count = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint16_t value = 0;
+        if (!trdb_d5m_read(dev, recorded_registers[i], &value)) {
+            return false;
+        }
+
+        rec->register_offsets[i] = recorded_registers[i];
+        rec->register_values[i] = value;
+    }
+
+    rec->register_count = count;
+
+    return true;
+}
+
+/*
+ * trdb_d5m_recording_write_frame
+ *
+ * Appends a frame captured by dev to the recording. The frame geometry, pixel
+ * depth and Bayer pattern are taken from the current configuration of dev,
+ * and the exposure, gains and register values from the last register
+ * snapshot. payload should be aligned to the recording's alignment, in which
+ * case its bulk is written without being copied.
+ *
+ * Returns true if the frame was successfully written, and false otherwise.
+ */
+bool trdb_d5m_recording_write_frame(trdb_d5m_recording *rec, trdb_d5m_dev *dev, const void *payload, size_t payload_size, trdb_d5m_recording_payload_format format, uint64_t timestamp) {
+    if (rec->error) {
+        return false;
+    }
+
+    uint64_t record_offset = rec->offset + rec->staging_used;
+    if (!append_index_entry(rec, record_offset, timestamp)) {
+        return false;
+    }
+
+    cmos_sensor_input_dev *input = &dev->cmos_sensor_acquisition.cmos_sensor_input;
+    const uint8_t *offsets = rec->register_offsets;
+    const uint16_t *values = rec->register_values;
+    uint32_t count = rec->register_count;
+
+    uint8_t header[TRDB_D5M_RECORDING_RECORD_HEADER_SIZE] = {0};
+    memcpy(header + FRAME_MAGIC_OFST, FRAME_MAGIC, 4);
+    write_le(header + FRAME_HEADER_SIZE_OFST, rec->alignment, 4);
+    write_le(header + FRAME_SEQUENCE_OFST, rec->sequence, 4);
+    write_le(header + FRAME_FORMAT_OFST, format, 4);
+    write_le(header + FRAME_TIMESTAMP_OFST, timestamp, 8);
+    write_le(header + FRAME_PAYLOAD_OFST, payload_size, 8);
+    write_le(header + FRAME_WIDTH_OFST, trdb_d5m_frame_width(dev), 4);
+    write_le(header + FRAME_HEIGHT_OFST, trdb_d5m_frame_height(dev), 4);
+    header[FRAME_PIX_DEPTH_OFST] = cmos_sensor_input_output_pix_depth(input);
+    header[FRAME_PATTERN_OFST] = cmos_sensor_input_config_debayer_pattern(input);
+    header[FRAME_REG_COUNT_OFST] = count;
+    write_le(header + FRAME_EXPOSURE_OFST,
+             ((uint32_t) register_value(offsets, values, count, TRDB_D5M_SHUTTER_WIDTH_UPPER_REG) << 16) |
+             register_value(offsets, values, count, TRDB_D5M_SHUTTER_WIDTH_LOWER_REG),
+             4);
+    write_le(header + FRAME_GAINS_OFST + 0, register_value(offsets, values, count, TRDB_D5M_GREEN_1_GAIN_REG), 2);
+    write_le(header + FRAME_GAINS_OFST + 2, register_value(offsets, values, count, TRDB_D5M_BLUE_GAIN_REG), 2);
+    write_le(header + FRAME_GAINS_OFST + 4, register_value(offsets, values, count, TRDB_D5M_RED_GAIN_REG), 2);
+    write_le(header + FRAME_GAINS_OFST + 6, register_value(offsets, values, count, TRDB_D5M_GREEN_2_GAIN_REG), 2);
+    write_le(header + FRAME_GAINS_OFST + 8, register_value(offsets, values, count, TRDB_D5M_GLOBAL_GAIN_REG), 2);
+    for (uint32_t i = 0; i < count; i++) {
+        header[FRAME_REGISTERS_OFST + 4 * i] = offsets[i];
+        write_le(header + FRAME_REGISTERS_OFST + 4 * i + 2, values[i], 2);
+    }
+
+    if (!stage(rec, header, sizeof(header)) ||
+        !pad_to_alignment(rec) ||
+        !write_payload(rec, payload, payload_size) ||
+        !pad_to_alignment(rec)) {
+        return false;
+    }
+
+    rec->sequence++;
+
+    return true;
+}
+
+/*
+ * trdb_d5m_recording_close
+ *
+ * Writes the index and footer of the recording, closes the file and frees all
+ * resources of rec.
+ *
+ * Returns true if the recording was successfully completed, and false
+ * otherwise (its frames can still be read, but without the index).
+ */
+bool trdb_d5m_recording_close(trdb_d5m_recording *rec) {
+    bool success = !rec->error;
+
+    if (success) {
+        uint64_t index_offset = rec->offset;
+        uint8_t header[INDEX_HEADER_SIZE];
+        memcpy(header, INDEX_MAGIC, 4);
+        write_le(header + 4, rec->sequence, 4);
+
+        size_t index_size = INDEX_HEADER_SIZE + (size_t) rec->sequence * TRDB_D5M_RECORDING_INDEX_ENTRY_SIZE;
+        size_t padding = round_up(index_size + TRDB_D5M_RECORDING_FOOTER_SIZE, rec->alignment) - index_size - TRDB_D5M_RECORDING_FOOTER_SIZE;
+
+        uint8_t footer[TRDB_D5M_RECORDING_FOOTER_SIZE] = {0};
+        memcpy(footer, FOOTER_MAGIC, 8);
+        write_le(footer + 8, index_offset, 8);
+        write_le(footer + 16, rec->sequence, 4);
+        write_le(footer + 20, TRDB_D5M_RECORDING_VERSION, 4);
+
+        success = stage(rec, header, sizeof(header)) &&
+                  stage(rec, rec->index, (size_t) rec->sequence * TRDB_D5M_RECORDING_INDEX_ENTRY_SIZE);
+
+        /* zero padding between the index and the footer */
+        while (success && padding > 0) {
+            static const uint8_t zeros[64] = {0};
+            size_t chunk = padding < sizeof(zeros) ? padding : sizeof(zeros);
+            success = stage(rec, zeros, chunk);
+            padding -= chunk;
+        }
+
+        success = success && stage(rec, footer, sizeof(footer)) && flush_staging(rec);
+    }
+
+    if (close(rec->fd) != 0) {
+        success = false;
+    }
+
+    free(rec->index);
+    free(rec->memory);
+    rec->index = NULL;
+    rec->memory = NULL;
+    rec->staging = NULL;
+
+    return success;
+}
+
+/*
+ * trdb_d5m_recording_reader_open
+ *
+ * Opens the recording whose whole contents are at data (typically a read-only
+ * memory mapping of the file). If the recording has no valid index (because it
+ * was not closed), the frames are found by walking the records, and only the
+ * complete ones are kept.
+ *
+ * Returns true if data is a recording, and false otherwise.
+ */
+bool trdb_d5m_recording_reader_open(trdb_d5m_recording_reader *reader, const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *) data;
+
+    memset(reader, 0, sizeof(*reader));
+
+    if (size < TRDB_D5M_RECORDING_FILE_HEADER_SIZE ||
+        memcmp(bytes, FILE_MAGIC, 8) != 0 ||
+        read_le(bytes + 8, 4) != TRDB_D5M_RECORDING_VERSION) {
+        return false;
+    }
+
+    uint32_t alignment = read_le(bytes + 12, 4);
+    if (alignment < TRDB_D5M_RECORDING_RECORD_HEADER_SIZE || (alignment & (alignment - 1)) != 0 || size < alignment) {
+        return false;
+    }
+
+    reader->data = bytes;
+    reader->size = size;
+    reader->alignment = alignment;
+    reader->timestamp_frequency = read_le(bytes + 16, 8);
+
+    if (size >= alignment + TRDB_D5M_RECORDING_FOOTER_SIZE) {
+        const uint8_t *footer = bytes + size - TRDB_D5M_RECORDING_FOOTER_SIZE;
+        uint64_t index_offset = read_le(footer + 8, 8);
+        uint32_t frame_count = read_le(footer + 16, 4);
+
+        if (memcmp(footer, FOOTER_MAGIC, 8) == 0 &&
+            index_offset <= size - TRDB_D5M_RECORDING_FOOTER_SIZE - INDEX_HEADER_SIZE &&
+            (size - TRDB_D5M_RECORDING_FOOTER_SIZE - INDEX_HEADER_SIZE - index_offset) / TRDB_D5M_RECORDING_INDEX_ENTRY_SIZE >= frame_count &&
+            memcmp(bytes + index_offset, INDEX_MAGIC, 4) == 0 &&
+            read_le(bytes + index_offset + 4, 4) == frame_count) {
+            reader->index = bytes + index_offset + INDEX_HEADER_SIZE;
+            reader->frame_count = frame_count;
+            return true;
+        }
+    }
+
+    uint64_t offset = alignment;
+    uint64_t next_offset = 0;
+    while (record_at(reader, offset, &next_offset)) {
+        reader->frame_count++;
+        offset = next_offset;
+    }
+
+    return true;
+}
+
+/*
+ * trdb_d5m_recording_reader_frame
+ *
+ * Fills frame with the metadata of frame n of the recording, and points
+ * frame->payload at its payload, inside the recording's data.
+ *
+ * Returns true if frame n exists and is valid, and false otherwise.
+ */
+bool trdb_d5m_recording_reader_frame(const trdb_d5m_recording_reader *reader, uint32_t n, trdb_d5m_recording_frame *frame) {
+    if (n >= reader->frame_count) {
+        return false;
+    }
+
+    uint64_t offset = reader->alignment;
+    uint64_t next_offset = 0;
+
+    if (reader->index != NULL) {
+        offset = read_le(reader->index + (size_t) n * TRDB_D5M_RECORDING_INDEX_ENTRY_SIZE, 8);
+    } else {
+        for (uint32_t i = 0; i < n; i++) {
+            if (!record_at(reader, offset, &next_offset)) {
+                return false;
+            }
+            offset = next_offset;
+        }
+    }
+
+    if (!record_at(reader, offset, &next_offset)) {
+        return false;
+    }
+
+    const uint8_t *header = reader->data + offset;
+
+    frame->sequence = read_le(header + FRAME_SEQUENCE_OFST, 4);
+    frame->timestamp = read_le(header + FRAME_TIMESTAMP_OFST, 8);
+    frame->payload_format = (trdb_d5m_recording_payload_format) read_le(header + FRAME_FORMAT_OFST, 4);
+    frame->width = read_le(header + FRAME_WIDTH_OFST, 4);
+    frame->height = read_le(header + FRAME_HEIGHT_OFST, 4);
+    frame->pix_depth = header[FRAME_PIX_DEPTH_OFST];
+    frame->pattern = (cmos_sensor_input_debayer_pattern) header[FRAME_PATTERN_OFST];
+    frame->exposure = read_le(header + FRAME_EXPOSURE_OFST, 4);
+    frame->green_1_gain = read_le(header + FRAME_GAINS_OFST + 0, 2);
+    frame->blue_gain = read_le(header + FRAME_GAINS_OFST + 2, 2);
+    frame->red_gain = read_le(header + FRAME_GAINS_OFST + 4, 2);
+    frame->green_2_gain = read_le(header + FRAME_GAINS_OFST + 6, 2);
+    frame->global_gain = read_le(header + FRAME_GAINS_OFST + 8, 2);
+
+    frame->register_count = header[FRAME_REG_COUNT_OFST];
+    if (frame->register_count > TRDB_D5M_RECORDING_MAX_REGISTERS) {
+        return false;
+    }
+    for (uint32_t i = 0; i < frame->register_count; i++) {
+        frame->register_offsets[i] = header[FRAME_REGISTERS_OFST + 4 * i];
+        frame->register_values[i] = read_le(header + FRAME_REGISTERS_OFST + 4 * i + 2, 2);
+    }
+
+    frame->payload = header + reader->alignment;
+    frame->payload_size = read_le(header + FRAME_PAYLOAD_OFST, 8);
+
+    return true;
+}
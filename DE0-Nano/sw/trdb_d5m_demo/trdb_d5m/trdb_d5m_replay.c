@@ -0,0 +1,562 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "cmos_sensor_acquisition_raw_codec.h"
+#include "trdb_d5m_replay.h"
+
+/* side of the bright square of synthetic frames, as a fraction of the frame height */
+#define SYNTHETIC_SQUARE_DIVIDER (8)
+
+/*******************************************************************************
+ *  Private API
+ ******************************************************************************/
+static bool load_file(trdb_d5m_replay *replay, const char *filename);
+static void unload_file(trdb_d5m_replay *replay);
+static bool init_from_reader(trdb_d5m_replay *replay, bool loop);
+static uint32_t hash(uint32_t seed, uint32_t frame, uint32_t x, uint32_t y);
+static void generate_frame(trdb_d5m_replay *replay, uint32_t frame);
+static uint64_t now_us(void);
+static void pace(trdb_d5m_replay *replay);
+
+/*
+ * load_file
+ *
+ * Makes the contents of filename available at replay->data. On Linux, the file
+ * is memory mapped, so frames are served straight from the page cache. On
+ * other platforms (e.g. the HAL's host file system), it is read in a heap
+ * buffer once.
+ */
+static bool load_file(trdb_d5m_replay *replay, const char *filename) {
+#if defined(__linux__)
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    /* frames are read in order, let the kernel read ahead aggressively */
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    replay->data = data;
+    replay->data_size = st.st_size;
+    replay->mapped = true;
+
+    return true;
+#else
+    FILE *finput = fopen(filename, "rb");
+    if (!finput) {
+        return false;
+    }
+
+    long size = -1;
+    if (fseek(finput, 0, SEEK_END) == 0) {
+        size = ftell(finput);
+    }
+    if (size <= 0 || fseek(finput, 0, SEEK_SET) != 0) {
+        fclose(finput);
+        return false;
+    }
+
+    void *data = malloc(size);
+    if (data == NULL) {
+        fclose(finput);
+        return false;
+    }
+
+    if (fread(data, 1, size, finput) != (size_t) size) {
+        free(data);
+        fclose(finput);
+        return false;
+    }
+    fclose(finput);
+
+    replay->data = data;
+    replay->data_size = size;
+    replay->mapped = false;
+
+    return true;
+#endif
+}
+
+/*
+ * unload_file
+ *
+ * Releases the contents loaded by load_file(), if any.
+ */
+static void unload_file(trdb_d5m_replay *replay) {
+    if (replay->data == NULL) {
+        return;
+    }
+
+#if defined(__linux__)
+    if (replay->mapped) {
+        munmap(replay->data, replay->data_size);
+    } else {
+        free(replay->data);
+    }
+#else
+    free(replay->data);
+#endif
+
+    replay->data = NULL;
+}
+
+/*
+ * init_from_reader
+ *
+ * Sets up replay to serve the frames of replay->reader. The geometry is taken
+ * from the first frame. Frames stored with the raw codec are decoded in a
+ * scratch frame of 16 bit pixels (allocated on the first such frame), raw
+ * frames are served in place.
+ */
+static bool init_from_reader(trdb_d5m_replay *replay, bool loop) {
+    trdb_d5m_recording_frame first;
+    if (!trdb_d5m_recording_reader_frame(&replay->reader, 0, &first)) {
+        return false;
+    }
+
+    replay->source = REPLAY_RECORDING;
+    replay->width = first.width;
+    replay->height = first.height;
+    replay->pix_depth = first.pix_depth;
+    replay->pattern = first.pattern;
+    replay->frame_count = replay->reader.frame_count;
+    replay->loop = loop;
+
+    switch (first.payload_format) {
+        case PAYLOAD_RAW:
+            replay->frame_size = first.payload_size;
+            break;
+
+        case PAYLOAD_RAW_CODEC:
+            replay->frame_size = (size_t) first.width * first.height * sizeof(uint16_t);
+            break;
+
+        default:
+            /* the hardware compressor's bitstream needs the unit's
+             * configuration to be decoded */
+            return false;
+    }
+
+    return replay->frame_size != 0 && replay->height != 0;
+}
+
+/*
+ * hash
+ *
+ * Returns a well mixed 32 bit value of its arguments, used as deterministic
+ * noise.
+ */
+static uint32_t hash(uint32_t seed, uint32_t frame, uint32_t x, uint32_t y) {
+    uint32_t h = seed ^ (frame * 0x9e3779b9) ^ (y * 0x85ebca6b) ^ (x * 0xc2b2ae35);
+
+    h ^= h >> 16;
+    h *= 0x7feb352d;
+    h ^= h >> 15;
+    h *= 0x846ca68b;
+    h ^= h >> 16;
+
+    return h;
+}
+
+/*
+ * generate_frame
+ *
+ * Generates synthetic frame number frame in replay->scratch: a horizontal ramp
+ * scrolling by 2 pixels per frame, a saturated square moving diagonally, and
+ * a little noise, with a different gain for each Bayer channel. The contents
+ * only depend on the geometry, the seed and frame.
+ */
+static void generate_frame(trdb_d5m_replay *replay, uint32_t frame) {
+    static const uint32_t channel_gain[4] = {8, 6, 4, 7}; /* in eighths, per (row parity, column parity) */
+    uint32_t width = replay->width;
+    uint32_t height = replay->height;
+    uint32_t max = (1u << replay->pix_depth) - 1;
+    uint32_t noise_mask = max >> 6;
+    uint32_t side = height / SYNTHETIC_SQUARE_DIVIDER;
+    uint32_t square_x = (width > side) ? (frame * 4) % (width - side) : 0;
+    uint32_t square_y = (height > side) ? (frame * 4) % (height - side) : 0;
+
+    for (uint32_t y = 0; y < height; y++) {
+        uint16_t *row = replay->scratch + (size_t) y * width;
+
+        for (uint32_t x = 0; x < width; x++) {
+            uint32_t value;
+
+            if (x - square_x < side && y - square_y < side) {
+                value = max;
+            } else {
+                uint32_t ramp = (uint32_t) (((uint64_t) ((x + 2 * frame) % width) * max) / width);
+                value = (ramp * channel_gain[(y % 2) * 2 + (x % 2)]) / 8;
+                value += hash(replay->seed, frame, x, y) & noise_mask;
+                if (value > max) {
+                    value = max;
+                }
+            }
+
+            row[x] = value;
+        }
+    }
+}
+
+/*
+ * now_us
+ *
+ * Returns the current time in microseconds.
+ */
+static uint64_t now_us(void) {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/*
+ * pace
+ *
+ * Waits until the next frame is due at the configured rate. Frames are due at
+ * fixed times from the first one, so the rate does not drift when serving a
+ * frame takes a variable time.
+ */
+static void pace(trdb_d5m_replay *replay) {
+    if (replay->frames_per_second == 0) {
+        return;
+    }
+
+    uint64_t now = now_us();
+    if (replay->served == 0) {
+        replay->start_us = now;
+        return;
+    }
+
+    uint64_t due = replay->start_us + (replay->served * 1000000) / replay->frames_per_second;
+    if (now < due) {
+        usleep(due - now);
+    }
+}
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+/*
+ * trdb_d5m_replay_open_recording
+ *
+ * Opens the trdb_d5m_recording file filename for replay. If loop is true, the
+ * recording restarts from its first frame after its last one.
+ *
+ * Returns true if the recording was successfully opened, and false otherwise.
+ */
+bool trdb_d5m_replay_open_recording(trdb_d5m_replay *replay, const char *filename, bool loop) {
+    memset(replay, 0, sizeof(*replay));
+
+    if (!load_file(replay, filename)) {
+        return false;
+    }
+
+    if (!trdb_d5m_recording_reader_open(&replay->reader, replay->data, replay->data_size) ||
+        !init_from_reader(replay, loop)) {
+        trdb_d5m_replay_close(replay);
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * trdb_d5m_replay_open_memory
+ *
+ * Same as trdb_d5m_replay_open_recording(), for a recording already in memory.
+ * data is not copied, and must remain valid until trdb_d5m_replay_close().
+ */
+bool trdb_d5m_replay_open_memory(trdb_d5m_replay *replay, const void *data, size_t size, bool loop) {
+    memset(replay, 0, sizeof(*replay));
+
+    if (!trdb_d5m_recording_reader_open(&replay->reader, data, size) ||
+        !init_from_reader(replay, loop)) {
+        trdb_d5m_replay_close(replay);
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * trdb_d5m_replay_open_synthetic
+ *
+ * Opens an endless source of generated frames of width x height pixels of
+ * pix_depth bits (1 to 16), saved as one uint16_t per pixel as the
+ * cmos_sensor_input unit does without packing. Two sources with the same
+ * arguments serve identical frames.
+ *
+ * Returns true if the source was successfully opened, and false otherwise.
+ */
+bool trdb_d5m_replay_open_synthetic(trdb_d5m_replay *replay, uint32_t width, uint32_t height, uint8_t pix_depth, cmos_sensor_input_debayer_pattern pattern, uint32_t seed) {
+    memset(replay, 0, sizeof(*replay));
+
+    if (width == 0 || height == 0 || pix_depth == 0 || pix_depth > 16) {
+        return false;
+    }
+
+    replay->source = REPLAY_SYNTHETIC;
+    replay->width = width;
+    replay->height = height;
+    replay->pix_depth = pix_depth;
+    replay->pattern = pattern;
+    replay->frame_size = (size_t) width * height * sizeof(uint16_t);
+    replay->seed = seed;
+
+    replay->scratch = (uint16_t *) malloc(replay->frame_size);
+    if (replay->scratch == NULL) {
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * trdb_d5m_replay_set_rate
+ *
+ * Sets the rate at which frames are served, or 0 to serve them as fast as
+ * possible (the default).
+ */
+void trdb_d5m_replay_set_rate(trdb_d5m_replay *replay, uint32_t frames_per_second) {
+    replay->frames_per_second = frames_per_second;
+    replay->served = 0;
+}
+
+/*
+ * trdb_d5m_replay_rewind
+ *
+ * Restarts the replay from its first frame.
+ */
+void trdb_d5m_replay_rewind(trdb_d5m_replay *replay) {
+    replay->next = 0;
+    replay->served = 0;
+}
+
+/*
+ * trdb_d5m_replay_close
+ *
+ * Frees all resources of replay.
+ */
+void trdb_d5m_replay_close(trdb_d5m_replay *replay) {
+    unload_file(replay);
+    free(replay->scratch);
+    replay->scratch = NULL;
+}
+
+/*
+ * trdb_d5m_replay_frame_size
+ *
+ * Returns the size of a served frame in bytes.
+ */
+size_t trdb_d5m_replay_frame_size(trdb_d5m_replay *replay) {
+    return replay->frame_size;
+}
+
+/*
+ * trdb_d5m_replay_frame_width
+ *
+ * Returns the width of a served frame in pixels.
+ */
+uint32_t trdb_d5m_replay_frame_width(trdb_d5m_replay *replay) {
+    return replay->width;
+}
+
+/*
+ * trdb_d5m_replay_frame_height
+ *
+ * Returns the height of a served frame in pixels.
+ */
+uint32_t trdb_d5m_replay_frame_height(trdb_d5m_replay *replay) {
+    return replay->height;
+}
+
+/*
+ * trdb_d5m_replay_strip_size
+ *
+ * Returns the size in bytes of a strip of the given number of lines of a
+ * served frame, to be used with trdb_d5m_replay_snapshot_strips().
+ */
+size_t trdb_d5m_replay_strip_size(trdb_d5m_replay *replay, uint32_t lines) {
+    return (replay->frame_size / replay->height) * lines;
+}
+
+/*
+ * trdb_d5m_replay_next_frame
+ *
+ * Serves the next frame without copying it: frame is set to the frame's
+ * contents (inside the recording's mapping for raw frames, or in the replay's
+ * scratch frame otherwise), which remain valid until the next frame is served.
+ * If metadata is not NULL, it is filled with the frame's metadata.
+ *
+ * Returns false at the end of a recording which does not loop, or if the frame
+ * is not valid.
+ */
+bool trdb_d5m_replay_next_frame(trdb_d5m_replay *replay, const void **frame, trdb_d5m_recording_frame *metadata) {
+    trdb_d5m_recording_frame current;
+
+    if (replay->frame_count != 0 && replay->next >= replay->frame_count) {
+        if (!replay->loop) {
+            return false;
+        }
+        replay->next = 0;
+    }
+
+    pace(replay);
+
+    if (replay->source == REPLAY_SYNTHETIC) {
+        generate_frame(replay, replay->next);
+
+        memset(&current, 0, sizeof(current));
+        current.sequence = replay->next;
+        current.timestamp = replay->next;
+        current.payload_format = PAYLOAD_RAW;
+        current.width = replay->width;
+        current.height = replay->height;
+        current.pix_depth = replay->pix_depth;
+        current.pattern = replay->pattern;
+        current.payload = replay->scratch;
+        current.payload_size = replay->frame_size;
+    } else {
+        if (!trdb_d5m_recording_reader_frame(&replay->reader, replay->next, &current) ||
+            current.width != replay->width || current.height != replay->height) {
+            return false;
+        }
+
+        if (current.payload_format == PAYLOAD_RAW_CODEC) {
+            if (replay->frame_size != (size_t) replay->width * replay->height * sizeof(uint16_t)) {
+                return false;
+            }
+
+            if (replay->scratch == NULL) {
+                replay->scratch = (uint16_t *) malloc(replay->frame_size);
+            }
+
+            if (replay->scratch == NULL ||
+                !cmos_sensor_acquisition_raw_codec_decode(current.payload, current.payload_size, replay->scratch, replay->width * sizeof(uint16_t))) {
+                return false;
+            }
+            current.payload = replay->scratch;
+            current.payload_size = replay->frame_size;
+        } else if (current.payload_format != PAYLOAD_RAW || current.payload_size != replay->frame_size) {
+            return false;
+        }
+    }
+
+    *frame = current.payload;
+    if (metadata) {
+        *metadata = current;
+    }
+
+    replay->next++;
+    replay->served++;
+
+    return true;
+}
+
+/*
+ * trdb_d5m_replay_snapshot
+ *
+ * Counterpart of trdb_d5m_snapshot(): copies the next frame to frame, which
+ * must hold at least trdb_d5m_replay_frame_size() bytes.
+ *
+ * Returns true if the frame was successfully saved, and false otherwise.
+ */
+bool trdb_d5m_replay_snapshot(trdb_d5m_replay *replay, void *frame, size_t frame_size) {
+    const void *source = NULL;
+
+    if (frame_size < replay->frame_size || !trdb_d5m_replay_next_frame(replay, &source, NULL)) {
+        return false;
+    }
+
+    memcpy(frame, source, replay->frame_size);
+
+    return true;
+}
+
+/*
+ * trdb_d5m_replay_snapshot_pitched
+ *
+ * Counterpart of trdb_d5m_snapshot_pitched(): copies row i of the next frame
+ * to (base + i * pitch).
+ *
+ * Returns true if the frame was successfully saved, and false otherwise.
+ */
+bool trdb_d5m_replay_snapshot_pitched(trdb_d5m_replay *replay, void *base, size_t pitch) {
+    size_t row_size = trdb_d5m_replay_strip_size(replay, 1);
+    const void *source = NULL;
+
+    if (pitch < row_size || !trdb_d5m_replay_next_frame(replay, &source, NULL)) {
+        return false;
+    }
+
+    for (uint32_t row = 0; row < replay->height; row++) {
+        memcpy((uint8_t *) base + row * pitch, (const uint8_t *) source + row * row_size, row_size);
+    }
+
+    return true;
+}
+
+/*
+ * trdb_d5m_replay_snapshot_strips
+ *
+ * Counterpart of trdb_d5m_snapshot_strips(): the next frame is cut in strips of
+ * strip_size bytes (only the last one may be shorter), each copied to the next
+ * buffer of the ring of ring_strips buffers at ring before callback is called
+ * on it.
+ *
+ * If ring is NULL, no copy is made and callback is called directly on the
+ * strips of the served frame, which it must not modify.
+ *
+ * Returns true if the whole frame was successfully served, and false
+ * otherwise.
+ */
+bool trdb_d5m_replay_snapshot_strips(trdb_d5m_replay *replay, void *ring, uint32_t ring_strips, size_t strip_size, cmos_sensor_acquisition_strip_callback callback, void *context) {
+    const void *source = NULL;
+
+    if ((ring != NULL && ring_strips == 0) || strip_size == 0 || !trdb_d5m_replay_next_frame(replay, &source, NULL)) {
+        return false;
+    }
+
+    uint32_t num_strips = 1 + ((replay->frame_size - 1) / strip_size);
+
+    for (uint32_t i = 0; i < num_strips; i++) {
+        uint8_t *strip = (uint8_t *) source + (size_t) i * strip_size;
+        size_t remaining = replay->frame_size - (size_t) i * strip_size;
+        size_t length = (remaining < strip_size) ? remaining : strip_size;
+
+        if (ring != NULL) {
+            uint8_t *buffer = (uint8_t *) ring + (size_t) (i % ring_strips) * strip_size;
+            memcpy(buffer, strip, length);
+            strip = buffer;
+        }
+
+        if (callback) {
+            callback(strip, length, i, context);
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef __TRDB_D5M_REPLAY_H__
+#define __TRDB_D5M_REPLAY_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cmos_sensor_acquisition.h"
+#include "trdb_d5m_recording.h"
+
+/* Origin of the replayed frames */
+typedef enum trdb_d5m_replay_source {
+    REPLAY_RECORDING, /* Frames of a trdb_d5m_recording file */
+    REPLAY_SYNTHETIC  /* Deterministic generated Bayer frames */
+} trdb_d5m_replay_source;
+
+/* Replay device, standing in for a trdb_d5m_dev when no camera is attached */
+typedef struct trdb_d5m_replay {
+    trdb_d5m_replay_source            source;
+    trdb_d5m_recording_reader         reader;            /* Recording being replayed (REPLAY_RECORDING) */
+    void                              *data;             /* Recording contents, owned by the replay */
+    size_t                            data_size;         /* Size of the recording in bytes */
+    bool                              mapped;            /* data is a memory mapping (else a heap allocation) */
+    uint32_t                          width;             /* Frame width in pixels */
+    uint32_t                          height;            /* Frame height in pixels */
+    uint8_t                           pix_depth;         /* Depth of each pixel sample */
+    cmos_sensor_input_debayer_pattern pattern;           /* Bayer pattern */
+    size_t                            frame_size;        /* Size of a served frame in bytes */
+    uint32_t                          frame_count;       /* Number of distinct frames (0 for an endless synthetic source) */
+    uint32_t                          next;              /* Index of the next frame to serve */
+    bool                              loop;              /* Restart from the first frame after the last one */
+    uint32_t                          seed;              /* Seed of the synthetic noise */
+    uint16_t                          *scratch;          /* Decoded or generated frame */
+    uint32_t                          frames_per_second; /* Serving rate, 0 for as fast as possible */
+    uint64_t                          start_us;          /* Time at which the first frame was served */
+    uint64_t                          served;            /* Number of frames served so far */
+} trdb_d5m_replay;
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+bool trdb_d5m_replay_open_recording(trdb_d5m_replay *replay, const char *filename, bool loop);
+bool trdb_d5m_replay_open_memory(trdb_d5m_replay *replay, const void *data, size_t size, bool loop);
+bool trdb_d5m_replay_open_synthetic(trdb_d5m_replay *replay, uint32_t width, uint32_t height, uint8_t pix_depth, cmos_sensor_input_debayer_pattern pattern, uint32_t seed);
+void trdb_d5m_replay_set_rate(trdb_d5m_replay *replay, uint32_t frames_per_second);
+void trdb_d5m_replay_rewind(trdb_d5m_replay *replay);
+void trdb_d5m_replay_close(trdb_d5m_replay *replay);
+
+size_t trdb_d5m_replay_frame_size(trdb_d5m_replay *replay);
+uint32_t trdb_d5m_replay_frame_width(trdb_d5m_replay *replay);
+uint32_t trdb_d5m_replay_frame_height(trdb_d5m_replay *replay);
+size_t trdb_d5m_replay_strip_size(trdb_d5m_replay *replay, uint32_t lines);
+
+bool trdb_d5m_replay_next_frame(trdb_d5m_replay *replay, const void **frame, trdb_d5m_recording_frame *metadata);
+bool trdb_d5m_replay_snapshot(trdb_d5m_replay *replay, void *frame, size_t frame_size);
+bool trdb_d5m_replay_snapshot_pitched(trdb_d5m_replay *replay, void *base, size_t pitch);
+bool trdb_d5m_replay_snapshot_strips(trdb_d5m_replay *replay, void *ring, uint32_t ring_strips, size_t strip_size, cmos_sensor_acquisition_strip_callback callback, void *context);
+
+#endif /* __TRDB_D5M_REPLAY_H__ */
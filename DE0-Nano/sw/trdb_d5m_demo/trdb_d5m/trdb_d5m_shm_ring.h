@@ -0,0 +1,93 @@
+#ifndef __TRDB_D5M_SHM_RING_H__
+#define __TRDB_D5M_SHM_RING_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Maximum number of consumers attached to a ring (one pin bit each) */
+#define TRDB_D5M_SHM_RING_MAX_CONSUMERS (31)
+
+/* Alignment of the frame slots in the shared memory */
+#define TRDB_D5M_SHM_RING_SLOT_ALIGNMENT (4096)
+
+/* Description of a published frame */
+typedef struct trdb_d5m_shm_ring_frame {
+    uint32_t sequence;  /* Frame number, counting from 0 */
+    uint32_t size;      /* Frame size in bytes */
+    uint64_t timestamp; /* Capture time */
+    uint16_t width;     /* Frame width in pixels */
+    uint16_t height;    /* Frame height in pixels */
+    uint16_t format;    /* Payload format, defined by the application */
+    uint16_t reserved;
+    uint32_t dropped;   /* Frames the consumer skipped before this one */
+} trdb_d5m_shm_ring_frame;
+
+/* Frame slot, in the shared memory */
+typedef struct trdb_d5m_shm_ring_slot {
+    uint32_t                pins;      /* One bit per consumer reading the slot, SLOT_WRITER while being filled */
+    uint32_t                published; /* Sequence of the slot's frame + 1, or 0 if it holds none */
+    trdb_d5m_shm_ring_frame frame;     /* Description of the slot's frame */
+} trdb_d5m_shm_ring_slot;
+
+/* Consumer registration, in the shared memory */
+typedef struct trdb_d5m_shm_ring_consumer_entry {
+    uint32_t pid;     /* Process of the consumer, or 0 if the entry is free */
+    uint32_t cursor;  /* Sequence of the next frame the consumer wants */
+    uint32_t dropped; /* Frames the consumer skipped so far */
+    uint32_t reserved;
+} trdb_d5m_shm_ring_consumer_entry;
+
+/* Start of the shared memory */
+typedef struct trdb_d5m_shm_ring_header {
+    char     magic[8];      /* "TD5MRNG\0" */
+    uint32_t version;       /* Layout version */
+    uint32_t slot_count;    /* Number of frame slots */
+    uint32_t slot_size;     /* Capacity of a frame slot in bytes */
+    uint32_t slot_stride;   /* Distance between two frame slots in bytes */
+    uint64_t data_offset;   /* Offset of the first frame slot */
+    uint64_t size;          /* Size of the shared memory in bytes */
+    uint32_t head;          /* Number of frames published so far (futex word) */
+    uint32_t waiters;       /* Number of consumers sleeping on head */
+    uint32_t producer_pid;  /* Process of the producer */
+    uint32_t next_slot;     /* Slot the producer tries first */
+    uint64_t overruns;      /* Frames the producer dropped because all slots were pinned */
+} trdb_d5m_shm_ring_header;
+
+/* Shared-memory frame ring, as mapped by one process */
+typedef struct trdb_d5m_shm_ring {
+    trdb_d5m_shm_ring_header         *header;    /* Mapped shared memory */
+    trdb_d5m_shm_ring_consumer_entry *consumers; /* Consumer table */
+    trdb_d5m_shm_ring_slot           *slots;     /* Slot table */
+    uint8_t                          *data;      /* First frame slot */
+    size_t                           size;       /* Size of the mapping in bytes */
+    bool                             producer;   /* This process created the ring */
+    char                             name[64];   /* Name of the shared memory object */
+    int32_t                          writing;    /* Slot acquired by the producer, or -1 */
+} trdb_d5m_shm_ring;
+
+/* Consumer of a shared-memory frame ring */
+typedef struct trdb_d5m_shm_ring_consumer {
+    trdb_d5m_shm_ring *ring;  /* Ring the consumer is attached to */
+    uint32_t          index;  /* Entry in the consumer table */
+    int32_t           slot;   /* Slot being read, or -1 */
+} trdb_d5m_shm_ring_consumer;
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+bool trdb_d5m_shm_ring_create(trdb_d5m_shm_ring *ring, const char *name, uint32_t slot_count, uint32_t slot_size);
+bool trdb_d5m_shm_ring_attach(trdb_d5m_shm_ring *ring, const char *name);
+void trdb_d5m_shm_ring_close(trdb_d5m_shm_ring *ring);
+
+void *trdb_d5m_shm_ring_acquire(trdb_d5m_shm_ring *ring);
+bool trdb_d5m_shm_ring_publish(trdb_d5m_shm_ring *ring, const trdb_d5m_shm_ring_frame *frame);
+void trdb_d5m_shm_ring_cancel(trdb_d5m_shm_ring *ring);
+uint32_t trdb_d5m_shm_ring_reap(trdb_d5m_shm_ring *ring);
+
+bool trdb_d5m_shm_ring_consumer_open(trdb_d5m_shm_ring_consumer *consumer, trdb_d5m_shm_ring *ring);
+bool trdb_d5m_shm_ring_consumer_read(trdb_d5m_shm_ring_consumer *consumer, int timeout_ms, const void **data, trdb_d5m_shm_ring_frame *frame);
+void trdb_d5m_shm_ring_consumer_done(trdb_d5m_shm_ring_consumer *consumer);
+void trdb_d5m_shm_ring_consumer_close(trdb_d5m_shm_ring_consumer *consumer);
+
+#endif /* __TRDB_D5M_SHM_RING_H__ */
@@ -4,7 +4,7 @@ package require -exact qsys 15.1
 #
 # module cmos_sensor_input
 #
-set_module_property DESCRIPTION {"cmos_sensor_input -> dc_fifo -> msgdma"}
+set_module_property DESCRIPTION {"cmos_sensor_input -> dc_fifo -> msgdma (optionally a second preview stream with its own dc_fifo -> msgdma)"}
 set_module_property NAME {cmos_sensor_acquisition}
 set_module_property VERSION {15.1}
 set_module_property OPAQUE_ADDRESS_MAP false
@@ -23,8 +23,22 @@ proc compose {} {
     set CMOS_SENSOR_INPUT_OUTPUT_WIDTH [get_parameter_value CMOS_SENSOR_INPUT_OUTPUT_WIDTH]
     set CMOS_SENSOR_INPUT_FIFO_DEPTH [get_parameter_value CMOS_SENSOR_INPUT_FIFO_DEPTH]
     set CMOS_SENSOR_INPUT_DEVICE_FAMILY [get_parameter_value CMOS_SENSOR_INPUT_DEVICE_FAMILY]
+    set CMOS_SENSOR_INPUT_DOWNSCALER_ENABLE [get_parameter_value CMOS_SENSOR_INPUT_DOWNSCALER_ENABLE]
+    set CMOS_SENSOR_INPUT_PREVIEW_ENABLE [get_parameter_value CMOS_SENSOR_INPUT_PREVIEW_ENABLE]
+    set CMOS_SENSOR_INPUT_PLANAR_ENABLE [get_parameter_value CMOS_SENSOR_INPUT_PLANAR_ENABLE]
+    set CMOS_SENSOR_INPUT_DEPTH_REDUCER_ENABLE [get_parameter_value CMOS_SENSOR_INPUT_DEPTH_REDUCER_ENABLE]
+    set CMOS_SENSOR_INPUT_REDUCED_PIX_DEPTH [get_parameter_value CMOS_SENSOR_INPUT_REDUCED_PIX_DEPTH]
     set CMOS_SENSOR_INPUT_DEBAYER_ENABLE [get_parameter_value CMOS_SENSOR_INPUT_DEBAYER_ENABLE]
+    set CMOS_SENSOR_INPUT_COLOR_CONVERTER_ENABLE [get_parameter_value CMOS_SENSOR_INPUT_COLOR_CONVERTER_ENABLE]
     set CMOS_SENSOR_INPUT_PACKER_ENABLE [get_parameter_value CMOS_SENSOR_INPUT_PACKER_ENABLE]
+    set CMOS_SENSOR_INPUT_STAGE_COUNT [get_parameter_value CMOS_SENSOR_INPUT_STAGE_COUNT]
+    set CMOS_SENSOR_INPUT_STAGE_0_TYPE [get_parameter_value CMOS_SENSOR_INPUT_STAGE_0_TYPE]
+    set CMOS_SENSOR_INPUT_STAGE_1_TYPE [get_parameter_value CMOS_SENSOR_INPUT_STAGE_1_TYPE]
+    set CMOS_SENSOR_INPUT_STAGE_2_TYPE [get_parameter_value CMOS_SENSOR_INPUT_STAGE_2_TYPE]
+    set CMOS_SENSOR_INPUT_STAGE_3_TYPE [get_parameter_value CMOS_SENSOR_INPUT_STAGE_3_TYPE]
+    set CMOS_SENSOR_INPUT_BLOB_COUNT [get_parameter_value CMOS_SENSOR_INPUT_BLOB_COUNT]
+    set CMOS_SENSOR_INPUT_SPARSE_ENABLE [get_parameter_value CMOS_SENSOR_INPUT_SPARSE_ENABLE]
+    set CMOS_SENSOR_INPUT_COMPRESSOR_ENABLE [get_parameter_value CMOS_SENSOR_INPUT_COMPRESSOR_ENABLE]
 
     set DC_FIFO_DEPTH [get_parameter_value DC_FIFO_DEPTH]
     set DC_FIFO_WIDTH [get_parameter_value DC_FIFO_WIDTH]
@@ -36,6 +50,8 @@ proc compose {} {
     set MSGDMA_MAX_BYTE [get_parameter_value MSGDMA_MAX_BYTE]
     set MSGDMA_BURST_ENABLE [get_parameter_value MSGDMA_BURST_ENABLE]
     set MSGDMA_MAX_BURST_COUNT [get_parameter_value MSGDMA_MAX_BURST_COUNT]
+    set MSGDMA_ENHANCED_FEATURES [get_parameter_value MSGDMA_ENHANCED_FEATURES]
+    set MSGDMA_PROGRAMMABLE_BURST_ENABLE [get_parameter_value MSGDMA_PROGRAMMABLE_BURST_ENABLE]
 
     # Instances and instance parameters
     # (disabled instances are intentionally culled)
@@ -57,8 +73,22 @@ proc compose {} {
     set_instance_parameter_value cmos_sensor_input_0 {OUTPUT_WIDTH} $CMOS_SENSOR_INPUT_OUTPUT_WIDTH
     set_instance_parameter_value cmos_sensor_input_0 {FIFO_DEPTH} $CMOS_SENSOR_INPUT_FIFO_DEPTH
     set_instance_parameter_value cmos_sensor_input_0 {DEVICE_FAMILY} $CMOS_SENSOR_INPUT_DEVICE_FAMILY
+    set_instance_parameter_value cmos_sensor_input_0 {DOWNSCALER_ENABLE} $CMOS_SENSOR_INPUT_DOWNSCALER_ENABLE
+    set_instance_parameter_value cmos_sensor_input_0 {PREVIEW_ENABLE} $CMOS_SENSOR_INPUT_PREVIEW_ENABLE
+    set_instance_parameter_value cmos_sensor_input_0 {PLANAR_ENABLE} $CMOS_SENSOR_INPUT_PLANAR_ENABLE
+    set_instance_parameter_value cmos_sensor_input_0 {DEPTH_REDUCER_ENABLE} $CMOS_SENSOR_INPUT_DEPTH_REDUCER_ENABLE
+    set_instance_parameter_value cmos_sensor_input_0 {REDUCED_PIX_DEPTH} $CMOS_SENSOR_INPUT_REDUCED_PIX_DEPTH
     set_instance_parameter_value cmos_sensor_input_0 {DEBAYER_ENABLE} $CMOS_SENSOR_INPUT_DEBAYER_ENABLE
+    set_instance_parameter_value cmos_sensor_input_0 {COLOR_CONVERTER_ENABLE} $CMOS_SENSOR_INPUT_COLOR_CONVERTER_ENABLE
     set_instance_parameter_value cmos_sensor_input_0 {PACKER_ENABLE} $CMOS_SENSOR_INPUT_PACKER_ENABLE
+    set_instance_parameter_value cmos_sensor_input_0 {STAGE_COUNT} $CMOS_SENSOR_INPUT_STAGE_COUNT
+    set_instance_parameter_value cmos_sensor_input_0 {STAGE_0_TYPE} $CMOS_SENSOR_INPUT_STAGE_0_TYPE
+    set_instance_parameter_value cmos_sensor_input_0 {STAGE_1_TYPE} $CMOS_SENSOR_INPUT_STAGE_1_TYPE
+    set_instance_parameter_value cmos_sensor_input_0 {STAGE_2_TYPE} $CMOS_SENSOR_INPUT_STAGE_2_TYPE
+    set_instance_parameter_value cmos_sensor_input_0 {STAGE_3_TYPE} $CMOS_SENSOR_INPUT_STAGE_3_TYPE
+    set_instance_parameter_value cmos_sensor_input_0 {BLOB_COUNT} $CMOS_SENSOR_INPUT_BLOB_COUNT
+    set_instance_parameter_value cmos_sensor_input_0 {SPARSE_ENABLE} $CMOS_SENSOR_INPUT_SPARSE_ENABLE
+    set_instance_parameter_value cmos_sensor_input_0 {COMPRESSOR_ENABLE} $CMOS_SENSOR_INPUT_COMPRESSOR_ENABLE
 
     add_instance dc_fifo_0 altera_avalon_dc_fifo 15.1
     set_instance_parameter_value dc_fifo_0 {SYMBOLS_PER_BEAT} $DC_FIFO_SYMBOLS_PER_BEAT
@@ -66,7 +96,7 @@ proc compose {} {
     set_instance_parameter_value dc_fifo_0 {FIFO_DEPTH} $DC_FIFO_DEPTH
     set_instance_parameter_value dc_fifo_0 {CHANNEL_WIDTH} {0}
     set_instance_parameter_value dc_fifo_0 {ERROR_WIDTH} {0}
-    set_instance_parameter_value dc_fifo_0 {USE_PACKETS} {0}
+    set_instance_parameter_value dc_fifo_0 {USE_PACKETS} {1}
     set_instance_parameter_value dc_fifo_0 {USE_IN_FILL_LEVEL} {0}
     set_instance_parameter_value dc_fifo_0 {USE_OUT_FILL_LEVEL} {0}
     set_instance_parameter_value dc_fifo_0 {WR_SYNC_DEPTH} {3}
@@ -100,11 +130,11 @@ proc compose {} {
     set_instance_parameter_value msgdma_0 {BURST_ENABLE} $MSGDMA_BURST_ENABLE
     set_instance_parameter_value msgdma_0 {MAX_BURST_COUNT} $MSGDMA_MAX_BURST_COUNT
     set_instance_parameter_value msgdma_0 {BURST_WRAPPING_SUPPORT} {0}
-    set_instance_parameter_value msgdma_0 {ENHANCED_FEATURES} {0}
+    set_instance_parameter_value msgdma_0 {ENHANCED_FEATURES} $MSGDMA_ENHANCED_FEATURES
     set_instance_parameter_value msgdma_0 {STRIDE_ENABLE} {0}
     set_instance_parameter_value msgdma_0 {MAX_STRIDE} {1}
-    set_instance_parameter_value msgdma_0 {PROGRAMMABLE_BURST_ENABLE} {0}
-    set_instance_parameter_value msgdma_0 {PACKET_ENABLE} {0}
+    set_instance_parameter_value msgdma_0 {PROGRAMMABLE_BURST_ENABLE} $MSGDMA_PROGRAMMABLE_BURST_ENABLE
+    set_instance_parameter_value msgdma_0 {PACKET_ENABLE} {1}
     set_instance_parameter_value msgdma_0 {ERROR_ENABLE} {0}
     set_instance_parameter_value msgdma_0 {ERROR_WIDTH} {8}
     set_instance_parameter_value msgdma_0 {CHANNEL_ENABLE} {0}
@@ -114,10 +144,55 @@ proc compose {} {
     set_instance_parameter_value msgdma_0 {PREFETCHER_DATA_WIDTH} {32}
     set_instance_parameter_value msgdma_0 {PREFETCHER_MAX_READ_BURST_COUNT} {2}
 
+    # second dc_fifo -> msgdma pair for the preview stream (same parameters as
+    # the main stream)
+    if {$CMOS_SENSOR_INPUT_PREVIEW_ENABLE} {
+        add_instance dc_fifo_1 altera_avalon_dc_fifo 15.1
+        set_instance_parameter_value dc_fifo_1 {SYMBOLS_PER_BEAT} $DC_FIFO_SYMBOLS_PER_BEAT
+        set_instance_parameter_value dc_fifo_1 {BITS_PER_SYMBOL} {8}
+        set_instance_parameter_value dc_fifo_1 {FIFO_DEPTH} $DC_FIFO_DEPTH
+        set_instance_parameter_value dc_fifo_1 {CHANNEL_WIDTH} {0}
+        set_instance_parameter_value dc_fifo_1 {ERROR_WIDTH} {0}
+        set_instance_parameter_value dc_fifo_1 {USE_PACKETS} {1}
+        set_instance_parameter_value dc_fifo_1 {USE_IN_FILL_LEVEL} {0}
+        set_instance_parameter_value dc_fifo_1 {USE_OUT_FILL_LEVEL} {0}
+        set_instance_parameter_value dc_fifo_1 {WR_SYNC_DEPTH} {3}
+        set_instance_parameter_value dc_fifo_1 {RD_SYNC_DEPTH} {3}
+        set_instance_parameter_value dc_fifo_1 {ENABLE_EXPLICIT_MAXCHANNEL} {0}
+        set_instance_parameter_value dc_fifo_1 {EXPLICIT_MAXCHANNEL} {0}
+
+        add_instance msgdma_1 altera_msgdma 15.1
+        set_instance_parameter_value msgdma_1 {MODE} {2}
+        set_instance_parameter_value msgdma_1 {DATA_WIDTH} $MSGDMA_DATA_WIDTH
+        set_instance_parameter_value msgdma_1 {USE_FIX_ADDRESS_WIDTH} {0}
+        set_instance_parameter_value msgdma_1 {FIX_ADDRESS_WIDTH} {32}
+        set_instance_parameter_value msgdma_1 {DATA_FIFO_DEPTH} $MSGDMA_DATA_FIFO_DEPTH
+        set_instance_parameter_value msgdma_1 {DESCRIPTOR_FIFO_DEPTH} $MSGDMA_DESCRIPTOR_FIFO_DEPTH
+        set_instance_parameter_value msgdma_1 {RESPONSE_PORT} {2}
+        set_instance_parameter_value msgdma_1 {MAX_BYTE} $MSGDMA_MAX_BYTE
+        set_instance_parameter_value msgdma_1 {TRANSFER_TYPE} {Aligned Accesses}
+        set_instance_parameter_value msgdma_1 {BURST_ENABLE} $MSGDMA_BURST_ENABLE
+        set_instance_parameter_value msgdma_1 {MAX_BURST_COUNT} $MSGDMA_MAX_BURST_COUNT
+        set_instance_parameter_value msgdma_1 {BURST_WRAPPING_SUPPORT} {0}
+        set_instance_parameter_value msgdma_1 {ENHANCED_FEATURES} $MSGDMA_ENHANCED_FEATURES
+        set_instance_parameter_value msgdma_1 {STRIDE_ENABLE} {0}
+        set_instance_parameter_value msgdma_1 {MAX_STRIDE} {1}
+        set_instance_parameter_value msgdma_1 {PROGRAMMABLE_BURST_ENABLE} $MSGDMA_PROGRAMMABLE_BURST_ENABLE
+        set_instance_parameter_value msgdma_1 {PACKET_ENABLE} {1}
+        set_instance_parameter_value msgdma_1 {ERROR_ENABLE} {0}
+        set_instance_parameter_value msgdma_1 {ERROR_WIDTH} {8}
+        set_instance_parameter_value msgdma_1 {CHANNEL_ENABLE} {0}
+        set_instance_parameter_value msgdma_1 {CHANNEL_WIDTH} {8}
+        set_instance_parameter_value msgdma_1 {PREFETCHER_ENABLE} {0}
+        set_instance_parameter_value msgdma_1 {PREFETCHER_READ_BURST_ENABLE} {0}
+        set_instance_parameter_value msgdma_1 {PREFETCHER_DATA_WIDTH} {32}
+        set_instance_parameter_value msgdma_1 {PREFETCHER_MAX_READ_BURST_COUNT} {2}
+    }
+
     # connections and connection parameters
     add_connection mm_bridge_0.m0 cmos_sensor_input_0.avalon_slave avalon
     set_connection_parameter_value mm_bridge_0.m0/cmos_sensor_input_0.avalon_slave arbitrationPriority {1}
-    set_connection_parameter_value mm_bridge_0.m0/cmos_sensor_input_0.avalon_slave baseAddress {0x0030}
+    set_connection_parameter_value mm_bridge_0.m0/cmos_sensor_input_0.avalon_slave baseAddress {0x0080}
     set_connection_parameter_value mm_bridge_0.m0/cmos_sensor_input_0.avalon_slave defaultConnection {0}
 
     add_connection mm_bridge_0.m0 msgdma_0.csr avalon
@@ -134,6 +209,34 @@ proc compose {} {
 
     add_connection dc_fifo_0.out msgdma_0.st_sink avalon_streaming
 
+    if {$CMOS_SENSOR_INPUT_PREVIEW_ENABLE} {
+        add_connection mm_bridge_0.m0 msgdma_1.csr avalon
+        set_connection_parameter_value mm_bridge_0.m0/msgdma_1.csr arbitrationPriority {1}
+        set_connection_parameter_value mm_bridge_0.m0/msgdma_1.csr baseAddress {0x0040}
+        set_connection_parameter_value mm_bridge_0.m0/msgdma_1.csr defaultConnection {0}
+
+        add_connection mm_bridge_0.m0 msgdma_1.descriptor_slave avalon
+        set_connection_parameter_value mm_bridge_0.m0/msgdma_1.descriptor_slave arbitrationPriority {1}
+        set_connection_parameter_value mm_bridge_0.m0/msgdma_1.descriptor_slave baseAddress {0x0060}
+        set_connection_parameter_value mm_bridge_0.m0/msgdma_1.descriptor_slave defaultConnection {0}
+
+        add_connection cmos_sensor_input_0.avalon_streaming_source_preview dc_fifo_1.in avalon_streaming
+
+        add_connection dc_fifo_1.out msgdma_1.st_sink avalon_streaming
+
+        add_connection clk_out.clk msgdma_1.clock clock
+
+        add_connection clk_in.clk dc_fifo_1.in_clk clock
+
+        add_connection clk_out.clk dc_fifo_1.out_clk clock
+
+        add_connection clk_in.clk_reset dc_fifo_1.in_clk_reset reset
+
+        add_connection clk_out.clk_reset dc_fifo_1.out_clk_reset reset
+
+        add_connection clk_out.clk_reset msgdma_1.reset_n reset
+    }
+
     add_connection clk_out.clk mm_bridge_0.clk clock
 
     add_connection clk_out.clk msgdma_0.clock clock
@@ -173,6 +276,12 @@ proc compose {} {
     set_interface_property cmos_sensor_input_irq EXPORT_OF cmos_sensor_input_0.interrupt_sender
     add_interface msgdma_csr_irq interrupt sender
     set_interface_property msgdma_csr_irq EXPORT_OF msgdma_0.csr_irq
+    if {$CMOS_SENSOR_INPUT_PREVIEW_ENABLE} {
+        add_interface avalon_master_preview avalon master
+        set_interface_property avalon_master_preview EXPORT_OF msgdma_1.mm_write
+        add_interface msgdma_preview_csr_irq interrupt sender
+        set_interface_property msgdma_preview_csr_irq EXPORT_OF msgdma_1.csr_irq
+    }
 
     # interconnect requirements
     set_interconnect_requirement {$system} {qsys_mm.clockCrossingAdapter} {HANDSHAKE}
@@ -257,6 +366,51 @@ set_parameter_property CMOS_SENSOR_INPUT_DEVICE_FAMILY DESCRIPTION "Target FPGA
 set_parameter_property CMOS_SENSOR_INPUT_DEVICE_FAMILY HDL_PARAMETER true
 set_parameter_property CMOS_SENSOR_INPUT_DEVICE_FAMILY GROUP "CMOS Sensor Input"
 
+add_parameter CMOS_SENSOR_INPUT_DOWNSCALER_ENABLE BOOLEAN FALSE "Enable Bayer-preserving 2x2 / 4x4 downscaling (binning or decimation)"
+set_parameter_property CMOS_SENSOR_INPUT_DOWNSCALER_ENABLE DISPLAY_NAME "Enable Downscaler"
+set_parameter_property CMOS_SENSOR_INPUT_DOWNSCALER_ENABLE TYPE BOOLEAN
+set_parameter_property CMOS_SENSOR_INPUT_DOWNSCALER_ENABLE UNITS None
+set_parameter_property CMOS_SENSOR_INPUT_DOWNSCALER_ENABLE ALLOWED_RANGES {}
+set_parameter_property CMOS_SENSOR_INPUT_DOWNSCALER_ENABLE DESCRIPTION "Enable Bayer-preserving 2x2 / 4x4 downscaling (binning or decimation)"
+set_parameter_property CMOS_SENSOR_INPUT_DOWNSCALER_ENABLE HDL_PARAMETER true
+set_parameter_property CMOS_SENSOR_INPUT_DOWNSCALER_ENABLE GROUP "CMOS Sensor Input"
+
+add_parameter CMOS_SENSOR_INPUT_PREVIEW_ENABLE BOOLEAN FALSE "Output the downscaled frame on a second Avalon-ST source, and the full resolution frame on the main one"
+set_parameter_property CMOS_SENSOR_INPUT_PREVIEW_ENABLE DISPLAY_NAME "Enable Preview Stream"
+set_parameter_property CMOS_SENSOR_INPUT_PREVIEW_ENABLE TYPE BOOLEAN
+set_parameter_property CMOS_SENSOR_INPUT_PREVIEW_ENABLE UNITS None
+set_parameter_property CMOS_SENSOR_INPUT_PREVIEW_ENABLE ALLOWED_RANGES {}
+set_parameter_property CMOS_SENSOR_INPUT_PREVIEW_ENABLE DESCRIPTION "Output the downscaled frame on a second Avalon-ST source, and the full resolution frame on the main one"
+set_parameter_property CMOS_SENSOR_INPUT_PREVIEW_ENABLE HDL_PARAMETER true
+set_parameter_property CMOS_SENSOR_INPUT_PREVIEW_ENABLE GROUP "CMOS Sensor Input"
+
+add_parameter CMOS_SENSOR_INPUT_PLANAR_ENABLE BOOLEAN FALSE "Optionally split each raw frame row into its even and odd columns, so that the 4 Bayer channels can be written to separate planes"
+set_parameter_property CMOS_SENSOR_INPUT_PLANAR_ENABLE DISPLAY_NAME "Enable Bayer Plane Splitter"
+set_parameter_property CMOS_SENSOR_INPUT_PLANAR_ENABLE TYPE BOOLEAN
+set_parameter_property CMOS_SENSOR_INPUT_PLANAR_ENABLE UNITS None
+set_parameter_property CMOS_SENSOR_INPUT_PLANAR_ENABLE ALLOWED_RANGES {}
+set_parameter_property CMOS_SENSOR_INPUT_PLANAR_ENABLE DESCRIPTION "Optionally split each raw frame row into its even and odd columns, so that the 4 Bayer channels can be written to separate planes"
+set_parameter_property CMOS_SENSOR_INPUT_PLANAR_ENABLE HDL_PARAMETER true
+set_parameter_property CMOS_SENSOR_INPUT_PLANAR_ENABLE GROUP "CMOS Sensor Input"
+
+add_parameter CMOS_SENSOR_INPUT_DEPTH_REDUCER_ENABLE BOOLEAN FALSE "Optionally reduce each raw sample to REDUCED_PIX_DEPTH bits at runtime (by shifting, or through a lookup table), so that more pixels fit in each output word"
+set_parameter_property CMOS_SENSOR_INPUT_DEPTH_REDUCER_ENABLE DISPLAY_NAME "Enable Pixel Depth Reducer"
+set_parameter_property CMOS_SENSOR_INPUT_DEPTH_REDUCER_ENABLE TYPE BOOLEAN
+set_parameter_property CMOS_SENSOR_INPUT_DEPTH_REDUCER_ENABLE UNITS None
+set_parameter_property CMOS_SENSOR_INPUT_DEPTH_REDUCER_ENABLE ALLOWED_RANGES {}
+set_parameter_property CMOS_SENSOR_INPUT_DEPTH_REDUCER_ENABLE DESCRIPTION "Optionally reduce each raw sample to REDUCED_PIX_DEPTH bits at runtime (by shifting, or through a lookup table), so that more pixels fit in each output word"
+set_parameter_property CMOS_SENSOR_INPUT_DEPTH_REDUCER_ENABLE HDL_PARAMETER true
+set_parameter_property CMOS_SENSOR_INPUT_DEPTH_REDUCER_ENABLE GROUP "CMOS Sensor Input"
+
+add_parameter CMOS_SENSOR_INPUT_REDUCED_PIX_DEPTH POSITIVE 8 "Depth of each pixel sample once reduced by the depth reducer"
+set_parameter_property CMOS_SENSOR_INPUT_REDUCED_PIX_DEPTH DISPLAY_NAME "Reduced Pixel Depth"
+set_parameter_property CMOS_SENSOR_INPUT_REDUCED_PIX_DEPTH TYPE POSITIVE
+set_parameter_property CMOS_SENSOR_INPUT_REDUCED_PIX_DEPTH UNITS bits
+set_parameter_property CMOS_SENSOR_INPUT_REDUCED_PIX_DEPTH ALLOWED_RANGES {1:16}
+set_parameter_property CMOS_SENSOR_INPUT_REDUCED_PIX_DEPTH DESCRIPTION "Depth of each pixel sample once reduced by the depth reducer"
+set_parameter_property CMOS_SENSOR_INPUT_REDUCED_PIX_DEPTH HDL_PARAMETER true
+set_parameter_property CMOS_SENSOR_INPUT_REDUCED_PIX_DEPTH GROUP "CMOS Sensor Input"
+
 add_parameter CMOS_SENSOR_INPUT_DEBAYER_ENABLE BOOLEAN FALSE "Enable Debayering"
 set_parameter_property CMOS_SENSOR_INPUT_DEBAYER_ENABLE DISPLAY_NAME "Enable Debayering"
 set_parameter_property CMOS_SENSOR_INPUT_DEBAYER_ENABLE TYPE BOOLEAN
@@ -267,6 +421,15 @@ set_parameter_property CMOS_SENSOR_INPUT_DEBAYER_ENABLE HDL_PARAMETER true
 set_parameter_property CMOS_SENSOR_INPUT_DEBAYER_ENABLE ENABLED false
 set_parameter_property CMOS_SENSOR_INPUT_DEBAYER_ENABLE GROUP "CMOS Sensor Input"
 
+add_parameter CMOS_SENSOR_INPUT_COLOR_CONVERTER_ENABLE BOOLEAN FALSE "Optionally convert debayered pixels to RGB565, RGB888 or YCbCr 4:2:2 at runtime"
+set_parameter_property CMOS_SENSOR_INPUT_COLOR_CONVERTER_ENABLE DISPLAY_NAME "Enable Color Converter"
+set_parameter_property CMOS_SENSOR_INPUT_COLOR_CONVERTER_ENABLE TYPE BOOLEAN
+set_parameter_property CMOS_SENSOR_INPUT_COLOR_CONVERTER_ENABLE UNITS None
+set_parameter_property CMOS_SENSOR_INPUT_COLOR_CONVERTER_ENABLE ALLOWED_RANGES {}
+set_parameter_property CMOS_SENSOR_INPUT_COLOR_CONVERTER_ENABLE DESCRIPTION "Optionally convert debayered pixels to RGB565, RGB888 or YCbCr 4:2:2 at runtime"
+set_parameter_property CMOS_SENSOR_INPUT_COLOR_CONVERTER_ENABLE HDL_PARAMETER true
+set_parameter_property CMOS_SENSOR_INPUT_COLOR_CONVERTER_ENABLE GROUP "CMOS Sensor Input"
+
 add_parameter CMOS_SENSOR_INPUT_PACKER_ENABLE BOOLEAN FALSE "Enable packing of multiple pixels into a single output word of size OUTPUT_WIDTH"
 set_parameter_property CMOS_SENSOR_INPUT_PACKER_ENABLE DISPLAY_NAME "Enable Pixel Packer"
 set_parameter_property CMOS_SENSOR_INPUT_PACKER_ENABLE TYPE BOOLEAN
@@ -276,6 +439,78 @@ set_parameter_property CMOS_SENSOR_INPUT_PACKER_ENABLE DESCRIPTION "Enable packi
 set_parameter_property CMOS_SENSOR_INPUT_PACKER_ENABLE HDL_PARAMETER true
 set_parameter_property CMOS_SENSOR_INPUT_PACKER_ENABLE GROUP "CMOS Sensor Input"
 
+add_parameter CMOS_SENSOR_INPUT_STAGE_COUNT NATURAL 0 "Number of processing stages applied to the raw bayer stream, before the plane splitter and the debayer"
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_COUNT DISPLAY_NAME "Processing Stage Count"
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_COUNT TYPE NATURAL
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_COUNT UNITS None
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_COUNT ALLOWED_RANGES {0:4}
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_COUNT DESCRIPTION "Number of processing stages applied to the raw bayer stream, before the plane splitter and the debayer"
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_COUNT HDL_PARAMETER true
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_COUNT GROUP "CMOS Sensor Input"
+
+add_parameter CMOS_SENSOR_INPUT_STAGE_0_TYPE STRING GAIN "Type of processing stage 0"
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_0_TYPE DISPLAY_NAME "Processing Stage 0 Type"
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_0_TYPE TYPE STRING
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_0_TYPE UNITS None
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_0_TYPE ALLOWED_RANGES {GAIN CONV3X3}
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_0_TYPE DESCRIPTION "Type of processing stage 0"
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_0_TYPE HDL_PARAMETER true
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_0_TYPE GROUP "CMOS Sensor Input"
+
+add_parameter CMOS_SENSOR_INPUT_STAGE_1_TYPE STRING GAIN "Type of processing stage 1"
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_1_TYPE DISPLAY_NAME "Processing Stage 1 Type"
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_1_TYPE TYPE STRING
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_1_TYPE UNITS None
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_1_TYPE ALLOWED_RANGES {GAIN CONV3X3}
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_1_TYPE DESCRIPTION "Type of processing stage 1"
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_1_TYPE HDL_PARAMETER true
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_1_TYPE GROUP "CMOS Sensor Input"
+
+add_parameter CMOS_SENSOR_INPUT_STAGE_2_TYPE STRING GAIN "Type of processing stage 2"
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_2_TYPE DISPLAY_NAME "Processing Stage 2 Type"
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_2_TYPE TYPE STRING
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_2_TYPE UNITS None
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_2_TYPE ALLOWED_RANGES {GAIN CONV3X3}
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_2_TYPE DESCRIPTION "Type of processing stage 2"
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_2_TYPE HDL_PARAMETER true
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_2_TYPE GROUP "CMOS Sensor Input"
+
+add_parameter CMOS_SENSOR_INPUT_STAGE_3_TYPE STRING GAIN "Type of processing stage 3"
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_3_TYPE DISPLAY_NAME "Processing Stage 3 Type"
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_3_TYPE TYPE STRING
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_3_TYPE UNITS None
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_3_TYPE ALLOWED_RANGES {GAIN CONV3X3}
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_3_TYPE DESCRIPTION "Type of processing stage 3"
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_3_TYPE HDL_PARAMETER true
+set_parameter_property CMOS_SENSOR_INPUT_STAGE_3_TYPE GROUP "CMOS Sensor Input"
+
+add_parameter CMOS_SENSOR_INPUT_BLOB_COUNT NATURAL 0 "Maximum number of blobs (groups of pixels above a threshold) whose statistics are computed per frame, 0 disables the blob unit"
+set_parameter_property CMOS_SENSOR_INPUT_BLOB_COUNT DISPLAY_NAME "Blob Count"
+set_parameter_property CMOS_SENSOR_INPUT_BLOB_COUNT TYPE NATURAL
+set_parameter_property CMOS_SENSOR_INPUT_BLOB_COUNT UNITS None
+set_parameter_property CMOS_SENSOR_INPUT_BLOB_COUNT ALLOWED_RANGES {0:8}
+set_parameter_property CMOS_SENSOR_INPUT_BLOB_COUNT DESCRIPTION "Maximum number of blobs (groups of pixels above a threshold) whose statistics are computed per frame, 0 disables the blob unit"
+set_parameter_property CMOS_SENSOR_INPUT_BLOB_COUNT HDL_PARAMETER true
+set_parameter_property CMOS_SENSOR_INPUT_BLOB_COUNT GROUP "CMOS Sensor Input"
+
+add_parameter CMOS_SENSOR_INPUT_SPARSE_ENABLE BOOLEAN FALSE "Optionally output only the pixels above a threshold, as one (x, y, value) record per output word followed by an end-of-frame marker"
+set_parameter_property CMOS_SENSOR_INPUT_SPARSE_ENABLE DISPLAY_NAME "Enable Sparse Output"
+set_parameter_property CMOS_SENSOR_INPUT_SPARSE_ENABLE TYPE BOOLEAN
+set_parameter_property CMOS_SENSOR_INPUT_SPARSE_ENABLE UNITS None
+set_parameter_property CMOS_SENSOR_INPUT_SPARSE_ENABLE ALLOWED_RANGES {}
+set_parameter_property CMOS_SENSOR_INPUT_SPARSE_ENABLE DESCRIPTION "Optionally output only the pixels above a threshold, as one (x, y, value) record per output word followed by an end-of-frame marker"
+set_parameter_property CMOS_SENSOR_INPUT_SPARSE_ENABLE HDL_PARAMETER true
+set_parameter_property CMOS_SENSOR_INPUT_SPARSE_ENABLE GROUP "CMOS Sensor Input"
+
+add_parameter CMOS_SENSOR_INPUT_COMPRESSOR_ENABLE BOOLEAN FALSE "Optionally replace the raw output by a lossless bitstream of adaptive Golomb-Rice codes of per-Bayer-channel horizontal deltas"
+set_parameter_property CMOS_SENSOR_INPUT_COMPRESSOR_ENABLE DISPLAY_NAME "Enable Lossless Compressor"
+set_parameter_property CMOS_SENSOR_INPUT_COMPRESSOR_ENABLE TYPE BOOLEAN
+set_parameter_property CMOS_SENSOR_INPUT_COMPRESSOR_ENABLE UNITS None
+set_parameter_property CMOS_SENSOR_INPUT_COMPRESSOR_ENABLE ALLOWED_RANGES {}
+set_parameter_property CMOS_SENSOR_INPUT_COMPRESSOR_ENABLE DESCRIPTION "Optionally replace the raw output by a lossless bitstream of adaptive Golomb-Rice codes of per-Bayer-channel horizontal deltas"
+set_parameter_property CMOS_SENSOR_INPUT_COMPRESSOR_ENABLE HDL_PARAMETER true
+set_parameter_property CMOS_SENSOR_INPUT_COMPRESSOR_ENABLE GROUP "CMOS Sensor Input"
+
 #
 # dc_fifo parameters
 #
@@ -356,6 +591,24 @@ set_parameter_property MSGDMA_MAX_BURST_COUNT DERIVED false
 set_parameter_property MSGDMA_MAX_BURST_COUNT AFFECTS_ELABORATION true
 set_parameter_property MSGDMA_MAX_BURST_COUNT GROUP "Modular Scatter-Gather DMA"
 
+add_parameter MSGDMA_ENHANCED_FEATURES INTEGER 0 "Enable the extended descriptor format (sequence numbers and programmable burst counts)."
+set_parameter_property MSGDMA_ENHANCED_FEATURES DISPLAY_NAME "Enable Extended Feature Support"
+set_parameter_property MSGDMA_ENHANCED_FEATURES DISPLAY_HINT boolean
+set_parameter_property MSGDMA_ENHANCED_FEATURES AFFECTS_GENERATION true
+set_parameter_property MSGDMA_ENHANCED_FEATURES HDL_PARAMETER false
+set_parameter_property MSGDMA_ENHANCED_FEATURES DERIVED false
+set_parameter_property MSGDMA_ENHANCED_FEATURES AFFECTS_ELABORATION true
+set_parameter_property MSGDMA_ENHANCED_FEATURES GROUP "Modular Scatter-Gather DMA"
+
+add_parameter MSGDMA_PROGRAMMABLE_BURST_ENABLE INTEGER 0 "Allow the burst count to be set per descriptor (requires extended feature support)."
+set_parameter_property MSGDMA_PROGRAMMABLE_BURST_ENABLE DISPLAY_NAME "Programmable Burst Enable"
+set_parameter_property MSGDMA_PROGRAMMABLE_BURST_ENABLE DISPLAY_HINT boolean
+set_parameter_property MSGDMA_PROGRAMMABLE_BURST_ENABLE AFFECTS_GENERATION true
+set_parameter_property MSGDMA_PROGRAMMABLE_BURST_ENABLE HDL_PARAMETER false
+set_parameter_property MSGDMA_PROGRAMMABLE_BURST_ENABLE DERIVED false
+set_parameter_property MSGDMA_PROGRAMMABLE_BURST_ENABLE AFFECTS_ELABORATION true
+set_parameter_property MSGDMA_PROGRAMMABLE_BURST_ENABLE GROUP "Modular Scatter-Gather DMA"
+
 #
 # clk_out parameters
 #
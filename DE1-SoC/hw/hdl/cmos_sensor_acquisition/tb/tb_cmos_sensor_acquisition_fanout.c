@@ -0,0 +1,199 @@
+/*
+ * tb_cmos_sensor_acquisition_fanout.c
+ *
+ * Host test of the frame dispatcher of the HAL with worker threads
+ * (cmos_sensor_acquisition_fanout.c, CMOS_SENSOR_ACQUISITION_FANOUT_THREADS).
+ * A producer dispatches frames to a fast consumer, and to a slow one which
+ * also retains some frames beyond its callback. Checks that no frame is
+ * recycled while a consumer holds it, that the producer always finds a free
+ * frame, that every frame is either handled or dropped by each consumer, and
+ * that all frames are back in the pool at the end.
+ *
+ * Build and run from this directory:
+ *
+ *   gcc -std=gnu99 -Wall -pthread -I../HAL -I../../cmos_sensor_input/HAL -I../../msgdma/HAL -o tb_cmos_sensor_acquisition_fanout tb_cmos_sensor_acquisition_fanout.c ../HAL/cmos_sensor_acquisition_fanout.c ../HAL/cmos_sensor_acquisition_frame_pool.c
+ *   ./tb_cmos_sensor_acquisition_fanout
+ *
+ * Also worth running with -fsanitize=thread.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "cmos_sensor_acquisition_fanout.h"
+
+#if !defined(CMOS_SENSOR_ACQUISITION_FANOUT_THREADS)
+#error "the dispatcher must be built with threads"
+#endif
+
+#define FRAME_COUNT  (200)
+#define FRAME_WORDS  (1024)
+#define FAST_DEPTH   (2)
+#define SLOW_DEPTH   (3)
+#define RETAIN_EVERY (4)
+
+/* sum of the queue depths, plus the frame each consumer is handling, the frame
+ * the slow consumer retains and the producer's frame */
+#define POOL_FRAMES  (FAST_DEPTH + SLOW_DEPTH + 2 + 1 + 1)
+
+/* state of a consumer, only accessed from its worker thread */
+typedef struct consumer_state {
+    const char                    *name;
+    useconds_t                    delay;    /* Time spent on each frame */
+    bool                          retain;   /* Keeps every RETAIN_EVERY-th frame until the next one */
+    cmos_sensor_acquisition_frame *kept;    /* Frame retained from a previous callback */
+    int64_t                       last;     /* Sequence of the previous frame, -1 before the first one */
+    uint32_t                      errors;   /* Number of failed checks */
+} consumer_state;
+
+/*
+ * check_frame
+ *
+ * Returns true if every word of frame holds its sequence number, as written by
+ * the producer.
+ */
+static bool check_frame(const cmos_sensor_acquisition_frame *frame) {
+    const uint32_t *words = frame->data;
+
+    if (frame->size != FRAME_WORDS * sizeof(uint32_t)) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < FRAME_WORDS; i++) {
+        if (words[i] != frame->sequence) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * consume
+ *
+ * Callback of both consumers.
+ */
+static void consume(cmos_sensor_acquisition_frame *frame, void *context) {
+    consumer_state *state = context;
+
+    if ((int64_t) frame->sequence <= state->last) {
+        fprintf(stderr, "%s: frame %u after frame %lld\n", state->name, frame->sequence, (long long) state->last);
+        state->errors++;
+    }
+    state->last = frame->sequence;
+
+    if (!check_frame(frame)) {
+        fprintf(stderr, "%s: frame %u corrupted on entry\n", state->name, frame->sequence);
+        state->errors++;
+    }
+
+    if (state->delay != 0) {
+        usleep(state->delay);
+    }
+
+    /* the producer must not have reused the frame in the meantime */
+    if (!check_frame(frame)) {
+        fprintf(stderr, "%s: frame %u recycled while held\n", state->name, frame->sequence);
+        state->errors++;
+    }
+
+    if (state->kept != NULL) {
+        if (!check_frame(state->kept)) {
+            fprintf(stderr, "%s: retained frame %u recycled\n", state->name, state->kept->sequence);
+            state->errors++;
+        }
+
+        cmos_sensor_acquisition_fanout_release(state->kept);
+        state->kept = NULL;
+    }
+
+    if (state->retain && (frame->sequence % RETAIN_EVERY) == 0) {
+        cmos_sensor_acquisition_fanout_retain(frame);
+        state->kept = frame;
+    }
+}
+
+int main(void) {
+    cmos_sensor_acquisition_frame_pool pool;
+    static cmos_sensor_acquisition_fanout fanout;
+    consumer_state fast = {.name = "fast", .delay = 0, .retain = false, .kept = NULL, .last = -1, .errors = 0};
+    consumer_state slow = {.name = "slow", .delay = 2000, .retain = true, .kept = NULL, .last = -1, .errors = 0};
+    uint32_t dispatched = 0;
+    uint32_t failed = 0;
+
+    if (!cmos_sensor_acquisition_frame_pool_init(&pool, FRAME_WORDS * sizeof(uint32_t), POOL_FRAMES, 64, false) ||
+        !cmos_sensor_acquisition_fanout_init(&fanout, &pool) ||
+        !cmos_sensor_acquisition_fanout_add_consumer(&fanout, consume, &fast, FAST_DEPTH) ||
+        !cmos_sensor_acquisition_fanout_add_consumer(&fanout, consume, &slow, SLOW_DEPTH) ||
+        !cmos_sensor_acquisition_fanout_start(&fanout)) {
+        fprintf(stderr, "setup failed\n");
+        return EXIT_FAILURE;
+    }
+
+    for (uint32_t sequence = 0; sequence < FRAME_COUNT; sequence++) {
+        cmos_sensor_acquisition_frame *frame = cmos_sensor_acquisition_fanout_acquire(&fanout);
+        if (frame == NULL) {
+            fprintf(stderr, "producer: no free frame for frame %u\n", sequence);
+            failed++;
+            break;
+        }
+
+        uint32_t *words = frame->data;
+        for (uint32_t i = 0; i < FRAME_WORDS; i++) {
+            words[i] = sequence;
+        }
+
+        cmos_sensor_acquisition_fanout_dispatch(&fanout, frame, FRAME_WORDS * sizeof(uint32_t), sequence);
+        dispatched++;
+
+        /* a capture takes some time */
+        usleep(200);
+    }
+
+    cmos_sensor_acquisition_fanout_stop(&fanout);
+
+    /* the worker threads are joined: the consumers' state can be read */
+    if (slow.kept != NULL) {
+        cmos_sensor_acquisition_fanout_release(slow.kept);
+        slow.kept = NULL;
+    }
+
+    const consumer_state *states[] = {&fast, &slow};
+    for (uint32_t i = 0; i < 2; i++) {
+        const cmos_sensor_acquisition_fanout_consumer *consumer = &fanout.consumers[i];
+
+        printf("%s: %llu frames handled, %llu dropped\n", states[i]->name,
+               (unsigned long long) consumer->processed, (unsigned long long) consumer->dropped);
+
+        if (consumer->processed + consumer->dropped != dispatched) {
+            fprintf(stderr, "%s: frames lost\n", states[i]->name);
+            failed++;
+        }
+
+        if (consumer->processed == 0) {
+            fprintf(stderr, "%s: no frame handled\n", states[i]->name);
+            failed++;
+        }
+
+        failed += states[i]->errors;
+    }
+
+    uint32_t all_free = (POOL_FRAMES == 32) ? 0xffffffff : ((1u << POOL_FRAMES) - 1);
+    if (pool.free_mask != all_free) {
+        fprintf(stderr, "frames not returned to the pool: free mask 0x%08x\n", pool.free_mask);
+        failed++;
+    }
+
+    cmos_sensor_acquisition_frame_pool_destroy(&pool);
+
+    if (failed != 0) {
+        printf("FAILED\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("PASSED\n");
+    return EXIT_SUCCESS;
+}
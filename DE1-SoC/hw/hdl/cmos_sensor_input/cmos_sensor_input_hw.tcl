@@ -17,13 +17,92 @@ set_module_property REPORT_TO_TALKBACK false
 set_module_property ALLOW_GREYBOX_GENERATION false
 set_module_property REPORT_HIERARCHY false
 set_module_property VALIDATION_CALLBACK validate
+set_module_property ELABORATION_CALLBACK elaborate
 
 
 proc validate {} {
     set pix_depth [get_parameter_value PIX_DEPTH]
     set output_width [get_parameter_value OUTPUT_WIDTH]
     set debayer_enable [get_parameter_value DEBAYER_ENABLE]
+    set color_converter_enable [get_parameter_value COLOR_CONVERTER_ENABLE]
     set packer_enable [get_parameter_value PACKER_ENABLE]
+    set downscaler_enable [get_parameter_value DOWNSCALER_ENABLE]
+    set preview_enable [get_parameter_value PREVIEW_ENABLE]
+    set planar_enable [get_parameter_value PLANAR_ENABLE]
+    set depth_reducer_enable [get_parameter_value DEPTH_REDUCER_ENABLE]
+    set reduced_pix_depth [get_parameter_value REDUCED_PIX_DEPTH]
+    set stage_count [get_parameter_value STAGE_COUNT]
+    set sparse_enable [get_parameter_value SPARSE_ENABLE]
+    set compressor_enable [get_parameter_value COMPRESSOR_ENABLE]
+    set max_width [get_parameter_value MAX_WIDTH]
+    set max_height [get_parameter_value MAX_HEIGHT]
+
+    # only the type of the stages that are instantiated can be selected
+    for {set i 0} {$i < 4} {incr i} {
+        set_parameter_property STAGE_${i}_TYPE ENABLED [expr $i < $stage_count]
+    }
+
+    # the preview stream carries the output of the downscaler
+    if {[expr $preview_enable && !$downscaler_enable]} {
+        send_message error "PREVIEW_ENABLE requires DOWNSCALER_ENABLE"
+    }
+
+    # the plane splitter only operates on raw bayer frames
+    if {[expr $planar_enable && $debayer_enable]} {
+        send_message error "PLANAR_ENABLE cannot be used with DEBAYER_ENABLE"
+    }
+
+    # the depth reducer only operates on raw bayer frames, and its lut holds one entry per possible sample value
+    if {$depth_reducer_enable} {
+        if {$debayer_enable} {
+            send_message error "DEPTH_REDUCER_ENABLE cannot be used with DEBAYER_ENABLE"
+        }
+        if {[expr $pix_depth > 16]} {
+            send_message error "DEPTH_REDUCER_ENABLE requires PIX_DEPTH to be smaller or equal to 16"
+        }
+        if {[expr $reduced_pix_depth >= $pix_depth]} {
+            send_message error "REDUCED_PIX_DEPTH must be smaller than PIX_DEPTH"
+        }
+    }
+
+    # the color converter operates on debayered frames, and outputs up to 24-bit pixels (RGB888)
+    if {$color_converter_enable} {
+        if {!$debayer_enable} {
+            send_message error "COLOR_CONVERTER_ENABLE requires DEBAYER_ENABLE"
+        }
+        if {[expr !$packer_enable && $output_width < 24]} {
+            send_message error "COLOR_CONVERTER_ENABLE requires OUTPUT_WIDTH to be larger or equal to 24"
+        }
+        if {[expr $packer_enable && $output_width < 48]} {
+            send_message error "COLOR_CONVERTER_ENABLE requires OUTPUT_WIDTH to be larger or equal to 48 if PACKER_ENABLE is set"
+        }
+    }
+
+    # the sparse unit only operates on raw bayer frames, and each (x, y, value) record must fit in one output word
+    if {$sparse_enable} {
+        if {$debayer_enable} {
+            send_message error "SPARSE_ENABLE cannot be used with DEBAYER_ENABLE"
+        }
+        set coord_width [expr int(ceil(log([expr max($max_width, $max_height) + 1]) / log(2)))]
+        set min_output_width_sparse [expr $pix_depth + 2 * $coord_width]
+        if {[expr $output_width < $min_output_width_sparse]} {
+            send_message error "SPARSE_ENABLE requires OUTPUT_WIDTH to be larger or equal to $min_output_width_sparse"
+        }
+    }
+
+    # the compressor only operates on raw bayer frames, and an escape code (8 ones and a raw pixel) must fit in one output word
+    if {$compressor_enable} {
+        if {$debayer_enable} {
+            send_message error "COMPRESSOR_ENABLE cannot be used with DEBAYER_ENABLE"
+        }
+        if {[expr $pix_depth > 16]} {
+            send_message error "COMPRESSOR_ENABLE requires PIX_DEPTH to be smaller or equal to 16"
+        }
+        set min_output_width_compressor [expr $pix_depth + 8]
+        if {[expr $output_width < $min_output_width_compressor]} {
+            send_message error "COMPRESSOR_ENABLE requires OUTPUT_WIDTH to be larger or equal to $min_output_width_compressor"
+        }
+    }
 
     set min_output_width_debayer_disable_packer_disable [expr 1 * $pix_depth]
 
@@ -56,12 +135,29 @@ proc validate {} {
 
     set_module_assignment embeddedsw.CMacro.PIX_DEPTH $pix_depth
     set_module_assignment embeddedsw.CMacro.SAMPLE_EDGE [get_parameter_value SAMPLE_EDGE]
-    set_module_assignment embeddedsw.CMacro.MAX_WIDTH [get_parameter_value MAX_WIDTH]
-    set_module_assignment embeddedsw.CMacro.MAX_HEIGHT [get_parameter_value MAX_HEIGHT]
+    set_module_assignment embeddedsw.CMacro.MAX_WIDTH $max_width
+    set_module_assignment embeddedsw.CMacro.MAX_HEIGHT $max_height
     set_module_assignment embeddedsw.CMacro.OUTPUT_WIDTH [get_parameter_value OUTPUT_WIDTH]
     set_module_assignment embeddedsw.CMacro.FIFO_DEPTH [get_parameter_value FIFO_DEPTH]
+    set_module_assignment embeddedsw.CMacro.DOWNSCALER_ENABLE [get_parameter_value DOWNSCALER_ENABLE]
+    set_module_assignment embeddedsw.CMacro.PREVIEW_ENABLE [get_parameter_value PREVIEW_ENABLE]
+    set_module_assignment embeddedsw.CMacro.PLANAR_ENABLE [get_parameter_value PLANAR_ENABLE]
+    set_module_assignment embeddedsw.CMacro.DEPTH_REDUCER_ENABLE [get_parameter_value DEPTH_REDUCER_ENABLE]
+    set_module_assignment embeddedsw.CMacro.REDUCED_PIX_DEPTH [get_parameter_value REDUCED_PIX_DEPTH]
     set_module_assignment embeddedsw.CMacro.DEBAYER_ENABLE [get_parameter_value DEBAYER_ENABLE]
+    set_module_assignment embeddedsw.CMacro.COLOR_CONVERTER_ENABLE [get_parameter_value COLOR_CONVERTER_ENABLE]
     set_module_assignment embeddedsw.CMacro.PACKER_ENABLE [get_parameter_value PACKER_ENABLE]
+    set_module_assignment embeddedsw.CMacro.STAGE_COUNT $stage_count
+    set_module_assignment embeddedsw.CMacro.BLOB_COUNT [get_parameter_value BLOB_COUNT]
+    set_module_assignment embeddedsw.CMacro.SPARSE_ENABLE $sparse_enable
+    set_module_assignment embeddedsw.CMacro.COMPRESSOR_ENABLE $compressor_enable
+}
+
+proc elaborate {} {
+    # the preview source only exists if the preview stream is enabled
+    if {![get_parameter_value PREVIEW_ENABLE]} {
+        set_interface_property avalon_streaming_source_preview ENABLED false
+    }
 }
 
 
@@ -77,7 +173,18 @@ add_fileset_file cmos_sensor_input_avalon_mm_slave.vhd VHDL PATH hdl/cmos_sensor
 add_fileset_file cmos_sensor_input_synchronizer.vhd VHDL PATH hdl/cmos_sensor_input_synchronizer.vhd
 add_fileset_file cmos_sensor_input_sampler.vhd VHDL PATH hdl/cmos_sensor_input_sampler.vhd
 add_fileset_file cmos_sensor_input_sc_fifo.vhd VHDL PATH hdl/cmos_sensor_input_sc_fifo.vhd
+add_fileset_file cmos_sensor_input_downscaler.vhd VHDL PATH hdl/cmos_sensor_input_downscaler.vhd
+add_fileset_file cmos_sensor_input_stage_conv3x3.vhd VHDL PATH hdl/cmos_sensor_input_stage_conv3x3.vhd
+add_fileset_file cmos_sensor_input_stage_gain.vhd VHDL PATH hdl/cmos_sensor_input_stage_gain.vhd
+add_fileset_file cmos_sensor_input_stage.vhd VHDL PATH hdl/cmos_sensor_input_stage.vhd
+add_fileset_file cmos_sensor_input_stage_chain.vhd VHDL PATH hdl/cmos_sensor_input_stage_chain.vhd
+add_fileset_file cmos_sensor_input_blob.vhd VHDL PATH hdl/cmos_sensor_input_blob.vhd
+add_fileset_file cmos_sensor_input_planar.vhd VHDL PATH hdl/cmos_sensor_input_planar.vhd
+add_fileset_file cmos_sensor_input_depth_reducer.vhd VHDL PATH hdl/cmos_sensor_input_depth_reducer.vhd
+add_fileset_file cmos_sensor_input_sparse.vhd VHDL PATH hdl/cmos_sensor_input_sparse.vhd
+add_fileset_file cmos_sensor_input_compressor.vhd VHDL PATH hdl/cmos_sensor_input_compressor.vhd
 add_fileset_file cmos_sensor_input_debayer.vhd VHDL PATH hdl/cmos_sensor_input_debayer.vhd
+add_fileset_file cmos_sensor_input_color_converter.vhd VHDL PATH hdl/cmos_sensor_input_color_converter.vhd
 add_fileset_file cmos_sensor_input_packer.vhd VHDL PATH hdl/cmos_sensor_input_packer.vhd
 add_fileset_file cmos_sensor_input_avalon_st_source.vhd VHDL PATH hdl/cmos_sensor_input_avalon_st_source.vhd
 add_fileset_file cmos_sensor_input.vhd VHDL PATH hdl/cmos_sensor_input.vhd TOP_LEVEL_FILE
@@ -91,7 +198,18 @@ add_fileset_file cmos_sensor_input_avalon_mm_slave.vhd VHDL PATH hdl/cmos_sensor
 add_fileset_file cmos_sensor_input_synchronizer.vhd VHDL PATH hdl/cmos_sensor_input_synchronizer.vhd
 add_fileset_file cmos_sensor_input_sampler.vhd VHDL PATH hdl/cmos_sensor_input_sampler.vhd
 add_fileset_file cmos_sensor_input_sc_fifo.vhd VHDL PATH hdl/cmos_sensor_input_sc_fifo.vhd
+add_fileset_file cmos_sensor_input_downscaler.vhd VHDL PATH hdl/cmos_sensor_input_downscaler.vhd
+add_fileset_file cmos_sensor_input_stage_conv3x3.vhd VHDL PATH hdl/cmos_sensor_input_stage_conv3x3.vhd
+add_fileset_file cmos_sensor_input_stage_gain.vhd VHDL PATH hdl/cmos_sensor_input_stage_gain.vhd
+add_fileset_file cmos_sensor_input_stage.vhd VHDL PATH hdl/cmos_sensor_input_stage.vhd
+add_fileset_file cmos_sensor_input_stage_chain.vhd VHDL PATH hdl/cmos_sensor_input_stage_chain.vhd
+add_fileset_file cmos_sensor_input_blob.vhd VHDL PATH hdl/cmos_sensor_input_blob.vhd
+add_fileset_file cmos_sensor_input_planar.vhd VHDL PATH hdl/cmos_sensor_input_planar.vhd
+add_fileset_file cmos_sensor_input_depth_reducer.vhd VHDL PATH hdl/cmos_sensor_input_depth_reducer.vhd
+add_fileset_file cmos_sensor_input_sparse.vhd VHDL PATH hdl/cmos_sensor_input_sparse.vhd
+add_fileset_file cmos_sensor_input_compressor.vhd VHDL PATH hdl/cmos_sensor_input_compressor.vhd
 add_fileset_file cmos_sensor_input_debayer.vhd VHDL PATH hdl/cmos_sensor_input_debayer.vhd
+add_fileset_file cmos_sensor_input_color_converter.vhd VHDL PATH hdl/cmos_sensor_input_color_converter.vhd
 add_fileset_file cmos_sensor_input_packer.vhd VHDL PATH hdl/cmos_sensor_input_packer.vhd
 add_fileset_file cmos_sensor_input_avalon_st_source.vhd VHDL PATH hdl/cmos_sensor_input_avalon_st_source.vhd
 add_fileset_file cmos_sensor_input.vhd VHDL PATH hdl/cmos_sensor_input.vhd
@@ -156,6 +274,46 @@ set_parameter_property DEVICE_FAMILY ALLOWED_RANGES {"Cyclone V" "Cyclone IV E"}
 set_parameter_property DEVICE_FAMILY DESCRIPTION "Target FPGA device family (only used for efficient FIFO instantiation)"
 set_parameter_property DEVICE_FAMILY HDL_PARAMETER true
 
+add_parameter DOWNSCALER_ENABLE BOOLEAN FALSE "Enable Bayer-preserving 2x2 / 4x4 downscaling (binning or decimation)"
+set_parameter_property DOWNSCALER_ENABLE DISPLAY_NAME "Enable Downscaler"
+set_parameter_property DOWNSCALER_ENABLE TYPE BOOLEAN
+set_parameter_property DOWNSCALER_ENABLE UNITS None
+set_parameter_property DOWNSCALER_ENABLE ALLOWED_RANGES {}
+set_parameter_property DOWNSCALER_ENABLE DESCRIPTION "Enable Bayer-preserving 2x2 / 4x4 downscaling (binning or decimation)"
+set_parameter_property DOWNSCALER_ENABLE HDL_PARAMETER true
+
+add_parameter PREVIEW_ENABLE BOOLEAN FALSE "Output the downscaled frame on a second Avalon-ST source, and the full resolution frame on the main one"
+set_parameter_property PREVIEW_ENABLE DISPLAY_NAME "Enable Preview Stream"
+set_parameter_property PREVIEW_ENABLE TYPE BOOLEAN
+set_parameter_property PREVIEW_ENABLE UNITS None
+set_parameter_property PREVIEW_ENABLE ALLOWED_RANGES {}
+set_parameter_property PREVIEW_ENABLE DESCRIPTION "Output the downscaled frame on a second Avalon-ST source, and the full resolution frame on the main one"
+set_parameter_property PREVIEW_ENABLE HDL_PARAMETER true
+
+add_parameter PLANAR_ENABLE BOOLEAN FALSE "Optionally split each raw frame row into its even and odd columns, so that the 4 Bayer channels can be written to separate planes"
+set_parameter_property PLANAR_ENABLE DISPLAY_NAME "Enable Bayer Plane Splitter"
+set_parameter_property PLANAR_ENABLE TYPE BOOLEAN
+set_parameter_property PLANAR_ENABLE UNITS None
+set_parameter_property PLANAR_ENABLE ALLOWED_RANGES {}
+set_parameter_property PLANAR_ENABLE DESCRIPTION "Optionally split each raw frame row into its even and odd columns, so that the 4 Bayer channels can be written to separate planes"
+set_parameter_property PLANAR_ENABLE HDL_PARAMETER true
+
+add_parameter DEPTH_REDUCER_ENABLE BOOLEAN FALSE "Optionally reduce each raw sample to REDUCED_PIX_DEPTH bits at runtime (by shifting, or through a lookup table), so that more pixels fit in each output word"
+set_parameter_property DEPTH_REDUCER_ENABLE DISPLAY_NAME "Enable Pixel Depth Reducer"
+set_parameter_property DEPTH_REDUCER_ENABLE TYPE BOOLEAN
+set_parameter_property DEPTH_REDUCER_ENABLE UNITS None
+set_parameter_property DEPTH_REDUCER_ENABLE ALLOWED_RANGES {}
+set_parameter_property DEPTH_REDUCER_ENABLE DESCRIPTION "Optionally reduce each raw sample to REDUCED_PIX_DEPTH bits at runtime (by shifting, or through a lookup table), so that more pixels fit in each output word"
+set_parameter_property DEPTH_REDUCER_ENABLE HDL_PARAMETER true
+
+add_parameter REDUCED_PIX_DEPTH POSITIVE 8 "Depth of each pixel sample once reduced by the depth reducer"
+set_parameter_property REDUCED_PIX_DEPTH DISPLAY_NAME "Reduced Pixel Depth"
+set_parameter_property REDUCED_PIX_DEPTH TYPE POSITIVE
+set_parameter_property REDUCED_PIX_DEPTH UNITS bits
+set_parameter_property REDUCED_PIX_DEPTH ALLOWED_RANGES {1:16}
+set_parameter_property REDUCED_PIX_DEPTH DESCRIPTION "Depth of each pixel sample once reduced by the depth reducer"
+set_parameter_property REDUCED_PIX_DEPTH HDL_PARAMETER true
+
 add_parameter DEBAYER_ENABLE BOOLEAN FALSE "Enable Debayering"
 set_parameter_property DEBAYER_ENABLE DISPLAY_NAME "Enable Debayering"
 set_parameter_property DEBAYER_ENABLE TYPE BOOLEAN
@@ -165,6 +323,14 @@ set_parameter_property DEBAYER_ENABLE DESCRIPTION "Enable Debayering"
 set_parameter_property DEBAYER_ENABLE HDL_PARAMETER true
 set_parameter_property DEBAYER_ENABLE ENABLED false
 
+add_parameter COLOR_CONVERTER_ENABLE BOOLEAN FALSE "Optionally convert debayered pixels to RGB565, RGB888 or YCbCr 4:2:2 at runtime"
+set_parameter_property COLOR_CONVERTER_ENABLE DISPLAY_NAME "Enable Color Converter"
+set_parameter_property COLOR_CONVERTER_ENABLE TYPE BOOLEAN
+set_parameter_property COLOR_CONVERTER_ENABLE UNITS None
+set_parameter_property COLOR_CONVERTER_ENABLE ALLOWED_RANGES {}
+set_parameter_property COLOR_CONVERTER_ENABLE DESCRIPTION "Optionally convert debayered pixels to RGB565, RGB888 or YCbCr 4:2:2 at runtime"
+set_parameter_property COLOR_CONVERTER_ENABLE HDL_PARAMETER true
+
 add_parameter PACKER_ENABLE BOOLEAN FALSE "Enable packing of multiple pixels into a single output word of size OUTPUT_WIDTH"
 set_parameter_property PACKER_ENABLE DISPLAY_NAME "Enable Pixel Packer"
 set_parameter_property PACKER_ENABLE TYPE BOOLEAN
@@ -173,6 +339,70 @@ set_parameter_property PACKER_ENABLE ALLOWED_RANGES {}
 set_parameter_property PACKER_ENABLE DESCRIPTION "Enable packing of multiple pixels into a single output word of size OUTPUT_WIDTH"
 set_parameter_property PACKER_ENABLE HDL_PARAMETER true
 
+add_parameter STAGE_COUNT NATURAL 0 "Number of processing stages applied to the raw bayer stream, before the plane splitter and the debayer"
+set_parameter_property STAGE_COUNT DISPLAY_NAME "Processing Stage Count"
+set_parameter_property STAGE_COUNT TYPE NATURAL
+set_parameter_property STAGE_COUNT UNITS None
+set_parameter_property STAGE_COUNT ALLOWED_RANGES {0:4}
+set_parameter_property STAGE_COUNT DESCRIPTION "Number of processing stages applied to the raw bayer stream, before the plane splitter and the debayer"
+set_parameter_property STAGE_COUNT HDL_PARAMETER true
+
+add_parameter STAGE_0_TYPE STRING GAIN "Type of processing stage 0"
+set_parameter_property STAGE_0_TYPE DISPLAY_NAME "Processing Stage 0 Type"
+set_parameter_property STAGE_0_TYPE TYPE STRING
+set_parameter_property STAGE_0_TYPE UNITS None
+set_parameter_property STAGE_0_TYPE ALLOWED_RANGES {GAIN CONV3X3}
+set_parameter_property STAGE_0_TYPE DESCRIPTION "Type of processing stage 0"
+set_parameter_property STAGE_0_TYPE HDL_PARAMETER true
+
+add_parameter STAGE_1_TYPE STRING GAIN "Type of processing stage 1"
+set_parameter_property STAGE_1_TYPE DISPLAY_NAME "Processing Stage 1 Type"
+set_parameter_property STAGE_1_TYPE TYPE STRING
+set_parameter_property STAGE_1_TYPE UNITS None
+set_parameter_property STAGE_1_TYPE ALLOWED_RANGES {GAIN CONV3X3}
+set_parameter_property STAGE_1_TYPE DESCRIPTION "Type of processing stage 1"
+set_parameter_property STAGE_1_TYPE HDL_PARAMETER true
+
+add_parameter STAGE_2_TYPE STRING GAIN "Type of processing stage 2"
+set_parameter_property STAGE_2_TYPE DISPLAY_NAME "Processing Stage 2 Type"
+set_parameter_property STAGE_2_TYPE TYPE STRING
+set_parameter_property STAGE_2_TYPE UNITS None
+set_parameter_property STAGE_2_TYPE ALLOWED_RANGES {GAIN CONV3X3}
+set_parameter_property STAGE_2_TYPE DESCRIPTION "Type of processing stage 2"
+set_parameter_property STAGE_2_TYPE HDL_PARAMETER true
+
+add_parameter STAGE_3_TYPE STRING GAIN "Type of processing stage 3"
+set_parameter_property STAGE_3_TYPE DISPLAY_NAME "Processing Stage 3 Type"
+set_parameter_property STAGE_3_TYPE TYPE STRING
+set_parameter_property STAGE_3_TYPE UNITS None
+set_parameter_property STAGE_3_TYPE ALLOWED_RANGES {GAIN CONV3X3}
+set_parameter_property STAGE_3_TYPE DESCRIPTION "Type of processing stage 3"
+set_parameter_property STAGE_3_TYPE HDL_PARAMETER true
+
+add_parameter BLOB_COUNT NATURAL 0 "Maximum number of blobs (groups of pixels above a threshold) whose statistics are computed per frame, 0 disables the blob unit"
+set_parameter_property BLOB_COUNT DISPLAY_NAME "Blob Count"
+set_parameter_property BLOB_COUNT TYPE NATURAL
+set_parameter_property BLOB_COUNT UNITS None
+set_parameter_property BLOB_COUNT ALLOWED_RANGES {0:8}
+set_parameter_property BLOB_COUNT DESCRIPTION "Maximum number of blobs (groups of pixels above a threshold) whose statistics are computed per frame, 0 disables the blob unit"
+set_parameter_property BLOB_COUNT HDL_PARAMETER true
+
+add_parameter SPARSE_ENABLE BOOLEAN FALSE "Optionally output only the pixels above a threshold, as one (x, y, value) record per output word followed by an end-of-frame marker"
+set_parameter_property SPARSE_ENABLE DISPLAY_NAME "Enable Sparse Output"
+set_parameter_property SPARSE_ENABLE TYPE BOOLEAN
+set_parameter_property SPARSE_ENABLE UNITS None
+set_parameter_property SPARSE_ENABLE ALLOWED_RANGES {}
+set_parameter_property SPARSE_ENABLE DESCRIPTION "Optionally output only the pixels above a threshold, as one (x, y, value) record per output word followed by an end-of-frame marker"
+set_parameter_property SPARSE_ENABLE HDL_PARAMETER true
+
+add_parameter COMPRESSOR_ENABLE BOOLEAN FALSE "Optionally replace the raw output by a lossless bitstream of adaptive Golomb-Rice codes of per-Bayer-channel horizontal deltas"
+set_parameter_property COMPRESSOR_ENABLE DISPLAY_NAME "Enable Lossless Compressor"
+set_parameter_property COMPRESSOR_ENABLE TYPE BOOLEAN
+set_parameter_property COMPRESSOR_ENABLE UNITS None
+set_parameter_property COMPRESSOR_ENABLE ALLOWED_RANGES {}
+set_parameter_property COMPRESSOR_ENABLE DESCRIPTION "Optionally replace the raw output by a lossless bitstream of adaptive Golomb-Rice codes of per-Bayer-channel horizontal deltas"
+set_parameter_property COMPRESSOR_ENABLE HDL_PARAMETER true
+
 
 #
 # display items
@@ -238,7 +468,7 @@ add_interface_port avalon_slave read read Input 1
 add_interface_port avalon_slave write write Input 1
 add_interface_port avalon_slave rddata readdata Output 32
 add_interface_port avalon_slave wrdata writedata Input 32
-add_interface_port avalon_slave addr address Input 2
+add_interface_port avalon_slave addr address Input 4
 set_interface_assignment avalon_slave embeddedsw.configuration.isFlash 0
 set_interface_assignment avalon_slave embeddedsw.configuration.isMemoryDevice 0
 set_interface_assignment avalon_slave embeddedsw.configuration.isNonVolatileStorage 0
@@ -265,6 +495,32 @@ set_interface_property avalon_streaming_source SVD_ADDRESS_GROUP ""
 add_interface_port avalon_streaming_source ready ready Input 1
 add_interface_port avalon_streaming_source valid valid Output 1
 add_interface_port avalon_streaming_source data_out data Output output_width
+add_interface_port avalon_streaming_source startofpacket startofpacket Output 1
+add_interface_port avalon_streaming_source endofpacket endofpacket Output 1
+
+
+#
+# connection point avalon_streaming_source_preview
+#
+add_interface avalon_streaming_source_preview avalon_streaming start
+set_interface_property avalon_streaming_source_preview associatedClock clock
+set_interface_property avalon_streaming_source_preview associatedReset reset
+set_interface_property avalon_streaming_source_preview dataBitsPerSymbol 8
+set_interface_property avalon_streaming_source_preview errorDescriptor ""
+set_interface_property avalon_streaming_source_preview firstSymbolInHighOrderBits true
+set_interface_property avalon_streaming_source_preview maxChannel 0
+set_interface_property avalon_streaming_source_preview readyLatency 1
+set_interface_property avalon_streaming_source_preview ENABLED true
+set_interface_property avalon_streaming_source_preview EXPORT_OF ""
+set_interface_property avalon_streaming_source_preview PORT_NAME_MAP ""
+set_interface_property avalon_streaming_source_preview CMSIS_SVD_VARIABLES ""
+set_interface_property avalon_streaming_source_preview SVD_ADDRESS_GROUP ""
+
+add_interface_port avalon_streaming_source_preview ready_preview ready Input 1
+add_interface_port avalon_streaming_source_preview valid_preview valid Output 1
+add_interface_port avalon_streaming_source_preview data_out_preview data Output output_width
+add_interface_port avalon_streaming_source_preview startofpacket_preview startofpacket Output 1
+add_interface_port avalon_streaming_source_preview endofpacket_preview endofpacket Output 1
 
 
 #
@@ -6,69 +6,114 @@ use work.cmos_sensor_input_constants.all;
 
 entity cmos_sensor_input is
     generic(
-        PIX_DEPTH      : positive;
-        SAMPLE_EDGE    : string;
-        MAX_WIDTH      : positive range 2 to 65535; -- does not support images with only 1 column (in order for start_of_frame and end_of_frame not to overlap)
-        MAX_HEIGHT     : positive range 1 to 65535; -- but any height is supported
-        OUTPUT_WIDTH   : positive;
-        FIFO_DEPTH     : positive;
-        DEVICE_FAMILY  : string;
-        DEBAYER_ENABLE : boolean;
-        PACKER_ENABLE  : boolean
+        PIX_DEPTH              : positive;
+        SAMPLE_EDGE            : string;
+        MAX_WIDTH              : positive range 2 to 65535; -- does not support images with only 1 column (in order for start_of_frame and end_of_frame not to overlap)
+        MAX_HEIGHT             : positive range 1 to 65535; -- but any height is supported
+        OUTPUT_WIDTH           : positive;
+        FIFO_DEPTH             : positive;
+        DEVICE_FAMILY          : string;
+        DOWNSCALER_ENABLE      : boolean;
+        PREVIEW_ENABLE         : boolean; -- requires DOWNSCALER_ENABLE
+        PLANAR_ENABLE          : boolean; -- requires DEBAYER_ENABLE = false
+        DEPTH_REDUCER_ENABLE   : boolean; -- requires DEBAYER_ENABLE = false and PIX_DEPTH <= 16
+        REDUCED_PIX_DEPTH      : positive; -- only used if DEPTH_REDUCER_ENABLE, must be smaller than PIX_DEPTH
+        DEBAYER_ENABLE         : boolean;
+        COLOR_CONVERTER_ENABLE : boolean; -- requires DEBAYER_ENABLE
+        PACKER_ENABLE          : boolean;
+        STAGE_COUNT            : natural range 0 to CMOS_SENSOR_INPUT_MAX_STAGE_COUNT;
+        STAGE_0_TYPE           : string; -- only used if STAGE_COUNT > 0
+        STAGE_1_TYPE           : string; -- only used if STAGE_COUNT > 1
+        STAGE_2_TYPE           : string; -- only used if STAGE_COUNT > 2
+        STAGE_3_TYPE           : string; -- only used if STAGE_COUNT > 3
+        BLOB_COUNT             : natural range 0 to CMOS_SENSOR_INPUT_MAX_BLOB_COUNT;
+        SPARSE_ENABLE          : boolean; -- requires DEBAYER_ENABLE = false and PIX_DEPTH + 2 * bit_width(max(MAX_WIDTH, MAX_HEIGHT)) <= OUTPUT_WIDTH
+        COMPRESSOR_ENABLE      : boolean -- requires DEBAYER_ENABLE = false, PIX_DEPTH <= 16 and PIX_DEPTH + CMOS_SENSOR_INPUT_COMPRESS_ESCAPE_Q <= OUTPUT_WIDTH
     );
     port(
-        clk         : in  std_logic;
-        reset       : in  std_logic;
+        clk                   : in  std_logic;
+        reset                 : in  std_logic;
 
         -- cmos sensor
-        frame_valid : in  std_logic;
-        line_valid  : in  std_logic;
-        data_in     : in  std_logic_vector(PIX_DEPTH - 1 downto 0);
+        frame_valid           : in  std_logic;
+        line_valid            : in  std_logic;
+        data_in               : in  std_logic_vector(PIX_DEPTH - 1 downto 0);
 
         -- Avalon-ST Src
-        ready       : in  std_logic;
-        valid       : out std_logic;
-        data_out    : out std_logic_vector(OUTPUT_WIDTH - 1 downto 0);
+        ready                 : in  std_logic;
+        valid                 : out std_logic;
+        data_out              : out std_logic_vector(OUTPUT_WIDTH - 1 downto 0);
+        startofpacket         : out std_logic;
+        endofpacket           : out std_logic;
+
+        -- Avalon-ST Src (preview, only used if PREVIEW_ENABLE = true)
+        ready_preview         : in  std_logic;
+        valid_preview         : out std_logic;
+        data_out_preview      : out std_logic_vector(OUTPUT_WIDTH - 1 downto 0);
+        startofpacket_preview : out std_logic;
+        endofpacket_preview   : out std_logic;
 
         -- Avalon-MM Slave
-        addr        : in  std_logic_vector(1 downto 0);
-        read        : in  std_logic;
-        write       : in  std_logic;
-        rddata      : out std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
-        wrdata      : in  std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+        addr                  : in  std_logic_vector(CMOS_SENSOR_INPUT_MM_S_ADDR_WIDTH - 1 downto 0);
+        read                  : in  std_logic;
+        write                 : in  std_logic;
+        rddata                : out std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+        wrdata                : in  std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
 
         -- Avalon Interrupt Sender
-        irq         : out std_logic
+        irq                   : out std_logic
     );
 end entity cmos_sensor_input;
 
 architecture rtl of cmos_sensor_input is
-    constant PIX_DEPTH_RGB : positive := 3 * PIX_DEPTH;
+    constant PIX_DEPTH_RGB   : positive := 3 * PIX_DEPTH;
+    constant PIX_DEPTH_RGB16 : positive := 16; -- color_converter RGB565 and YCbCr 4:2:2 output
+    constant PIX_DEPTH_RGB24 : positive := 24; -- color_converter RGB888 output
 
     constant FIFO_DATA_WIDTH            : positive := OUTPUT_WIDTH + 1;
     constant FIFO_END_OF_FRAME_BIT_OFST : positive := OUTPUT_WIDTH; -- sc_fifo_data(FIFO_END_OF_FRAME_BIT_OFST) = end_of_frame
 
     -- avalon_mm_slave ---------------------------------------------------------
-    signal avalon_mm_slave_clk_in              : std_logic;
-    signal avalon_mm_slave_reset_in            : std_logic;
-    signal avalon_mm_slave_addr_in             : std_logic_vector(1 downto 0);
-    signal avalon_mm_slave_read_in             : std_logic;
-    signal avalon_mm_slave_write_in            : std_logic;
-    signal avalon_mm_slave_rddata_out          : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
-    signal avalon_mm_slave_wrdata_in           : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
-    signal avalon_mm_slave_irq_out             : std_logic;
-    signal avalon_mm_slave_idle_in             : std_logic;
-    signal avalon_mm_slave_snapshot_out        : std_logic;
-    signal avalon_mm_slave_get_frame_info_out  : std_logic;
-    signal avalon_mm_slave_irq_en_out          : std_logic;
-    signal avalon_mm_slave_irq_ack_out         : std_logic;
-    signal avalon_mm_slave_wait_irq_ack_in     : std_logic;
-    signal avalon_mm_slave_frame_width_in      : std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
-    signal avalon_mm_slave_frame_height_in     : std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
-    signal avalon_mm_slave_debayer_pattern_out : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_WIDTH - 1 downto 0);
-    signal avalon_mm_slave_fifo_usedw_in       : std_logic_vector(bit_width(FIFO_DEPTH) - 1 downto 0);
-    signal avalon_mm_slave_fifo_overflow_in    : std_logic;
-    signal avalon_mm_slave_stop_and_reset_out  : std_logic;
+    signal avalon_mm_slave_clk_in               : std_logic;
+    signal avalon_mm_slave_reset_in             : std_logic;
+    signal avalon_mm_slave_addr_in              : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_ADDR_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_read_in              : std_logic;
+    signal avalon_mm_slave_write_in             : std_logic;
+    signal avalon_mm_slave_rddata_out           : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_wrdata_in            : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_irq_out              : std_logic;
+    signal avalon_mm_slave_idle_in              : std_logic;
+    signal avalon_mm_slave_config_latch_in      : std_logic;
+    signal avalon_mm_slave_snapshot_out         : std_logic;
+    signal avalon_mm_slave_get_frame_info_out   : std_logic;
+    signal avalon_mm_slave_irq_en_out           : std_logic;
+    signal avalon_mm_slave_irq_ack_out          : std_logic;
+    signal avalon_mm_slave_wait_irq_ack_in      : std_logic;
+    signal avalon_mm_slave_frame_width_in       : std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+    signal avalon_mm_slave_frame_height_in      : std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+    signal avalon_mm_slave_debayer_pattern_out  : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_downscale_mode_out   : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_downscale_factor_out : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_planar_out           : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_PLANAR_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_depth_mode_out       : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_depth_lut_write_out  : std_logic;
+    signal avalon_mm_slave_depth_lut_index_out  : std_logic_vector(CMOS_SENSOR_INPUT_DEPTH_LUT_INDEX_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_depth_lut_value_out  : std_logic_vector(CMOS_SENSOR_INPUT_DEPTH_LUT_VALUE_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_output_format_out    : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_stage_write_out      : std_logic;
+    signal avalon_mm_slave_stage_index_out      : std_logic_vector(CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_stage_word_out       : std_logic_vector(CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_stage_data_out       : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_blob_threshold_out   : std_logic_vector(CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_blob_stats_only_out  : std_logic_vector(CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_blob_word_out        : std_logic_vector(CMOS_SENSOR_INPUT_BLOB_ADDR_WORD_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_blob_data_in         : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_sparse_threshold_out : std_logic_vector(CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_sparse_enable_out    : std_logic_vector(CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_compress_out         : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_COMPRESS_WIDTH - 1 downto 0);
+    signal avalon_mm_slave_fifo_usedw_in        : std_logic_vector(bit_width(FIFO_DEPTH) - 1 downto 0);
+    signal avalon_mm_slave_fifo_overflow_in     : std_logic;
+    signal avalon_mm_slave_stop_and_reset_out   : std_logic;
 
     -- synchronizer ------------------------------------------------------------
     signal synchronizer_clk_in              : std_logic;
@@ -85,6 +130,7 @@ architecture rtl of cmos_sensor_input is
     signal sampler_reset_in                : std_logic;
     signal sampler_stop_and_reset_in       : std_logic;
     signal sampler_idle_out                : std_logic;
+    signal sampler_config_latch_out        : std_logic;
     signal sampler_wait_irq_ack_out        : std_logic;
     signal sampler_irq_en_in               : std_logic;
     signal sampler_irq_ack_in              : std_logic;
@@ -103,6 +149,153 @@ architecture rtl of cmos_sensor_input is
     signal sampler_end_of_frame_in_in      : std_logic;
     signal sampler_end_of_frame_in_ack_out : std_logic;
 
+    -- downscaler --------------------------------------------------------------
+    signal downscaler_clk_in                 : std_logic;
+    signal downscaler_reset_in               : std_logic;
+    signal downscaler_stop_and_reset_in      : std_logic;
+    signal downscaler_downscale_mode_in      : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_WIDTH - 1 downto 0);
+    signal downscaler_downscale_factor_in    : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_WIDTH - 1 downto 0);
+    signal downscaler_frame_width_in         : std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+    signal downscaler_valid_in_in            : std_logic;
+    signal downscaler_data_in_in             : std_logic_vector(PIX_DEPTH - 1 downto 0);
+    signal downscaler_start_of_frame_in_in   : std_logic;
+    signal downscaler_end_of_frame_in_in     : std_logic;
+    signal downscaler_valid_out_out          : std_logic;
+    signal downscaler_data_out_out           : std_logic_vector(PIX_DEPTH - 1 downto 0);
+    signal downscaler_start_of_frame_out_out : std_logic;
+    signal downscaler_end_of_frame_out_out   : std_logic;
+    signal downscaler_output_frame_width_out : std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+
+    -- raw pixel stream fed to the stage chain (sampler or downscaler output)
+    signal raw_valid          : std_logic;
+    signal raw_data           : std_logic_vector(PIX_DEPTH - 1 downto 0);
+    signal raw_start_of_frame : std_logic;
+    signal raw_end_of_frame   : std_logic;
+    signal raw_frame_width    : std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+
+    -- stage_chain -------------------------------------------------------------
+    signal stage_chain_clk_in                 : std_logic;
+    signal stage_chain_reset_in               : std_logic;
+    signal stage_chain_stop_and_reset_in      : std_logic;
+    signal stage_chain_stage_write_in         : std_logic;
+    signal stage_chain_stage_index_in         : std_logic_vector(CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_WIDTH - 1 downto 0);
+    signal stage_chain_stage_word_in          : std_logic_vector(CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_WIDTH - 1 downto 0);
+    signal stage_chain_stage_data_in          : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+    signal stage_chain_config_latch_in        : std_logic;
+    signal stage_chain_frame_width_in         : std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+    signal stage_chain_valid_in_in            : std_logic;
+    signal stage_chain_data_in_in             : std_logic_vector(PIX_DEPTH - 1 downto 0);
+    signal stage_chain_start_of_frame_in_in   : std_logic;
+    signal stage_chain_end_of_frame_in_in     : std_logic;
+    signal stage_chain_valid_out_out          : std_logic;
+    signal stage_chain_data_out_out           : std_logic_vector(PIX_DEPTH - 1 downto 0);
+    signal stage_chain_start_of_frame_out_out : std_logic;
+    signal stage_chain_end_of_frame_out_out   : std_logic;
+
+    -- raw pixel stream after the processing stages (raw stream if there are none)
+    signal raw_processed_valid          : std_logic;
+    signal raw_processed_data           : std_logic_vector(PIX_DEPTH - 1 downto 0);
+    signal raw_processed_start_of_frame : std_logic;
+    signal raw_processed_end_of_frame   : std_logic;
+
+    -- blob --------------------------------------------------------------------
+    signal blob_clk_in                  : std_logic;
+    signal blob_reset_in                : std_logic;
+    signal blob_stop_and_reset_in       : std_logic;
+    signal blob_threshold_in            : std_logic_vector(CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_WIDTH - 1 downto 0);
+    signal blob_result_word_in          : std_logic_vector(CMOS_SENSOR_INPUT_BLOB_ADDR_WORD_WIDTH - 1 downto 0);
+    signal blob_result_data_out         : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+    signal blob_frame_width_in          : std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+    signal blob_valid_in_in             : std_logic;
+    signal blob_data_in_in              : std_logic_vector(PIX_DEPTH - 1 downto 0);
+    signal blob_start_of_frame_in_in    : std_logic;
+    signal blob_end_of_frame_in_in      : std_logic;
+    signal blob_end_of_frame_out_out    : std_logic;
+    signal blob_end_of_frame_out_ack_in : std_logic;
+
+    -- '1' if only the blob statistics are output for the current frame
+    signal stats_only : std_logic;
+
+    -- raw pixel stream fed to the rest of the pipeline (cut off in stats-only mode)
+    signal raw_output_valid          : std_logic;
+    signal raw_output_data           : std_logic_vector(PIX_DEPTH - 1 downto 0);
+    signal raw_output_start_of_frame : std_logic;
+    signal raw_output_end_of_frame   : std_logic;
+
+    -- planar ------------------------------------------------------------------
+    signal planar_clk_in                 : std_logic;
+    signal planar_reset_in               : std_logic;
+    signal planar_stop_and_reset_in      : std_logic;
+    signal planar_planar_in              : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_PLANAR_WIDTH - 1 downto 0);
+    signal planar_frame_width_in         : std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+    signal planar_valid_in_in            : std_logic;
+    signal planar_data_in_in             : std_logic_vector(PIX_DEPTH - 1 downto 0);
+    signal planar_start_of_frame_in_in   : std_logic;
+    signal planar_end_of_frame_in_in     : std_logic;
+    signal planar_valid_out_out          : std_logic;
+    signal planar_data_out_out           : std_logic_vector(PIX_DEPTH - 1 downto 0);
+    signal planar_start_of_frame_out_out : std_logic;
+    signal planar_end_of_frame_out_out   : std_logic;
+
+    -- raw pixel stream fed to the packer / fifo if the debayer is disabled (raw stream, or planar output)
+    signal raw_split_valid          : std_logic;
+    signal raw_split_data           : std_logic_vector(PIX_DEPTH - 1 downto 0);
+    signal raw_split_start_of_frame : std_logic;
+    signal raw_split_end_of_frame   : std_logic;
+
+    -- depth_reducer -----------------------------------------------------------
+    signal depth_reducer_clk_in                 : std_logic;
+    signal depth_reducer_reset_in               : std_logic;
+    signal depth_reducer_stop_and_reset_in      : std_logic;
+    signal depth_reducer_depth_mode_in          : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_WIDTH - 1 downto 0);
+    signal depth_reducer_lut_write_in           : std_logic;
+    signal depth_reducer_lut_index_in           : std_logic_vector(CMOS_SENSOR_INPUT_DEPTH_LUT_INDEX_WIDTH - 1 downto 0);
+    signal depth_reducer_lut_value_in           : std_logic_vector(CMOS_SENSOR_INPUT_DEPTH_LUT_VALUE_WIDTH - 1 downto 0);
+    signal depth_reducer_valid_in_in            : std_logic;
+    signal depth_reducer_data_in_in             : std_logic_vector(PIX_DEPTH - 1 downto 0);
+    signal depth_reducer_start_of_frame_in_in   : std_logic;
+    signal depth_reducer_end_of_frame_in_in     : std_logic;
+    signal depth_reducer_valid_out_out          : std_logic;
+    signal depth_reducer_data_out_out           : std_logic_vector(REDUCED_PIX_DEPTH - 1 downto 0);
+    signal depth_reducer_start_of_frame_out_out : std_logic;
+    signal depth_reducer_end_of_frame_out_out   : std_logic;
+
+    -- '1' if the raw stream goes through the depth_reducer for the current frame
+    signal depth_reduced : std_logic;
+
+    -- sparse ------------------------------------------------------------------
+    signal sparse_clk_in               : std_logic;
+    signal sparse_reset_in             : std_logic;
+    signal sparse_stop_and_reset_in    : std_logic;
+    signal sparse_threshold_in         : std_logic_vector(CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_WIDTH - 1 downto 0);
+    signal sparse_frame_width_in       : std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+    signal sparse_valid_in_in          : std_logic;
+    signal sparse_data_in_in           : std_logic_vector(PIX_DEPTH - 1 downto 0);
+    signal sparse_start_of_frame_in_in : std_logic;
+    signal sparse_end_of_frame_in_in   : std_logic;
+    signal sparse_valid_out_out        : std_logic;
+    signal sparse_data_out_out         : std_logic_vector(OUTPUT_WIDTH - 1 downto 0);
+    signal sparse_end_of_frame_out_out : std_logic;
+
+    -- '1' if the raw stream goes through the sparse unit for the current frame
+    signal sparse : std_logic;
+
+    -- compressor --------------------------------------------------------------
+    signal compressor_clk_in               : std_logic;
+    signal compressor_reset_in             : std_logic;
+    signal compressor_stop_and_reset_in    : std_logic;
+    signal compressor_frame_width_in       : std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+    signal compressor_valid_in_in          : std_logic;
+    signal compressor_data_in_in           : std_logic_vector(PIX_DEPTH - 1 downto 0);
+    signal compressor_start_of_frame_in_in : std_logic;
+    signal compressor_end_of_frame_in_in   : std_logic;
+    signal compressor_valid_out_out        : std_logic;
+    signal compressor_data_out_out         : std_logic_vector(OUTPUT_WIDTH - 1 downto 0);
+    signal compressor_end_of_frame_out_out : std_logic;
+
+    -- '1' if the raw stream goes through the compressor for the current frame
+    signal compressed : std_logic;
+
     -- debayer -----------------------------------------------------------------
     signal debayer_clk_in                 : std_logic;
     signal debayer_reset_in               : std_logic;
@@ -117,6 +310,23 @@ architecture rtl of cmos_sensor_input is
     signal debayer_start_of_frame_out_out : std_logic;
     signal debayer_end_of_frame_out_out   : std_logic;
 
+    -- color_converter ---------------------------------------------------------
+    signal color_converter_clk_in                 : std_logic;
+    signal color_converter_reset_in               : std_logic;
+    signal color_converter_stop_and_reset_in      : std_logic;
+    signal color_converter_output_format_in       : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_WIDTH - 1 downto 0);
+    signal color_converter_valid_in_in            : std_logic;
+    signal color_converter_data_in_in             : std_logic_vector(PIX_DEPTH_RGB - 1 downto 0);
+    signal color_converter_start_of_frame_in_in   : std_logic;
+    signal color_converter_end_of_frame_in_in     : std_logic;
+    signal color_converter_valid_out_out          : std_logic;
+    signal color_converter_data_out_out           : std_logic_vector(PIX_DEPTH_RGB24 - 1 downto 0);
+    signal color_converter_start_of_frame_out_out : std_logic;
+    signal color_converter_end_of_frame_out_out   : std_logic;
+
+    -- '1' if the rgb stream goes through the color_converter for the current frame
+    signal color_converted : std_logic;
+
     -- packer_raw --------------------------------------------------------------
     signal packer_raw_clk_in               : std_logic;
     signal packer_raw_reset_in             : std_logic;
@@ -129,6 +339,18 @@ architecture rtl of cmos_sensor_input is
     signal packer_raw_data_out_out         : std_logic_vector(OUTPUT_WIDTH - 1 downto 0);
     signal packer_raw_end_of_frame_out_out : std_logic;
 
+    -- packer_reduced ----------------------------------------------------------
+    signal packer_reduced_clk_in               : std_logic;
+    signal packer_reduced_reset_in             : std_logic;
+    signal packer_reduced_stop_and_reset_in    : std_logic;
+    signal packer_reduced_valid_in_in          : std_logic;
+    signal packer_reduced_data_in_in           : std_logic_vector(REDUCED_PIX_DEPTH - 1 downto 0);
+    signal packer_reduced_start_of_frame_in_in : std_logic;
+    signal packer_reduced_end_of_frame_in_in   : std_logic;
+    signal packer_reduced_valid_out_out        : std_logic;
+    signal packer_reduced_data_out_out         : std_logic_vector(OUTPUT_WIDTH - 1 downto 0);
+    signal packer_reduced_end_of_frame_out_out : std_logic;
+
     -- packer_rgb --------------------------------------------------------------
     signal packer_rgb_clk_in               : std_logic;
     signal packer_rgb_reset_in             : std_logic;
@@ -141,6 +363,42 @@ architecture rtl of cmos_sensor_input is
     signal packer_rgb_data_out_out         : std_logic_vector(OUTPUT_WIDTH - 1 downto 0);
     signal packer_rgb_end_of_frame_out_out : std_logic;
 
+    -- packer_rgb16 ------------------------------------------------------------
+    signal packer_rgb16_clk_in               : std_logic;
+    signal packer_rgb16_reset_in             : std_logic;
+    signal packer_rgb16_stop_and_reset_in    : std_logic;
+    signal packer_rgb16_valid_in_in          : std_logic;
+    signal packer_rgb16_data_in_in           : std_logic_vector(PIX_DEPTH_RGB16 - 1 downto 0);
+    signal packer_rgb16_start_of_frame_in_in : std_logic;
+    signal packer_rgb16_end_of_frame_in_in   : std_logic;
+    signal packer_rgb16_valid_out_out        : std_logic;
+    signal packer_rgb16_data_out_out         : std_logic_vector(OUTPUT_WIDTH - 1 downto 0);
+    signal packer_rgb16_end_of_frame_out_out : std_logic;
+
+    -- packer_rgb24 ------------------------------------------------------------
+    signal packer_rgb24_clk_in               : std_logic;
+    signal packer_rgb24_reset_in             : std_logic;
+    signal packer_rgb24_stop_and_reset_in    : std_logic;
+    signal packer_rgb24_valid_in_in          : std_logic;
+    signal packer_rgb24_data_in_in           : std_logic_vector(PIX_DEPTH_RGB24 - 1 downto 0);
+    signal packer_rgb24_start_of_frame_in_in : std_logic;
+    signal packer_rgb24_end_of_frame_in_in   : std_logic;
+    signal packer_rgb24_valid_out_out        : std_logic;
+    signal packer_rgb24_data_out_out         : std_logic_vector(OUTPUT_WIDTH - 1 downto 0);
+    signal packer_rgb24_end_of_frame_out_out : std_logic;
+
+    -- packer_preview ----------------------------------------------------------
+    signal packer_preview_clk_in               : std_logic;
+    signal packer_preview_reset_in             : std_logic;
+    signal packer_preview_stop_and_reset_in    : std_logic;
+    signal packer_preview_valid_in_in          : std_logic;
+    signal packer_preview_data_in_in           : std_logic_vector(PIX_DEPTH - 1 downto 0);
+    signal packer_preview_start_of_frame_in_in : std_logic;
+    signal packer_preview_end_of_frame_in_in   : std_logic;
+    signal packer_preview_valid_out_out        : std_logic;
+    signal packer_preview_data_out_out         : std_logic_vector(OUTPUT_WIDTH - 1 downto 0);
+    signal packer_preview_end_of_frame_out_out : std_logic;
+
     -- sc_fifo -----------------------------------------------------------------
     signal sc_fifo_clk_in       : std_logic;
     signal sc_fifo_reset_in     : std_logic;
@@ -154,6 +412,19 @@ architecture rtl of cmos_sensor_input is
     signal sc_fifo_usedw_out    : std_logic_vector(bit_width(FIFO_DEPTH) - 1 downto 0);
     signal sc_fifo_overflow_out : std_logic;
 
+    -- sc_fifo_preview ---------------------------------------------------------
+    signal sc_fifo_preview_clk_in       : std_logic;
+    signal sc_fifo_preview_reset_in     : std_logic;
+    signal sc_fifo_preview_clr_in       : std_logic;
+    signal sc_fifo_preview_data_in_in   : std_logic_vector(FIFO_DATA_WIDTH - 1 downto 0);
+    signal sc_fifo_preview_data_out_out : std_logic_vector(FIFO_DATA_WIDTH - 1 downto 0);
+    signal sc_fifo_preview_read_in      : std_logic;
+    signal sc_fifo_preview_write_in     : std_logic;
+    signal sc_fifo_preview_empty_out    : std_logic;
+    signal sc_fifo_preview_full_out     : std_logic;
+    signal sc_fifo_preview_usedw_out    : std_logic_vector(bit_width(FIFO_DEPTH) - 1 downto 0);
+    signal sc_fifo_preview_overflow_out : std_logic;
+
     -- avalon_st_source --------------------------------------------------------
     signal avalon_st_source_clk_in                  : std_logic;
     signal avalon_st_source_reset_in                : std_logic;
@@ -161,6 +432,8 @@ architecture rtl of cmos_sensor_input is
     signal avalon_st_source_ready_in                : std_logic;
     signal avalon_st_source_valid_out               : std_logic;
     signal avalon_st_source_data_out                : std_logic_vector(OUTPUT_WIDTH - 1 downto 0);
+    signal avalon_st_source_startofpacket_out       : std_logic;
+    signal avalon_st_source_endofpacket_out         : std_logic;
     signal avalon_st_source_fifo_read_out           : std_logic;
     signal avalon_st_source_fifo_empty_in           : std_logic;
     signal avalon_st_source_fifo_data_in            : std_logic_vector(OUTPUT_WIDTH - 1 downto 0);
@@ -169,37 +442,94 @@ architecture rtl of cmos_sensor_input is
     signal avalon_st_source_end_of_frame_out_out    : std_logic;
     signal avalon_st_source_end_of_frame_out_ack_in : std_logic;
 
+    -- avalon_st_source_preview ------------------------------------------------
+    signal avalon_st_source_preview_clk_in                  : std_logic;
+    signal avalon_st_source_preview_reset_in                : std_logic;
+    signal avalon_st_source_preview_stop_and_reset_in       : std_logic;
+    signal avalon_st_source_preview_ready_in                : std_logic;
+    signal avalon_st_source_preview_valid_out               : std_logic;
+    signal avalon_st_source_preview_data_out                : std_logic_vector(OUTPUT_WIDTH - 1 downto 0);
+    signal avalon_st_source_preview_startofpacket_out       : std_logic;
+    signal avalon_st_source_preview_endofpacket_out         : std_logic;
+    signal avalon_st_source_preview_fifo_read_out           : std_logic;
+    signal avalon_st_source_preview_fifo_empty_in           : std_logic;
+    signal avalon_st_source_preview_fifo_data_in            : std_logic_vector(OUTPUT_WIDTH - 1 downto 0);
+    signal avalon_st_source_preview_fifo_end_of_frame_in    : std_logic;
+    signal avalon_st_source_preview_fifo_overflow_in        : std_logic;
+    signal avalon_st_source_preview_end_of_frame_out_out    : std_logic;
+    signal avalon_st_source_preview_end_of_frame_out_ack_in : std_logic;
+
+    -- overflow of any output fifo stops the whole unit
+    signal fifo_overflow : std_logic;
+
+    -- end of the main output frame (Avalon-ST source and blob unit)
+    signal output_end_of_frame : std_logic;
+
 begin
-    valid    <= avalon_st_source_valid_out;
-    data_out <= avalon_st_source_data_out;
-    rddata   <= avalon_mm_slave_rddata_out;
-    irq      <= avalon_mm_slave_irq_out;
+    valid                 <= avalon_st_source_valid_out;
+    data_out              <= avalon_st_source_data_out;
+    startofpacket         <= avalon_st_source_startofpacket_out;
+    endofpacket           <= avalon_st_source_endofpacket_out;
+    valid_preview         <= avalon_st_source_preview_valid_out when PREVIEW_ENABLE else '0';
+    data_out_preview      <= avalon_st_source_preview_data_out when PREVIEW_ENABLE else (others => '0');
+    startofpacket_preview <= avalon_st_source_preview_startofpacket_out when PREVIEW_ENABLE else '0';
+    endofpacket_preview   <= avalon_st_source_preview_endofpacket_out when PREVIEW_ENABLE else '0';
+    rddata                <= avalon_mm_slave_rddata_out;
+    irq                   <= avalon_mm_slave_irq_out;
 
     cmos_sensor_input_avalon_mm_slave_inst : entity work.cmos_sensor_input_avalon_mm_slave
-        generic map(DEBAYER_ENABLE => DEBAYER_ENABLE,
-                    FIFO_DEPTH     => FIFO_DEPTH,
-                    MAX_WIDTH      => MAX_WIDTH,
-                    MAX_HEIGHT     => MAX_HEIGHT)
-        port map(clk             => avalon_mm_slave_clk_in,
-                 reset           => avalon_mm_slave_reset_in,
-                 addr            => avalon_mm_slave_addr_in,
-                 read            => avalon_mm_slave_read_in,
-                 write           => avalon_mm_slave_write_in,
-                 rddata          => avalon_mm_slave_rddata_out,
-                 wrdata          => avalon_mm_slave_wrdata_in,
-                 irq             => avalon_mm_slave_irq_out,
-                 idle            => avalon_mm_slave_idle_in,
-                 snapshot        => avalon_mm_slave_snapshot_out,
-                 get_frame_info  => avalon_mm_slave_get_frame_info_out,
-                 irq_en          => avalon_mm_slave_irq_en_out,
-                 irq_ack         => avalon_mm_slave_irq_ack_out,
-                 wait_irq_ack    => avalon_mm_slave_wait_irq_ack_in,
-                 frame_width     => avalon_mm_slave_frame_width_in,
-                 frame_height    => avalon_mm_slave_frame_height_in,
-                 debayer_pattern => avalon_mm_slave_debayer_pattern_out,
-                 fifo_usedw      => avalon_mm_slave_fifo_usedw_in,
-                 fifo_overflow   => avalon_mm_slave_fifo_overflow_in,
-                 stop_and_reset  => avalon_mm_slave_stop_and_reset_out);
+        generic map(DEBAYER_ENABLE         => DEBAYER_ENABLE,
+                    DOWNSCALER_ENABLE      => DOWNSCALER_ENABLE,
+                    PLANAR_ENABLE          => PLANAR_ENABLE,
+                    DEPTH_REDUCER_ENABLE   => DEPTH_REDUCER_ENABLE,
+                    COLOR_CONVERTER_ENABLE => COLOR_CONVERTER_ENABLE,
+                    STAGE_COUNT            => STAGE_COUNT,
+                    BLOB_COUNT             => BLOB_COUNT,
+                    SPARSE_ENABLE          => SPARSE_ENABLE,
+                    COMPRESSOR_ENABLE      => COMPRESSOR_ENABLE,
+                    FIFO_DEPTH             => FIFO_DEPTH,
+                    MAX_WIDTH              => MAX_WIDTH,
+                    MAX_HEIGHT             => MAX_HEIGHT)
+        port map(clk              => avalon_mm_slave_clk_in,
+                 reset            => avalon_mm_slave_reset_in,
+                 addr             => avalon_mm_slave_addr_in,
+                 read             => avalon_mm_slave_read_in,
+                 write            => avalon_mm_slave_write_in,
+                 rddata           => avalon_mm_slave_rddata_out,
+                 wrdata           => avalon_mm_slave_wrdata_in,
+                 irq              => avalon_mm_slave_irq_out,
+                 idle             => avalon_mm_slave_idle_in,
+                 config_latch     => avalon_mm_slave_config_latch_in,
+                 snapshot         => avalon_mm_slave_snapshot_out,
+                 get_frame_info   => avalon_mm_slave_get_frame_info_out,
+                 irq_en           => avalon_mm_slave_irq_en_out,
+                 irq_ack          => avalon_mm_slave_irq_ack_out,
+                 wait_irq_ack     => avalon_mm_slave_wait_irq_ack_in,
+                 frame_width      => avalon_mm_slave_frame_width_in,
+                 frame_height     => avalon_mm_slave_frame_height_in,
+                 debayer_pattern  => avalon_mm_slave_debayer_pattern_out,
+                 downscale_mode   => avalon_mm_slave_downscale_mode_out,
+                 downscale_factor => avalon_mm_slave_downscale_factor_out,
+                 planar           => avalon_mm_slave_planar_out,
+                 depth_mode       => avalon_mm_slave_depth_mode_out,
+                 depth_lut_write  => avalon_mm_slave_depth_lut_write_out,
+                 depth_lut_index  => avalon_mm_slave_depth_lut_index_out,
+                 depth_lut_value  => avalon_mm_slave_depth_lut_value_out,
+                 output_format    => avalon_mm_slave_output_format_out,
+                 stage_write      => avalon_mm_slave_stage_write_out,
+                 stage_index      => avalon_mm_slave_stage_index_out,
+                 stage_word       => avalon_mm_slave_stage_word_out,
+                 stage_data       => avalon_mm_slave_stage_data_out,
+                 blob_threshold   => avalon_mm_slave_blob_threshold_out,
+                 blob_stats_only  => avalon_mm_slave_blob_stats_only_out,
+                 blob_word        => avalon_mm_slave_blob_word_out,
+                 blob_data        => avalon_mm_slave_blob_data_in,
+                 sparse_threshold => avalon_mm_slave_sparse_threshold_out,
+                 sparse_enable    => avalon_mm_slave_sparse_enable_out,
+                 compress         => avalon_mm_slave_compress_out,
+                 fifo_usedw       => avalon_mm_slave_fifo_usedw_in,
+                 fifo_overflow    => avalon_mm_slave_fifo_overflow_in,
+                 stop_and_reset   => avalon_mm_slave_stop_and_reset_out);
 
     cmos_sensor_input_synchronizer_inst : entity work.cmos_sensor_input_synchronizer
         generic map(PIX_DEPTH   => PIX_DEPTH,
@@ -221,6 +551,7 @@ begin
                  reset               => sampler_reset_in,
                  stop_and_reset      => sampler_stop_and_reset_in,
                  idle                => sampler_idle_out,
+                 config_latch        => sampler_config_latch_out,
                  wait_irq_ack        => sampler_wait_irq_ack_out,
                  irq_en              => sampler_irq_en_in,
                  irq_ack             => sampler_irq_ack_in,
@@ -239,6 +570,158 @@ begin
                  end_of_frame_in     => sampler_end_of_frame_in_in,
                  end_of_frame_in_ack => sampler_end_of_frame_in_ack_out);
 
+    downscaler_inst : if DOWNSCALER_ENABLE generate
+        cmos_sensor_input_downscaler_inst : entity work.cmos_sensor_input_downscaler
+            generic map(PIX_DEPTH  => PIX_DEPTH,
+                        MAX_WIDTH  => MAX_WIDTH,
+                        MAX_HEIGHT => MAX_HEIGHT)
+            port map(clk                => downscaler_clk_in,
+                     reset              => downscaler_reset_in,
+                     stop_and_reset     => downscaler_stop_and_reset_in,
+                     downscale_mode     => downscaler_downscale_mode_in,
+                     downscale_factor   => downscaler_downscale_factor_in,
+                     frame_width        => downscaler_frame_width_in,
+                     valid_in           => downscaler_valid_in_in,
+                     data_in            => downscaler_data_in_in,
+                     start_of_frame_in  => downscaler_start_of_frame_in_in,
+                     end_of_frame_in    => downscaler_end_of_frame_in_in,
+                     valid_out          => downscaler_valid_out_out,
+                     data_out           => downscaler_data_out_out,
+                     start_of_frame_out => downscaler_start_of_frame_out_out,
+                     end_of_frame_out   => downscaler_end_of_frame_out_out,
+                     output_frame_width => downscaler_output_frame_width_out);
+    end generate downscaler_inst;
+
+    stage_chain_inst : if STAGE_COUNT > 0 generate
+        cmos_sensor_input_stage_chain_inst : entity work.cmos_sensor_input_stage_chain
+            generic map(PIX_DEPTH    => PIX_DEPTH,
+                        MAX_WIDTH    => MAX_WIDTH,
+                        MAX_HEIGHT   => MAX_HEIGHT,
+                        STAGE_COUNT  => STAGE_COUNT,
+                        STAGE_0_TYPE => STAGE_0_TYPE,
+                        STAGE_1_TYPE => STAGE_1_TYPE,
+                        STAGE_2_TYPE => STAGE_2_TYPE,
+                        STAGE_3_TYPE => STAGE_3_TYPE)
+            port map(clk                => stage_chain_clk_in,
+                     reset              => stage_chain_reset_in,
+                     stop_and_reset     => stage_chain_stop_and_reset_in,
+                     stage_write        => stage_chain_stage_write_in,
+                     stage_index        => stage_chain_stage_index_in,
+                     stage_word         => stage_chain_stage_word_in,
+                     stage_data         => stage_chain_stage_data_in,
+                     config_latch       => stage_chain_config_latch_in,
+                     frame_width        => stage_chain_frame_width_in,
+                     valid_in           => stage_chain_valid_in_in,
+                     data_in            => stage_chain_data_in_in,
+                     start_of_frame_in  => stage_chain_start_of_frame_in_in,
+                     end_of_frame_in    => stage_chain_end_of_frame_in_in,
+                     valid_out          => stage_chain_valid_out_out,
+                     data_out           => stage_chain_data_out_out,
+                     start_of_frame_out => stage_chain_start_of_frame_out_out,
+                     end_of_frame_out   => stage_chain_end_of_frame_out_out);
+    end generate stage_chain_inst;
+
+    blob_inst : if BLOB_COUNT > 0 generate
+        cmos_sensor_input_blob_inst : entity work.cmos_sensor_input_blob
+            generic map(PIX_DEPTH  => PIX_DEPTH,
+                        MAX_WIDTH  => MAX_WIDTH,
+                        MAX_HEIGHT => MAX_HEIGHT,
+                        BLOB_COUNT => BLOB_COUNT)
+            port map(clk                  => blob_clk_in,
+                     reset                => blob_reset_in,
+                     stop_and_reset       => blob_stop_and_reset_in,
+                     threshold            => blob_threshold_in,
+                     result_word          => blob_result_word_in,
+                     result_data          => blob_result_data_out,
+                     frame_width          => blob_frame_width_in,
+                     valid_in             => blob_valid_in_in,
+                     data_in              => blob_data_in_in,
+                     start_of_frame_in    => blob_start_of_frame_in_in,
+                     end_of_frame_in      => blob_end_of_frame_in_in,
+                     end_of_frame_out     => blob_end_of_frame_out_out,
+                     end_of_frame_out_ack => blob_end_of_frame_out_ack_in);
+    end generate blob_inst;
+
+    planar_inst : if PLANAR_ENABLE generate
+        cmos_sensor_input_planar_inst : entity work.cmos_sensor_input_planar
+            generic map(PIX_DEPTH  => PIX_DEPTH,
+                        MAX_WIDTH  => MAX_WIDTH,
+                        MAX_HEIGHT => MAX_HEIGHT)
+            port map(clk                => planar_clk_in,
+                     reset              => planar_reset_in,
+                     stop_and_reset     => planar_stop_and_reset_in,
+                     planar             => planar_planar_in,
+                     frame_width        => planar_frame_width_in,
+                     valid_in           => planar_valid_in_in,
+                     data_in            => planar_data_in_in,
+                     start_of_frame_in  => planar_start_of_frame_in_in,
+                     end_of_frame_in    => planar_end_of_frame_in_in,
+                     valid_out          => planar_valid_out_out,
+                     data_out           => planar_data_out_out,
+                     start_of_frame_out => planar_start_of_frame_out_out,
+                     end_of_frame_out   => planar_end_of_frame_out_out);
+    end generate planar_inst;
+
+    depth_reducer_inst : if DEPTH_REDUCER_ENABLE generate
+        cmos_sensor_input_depth_reducer_inst : entity work.cmos_sensor_input_depth_reducer
+            generic map(PIX_DEPTH         => PIX_DEPTH,
+                        REDUCED_PIX_DEPTH => REDUCED_PIX_DEPTH)
+            port map(clk                => depth_reducer_clk_in,
+                     reset              => depth_reducer_reset_in,
+                     stop_and_reset     => depth_reducer_stop_and_reset_in,
+                     depth_mode         => depth_reducer_depth_mode_in,
+                     lut_write          => depth_reducer_lut_write_in,
+                     lut_index          => depth_reducer_lut_index_in,
+                     lut_value          => depth_reducer_lut_value_in,
+                     valid_in           => depth_reducer_valid_in_in,
+                     data_in            => depth_reducer_data_in_in,
+                     start_of_frame_in  => depth_reducer_start_of_frame_in_in,
+                     end_of_frame_in    => depth_reducer_end_of_frame_in_in,
+                     valid_out          => depth_reducer_valid_out_out,
+                     data_out           => depth_reducer_data_out_out,
+                     start_of_frame_out => depth_reducer_start_of_frame_out_out,
+                     end_of_frame_out   => depth_reducer_end_of_frame_out_out);
+    end generate depth_reducer_inst;
+
+    sparse_inst : if SPARSE_ENABLE generate
+        cmos_sensor_input_sparse_inst : entity work.cmos_sensor_input_sparse
+            generic map(PIX_DEPTH    => PIX_DEPTH,
+                        MAX_WIDTH    => MAX_WIDTH,
+                        MAX_HEIGHT   => MAX_HEIGHT,
+                        RECORD_WIDTH => OUTPUT_WIDTH)
+            port map(clk               => sparse_clk_in,
+                     reset             => sparse_reset_in,
+                     stop_and_reset    => sparse_stop_and_reset_in,
+                     threshold         => sparse_threshold_in,
+                     frame_width       => sparse_frame_width_in,
+                     valid_in          => sparse_valid_in_in,
+                     data_in           => sparse_data_in_in,
+                     start_of_frame_in => sparse_start_of_frame_in_in,
+                     end_of_frame_in   => sparse_end_of_frame_in_in,
+                     valid_out         => sparse_valid_out_out,
+                     data_out          => sparse_data_out_out,
+                     end_of_frame_out  => sparse_end_of_frame_out_out);
+    end generate sparse_inst;
+
+    compressor_inst : if COMPRESSOR_ENABLE generate
+        cmos_sensor_input_compressor_inst : entity work.cmos_sensor_input_compressor
+            generic map(PIX_DEPTH    => PIX_DEPTH,
+                        MAX_WIDTH    => MAX_WIDTH,
+                        MAX_HEIGHT   => MAX_HEIGHT,
+                        OUTPUT_WIDTH => OUTPUT_WIDTH)
+            port map(clk               => compressor_clk_in,
+                     reset             => compressor_reset_in,
+                     stop_and_reset    => compressor_stop_and_reset_in,
+                     frame_width       => compressor_frame_width_in,
+                     valid_in          => compressor_valid_in_in,
+                     data_in           => compressor_data_in_in,
+                     start_of_frame_in => compressor_start_of_frame_in_in,
+                     end_of_frame_in   => compressor_end_of_frame_in_in,
+                     valid_out         => compressor_valid_out_out,
+                     data_out          => compressor_data_out_out,
+                     end_of_frame_out  => compressor_end_of_frame_out_out);
+    end generate compressor_inst;
+
     debayer_inst : if DEBAYER_ENABLE generate
         cmos_sensor_input_debayer_inst : entity work.cmos_sensor_input_debayer
             generic map(PIX_DEPTH_RAW => PIX_DEPTH,
@@ -258,6 +741,23 @@ begin
                      end_of_frame_out   => debayer_end_of_frame_out_out);
     end generate debayer_inst;
 
+    color_converter_inst : if COLOR_CONVERTER_ENABLE generate
+        cmos_sensor_input_color_converter_inst : entity work.cmos_sensor_input_color_converter
+            generic map(PIX_DEPTH => PIX_DEPTH)
+            port map(clk                => color_converter_clk_in,
+                     reset              => color_converter_reset_in,
+                     stop_and_reset     => color_converter_stop_and_reset_in,
+                     output_format      => color_converter_output_format_in,
+                     valid_in           => color_converter_valid_in_in,
+                     data_in            => color_converter_data_in_in,
+                     start_of_frame_in  => color_converter_start_of_frame_in_in,
+                     end_of_frame_in    => color_converter_end_of_frame_in_in,
+                     valid_out          => color_converter_valid_out_out,
+                     data_out           => color_converter_data_out_out,
+                     start_of_frame_out => color_converter_start_of_frame_out_out,
+                     end_of_frame_out   => color_converter_end_of_frame_out_out);
+    end generate color_converter_inst;
+
     packer_inst : if PACKER_ENABLE generate
         packer_raw : if not DEBAYER_ENABLE generate
             cmos_sensor_input_packer_inst : entity work.cmos_sensor_input_packer
@@ -275,6 +775,22 @@ begin
                          end_of_frame_out  => packer_raw_end_of_frame_out_out);
         end generate packer_raw;
 
+        packer_reduced : if not DEBAYER_ENABLE and DEPTH_REDUCER_ENABLE generate
+            cmos_sensor_input_packer_inst : entity work.cmos_sensor_input_packer
+                generic map(PIX_DEPTH  => REDUCED_PIX_DEPTH,
+                            PACK_WIDTH => OUTPUT_WIDTH)
+                port map(clk               => packer_reduced_clk_in,
+                         reset             => packer_reduced_reset_in,
+                         stop_and_reset    => packer_reduced_stop_and_reset_in,
+                         valid_in          => packer_reduced_valid_in_in,
+                         data_in           => packer_reduced_data_in_in,
+                         start_of_frame_in => packer_reduced_start_of_frame_in_in,
+                         end_of_frame_in   => packer_reduced_end_of_frame_in_in,
+                         valid_out         => packer_reduced_valid_out_out,
+                         data_out          => packer_reduced_data_out_out,
+                         end_of_frame_out  => packer_reduced_end_of_frame_out_out);
+        end generate packer_reduced;
+
         packer_rgb : if DEBAYER_ENABLE generate
             cmos_sensor_input_packer_inst : entity work.cmos_sensor_input_packer
                 generic map(PIX_DEPTH  => PIX_DEPTH_RGB,
@@ -290,6 +806,38 @@ begin
                          data_out          => packer_rgb_data_out_out,
                          end_of_frame_out  => packer_rgb_end_of_frame_out_out);
         end generate packer_rgb;
+
+        packer_rgb16 : if DEBAYER_ENABLE and COLOR_CONVERTER_ENABLE generate
+            cmos_sensor_input_packer_inst : entity work.cmos_sensor_input_packer
+                generic map(PIX_DEPTH  => PIX_DEPTH_RGB16,
+                            PACK_WIDTH => OUTPUT_WIDTH)
+                port map(clk               => packer_rgb16_clk_in,
+                         reset             => packer_rgb16_reset_in,
+                         stop_and_reset    => packer_rgb16_stop_and_reset_in,
+                         valid_in          => packer_rgb16_valid_in_in,
+                         data_in           => packer_rgb16_data_in_in,
+                         start_of_frame_in => packer_rgb16_start_of_frame_in_in,
+                         end_of_frame_in   => packer_rgb16_end_of_frame_in_in,
+                         valid_out         => packer_rgb16_valid_out_out,
+                         data_out          => packer_rgb16_data_out_out,
+                         end_of_frame_out  => packer_rgb16_end_of_frame_out_out);
+        end generate packer_rgb16;
+
+        packer_rgb24 : if DEBAYER_ENABLE and COLOR_CONVERTER_ENABLE generate
+            cmos_sensor_input_packer_inst : entity work.cmos_sensor_input_packer
+                generic map(PIX_DEPTH  => PIX_DEPTH_RGB24,
+                            PACK_WIDTH => OUTPUT_WIDTH)
+                port map(clk               => packer_rgb24_clk_in,
+                         reset             => packer_rgb24_reset_in,
+                         stop_and_reset    => packer_rgb24_stop_and_reset_in,
+                         valid_in          => packer_rgb24_valid_in_in,
+                         data_in           => packer_rgb24_data_in_in,
+                         start_of_frame_in => packer_rgb24_start_of_frame_in_in,
+                         end_of_frame_in   => packer_rgb24_end_of_frame_in_in,
+                         valid_out         => packer_rgb24_valid_out_out,
+                         data_out          => packer_rgb24_data_out_out,
+                         end_of_frame_out  => packer_rgb24_end_of_frame_out_out);
+        end generate packer_rgb24;
     end generate packer_inst;
 
     cmos_sensor_input_sc_fifo_inst : entity work.cmos_sensor_input_sc_fifo
@@ -316,6 +864,8 @@ begin
                  ready                => avalon_st_source_ready_in,
                  valid                => avalon_st_source_valid_out,
                  data                 => avalon_st_source_data_out,
+                 startofpacket        => avalon_st_source_startofpacket_out,
+                 endofpacket          => avalon_st_source_endofpacket_out,
                  fifo_read            => avalon_st_source_fifo_read_out,
                  fifo_empty           => avalon_st_source_fifo_empty_in,
                  fifo_data            => avalon_st_source_fifo_data_in,
@@ -324,7 +874,123 @@ begin
                  end_of_frame_out     => avalon_st_source_end_of_frame_out_out,
                  end_of_frame_out_ack => avalon_st_source_end_of_frame_out_ack_in);
 
-    TOP_LEVEL_INTERNALS_CONNECTIONS : process(addr, avalon_mm_slave_debayer_pattern_out, avalon_mm_slave_get_frame_info_out, avalon_mm_slave_irq_ack_out, avalon_mm_slave_irq_en_out, avalon_mm_slave_snapshot_out, avalon_mm_slave_stop_and_reset_out, avalon_st_source_end_of_frame_out_out, avalon_st_source_fifo_read_out, clk, data_in, debayer_data_out_out, debayer_end_of_frame_out_out, debayer_start_of_frame_out_out, debayer_valid_out_out, frame_valid, line_valid, packer_raw_data_out_out, packer_raw_end_of_frame_out_out, packer_raw_valid_out_out, packer_rgb_data_out_out, packer_rgb_end_of_frame_out_out, packer_rgb_valid_out_out, read, ready, reset, sampler_data_out_out, sampler_end_of_frame_in_ack_out, sampler_end_of_frame_out_out, sampler_frame_height_out, sampler_frame_width_out, sampler_idle_out, sampler_start_of_frame_out_out, sampler_valid_out_out, sampler_wait_irq_ack_out, sc_fifo_data_out_out, sc_fifo_empty_out, sc_fifo_overflow_out, sc_fifo_usedw_out, synchronizer_data_out_out, synchronizer_frame_valid_out_out, synchronizer_line_valid_out_out, wrdata, write)
+    preview_inst : if PREVIEW_ENABLE generate
+        packer_preview : if PACKER_ENABLE generate
+            cmos_sensor_input_packer_inst : entity work.cmos_sensor_input_packer
+                generic map(PIX_DEPTH  => PIX_DEPTH,
+                            PACK_WIDTH => OUTPUT_WIDTH)
+                port map(clk               => packer_preview_clk_in,
+                         reset             => packer_preview_reset_in,
+                         stop_and_reset    => packer_preview_stop_and_reset_in,
+                         valid_in          => packer_preview_valid_in_in,
+                         data_in           => packer_preview_data_in_in,
+                         start_of_frame_in => packer_preview_start_of_frame_in_in,
+                         end_of_frame_in   => packer_preview_end_of_frame_in_in,
+                         valid_out         => packer_preview_valid_out_out,
+                         data_out          => packer_preview_data_out_out,
+                         end_of_frame_out  => packer_preview_end_of_frame_out_out);
+        end generate packer_preview;
+
+        cmos_sensor_input_sc_fifo_preview_inst : entity work.cmos_sensor_input_sc_fifo
+            generic map(DATA_WIDTH    => FIFO_DATA_WIDTH,
+                        FIFO_DEPTH    => FIFO_DEPTH,
+                        DEVICE_FAMILY => DEVICE_FAMILY)
+            port map(clk      => sc_fifo_preview_clk_in,
+                     reset    => sc_fifo_preview_reset_in,
+                     clr      => sc_fifo_preview_clr_in,
+                     data_in  => sc_fifo_preview_data_in_in,
+                     data_out => sc_fifo_preview_data_out_out,
+                     read     => sc_fifo_preview_read_in,
+                     write    => sc_fifo_preview_write_in,
+                     empty    => sc_fifo_preview_empty_out,
+                     full     => sc_fifo_preview_full_out,
+                     usedw    => sc_fifo_preview_usedw_out,
+                     overflow => sc_fifo_preview_overflow_out);
+
+        cmos_sensor_input_avalon_st_source_preview_inst : entity work.cmos_sensor_input_avalon_st_source
+            generic map(DATA_WIDTH => OUTPUT_WIDTH)
+            port map(clk                  => avalon_st_source_preview_clk_in,
+                     reset                => avalon_st_source_preview_reset_in,
+                     stop_and_reset       => avalon_st_source_preview_stop_and_reset_in,
+                     ready                => avalon_st_source_preview_ready_in,
+                     valid                => avalon_st_source_preview_valid_out,
+                     data                 => avalon_st_source_preview_data_out,
+                     startofpacket        => avalon_st_source_preview_startofpacket_out,
+                     endofpacket          => avalon_st_source_preview_endofpacket_out,
+                     fifo_read            => avalon_st_source_preview_fifo_read_out,
+                     fifo_empty           => avalon_st_source_preview_fifo_empty_in,
+                     fifo_data            => avalon_st_source_preview_fifo_data_in,
+                     fifo_end_of_frame    => avalon_st_source_preview_fifo_end_of_frame_in,
+                     fifo_overflow        => avalon_st_source_preview_fifo_overflow_in,
+                     end_of_frame_out     => avalon_st_source_preview_end_of_frame_out_out,
+                     end_of_frame_out_ack => avalon_st_source_preview_end_of_frame_out_ack_in);
+    end generate preview_inst;
+
+    -- the downscaler operates on the raw bayer stream, before the debayer. If
+    -- the preview stream is enabled, the downscaler feeds the preview output
+    -- instead, and the main output carries the full resolution frame.
+    raw_valid          <= downscaler_valid_out_out          when DOWNSCALER_ENABLE and not PREVIEW_ENABLE else sampler_valid_out_out;
+    raw_data           <= downscaler_data_out_out           when DOWNSCALER_ENABLE and not PREVIEW_ENABLE else sampler_data_out_out;
+    raw_start_of_frame <= downscaler_start_of_frame_out_out when DOWNSCALER_ENABLE and not PREVIEW_ENABLE else sampler_start_of_frame_out_out;
+    raw_end_of_frame   <= downscaler_end_of_frame_out_out   when DOWNSCALER_ENABLE and not PREVIEW_ENABLE else sampler_end_of_frame_out_out;
+    raw_frame_width    <= downscaler_output_frame_width_out when DOWNSCALER_ENABLE and not PREVIEW_ENABLE else sampler_frame_width_out;
+
+    -- the processing stages operate on the raw bayer stream, before the plane
+    -- splitter and the debayer. Stages never change the frame dimensions, so
+    -- raw_frame_width also applies to their output.
+    raw_processed_valid          <= stage_chain_valid_out_out          when STAGE_COUNT > 0 else raw_valid;
+    raw_processed_data           <= stage_chain_data_out_out           when STAGE_COUNT > 0 else raw_data;
+    raw_processed_start_of_frame <= stage_chain_start_of_frame_out_out when STAGE_COUNT > 0 else raw_start_of_frame;
+    raw_processed_end_of_frame   <= stage_chain_end_of_frame_out_out   when STAGE_COUNT > 0 else raw_end_of_frame;
+
+    -- the blob unit taps the processed raw stream. In stats-only mode, the
+    -- stream is not forwarded to the rest of the pipeline, so nothing reaches
+    -- the fifo and the frame is only completed by the blob unit. The mode is
+    -- only latched while the pipeline is empty.
+    stats_only <= '1' when BLOB_COUNT > 0 and avalon_mm_slave_blob_stats_only_out = CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_ENABLE else '0';
+
+    raw_output_valid          <= raw_processed_valid and not stats_only;
+    raw_output_data           <= raw_processed_data;
+    raw_output_start_of_frame <= raw_processed_start_of_frame and not stats_only;
+    raw_output_end_of_frame   <= raw_processed_end_of_frame and not stats_only;
+
+    -- the plane splitter only operates on the raw bayer stream, and bypasses
+    -- it unless planar output is configured
+    raw_split_valid          <= planar_valid_out_out          when PLANAR_ENABLE else raw_output_valid;
+    raw_split_data           <= planar_data_out_out           when PLANAR_ENABLE else raw_output_data;
+    raw_split_start_of_frame <= planar_start_of_frame_out_out when PLANAR_ENABLE else raw_output_start_of_frame;
+    raw_split_end_of_frame   <= planar_end_of_frame_out_out   when PLANAR_ENABLE else raw_output_end_of_frame;
+
+    -- the depth reducer follows the plane splitter, and is bypassed (along
+    -- with its packer) unless a reduced depth mode is configured. The mode is
+    -- only latched while the pipeline is empty, so a frame is never split
+    -- between both paths.
+    depth_reduced <= '1' when DEPTH_REDUCER_ENABLE and avalon_mm_slave_depth_mode_out /= CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_FULL else '0';
+
+    -- the sparse unit follows the depth reducer, and replaces the packers and
+    -- the plain output while it is enabled. Frames then have a variable length,
+    -- and the Avalon-ST source marks their end with endofpacket.
+    sparse <= '1' when SPARSE_ENABLE and avalon_mm_slave_sparse_enable_out = CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_ENABLE else '0';
+
+    -- the compressor also follows the depth reducer, and replaces the packers
+    -- and the plain output while it is enabled (unless the sparse unit is).
+    -- Frames have a variable length as well.
+    compressed <= '1' when COMPRESSOR_ENABLE and avalon_mm_slave_compress_out = CMOS_SENSOR_INPUT_CONFIG_COMPRESS_ENABLE else '0';
+
+    -- the color converter follows the debayer, and is bypassed (along with its
+    -- packers) if the native RGB format is configured
+    color_converted <= '1' when COLOR_CONVERTER_ENABLE and avalon_mm_slave_output_format_out /= CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB else '0';
+
+    fifo_overflow <= sc_fifo_overflow_out or sc_fifo_preview_overflow_out when PREVIEW_ENABLE else sc_fifo_overflow_out;
+
+    -- end of the main output frame, as seen by the sampler: the Avalon-ST
+    -- source has output the frame and the blob unit has published its
+    -- statistics (only the latter in stats-only mode)
+    output_end_of_frame <= avalon_st_source_end_of_frame_out_out when BLOB_COUNT = 0 else
+                           blob_end_of_frame_out_out when stats_only = '1' else
+                           avalon_st_source_end_of_frame_out_out and blob_end_of_frame_out_out;
+
+    TOP_LEVEL_INTERNALS_CONNECTIONS : process(addr, avalon_mm_slave_blob_threshold_out, avalon_mm_slave_blob_word_out, avalon_mm_slave_debayer_pattern_out, avalon_mm_slave_depth_lut_index_out, avalon_mm_slave_depth_lut_value_out, avalon_mm_slave_depth_lut_write_out, avalon_mm_slave_depth_mode_out, avalon_mm_slave_downscale_factor_out, avalon_mm_slave_downscale_mode_out, avalon_mm_slave_get_frame_info_out, avalon_mm_slave_irq_ack_out, avalon_mm_slave_irq_en_out, avalon_mm_slave_output_format_out, avalon_mm_slave_planar_out, avalon_mm_slave_snapshot_out, avalon_mm_slave_sparse_threshold_out, avalon_mm_slave_stage_data_out, avalon_mm_slave_stage_index_out, avalon_mm_slave_stage_word_out, avalon_mm_slave_stage_write_out, avalon_mm_slave_stop_and_reset_out, avalon_st_source_fifo_read_out, avalon_st_source_preview_end_of_frame_out_out, avalon_st_source_preview_fifo_read_out, blob_result_data_out, clk, color_converted, color_converter_data_out_out, color_converter_end_of_frame_out_out, color_converter_start_of_frame_out_out, color_converter_valid_out_out, compressed, compressor_data_out_out, compressor_end_of_frame_out_out, compressor_valid_out_out, data_in, debayer_data_out_out, debayer_end_of_frame_out_out, debayer_start_of_frame_out_out, debayer_valid_out_out, depth_reduced, depth_reducer_data_out_out, depth_reducer_end_of_frame_out_out, depth_reducer_start_of_frame_out_out, depth_reducer_valid_out_out, downscaler_data_out_out, downscaler_end_of_frame_out_out, downscaler_start_of_frame_out_out, downscaler_valid_out_out, fifo_overflow, frame_valid, line_valid, output_end_of_frame, packer_preview_data_out_out, packer_preview_end_of_frame_out_out, packer_preview_valid_out_out, packer_raw_data_out_out, packer_raw_end_of_frame_out_out, packer_raw_valid_out_out, packer_reduced_data_out_out, packer_reduced_end_of_frame_out_out, packer_reduced_valid_out_out, packer_rgb16_data_out_out, packer_rgb16_end_of_frame_out_out, packer_rgb16_valid_out_out, packer_rgb24_data_out_out, packer_rgb24_end_of_frame_out_out, packer_rgb24_valid_out_out, packer_rgb_data_out_out, packer_rgb_end_of_frame_out_out, packer_rgb_valid_out_out, raw_data, raw_end_of_frame, raw_frame_width, raw_output_data, raw_output_end_of_frame, raw_output_start_of_frame, raw_output_valid, raw_processed_data, raw_processed_end_of_frame, raw_processed_start_of_frame, raw_processed_valid, raw_split_data, raw_split_end_of_frame, raw_split_start_of_frame, raw_split_valid, raw_start_of_frame, raw_valid, read, ready, ready_preview, reset, sampler_config_latch_out, sampler_data_out_out, sampler_end_of_frame_in_ack_out, sampler_end_of_frame_out_out, sampler_frame_height_out, sampler_frame_width_out, sampler_idle_out, sampler_start_of_frame_out_out, sampler_valid_out_out, sampler_wait_irq_ack_out, sc_fifo_data_out_out, sc_fifo_empty_out, sc_fifo_preview_data_out_out, sc_fifo_preview_empty_out, sc_fifo_usedw_out, sparse, sparse_data_out_out, sparse_end_of_frame_out_out, sparse_valid_out_out, synchronizer_data_out_out, synchronizer_frame_valid_out_out, synchronizer_line_valid_out_out, wrdata, write)
     begin
         -- always existing top-level connections -------------------------------
         avalon_mm_slave_clk_in           <= clk;
@@ -334,11 +1000,13 @@ begin
         avalon_mm_slave_write_in         <= write;
         avalon_mm_slave_wrdata_in        <= wrdata;
         avalon_mm_slave_idle_in          <= sampler_idle_out;
+        avalon_mm_slave_config_latch_in  <= sampler_config_latch_out;
         avalon_mm_slave_wait_irq_ack_in  <= sampler_wait_irq_ack_out;
         avalon_mm_slave_frame_width_in   <= sampler_frame_width_out;
         avalon_mm_slave_frame_height_in  <= sampler_frame_height_out;
         avalon_mm_slave_fifo_usedw_in    <= sc_fifo_usedw_out;
-        avalon_mm_slave_fifo_overflow_in <= sc_fifo_overflow_out;
+        avalon_mm_slave_fifo_overflow_in <= fifo_overflow;
+        avalon_mm_slave_blob_data_in     <= blob_result_data_out;
 
         synchronizer_clk_in            <= clk;
         synchronizer_reset_in          <= reset;
@@ -356,22 +1024,89 @@ begin
         sampler_frame_valid_in     <= synchronizer_frame_valid_out_out;
         sampler_line_valid_in      <= synchronizer_line_valid_out_out;
         sampler_data_in_in         <= synchronizer_data_out_out;
-        sampler_fifo_overflow_in   <= sc_fifo_overflow_out;
-        sampler_end_of_frame_in_in <= avalon_st_source_end_of_frame_out_out;
+        sampler_fifo_overflow_in   <= fifo_overflow;
+        sampler_end_of_frame_in_in <= output_end_of_frame;
+
+        downscaler_clk_in              <= clk;
+        downscaler_reset_in            <= reset;
+        downscaler_stop_and_reset_in   <= avalon_mm_slave_stop_and_reset_out;
+        downscaler_downscale_mode_in   <= avalon_mm_slave_downscale_mode_out;
+        downscaler_downscale_factor_in <= avalon_mm_slave_downscale_factor_out;
+        downscaler_frame_width_in      <= sampler_frame_width_out;
+
+        stage_chain_clk_in            <= clk;
+        stage_chain_reset_in          <= reset;
+        stage_chain_stop_and_reset_in <= avalon_mm_slave_stop_and_reset_out;
+        stage_chain_stage_write_in    <= avalon_mm_slave_stage_write_out;
+        stage_chain_stage_index_in    <= avalon_mm_slave_stage_index_out;
+        stage_chain_stage_word_in     <= avalon_mm_slave_stage_word_out;
+        stage_chain_stage_data_in     <= avalon_mm_slave_stage_data_out;
+        stage_chain_config_latch_in   <= sampler_config_latch_out;
+        stage_chain_frame_width_in    <= raw_frame_width;
+
+        blob_clk_in                  <= clk;
+        blob_reset_in                <= reset;
+        blob_stop_and_reset_in       <= avalon_mm_slave_stop_and_reset_out;
+        blob_threshold_in            <= avalon_mm_slave_blob_threshold_out;
+        blob_result_word_in          <= avalon_mm_slave_blob_word_out;
+        blob_frame_width_in          <= raw_frame_width;
+        blob_end_of_frame_out_ack_in <= sampler_end_of_frame_in_ack_out;
+
+        planar_clk_in            <= clk;
+        planar_reset_in          <= reset;
+        planar_stop_and_reset_in <= avalon_mm_slave_stop_and_reset_out;
+        planar_planar_in         <= avalon_mm_slave_planar_out;
+        planar_frame_width_in    <= raw_frame_width;
+
+        depth_reducer_clk_in            <= clk;
+        depth_reducer_reset_in          <= reset;
+        depth_reducer_stop_and_reset_in <= avalon_mm_slave_stop_and_reset_out;
+        depth_reducer_depth_mode_in     <= avalon_mm_slave_depth_mode_out;
+        depth_reducer_lut_write_in      <= avalon_mm_slave_depth_lut_write_out;
+        depth_reducer_lut_index_in      <= avalon_mm_slave_depth_lut_index_out;
+        depth_reducer_lut_value_in      <= avalon_mm_slave_depth_lut_value_out;
+
+        sparse_clk_in            <= clk;
+        sparse_reset_in          <= reset;
+        sparse_stop_and_reset_in <= avalon_mm_slave_stop_and_reset_out;
+        sparse_threshold_in      <= avalon_mm_slave_sparse_threshold_out;
+        sparse_frame_width_in    <= raw_frame_width;
+
+        compressor_clk_in            <= clk;
+        compressor_reset_in          <= reset;
+        compressor_stop_and_reset_in <= avalon_mm_slave_stop_and_reset_out;
+        compressor_frame_width_in    <= raw_frame_width;
 
         debayer_clk_in             <= clk;
         debayer_reset_in           <= reset;
         debayer_stop_and_reset_in  <= avalon_mm_slave_stop_and_reset_out;
         debayer_debayer_pattern_in <= avalon_mm_slave_debayer_pattern_out;
 
+        color_converter_clk_in            <= clk;
+        color_converter_reset_in          <= reset;
+        color_converter_stop_and_reset_in <= avalon_mm_slave_stop_and_reset_out;
+        color_converter_output_format_in  <= avalon_mm_slave_output_format_out;
+
         packer_raw_clk_in            <= clk;
         packer_raw_reset_in          <= reset;
         packer_raw_stop_and_reset_in <= avalon_mm_slave_stop_and_reset_out;
 
+        packer_reduced_clk_in            <= clk;
+        packer_reduced_reset_in          <= reset;
+        packer_reduced_stop_and_reset_in <= avalon_mm_slave_stop_and_reset_out;
+
         packer_rgb_clk_in            <= clk;
         packer_rgb_reset_in          <= reset;
         packer_rgb_stop_and_reset_in <= avalon_mm_slave_stop_and_reset_out;
 
+        packer_rgb16_clk_in            <= clk;
+        packer_rgb16_reset_in          <= reset;
+        packer_rgb16_stop_and_reset_in <= avalon_mm_slave_stop_and_reset_out;
+
+        packer_rgb24_clk_in            <= clk;
+        packer_rgb24_reset_in          <= reset;
+        packer_rgb24_stop_and_reset_in <= avalon_mm_slave_stop_and_reset_out;
+
         sc_fifo_clk_in   <= clk;
         sc_fifo_reset_in <= reset;
         sc_fifo_clr_in   <= avalon_mm_slave_stop_and_reset_out;
@@ -384,68 +1119,295 @@ begin
         avalon_st_source_fifo_empty_in           <= sc_fifo_empty_out;
         avalon_st_source_fifo_data_in            <= sc_fifo_data_out_out(avalon_st_source_fifo_data_in'range);
         avalon_st_source_fifo_end_of_frame_in    <= sc_fifo_data_out_out(FIFO_END_OF_FRAME_BIT_OFST);
-        avalon_st_source_fifo_overflow_in        <= sc_fifo_overflow_out;
+        avalon_st_source_fifo_overflow_in        <= fifo_overflow;
         avalon_st_source_end_of_frame_out_ack_in <= sampler_end_of_frame_in_ack_out;
 
+        packer_preview_clk_in            <= clk;
+        packer_preview_reset_in          <= reset;
+        packer_preview_stop_and_reset_in <= avalon_mm_slave_stop_and_reset_out;
+
+        sc_fifo_preview_clk_in   <= clk;
+        sc_fifo_preview_reset_in <= reset;
+        sc_fifo_preview_clr_in   <= avalon_mm_slave_stop_and_reset_out;
+        sc_fifo_preview_read_in  <= avalon_st_source_preview_fifo_read_out;
+
+        avalon_st_source_preview_clk_in                  <= clk;
+        avalon_st_source_preview_reset_in                <= reset;
+        avalon_st_source_preview_stop_and_reset_in       <= avalon_mm_slave_stop_and_reset_out;
+        avalon_st_source_preview_ready_in                <= ready_preview;
+        avalon_st_source_preview_fifo_empty_in           <= sc_fifo_preview_empty_out;
+        avalon_st_source_preview_fifo_data_in            <= sc_fifo_preview_data_out_out(avalon_st_source_preview_fifo_data_in'range);
+        avalon_st_source_preview_fifo_end_of_frame_in    <= sc_fifo_preview_data_out_out(FIFO_END_OF_FRAME_BIT_OFST);
+        avalon_st_source_preview_fifo_overflow_in        <= fifo_overflow;
+        avalon_st_source_preview_end_of_frame_out_ack_in <= sampler_end_of_frame_in_ack_out;
+
         -- default values for "configurable" signals ---------------------------
+        downscaler_valid_in_in          <= '0';
+        downscaler_data_in_in           <= (others => '0');
+        downscaler_start_of_frame_in_in <= '0';
+        downscaler_end_of_frame_in_in   <= '0';
+
+        stage_chain_valid_in_in          <= '0';
+        stage_chain_data_in_in           <= (others => '0');
+        stage_chain_start_of_frame_in_in <= '0';
+        stage_chain_end_of_frame_in_in   <= '0';
+
+        blob_valid_in_in          <= '0';
+        blob_data_in_in           <= (others => '0');
+        blob_start_of_frame_in_in <= '0';
+        blob_end_of_frame_in_in   <= '0';
+
+        planar_valid_in_in          <= '0';
+        planar_data_in_in           <= (others => '0');
+        planar_start_of_frame_in_in <= '0';
+        planar_end_of_frame_in_in   <= '0';
+
+        depth_reducer_valid_in_in          <= '0';
+        depth_reducer_data_in_in           <= (others => '0');
+        depth_reducer_start_of_frame_in_in <= '0';
+        depth_reducer_end_of_frame_in_in   <= '0';
+
+        sparse_valid_in_in          <= '0';
+        sparse_data_in_in           <= (others => '0');
+        sparse_start_of_frame_in_in <= '0';
+        sparse_end_of_frame_in_in   <= '0';
+
+        compressor_valid_in_in          <= '0';
+        compressor_data_in_in           <= (others => '0');
+        compressor_start_of_frame_in_in <= '0';
+        compressor_end_of_frame_in_in   <= '0';
+
         debayer_valid_in_in          <= '0';
         debayer_data_in_in           <= (others => '0');
         debayer_start_of_frame_in_in <= '0';
         debayer_end_of_frame_in_in   <= '0';
 
+        color_converter_valid_in_in          <= '0';
+        color_converter_data_in_in           <= (others => '0');
+        color_converter_start_of_frame_in_in <= '0';
+        color_converter_end_of_frame_in_in   <= '0';
+
         packer_raw_valid_in_in          <= '0';
         packer_raw_data_in_in           <= (others => '0');
         packer_raw_start_of_frame_in_in <= '0';
         packer_raw_end_of_frame_in_in   <= '0';
 
+        packer_reduced_valid_in_in          <= '0';
+        packer_reduced_data_in_in           <= (others => '0');
+        packer_reduced_start_of_frame_in_in <= '0';
+        packer_reduced_end_of_frame_in_in   <= '0';
+
         packer_rgb_valid_in_in          <= '0';
         packer_rgb_data_in_in           <= (others => '0');
         packer_rgb_start_of_frame_in_in <= '0';
         packer_rgb_end_of_frame_in_in   <= '0';
 
+        packer_rgb16_valid_in_in          <= '0';
+        packer_rgb16_data_in_in           <= (others => '0');
+        packer_rgb16_start_of_frame_in_in <= '0';
+        packer_rgb16_end_of_frame_in_in   <= '0';
+
+        packer_rgb24_valid_in_in          <= '0';
+        packer_rgb24_data_in_in           <= (others => '0');
+        packer_rgb24_start_of_frame_in_in <= '0';
+        packer_rgb24_end_of_frame_in_in   <= '0';
+
         sc_fifo_write_in   <= '0';
         sc_fifo_data_in_in <= (others => '0');
 
-        if not DEBAYER_ENABLE and not PACKER_ENABLE then
-            sc_fifo_write_in                               <= sampler_valid_out_out;
-            sc_fifo_data_in_in                             <= std_logic_vector(resize(unsigned(sampler_data_out_out), FIFO_DATA_WIDTH));
-            sc_fifo_data_in_in(FIFO_END_OF_FRAME_BIT_OFST) <= sampler_end_of_frame_out_out;
+        packer_preview_valid_in_in          <= '0';
+        packer_preview_data_in_in           <= (others => '0');
+        packer_preview_start_of_frame_in_in <= '0';
+        packer_preview_end_of_frame_in_in   <= '0';
+
+        sc_fifo_preview_write_in   <= '0';
+        sc_fifo_preview_data_in_in <= (others => '0');
+
+        if DOWNSCALER_ENABLE then
+            downscaler_valid_in_in          <= sampler_valid_out_out;
+            downscaler_data_in_in           <= sampler_data_out_out;
+            downscaler_start_of_frame_in_in <= sampler_start_of_frame_out_out;
+            downscaler_end_of_frame_in_in   <= sampler_end_of_frame_out_out;
+        end if;
+
+        if STAGE_COUNT > 0 then
+            stage_chain_valid_in_in          <= raw_valid;
+            stage_chain_data_in_in           <= raw_data;
+            stage_chain_start_of_frame_in_in <= raw_start_of_frame;
+            stage_chain_end_of_frame_in_in   <= raw_end_of_frame;
+        end if;
+
+        if BLOB_COUNT > 0 then
+            blob_valid_in_in          <= raw_processed_valid;
+            blob_data_in_in           <= raw_processed_data;
+            blob_start_of_frame_in_in <= raw_processed_start_of_frame;
+            blob_end_of_frame_in_in   <= raw_processed_end_of_frame;
+        end if;
+
+        if PLANAR_ENABLE then
+            planar_valid_in_in          <= raw_output_valid;
+            planar_data_in_in           <= raw_output_data;
+            planar_start_of_frame_in_in <= raw_output_start_of_frame;
+            planar_end_of_frame_in_in   <= raw_output_end_of_frame;
+        end if;
+
+        if DEPTH_REDUCER_ENABLE then
+            depth_reducer_valid_in_in          <= raw_split_valid;
+            depth_reducer_data_in_in           <= raw_split_data;
+            depth_reducer_start_of_frame_in_in <= raw_split_start_of_frame;
+            depth_reducer_end_of_frame_in_in   <= raw_split_end_of_frame;
+        end if;
+
+        if not DEBAYER_ENABLE and sparse = '1' then
+            if depth_reduced = '1' then
+                sparse_valid_in_in          <= depth_reducer_valid_out_out;
+                sparse_data_in_in           <= std_logic_vector(resize(unsigned(depth_reducer_data_out_out), PIX_DEPTH));
+                sparse_start_of_frame_in_in <= depth_reducer_start_of_frame_out_out;
+                sparse_end_of_frame_in_in   <= depth_reducer_end_of_frame_out_out;
+            else
+                sparse_valid_in_in          <= raw_split_valid;
+                sparse_data_in_in           <= raw_split_data;
+                sparse_start_of_frame_in_in <= raw_split_start_of_frame;
+                sparse_end_of_frame_in_in   <= raw_split_end_of_frame;
+            end if;
+
+            sc_fifo_write_in                               <= sparse_valid_out_out;
+            sc_fifo_data_in_in                             <= std_logic_vector(resize(unsigned(sparse_data_out_out), FIFO_DATA_WIDTH));
+            sc_fifo_data_in_in(FIFO_END_OF_FRAME_BIT_OFST) <= sparse_end_of_frame_out_out;
+
+        elsif not DEBAYER_ENABLE and compressed = '1' then
+            if depth_reduced = '1' then
+                compressor_valid_in_in          <= depth_reducer_valid_out_out;
+                compressor_data_in_in           <= std_logic_vector(resize(unsigned(depth_reducer_data_out_out), PIX_DEPTH));
+                compressor_start_of_frame_in_in <= depth_reducer_start_of_frame_out_out;
+                compressor_end_of_frame_in_in   <= depth_reducer_end_of_frame_out_out;
+            else
+                compressor_valid_in_in          <= raw_split_valid;
+                compressor_data_in_in           <= raw_split_data;
+                compressor_start_of_frame_in_in <= raw_split_start_of_frame;
+                compressor_end_of_frame_in_in   <= raw_split_end_of_frame;
+            end if;
+
+            sc_fifo_write_in                               <= compressor_valid_out_out;
+            sc_fifo_data_in_in                             <= std_logic_vector(resize(unsigned(compressor_data_out_out), FIFO_DATA_WIDTH));
+            sc_fifo_data_in_in(FIFO_END_OF_FRAME_BIT_OFST) <= compressor_end_of_frame_out_out;
+
+        elsif not DEBAYER_ENABLE and not PACKER_ENABLE then
+            if depth_reduced = '1' then
+                sc_fifo_write_in                               <= depth_reducer_valid_out_out;
+                sc_fifo_data_in_in                             <= std_logic_vector(resize(unsigned(depth_reducer_data_out_out), FIFO_DATA_WIDTH));
+                sc_fifo_data_in_in(FIFO_END_OF_FRAME_BIT_OFST) <= depth_reducer_end_of_frame_out_out;
+            else
+                sc_fifo_write_in                               <= raw_split_valid;
+                sc_fifo_data_in_in                             <= std_logic_vector(resize(unsigned(raw_split_data), FIFO_DATA_WIDTH));
+                sc_fifo_data_in_in(FIFO_END_OF_FRAME_BIT_OFST) <= raw_split_end_of_frame;
+            end if;
 
         elsif not DEBAYER_ENABLE and PACKER_ENABLE then
-            packer_raw_valid_in_in          <= sampler_valid_out_out;
-            packer_raw_data_in_in           <= sampler_data_out_out;
-            packer_raw_start_of_frame_in_in <= sampler_start_of_frame_out_out;
-            packer_raw_end_of_frame_in_in   <= sampler_end_of_frame_out_out;
+            if depth_reduced = '1' then
+                packer_reduced_valid_in_in          <= depth_reducer_valid_out_out;
+                packer_reduced_data_in_in           <= depth_reducer_data_out_out;
+                packer_reduced_start_of_frame_in_in <= depth_reducer_start_of_frame_out_out;
+                packer_reduced_end_of_frame_in_in   <= depth_reducer_end_of_frame_out_out;
 
-            sc_fifo_write_in                               <= packer_raw_valid_out_out;
-            sc_fifo_data_in_in                             <= std_logic_vector(resize(unsigned(packer_raw_data_out_out), FIFO_DATA_WIDTH));
-            sc_fifo_data_in_in(FIFO_END_OF_FRAME_BIT_OFST) <= packer_raw_end_of_frame_out_out;
+                sc_fifo_write_in                               <= packer_reduced_valid_out_out;
+                sc_fifo_data_in_in                             <= std_logic_vector(resize(unsigned(packer_reduced_data_out_out), FIFO_DATA_WIDTH));
+                sc_fifo_data_in_in(FIFO_END_OF_FRAME_BIT_OFST) <= packer_reduced_end_of_frame_out_out;
+            else
+                packer_raw_valid_in_in          <= raw_split_valid;
+                packer_raw_data_in_in           <= raw_split_data;
+                packer_raw_start_of_frame_in_in <= raw_split_start_of_frame;
+                packer_raw_end_of_frame_in_in   <= raw_split_end_of_frame;
+
+                sc_fifo_write_in                               <= packer_raw_valid_out_out;
+                sc_fifo_data_in_in                             <= std_logic_vector(resize(unsigned(packer_raw_data_out_out), FIFO_DATA_WIDTH));
+                sc_fifo_data_in_in(FIFO_END_OF_FRAME_BIT_OFST) <= packer_raw_end_of_frame_out_out;
+            end if;
 
         elsif DEBAYER_ENABLE and not PACKER_ENABLE then
-            debayer_valid_in_in          <= sampler_valid_out_out;
-            debayer_data_in_in           <= sampler_data_out_out;
-            debayer_start_of_frame_in_in <= sampler_start_of_frame_out_out;
-            debayer_end_of_frame_in_in   <= sampler_end_of_frame_out_out;
+            debayer_valid_in_in          <= raw_output_valid;
+            debayer_data_in_in           <= raw_output_data;
+            debayer_start_of_frame_in_in <= raw_output_start_of_frame;
+            debayer_end_of_frame_in_in   <= raw_output_end_of_frame;
+
+            if color_converted = '1' then
+                color_converter_valid_in_in          <= debayer_valid_out_out;
+                color_converter_data_in_in           <= debayer_data_out_out;
+                color_converter_start_of_frame_in_in <= debayer_start_of_frame_out_out;
+                color_converter_end_of_frame_in_in   <= debayer_end_of_frame_out_out;
 
-            sc_fifo_write_in                               <= debayer_valid_out_out;
-            sc_fifo_data_in_in                             <= std_logic_vector(resize(unsigned(debayer_data_out_out), FIFO_DATA_WIDTH));
-            sc_fifo_data_in_in(FIFO_END_OF_FRAME_BIT_OFST) <= debayer_end_of_frame_out_out;
+                sc_fifo_write_in                               <= color_converter_valid_out_out;
+                sc_fifo_data_in_in                             <= std_logic_vector(resize(unsigned(color_converter_data_out_out), FIFO_DATA_WIDTH));
+                sc_fifo_data_in_in(FIFO_END_OF_FRAME_BIT_OFST) <= color_converter_end_of_frame_out_out;
+            else
+                sc_fifo_write_in                               <= debayer_valid_out_out;
+                sc_fifo_data_in_in                             <= std_logic_vector(resize(unsigned(debayer_data_out_out), FIFO_DATA_WIDTH));
+                sc_fifo_data_in_in(FIFO_END_OF_FRAME_BIT_OFST) <= debayer_end_of_frame_out_out;
+            end if;
 
         elsif DEBAYER_ENABLE and PACKER_ENABLE then
-            debayer_valid_in_in          <= sampler_valid_out_out;
-            debayer_data_in_in           <= sampler_data_out_out;
-            debayer_start_of_frame_in_in <= sampler_start_of_frame_out_out;
-            debayer_end_of_frame_in_in   <= sampler_end_of_frame_out_out;
+            debayer_valid_in_in          <= raw_output_valid;
+            debayer_data_in_in           <= raw_output_data;
+            debayer_start_of_frame_in_in <= raw_output_start_of_frame;
+            debayer_end_of_frame_in_in   <= raw_output_end_of_frame;
+
+            if color_converted = '1' then
+                color_converter_valid_in_in          <= debayer_valid_out_out;
+                color_converter_data_in_in           <= debayer_data_out_out;
+                color_converter_start_of_frame_in_in <= debayer_start_of_frame_out_out;
+                color_converter_end_of_frame_in_in   <= debayer_end_of_frame_out_out;
+
+                if avalon_mm_slave_output_format_out = CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB888 then
+                    packer_rgb24_valid_in_in          <= color_converter_valid_out_out;
+                    packer_rgb24_data_in_in           <= color_converter_data_out_out;
+                    packer_rgb24_start_of_frame_in_in <= color_converter_start_of_frame_out_out;
+                    packer_rgb24_end_of_frame_in_in   <= color_converter_end_of_frame_out_out;
+
+                    sc_fifo_write_in                               <= packer_rgb24_valid_out_out;
+                    sc_fifo_data_in_in                             <= std_logic_vector(resize(unsigned(packer_rgb24_data_out_out), FIFO_DATA_WIDTH));
+                    sc_fifo_data_in_in(FIFO_END_OF_FRAME_BIT_OFST) <= packer_rgb24_end_of_frame_out_out;
+                else
+                    packer_rgb16_valid_in_in          <= color_converter_valid_out_out;
+                    packer_rgb16_data_in_in           <= color_converter_data_out_out(PIX_DEPTH_RGB16 - 1 downto 0);
+                    packer_rgb16_start_of_frame_in_in <= color_converter_start_of_frame_out_out;
+                    packer_rgb16_end_of_frame_in_in   <= color_converter_end_of_frame_out_out;
+
+                    sc_fifo_write_in                               <= packer_rgb16_valid_out_out;
+                    sc_fifo_data_in_in                             <= std_logic_vector(resize(unsigned(packer_rgb16_data_out_out), FIFO_DATA_WIDTH));
+                    sc_fifo_data_in_in(FIFO_END_OF_FRAME_BIT_OFST) <= packer_rgb16_end_of_frame_out_out;
+                end if;
+            else
+                packer_rgb_valid_in_in          <= debayer_valid_out_out;
+                packer_rgb_data_in_in           <= debayer_data_out_out;
+                packer_rgb_start_of_frame_in_in <= debayer_start_of_frame_out_out;
+                packer_rgb_end_of_frame_in_in   <= debayer_end_of_frame_out_out;
+
+                sc_fifo_write_in                               <= packer_rgb_valid_out_out;
+                sc_fifo_data_in_in                             <= std_logic_vector(resize(unsigned(packer_rgb_data_out_out), FIFO_DATA_WIDTH));
+                sc_fifo_data_in_in(FIFO_END_OF_FRAME_BIT_OFST) <= packer_rgb_end_of_frame_out_out;
+            end if;
+
+        end if;
 
-            packer_rgb_valid_in_in          <= debayer_valid_out_out;
-            packer_rgb_data_in_in           <= debayer_data_out_out;
-            packer_rgb_start_of_frame_in_in <= debayer_start_of_frame_out_out;
-            packer_rgb_end_of_frame_in_in   <= debayer_end_of_frame_out_out;
+        -- preview stream (downscaled raw bayer frame, never debayered)
+        if PREVIEW_ENABLE then
+            -- the sampler only considers a frame finished once both streams have output it
+            sampler_end_of_frame_in_in <= output_end_of_frame and avalon_st_source_preview_end_of_frame_out_out;
 
-            sc_fifo_write_in                               <= packer_rgb_valid_out_out;
-            sc_fifo_data_in_in                             <= std_logic_vector(resize(unsigned(packer_rgb_data_out_out), FIFO_DATA_WIDTH));
-            sc_fifo_data_in_in(FIFO_END_OF_FRAME_BIT_OFST) <= packer_rgb_end_of_frame_out_out;
+            if not PACKER_ENABLE then
+                sc_fifo_preview_write_in                               <= downscaler_valid_out_out;
+                sc_fifo_preview_data_in_in                             <= std_logic_vector(resize(unsigned(downscaler_data_out_out), FIFO_DATA_WIDTH));
+                sc_fifo_preview_data_in_in(FIFO_END_OF_FRAME_BIT_OFST) <= downscaler_end_of_frame_out_out;
+            else
+                packer_preview_valid_in_in          <= downscaler_valid_out_out;
+                packer_preview_data_in_in           <= downscaler_data_out_out;
+                packer_preview_start_of_frame_in_in <= downscaler_start_of_frame_out_out;
+                packer_preview_end_of_frame_in_in   <= downscaler_end_of_frame_out_out;
 
+                sc_fifo_preview_write_in                               <= packer_preview_valid_out_out;
+                sc_fifo_preview_data_in_in                             <= std_logic_vector(resize(unsigned(packer_preview_data_out_out), FIFO_DATA_WIDTH));
+                sc_fifo_preview_data_in_in(FIFO_END_OF_FRAME_BIT_OFST) <= packer_preview_end_of_frame_out_out;
+            end if;
         end if;
     end process;
 
@@ -16,6 +16,8 @@ entity cmos_sensor_input_avalon_st_source is
         ready                : in  std_logic;
         valid                : out std_logic;
         data                 : out std_logic_vector(DATA_WIDTH - 1 downto 0);
+        startofpacket        : out std_logic;
+        endofpacket          : out std_logic;
 
         -- fifo
         fifo_read            : out std_logic;
@@ -35,6 +37,9 @@ architecture rtl of cmos_sensor_input_avalon_st_source is
 
     signal reg_state, next_reg_state : state_type;
 
+    -- '1' until the first word of the next frame is output
+    signal reg_start_of_packet : std_logic;
+
     signal data_little_endian : std_logic_vector(data'range);
     signal data_big_endian    : std_logic_vector(data'range);
 
@@ -42,21 +47,30 @@ begin
     STATE_LOGIC : process(clk, reset)
     begin
         if reset = '1' then
-            reg_state <= STATE_IDLE;
+            reg_state           <= STATE_IDLE;
+            reg_start_of_packet <= '1';
         elsif rising_edge(clk) then
             if stop_and_reset = '1' then
-                reg_state <= STATE_IDLE;
+                reg_state           <= STATE_IDLE;
+                reg_start_of_packet <= '1';
             else
                 reg_state <= next_reg_state;
+
+                -- each frame is output as one Avalon-ST packet
+                if reg_state = STATE_READY_CYCLE and fifo_empty = '0' and fifo_overflow = '0' then
+                    reg_start_of_packet <= fifo_end_of_frame;
+                end if;
             end if;
         end if;
     end process;
 
-    NEXT_STATE_LOGIC : process(data_big_endian, end_of_frame_out_ack, fifo_empty, fifo_end_of_frame, fifo_overflow, ready, reg_state)
+    NEXT_STATE_LOGIC : process(data_big_endian, end_of_frame_out_ack, fifo_empty, fifo_end_of_frame, fifo_overflow, ready, reg_start_of_packet, reg_state)
     begin
         fifo_read        <= '0';
         valid            <= '0';
         data             <= (others => '0');
+        startofpacket    <= '0';
+        endofpacket      <= '0';
         end_of_frame_out <= '0';
 
         next_reg_state <= reg_state;
@@ -73,9 +87,11 @@ begin
                 end if;
 
                 if fifo_empty = '0' and fifo_overflow = '0' then
-                    fifo_read <= '1';
-                    valid     <= '1';
-                    data      <= data_big_endian;
+                    fifo_read     <= '1';
+                    valid         <= '1';
+                    data          <= data_big_endian;
+                    startofpacket <= reg_start_of_packet;
+                    endofpacket   <= fifo_end_of_frame;
 
                     if fifo_end_of_frame = '1' then
                         next_reg_state <= STATE_WAIT_END_OF_FRAME_ACK;
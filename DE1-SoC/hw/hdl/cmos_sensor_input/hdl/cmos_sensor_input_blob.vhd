@@ -0,0 +1,496 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.cmos_sensor_input_constants.all;
+
+-- Blob statistics unit.
+--
+-- Thresholds the raw pixel stream (a pixel is lit if its value is >= the
+-- THRESHOLD field of the BLOB_CONFIG register), and accumulates statistics on
+-- up to BLOB_COUNT 8-connected groups of lit pixels (blobs) per frame:
+--
+--   PIXELS    number of pixels
+--   SUM_X     sum of the column index of the pixels
+--   SUM_Y     sum of the row index of the pixels
+--   SUM_VALUE sum of the pixel values
+--   X, Y      bounding box (MIN and MAX column / row)
+--
+-- so that software can compute the centroid (SUM_X / PIXELS, SUM_Y / PIXELS)
+-- or the intensity weighted centroid without reading the frame. Sums are 32
+-- bits wide and wrap around for very large blobs.
+--
+-- The stream is first split into horizontal runs of lit pixels. Each run is
+-- then merged into the first blob whose extent on the previous row touches it
+-- (including diagonally), or starts a new blob if none does. A run touching
+-- several blobs only extends the first one, so blobs that only join below
+-- their top (U shapes) are reported as several blobs. Runs that do not fit in
+-- the BLOB_COUNT blobs are dropped, and the OVERFLOW status bit is set.
+--
+-- Statistics are published to the result words (read through BLOB_ADDR /
+-- BLOB_DATA) when end_of_frame_in is seen, so they always describe the last
+-- complete frame. end_of_frame_out is then held until end_of_frame_out_ack,
+-- like the Avalon-ST source does, so the sampler only considers a frame
+-- finished once its statistics are available.
+entity cmos_sensor_input_blob is
+    generic(
+        PIX_DEPTH  : positive;
+        MAX_WIDTH  : positive;
+        MAX_HEIGHT : positive;
+        BLOB_COUNT : positive range 1 to CMOS_SENSOR_INPUT_MAX_BLOB_COUNT
+    );
+    port(
+        clk                  : in  std_logic;
+        reset                : in  std_logic;
+
+        -- avalon_mm_slave
+        stop_and_reset       : in  std_logic;
+        threshold            : in  std_logic_vector(CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_WIDTH - 1 downto 0);
+        result_word          : in  std_logic_vector(CMOS_SENSOR_INPUT_BLOB_ADDR_WORD_WIDTH - 1 downto 0);
+        result_data          : out std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+
+        -- sampler / downscaler / stage_chain
+        frame_width          : in  std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+        valid_in             : in  std_logic;
+        data_in              : in  std_logic_vector(PIX_DEPTH - 1 downto 0);
+        start_of_frame_in    : in  std_logic;
+        end_of_frame_in      : in  std_logic;
+
+        -- sampler
+        end_of_frame_out     : out std_logic;
+        end_of_frame_out_ack : in  std_logic
+    );
+end entity cmos_sensor_input_blob;
+
+architecture rtl of cmos_sensor_input_blob is
+    constant COORD_WIDTH : positive := bit_width(max(MAX_WIDTH, MAX_HEIGHT));
+    constant SUM_WIDTH   : positive := CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH;
+
+    type coord_array is array (0 to BLOB_COUNT - 1) of unsigned(COORD_WIDTH - 1 downto 0);
+    type sum_array is array (0 to BLOB_COUNT - 1) of unsigned(SUM_WIDTH - 1 downto 0);
+
+    -- run accumulator (stage 1)
+    signal reg_next_x        : unsigned(COORD_WIDTH - 1 downto 0);
+    signal reg_next_y        : unsigned(COORD_WIDTH - 1 downto 0);
+    signal reg_run_active    : std_logic;
+    signal reg_run_xs        : unsigned(COORD_WIDTH - 1 downto 0);
+    signal reg_run_pixels    : unsigned(SUM_WIDTH - 1 downto 0);
+    signal reg_run_sum_x     : unsigned(SUM_WIDTH - 1 downto 0);
+    signal reg_run_sum_y     : unsigned(SUM_WIDTH - 1 downto 0);
+    signal reg_run_sum_value : unsigned(SUM_WIDTH - 1 downto 0);
+
+    -- completed run (stage 1 -> stage 2)
+    signal reg_emit           : std_logic;
+    signal reg_emit_xs        : unsigned(COORD_WIDTH - 1 downto 0);
+    signal reg_emit_xe        : unsigned(COORD_WIDTH - 1 downto 0);
+    signal reg_emit_y         : unsigned(COORD_WIDTH - 1 downto 0);
+    signal reg_emit_pixels    : unsigned(SUM_WIDTH - 1 downto 0);
+    signal reg_emit_sum_x     : unsigned(SUM_WIDTH - 1 downto 0);
+    signal reg_emit_sum_y     : unsigned(SUM_WIDTH - 1 downto 0);
+    signal reg_emit_sum_value : unsigned(SUM_WIDTH - 1 downto 0);
+    signal reg_start_of_frame : std_logic;
+    signal reg_end_of_frame   : std_logic;
+
+    -- blob slots (stage 2). The row extents of a blob on the current row
+    -- (reg_cur_*) and on the previous row (reg_prev_*) are used to decide
+    -- which blob a run belongs to.
+    signal reg_row       : unsigned(COORD_WIDTH - 1 downto 0);
+    signal reg_used      : std_logic_vector(0 to BLOB_COUNT - 1);
+    signal reg_overflow  : std_logic;
+    signal reg_pixels    : sum_array;
+    signal reg_sum_x     : sum_array;
+    signal reg_sum_y     : sum_array;
+    signal reg_sum_value : sum_array;
+    signal reg_x_min     : coord_array;
+    signal reg_x_max     : coord_array;
+    signal reg_y_min     : coord_array;
+    signal reg_y_max     : coord_array;
+    signal reg_cur       : std_logic_vector(0 to BLOB_COUNT - 1);
+    signal reg_cur_min   : coord_array;
+    signal reg_cur_max   : coord_array;
+    signal reg_prev      : std_logic_vector(0 to BLOB_COUNT - 1);
+    signal reg_prev_min  : coord_array;
+    signal reg_prev_max  : coord_array;
+    signal reg_publish   : std_logic;
+
+    -- published results of the last frame
+    signal reg_res_count     : unsigned(CMOS_SENSOR_INPUT_BLOB_STATUS_COUNT_WIDTH - 1 downto 0);
+    signal reg_res_overflow  : std_logic;
+    signal reg_res_pixels    : sum_array;
+    signal reg_res_sum_x     : sum_array;
+    signal reg_res_sum_y     : sum_array;
+    signal reg_res_sum_value : sum_array;
+    signal reg_res_x_min     : coord_array;
+    signal reg_res_x_max     : coord_array;
+    signal reg_res_y_min     : coord_array;
+    signal reg_res_y_max     : coord_array;
+
+    signal reg_end_of_frame_out : std_logic;
+
+begin
+    end_of_frame_out <= reg_end_of_frame_out;
+
+    -- splits the lit pixels of each row into runs. A run is emitted on the
+    -- first unlit pixel after it, or on the last pixel of its row.
+    RUNS : process(clk, reset)
+        variable x           : unsigned(COORD_WIDTH - 1 downto 0);
+        variable y           : unsigned(COORD_WIDTH - 1 downto 0);
+        variable active      : boolean;
+        variable last_in_row : boolean;
+        variable xs          : unsigned(COORD_WIDTH - 1 downto 0);
+        variable pixels      : unsigned(SUM_WIDTH - 1 downto 0);
+        variable sum_x       : unsigned(SUM_WIDTH - 1 downto 0);
+        variable sum_y       : unsigned(SUM_WIDTH - 1 downto 0);
+        variable sum_value   : unsigned(SUM_WIDTH - 1 downto 0);
+    begin
+        if reset = '1' then
+            reg_next_x         <= (others => '0');
+            reg_next_y         <= (others => '0');
+            reg_run_active     <= '0';
+            reg_run_xs         <= (others => '0');
+            reg_run_pixels     <= (others => '0');
+            reg_run_sum_x      <= (others => '0');
+            reg_run_sum_y      <= (others => '0');
+            reg_run_sum_value  <= (others => '0');
+            reg_emit           <= '0';
+            reg_emit_xs        <= (others => '0');
+            reg_emit_xe        <= (others => '0');
+            reg_emit_y         <= (others => '0');
+            reg_emit_pixels    <= (others => '0');
+            reg_emit_sum_x     <= (others => '0');
+            reg_emit_sum_y     <= (others => '0');
+            reg_emit_sum_value <= (others => '0');
+            reg_start_of_frame <= '0';
+            reg_end_of_frame   <= '0';
+        elsif rising_edge(clk) then
+            reg_emit           <= '0';
+            reg_start_of_frame <= '0';
+            reg_end_of_frame   <= '0';
+
+            if stop_and_reset = '1' then
+                reg_run_active <= '0';
+            elsif valid_in = '1' then
+                if start_of_frame_in = '1' then
+                    x      := (others => '0');
+                    y      := (others => '0');
+                    active := false;
+                else
+                    x      := reg_next_x;
+                    y      := reg_next_y;
+                    active := reg_run_active = '1';
+                end if;
+
+                xs        := reg_run_xs;
+                pixels    := reg_run_pixels;
+                sum_x     := reg_run_sum_x;
+                sum_y     := reg_run_sum_y;
+                sum_value := reg_run_sum_value;
+
+                last_in_row := x = unsigned(frame_width) - 1 or end_of_frame_in = '1';
+
+                if unsigned(data_in) >= unsigned(threshold) then
+                    if not active then
+                        xs        := x;
+                        pixels    := (others => '0');
+                        sum_x     := (others => '0');
+                        sum_y     := (others => '0');
+                        sum_value := (others => '0');
+                        active    := true;
+                    end if;
+
+                    pixels    := pixels + 1;
+                    sum_x     := sum_x + x;
+                    sum_y     := sum_y + y;
+                    sum_value := sum_value + unsigned(data_in);
+
+                    if last_in_row then
+                        reg_emit    <= '1';
+                        reg_emit_xe <= x;
+                        active      := false;
+                    end if;
+                elsif active then
+                    reg_emit    <= '1';
+                    reg_emit_xe <= x - 1;
+                    active      := false;
+                end if;
+
+                reg_emit_xs        <= xs;
+                reg_emit_y         <= y;
+                reg_emit_pixels    <= pixels;
+                reg_emit_sum_x     <= sum_x;
+                reg_emit_sum_y     <= sum_y;
+                reg_emit_sum_value <= sum_value;
+
+                reg_run_xs        <= xs;
+                reg_run_pixels    <= pixels;
+                reg_run_sum_x     <= sum_x;
+                reg_run_sum_y     <= sum_y;
+                reg_run_sum_value <= sum_value;
+
+                if active then
+                    reg_run_active <= '1';
+                else
+                    reg_run_active <= '0';
+                end if;
+
+                if last_in_row then
+                    reg_next_x <= (others => '0');
+                    reg_next_y <= y + 1;
+                else
+                    reg_next_x <= x + 1;
+                    reg_next_y <= y;
+                end if;
+
+                reg_start_of_frame <= start_of_frame_in;
+                reg_end_of_frame   <= end_of_frame_in;
+            end if;
+        end if;
+    end process;
+
+    -- merges the runs into the blob slots, and publishes the slots at the end
+    -- of the frame
+    BLOBS : process(clk, reset)
+        variable cur      : std_logic_vector(0 to BLOB_COUNT - 1);
+        variable cur_min  : coord_array;
+        variable cur_max  : coord_array;
+        variable prev     : std_logic_vector(0 to BLOB_COUNT - 1);
+        variable prev_min : coord_array;
+        variable prev_max : coord_array;
+        variable target   : natural range 0 to BLOB_COUNT - 1;
+        variable found    : boolean;
+        variable allocate : boolean;
+        variable count    : unsigned(reg_res_count'range);
+    begin
+        if reset = '1' then
+            reg_row              <= (others => '0');
+            reg_used             <= (others => '0');
+            reg_overflow         <= '0';
+            reg_pixels           <= (others => (others => '0'));
+            reg_sum_x            <= (others => (others => '0'));
+            reg_sum_y            <= (others => (others => '0'));
+            reg_sum_value        <= (others => (others => '0'));
+            reg_x_min            <= (others => (others => '0'));
+            reg_x_max            <= (others => (others => '0'));
+            reg_y_min            <= (others => (others => '0'));
+            reg_y_max            <= (others => (others => '0'));
+            reg_cur              <= (others => '0');
+            reg_cur_min          <= (others => (others => '0'));
+            reg_cur_max          <= (others => (others => '0'));
+            reg_prev             <= (others => '0');
+            reg_prev_min         <= (others => (others => '0'));
+            reg_prev_max         <= (others => (others => '0'));
+            reg_publish          <= '0';
+            reg_res_count        <= (others => '0');
+            reg_res_overflow     <= '0';
+            reg_res_pixels       <= (others => (others => '0'));
+            reg_res_sum_x        <= (others => (others => '0'));
+            reg_res_sum_y        <= (others => (others => '0'));
+            reg_res_sum_value    <= (others => (others => '0'));
+            reg_res_x_min        <= (others => (others => '0'));
+            reg_res_x_max        <= (others => (others => '0'));
+            reg_res_y_min        <= (others => (others => '0'));
+            reg_res_y_max        <= (others => (others => '0'));
+            reg_end_of_frame_out <= '0';
+        elsif rising_edge(clk) then
+            reg_publish <= '0';
+
+            if stop_and_reset = '1' then
+                reg_used             <= (others => '0');
+                reg_overflow         <= '0';
+                reg_cur              <= (others => '0');
+                reg_prev             <= (others => '0');
+                reg_end_of_frame_out <= '0';
+
+            elsif reg_start_of_frame = '1' then
+                -- no run can end on the first pixel of a frame, as frames
+                -- have at least 2 columns
+                reg_row              <= (others => '0');
+                reg_used             <= (others => '0');
+                reg_overflow         <= '0';
+                reg_cur              <= (others => '0');
+                reg_prev             <= (others => '0');
+                reg_end_of_frame_out <= '0';
+
+            elsif reg_emit = '1' then
+                cur      := reg_cur;
+                cur_min  := reg_cur_min;
+                cur_max  := reg_cur_max;
+                prev     := reg_prev;
+                prev_min := reg_prev_min;
+                prev_max := reg_prev_max;
+
+                -- the run is on a new row: the current row extents become the
+                -- previous row extents if the rows are adjacent
+                if reg_emit_y /= reg_row then
+                    if reg_emit_y = reg_row + 1 then
+                        prev     := cur;
+                        prev_min := cur_min;
+                        prev_max := cur_max;
+                    else
+                        prev := (others => '0');
+                    end if;
+
+                    cur     := (others => '0');
+                    reg_row <= reg_emit_y;
+                end if;
+
+                -- first blob touching the run on the previous row (8-connected)
+                found  := false;
+                target := 0;
+                for i in 0 to BLOB_COUNT - 1 loop
+                    if not found and reg_used(i) = '1' and prev(i) = '1' and
+                       resize(reg_emit_xs, COORD_WIDTH + 1) <= resize(prev_max(i), COORD_WIDTH + 1) + 1 and
+                       resize(reg_emit_xe, COORD_WIDTH + 1) + 1 >= resize(prev_min(i), COORD_WIDTH + 1) then
+                        found  := true;
+                        target := i;
+                    end if;
+                end loop;
+
+                -- otherwise, first free blob
+                allocate := false;
+                if not found then
+                    for i in 0 to BLOB_COUNT - 1 loop
+                        if not found and reg_used(i) = '0' then
+                            found    := true;
+                            allocate := true;
+                            target   := i;
+                        end if;
+                    end loop;
+                end if;
+
+                if not found then
+                    reg_overflow <= '1';
+                elsif allocate then
+                    reg_used(target)      <= '1';
+                    reg_pixels(target)    <= reg_emit_pixels;
+                    reg_sum_x(target)     <= reg_emit_sum_x;
+                    reg_sum_y(target)     <= reg_emit_sum_y;
+                    reg_sum_value(target) <= reg_emit_sum_value;
+                    reg_x_min(target)     <= reg_emit_xs;
+                    reg_x_max(target)     <= reg_emit_xe;
+                    reg_y_min(target)     <= reg_emit_y;
+                    reg_y_max(target)     <= reg_emit_y;
+
+                    cur(target)     := '1';
+                    cur_min(target) := reg_emit_xs;
+                    cur_max(target) := reg_emit_xe;
+                else
+                    reg_pixels(target)    <= reg_pixels(target) + reg_emit_pixels;
+                    reg_sum_x(target)     <= reg_sum_x(target) + reg_emit_sum_x;
+                    reg_sum_y(target)     <= reg_sum_y(target) + reg_emit_sum_y;
+                    reg_sum_value(target) <= reg_sum_value(target) + reg_emit_sum_value;
+
+                    if reg_emit_xs < reg_x_min(target) then
+                        reg_x_min(target) <= reg_emit_xs;
+                    end if;
+                    if reg_emit_xe > reg_x_max(target) then
+                        reg_x_max(target) <= reg_emit_xe;
+                    end if;
+
+                    -- rows are processed in order
+                    reg_y_max(target) <= reg_emit_y;
+
+                    if cur(target) = '0' then
+                        cur(target)     := '1';
+                        cur_min(target) := reg_emit_xs;
+                        cur_max(target) := reg_emit_xe;
+                    else
+                        -- runs of a row arrive from left to right
+                        cur_max(target) := reg_emit_xe;
+                    end if;
+                end if;
+
+                reg_cur      <= cur;
+                reg_cur_min  <= cur_min;
+                reg_cur_max  <= cur_max;
+                reg_prev     <= prev;
+                reg_prev_min <= prev_min;
+                reg_prev_max <= prev_max;
+            end if;
+
+            -- the last run of the frame is merged in the same cycle as
+            -- reg_end_of_frame, so the slots are published on the next one
+            if stop_and_reset = '0' and reg_end_of_frame = '1' then
+                reg_publish <= '1';
+            end if;
+
+            if reg_publish = '1' then
+                count := (others => '0');
+                for i in 0 to BLOB_COUNT - 1 loop
+                    if reg_used(i) = '1' then
+                        count := count + 1;
+                    end if;
+                end loop;
+
+                -- used slots are always allocated from the first one, so the
+                -- published blobs are contiguous
+                reg_res_count        <= count;
+                reg_res_overflow     <= reg_overflow;
+                reg_res_pixels       <= reg_pixels;
+                reg_res_sum_x        <= reg_sum_x;
+                reg_res_sum_y        <= reg_sum_y;
+                reg_res_sum_value    <= reg_sum_value;
+                reg_res_x_min        <= reg_x_min;
+                reg_res_x_max        <= reg_x_max;
+                reg_res_y_min        <= reg_y_min;
+                reg_res_y_max        <= reg_y_max;
+                reg_end_of_frame_out <= '1';
+            end if;
+
+            if reg_end_of_frame_out = '1' and end_of_frame_out_ack = '1' then
+                reg_end_of_frame_out <= '0';
+            end if;
+        end if;
+    end process;
+
+    RESULT : process(reg_res_count, reg_res_overflow, reg_res_pixels, reg_res_sum_value, reg_res_sum_x, reg_res_sum_y, reg_res_x_max, reg_res_x_min, reg_res_y_max, reg_res_y_min, result_word)
+        variable word  : natural range 0 to 2 ** CMOS_SENSOR_INPUT_BLOB_ADDR_WORD_WIDTH - 1;
+        variable index : natural;
+    begin
+        result_data <= (others => '0');
+
+        word := to_integer(unsigned(result_word));
+
+        if word = CMOS_SENSOR_INPUT_BLOB_STATUS_WORD then
+            result_data(CMOS_SENSOR_INPUT_BLOB_STATUS_COUNT_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_BLOB_STATUS_COUNT_LOW_BIT_OFST) <= std_logic_vector(reg_res_count);
+
+            if reg_res_overflow = '1' then
+                result_data(CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_LOW_BIT_OFST) <= CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_OVERFLOW;
+            else
+                result_data(CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_LOW_BIT_OFST) <= CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_NO_OVERFLOW;
+            end if;
+
+        elsif word >= CMOS_SENSOR_INPUT_BLOB_RECORD_WORD and word < CMOS_SENSOR_INPUT_BLOB_RECORD_WORD + BLOB_COUNT * CMOS_SENSOR_INPUT_BLOB_RECORD_SIZE then
+            index := (word - CMOS_SENSOR_INPUT_BLOB_RECORD_WORD) / CMOS_SENSOR_INPUT_BLOB_RECORD_SIZE;
+
+            -- records of unused slots read as 0
+            if index < to_integer(reg_res_count) then
+                case (word - CMOS_SENSOR_INPUT_BLOB_RECORD_WORD) mod CMOS_SENSOR_INPUT_BLOB_RECORD_SIZE is
+                    when CMOS_SENSOR_INPUT_BLOB_PIXELS_WORD =>
+                        result_data <= std_logic_vector(reg_res_pixels(index));
+
+                    when CMOS_SENSOR_INPUT_BLOB_SUM_X_WORD =>
+                        result_data <= std_logic_vector(reg_res_sum_x(index));
+
+                    when CMOS_SENSOR_INPUT_BLOB_SUM_Y_WORD =>
+                        result_data <= std_logic_vector(reg_res_sum_y(index));
+
+                    when CMOS_SENSOR_INPUT_BLOB_SUM_VALUE_WORD =>
+                        result_data <= std_logic_vector(reg_res_sum_value(index));
+
+                    when CMOS_SENSOR_INPUT_BLOB_X_WORD =>
+                        result_data(CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_LOW_BIT_OFST) <= std_logic_vector(resize(reg_res_x_min(index), CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_WIDTH));
+                        result_data(CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_LOW_BIT_OFST) <= std_logic_vector(resize(reg_res_x_max(index), CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_WIDTH));
+
+                    when CMOS_SENSOR_INPUT_BLOB_Y_WORD =>
+                        result_data(CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_LOW_BIT_OFST) <= std_logic_vector(resize(reg_res_y_min(index), CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_WIDTH));
+                        result_data(CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_LOW_BIT_OFST) <= std_logic_vector(resize(reg_res_y_max(index), CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_WIDTH));
+
+                    when others =>
+                        null;
+                end case;
+            end if;
+        end if;
+    end process;
+
+end architecture rtl;
@@ -4,12 +4,34 @@ use ieee.math_real.all;
 
 package cmos_sensor_input_constants is
     constant CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH : positive := 32;
+    constant CMOS_SENSOR_INPUT_MM_S_ADDR_WIDTH : positive := 4;
+
+    -- number of SNAPSHOT / GET_FRAME_INFO commands that can be queued while the sampler is busy (must be a power of 2)
+    constant CMOS_SENSOR_INPUT_CMD_FIFO_DEPTH : positive := 4;
+
+    -- maximum number of processing stages in the stage chain
+    constant CMOS_SENSOR_INPUT_MAX_STAGE_COUNT : positive := 4;
+
+    -- maximum number of blobs the blob unit can track in a frame
+    constant CMOS_SENSOR_INPUT_MAX_BLOB_COUNT : natural := 8;
+
+    -- compressor: number of leading ones of an escape code, and right shift of
+    -- the running residual averages (must match the HAL decoder)
+    constant CMOS_SENSOR_INPUT_COMPRESS_ESCAPE_Q   : positive := 8;
+    constant CMOS_SENSOR_INPUT_COMPRESS_ACC_SHIFT  : positive := 4;
 
     -- register offsets
-    constant CMOS_SENSOR_INPUT_CONFIG_OFST     : std_logic_vector(1 downto 0) := "00"; -- RW
-    constant CMOS_SENSOR_INPUT_COMMAND_OFST    : std_logic_vector(1 downto 0) := "01"; -- WO
-    constant CMOS_SENSOR_INPUT_STATUS_OFST     : std_logic_vector(1 downto 0) := "10"; -- RO
-    constant CMOS_SENSOR_INPUT_FRAME_INFO_OFST : std_logic_vector(1 downto 0) := "11"; -- RO
+    constant CMOS_SENSOR_INPUT_CONFIG_OFST        : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_ADDR_WIDTH - 1 downto 0) := "0000"; -- RW
+    constant CMOS_SENSOR_INPUT_COMMAND_OFST       : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_ADDR_WIDTH - 1 downto 0) := "0001"; -- WO
+    constant CMOS_SENSOR_INPUT_STATUS_OFST        : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_ADDR_WIDTH - 1 downto 0) := "0010"; -- RO
+    constant CMOS_SENSOR_INPUT_FRAME_INFO_OFST    : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_ADDR_WIDTH - 1 downto 0) := "0011"; -- RO
+    constant CMOS_SENSOR_INPUT_DEPTH_LUT_OFST     : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_ADDR_WIDTH - 1 downto 0) := "0100"; -- WO
+    constant CMOS_SENSOR_INPUT_STAGE_ADDR_OFST    : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_ADDR_WIDTH - 1 downto 0) := "0101"; -- RW
+    constant CMOS_SENSOR_INPUT_STAGE_DATA_OFST    : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_ADDR_WIDTH - 1 downto 0) := "0110"; -- WO
+    constant CMOS_SENSOR_INPUT_BLOB_CONFIG_OFST   : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_ADDR_WIDTH - 1 downto 0) := "0111"; -- RW
+    constant CMOS_SENSOR_INPUT_BLOB_ADDR_OFST     : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_ADDR_WIDTH - 1 downto 0) := "1000"; -- RW
+    constant CMOS_SENSOR_INPUT_BLOB_DATA_OFST     : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_ADDR_WIDTH - 1 downto 0) := "1001"; -- RO
+    constant CMOS_SENSOR_INPUT_SPARSE_CONFIG_OFST : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_ADDR_WIDTH - 1 downto 0) := "1010"; -- RW
 
     -- CONFIG register
     constant CMOS_SENSOR_INPUT_CONFIG_IRQ_BIT_OFST      : natural                                                           := 0;
@@ -28,6 +50,52 @@ package cmos_sensor_input_constants is
     constant CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_GRBG          : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_WIDTH - 1 downto 0) := "10";
     constant CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_GBRG          : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_WIDTH - 1 downto 0) := "11";
 
+    constant CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_BIT_OFST      : natural                                                                      := CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_HIGH_BIT_OFST + 1;
+    constant CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_WIDTH         : positive                                                                     := 1;
+    constant CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_LOW_BIT_OFST  : natural                                                                      := CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_HIGH_BIT_OFST : natural                                                                      := CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_LOW_BIT_OFST + CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_WIDTH - 1;
+    constant CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_DECIMATE      : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_WIDTH - 1 downto 0) := "0";
+    constant CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_BIN           : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_WIDTH - 1 downto 0) := "1";
+
+    constant CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_BIT_OFST      : natural                                                                        := CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_MODE_HIGH_BIT_OFST + 1;
+    constant CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_WIDTH         : positive                                                                       := 2;
+    constant CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_LOW_BIT_OFST  : natural                                                                        := CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_HIGH_BIT_OFST : natural                                                                        := CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_LOW_BIT_OFST + CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_WIDTH - 1;
+    constant CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_1X1           : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_WIDTH - 1 downto 0) := "00";
+    constant CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_2X2           : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_WIDTH - 1 downto 0) := "01";
+    constant CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_4X4           : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_WIDTH - 1 downto 0) := "10";
+
+    constant CMOS_SENSOR_INPUT_CONFIG_PLANAR_BIT_OFST      : natural                                                              := CMOS_SENSOR_INPUT_CONFIG_DOWNSCALE_FACTOR_HIGH_BIT_OFST + 1;
+    constant CMOS_SENSOR_INPUT_CONFIG_PLANAR_WIDTH         : positive                                                             := 1;
+    constant CMOS_SENSOR_INPUT_CONFIG_PLANAR_LOW_BIT_OFST  : natural                                                              := CMOS_SENSOR_INPUT_CONFIG_PLANAR_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_CONFIG_PLANAR_HIGH_BIT_OFST : natural                                                              := CMOS_SENSOR_INPUT_CONFIG_PLANAR_LOW_BIT_OFST + CMOS_SENSOR_INPUT_CONFIG_PLANAR_WIDTH - 1;
+    constant CMOS_SENSOR_INPUT_CONFIG_PLANAR_DISABLE       : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_PLANAR_WIDTH - 1 downto 0) := "0";
+    constant CMOS_SENSOR_INPUT_CONFIG_PLANAR_ENABLE        : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_PLANAR_WIDTH - 1 downto 0) := "1";
+
+    constant CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_BIT_OFST      : natural                                                                  := CMOS_SENSOR_INPUT_CONFIG_PLANAR_HIGH_BIT_OFST + 1;
+    constant CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_WIDTH         : positive                                                                 := 2;
+    constant CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_LOW_BIT_OFST  : natural                                                                  := CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_HIGH_BIT_OFST : natural                                                                  := CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_LOW_BIT_OFST + CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_WIDTH - 1;
+    constant CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_FULL          : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_WIDTH - 1 downto 0) := "00";
+    constant CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_SHIFT         : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_WIDTH - 1 downto 0) := "01";
+    constant CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_LUT           : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_WIDTH - 1 downto 0) := "10";
+
+    constant CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_BIT_OFST      : natural                                                                     := CMOS_SENSOR_INPUT_CONFIG_DEPTH_MODE_HIGH_BIT_OFST + 1;
+    constant CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_WIDTH         : positive                                                                    := 2;
+    constant CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_LOW_BIT_OFST  : natural                                                                     := CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_HIGH_BIT_OFST : natural                                                                     := CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_LOW_BIT_OFST + CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_WIDTH - 1;
+    constant CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB           : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_WIDTH - 1 downto 0) := "00";
+    constant CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB565        : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_WIDTH - 1 downto 0) := "01";
+    constant CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_RGB888        : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_WIDTH - 1 downto 0) := "10";
+    constant CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_YCBCR422      : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_WIDTH - 1 downto 0) := "11";
+
+    constant CMOS_SENSOR_INPUT_CONFIG_COMPRESS_BIT_OFST      : natural                                                                := CMOS_SENSOR_INPUT_CONFIG_OUTPUT_FORMAT_HIGH_BIT_OFST + 1;
+    constant CMOS_SENSOR_INPUT_CONFIG_COMPRESS_WIDTH         : positive                                                               := 1;
+    constant CMOS_SENSOR_INPUT_CONFIG_COMPRESS_LOW_BIT_OFST  : natural                                                                := CMOS_SENSOR_INPUT_CONFIG_COMPRESS_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_CONFIG_COMPRESS_HIGH_BIT_OFST : natural                                                                := CMOS_SENSOR_INPUT_CONFIG_COMPRESS_LOW_BIT_OFST + CMOS_SENSOR_INPUT_CONFIG_COMPRESS_WIDTH - 1;
+    constant CMOS_SENSOR_INPUT_CONFIG_COMPRESS_DISABLE       : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_COMPRESS_WIDTH - 1 downto 0) := "0";
+    constant CMOS_SENSOR_INPUT_CONFIG_COMPRESS_ENABLE        : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_COMPRESS_WIDTH - 1 downto 0) := "1";
+
     -- COMMAND register
     constant CMOS_SENSOR_INPUT_COMMAND_BIT_OFST       : natural                                                        := 0;
     constant CMOS_SENSOR_INPUT_COMMAND_WIDTH          : positive                                                       := CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH;
@@ -59,6 +127,12 @@ package cmos_sensor_input_constants is
     constant CMOS_SENSOR_INPUT_STATUS_FIFO_USEDW_LOW_BIT_OFST  : natural  := CMOS_SENSOR_INPUT_STATUS_FIFO_USEDW_BIT_OFST;
     constant CMOS_SENSOR_INPUT_STATUS_FIFO_USEDW_HIGH_BIT_0FST : natural  := CMOS_SENSOR_INPUT_STATUS_FIFO_USEDW_LOW_BIT_OFST + CMOS_SENSOR_INPUT_STATUS_FIFO_USEDW_WIDTH - 1;
 
+    constant CMOS_SENSOR_INPUT_STATUS_CMD_FIFO_USEDW_BIT_OFST      : natural  := CMOS_SENSOR_INPUT_STATUS_FIFO_USEDW_HIGH_BIT_0FST + 1;
+    -- command fifo holds CMOS_SENSOR_INPUT_CMD_FIFO_DEPTH elements, so need bit_width(CMOS_SENSOR_INPUT_CMD_FIFO_DEPTH) bits
+    constant CMOS_SENSOR_INPUT_STATUS_CMD_FIFO_USEDW_WIDTH         : positive := 3;
+    constant CMOS_SENSOR_INPUT_STATUS_CMD_FIFO_USEDW_LOW_BIT_OFST  : natural  := CMOS_SENSOR_INPUT_STATUS_CMD_FIFO_USEDW_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_STATUS_CMD_FIFO_USEDW_HIGH_BIT_OFST : natural  := CMOS_SENSOR_INPUT_STATUS_CMD_FIFO_USEDW_LOW_BIT_OFST + CMOS_SENSOR_INPUT_STATUS_CMD_FIFO_USEDW_WIDTH - 1;
+
     -- FRAME_INFO register
     constant CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_WIDTH_BIT_OFST      : natural  := 0;
     -- takes up half the space of the bus width --> max frame width is 65535
@@ -72,6 +146,157 @@ package cmos_sensor_input_constants is
     constant CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_HEIGHT_LOW_BIT_OFST  : natural  := CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_HEIGHT_BIT_OFST;
     constant CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_HEIGHT_HIGH_BIT_OFST : natural  := CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_HEIGHT_LOW_BIT_OFST + CMOS_SENSOR_INPUT_FRAME_INFO_FRAME_HEIGHT_WIDTH - 1;
 
+    -- DEPTH_LUT register
+    constant CMOS_SENSOR_INPUT_DEPTH_LUT_VALUE_BIT_OFST      : natural  := 0;
+    -- takes up half the space of the bus width --> max reduced pixel depth is 16
+    constant CMOS_SENSOR_INPUT_DEPTH_LUT_VALUE_WIDTH         : positive := CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH / 2;
+    constant CMOS_SENSOR_INPUT_DEPTH_LUT_VALUE_LOW_BIT_OFST  : natural  := CMOS_SENSOR_INPUT_DEPTH_LUT_VALUE_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_DEPTH_LUT_VALUE_HIGH_BIT_OFST : natural  := CMOS_SENSOR_INPUT_DEPTH_LUT_VALUE_LOW_BIT_OFST + CMOS_SENSOR_INPUT_DEPTH_LUT_VALUE_WIDTH - 1;
+
+    constant CMOS_SENSOR_INPUT_DEPTH_LUT_INDEX_BIT_OFST      : natural  := CMOS_SENSOR_INPUT_DEPTH_LUT_VALUE_HIGH_BIT_OFST + 1;
+    -- takes up half the space of the bus width --> the lut can hold up to 65536 entries (PIX_DEPTH <= 16)
+    constant CMOS_SENSOR_INPUT_DEPTH_LUT_INDEX_WIDTH         : positive := CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH / 2;
+    constant CMOS_SENSOR_INPUT_DEPTH_LUT_INDEX_LOW_BIT_OFST  : natural  := CMOS_SENSOR_INPUT_DEPTH_LUT_INDEX_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_DEPTH_LUT_INDEX_HIGH_BIT_OFST : natural  := CMOS_SENSOR_INPUT_DEPTH_LUT_INDEX_LOW_BIT_OFST + CMOS_SENSOR_INPUT_DEPTH_LUT_INDEX_WIDTH - 1;
+
+    -- STAGE_ADDR register
+    constant CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_BIT_OFST      : natural  := 0;
+    constant CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_WIDTH         : positive := 8;
+    constant CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_LOW_BIT_OFST  : natural  := CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_HIGH_BIT_OFST : natural  := CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_LOW_BIT_OFST + CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_WIDTH - 1;
+
+    constant CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_BIT_OFST      : natural  := CMOS_SENSOR_INPUT_STAGE_ADDR_WORD_HIGH_BIT_OFST + 1;
+    constant CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_WIDTH         : positive := 8;
+    constant CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_LOW_BIT_OFST  : natural  := CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_HIGH_BIT_OFST : natural  := CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_LOW_BIT_OFST + CMOS_SENSOR_INPUT_STAGE_ADDR_STAGE_WIDTH - 1;
+
+    -- stage parameter words (written through STAGE_DATA). Word 0 is common to
+    -- all stage types, the meaning of the other words depends on the type.
+    constant CMOS_SENSOR_INPUT_STAGE_CONTROL_WORD : natural := 0;
+
+    constant CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_BIT_OFST      : natural                                                                     := 0;
+    constant CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_WIDTH         : positive                                                                    := 1;
+    constant CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_LOW_BIT_OFST  : natural                                                                     := CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_HIGH_BIT_OFST : natural                                                                     := CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_LOW_BIT_OFST + CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_WIDTH - 1;
+    constant CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_BYPASS        : std_logic_vector(CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_WIDTH - 1 downto 0) := "0";
+    constant CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_PROCESS       : std_logic_vector(CMOS_SENSOR_INPUT_STAGE_CONTROL_ENABLE_WIDTH - 1 downto 0) := "1";
+
+    -- GAIN stage
+    constant CMOS_SENSOR_INPUT_STAGE_GAIN_WORD : natural := 1;
+
+    constant CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_BIT_OFST      : natural  := 0;
+    -- unsigned 8.8 fixed point --> 0x0100 is a gain of 1
+    constant CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_WIDTH         : positive := CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH / 2;
+    constant CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_LOW_BIT_OFST  : natural  := CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_HIGH_BIT_OFST : natural  := CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_LOW_BIT_OFST + CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_WIDTH - 1;
+
+    constant CMOS_SENSOR_INPUT_STAGE_GAIN_OFFSET_BIT_OFST      : natural  := CMOS_SENSOR_INPUT_STAGE_GAIN_GAIN_HIGH_BIT_OFST + 1;
+    constant CMOS_SENSOR_INPUT_STAGE_GAIN_OFFSET_WIDTH         : positive := CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH / 2;
+    constant CMOS_SENSOR_INPUT_STAGE_GAIN_OFFSET_LOW_BIT_OFST  : natural  := CMOS_SENSOR_INPUT_STAGE_GAIN_OFFSET_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_STAGE_GAIN_OFFSET_HIGH_BIT_OFST : natural  := CMOS_SENSOR_INPUT_STAGE_GAIN_OFFSET_LOW_BIT_OFST + CMOS_SENSOR_INPUT_STAGE_GAIN_OFFSET_WIDTH - 1;
+
+    -- CONV3X3 stage
+    -- words COEF_WORD to COEF_WORD + 8 hold the 9 coefficients of the kernel
+    -- in row-major order (top-left coefficient first)
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_WORD : natural := 1;
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_POST_WORD : natural := 10;
+
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_BIT_OFST      : natural  := 0;
+    -- signed
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_WIDTH         : positive := 16;
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_LOW_BIT_OFST  : natural  := CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_HIGH_BIT_OFST : natural  := CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_LOW_BIT_OFST + CMOS_SENSOR_INPUT_STAGE_CONV3X3_COEF_WIDTH - 1;
+
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_SHIFT_BIT_OFST      : natural  := 0;
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_SHIFT_WIDTH         : positive := 5;
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_SHIFT_LOW_BIT_OFST  : natural  := CMOS_SENSOR_INPUT_STAGE_CONV3X3_SHIFT_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_SHIFT_HIGH_BIT_OFST : natural  := CMOS_SENSOR_INPUT_STAGE_CONV3X3_SHIFT_LOW_BIT_OFST + CMOS_SENSOR_INPUT_STAGE_CONV3X3_SHIFT_WIDTH - 1;
+
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_BIT_OFST      : natural                                                                  := 8;
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_WIDTH         : positive                                                                 := 1;
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_LOW_BIT_OFST  : natural                                                                  := CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_HIGH_BIT_OFST : natural                                                                  := CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_LOW_BIT_OFST + CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_WIDTH - 1;
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_DISABLE       : std_logic_vector(CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_WIDTH - 1 downto 0) := "0";
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_ENABLE        : std_logic_vector(CMOS_SENSOR_INPUT_STAGE_CONV3X3_ABS_WIDTH - 1 downto 0) := "1";
+
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_BIAS_BIT_OFST      : natural  := 16;
+    -- signed
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_BIAS_WIDTH         : positive := 16;
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_BIAS_LOW_BIT_OFST  : natural  := CMOS_SENSOR_INPUT_STAGE_CONV3X3_BIAS_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_STAGE_CONV3X3_BIAS_HIGH_BIT_OFST : natural  := CMOS_SENSOR_INPUT_STAGE_CONV3X3_BIAS_LOW_BIT_OFST + CMOS_SENSOR_INPUT_STAGE_CONV3X3_BIAS_WIDTH - 1;
+
+    -- BLOB_CONFIG register
+    constant CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_BIT_OFST      : natural  := 0;
+    -- pixels >= THRESHOLD belong to a blob
+    constant CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_WIDTH         : positive := CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH / 2;
+    constant CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_LOW_BIT_OFST  : natural  := CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_HIGH_BIT_OFST : natural  := CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_LOW_BIT_OFST + CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_WIDTH - 1;
+
+    constant CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_BIT_OFST      : natural                                                                       := CMOS_SENSOR_INPUT_BLOB_CONFIG_THRESHOLD_HIGH_BIT_OFST + 1;
+    constant CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_WIDTH         : positive                                                                      := 1;
+    constant CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_LOW_BIT_OFST  : natural                                                                       := CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_HIGH_BIT_OFST : natural                                                                       := CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_LOW_BIT_OFST + CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_WIDTH - 1;
+    constant CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_DISABLE       : std_logic_vector(CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_WIDTH - 1 downto 0) := "0";
+    constant CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_ENABLE        : std_logic_vector(CMOS_SENSOR_INPUT_BLOB_CONFIG_STATS_ONLY_WIDTH - 1 downto 0) := "1";
+
+    -- BLOB_ADDR register
+    constant CMOS_SENSOR_INPUT_BLOB_ADDR_WORD_BIT_OFST      : natural  := 0;
+    constant CMOS_SENSOR_INPUT_BLOB_ADDR_WORD_WIDTH         : positive := 8;
+    constant CMOS_SENSOR_INPUT_BLOB_ADDR_WORD_LOW_BIT_OFST  : natural  := CMOS_SENSOR_INPUT_BLOB_ADDR_WORD_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_BLOB_ADDR_WORD_HIGH_BIT_OFST : natural  := CMOS_SENSOR_INPUT_BLOB_ADDR_WORD_LOW_BIT_OFST + CMOS_SENSOR_INPUT_BLOB_ADDR_WORD_WIDTH - 1;
+
+    -- blob result words (read through BLOB_DATA). Word 0 is the status of the
+    -- last frame, blob n occupies words RECORD_WORD + n * RECORD_SIZE to
+    -- RECORD_WORD + n * RECORD_SIZE + RECORD_SIZE - 1.
+    constant CMOS_SENSOR_INPUT_BLOB_STATUS_WORD : natural := 0;
+
+    constant CMOS_SENSOR_INPUT_BLOB_STATUS_COUNT_BIT_OFST      : natural  := 0;
+    constant CMOS_SENSOR_INPUT_BLOB_STATUS_COUNT_WIDTH         : positive := 8;
+    constant CMOS_SENSOR_INPUT_BLOB_STATUS_COUNT_LOW_BIT_OFST  : natural  := CMOS_SENSOR_INPUT_BLOB_STATUS_COUNT_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_BLOB_STATUS_COUNT_HIGH_BIT_OFST : natural  := CMOS_SENSOR_INPUT_BLOB_STATUS_COUNT_LOW_BIT_OFST + CMOS_SENSOR_INPUT_BLOB_STATUS_COUNT_WIDTH - 1;
+
+    constant CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_BIT_OFST      : natural                                                                     := CMOS_SENSOR_INPUT_BLOB_STATUS_COUNT_HIGH_BIT_OFST + 1;
+    constant CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_WIDTH         : positive                                                                    := 1;
+    constant CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_LOW_BIT_OFST  : natural                                                                     := CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_HIGH_BIT_OFST : natural                                                                     := CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_LOW_BIT_OFST + CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_WIDTH - 1;
+    constant CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_NO_OVERFLOW   : std_logic_vector(CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_WIDTH - 1 downto 0) := "0";
+    constant CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_OVERFLOW      : std_logic_vector(CMOS_SENSOR_INPUT_BLOB_STATUS_OVERFLOW_WIDTH - 1 downto 0) := "1";
+
+    constant CMOS_SENSOR_INPUT_BLOB_RECORD_WORD : natural := 8;
+    constant CMOS_SENSOR_INPUT_BLOB_RECORD_SIZE : natural := 8;
+
+    -- words of a blob record, relative to the start of the record
+    constant CMOS_SENSOR_INPUT_BLOB_PIXELS_WORD    : natural := 0;
+    constant CMOS_SENSOR_INPUT_BLOB_SUM_X_WORD     : natural := 1;
+    constant CMOS_SENSOR_INPUT_BLOB_SUM_Y_WORD     : natural := 2;
+    constant CMOS_SENSOR_INPUT_BLOB_SUM_VALUE_WORD : natural := 3;
+    -- X and Y words hold the bounding box extent (MIN and MAX fields)
+    constant CMOS_SENSOR_INPUT_BLOB_X_WORD         : natural := 4;
+    constant CMOS_SENSOR_INPUT_BLOB_Y_WORD         : natural := 5;
+
+    constant CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_BIT_OFST      : natural  := 0;
+    constant CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_WIDTH         : positive := CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH / 2;
+    constant CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_LOW_BIT_OFST  : natural  := CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_HIGH_BIT_OFST : natural  := CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_LOW_BIT_OFST + CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_WIDTH - 1;
+
+    constant CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_BIT_OFST      : natural  := CMOS_SENSOR_INPUT_BLOB_EXTENT_MIN_HIGH_BIT_OFST + 1;
+    constant CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_WIDTH         : positive := CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH / 2;
+    constant CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_LOW_BIT_OFST  : natural  := CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_HIGH_BIT_OFST : natural  := CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_LOW_BIT_OFST + CMOS_SENSOR_INPUT_BLOB_EXTENT_MAX_WIDTH - 1;
+
+    -- SPARSE_CONFIG register
+    constant CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_BIT_OFST      : natural  := 0;
+    constant CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_WIDTH         : positive := CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH / 2;
+    constant CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_LOW_BIT_OFST  : natural  := CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_HIGH_BIT_OFST : natural  := CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_LOW_BIT_OFST + CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_WIDTH - 1;
+
+    constant CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_BIT_OFST      : natural                                                                    := CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_HIGH_BIT_OFST + 1;
+    constant CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_WIDTH         : positive                                                                   := 1;
+    constant CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_LOW_BIT_OFST  : natural                                                                    := CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_BIT_OFST;
+    constant CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_HIGH_BIT_OFST : natural                                                                    := CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_LOW_BIT_OFST + CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_WIDTH - 1;
+    constant CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_DISABLE       : std_logic_vector(CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_WIDTH - 1 downto 0) := "0";
+    constant CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_ENABLE        : std_logic_vector(CMOS_SENSOR_INPUT_SPARSE_CONFIG_ENABLE_WIDTH - 1 downto 0) := "1";
+
     function ceil_log2(num : positive) return natural;
     function floor_div(numerator : positive; denominator : positive) return natural;
     function bit_width(num : positive) return positive;
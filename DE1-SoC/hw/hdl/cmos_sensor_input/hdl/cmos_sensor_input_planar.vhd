@@ -0,0 +1,223 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.cmos_sensor_input_constants.all;
+
+-- Bayer plane splitter.
+--
+-- Reorders the pixels of each row of the raw Bayer frame so that all pixels of
+-- even columns are output first, followed by all pixels of odd columns. Each
+-- half row then only holds samples of a single Bayer channel, so a DMA can
+-- write the 4 channels to 4 separate planes with 2 descriptors per row.
+--
+-- Rows are written to one bank of a 2-row buffer while the previous row is read
+-- back from the other bank in split order, one pixel for every input pixel, so
+-- the output rate never exceeds the input rate. The output is therefore
+-- delayed by one row, and the last row is flushed after end_of_frame_in at one
+-- pixel per cycle.
+--
+-- The stage is bypassed (no delay, row buffer unused) if planar is set to
+-- DISABLE.
+entity cmos_sensor_input_planar is
+    generic(
+        PIX_DEPTH  : positive;
+        MAX_WIDTH  : positive;
+        MAX_HEIGHT : positive
+    );
+    port(
+        clk                : in  std_logic;
+        reset              : in  std_logic;
+
+        -- avalon_mm_slave
+        stop_and_reset     : in  std_logic;
+        planar             : in  std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_PLANAR_WIDTH - 1 downto 0);
+
+        -- sampler / downscaler
+        frame_width        : in  std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+        valid_in           : in  std_logic;
+        data_in            : in  std_logic_vector(PIX_DEPTH - 1 downto 0);
+        start_of_frame_in  : in  std_logic;
+        end_of_frame_in    : in  std_logic;
+
+        -- packer / fifo
+        valid_out          : out std_logic;
+        data_out           : out std_logic_vector(PIX_DEPTH - 1 downto 0);
+        start_of_frame_out : out std_logic;
+        end_of_frame_out   : out std_logic
+    );
+end entity cmos_sensor_input_planar;
+
+architecture rtl of cmos_sensor_input_planar is
+    -- one row per bank
+    constant ROW_BUFFER_ADDR_WIDTH : positive := ceil_log2(MAX_WIDTH);
+
+    type row_buffer_type is array (0 to 2 ** (ROW_BUFFER_ADDR_WIDTH + 1) - 1) of std_logic_vector(PIX_DEPTH - 1 downto 0);
+
+    -- number of even columns
+    signal half_width : unsigned(frame_width'range);
+
+    -- input pixel position
+    signal reg_x         : unsigned(frame_width'range);
+    signal reg_bank      : std_logic;
+    signal reg_first_row : boolean;
+
+    signal cur_x         : unsigned(frame_width'range);
+    signal cur_bank      : std_logic;
+    signal cur_first_row : boolean;
+
+    -- flush of the last row
+    signal reg_flush   : std_logic;
+    signal reg_flush_x : unsigned(frame_width'range);
+
+    -- first pixel read back from the row buffer gets start_of_frame
+    signal reg_sof_pending : std_logic;
+
+    -- row buffer
+    signal row_buffer    : row_buffer_type;
+    signal row_buffer_we : std_logic;
+    signal rd_addr       : unsigned(ROW_BUFFER_ADDR_WIDTH downto 0);
+    signal row_buffer_q  : std_logic_vector(data_in'range);
+
+    -- flags of the pixel being read from the row buffer
+    signal reg_rd_valid : std_logic;
+    signal reg_rd_sof   : std_logic;
+    signal reg_rd_eof   : std_logic;
+
+begin
+    half_width <= shift_right(unsigned(frame_width) + 1, 1);
+
+    INPUT_POSITION : process(reg_bank, reg_first_row, reg_x, start_of_frame_in)
+    begin
+        cur_x         <= reg_x;
+        cur_bank      <= reg_bank;
+        cur_first_row <= reg_first_row;
+        if start_of_frame_in = '1' then
+            cur_x         <= (others => '0');
+            cur_bank      <= '0';
+            cur_first_row <= true;
+        end if;
+    end process;
+
+    -- output column i of a row holds input column 2 * i for the first half of
+    -- the row, and input column 2 * (i - half_width) + 1 for the second half
+    READ_ADDRESS : process(cur_bank, cur_x, half_width, reg_bank, reg_flush, reg_flush_x)
+        variable out_x : unsigned(frame_width'range);
+        variable rd_x  : unsigned(frame_width'range);
+    begin
+        if reg_flush = '1' then
+            out_x := reg_flush_x;
+        else
+            out_x := cur_x;
+        end if;
+
+        if out_x < half_width then
+            rd_x := shift_left(out_x, 1);
+        else
+            rd_x := shift_left(out_x - half_width, 1) + 1;
+        end if;
+
+        if reg_flush = '1' then
+            rd_addr <= reg_bank & resize(rd_x, ROW_BUFFER_ADDR_WIDTH);
+        else
+            rd_addr <= (not cur_bank) & resize(rd_x, ROW_BUFFER_ADDR_WIDTH);
+        end if;
+    end process;
+
+    row_buffer_we <= '1' when valid_in = '1' and reg_flush = '0' else '0';
+
+    ROW_BUFFER : process(clk)
+    begin
+        if rising_edge(clk) then
+            if row_buffer_we = '1' then
+                row_buffer(to_integer(cur_bank & resize(cur_x, ROW_BUFFER_ADDR_WIDTH))) <= data_in;
+            end if;
+
+            row_buffer_q <= row_buffer(to_integer(rd_addr));
+        end if;
+    end process;
+
+    CONTROL : process(clk, reset)
+    begin
+        if reset = '1' then
+            reg_x           <= (others => '0');
+            reg_bank        <= '0';
+            reg_first_row   <= true;
+            reg_flush       <= '0';
+            reg_flush_x     <= (others => '0');
+            reg_sof_pending <= '0';
+            reg_rd_valid    <= '0';
+            reg_rd_sof      <= '0';
+            reg_rd_eof      <= '0';
+
+        elsif rising_edge(clk) then
+            reg_rd_valid <= '0';
+            reg_rd_sof   <= '0';
+            reg_rd_eof   <= '0';
+
+            if stop_and_reset = '1' or planar /= CMOS_SENSOR_INPUT_CONFIG_PLANAR_ENABLE then
+                reg_x           <= (others => '0');
+                reg_bank        <= '0';
+                reg_first_row   <= true;
+                reg_flush       <= '0';
+                reg_flush_x     <= (others => '0');
+                reg_sof_pending <= '0';
+            elsif reg_flush = '1' then
+                -- last row, no input pixels arrive until the frame has been output
+                reg_rd_valid    <= '1';
+                reg_rd_sof      <= reg_sof_pending;
+                reg_sof_pending <= '0';
+
+                if reg_flush_x = unsigned(frame_width) - 1 then
+                    reg_rd_eof <= '1';
+                    reg_flush  <= '0';
+                else
+                    reg_flush_x <= reg_flush_x + 1;
+                end if;
+            elsif valid_in = '1' then
+                if start_of_frame_in = '1' then
+                    reg_sof_pending <= '1';
+                end if;
+
+                -- read back one pixel of the previous row for every input pixel
+                if not cur_first_row then
+                    reg_rd_valid    <= '1';
+                    reg_rd_sof      <= reg_sof_pending;
+                    reg_sof_pending <= '0';
+                end if;
+
+                if end_of_frame_in = '1' then
+                    reg_flush     <= '1';
+                    reg_flush_x   <= (others => '0');
+                    reg_bank      <= cur_bank;
+                    reg_x         <= (others => '0');
+                    reg_first_row <= true;
+                elsif cur_x = unsigned(frame_width) - 1 then
+                    reg_x         <= (others => '0');
+                    reg_bank      <= not cur_bank;
+                    reg_first_row <= false;
+                else
+                    reg_x         <= cur_x + 1;
+                    reg_bank      <= cur_bank;
+                    reg_first_row <= cur_first_row;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    OUTPUT : process(data_in, end_of_frame_in, planar, reg_rd_eof, reg_rd_sof, reg_rd_valid, row_buffer_q, start_of_frame_in, valid_in)
+    begin
+        if planar = CMOS_SENSOR_INPUT_CONFIG_PLANAR_ENABLE then
+            valid_out          <= reg_rd_valid;
+            data_out           <= row_buffer_q;
+            start_of_frame_out <= reg_rd_sof;
+            end_of_frame_out   <= reg_rd_eof;
+        else
+            valid_out          <= valid_in;
+            data_out           <= data_in;
+            start_of_frame_out <= start_of_frame_in;
+            end_of_frame_out   <= end_of_frame_in;
+        end if;
+    end process;
+
+end architecture rtl;
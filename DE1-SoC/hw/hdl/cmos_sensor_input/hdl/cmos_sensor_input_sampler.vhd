@@ -17,6 +17,7 @@ entity cmos_sensor_input_sampler is
         -- avalon_mm_slave
         stop_and_reset      : in  std_logic;
         idle                : out std_logic;
+        config_latch        : out std_logic;
         wait_irq_ack        : out std_logic;
         irq_en              : in  std_logic;
         irq_ack             : in  std_logic;
@@ -94,6 +95,7 @@ begin
     process(data_in, end_of_frame_in, fifo_overflow, frame_valid, get_frame_info, irq_ack, irq_en, line_valid, reg_data_in, reg_frame_height_config, reg_frame_height_counter, reg_frame_width_config, reg_frame_width_counter, reg_state, snapshot)
     begin
         idle                <= '0';
+        config_latch        <= '0';
         wait_irq_ack        <= '0';
         frame_width         <= std_logic_vector(reg_frame_width_config);
         frame_height        <= std_logic_vector(reg_frame_height_config);
@@ -112,7 +114,8 @@ begin
 
         case reg_state is
             when STATE_IDLE =>
-                idle <= '1';
+                idle         <= '1';
+                config_latch <= '1';
 
                 if get_frame_info = '1' then
                     if frame_valid = '0' then
@@ -135,6 +138,8 @@ begin
 
             when STATE_WAIT_START_FRAME_GFI =>
                 if frame_valid = '1' and line_valid = '1' then
+                    config_latch <= '1';
+
                     next_reg_state               <= STATE_DATA_SKIP;
                     next_reg_frame_width_config  <= to_unsigned(1, next_reg_frame_width_config'length);
                     next_reg_frame_height_config <= to_unsigned(1, next_reg_frame_height_config'length);
@@ -177,6 +182,8 @@ begin
 
             when STATE_WAIT_START_FRAME_SNPSHT =>
                 if frame_valid = '1' and line_valid = '1' then
+                    config_latch <= '1';
+
                     next_reg_state                <= STATE_START_OF_FRAME_OUT;
                     next_reg_frame_width_counter  <= to_unsigned(1, next_reg_frame_width_counter'length);
                     next_reg_frame_height_counter <= to_unsigned(1, next_reg_frame_height_counter'length);
@@ -0,0 +1,134 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.cmos_sensor_input_constants.all;
+
+-- Sparse output unit.
+--
+-- Replaces the pixel stream by one record per pixel whose value is >= the
+-- THRESHOLD field of the SPARSE_CONFIG register. Each record fills one output
+-- word, with COORD_WIDTH = bit_width(max(MAX_WIDTH, MAX_HEIGHT)):
+--
+--   VALUE  PIX_DEPTH bits, starting at bit 0
+--   X      COORD_WIDTH bits, starting at bit PIX_DEPTH (column)
+--   Y      COORD_WIDTH bits, starting at bit PIX_DEPTH + COORD_WIDTH (row)
+--
+-- and all other bits are 0. The frame is terminated by a marker record whose x
+-- and y fields are all ones (a coordinate no frame can reach) and whose value
+-- is 0, which carries end_of_frame. A frame therefore always produces at least
+-- one word, and at most (width * height + 1).
+--
+-- The marker is output on the cycle following end_of_frame_in, so the input
+-- must not be valid on that cycle (the sampler always has some blanking
+-- between frames).
+entity cmos_sensor_input_sparse is
+    generic(
+        PIX_DEPTH    : positive;
+        MAX_WIDTH    : positive;
+        MAX_HEIGHT   : positive;
+        RECORD_WIDTH : positive -- must be >= PIX_DEPTH + 2 * bit_width(max(MAX_WIDTH, MAX_HEIGHT))
+    );
+    port(
+        clk               : in  std_logic;
+        reset             : in  std_logic;
+
+        -- avalon_mm_slave
+        stop_and_reset    : in  std_logic;
+        threshold         : in  std_logic_vector(CMOS_SENSOR_INPUT_SPARSE_CONFIG_THRESHOLD_WIDTH - 1 downto 0);
+
+        -- sampler / downscaler
+        frame_width       : in  std_logic_vector(bit_width(max(MAX_WIDTH, MAX_HEIGHT)) - 1 downto 0);
+
+        -- planar / depth_reducer
+        valid_in          : in  std_logic;
+        data_in           : in  std_logic_vector(PIX_DEPTH - 1 downto 0);
+        start_of_frame_in : in  std_logic;
+        end_of_frame_in   : in  std_logic;
+
+        -- fifo
+        valid_out         : out std_logic;
+        data_out          : out std_logic_vector(RECORD_WIDTH - 1 downto 0);
+        end_of_frame_out  : out std_logic
+    );
+end entity cmos_sensor_input_sparse;
+
+architecture rtl of cmos_sensor_input_sparse is
+    constant COORD_WIDTH : positive := bit_width(max(MAX_WIDTH, MAX_HEIGHT));
+
+    constant VALUE_LOW_BIT_OFST  : natural := 0;
+    constant VALUE_HIGH_BIT_OFST : natural := VALUE_LOW_BIT_OFST + PIX_DEPTH - 1;
+    constant X_LOW_BIT_OFST      : natural := VALUE_HIGH_BIT_OFST + 1;
+    constant X_HIGH_BIT_OFST     : natural := X_LOW_BIT_OFST + COORD_WIDTH - 1;
+    constant Y_LOW_BIT_OFST      : natural := X_HIGH_BIT_OFST + 1;
+    constant Y_HIGH_BIT_OFST     : natural := Y_LOW_BIT_OFST + COORD_WIDTH - 1;
+
+    signal reg_next_x : unsigned(COORD_WIDTH - 1 downto 0);
+    signal reg_next_y : unsigned(COORD_WIDTH - 1 downto 0);
+    signal reg_marker : std_logic;
+
+begin
+    assert Y_HIGH_BIT_OFST < RECORD_WIDTH
+        report "cmos_sensor_input_sparse: a record does not fit in RECORD_WIDTH bits"
+        severity failure;
+
+    process(clk, reset)
+        variable x : unsigned(COORD_WIDTH - 1 downto 0);
+        variable y : unsigned(COORD_WIDTH - 1 downto 0);
+    begin
+        if reset = '1' then
+            reg_next_x       <= (others => '0');
+            reg_next_y       <= (others => '0');
+            reg_marker       <= '0';
+            valid_out        <= '0';
+            data_out         <= (others => '0');
+            end_of_frame_out <= '0';
+
+        elsif rising_edge(clk) then
+            valid_out        <= '0';
+            data_out         <= (others => '0');
+            end_of_frame_out <= '0';
+            reg_marker       <= '0';
+
+            if stop_and_reset = '1' then
+                reg_next_x <= (others => '0');
+                reg_next_y <= (others => '0');
+            else
+                if reg_marker = '1' then
+                    valid_out                                       <= '1';
+                    data_out(X_HIGH_BIT_OFST downto X_LOW_BIT_OFST) <= (others => '1');
+                    data_out(Y_HIGH_BIT_OFST downto Y_LOW_BIT_OFST) <= (others => '1');
+                    end_of_frame_out                                <= '1';
+                end if;
+
+                if valid_in = '1' then
+                    if start_of_frame_in = '1' then
+                        x := (others => '0');
+                        y := (others => '0');
+                    else
+                        x := reg_next_x;
+                        y := reg_next_y;
+                    end if;
+
+                    if unsigned(data_in) >= unsigned(threshold) then
+                        valid_out                                               <= '1';
+                        data_out(VALUE_HIGH_BIT_OFST downto VALUE_LOW_BIT_OFST) <= data_in;
+                        data_out(X_HIGH_BIT_OFST downto X_LOW_BIT_OFST)         <= std_logic_vector(x);
+                        data_out(Y_HIGH_BIT_OFST downto Y_LOW_BIT_OFST)         <= std_logic_vector(y);
+                    end if;
+
+                    if end_of_frame_in = '1' then
+                        reg_marker <= '1';
+                    elsif x = unsigned(frame_width) - 1 then
+                        reg_next_x <= (others => '0');
+                        reg_next_y <= y + 1;
+                    else
+                        reg_next_x <= x + 1;
+                        reg_next_y <= y;
+                    end if;
+                end if;
+            end if;
+        end if;
+    end process;
+
+end architecture rtl;
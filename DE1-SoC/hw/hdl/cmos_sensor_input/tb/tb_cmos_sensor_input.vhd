@@ -1,6 +1,7 @@
 library ieee;
 use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
+use std.textio.all;
 
 library osvvm;
 use osvvm.RandomPkg.all;
@@ -23,16 +24,30 @@ architecture test of tb_cmos_sensor_input is
     signal sim_finished : boolean := false;
 
     -- simulation parameters ---------------------------------------------------
-    constant PIX_DEPTH       : positive                                                                      := 8;
-    constant SAMPLE_EDGE     : string                                                                        := "RISING";
-    constant MAX_WIDTH       : positive                                                                      := 1920;
-    constant MAX_HEIGHT      : positive                                                                      := 1080;
-    constant OUTPUT_WIDTH    : positive                                                                      := 32;
-    constant FIFO_DEPTH      : positive                                                                      := 32;
-    constant DEVICE_FAMILY   : string                                                                        := "Cyclone V";
-    constant DEBAYER_ENABLE  : boolean                                                                       := false;
-    constant PACKER_ENABLE   : boolean                                                                       := false;
-    constant DEBAYER_PATTERN : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_WIDTH - 1 downto 0) := CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_RGGB;
+    constant PIX_DEPTH              : positive                                                                      := 8;
+    constant SAMPLE_EDGE            : string                                                                        := "RISING";
+    constant MAX_WIDTH              : positive                                                                      := 1920;
+    constant MAX_HEIGHT             : positive                                                                      := 1080;
+    constant OUTPUT_WIDTH           : positive                                                                      := 32;
+    constant FIFO_DEPTH             : positive                                                                      := 32;
+    constant DEVICE_FAMILY          : string                                                                        := "Cyclone V";
+    constant DOWNSCALER_ENABLE      : boolean                                                                       := false;
+    constant PREVIEW_ENABLE         : boolean                                                                       := false;
+    constant PLANAR_ENABLE          : boolean                                                                       := false;
+    constant DEPTH_REDUCER_ENABLE   : boolean                                                                       := false;
+    constant REDUCED_PIX_DEPTH      : positive                                                                      := 4;
+    constant DEBAYER_ENABLE         : boolean                                                                       := false;
+    constant COLOR_CONVERTER_ENABLE : boolean                                                                       := false;
+    constant PACKER_ENABLE          : boolean                                                                       := false;
+    constant STAGE_COUNT            : natural                                                                       := 0;
+    constant BLOB_COUNT             : natural                                                                       := 0;
+    constant SPARSE_ENABLE          : boolean                                                                       := false;
+    constant COMPRESSOR_ENABLE      : boolean                                                                       := true;
+    constant STAGE_0_TYPE           : string                                                                        := "GAIN";
+    constant STAGE_1_TYPE           : string                                                                        := "GAIN";
+    constant STAGE_2_TYPE           : string                                                                        := "GAIN";
+    constant STAGE_3_TYPE           : string                                                                        := "GAIN";
+    constant DEBAYER_PATTERN        : std_logic_vector(CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_WIDTH - 1 downto 0) := CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_RGGB;
 
     constant FRAME_WIDTH       : positive := 5;
     constant FRAME_HEIGHT      : positive := 4;
@@ -43,6 +58,11 @@ architecture test of tb_cmos_sensor_input is
 
     constant BUS_BUSY_THRESHOLD : natural range 0 to 100 := 100;
 
+    -- compressed frame dump, checked by tb_cmos_sensor_input_compressed_check.c
+    constant COMPRESSED_DUMP_FILE : string := "tb_cmos_sensor_input_compressed.txt";
+
+    signal compressed_recording : boolean := false;
+
     -- cmos_sensor_output_generator --------------------------------------------
     signal cmos_sensor_output_generator_addr        : std_logic_vector(2 downto 0);
     signal cmos_sensor_output_generator_read        : std_logic;
@@ -54,15 +74,18 @@ architecture test of tb_cmos_sensor_input is
     signal cmos_sensor_output_generator_data        : std_logic_vector(PIX_DEPTH - 1 downto 0);
 
     -- cmos_sensor_input -------------------------------------------------------
-    signal cmos_sensor_input_ready    : std_logic;
-    signal cmos_sensor_input_valid    : std_logic;
-    signal cmos_sensor_input_data_out : std_logic_vector(OUTPUT_WIDTH - 1 downto 0);
-    signal cmos_sensor_input_addr     : std_logic_vector(1 downto 0);
-    signal cmos_sensor_input_read     : std_logic;
-    signal cmos_sensor_input_write    : std_logic;
-    signal cmos_sensor_input_rddata   : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
-    signal cmos_sensor_input_wrdata   : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
-    signal cmos_sensor_input_irq      : std_logic;
+    signal cmos_sensor_input_ready            : std_logic;
+    signal cmos_sensor_input_valid            : std_logic;
+    signal cmos_sensor_input_data_out         : std_logic_vector(OUTPUT_WIDTH - 1 downto 0);
+    signal cmos_sensor_input_ready_preview    : std_logic := '1';
+    signal cmos_sensor_input_valid_preview    : std_logic;
+    signal cmos_sensor_input_data_out_preview : std_logic_vector(OUTPUT_WIDTH - 1 downto 0);
+    signal cmos_sensor_input_addr             : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_ADDR_WIDTH - 1 downto 0);
+    signal cmos_sensor_input_read             : std_logic;
+    signal cmos_sensor_input_write            : std_logic;
+    signal cmos_sensor_input_rddata           : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+    signal cmos_sensor_input_wrdata           : std_logic_vector(CMOS_SENSOR_INPUT_MM_S_DATA_WIDTH - 1 downto 0);
+    signal cmos_sensor_input_irq              : std_logic;
 
 begin
     clk_generation : process
@@ -117,29 +140,145 @@ begin
                  data        => cmos_sensor_output_generator_data);
 
     cmos_sensor_input_inst : entity work.cmos_sensor_input
-        generic map(PIX_DEPTH      => PIX_DEPTH,
-                    SAMPLE_EDGE    => SAMPLE_EDGE,
-                    MAX_WIDTH      => MAX_WIDTH,
-                    MAX_HEIGHT     => MAX_HEIGHT,
-                    OUTPUT_WIDTH   => OUTPUT_WIDTH,
-                    FIFO_DEPTH     => FIFO_DEPTH,
-                    DEVICE_FAMILY  => DEVICE_FAMILY,
-                    DEBAYER_ENABLE => DEBAYER_ENABLE,
-                    PACKER_ENABLE  => PACKER_ENABLE)
-        port map(clk         => clk,
-                 reset       => reset,
-                 frame_valid => cmos_sensor_output_generator_frame_valid,
-                 line_valid  => cmos_sensor_output_generator_line_valid,
-                 data_in     => cmos_sensor_output_generator_data,
-                 ready       => cmos_sensor_input_ready,
-                 valid       => cmos_sensor_input_valid,
-                 data_out    => cmos_sensor_input_data_out,
-                 addr        => cmos_sensor_input_addr,
-                 read        => cmos_sensor_input_read,
-                 write       => cmos_sensor_input_write,
-                 rddata      => cmos_sensor_input_rddata,
-                 wrdata      => cmos_sensor_input_wrdata,
-                 irq         => cmos_sensor_input_irq);
+        generic map(PIX_DEPTH              => PIX_DEPTH,
+                    SAMPLE_EDGE            => SAMPLE_EDGE,
+                    MAX_WIDTH              => MAX_WIDTH,
+                    MAX_HEIGHT             => MAX_HEIGHT,
+                    OUTPUT_WIDTH           => OUTPUT_WIDTH,
+                    FIFO_DEPTH             => FIFO_DEPTH,
+                    DEVICE_FAMILY          => DEVICE_FAMILY,
+                    DOWNSCALER_ENABLE      => DOWNSCALER_ENABLE,
+                    PREVIEW_ENABLE         => PREVIEW_ENABLE,
+                    PLANAR_ENABLE          => PLANAR_ENABLE,
+                    DEPTH_REDUCER_ENABLE   => DEPTH_REDUCER_ENABLE,
+                    REDUCED_PIX_DEPTH      => REDUCED_PIX_DEPTH,
+                    DEBAYER_ENABLE         => DEBAYER_ENABLE,
+                    COLOR_CONVERTER_ENABLE => COLOR_CONVERTER_ENABLE,
+                    PACKER_ENABLE          => PACKER_ENABLE,
+                    STAGE_COUNT            => STAGE_COUNT,
+                    STAGE_0_TYPE           => STAGE_0_TYPE,
+                    STAGE_1_TYPE           => STAGE_1_TYPE,
+                    STAGE_2_TYPE           => STAGE_2_TYPE,
+                    STAGE_3_TYPE           => STAGE_3_TYPE,
+                    BLOB_COUNT             => BLOB_COUNT,
+                    SPARSE_ENABLE          => SPARSE_ENABLE,
+                    COMPRESSOR_ENABLE      => COMPRESSOR_ENABLE)
+        port map(clk              => clk,
+                 reset            => reset,
+                 frame_valid      => cmos_sensor_output_generator_frame_valid,
+                 line_valid       => cmos_sensor_output_generator_line_valid,
+                 data_in          => cmos_sensor_output_generator_data,
+                 ready            => cmos_sensor_input_ready,
+                 valid            => cmos_sensor_input_valid,
+                 data_out         => cmos_sensor_input_data_out,
+                 ready_preview    => cmos_sensor_input_ready_preview,
+                 valid_preview    => cmos_sensor_input_valid_preview,
+                 data_out_preview => cmos_sensor_input_data_out_preview,
+                 addr             => cmos_sensor_input_addr,
+                 read             => cmos_sensor_input_read,
+                 write            => cmos_sensor_input_write,
+                 rddata           => cmos_sensor_input_rddata,
+                 wrdata           => cmos_sensor_input_wrdata,
+                 irq              => cmos_sensor_input_irq);
+
+    -- Records the pixels entering the compressor and the words leaving the unit
+    -- while compressed_recording is set, then dumps them to
+    -- COMPRESSED_DUMP_FILE. The words are dumped as bytes in the order the
+    -- msgdma writes them to memory: the source has firstSymbolInHighOrderBits
+    -- set, so the high-order byte of data_out comes first. As the source
+    -- byte-swaps the compressor's words, this is also the bitstream's byte
+    -- order (byte 0 holds its bits 7..0). Also checks that the compressor never
+    -- gets a pixel on the cycle following the last one of a frame.
+    compressed_recorder_inst : if COMPRESSOR_ENABLE generate
+        compressed_recorder : process
+            alias compressor_valid_in        is << signal .tb_cmos_sensor_input.cmos_sensor_input_inst.compressor_valid_in_in : std_logic >>;
+            alias compressor_data_in         is << signal .tb_cmos_sensor_input.cmos_sensor_input_inst.compressor_data_in_in : std_logic_vector(PIX_DEPTH - 1 downto 0) >>;
+            alias compressor_end_of_frame_in is << signal .tb_cmos_sensor_input.cmos_sensor_input_inst.compressor_end_of_frame_in_in : std_logic >>;
+
+            constant MAX_PIXELS : positive := FRAME_WIDTH * FRAME_HEIGHT;
+            constant MAX_BYTES  : positive := ((MAX_PIXELS * (CMOS_SENSOR_INPUT_COMPRESS_ESCAPE_Q + PIX_DEPTH) + OUTPUT_WIDTH - 1) / OUTPUT_WIDTH) * (OUTPUT_WIDTH / 8);
+
+            type natural_array is array (natural range <>) of natural;
+
+            file     dump         : text;
+            variable l            : line;
+            variable pixels       : natural_array(0 to MAX_PIXELS - 1);
+            variable pixel_count  : natural := 0;
+            variable bytes        : natural_array(0 to MAX_BYTES - 1);
+            variable byte_count   : natural := 0;
+            variable recorded     : boolean := false;
+            variable end_of_frame : boolean := false;
+        begin
+            wait until rising_edge(clk);
+
+            assert not (end_of_frame and compressor_valid_in = '1')
+                report "compressor input valid on the cycle following end_of_frame_in"
+                severity error;
+            end_of_frame := compressor_valid_in = '1' and compressor_end_of_frame_in = '1';
+
+            if compressed_recording then
+                if compressor_valid_in = '1' then
+                    if pixel_count < MAX_PIXELS then
+                        pixels(pixel_count) := to_integer(unsigned(compressor_data_in));
+                    end if;
+                    pixel_count := pixel_count + 1;
+                end if;
+
+                if cmos_sensor_input_valid = '1' then
+                    for i in 0 to OUTPUT_WIDTH / 8 - 1 loop
+                        if byte_count < MAX_BYTES then
+                            bytes(byte_count) := to_integer(unsigned(cmos_sensor_input_data_out(OUTPUT_WIDTH - 8 * i - 1 downto OUTPUT_WIDTH - 8 * (i + 1))));
+                        end if;
+                        byte_count := byte_count + 1;
+                    end loop;
+                end if;
+
+                recorded := true;
+
+            elsif recorded then
+                assert pixel_count = MAX_PIXELS
+                    report "compressor got " & integer'image(pixel_count) & " pixels instead of " & integer'image(MAX_PIXELS)
+                    severity error;
+
+                assert byte_count <= MAX_BYTES
+                    report "compressed frame larger than its bound"
+                    severity error;
+
+                file_open(dump, COMPRESSED_DUMP_FILE, write_mode);
+
+                write(l, PIX_DEPTH);
+                write(l, ' ');
+                write(l, OUTPUT_WIDTH);
+                writeline(dump, l);
+
+                write(l, FRAME_WIDTH);
+                write(l, ' ');
+                write(l, FRAME_HEIGHT);
+                writeline(dump, l);
+
+                for i in 0 to MAX_PIXELS - 1 loop
+                    write(l, pixels(i));
+                    write(l, ' ');
+                end loop;
+                writeline(dump, l);
+
+                write(l, minimum(byte_count, MAX_BYTES));
+                writeline(dump, l);
+
+                for i in 0 to minimum(byte_count, MAX_BYTES) - 1 loop
+                    write(l, bytes(i));
+                    write(l, ' ');
+                end loop;
+                writeline(dump, l);
+
+                file_close(dump);
+
+                pixel_count := 0;
+                byte_count  := 0;
+                recorded    := false;
+            end if;
+        end process compressed_recorder;
+    end generate compressed_recorder_inst;
 
     sim : process
         function configuration_valid return boolean is
@@ -205,6 +344,22 @@ begin
                 return false;
             end if;
 
+            if DEPTH_REDUCER_ENABLE and not ((PIX_DEPTH <= 16) and (REDUCED_PIX_DEPTH < PIX_DEPTH) and not DEBAYER_ENABLE) then
+                assert false
+                    report "DEPTH_REDUCER_ENABLE requires PIX_DEPTH <= 16, REDUCED_PIX_DEPTH < PIX_DEPTH and DEBAYER_ENABLE = false"
+                    severity error;
+
+                return false;
+            end if;
+
+            if COLOR_CONVERTER_ENABLE and not (DEBAYER_ENABLE and ((PACKER_ENABLE and OUTPUT_WIDTH >= 48) or (not PACKER_ENABLE and OUTPUT_WIDTH >= 24))) then
+                assert false
+                    report "COLOR_CONVERTER_ENABLE requires DEBAYER_ENABLE and OUTPUT_WIDTH >= 24 (48 if PACKER_ENABLE)"
+                    severity error;
+
+                return false;
+            end if;
+
             if not DEBAYER_ENABLE and not PACKER_ENABLE then
                 if OUTPUT_WIDTH < MIN_OUTPUT_WIDTH_DEBAYER_DISABLE_PACKER_DISABLE then
                     assert false
@@ -239,6 +394,14 @@ begin
                 end if;
             end if;
 
+            if COMPRESSOR_ENABLE and not ((PIX_DEPTH <= 16) and (OUTPUT_WIDTH >= PIX_DEPTH + CMOS_SENSOR_INPUT_COMPRESS_ESCAPE_Q) and not DEBAYER_ENABLE) then
+                assert false
+                    report "COMPRESSOR_ENABLE requires PIX_DEPTH <= 16, OUTPUT_WIDTH >= PIX_DEPTH + " & integer'image(CMOS_SENSOR_INPUT_COMPRESS_ESCAPE_Q) & " and DEBAYER_ENABLE = false"
+                    severity error;
+
+                return false;
+            end if;
+
             if not ((2 <= FRAME_WIDTH) and (FRAME_WIDTH <= MAX_WIDTH)) then
                 assert false
                     report "FRAME_WIDTH must be in range {1:" & integer'image(MAX_WIDTH) & "}"
@@ -323,7 +486,8 @@ begin
             end procedure write_command_register;
 
             procedure write_config_register(constant irq             : in boolean;
-                                            constant debayer_pattern : in std_logic_vector) is
+                                            constant debayer_pattern : in std_logic_vector;
+                                            constant compress        : in boolean) is
             begin
                 wait until falling_edge(clk);
                 cmos_sensor_input_addr   <= CMOS_SENSOR_INPUT_CONFIG_OFST;
@@ -338,6 +502,10 @@ begin
 
                 cmos_sensor_input_wrdata(CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_DEBAYER_PATTERN_LOW_BIT_OFST) <= debayer_pattern;
 
+                if compress then
+                    cmos_sensor_input_wrdata(CMOS_SENSOR_INPUT_CONFIG_COMPRESS_HIGH_BIT_OFST downto CMOS_SENSOR_INPUT_CONFIG_COMPRESS_LOW_BIT_OFST) <= CMOS_SENSOR_INPUT_CONFIG_COMPRESS_ENABLE;
+                end if;
+
                 wait until falling_edge(clk);
                 cmos_sensor_input_addr   <= (others => '0');
                 cmos_sensor_input_write  <= '0';
@@ -393,7 +561,7 @@ begin
                 write_command_register(CMOS_SENSOR_INPUT_COMMAND_STOP_AND_RESET);
                 wait_until_idle;
 
-                write_config_register(false, DEBAYER_PATTERN);
+                write_config_register(false, DEBAYER_PATTERN, false);
                 wait_until_idle;
 
                 write_command_register(CMOS_SENSOR_INPUT_COMMAND_GET_FRAME_INFO);
@@ -410,7 +578,7 @@ begin
                 write_command_register(CMOS_SENSOR_INPUT_COMMAND_STOP_AND_RESET);
                 wait_until_idle;
 
-                write_config_register(true, DEBAYER_PATTERN);
+                write_config_register(true, DEBAYER_PATTERN, false);
                 wait_until_idle;
 
                 write_command_register(CMOS_SENSOR_INPUT_COMMAND_GET_FRAME_INFO);
@@ -430,10 +598,35 @@ begin
                 wait_until_idle;
             end procedure withIrq;
 
+            -- captures one compressed frame, dumped by compressed_recorder
+            procedure compressed is
+            begin
+                write_command_register(CMOS_SENSOR_INPUT_COMMAND_STOP_AND_RESET);
+                wait_until_idle;
+
+                write_config_register(false, DEBAYER_PATTERN, true);
+                wait_until_idle;
+
+                write_command_register(CMOS_SENSOR_INPUT_COMMAND_GET_FRAME_INFO);
+                wait_until_idle;
+
+                compressed_recording <= true;
+                write_command_register(CMOS_SENSOR_INPUT_COMMAND_SNAPSHOT);
+                wait_until_idle;
+                compressed_recording <= false;
+
+                -- let compressed_recorder write the dump
+                wait_clock_cycles(2);
+            end procedure compressed;
+
         begin
             --noIrq;
             withIrq;
 
+            if COMPRESSOR_ENABLE then
+                compressed;
+            end if;
+
         end procedure sim_cmos_sensor_input;
 
     begin
@@ -0,0 +1,36 @@
+#ifndef __CMOS_SENSOR_ACQUISITION_FRAME_POOL_H__
+#define __CMOS_SENSOR_ACQUISITION_FRAME_POOL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cmos_sensor_acquisition.h"
+
+/* Maximum number of frames in a pool (one bit per frame in free_mask) */
+#define CMOS_SENSOR_ACQUISITION_FRAME_POOL_MAX_FRAMES (32)
+
+/* frame pool structure */
+typedef struct cmos_sensor_acquisition_frame_pool {
+    void     *memory;      /* Backing allocation (only used to free the pool) */
+    uint8_t  *frames;      /* Aligned address of the first frame */
+    size_t   frame_size;   /* Size of a frame in bytes */
+    size_t   frame_stride; /* Distance between 2 frames in bytes */
+    uint32_t num_frames;   /* Number of frames in the pool */
+    uint32_t free_mask;    /* Bit i is set if frame i is free */
+    bool     uncached;     /* Frames are handed out as uncached aliases */
+} cmos_sensor_acquisition_frame_pool;
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+size_t cmos_sensor_acquisition_frame_pool_alignment(cmos_sensor_acquisition_dev *dev);
+
+bool cmos_sensor_acquisition_frame_pool_init(cmos_sensor_acquisition_frame_pool *pool, size_t frame_size, uint32_t num_frames, size_t alignment, bool uncached);
+void cmos_sensor_acquisition_frame_pool_destroy(cmos_sensor_acquisition_frame_pool *pool);
+
+void *cmos_sensor_acquisition_frame_pool_acquire(cmos_sensor_acquisition_frame_pool *pool);
+void cmos_sensor_acquisition_frame_pool_dma_done(cmos_sensor_acquisition_frame_pool *pool, void *frame, size_t size);
+void cmos_sensor_acquisition_frame_pool_release(cmos_sensor_acquisition_frame_pool *pool, void *frame);
+
+#endif /* __CMOS_SENSOR_ACQUISITION_FRAME_POOL_H__ */
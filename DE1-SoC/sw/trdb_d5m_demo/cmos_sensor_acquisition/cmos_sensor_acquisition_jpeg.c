@@ -0,0 +1,982 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "cmos_sensor_acquisition_jpeg.h"
+
+/*
+ * The encoder produces baseline JFIF files with 4:2:0 chroma subsampling, the
+ * quality-scaled quantization tables and the typical Huffman tables of Annex K
+ * of the JPEG standard.
+ *
+ * The forward DCT is the fixed-point AAN (Arai, Agui and Nakajima) algorithm
+ * with 8 fractional bits, as libjpeg's "ifast" DCT. Its outputs are scaled by
+ * 8 * aan_scales[], which is folded into the quantizer divisors. The SSE2
+ * kernel computes exactly the same values as the portable one: it works on 16
+ * bit lanes and computes (x * c) >> 8 as mulhi(x << 2, c << 6), which is exact
+ * as long as |x| < 2^13 (always true for 8 bit samples).
+ */
+
+/* number of fractional bits of the DCT constants */
+#define DCT_CONST_BITS (8)
+
+#define FIX_0_382683433 (98)
+#define FIX_0_541196100 (139)
+#define FIX_0_707106781 (181)
+#define FIX_1_306562965 (334)
+
+#define DCT_MULTIPLY(x, c) (((x) * (c)) >> DCT_CONST_BITS)
+
+/* JPEG markers */
+#define MARKER_SOI  (0xd8)
+#define MARKER_EOI  (0xd9)
+#define MARKER_APP0 (0xe0)
+#define MARKER_DQT  (0xdb)
+#define MARKER_SOF0 (0xc0)
+#define MARKER_DHT  (0xc4)
+#define MARKER_SOS  (0xda)
+
+/* upper bound of the size of the headers written by write_headers() */
+#define JPEG_HEADERS_SIZE (1024)
+
+/* upper bound of the size of the entropy coded data of an MCU (6 blocks of at
+ * most 64 codes of 27 bits each, doubled for byte stuffing) */
+#define JPEG_MCU_CODED_SIZE (2 * 6 * 64 * 27 / 8)
+
+/* Huffman table specification, as stored in a DHT segment */
+typedef struct huffman_spec {
+    uint8_t       bits[16]; /* Number of codes of each length from 1 to 16 */
+    const uint8_t *values;  /* Symbols, by increasing code length */
+    uint32_t      count;    /* Number of symbols */
+} huffman_spec;
+
+/* Huffman encoding table */
+typedef struct huffman_table {
+    uint16_t code[256]; /* Code of each symbol */
+    uint8_t  size[256]; /* Length in bits of the code of each symbol */
+} huffman_table;
+
+/* index (in natural order) of each coefficient in zigzag order */
+static const uint8_t natural_order[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10,
+    17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34,
+    27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36,
+    29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46,
+    53, 60, 61, 54, 47, 55, 62, 63
+};
+
+/* Annex K quantization tables, natural order */
+static const uint8_t base_quant[2][64] = {
+    {
+        16,  11,  10,  16,  24,  40,  51,  61,
+        12,  12,  14,  19,  26,  58,  60,  55,
+        14,  13,  16,  24,  40,  57,  69,  56,
+        14,  17,  22,  29,  51,  87,  80,  62,
+        18,  22,  37,  56,  68, 109, 103,  77,
+        24,  35,  55,  64,  81, 104, 113,  92,
+        49,  64,  78,  87, 103, 121, 120, 101,
+        72,  92,  95,  98, 112, 100, 103,  99
+    },
+    {
+        17,  18,  24,  47,  99,  99,  99,  99,
+        18,  21,  26,  66,  99,  99,  99,  99,
+        24,  26,  56,  99,  99,  99,  99,  99,
+        47,  66,  99,  99,  99,  99,  99,  99,
+        99,  99,  99,  99,  99,  99,  99,  99,
+        99,  99,  99,  99,  99,  99,  99,  99,
+        99,  99,  99,  99,  99,  99,  99,  99,
+        99,  99,  99,  99,  99,  99,  99,  99
+    }
+};
+
+/* output scale of the AAN DCT, 2^14 * cos(k * pi / 16) * sqrt(2) products, natural order */
+static const uint16_t aan_scales[64] = {
+    16384, 22725, 21407, 19266, 16384, 12873,  8867,  4520,
+    22725, 31521, 29692, 26722, 22725, 17855, 12299,  6270,
+    21407, 29692, 27969, 25172, 21407, 16819, 11585,  5906,
+    19266, 26722, 25172, 22654, 19266, 15137, 10426,  5315,
+    16384, 22725, 21407, 19266, 16384, 12873,  8867,  4520,
+    12873, 17855, 16819, 15137, 12873, 10114,  6967,  3552,
+     8867, 12299, 11585, 10426,  8867,  6967,  4799,  2446,
+     4520,  6270,  5906,  5315,  4520,  3552,  2446,  1247
+};
+
+static const uint8_t dc_values[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+static const uint8_t ac_luma_values[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+static const uint8_t ac_chroma_values[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+/* DC luma, AC luma, DC chroma and AC chroma tables, in DHT order */
+static const huffman_spec huffman_specs[4] = {
+    {{0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0},    dc_values,        12},
+    {{0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d}, ac_luma_values,   162},
+    {{0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0},    dc_values,        12},
+    {{0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77}, ac_chroma_values, 162}
+};
+
+/* table class and identifier of each table in a DHT segment */
+static const uint8_t huffman_ids[4] = {0x00, 0x10, 0x01, 0x11};
+
+static huffman_table huffman_tables[4];
+static bool huffman_tables_built = false;
+
+/*******************************************************************************
+ *  Private API
+ ******************************************************************************/
+static void build_huffman_tables(void);
+static void build_quant_tables(cmos_sensor_acquisition_jpeg_encoder *enc, uint8_t quality);
+static void put_byte(cmos_sensor_acquisition_jpeg_encoder *enc, uint8_t byte);
+static void put_u16(cmos_sensor_acquisition_jpeg_encoder *enc, uint16_t value);
+static void put_marker(cmos_sensor_acquisition_jpeg_encoder *enc, uint8_t marker, uint16_t length);
+static void put_bits(cmos_sensor_acquisition_jpeg_encoder *enc, uint32_t code, uint32_t size);
+static void flush_bits(cmos_sensor_acquisition_jpeg_encoder *enc);
+static void write_headers(cmos_sensor_acquisition_jpeg_encoder *enc);
+static uint64_t read_pixel(const uint8_t *pixel, size_t pixel_size);
+static void convert_row(cmos_sensor_acquisition_jpeg_encoder *enc, const uint8_t *row, uint32_t line);
+static void fdct(int16_t *block);
+static void quantize(const cmos_sensor_acquisition_jpeg_encoder *enc, const int16_t *block, int16_t *coefs, uint32_t table);
+static uint32_t bit_length(uint32_t value);
+static void encode_block(cmos_sensor_acquisition_jpeg_encoder *enc, int16_t *block, uint32_t component);
+static void encode_mcu_row(cmos_sensor_acquisition_jpeg_encoder *enc);
+
+/*
+ * build_huffman_tables
+ *
+ * Generates the code of every symbol of the Huffman tables (Annex C of the
+ * JPEG standard). The tables are shared by all encoders.
+ */
+static void build_huffman_tables(void) {
+    for (uint32_t t = 0; t < 4; t++) {
+        const huffman_spec *spec = &huffman_specs[t];
+        huffman_table *table = &huffman_tables[t];
+        uint32_t code = 0;
+        uint32_t k = 0;
+
+        memset(table, 0, sizeof(*table));
+
+        for (uint32_t length = 1; length <= 16; length++) {
+            for (uint32_t i = 0; i < spec->bits[length - 1]; i++) {
+                table->code[spec->values[k]] = code;
+                table->size[spec->values[k]] = length;
+                code++;
+                k++;
+            }
+            code <<= 1;
+        }
+    }
+
+    huffman_tables_built = true;
+}
+
+/*
+ * build_quant_tables
+ *
+ * Scales the Annex K quantization tables to quality (1 to 100) as libjpeg
+ * does, and precomputes the divisors and reciprocals used to quantize the
+ * (scaled) DCT outputs.
+ */
+static void build_quant_tables(cmos_sensor_acquisition_jpeg_encoder *enc, uint8_t quality) {
+    uint32_t scale = (quality < 50) ? (5000 / quality) : (200 - 2 * quality);
+
+    for (uint32_t t = 0; t < 2; t++) {
+        for (uint32_t i = 0; i < 64; i++) {
+            uint32_t q = (base_quant[t][i] * scale + 50) / 100;
+            if (q < 1) {
+                q = 1;
+            } else if (q > 255) {
+                q = 255;
+            }
+
+            /* the DCT outputs are scaled by 8 * aan_scales[i] / 2^14 */
+            uint32_t divisor = (q * aan_scales[i] + (1 << 10)) >> 11;
+            if (divisor < 1) {
+                divisor = 1;
+            }
+
+            enc->quant[t][i] = q;
+            enc->divisor[t][i] = divisor;
+            enc->reciprocal[t][i] = 65536 / divisor;
+        }
+    }
+}
+
+/*
+ * put_byte
+ *
+ * Appends a byte to the output, or flags the encoder if the output buffer is
+ * full.
+ */
+static void put_byte(cmos_sensor_acquisition_jpeg_encoder *enc, uint8_t byte) {
+    if (enc->out_used < enc->out_size) {
+        enc->out[enc->out_used++] = byte;
+    } else {
+        enc->error = true;
+    }
+}
+
+/*
+ * put_u16
+ *
+ * Appends a big-endian 16 bit value to the output.
+ */
+static void put_u16(cmos_sensor_acquisition_jpeg_encoder *enc, uint16_t value) {
+    put_byte(enc, value >> 8);
+    put_byte(enc, value & 0xff);
+}
+
+/*
+ * put_marker
+ *
+ * Appends a marker, followed by the length of its segment if length is not 0.
+ */
+static void put_marker(cmos_sensor_acquisition_jpeg_encoder *enc, uint8_t marker, uint16_t length) {
+    put_byte(enc, 0xff);
+    put_byte(enc, marker);
+
+    if (length != 0) {
+        put_u16(enc, length);
+    }
+}
+
+/*
+ * put_bits
+ *
+ * Appends the size (at most 16) low bits of code to the entropy coded data,
+ * most significant bit first, stuffing a 0 byte after every 0xff byte.
+ */
+static void put_bits(cmos_sensor_acquisition_jpeg_encoder *enc, uint32_t code, uint32_t size) {
+    enc->bits = (enc->bits << size) | (code & ((1u << size) - 1));
+    enc->bit_count += size;
+
+    while (enc->bit_count >= 8) {
+        uint8_t byte = enc->bits >> (enc->bit_count - 8);
+
+        put_byte(enc, byte);
+        if (byte == 0xff) {
+            put_byte(enc, 0x00);
+        }
+
+        enc->bit_count -= 8;
+    }
+
+    enc->bits &= (1u << enc->bit_count) - 1;
+}
+
+/*
+ * flush_bits
+ *
+ * Pads the entropy coded data to a byte boundary with 1 bits.
+ */
+static void flush_bits(cmos_sensor_acquisition_jpeg_encoder *enc) {
+    if (enc->bit_count > 0) {
+        put_bits(enc, 0x7f, 8 - enc->bit_count);
+    }
+}
+
+/*
+ * write_headers
+ *
+ * Writes everything which precedes the entropy coded data: the JFIF header,
+ * the quantization and Huffman tables, the frame header and the scan header.
+ */
+static void write_headers(cmos_sensor_acquisition_jpeg_encoder *enc) {
+    static const uint8_t jfif[14] = {'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0};
+
+    put_marker(enc, MARKER_SOI, 0);
+
+    put_marker(enc, MARKER_APP0, 2 + sizeof(jfif));
+    for (uint32_t i = 0; i < sizeof(jfif); i++) {
+        put_byte(enc, jfif[i]);
+    }
+
+    put_marker(enc, MARKER_DQT, 2 + 2 * 65);
+    for (uint32_t t = 0; t < 2; t++) {
+        put_byte(enc, t);
+        for (uint32_t k = 0; k < 64; k++) {
+            put_byte(enc, enc->quant[t][natural_order[k]]);
+        }
+    }
+
+    /* Y is sampled 2x2, Cb and Cr 1x1, and use quantization tables 0, 1 and 1 */
+    put_marker(enc, MARKER_SOF0, 2 + 6 + 3 * 3);
+    put_byte(enc, 8);
+    put_u16(enc, enc->height);
+    put_u16(enc, enc->width);
+    put_byte(enc, 3);
+    put_byte(enc, 1); put_byte(enc, 0x22); put_byte(enc, 0);
+    put_byte(enc, 2); put_byte(enc, 0x11); put_byte(enc, 1);
+    put_byte(enc, 3); put_byte(enc, 0x11); put_byte(enc, 1);
+
+    uint32_t dht_length = 2;
+    for (uint32_t t = 0; t < 4; t++) {
+        dht_length += 1 + 16 + huffman_specs[t].count;
+    }
+    put_marker(enc, MARKER_DHT, dht_length);
+    for (uint32_t t = 0; t < 4; t++) {
+        put_byte(enc, huffman_ids[t]);
+        for (uint32_t i = 0; i < 16; i++) {
+            put_byte(enc, huffman_specs[t].bits[i]);
+        }
+        for (uint32_t i = 0; i < huffman_specs[t].count; i++) {
+            put_byte(enc, huffman_specs[t].values[i]);
+        }
+    }
+
+    /* Y uses Huffman tables 0, Cb and Cr tables 1 */
+    put_marker(enc, MARKER_SOS, 2 + 1 + 3 * 2 + 3);
+    put_byte(enc, 3);
+    put_byte(enc, 1); put_byte(enc, 0x00);
+    put_byte(enc, 2); put_byte(enc, 0x11);
+    put_byte(enc, 3); put_byte(enc, 0x11);
+    put_byte(enc, 0);
+    put_byte(enc, 63);
+    put_byte(enc, 0);
+}
+
+/*
+ * read_pixel
+ *
+ * Reads a pixel_size-byte little-endian pixel.
+ */
+static uint64_t read_pixel(const uint8_t *pixel, size_t pixel_size) {
+    uint64_t value = 0;
+
+    for (size_t i = 0; i < pixel_size; i++) {
+        value |= ((uint64_t) pixel[i]) << (8 * i);
+    }
+
+    return value;
+}
+
+/*
+ * convert_row
+ *
+ * Converts an input row to full resolution Y, Cb and Cr samples (full-range
+ * BT.601, as JFIF requires), saved in line line of the MCU row buffer. The
+ * last pixel is replicated up to the padded width.
+ */
+static void convert_row(cmos_sensor_acquisition_jpeg_encoder *enc, const uint8_t *row, uint32_t line) {
+    size_t plane_size = (size_t) enc->padded_width * CMOS_SENSOR_ACQUISITION_JPEG_MCU_SIZE;
+    uint8_t *y_row = enc->planes + line * enc->padded_width;
+    uint8_t *cb_row = y_row + plane_size;
+    uint8_t *cr_row = cb_row + plane_size;
+    uint32_t depth = enc->pix_depth;
+    uint32_t mask = (1u << depth) - 1;
+
+    for (uint32_t x = 0; x < enc->width; x++) {
+        uint64_t pixel = read_pixel(row + x * enc->pixel_size, enc->pixel_size);
+        int32_t r;
+        int32_t g;
+        int32_t b;
+
+        if (enc->format == OUTPUT_FORMAT_YCBCR422) {
+            /* even pixels carry Cb, odd pixels Cr, of the even pixel */
+            uint32_t pair = x & ~1u;
+            uint64_t even = (x == pair) ? pixel : read_pixel(row + pair * enc->pixel_size, enc->pixel_size);
+            uint64_t odd = (pair + 1 < enc->width) ? read_pixel(row + (pair + 1) * enc->pixel_size, enc->pixel_size) : even;
+
+            y_row[x] = (pixel >> 8) & 0xff;
+            cb_row[x] = even & 0xff;
+            cr_row[x] = odd & 0xff;
+            continue;
+        }
+
+        if (enc->format == OUTPUT_FORMAT_RGB565) {
+            r = (pixel >> 11) & 0x1f;
+            g = (pixel >> 5) & 0x3f;
+            b = pixel & 0x1f;
+            r = (r << 3) | (r >> 2);
+            g = (g << 2) | (g >> 4);
+            b = (b << 3) | (b >> 2);
+        } else if (enc->format == OUTPUT_FORMAT_RGB888) {
+            r = (pixel >> 16) & 0xff;
+            g = (pixel >> 8) & 0xff;
+            b = pixel & 0xff;
+        } else {
+            /* debayer output, R in the most significant bits, reduced (or
+             * extended) to 8 bits as the color converter does */
+            r = (pixel >> (2 * depth)) & mask;
+            g = (pixel >> depth) & mask;
+            b = pixel & mask;
+            if (depth >= 8) {
+                r >>= depth - 8;
+                g >>= depth - 8;
+                b >>= depth - 8;
+            } else {
+                r <<= 8 - depth;
+                g <<= 8 - depth;
+                b <<= 8 - depth;
+            }
+        }
+
+        y_row[x] = (19595 * r + 38470 * g + 7471 * b + 32768) >> 16;
+        cb_row[x] = (-11059 * r - 21709 * g + 32768 * b + (128 << 16) + 32767) >> 16;
+        cr_row[x] = (32768 * r - 27439 * g - 5329 * b + (128 << 16) + 32767) >> 16;
+    }
+
+    for (uint32_t x = enc->width; x < enc->padded_width; x++) {
+        y_row[x] = y_row[enc->width - 1];
+        cb_row[x] = cb_row[enc->width - 1];
+        cr_row[x] = cr_row[enc->width - 1];
+    }
+}
+
+#if defined(__SSE2__)
+/*
+ * transpose_8x8
+ *
+ * Transposes an 8x8 block of 16 bit values held one row per register.
+ */
+static inline void transpose_8x8(__m128i *r) {
+    __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+    __m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+    __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+    __m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+    __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+    __m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+    __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+    __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+    r[0] = _mm_unpacklo_epi64(b0, b4);
+    r[1] = _mm_unpackhi_epi64(b0, b4);
+    r[2] = _mm_unpacklo_epi64(b1, b5);
+    r[3] = _mm_unpackhi_epi64(b1, b5);
+    r[4] = _mm_unpacklo_epi64(b2, b6);
+    r[5] = _mm_unpackhi_epi64(b2, b6);
+    r[6] = _mm_unpacklo_epi64(b3, b7);
+    r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+/*
+ * dct_1d_8x
+ *
+ * One AAN DCT pass on 8 vectors at once: d[k] holds input k of 8 independent
+ * 1-D transforms, and is replaced by their output k.
+ */
+static inline void dct_1d_8x(__m128i *d) {
+    const __m128i c_0_382 = _mm_set1_epi16(FIX_0_382683433 << 6);
+    const __m128i c_0_541 = _mm_set1_epi16(FIX_0_541196100 << 6);
+    const __m128i c_0_707 = _mm_set1_epi16(FIX_0_707106781 << 6);
+    const __m128i c_1_306 = _mm_set1_epi16(FIX_1_306562965 << 6);
+
+#define SSE2_MULTIPLY(x, c) _mm_mulhi_epi16(_mm_slli_epi16((x), 2), (c))
+
+    __m128i tmp0 = _mm_add_epi16(d[0], d[7]);
+    __m128i tmp7 = _mm_sub_epi16(d[0], d[7]);
+    __m128i tmp1 = _mm_add_epi16(d[1], d[6]);
+    __m128i tmp6 = _mm_sub_epi16(d[1], d[6]);
+    __m128i tmp2 = _mm_add_epi16(d[2], d[5]);
+    __m128i tmp5 = _mm_sub_epi16(d[2], d[5]);
+    __m128i tmp3 = _mm_add_epi16(d[3], d[4]);
+    __m128i tmp4 = _mm_sub_epi16(d[3], d[4]);
+
+    /* even part */
+    __m128i tmp10 = _mm_add_epi16(tmp0, tmp3);
+    __m128i tmp13 = _mm_sub_epi16(tmp0, tmp3);
+    __m128i tmp11 = _mm_add_epi16(tmp1, tmp2);
+    __m128i tmp12 = _mm_sub_epi16(tmp1, tmp2);
+
+    d[0] = _mm_add_epi16(tmp10, tmp11);
+    d[4] = _mm_sub_epi16(tmp10, tmp11);
+
+    __m128i z1 = SSE2_MULTIPLY(_mm_add_epi16(tmp12, tmp13), c_0_707);
+    d[2] = _mm_add_epi16(tmp13, z1);
+    d[6] = _mm_sub_epi16(tmp13, z1);
+
+    /* odd part */
+    tmp10 = _mm_add_epi16(tmp4, tmp5);
+    tmp11 = _mm_add_epi16(tmp5, tmp6);
+    tmp12 = _mm_add_epi16(tmp6, tmp7);
+
+    __m128i z5 = SSE2_MULTIPLY(_mm_sub_epi16(tmp10, tmp12), c_0_382);
+    __m128i z2 = _mm_add_epi16(SSE2_MULTIPLY(tmp10, c_0_541), z5);
+    __m128i z4 = _mm_add_epi16(SSE2_MULTIPLY(tmp12, c_1_306), z5);
+    __m128i z3 = SSE2_MULTIPLY(tmp11, c_0_707);
+
+    __m128i z11 = _mm_add_epi16(tmp7, z3);
+    __m128i z13 = _mm_sub_epi16(tmp7, z3);
+
+    d[5] = _mm_add_epi16(z13, z2);
+    d[3] = _mm_sub_epi16(z13, z2);
+    d[1] = _mm_add_epi16(z11, z4);
+    d[7] = _mm_sub_epi16(z11, z4);
+
+#undef SSE2_MULTIPLY
+}
+
+/*
+ * fdct
+ *
+ * In-place forward DCT of an 8x8 block of level shifted samples (SSE2 kernel).
+ */
+static void fdct(int16_t *block) {
+    __m128i r[8];
+
+    for (uint32_t i = 0; i < 8; i++) {
+        r[i] = _mm_loadu_si128((const __m128i *) (block + 8 * i));
+    }
+
+    /* rows: transpose so that r[k] holds sample k of every row */
+    transpose_8x8(r);
+    dct_1d_8x(r);
+
+    /* columns: transpose back so that r[k] holds row k */
+    transpose_8x8(r);
+    dct_1d_8x(r);
+
+    for (uint32_t i = 0; i < 8; i++) {
+        _mm_storeu_si128((__m128i *) (block + 8 * i), r[i]);
+    }
+}
+#else
+/*
+ * fdct
+ *
+ * In-place forward DCT of an 8x8 block of level shifted samples: AAN rows
+ * pass, then columns pass.
+ */
+static void fdct(int16_t *block) {
+    for (uint32_t pass = 0; pass < 2; pass++) {
+        /* elements of a row are 1 apart, elements of a column are 8 apart */
+        uint32_t step = (pass == 0) ? 1 : 8;
+        uint32_t stride = (pass == 0) ? 8 : 1;
+
+        for (uint32_t i = 0; i < 8; i++) {
+            int16_t *d = block + i * stride;
+
+            int32_t tmp0 = d[0 * step] + d[7 * step];
+            int32_t tmp7 = d[0 * step] - d[7 * step];
+            int32_t tmp1 = d[1 * step] + d[6 * step];
+            int32_t tmp6 = d[1 * step] - d[6 * step];
+            int32_t tmp2 = d[2 * step] + d[5 * step];
+            int32_t tmp5 = d[2 * step] - d[5 * step];
+            int32_t tmp3 = d[3 * step] + d[4 * step];
+            int32_t tmp4 = d[3 * step] - d[4 * step];
+
+            /* even part */
+            int32_t tmp10 = tmp0 + tmp3;
+            int32_t tmp13 = tmp0 - tmp3;
+            int32_t tmp11 = tmp1 + tmp2;
+            int32_t tmp12 = tmp1 - tmp2;
+
+            d[0 * step] = tmp10 + tmp11;
+            d[4 * step] = tmp10 - tmp11;
+
+            int32_t z1 = DCT_MULTIPLY(tmp12 + tmp13, FIX_0_707106781);
+            d[2 * step] = tmp13 + z1;
+            d[6 * step] = tmp13 - z1;
+
+            /* odd part */
+            tmp10 = tmp4 + tmp5;
+            tmp11 = tmp5 + tmp6;
+            tmp12 = tmp6 + tmp7;
+
+            int32_t z5 = DCT_MULTIPLY(tmp10 - tmp12, FIX_0_382683433);
+            int32_t z2 = DCT_MULTIPLY(tmp10, FIX_0_541196100) + z5;
+            int32_t z4 = DCT_MULTIPLY(tmp12, FIX_1_306562965) + z5;
+            int32_t z3 = DCT_MULTIPLY(tmp11, FIX_0_707106781);
+
+            int32_t z11 = tmp7 + z3;
+            int32_t z13 = tmp7 - z3;
+
+            d[5 * step] = z13 + z2;
+            d[3 * step] = z13 - z2;
+            d[1 * step] = z11 + z4;
+            d[7 * step] = z11 - z4;
+        }
+    }
+}
+#endif
+
+/*
+ * quantize
+ *
+ * Quantizes the DCT outputs of block with quantization table table, rounding
+ * to the nearest, using reciprocals instead of divisions.
+ */
+static void quantize(const cmos_sensor_acquisition_jpeg_encoder *enc, const int16_t *block, int16_t *coefs, uint32_t table) {
+    const uint16_t *divisor = enc->divisor[table];
+    const uint32_t *reciprocal = enc->reciprocal[table];
+
+    for (uint32_t i = 0; i < 64; i++) {
+        int32_t value = block[i];
+        uint32_t magnitude = (value < 0) ? -value : value;
+        int32_t q = ((magnitude + (divisor[i] >> 1)) * reciprocal[i]) >> 16;
+
+        coefs[i] = (value < 0) ? -q : q;
+    }
+}
+
+/*
+ * bit_length
+ *
+ * Returns the number of bits needed to represent value (0 for 0).
+ */
+static uint32_t bit_length(uint32_t value) {
+    uint32_t length = 0;
+
+    while (value != 0) {
+        length++;
+        value >>= 1;
+    }
+
+    return length;
+}
+
+/*
+ * encode_block
+ *
+ * Transforms, quantizes and entropy codes a block of level shifted samples of
+ * component component (0 for Y, 1 for Cb, 2 for Cr).
+ */
+static void encode_block(cmos_sensor_acquisition_jpeg_encoder *enc, int16_t *block, uint32_t component) {
+    uint32_t table = (component == 0) ? 0 : 1;
+    const huffman_table *dc_table = &huffman_tables[2 * table];
+    const huffman_table *ac_table = &huffman_tables[2 * table + 1];
+    int16_t coefs[64];
+
+    fdct(block);
+    quantize(enc, block, coefs, table);
+
+    int32_t diff = coefs[0] - enc->dc[component];
+    enc->dc[component] = coefs[0];
+
+    uint32_t size = bit_length((diff < 0) ? -diff : diff);
+    put_bits(enc, dc_table->code[size], dc_table->size[size]);
+    if (size != 0) {
+        put_bits(enc, (diff < 0) ? (diff - 1) : diff, size);
+    }
+
+    uint32_t run = 0;
+    for (uint32_t k = 1; k < 64; k++) {
+        int32_t value = coefs[natural_order[k]];
+
+        if (value == 0) {
+            run++;
+            continue;
+        }
+
+        while (run > 15) {
+            put_bits(enc, ac_table->code[0xf0], ac_table->size[0xf0]);
+            run -= 16;
+        }
+
+        size = bit_length((value < 0) ? -value : value);
+        uint32_t symbol = (run << 4) | size;
+        put_bits(enc, ac_table->code[symbol], ac_table->size[symbol]);
+        put_bits(enc, (value < 0) ? (value - 1) : value, size);
+        run = 0;
+    }
+
+    if (run > 0) {
+        put_bits(enc, ac_table->code[0x00], ac_table->size[0x00]);
+    }
+}
+
+/*
+ * encode_mcu_row
+ *
+ * Encodes the MCU row held in the MCU row buffer: for each MCU, the 4 Y blocks
+ * and the 2x2 averaged Cb and Cr blocks.
+ */
+static void encode_mcu_row(cmos_sensor_acquisition_jpeg_encoder *enc) {
+    size_t plane_size = (size_t) enc->padded_width * CMOS_SENSOR_ACQUISITION_JPEG_MCU_SIZE;
+    uint32_t pitch = enc->padded_width;
+    int16_t block[64];
+
+    for (uint32_t mcu_x = 0; mcu_x < enc->padded_width; mcu_x += CMOS_SENSOR_ACQUISITION_JPEG_MCU_SIZE) {
+        for (uint32_t b = 0; b < 4; b++) {
+            const uint8_t *y_plane = enc->planes + (b / 2) * 8 * pitch + mcu_x + (b % 2) * 8;
+
+            for (uint32_t i = 0; i < 8; i++) {
+                for (uint32_t j = 0; j < 8; j++) {
+                    block[i * 8 + j] = y_plane[i * pitch + j] - 128;
+                }
+            }
+
+            encode_block(enc, block, 0);
+        }
+
+        for (uint32_t component = 1; component <= 2; component++) {
+            const uint8_t *plane = enc->planes + component * plane_size + mcu_x;
+
+            for (uint32_t i = 0; i < 8; i++) {
+                const uint8_t *top = plane + 2 * i * pitch;
+                const uint8_t *bottom = top + pitch;
+
+                for (uint32_t j = 0; j < 8; j++) {
+                    uint32_t sum = top[2 * j] + top[2 * j + 1] + bottom[2 * j] + bottom[2 * j + 1];
+                    block[i * 8 + j] = (int16_t) ((sum + 2) >> 2) - 128;
+                }
+            }
+
+            encode_block(enc, block, component);
+        }
+    }
+}
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+/*
+ * cmos_sensor_acquisition_jpeg_pixel_size
+ *
+ * Returns the size in bytes of a pixel of the frames captured by dev in its
+ * current configuration, to be given to
+ * cmos_sensor_acquisition_jpeg_encoder_init(), or 0 if the frames cannot be
+ * encoded (no debayering, or packed pixels which are not byte aligned).
+ */
+size_t cmos_sensor_acquisition_jpeg_pixel_size(cmos_sensor_acquisition_dev *dev) {
+    cmos_sensor_input_dev *input = &dev->cmos_sensor_input;
+    uint32_t pix_bits = cmos_sensor_input_output_pix_bits(input);
+    uint32_t pixels_per_word = 1;
+
+    if (!input->debayer_enable || pix_bits > 64) {
+        return 0;
+    }
+
+    if (input->packer_enable) {
+        pixels_per_word = input->output_width / pix_bits;
+        if (pixels_per_word > 1 && pixels_per_word * pix_bits != input->output_width) {
+            return 0;
+        }
+    }
+
+    return (input->output_width / 8) / pixels_per_word;
+}
+
+/*
+ * cmos_sensor_acquisition_jpeg_bound
+ *
+ * Returns the largest possible size in bytes of an encoded width x height
+ * frame.
+ */
+size_t cmos_sensor_acquisition_jpeg_bound(uint32_t width, uint32_t height) {
+    size_t mcus_x = (width + CMOS_SENSOR_ACQUISITION_JPEG_MCU_SIZE - 1) / CMOS_SENSOR_ACQUISITION_JPEG_MCU_SIZE;
+    size_t mcus_y = (height + CMOS_SENSOR_ACQUISITION_JPEG_MCU_SIZE - 1) / CMOS_SENSOR_ACQUISITION_JPEG_MCU_SIZE;
+
+    return JPEG_HEADERS_SIZE + mcus_x * mcus_y * JPEG_MCU_CODED_SIZE;
+}
+
+/*
+ * cmos_sensor_acquisition_jpeg_encoder_init
+ *
+ * Initializes an encoder of width x height frames (at most 65535 x 65535) of
+ * pixels of the given cmos_sensor_input output format, each held in the low
+ * bits of a pixel_size-byte little-endian word (see
+ * cmos_sensor_acquisition_jpeg_pixel_size()). pix_depth is the depth of each
+ * channel for OUTPUT_FORMAT_RGB, and is ignored for other formats. quality
+ * ranges from 1 to 100 (75 is a good default).
+ *
+ * The encoder can be used for any number of frames, see
+ * cmos_sensor_acquisition_jpeg_encoder_begin().
+ *
+ * Returns true if the encoder was successfully initialized, and false
+ * otherwise.
+ */
+bool cmos_sensor_acquisition_jpeg_encoder_init(cmos_sensor_acquisition_jpeg_encoder *enc, uint32_t width, uint32_t height, cmos_sensor_input_output_format format, uint8_t pix_depth, size_t pixel_size, uint8_t quality) {
+    memset(enc, 0, sizeof(*enc));
+
+    if (width == 0 || height == 0 || width > 0xffff || height > 0xffff ||
+        pixel_size == 0 || pixel_size > 8 ||
+        quality == 0 || quality > 100) {
+        return false;
+    }
+
+    if (format == OUTPUT_FORMAT_RGB && (pix_depth == 0 || 3 * pix_depth > 8 * pixel_size)) {
+        return false;
+    }
+
+    if (!huffman_tables_built) {
+        build_huffman_tables();
+    }
+
+    enc->width = width;
+    enc->height = height;
+    enc->format = format;
+    enc->pix_depth = pix_depth;
+    enc->pixel_size = pixel_size;
+    enc->padded_width = (width + CMOS_SENSOR_ACQUISITION_JPEG_MCU_SIZE - 1) & ~(CMOS_SENSOR_ACQUISITION_JPEG_MCU_SIZE - 1);
+
+    build_quant_tables(enc, quality);
+
+    enc->planes = (uint8_t *) malloc(3 * (size_t) enc->padded_width * CMOS_SENSOR_ACQUISITION_JPEG_MCU_SIZE);
+    if (enc->planes == NULL) {
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * cmos_sensor_acquisition_jpeg_encoder_begin
+ *
+ * Starts encoding a new frame in out (see cmos_sensor_acquisition_jpeg_bound()
+ * for a size which is always enough), and writes its headers. Each frame is a
+ * complete JPEG file, so consecutive frames form an MJPEG stream.
+ *
+ * Returns true if the headers fit in out, and false otherwise.
+ */
+bool cmos_sensor_acquisition_jpeg_encoder_begin(cmos_sensor_acquisition_jpeg_encoder *enc, void *out, size_t out_size) {
+    enc->out = (uint8_t *) out;
+    enc->out_size = out_size;
+    enc->out_used = 0;
+    enc->bits = 0;
+    enc->bit_count = 0;
+    enc->buffered_lines = 0;
+    enc->lines_done = 0;
+    enc->dc[0] = 0;
+    enc->dc[1] = 0;
+    enc->dc[2] = 0;
+    enc->error = false;
+
+    write_headers(enc);
+
+    return !enc->error;
+}
+
+/*
+ * cmos_sensor_acquisition_jpeg_encoder_push
+ *
+ * Encodes the next lines rows of the frame, pitch_bytes bytes apart (as for
+ * cmos_sensor_acquisition_snapshot_pitched()). Rows are converted as they are
+ * pushed, and each MCU row (16 lines) is encoded as soon as it is complete, so
+ * this can be called from a strip callback of
+ * cmos_sensor_acquisition_snapshot_strips() (with pitch_bytes set to
+ * cmos_sensor_acquisition_strip_size(dev, 1)) to encode the frame while it is
+ * being captured.
+ *
+ * Returns false if more lines than the frame height were pushed, or if the
+ * output buffer is full.
+ */
+bool cmos_sensor_acquisition_jpeg_encoder_push(cmos_sensor_acquisition_jpeg_encoder *enc, const void *rows, size_t pitch_bytes, uint32_t lines) {
+    const uint8_t *row = (const uint8_t *) rows;
+
+    if (enc->error || lines > enc->height - enc->lines_done) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < lines; i++) {
+        convert_row(enc, row + i * pitch_bytes, enc->buffered_lines);
+        enc->buffered_lines++;
+        enc->lines_done++;
+
+        if (enc->buffered_lines == CMOS_SENSOR_ACQUISITION_JPEG_MCU_SIZE) {
+            encode_mcu_row(enc);
+            enc->buffered_lines = 0;
+        }
+    }
+
+    return !enc->error;
+}
+
+/*
+ * cmos_sensor_acquisition_jpeg_encoder_finish
+ *
+ * Encodes the last (partial) MCU row, replicating the last line, and ends the
+ * frame.
+ *
+ * Returns the size of the JPEG file in bytes, or 0 if not all lines were
+ * pushed or if the output buffer was too small.
+ */
+size_t cmos_sensor_acquisition_jpeg_encoder_finish(cmos_sensor_acquisition_jpeg_encoder *enc) {
+    if (enc->error || enc->lines_done != enc->height) {
+        return 0;
+    }
+
+    if (enc->buffered_lines > 0) {
+        size_t plane_size = (size_t) enc->padded_width * CMOS_SENSOR_ACQUISITION_JPEG_MCU_SIZE;
+
+        for (uint32_t c = 0; c < 3; c++) {
+            uint8_t *plane = enc->planes + c * plane_size;
+            const uint8_t *last = plane + (enc->buffered_lines - 1) * enc->padded_width;
+
+            for (uint32_t line = enc->buffered_lines; line < CMOS_SENSOR_ACQUISITION_JPEG_MCU_SIZE; line++) {
+                memcpy(plane + line * enc->padded_width, last, enc->padded_width);
+            }
+        }
+
+        encode_mcu_row(enc);
+        enc->buffered_lines = 0;
+    }
+
+    flush_bits(enc);
+    put_marker(enc, MARKER_EOI, 0);
+
+    return enc->error ? 0 : enc->out_used;
+}
+
+/*
+ * cmos_sensor_acquisition_jpeg_encoder_destroy
+ *
+ * Frees all resources of enc.
+ */
+void cmos_sensor_acquisition_jpeg_encoder_destroy(cmos_sensor_acquisition_jpeg_encoder *enc) {
+    free(enc->planes);
+    enc->planes = NULL;
+}
+
+/*
+ * cmos_sensor_acquisition_jpeg_mjpeg_part_header
+ *
+ * Writes in buffer the header which precedes a jpeg_size-byte frame in a
+ * multipart/x-mixed-replace MJPEG stream (the format browsers display), with
+ * boundary CMOS_SENSOR_ACQUISITION_JPEG_MJPEG_BOUNDARY.
+ *
+ * Returns the length of the header, or 0 if buffer is too small.
+ */
+size_t cmos_sensor_acquisition_jpeg_mjpeg_part_header(char *buffer, size_t buffer_size, size_t jpeg_size) {
+    int length = snprintf(buffer, buffer_size,
+                          "--" CMOS_SENSOR_ACQUISITION_JPEG_MJPEG_BOUNDARY "\r\n"
+                          "Content-Type: image/jpeg\r\n"
+                          "Content-Length: %lu\r\n"
+                          "\r\n",
+                          (unsigned long) jpeg_size);
+
+    if (length < 0 || (size_t) length >= buffer_size) {
+        return 0;
+    }
+
+    return length;
+}
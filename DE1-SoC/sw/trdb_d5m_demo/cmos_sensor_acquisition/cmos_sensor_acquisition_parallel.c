@@ -0,0 +1,940 @@
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include "cmos_sensor_acquisition_parallel.h"
+
+/*
+ * A job splits a frame into tiles (or bands of whole rows), numbered row-major
+ * so that consecutive tiles are neighbours in memory. Each worker starts with
+ * an equal, contiguous range of tiles, which it consumes from the front. A
+ * worker which runs out of tiles steals the back half of another worker's
+ * range, so the load stays balanced when tiles take uneven time (or a core is
+ * busy with something else) while every worker still walks through mostly
+ * contiguous memory. Each range is a single 64-bit word updated with
+ * compare-and-swap, so taking a tile never locks; the lock is only used to
+ * start the helper threads and to wait for them at the end of a job.
+ *
+ * The calling thread is worker 0 and works on the job too. Without threads
+ * (Nios II HAL), the pool has that single worker and runs the tiles in order.
+ *
+ * Every worker has a scratch arena, emptied before each tile. The kernels
+ * below copy a tile and its 1 pixel halo (the neighbours they read, mirrored
+ * or replicated past the frame edges) into the arena, so their inner loops
+ * need no bounds checks and tiles never write to memory another tile reads.
+ */
+
+/* Number of tiles to aim for per worker, so that stealing can even out the load */
+#define TILES_PER_WORKER       (4)
+
+/* Smallest band height worth a task */
+#define MIN_BAND_HEIGHT        (4)
+
+/* Smallest number of packed words worth a task */
+#define MIN_UNPACK_WORDS       (1024)
+
+/* Bayer channel of each plane ((y & 1) * 2 + (x & 1)) for each pattern */
+static const uint8_t channel_at[4][4] = {
+    {BAYER_R, BAYER_G1, BAYER_G2, BAYER_B}, /* RGGB */
+    {BAYER_B, BAYER_G2, BAYER_G1, BAYER_R}, /* BGGR */
+    {BAYER_G1, BAYER_R, BAYER_B, BAYER_G2}, /* GRBG */
+    {BAYER_G2, BAYER_B, BAYER_R, BAYER_G1}  /* GBRG */
+};
+
+/* Context of the unpack kernel */
+typedef struct unpack_context {
+    const uint8_t *packed;
+    uint32_t      pixel_count;
+    uint32_t      pix_bits;
+    uint32_t      word_size;
+    uint32_t      pixels_per_word;
+    uint16_t      *pixels;
+} unpack_context;
+
+/* Context of the demosaic, conv3x3 and statistics kernels */
+typedef struct bayer_context {
+    const uint16_t                        *src;
+    uint32_t                              width;
+    uint32_t                              height;
+    uint8_t                               pix_depth;
+    cmos_sensor_input_debayer_pattern     pattern;
+    uint8_t                               *rgb;
+    uint16_t                              *dst;
+    const cmos_sensor_input_conv3x3       *conv;
+    cmos_sensor_acquisition_frame_stats   *partials;
+} bayer_context;
+
+/* Context of the luma kernel */
+typedef struct luma_context {
+    const uint8_t *rgb;
+    uint32_t      width;
+    uint8_t       *luma;
+} luma_context;
+
+/*******************************************************************************
+ *  Private API
+ ******************************************************************************/
+static size_t round_up(size_t x, size_t alignment);
+static void run_tile(cmos_sensor_acquisition_parallel *pool, cmos_sensor_acquisition_parallel_worker *worker, uint32_t index);
+static void work(cmos_sensor_acquisition_parallel *pool, cmos_sensor_acquisition_parallel_worker *worker);
+#if defined(CMOS_SENSOR_ACQUISITION_PARALLEL_THREADS)
+static uint64_t make_range(uint32_t first, uint32_t end);
+static bool pop_tile(cmos_sensor_acquisition_parallel_worker *worker, uint32_t *index);
+static bool steal_tile(cmos_sensor_acquisition_parallel *pool, cmos_sensor_acquisition_parallel_worker *thief, uint32_t *index);
+static void *worker_thread(void *arg);
+static void stop_threads(cmos_sensor_acquisition_parallel *pool, uint32_t count);
+#endif
+static uint32_t band_height(cmos_sensor_acquisition_parallel *pool, uint32_t height, uint32_t min_height, size_t scratch_row_size);
+static uint16_t *load_padded(const bayer_context *ctx, const cmos_sensor_acquisition_tile *tile, cmos_sensor_acquisition_arena *arena, bool mirror);
+static uint8_t reduce_to_8_bits(uint32_t value, uint8_t pix_depth);
+static void unpack_kernel(const cmos_sensor_acquisition_tile *tile, cmos_sensor_acquisition_arena *arena, void *context);
+static void demosaic_kernel(const cmos_sensor_acquisition_tile *tile, cmos_sensor_acquisition_arena *arena, void *context);
+static void luma_kernel(const cmos_sensor_acquisition_tile *tile, cmos_sensor_acquisition_arena *arena, void *context);
+static void statistics_kernel(const cmos_sensor_acquisition_tile *tile, cmos_sensor_acquisition_arena *arena, void *context);
+static void conv3x3_kernel(const cmos_sensor_acquisition_tile *tile, cmos_sensor_acquisition_arena *arena, void *context);
+
+/*
+ * round_up
+ *
+ * Rounds x up to the next multiple of alignment (which must be a power of 2).
+ */
+static size_t round_up(size_t x, size_t alignment) {
+    return (x + alignment - 1) & ~(alignment - 1);
+}
+
+/*
+ * run_tile
+ *
+ * Runs the job's kernel on one tile.
+ */
+static void run_tile(cmos_sensor_acquisition_parallel *pool, cmos_sensor_acquisition_parallel_worker *worker, uint32_t index) {
+    const cmos_sensor_acquisition_parallel_job *job = pool->job;
+    uint32_t tile_width = job->tile_width == 0 ? job->width : job->tile_width;
+    cmos_sensor_acquisition_tile tile;
+
+    tile.index = index;
+    tile.x0 = (index % pool->tiles_x) * tile_width;
+    tile.y0 = (index / pool->tiles_x) * job->tile_height;
+    tile.x1 = job->width - tile.x0 < tile_width ? job->width : tile.x0 + tile_width;
+    tile.y1 = job->height - tile.y0 < job->tile_height ? job->height : tile.y0 + job->tile_height;
+    tile.in_x0 = tile.x0 < job->halo ? 0 : tile.x0 - job->halo;
+    tile.in_y0 = tile.y0 < job->halo ? 0 : tile.y0 - job->halo;
+    tile.in_x1 = job->width - tile.x1 < job->halo ? job->width : tile.x1 + job->halo;
+    tile.in_y1 = job->height - tile.y1 < job->halo ? job->height : tile.y1 + job->halo;
+    tile.worker = worker->index;
+
+    worker->arena.used = 0;
+    job->kernel(&tile, &worker->arena, job->context);
+    worker->tiles++;
+}
+
+#if defined(CMOS_SENSOR_ACQUISITION_PARALLEL_THREADS)
+/*
+ * make_range
+ *
+ * Packs a range of tiles [first, end) in a 64-bit word.
+ */
+static uint64_t make_range(uint32_t first, uint32_t end) {
+    return (((uint64_t) end) << 32) | first;
+}
+
+/*
+ * pop_tile
+ *
+ * Takes the first tile of a worker's own range.
+ *
+ * Returns false if the range is empty.
+ */
+static bool pop_tile(cmos_sensor_acquisition_parallel_worker *worker, uint32_t *index) {
+    uint64_t range = __atomic_load_n(&worker->range, __ATOMIC_ACQUIRE);
+
+    for (;;) {
+        uint32_t first = (uint32_t) range;
+        uint32_t end = (uint32_t) (range >> 32);
+
+        if (first >= end) {
+            return false;
+        }
+
+        if (__atomic_compare_exchange_n(&worker->range, &range, make_range(first + 1, end), true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            *index = first;
+            return true;
+        }
+    }
+}
+
+/*
+ * steal_tile
+ *
+ * Takes the back half of the first non-empty range of the other workers: runs
+ * its first tile now (returned in index), and makes the rest the thief's own
+ * range. The thief's range is empty when it steals, so no other worker can
+ * be updating it.
+ *
+ * Returns false if there is nothing left to steal.
+ */
+static bool steal_tile(cmos_sensor_acquisition_parallel *pool, cmos_sensor_acquisition_parallel_worker *thief, uint32_t *index) {
+    for (uint32_t i = 1; i < pool->thread_count; i++) {
+        cmos_sensor_acquisition_parallel_worker *victim = &pool->workers[(thief->index + i) % pool->thread_count];
+        uint64_t range = __atomic_load_n(&victim->range, __ATOMIC_ACQUIRE);
+
+        for (;;) {
+            uint32_t first = (uint32_t) range;
+            uint32_t end = (uint32_t) (range >> 32);
+
+            if (first >= end) {
+                break;
+            }
+
+            uint32_t split = end - (end - first + 1) / 2;
+            if (__atomic_compare_exchange_n(&victim->range, &range, make_range(first, split), true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                __atomic_store_n(&thief->range, make_range(split + 1, end), __ATOMIC_RELEASE);
+                thief->steals++;
+                *index = split;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+/*
+ * worker_thread
+ *
+ * Helper thread: works on every posted job until the pool is destroyed.
+ */
+static void *worker_thread(void *arg) {
+    cmos_sensor_acquisition_parallel_worker *worker = arg;
+    cmos_sensor_acquisition_parallel *pool = worker->pool;
+    uint32_t seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stopping && pool->generation == seen) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+
+        if (pool->stopping) {
+            break;
+        }
+
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        work(pool, worker);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->active--;
+        if (pool->active == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+/*
+ * stop_threads
+ *
+ * Stops the helper threads of workers 1 to count - 1.
+ */
+static void stop_threads(cmos_sensor_acquisition_parallel *pool, uint32_t count) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (uint32_t i = 1; i < count; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+}
+#endif
+
+/*
+ * work
+ *
+ * Runs tiles until none is left, own ones first.
+ */
+static void work(cmos_sensor_acquisition_parallel *pool, cmos_sensor_acquisition_parallel_worker *worker) {
+#if defined(CMOS_SENSOR_ACQUISITION_PARALLEL_THREADS)
+    uint32_t index;
+
+    for (;;) {
+        if (pop_tile(worker, &index) || steal_tile(pool, worker, &index)) {
+            run_tile(pool, worker, index);
+        } else {
+            return;
+        }
+    }
+#else
+    for (uint32_t index = 0; index < pool->tile_count; index++) {
+        run_tile(pool, worker, index);
+    }
+#endif
+}
+
+/*
+ * band_height
+ *
+ * Returns the height of the bands of a height-row frame: small enough to give
+ * every worker a few bands, at least min_height rows, and such that a band and
+ * its 2 halo rows of scratch_row_size bytes each fit in a scratch arena (if
+ * scratch_row_size is not 0).
+ *
+ * Returns 0 if not even a 1 row band fits in the arena.
+ */
+static uint32_t band_height(cmos_sensor_acquisition_parallel *pool, uint32_t height, uint32_t min_height, size_t scratch_row_size) {
+    uint32_t bands = pool->thread_count * TILES_PER_WORKER;
+    uint32_t rows = (height + bands - 1) / bands;
+
+    if (rows < min_height) {
+        rows = min_height;
+    }
+
+    if (scratch_row_size != 0) {
+        size_t available = pool->workers[0].arena.size - CMOS_SENSOR_ACQUISITION_PARALLEL_SCRATCH_ALIGNMENT;
+        size_t fit = available / scratch_row_size;
+
+        if (fit < 3) {
+            return 0;
+        }
+        if (rows > fit - 2) {
+            rows = (uint32_t) (fit - 2);
+        }
+    }
+
+    return rows > height ? height : rows;
+}
+
+/*
+ * load_padded
+ *
+ * Copies the rows of a band and its 1 row halo to the arena, with 1 extra
+ * column on both sides. Rows and columns past the frame edges are mirrored
+ * (-1 is 1, which keeps the Bayer phase) or replicated (-1 is 0).
+ *
+ * Returns the copy (rows of width + 2 samples, the band's first row being row
+ * 1), or NULL if it does not fit in the arena.
+ */
+static uint16_t *load_padded(const bayer_context *ctx, const cmos_sensor_acquisition_tile *tile, cmos_sensor_acquisition_arena *arena, bool mirror) {
+    uint32_t width = ctx->width;
+    uint32_t height = ctx->height;
+    size_t padded_width = (size_t) width + 2;
+    uint32_t rows = tile->y1 - tile->y0 + 2;
+
+    uint16_t *padded = cmos_sensor_acquisition_arena_alloc(arena, rows * padded_width * sizeof(uint16_t));
+    if (padded == NULL) {
+        return NULL;
+    }
+
+    for (uint32_t r = 0; r < rows; r++) {
+        int64_t y = (int64_t) tile->y0 + r - 1;
+        uint32_t sy;
+
+        if (y < 0) {
+            sy = mirror ? 1 : 0;
+        } else if (y >= height) {
+            sy = mirror ? height - 2 : height - 1;
+        } else {
+            sy = (uint32_t) y;
+        }
+
+        const uint16_t *src = ctx->src + (size_t) sy * width;
+        uint16_t *row = padded + r * padded_width;
+
+        memcpy(row + 1, src, width * sizeof(uint16_t));
+        row[0] = mirror ? src[1] : src[0];
+        row[width + 1] = mirror ? src[width - 2] : src[width - 1];
+    }
+
+    return padded;
+}
+
+/*
+ * reduce_to_8_bits
+ *
+ * Scales a pix_depth-bit sample to 8 bits, as the color converter does.
+ */
+static uint8_t reduce_to_8_bits(uint32_t value, uint8_t pix_depth) {
+    return (uint8_t) (pix_depth >= 8 ? value >> (pix_depth - 8) : value << (8 - pix_depth));
+}
+
+/*
+ * unpack_kernel
+ *
+ * Unpacks a range of packer output words (the tile's rows). The packer puts
+ * the first pixel of a word in its most significant used bits, and aligns the
+ * pixels of the last, partial, word of a frame on its least significant bit.
+ */
+static void unpack_kernel(const cmos_sensor_acquisition_tile *tile, cmos_sensor_acquisition_arena *arena, void *context) {
+    const unpack_context *ctx = context;
+    uint32_t mask = (1u << ctx->pix_bits) - 1;
+
+    for (uint32_t w = tile->y0; w < tile->y1; w++) {
+        const uint8_t *word = ctx->packed + (size_t) w * ctx->word_size;
+        uint32_t first = w * ctx->pixels_per_word;
+        uint32_t count = ctx->pixel_count - first < ctx->pixels_per_word ? ctx->pixel_count - first : ctx->pixels_per_word;
+
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t bit = (count - 1 - i) * ctx->pix_bits;
+            uint32_t byte = bit / 8;
+            uint32_t value = 0;
+
+            /* pix_bits <= 16, so the sample spans at most 3 bytes */
+            for (uint32_t b = 0; b < 3 && byte + b < ctx->word_size; b++) {
+                value |= ((uint32_t) word[byte + b]) << (8 * b);
+            }
+
+            ctx->pixels[first + i] = (uint16_t) ((value >> (bit % 8)) & mask);
+        }
+    }
+}
+
+/*
+ * demosaic_kernel
+ *
+ * Bilinear demosaicing of a band: the missing channels of a pixel are the
+ * mean of the nearest samples of that channel.
+ */
+static void demosaic_kernel(const cmos_sensor_acquisition_tile *tile, cmos_sensor_acquisition_arena *arena, void *context) {
+    const bayer_context *ctx = context;
+    size_t pw = (size_t) ctx->width + 2;
+
+    const uint16_t *padded = load_padded(ctx, tile, arena, true);
+    if (padded == NULL) {
+        return;
+    }
+
+    for (uint32_t y = tile->y0; y < tile->y1; y++) {
+        const uint16_t *s = padded + (y - tile->y0 + 1) * pw + 1;
+        uint8_t *out = ctx->rgb + ((size_t) y * ctx->width) * 3;
+        const uint8_t *channels = channel_at[ctx->pattern] + ((y & 1) << 1);
+
+        for (uint32_t x = 0; x < ctx->width; x++, s++, out += 3) {
+            uint32_t c = s[0];
+            uint32_t cross = (s[-pw] + s[pw] + s[-1] + s[1] + 2) >> 2;
+            uint32_t diagonal = (s[-pw - 1] + s[-pw + 1] + s[pw - 1] + s[pw + 1] + 2) >> 2;
+            uint32_t horizontal = (s[-1] + s[1] + 1) >> 1;
+            uint32_t vertical = (s[-pw] + s[pw] + 1) >> 1;
+            uint32_t r;
+            uint32_t g;
+            uint32_t b;
+
+            switch (channels[x & 1]) {
+                case BAYER_R:
+                    r = c;
+                    g = cross;
+                    b = diagonal;
+                    break;
+
+                case BAYER_B:
+                    r = diagonal;
+                    g = cross;
+                    b = c;
+                    break;
+
+                case BAYER_G1:
+                    /* red row */
+                    r = horizontal;
+                    g = c;
+                    b = vertical;
+                    break;
+
+                case BAYER_G2:
+                default:
+                    /* blue row */
+                    r = vertical;
+                    g = c;
+                    b = horizontal;
+                    break;
+            }
+
+            out[0] = reduce_to_8_bits(r, ctx->pix_depth);
+            out[1] = reduce_to_8_bits(g, ctx->pix_depth);
+            out[2] = reduce_to_8_bits(b, ctx->pix_depth);
+        }
+    }
+}
+
+/*
+ * luma_kernel
+ *
+ * Converts a band of RGB888 pixels to full-range BT.601 luma.
+ */
+static void luma_kernel(const cmos_sensor_acquisition_tile *tile, cmos_sensor_acquisition_arena *arena, void *context) {
+    const luma_context *ctx = context;
+
+    for (uint32_t y = tile->y0; y < tile->y1; y++) {
+        const uint8_t *rgb = ctx->rgb + ((size_t) y * ctx->width) * 3;
+        uint8_t *luma = ctx->luma + (size_t) y * ctx->width;
+
+        for (uint32_t x = 0; x < ctx->width; x++, rgb += 3) {
+            luma[x] = (uint8_t) ((19595 * rgb[0] + 38470 * rgb[1] + 7471 * rgb[2] + 32768) >> 16);
+        }
+    }
+}
+
+/*
+ * statistics_kernel
+ *
+ * Accumulates the statistics of a band in the worker's partial statistics.
+ */
+static void statistics_kernel(const cmos_sensor_acquisition_tile *tile, cmos_sensor_acquisition_arena *arena, void *context) {
+    const bayer_context *ctx = context;
+    cmos_sensor_acquisition_frame_stats *stats = &ctx->partials[tile->worker];
+
+    for (uint32_t y = tile->y0; y < tile->y1; y++) {
+        const uint16_t *row = ctx->src + (size_t) y * ctx->width;
+        const uint8_t *channels = channel_at[ctx->pattern] + ((y & 1) << 1);
+
+        for (uint32_t x = 0; x < ctx->width; x++) {
+            cmos_sensor_acquisition_channel_stats *channel = &stats->channels[channels[x & 1]];
+            uint16_t value = row[x];
+
+            channel->count++;
+            channel->sum += value;
+            if (value < channel->min) {
+                channel->min = value;
+            }
+            if (value > channel->max) {
+                channel->max = value;
+            }
+            channel->histogram[reduce_to_8_bits(value, ctx->pix_depth)]++;
+        }
+    }
+}
+
+/*
+ * conv3x3_kernel
+ *
+ * Convolves a band, with the arithmetic of
+ * cmos_sensor_input_conv3x3_reference().
+ */
+static void conv3x3_kernel(const cmos_sensor_acquisition_tile *tile, cmos_sensor_acquisition_arena *arena, void *context) {
+    const bayer_context *ctx = context;
+    const cmos_sensor_input_conv3x3 *conv = ctx->conv;
+    int64_t max_value = (((int64_t) 1) << ctx->pix_depth) - 1;
+    size_t pw = (size_t) ctx->width + 2;
+
+    const uint16_t *padded = load_padded(ctx, tile, arena, false);
+    if (padded == NULL) {
+        return;
+    }
+
+    for (uint32_t y = tile->y0; y < tile->y1; y++) {
+        const uint16_t *s = padded + (y - tile->y0 + 1) * pw + 1;
+        uint16_t *dst = ctx->dst + (size_t) y * ctx->width;
+
+        for (uint32_t x = 0; x < ctx->width; x++, s++) {
+            int64_t sum = ((int64_t) conv->coef[0]) * s[-pw - 1] + ((int64_t) conv->coef[1]) * s[-pw] + ((int64_t) conv->coef[2]) * s[-pw + 1] +
+                          ((int64_t) conv->coef[3]) * s[-1]      + ((int64_t) conv->coef[4]) * s[0]   + ((int64_t) conv->coef[5]) * s[1] +
+                          ((int64_t) conv->coef[6]) * s[pw - 1]  + ((int64_t) conv->coef[7]) * s[pw]  + ((int64_t) conv->coef[8]) * s[pw + 1];
+
+            /* arithmetic shift (rounds towards minus infinity) */
+            int64_t value = sum >= 0 ? sum >> conv->shift : -((-sum + (((int64_t) 1) << conv->shift) - 1) >> conv->shift);
+
+            if (conv->abs && value < 0) {
+                value = -value;
+            }
+
+            value += conv->bias;
+
+            if (value < 0) {
+                value = 0;
+            } else if (value > max_value) {
+                value = max_value;
+            }
+
+            dst[x] = (uint16_t) value;
+        }
+    }
+}
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+
+/*
+ * cmos_sensor_acquisition_parallel_init
+ *
+ * Starts a pool of thread_count workers (0 for one per online CPU), the
+ * calling thread being one of them, each with a scratch arena of scratch_size
+ * bytes (0 for CMOS_SENSOR_ACQUISITION_PARALLEL_DEFAULT_SCRATCH). Without
+ * threads, the pool always has a single worker.
+ *
+ * Returns true on success, and false otherwise.
+ */
+bool cmos_sensor_acquisition_parallel_init(cmos_sensor_acquisition_parallel *pool, uint32_t thread_count, size_t scratch_size) {
+    memset(pool, 0, sizeof(*pool));
+
+    if (scratch_size == 0) {
+        scratch_size = CMOS_SENSOR_ACQUISITION_PARALLEL_DEFAULT_SCRATCH;
+    }
+    scratch_size = round_up(scratch_size, CMOS_SENSOR_ACQUISITION_PARALLEL_SCRATCH_ALIGNMENT);
+
+#if defined(CMOS_SENSOR_ACQUISITION_PARALLEL_THREADS)
+    if (thread_count == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = online > 0 ? (uint32_t) online : 1;
+    }
+    if (thread_count > CMOS_SENSOR_ACQUISITION_PARALLEL_MAX_THREADS) {
+        thread_count = CMOS_SENSOR_ACQUISITION_PARALLEL_MAX_THREADS;
+    }
+#else
+    thread_count = 1;
+#endif
+
+    for (uint32_t i = 0; i < thread_count; i++) {
+        cmos_sensor_acquisition_parallel_worker *worker = &pool->workers[i];
+
+        worker->arena.memory = malloc(scratch_size + CMOS_SENSOR_ACQUISITION_PARALLEL_SCRATCH_ALIGNMENT);
+        if (worker->arena.memory == NULL) {
+            cmos_sensor_acquisition_parallel_destroy(pool);
+            return false;
+        }
+        worker->arena.base = (uint8_t *) round_up((size_t) worker->arena.memory, CMOS_SENSOR_ACQUISITION_PARALLEL_SCRATCH_ALIGNMENT);
+        worker->arena.size = scratch_size;
+        worker->index = i;
+        worker->pool = pool;
+    }
+
+#if defined(CMOS_SENSOR_ACQUISITION_PARALLEL_THREADS)
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+        cmos_sensor_acquisition_parallel_destroy(pool);
+        return false;
+    }
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    /* thread_count only counts the workers whose thread is running */
+    pool->thread_count = 1;
+    for (uint32_t i = 1; i < thread_count; i++) {
+        if (pthread_create(&pool->workers[i].thread, NULL, worker_thread, &pool->workers[i]) != 0) {
+            cmos_sensor_acquisition_parallel_destroy(pool);
+            return false;
+        }
+        pool->thread_count++;
+    }
+#else
+    pool->thread_count = 1;
+#endif
+
+    return true;
+}
+
+/*
+ * cmos_sensor_acquisition_parallel_destroy
+ *
+ * Stops the helper threads and frees the scratch arenas.
+ */
+void cmos_sensor_acquisition_parallel_destroy(cmos_sensor_acquisition_parallel *pool) {
+#if defined(CMOS_SENSOR_ACQUISITION_PARALLEL_THREADS)
+    if (pool->thread_count > 0) {
+        stop_threads(pool, pool->thread_count);
+        pthread_cond_destroy(&pool->start);
+        pthread_cond_destroy(&pool->done);
+        pthread_mutex_destroy(&pool->lock);
+    }
+#endif
+
+    for (uint32_t i = 0; i < CMOS_SENSOR_ACQUISITION_PARALLEL_MAX_THREADS; i++) {
+        free(pool->workers[i].arena.memory);
+        pool->workers[i].arena.memory = NULL;
+    }
+
+    pool->thread_count = 0;
+}
+
+/*
+ * cmos_sensor_acquisition_parallel_thread_count
+ *
+ * Returns the number of workers of the pool, the calling thread included.
+ */
+uint32_t cmos_sensor_acquisition_parallel_thread_count(cmos_sensor_acquisition_parallel *pool) {
+    return pool->thread_count;
+}
+
+/*
+ * cmos_sensor_acquisition_parallel_run
+ *
+ * Runs job->kernel on every tile of a job, and returns once all tiles are
+ * done. Tiles run concurrently in any order, so the kernel must only write
+ * to memory of its own tile; it can read the tile's in_* region of the input.
+ * Only one thread may run jobs on a pool at a time.
+ *
+ * Returns true on success, and false if the job is invalid.
+ */
+bool cmos_sensor_acquisition_parallel_run(cmos_sensor_acquisition_parallel *pool, const cmos_sensor_acquisition_parallel_job *job) {
+    if (job->kernel == NULL || job->width == 0 || job->height == 0 || job->tile_height == 0 || pool->thread_count == 0) {
+        return false;
+    }
+
+    uint32_t tile_width = job->tile_width == 0 ? job->width : job->tile_width;
+    uint64_t tiles_x = (job->width + (uint64_t) tile_width - 1) / tile_width;
+    uint64_t tiles_y = (job->height + (uint64_t) job->tile_height - 1) / job->tile_height;
+    if (tiles_x * tiles_y > UINT32_MAX) {
+        return false;
+    }
+
+    pool->job = job;
+    pool->tiles_x = (uint32_t) tiles_x;
+    pool->tile_count = (uint32_t) (tiles_x * tiles_y);
+
+#if defined(CMOS_SENSOR_ACQUISITION_PARALLEL_THREADS)
+    uint32_t helpers = pool->tile_count > 1 ? pool->thread_count - 1 : 0;
+    uint32_t workers = helpers + 1;
+
+    for (uint32_t i = 0; i < pool->thread_count; i++) {
+        uint32_t first = i < workers ? (uint32_t) (((uint64_t) pool->tile_count * i) / workers) : 0;
+        uint32_t end = i < workers ? (uint32_t) (((uint64_t) pool->tile_count * (i + 1)) / workers) : 0;
+        pool->workers[i].range = make_range(first, end);
+    }
+
+    if (helpers > 0) {
+        pthread_mutex_lock(&pool->lock);
+        pool->active = helpers;
+        pool->generation++;
+        pthread_cond_broadcast(&pool->start);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    work(pool, &pool->workers[0]);
+
+    if (helpers > 0) {
+        /* helpers still running their last tile */
+        pthread_mutex_lock(&pool->lock);
+        while (pool->active > 0) {
+            pthread_cond_wait(&pool->done, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+#else
+    work(pool, &pool->workers[0]);
+#endif
+
+    pool->job = NULL;
+
+    return true;
+}
+
+/*
+ * cmos_sensor_acquisition_arena_alloc
+ *
+ * Allocates size bytes in a worker's scratch arena, for use until the end of
+ * the current tile.
+ *
+ * Returns the allocation (aligned on CMOS_SENSOR_ACQUISITION_PARALLEL_SCRATCH_ALIGNMENT
+ * bytes), or NULL if the arena is full.
+ */
+void *cmos_sensor_acquisition_arena_alloc(cmos_sensor_acquisition_arena *arena, size_t size) {
+    size = round_up(size, CMOS_SENSOR_ACQUISITION_PARALLEL_SCRATCH_ALIGNMENT);
+
+    if (size > arena->size - arena->used) {
+        return NULL;
+    }
+
+    void *block = arena->base + arena->used;
+    arena->used += size;
+
+    return block;
+}
+
+/*
+ * cmos_sensor_acquisition_parallel_unpack
+ *
+ * Unpacks pixel_count pix_bits-bit samples (at most 16 bits) packed by the
+ * unit's packer in output_width-bit words (see cmos_sensor_input_frame_size())
+ * into one sample per element of pixels.
+ *
+ * Returns true on success, and false if the arguments are invalid.
+ */
+bool cmos_sensor_acquisition_parallel_unpack(cmos_sensor_acquisition_parallel *pool, const void *packed, uint32_t pixel_count, uint32_t pix_bits, uint32_t output_width, uint16_t *pixels) {
+    if (pix_bits == 0 || pix_bits > 16 || output_width % 8 != 0 || output_width < pix_bits || pixel_count == 0) {
+        return false;
+    }
+
+    unpack_context ctx = {
+        .packed = packed,
+        .pixel_count = pixel_count,
+        .pix_bits = pix_bits,
+        .word_size = output_width / 8,
+        .pixels_per_word = output_width / pix_bits,
+        .pixels = pixels
+    };
+    uint32_t words = (pixel_count + ctx.pixels_per_word - 1) / ctx.pixels_per_word;
+
+    /* one "row" per word */
+    cmos_sensor_acquisition_parallel_job job = {
+        .width = 1,
+        .height = words,
+        .tile_width = 0,
+        .tile_height = band_height(pool, words, MIN_UNPACK_WORDS, 0),
+        .halo = 0,
+        .kernel = unpack_kernel,
+        .context = &ctx
+    };
+
+    return cmos_sensor_acquisition_parallel_run(pool, &job);
+}
+
+/*
+ * cmos_sensor_acquisition_parallel_demosaic
+ *
+ * Bilinear demosaicing of a width x height Bayer frame of pix_depth-bit
+ * samples (one per element) captured with the given pattern, to RGB888 (R
+ * first, 3 bytes per pixel). The frame must be at least 2 x 2 pixels.
+ *
+ * Returns true on success, and false if the arguments are invalid or a band
+ * does not fit in the scratch arenas.
+ */
+bool cmos_sensor_acquisition_parallel_demosaic(cmos_sensor_acquisition_parallel *pool, const uint16_t *bayer, uint32_t width, uint32_t height, uint8_t pix_depth, cmos_sensor_input_debayer_pattern pattern, uint8_t *rgb) {
+    if (width < 2 || height < 2 || pix_depth == 0 || pix_depth > 16) {
+        return false;
+    }
+
+    uint32_t rows = band_height(pool, height, MIN_BAND_HEIGHT, ((size_t) width + 2) * sizeof(uint16_t));
+    if (rows == 0) {
+        return false;
+    }
+
+    bayer_context ctx = {.src = bayer, .width = width, .height = height, .pix_depth = pix_depth, .pattern = pattern, .rgb = rgb};
+    cmos_sensor_acquisition_parallel_job job = {
+        .width = width,
+        .height = height,
+        .tile_width = 0,
+        .tile_height = rows,
+        .halo = 1,
+        .kernel = demosaic_kernel,
+        .context = &ctx
+    };
+
+    return cmos_sensor_acquisition_parallel_run(pool, &job);
+}
+
+/*
+ * cmos_sensor_acquisition_parallel_rgb_to_luma
+ *
+ * Converts a width x height RGB888 frame (R first) to 8-bit full-range BT.601
+ * luma, as the JPEG encoder does.
+ *
+ * Returns true on success, and false if the arguments are invalid.
+ */
+bool cmos_sensor_acquisition_parallel_rgb_to_luma(cmos_sensor_acquisition_parallel *pool, const uint8_t *rgb, uint32_t width, uint32_t height, uint8_t *luma) {
+    luma_context ctx = {.rgb = rgb, .width = width, .luma = luma};
+    cmos_sensor_acquisition_parallel_job job = {
+        .width = width,
+        .height = height,
+        .tile_width = 0,
+        .tile_height = band_height(pool, height, MIN_BAND_HEIGHT, 0),
+        .halo = 0,
+        .kernel = luma_kernel,
+        .context = &ctx
+    };
+
+    return cmos_sensor_acquisition_parallel_run(pool, &job);
+}
+
+/*
+ * cmos_sensor_acquisition_parallel_statistics
+ *
+ * Computes the count, sum, extrema and histogram of each Bayer channel of a
+ * width x height frame of pix_depth-bit samples captured with the given
+ * pattern. Every worker accumulates its bands separately, and the partial
+ * results are merged at the end.
+ *
+ * Returns true on success, and false otherwise.
+ */
+bool cmos_sensor_acquisition_parallel_statistics(cmos_sensor_acquisition_parallel *pool, const uint16_t *bayer, uint32_t width, uint32_t height, uint8_t pix_depth, cmos_sensor_input_debayer_pattern pattern, cmos_sensor_acquisition_frame_stats *stats) {
+    if (pix_depth == 0 || pix_depth > 16) {
+        return false;
+    }
+
+    cmos_sensor_acquisition_frame_stats *partials = calloc(pool->thread_count, sizeof(*partials));
+    if (partials == NULL) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < pool->thread_count; i++) {
+        for (uint32_t c = 0; c < 4; c++) {
+            partials[i].channels[c].min = UINT16_MAX;
+        }
+    }
+
+    bayer_context ctx = {.src = bayer, .width = width, .height = height, .pix_depth = pix_depth, .pattern = pattern, .partials = partials};
+    cmos_sensor_acquisition_parallel_job job = {
+        .width = width,
+        .height = height,
+        .tile_width = 0,
+        .tile_height = band_height(pool, height, MIN_BAND_HEIGHT, 0),
+        .halo = 0,
+        .kernel = statistics_kernel,
+        .context = &ctx
+    };
+
+    bool success = cmos_sensor_acquisition_parallel_run(pool, &job);
+
+    memset(stats, 0, sizeof(*stats));
+    for (uint32_t c = 0; c < 4; c++) {
+        stats->channels[c].min = UINT16_MAX;
+    }
+
+    for (uint32_t i = 0; i < pool->thread_count; i++) {
+        for (uint32_t c = 0; c < 4; c++) {
+            const cmos_sensor_acquisition_channel_stats *partial = &partials[i].channels[c];
+            cmos_sensor_acquisition_channel_stats *channel = &stats->channels[c];
+
+            channel->count += partial->count;
+            channel->sum += partial->sum;
+            if (partial->min < channel->min) {
+                channel->min = partial->min;
+            }
+            if (partial->max > channel->max) {
+                channel->max = partial->max;
+            }
+            for (uint32_t b = 0; b < CMOS_SENSOR_ACQUISITION_PARALLEL_HISTOGRAM_BINS; b++) {
+                channel->histogram[b] += partial->histogram[b];
+            }
+        }
+    }
+
+    free(partials);
+
+    return success;
+}
+
+/*
+ * cmos_sensor_acquisition_parallel_conv3x3
+ *
+ * Multithreaded cmos_sensor_input_conv3x3_reference(), with the same output.
+ *
+ * Returns true on success, and false if the arguments are invalid or a band
+ * does not fit in the scratch arenas.
+ */
+bool cmos_sensor_acquisition_parallel_conv3x3(cmos_sensor_acquisition_parallel *pool, const uint16_t *src, uint16_t *dst, uint32_t width, uint32_t height, uint8_t pix_depth, const cmos_sensor_input_conv3x3 *conv) {
+    if (width == 0 || height == 0 || pix_depth == 0 || pix_depth > 16) {
+        return false;
+    }
+
+    uint32_t rows = band_height(pool, height, MIN_BAND_HEIGHT, ((size_t) width + 2) * sizeof(uint16_t));
+    if (rows == 0) {
+        return false;
+    }
+
+    bayer_context ctx = {.src = src, .width = width, .height = height, .pix_depth = pix_depth, .dst = dst, .conv = conv};
+    cmos_sensor_acquisition_parallel_job job = {
+        .width = width,
+        .height = height,
+        .tile_width = 0,
+        .tile_height = rows,
+        .halo = 1,
+        .kernel = conv3x3_kernel,
+        .context = &ctx
+    };
+
+    return cmos_sensor_acquisition_parallel_run(pool, &job);
+}
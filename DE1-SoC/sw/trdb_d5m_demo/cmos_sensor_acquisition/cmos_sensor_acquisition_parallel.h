@@ -0,0 +1,125 @@
+#ifndef __CMOS_SENSOR_ACQUISITION_PARALLEL_H__
+#define __CMOS_SENSOR_ACQUISITION_PARALLEL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#define CMOS_SENSOR_ACQUISITION_PARALLEL_THREADS
+#endif
+
+#include "cmos_sensor_acquisition.h"
+#include "cmos_sensor_input.h"
+
+/* Maximum number of threads of a pool (the calling thread included) */
+#define CMOS_SENSOR_ACQUISITION_PARALLEL_MAX_THREADS       (64)
+
+/* Default size of each thread's scratch arena */
+#define CMOS_SENSOR_ACQUISITION_PARALLEL_DEFAULT_SCRATCH   (1024 * 1024)
+
+/* Alignment of the scratch allocations */
+#define CMOS_SENSOR_ACQUISITION_PARALLEL_SCRATCH_ALIGNMENT (64)
+
+/* Number of bins of the statistics' histograms (top 8 bits of the samples) */
+#define CMOS_SENSOR_ACQUISITION_PARALLEL_HISTOGRAM_BINS    (256)
+
+/* Region of the frame processed by one task */
+typedef struct cmos_sensor_acquisition_tile {
+    uint32_t index;  /* Tile number, row-major */
+    uint32_t x0;     /* Columns [x0, x1) and rows [y0, y1) to produce */
+    uint32_t y0;
+    uint32_t x1;
+    uint32_t y1;
+    uint32_t in_x0;  /* Same region extended by the halo, clipped to the frame */
+    uint32_t in_y0;
+    uint32_t in_x1;
+    uint32_t in_y1;
+    uint32_t worker; /* Thread running the tile (0 is the calling thread) */
+} cmos_sensor_acquisition_tile;
+
+/* Per-thread bump allocator, emptied before each tile */
+typedef struct cmos_sensor_acquisition_arena {
+    uint8_t *memory; /* Backing allocation */
+    uint8_t *base;   /* Aligned start of the arena */
+    size_t  size;    /* Size of the arena in bytes */
+    size_t  used;    /* Bytes allocated since the start of the tile */
+} cmos_sensor_acquisition_arena;
+
+/* Processes one tile */
+typedef void (*cmos_sensor_acquisition_parallel_kernel)(const cmos_sensor_acquisition_tile *tile, cmos_sensor_acquisition_arena *arena, void *context);
+
+/* Frame processing job */
+typedef struct cmos_sensor_acquisition_parallel_job {
+    uint32_t                               width;       /* Frame width in pixels */
+    uint32_t                               height;      /* Frame height in pixels */
+    uint32_t                               tile_width;  /* Tile width, 0 for whole rows (bands) */
+    uint32_t                               tile_height; /* Tile height */
+    uint32_t                               halo;        /* Pixels around a tile the kernel reads */
+    cmos_sensor_acquisition_parallel_kernel kernel;     /* Tile processing function */
+    void                                   *context;    /* Context of the kernel */
+} cmos_sensor_acquisition_parallel_job;
+
+struct cmos_sensor_acquisition_parallel;
+
+/* Thread of a pool */
+typedef struct cmos_sensor_acquisition_parallel_worker {
+    uint64_t                                range;  /* Tiles left to the worker: first (low 32 bits) to last + 1 (high 32 bits) */
+    cmos_sensor_acquisition_arena           arena;  /* Scratch memory */
+    uint32_t                                index;  /* Worker number (0 is the calling thread) */
+    uint64_t                                tiles;  /* Tiles run so far */
+    uint64_t                                steals; /* Successful steals so far */
+    struct cmos_sensor_acquisition_parallel *pool;  /* Pool of the worker */
+#if defined(CMOS_SENSOR_ACQUISITION_PARALLEL_THREADS)
+    pthread_t                               thread;
+#endif
+} cmos_sensor_acquisition_parallel_worker;
+
+/* Work-stealing thread pool */
+typedef struct cmos_sensor_acquisition_parallel {
+    cmos_sensor_acquisition_parallel_worker    workers[CMOS_SENSOR_ACQUISITION_PARALLEL_MAX_THREADS];
+    uint32_t                                   thread_count; /* Number of workers, the calling thread included */
+    const cmos_sensor_acquisition_parallel_job *job;         /* Job being run */
+    uint32_t                                   tiles_x;      /* Number of tiles per row of tiles */
+    uint32_t                                   tile_count;   /* Number of tiles of the job */
+#if defined(CMOS_SENSOR_ACQUISITION_PARALLEL_THREADS)
+    pthread_mutex_t                            lock;
+    pthread_cond_t                             start;        /* Signaled when a job is posted */
+    pthread_cond_t                             done;         /* Signaled when the last helper leaves a job */
+    uint32_t                                   generation;   /* Number of jobs posted so far */
+    uint32_t                                   active;       /* Helper threads still working on the job */
+    bool                                       stopping;     /* Helper threads must exit */
+#endif
+} cmos_sensor_acquisition_parallel;
+
+/* Statistics of one Bayer channel */
+typedef struct cmos_sensor_acquisition_channel_stats {
+    uint32_t count;                                                      /* Number of samples */
+    uint64_t sum;                                                        /* Sum of the samples */
+    uint16_t min;                                                        /* Smallest sample */
+    uint16_t max;                                                        /* Largest sample */
+    uint32_t histogram[CMOS_SENSOR_ACQUISITION_PARALLEL_HISTOGRAM_BINS]; /* Samples per value of their top 8 bits */
+} cmos_sensor_acquisition_channel_stats;
+
+/* Statistics of a Bayer frame, indexed by cmos_sensor_acquisition_bayer_channel */
+typedef struct cmos_sensor_acquisition_frame_stats {
+    cmos_sensor_acquisition_channel_stats channels[4];
+} cmos_sensor_acquisition_frame_stats;
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+bool cmos_sensor_acquisition_parallel_init(cmos_sensor_acquisition_parallel *pool, uint32_t thread_count, size_t scratch_size);
+void cmos_sensor_acquisition_parallel_destroy(cmos_sensor_acquisition_parallel *pool);
+uint32_t cmos_sensor_acquisition_parallel_thread_count(cmos_sensor_acquisition_parallel *pool);
+bool cmos_sensor_acquisition_parallel_run(cmos_sensor_acquisition_parallel *pool, const cmos_sensor_acquisition_parallel_job *job);
+void *cmos_sensor_acquisition_arena_alloc(cmos_sensor_acquisition_arena *arena, size_t size);
+
+bool cmos_sensor_acquisition_parallel_unpack(cmos_sensor_acquisition_parallel *pool, const void *packed, uint32_t pixel_count, uint32_t pix_bits, uint32_t output_width, uint16_t *pixels);
+bool cmos_sensor_acquisition_parallel_demosaic(cmos_sensor_acquisition_parallel *pool, const uint16_t *bayer, uint32_t width, uint32_t height, uint8_t pix_depth, cmos_sensor_input_debayer_pattern pattern, uint8_t *rgb);
+bool cmos_sensor_acquisition_parallel_rgb_to_luma(cmos_sensor_acquisition_parallel *pool, const uint8_t *rgb, uint32_t width, uint32_t height, uint8_t *luma);
+bool cmos_sensor_acquisition_parallel_statistics(cmos_sensor_acquisition_parallel *pool, const uint16_t *bayer, uint32_t width, uint32_t height, uint8_t pix_depth, cmos_sensor_input_debayer_pattern pattern, cmos_sensor_acquisition_frame_stats *stats);
+bool cmos_sensor_acquisition_parallel_conv3x3(cmos_sensor_acquisition_parallel *pool, const uint16_t *src, uint16_t *dst, uint32_t width, uint32_t height, uint8_t pix_depth, const cmos_sensor_input_conv3x3 *conv);
+
+#endif /* __CMOS_SENSOR_ACQUISITION_PARALLEL_H__ */
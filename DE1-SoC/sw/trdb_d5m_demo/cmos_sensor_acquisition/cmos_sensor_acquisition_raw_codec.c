@@ -0,0 +1,619 @@
+#include <stdlib.h>
+
+#include "cmos_sensor_acquisition_raw_codec.h"
+
+/*
+ * Stream layout (all fields little-endian):
+ *
+ *   header  'C' 'S' 'R' 'C', version (1 byte), pix_depth (1 byte),
+ *           strip_lines (2 bytes), width (4 bytes), height (4 bytes)
+ *   strips  ceil(height / strip_lines) times: payload size in bytes (4 bytes),
+ *           then the payload
+ *
+ * Each strip is coded on its own (the model is reset, and no pixel of another
+ * strip is referenced), so strips can be encoded as soon as they are captured,
+ * and decoded in parallel.
+ */
+#define RAW_CODEC_VERSION (1)
+
+/* the Rice model statistics are halved every RAW_CODEC_RESET_COUNT pixels of a context */
+#define RAW_CODEC_RESET_COUNT (64)
+
+/* model of one context: one per Bayer channel */
+typedef struct raw_codec_context {
+    uint32_t sum;   /* Sum of the mapped residuals */
+    uint32_t count; /* Number of mapped residuals */
+} raw_codec_context;
+
+/* LSB first bit writer */
+typedef struct bit_writer {
+    uint8_t  *next;
+    uint8_t  *end;
+    uint64_t bits;
+    uint32_t count;
+    bool     overflow;
+} bit_writer;
+
+/* LSB first bit reader */
+typedef struct bit_reader {
+    const uint8_t *next;
+    const uint8_t *end;
+    uint64_t      bits;
+    uint32_t      count;
+} bit_reader;
+
+/*******************************************************************************
+ *  Private API
+ ******************************************************************************/
+static void write_le(uint8_t *bytes, uint32_t value, uint32_t size);
+static uint32_t read_le(const uint8_t *bytes, uint32_t size);
+static void reset_contexts(raw_codec_context *contexts, uint8_t pix_depth);
+static uint32_t rice_parameter(const raw_codec_context *context, uint8_t pix_depth);
+static void update_context(raw_codec_context *context, uint32_t u);
+static uint32_t predict(const uint16_t *row, const uint16_t *up, uint32_t x, uint8_t pix_depth);
+static void map_row_residuals(const uint16_t *row, const uint16_t *up, uint16_t *residuals, uint32_t width, uint8_t pix_depth);
+static void bit_writer_put(bit_writer *writer, uint64_t code, uint32_t len);
+static void bit_writer_flush(bit_writer *writer);
+static void bit_reader_refill(bit_reader *reader);
+static bool encode_strip(cmos_sensor_acquisition_raw_encoder *enc, const uint16_t *rows, size_t pitch, uint32_t lines);
+
+/*
+ * write_le
+ *
+ * Writes the size low bytes of value at bytes, least significant byte first.
+ */
+static void write_le(uint8_t *bytes, uint32_t value, uint32_t size) {
+    for (uint32_t i = 0; i < size; i++) {
+        bytes[i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+/*
+ * read_le
+ *
+ * Reads a size-byte value stored least significant byte first at bytes.
+ */
+static uint32_t read_le(const uint8_t *bytes, uint32_t size) {
+    uint32_t value = 0;
+
+    for (uint32_t i = 0; i < size; i++) {
+        value |= ((uint32_t) bytes[i]) << (8 * i);
+    }
+
+    return value;
+}
+
+/*
+ * reset_contexts
+ *
+ * Resets the 4 contexts of a strip, with an initial mean residual of about
+ * 1/64 of the sample range.
+ */
+static void reset_contexts(raw_codec_context *contexts, uint8_t pix_depth) {
+    uint32_t initial_sum = ((1UL << pix_depth) + 32) / 64;
+
+    if (initial_sum < 2) {
+        initial_sum = 2;
+    }
+
+    for (uint32_t i = 0; i < 4; i++) {
+        contexts[i].sum = initial_sum;
+        contexts[i].count = 1;
+    }
+}
+
+/*
+ * rice_parameter
+ *
+ * Returns the smallest k such that count * 2^k >= sum, i.e. the Rice
+ * parameter matching the mean residual of the context.
+ */
+static uint32_t rice_parameter(const raw_codec_context *context, uint8_t pix_depth) {
+    uint32_t k = 0;
+
+    while ((context->count << k) < context->sum && k < pix_depth) {
+        k++;
+    }
+
+    return k;
+}
+
+/*
+ * update_context
+ *
+ * Accounts for the mapped residual u, and halves the statistics regularly so
+ * that the model follows the scene.
+ */
+static void update_context(raw_codec_context *context, uint32_t u) {
+    context->sum += u;
+    context->count++;
+
+    if (context->count == RAW_CODEC_RESET_COUNT) {
+        context->sum >>= 1;
+        context->count >>= 1;
+    }
+}
+
+/*
+ * predict
+ *
+ * Returns the prediction of pixel x of row from the previous pixels of the
+ * same Bayer channel: the median of left, up and (left + up - up left) (the
+ * LOCO-I predictor) if up (the row 2 lines above) is available, the left pixel
+ * otherwise, and mid-range (or up) in the first 2 columns.
+ */
+static uint32_t predict(const uint16_t *row, const uint16_t *up, uint32_t x, uint8_t pix_depth) {
+    if (x < 2) {
+        return (up != NULL) ? up[x] : (1UL << (pix_depth - 1));
+    }
+
+    if (up == NULL) {
+        return row[x - 2];
+    }
+
+    int32_t a = row[x - 2];
+    int32_t b = up[x];
+    int32_t c = up[x - 2];
+    int32_t min_ab = (a < b) ? a : b;
+    int32_t max_ab = (a < b) ? b : a;
+    int32_t gradient = a + b - c;
+
+    return (uint32_t) ((gradient < min_ab) ? min_ab : (gradient > max_ab) ? max_ab : gradient);
+}
+
+/*
+ * map_row_residuals
+ *
+ * Computes the zigzag mapped prediction residual of every pixel of row (see
+ * predict()). The prediction only depends on source pixels, so the main loop
+ * is branch free and left to the compiler's vectorizer.
+ */
+static void map_row_residuals(const uint16_t *row, const uint16_t *up, uint16_t *residuals, uint32_t width, uint8_t pix_depth) {
+    uint32_t pix_mask = (1UL << pix_depth) - 1;
+    uint32_t sign_shift = pix_depth - 1;
+    uint32_t x = 0;
+
+    for (; x < width && x < 2; x++) {
+        uint32_t d = (row[x] - predict(row, up, x, pix_depth)) & pix_mask;
+        residuals[x] = (uint16_t) (((d << 1) ^ (0 - (d >> sign_shift))) & pix_mask);
+    }
+
+    if (up == NULL) {
+        for (; x < width; x++) {
+            uint32_t d = (row[x] - row[x - 2]) & pix_mask;
+            residuals[x] = (uint16_t) (((d << 1) ^ (0 - (d >> sign_shift))) & pix_mask);
+        }
+    } else {
+        for (; x < width; x++) {
+            int32_t a = row[x - 2];
+            int32_t b = up[x];
+            int32_t c = up[x - 2];
+            int32_t min_ab = (a < b) ? a : b;
+            int32_t max_ab = (a < b) ? b : a;
+            int32_t gradient = a + b - c;
+            int32_t pred = (gradient < min_ab) ? min_ab : gradient;
+            pred = (pred > max_ab) ? max_ab : pred;
+
+            uint32_t d = (row[x] - (uint32_t) pred) & pix_mask;
+            residuals[x] = (uint16_t) (((d << 1) ^ (0 - (d >> sign_shift))) & pix_mask);
+        }
+    }
+}
+
+/*
+ * bit_writer_put
+ *
+ * Appends the len (<= 32) low bits of code, and writes out whole 32-bit
+ * words.
+ */
+static void bit_writer_put(bit_writer *writer, uint64_t code, uint32_t len) {
+    writer->bits |= code << writer->count;
+    writer->count += len;
+
+    if (writer->count >= 32) {
+        if (writer->end - writer->next < 4) {
+            writer->overflow = true;
+        } else {
+            write_le(writer->next, (uint32_t) writer->bits, 4);
+            writer->next += 4;
+        }
+
+        writer->bits >>= 32;
+        writer->count -= 32;
+    }
+}
+
+/*
+ * bit_writer_flush
+ *
+ * Writes out the remaining bits, padded with zeros to a whole byte.
+ */
+static void bit_writer_flush(bit_writer *writer) {
+    while (writer->count > 0) {
+        if (writer->next == writer->end) {
+            writer->overflow = true;
+            break;
+        }
+
+        *writer->next++ = (uint8_t) writer->bits;
+        writer->bits >>= 8;
+        writer->count = (writer->count > 8) ? writer->count - 8 : 0;
+    }
+}
+
+/*
+ * bit_reader_refill
+ *
+ * Loads whole bytes until more than 56 bits are available, or the input is
+ * exhausted (the missing bits then read as zeros).
+ */
+static void bit_reader_refill(bit_reader *reader) {
+    while (reader->count <= 56 && reader->next < reader->end) {
+        reader->bits |= ((uint64_t) *reader->next++) << reader->count;
+        reader->count += 8;
+    }
+}
+
+/*
+ * encode_strip
+ *
+ * Appends a strip of lines rows (pitch pixels apart) to the output.
+ */
+static bool encode_strip(cmos_sensor_acquisition_raw_encoder *enc, const uint16_t *rows, size_t pitch, uint32_t lines) {
+    uint8_t pix_depth = enc->info.pix_depth;
+    uint32_t width = enc->info.width;
+    raw_codec_context contexts[4];
+
+    if (enc->out_size - enc->out_used < CMOS_SENSOR_ACQUISITION_RAW_CODEC_STRIP_HEADER_SIZE) {
+        return false;
+    }
+
+    uint8_t *strip_header = enc->out + enc->out_used;
+    bit_writer writer = {strip_header + CMOS_SENSOR_ACQUISITION_RAW_CODEC_STRIP_HEADER_SIZE, enc->out + enc->out_size, 0, 0, false};
+
+    reset_contexts(contexts, pix_depth);
+
+    for (uint32_t y = 0; y < lines; y++) {
+        const uint16_t *row = rows + y * pitch;
+        const uint16_t *up = (y >= 2) ? row - 2 * pitch : NULL;
+        raw_codec_context *row_contexts = contexts + 2 * (y & 1);
+
+        map_row_residuals(row, up, enc->residuals, width, pix_depth);
+
+        for (uint32_t x = 0; x < width; x++) {
+            raw_codec_context *context = row_contexts + (x & 1);
+            uint32_t u = enc->residuals[x];
+            uint32_t k = rice_parameter(context, pix_depth);
+            uint32_t q = u >> k;
+
+            if (q < CMOS_SENSOR_ACQUISITION_RAW_CODEC_ESCAPE_Q) {
+                uint64_t code = ((1ULL << q) - 1) | (((uint64_t) (u & ((1UL << k) - 1))) << (q + 1));
+                bit_writer_put(&writer, code, q + 1 + k);
+            } else {
+                uint64_t code = ((1ULL << CMOS_SENSOR_ACQUISITION_RAW_CODEC_ESCAPE_Q) - 1) | (((uint64_t) u) << CMOS_SENSOR_ACQUISITION_RAW_CODEC_ESCAPE_Q);
+                bit_writer_put(&writer, code, CMOS_SENSOR_ACQUISITION_RAW_CODEC_ESCAPE_Q + pix_depth);
+            }
+
+            update_context(context, u);
+        }
+
+        if (writer.overflow) {
+            return false;
+        }
+    }
+
+    bit_writer_flush(&writer);
+    if (writer.overflow) {
+        return false;
+    }
+
+    uint8_t *payload = strip_header + CMOS_SENSOR_ACQUISITION_RAW_CODEC_STRIP_HEADER_SIZE;
+    write_le(strip_header, (uint32_t) (writer.next - payload), CMOS_SENSOR_ACQUISITION_RAW_CODEC_STRIP_HEADER_SIZE);
+    enc->out_used = writer.next - enc->out;
+
+    return true;
+}
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+/*
+ * cmos_sensor_acquisition_raw_codec_bound
+ *
+ * Returns the size in bytes of the largest compressed frame: every pixel costs
+ * at most an escape code (CMOS_SENSOR_ACQUISITION_RAW_CODEC_ESCAPE_Q +
+ * pix_depth bits), and every strip adds its header and up to 7 bits of
+ * padding.
+ */
+size_t cmos_sensor_acquisition_raw_codec_bound(uint32_t width, uint32_t height, uint8_t pix_depth, uint32_t strip_lines) {
+    if (strip_lines == 0) {
+        return 0;
+    }
+
+    uint64_t max_bits = CMOS_SENSOR_ACQUISITION_RAW_CODEC_ESCAPE_Q + pix_depth;
+    uint64_t full_strips = height / strip_lines;
+    uint64_t last_lines = height % strip_lines;
+    uint64_t size = CMOS_SENSOR_ACQUISITION_RAW_CODEC_HEADER_SIZE;
+
+    size += full_strips * (CMOS_SENSOR_ACQUISITION_RAW_CODEC_STRIP_HEADER_SIZE + ((uint64_t) strip_lines * width * max_bits + 7) / 8);
+
+    if (last_lines != 0) {
+        size += CMOS_SENSOR_ACQUISITION_RAW_CODEC_STRIP_HEADER_SIZE + (last_lines * width * max_bits + 7) / 8;
+    }
+
+    return (size_t) size;
+}
+
+/*
+ * cmos_sensor_acquisition_raw_encoder_init
+ *
+ * Prepares enc to compress a width x height frame of pix_depth-bit samples
+ * (1 to 16, stored in the low bits of uint16_t values) into out, which holds
+ * out_size bytes (see cmos_sensor_acquisition_raw_codec_bound() for the worst
+ * case), and writes the stream header.
+ *
+ * The frame is split into strips of strip_lines lines (the last one may be
+ * shorter), coded independently: a smaller strip_lines lets encoding start
+ * earlier and exposes more parallelism, at the cost of a slightly lower
+ * compression ratio (the model restarts, and the first 2 lines of a strip are
+ * only predicted horizontally). Use an even number of lines so that strips
+ * start on the same Bayer row.
+ *
+ * Returns false if a parameter is out of range, out is too small for the
+ * header, or the scratch row cannot be allocated.
+ */
+bool cmos_sensor_acquisition_raw_encoder_init(cmos_sensor_acquisition_raw_encoder *enc, uint32_t width, uint32_t height, uint8_t pix_depth, uint32_t strip_lines, void *out, size_t out_size) {
+    if (width == 0 || height == 0 || pix_depth == 0 || pix_depth > 16 || strip_lines == 0 || strip_lines > 0xffff) {
+        return false;
+    }
+
+    if (out_size < CMOS_SENSOR_ACQUISITION_RAW_CODEC_HEADER_SIZE) {
+        return false;
+    }
+
+    enc->residuals = (uint16_t *) malloc(width * sizeof(uint16_t));
+    if (enc->residuals == NULL) {
+        return false;
+    }
+
+    enc->info.width = width;
+    enc->info.height = height;
+    enc->info.pix_depth = pix_depth;
+    enc->info.strip_lines = strip_lines;
+    enc->out = (uint8_t *) out;
+    enc->out_size = out_size;
+    enc->lines_done = 0;
+    enc->error = false;
+
+    enc->out[0] = 'C';
+    enc->out[1] = 'S';
+    enc->out[2] = 'R';
+    enc->out[3] = 'C';
+    enc->out[4] = RAW_CODEC_VERSION;
+    enc->out[5] = pix_depth;
+    write_le(enc->out + 6, strip_lines, 2);
+    write_le(enc->out + 8, width, 4);
+    write_le(enc->out + 12, height, 4);
+    enc->out_used = CMOS_SENSOR_ACQUISITION_RAW_CODEC_HEADER_SIZE;
+
+    return true;
+}
+
+/*
+ * cmos_sensor_acquisition_raw_encoder_push
+ *
+ * Compresses the next lines rows of the frame, pitch_bytes bytes apart (as for
+ * cmos_sensor_acquisition_snapshot_pitched()), as soon as they are available
+ * (e.g. from the callback of cmos_sensor_acquisition_snapshot_strips() with a
+ * 16-bit unpacked output). lines must be a multiple of the strip size, except
+ * for the last rows of the frame.
+ *
+ * Returns false if lines or pitch_bytes is not valid, or if the output buffer
+ * is too small (the encoder then ignores all further rows).
+ */
+bool cmos_sensor_acquisition_raw_encoder_push(cmos_sensor_acquisition_raw_encoder *enc, const uint16_t *rows, size_t pitch_bytes, uint32_t lines) {
+    uint32_t remaining = enc->info.height - enc->lines_done;
+    size_t pitch = pitch_bytes / sizeof(uint16_t);
+
+    if (enc->error || lines == 0 || lines > remaining) {
+        return false;
+    }
+
+    if ((pitch_bytes % sizeof(uint16_t)) != 0 || pitch < enc->info.width) {
+        return false;
+    }
+
+    if ((lines % enc->info.strip_lines) != 0 && lines != remaining) {
+        return false;
+    }
+
+    for (uint32_t y = 0; y < lines; y += enc->info.strip_lines) {
+        uint32_t strip_lines = lines - y;
+
+        if (strip_lines > enc->info.strip_lines) {
+            strip_lines = enc->info.strip_lines;
+        }
+
+        if (!encode_strip(enc, rows + y * pitch, pitch, strip_lines)) {
+            enc->error = true;
+            return false;
+        }
+
+        enc->lines_done += strip_lines;
+    }
+
+    return true;
+}
+
+/*
+ * cmos_sensor_acquisition_raw_encoder_finish
+ *
+ * Returns the size in bytes of the compressed frame, or 0 if the output buffer
+ * was too small or not all rows were pushed.
+ */
+size_t cmos_sensor_acquisition_raw_encoder_finish(cmos_sensor_acquisition_raw_encoder *enc) {
+    if (enc->error || enc->lines_done != enc->info.height) {
+        return 0;
+    }
+
+    return enc->out_used;
+}
+
+/*
+ * cmos_sensor_acquisition_raw_encoder_destroy
+ *
+ * Frees the scratch memory of enc. The output buffer is left untouched.
+ */
+void cmos_sensor_acquisition_raw_encoder_destroy(cmos_sensor_acquisition_raw_encoder *enc) {
+    free(enc->residuals);
+    enc->residuals = NULL;
+}
+
+/*
+ * cmos_sensor_acquisition_raw_codec_read_info
+ *
+ * Reads the properties of the compressed frame held in the size bytes at in.
+ *
+ * Returns false if in does not start with a valid stream header.
+ */
+bool cmos_sensor_acquisition_raw_codec_read_info(const void *in, size_t size, cmos_sensor_acquisition_raw_codec_info *info) {
+    const uint8_t *bytes = (const uint8_t *) in;
+
+    if (size < CMOS_SENSOR_ACQUISITION_RAW_CODEC_HEADER_SIZE) {
+        return false;
+    }
+
+    if (bytes[0] != 'C' || bytes[1] != 'S' || bytes[2] != 'R' || bytes[3] != 'C' || bytes[4] != RAW_CODEC_VERSION) {
+        return false;
+    }
+
+    info->pix_depth = bytes[5];
+    info->strip_lines = read_le(bytes + 6, 2);
+    info->width = read_le(bytes + 8, 4);
+    info->height = read_le(bytes + 12, 4);
+
+    return info->pix_depth != 0 && info->pix_depth <= 16 && info->strip_lines != 0 && info->width != 0 && info->height != 0;
+}
+
+/*
+ * cmos_sensor_acquisition_raw_codec_decode_strip
+ *
+ * Decodes the payload of one strip (strip_size bytes at strip, following its
+ * size field) into lines rows, pitch_bytes bytes apart. Strips are
+ * independent, so a multi-core host can hand them to different threads.
+ *
+ * Returns false if pitch_bytes is not valid, or if the payload ends before the
+ * last pixel.
+ */
+bool cmos_sensor_acquisition_raw_codec_decode_strip(const cmos_sensor_acquisition_raw_codec_info *info, const void *strip, size_t strip_size, uint16_t *rows, size_t pitch_bytes, uint32_t lines) {
+    size_t pitch = pitch_bytes / sizeof(uint16_t);
+    uint8_t pix_depth = info->pix_depth;
+    uint32_t pix_mask = (1UL << pix_depth) - 1;
+    raw_codec_context contexts[4];
+    bit_reader reader = {(const uint8_t *) strip, (const uint8_t *) strip + strip_size, 0, 0};
+
+    if ((pitch_bytes % sizeof(uint16_t)) != 0 || pitch < info->width) {
+        return false;
+    }
+
+    reset_contexts(contexts, pix_depth);
+
+    for (uint32_t y = 0; y < lines; y++) {
+        uint16_t *row = rows + y * pitch;
+        const uint16_t *up = (y >= 2) ? row - 2 * pitch : NULL;
+        raw_codec_context *row_contexts = contexts + 2 * (y & 1);
+
+        for (uint32_t x = 0; x < info->width; x++) {
+            raw_codec_context *context = row_contexts + (x & 1);
+            uint32_t k = rice_parameter(context, pix_depth);
+
+            /* the longest code is ESCAPE_Q + 16 = 32 bits */
+            if (reader.count < 32) {
+                bit_reader_refill(&reader);
+            }
+
+            /* number of leading ones of the code, capped at ESCAPE_Q */
+            uint32_t q = __builtin_ctzll(~reader.bits | (1ULL << CMOS_SENSOR_ACQUISITION_RAW_CODEC_ESCAPE_Q));
+            uint32_t len;
+            uint32_t u;
+
+            if (q < CMOS_SENSOR_ACQUISITION_RAW_CODEC_ESCAPE_Q) {
+                len = q + 1 + k;
+                u = ((q << k) | ((uint32_t) (reader.bits >> (q + 1)) & ((1UL << k) - 1))) & pix_mask;
+            } else {
+                len = CMOS_SENSOR_ACQUISITION_RAW_CODEC_ESCAPE_Q + pix_depth;
+                u = (uint32_t) (reader.bits >> CMOS_SENSOR_ACQUISITION_RAW_CODEC_ESCAPE_Q) & pix_mask;
+            }
+
+            if (len > reader.count) {
+                return false;
+            }
+
+            reader.bits >>= len;
+            reader.count -= len;
+
+            update_context(context, u);
+
+            /* inverse zigzag, then the residual is added modulo 2^pix_depth */
+            uint32_t delta = (u >> 1) ^ (0 - (u & 1));
+            row[x] = (uint16_t) ((predict(row, up, x, pix_depth) + delta) & pix_mask);
+        }
+    }
+
+    return true;
+}
+
+/*
+ * cmos_sensor_acquisition_raw_codec_decode
+ *
+ * Decodes the compressed frame held in the size bytes at in into pixels, with
+ * rows pitch_bytes bytes apart (pitch_bytes must be even and hold at least a
+ * row of the frame, see cmos_sensor_acquisition_raw_codec_read_info()).
+ *
+ * Returns false if the stream is not valid or ends before the last pixel, or if
+ * pitch_bytes is not valid.
+ */
+bool cmos_sensor_acquisition_raw_codec_decode(const void *in, size_t size, uint16_t *pixels, size_t pitch_bytes) {
+    cmos_sensor_acquisition_raw_codec_info info;
+    size_t pitch = pitch_bytes / sizeof(uint16_t);
+
+    if (!cmos_sensor_acquisition_raw_codec_read_info(in, size, &info)) {
+        return false;
+    }
+
+    if ((pitch_bytes % sizeof(uint16_t)) != 0 || pitch < info.width) {
+        return false;
+    }
+
+    const uint8_t *bytes = (const uint8_t *) in + CMOS_SENSOR_ACQUISITION_RAW_CODEC_HEADER_SIZE;
+    size_t remaining = size - CMOS_SENSOR_ACQUISITION_RAW_CODEC_HEADER_SIZE;
+
+    for (uint32_t y = 0; y < info.height; y += info.strip_lines) {
+        uint32_t lines = info.height - y;
+
+        if (lines > info.strip_lines) {
+            lines = info.strip_lines;
+        }
+
+        if (remaining < CMOS_SENSOR_ACQUISITION_RAW_CODEC_STRIP_HEADER_SIZE) {
+            return false;
+        }
+
+        size_t strip_size = read_le(bytes, CMOS_SENSOR_ACQUISITION_RAW_CODEC_STRIP_HEADER_SIZE);
+        bytes += CMOS_SENSOR_ACQUISITION_RAW_CODEC_STRIP_HEADER_SIZE;
+        remaining -= CMOS_SENSOR_ACQUISITION_RAW_CODEC_STRIP_HEADER_SIZE;
+
+        if (strip_size > remaining) {
+            return false;
+        }
+
+        if (!cmos_sensor_acquisition_raw_codec_decode_strip(&info, bytes, strip_size, pixels + (size_t) y * pitch, pitch_bytes, lines)) {
+            return false;
+        }
+
+        bytes += strip_size;
+        remaining -= strip_size;
+    }
+
+    return true;
+}
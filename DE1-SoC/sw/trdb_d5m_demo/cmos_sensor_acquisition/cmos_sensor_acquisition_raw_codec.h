@@ -0,0 +1,48 @@
+#ifndef __CMOS_SENSOR_ACQUISITION_RAW_CODEC_H__
+#define __CMOS_SENSOR_ACQUISITION_RAW_CODEC_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Size of the stream header, and of the header of each strip */
+#define CMOS_SENSOR_ACQUISITION_RAW_CODEC_HEADER_SIZE       (16)
+#define CMOS_SENSOR_ACQUISITION_RAW_CODEC_STRIP_HEADER_SIZE (4)
+
+/* Number of leading ones of an escape code */
+#define CMOS_SENSOR_ACQUISITION_RAW_CODEC_ESCAPE_Q          (16)
+
+/* Properties of a compressed frame */
+typedef struct cmos_sensor_acquisition_raw_codec_info {
+    uint32_t width;       /* Frame width in pixels */
+    uint32_t height;      /* Frame height in pixels */
+    uint8_t  pix_depth;   /* Depth of each pixel sample (1 to 16) */
+    uint32_t strip_lines; /* Number of lines per independently coded strip */
+} cmos_sensor_acquisition_raw_codec_info;
+
+/* Streaming encoder */
+typedef struct cmos_sensor_acquisition_raw_encoder {
+    cmos_sensor_acquisition_raw_codec_info info;
+    uint8_t  *out;        /* Output buffer */
+    size_t   out_size;    /* Size of the output buffer in bytes */
+    size_t   out_used;    /* Number of bytes written to the output buffer */
+    uint32_t lines_done;  /* Number of lines encoded so far */
+    uint16_t *residuals;  /* Scratch row of info.width mapped residuals */
+    bool     error;       /* The output buffer was too small */
+} cmos_sensor_acquisition_raw_encoder;
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+size_t cmos_sensor_acquisition_raw_codec_bound(uint32_t width, uint32_t height, uint8_t pix_depth, uint32_t strip_lines);
+
+bool cmos_sensor_acquisition_raw_encoder_init(cmos_sensor_acquisition_raw_encoder *enc, uint32_t width, uint32_t height, uint8_t pix_depth, uint32_t strip_lines, void *out, size_t out_size);
+bool cmos_sensor_acquisition_raw_encoder_push(cmos_sensor_acquisition_raw_encoder *enc, const uint16_t *rows, size_t pitch_bytes, uint32_t lines);
+size_t cmos_sensor_acquisition_raw_encoder_finish(cmos_sensor_acquisition_raw_encoder *enc);
+void cmos_sensor_acquisition_raw_encoder_destroy(cmos_sensor_acquisition_raw_encoder *enc);
+
+bool cmos_sensor_acquisition_raw_codec_read_info(const void *in, size_t size, cmos_sensor_acquisition_raw_codec_info *info);
+bool cmos_sensor_acquisition_raw_codec_decode_strip(const cmos_sensor_acquisition_raw_codec_info *info, const void *strip, size_t strip_size, uint16_t *rows, size_t pitch_bytes, uint32_t lines);
+bool cmos_sensor_acquisition_raw_codec_decode(const void *in, size_t size, uint16_t *pixels, size_t pitch_bytes);
+
+#endif /* __CMOS_SENSOR_ACQUISITION_RAW_CODEC_H__ */
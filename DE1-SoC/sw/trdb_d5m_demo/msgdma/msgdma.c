@@ -852,3 +852,11 @@ int msgdma_extended_descriptor_sync_transfer(msgdma_dev *dev, msgdma_extended_de
 void msgdma_wait_until_idle(msgdma_dev *dev) {
     while (read_busy(dev->csr_base) != 0);
 }
+
+uint32_t msgdma_busy(msgdma_dev *dev) {
+    return read_busy(dev->csr_base);
+}
+
+uint16_t msgdma_write_descriptor_fill_level(msgdma_dev *dev) {
+    return read_csr_write_descriptor_buffer_fill_level(dev->csr_base);
+}
@@ -147,5 +147,7 @@ int msgdma_extended_descriptor_sync_transfer(msgdma_dev *dev, msgdma_extended_de
 
 /* Helper functions */
 void msgdma_wait_until_idle(msgdma_dev *dev);
+uint32_t msgdma_busy(msgdma_dev *dev);
+uint16_t msgdma_write_descriptor_fill_level(msgdma_dev *dev);
 
 #endif /* _MSGDMA_H_ */
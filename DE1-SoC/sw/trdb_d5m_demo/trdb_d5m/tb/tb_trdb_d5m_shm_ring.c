@@ -0,0 +1,206 @@
+/*
+ * tb_trdb_d5m_shm_ring.c
+ *
+ * Host test of the timeouts of trdb_d5m_shm_ring_consumer_read(). Checks that a
+ * read returns at once with timeout_ms = 0 and by its deadline otherwise, both
+ * on an empty ring and when the only frame left to read sits in a slot the
+ * producer took and never gave back (as if it died while filling it). Also
+ * checks that a read without timeout wakes up on the next published frame.
+ *
+ * Build and run from this directory:
+ *
+ *   gcc -std=gnu99 -Wall -pthread -I.. -o tb_trdb_d5m_shm_ring tb_trdb_d5m_shm_ring.c ../trdb_d5m_shm_ring.c -lrt
+ *   ./tb_trdb_d5m_shm_ring
+ *
+ * A read which never returns is caught by a watchdog, which fails the test.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trdb_d5m_shm_ring.h"
+
+#define SLOT_COUNT  (4)
+#define SLOT_SIZE   (1024)
+#define TIMEOUT_MS  (50)
+#define WATCHDOG_S  (10)
+
+/* same value as in trdb_d5m_shm_ring.c */
+#define SLOT_WRITER (0x80000000u)
+
+static trdb_d5m_shm_ring ring;
+static uint32_t failed = 0;
+
+/*
+ * now_ms
+ *
+ * Returns the monotonic time in milliseconds.
+ */
+static uint64_t now_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * publish
+ *
+ * Publishes a frame filled with its sequence number.
+ */
+static bool publish(uint32_t sequence) {
+    uint8_t *slot = trdb_d5m_shm_ring_acquire(&ring);
+    if (slot == NULL) {
+        return false;
+    }
+
+    memset(slot, (int) (sequence & 0xff), SLOT_SIZE);
+
+    trdb_d5m_shm_ring_frame frame = {.size = SLOT_SIZE, .timestamp = sequence, .width = 32, .height = 32};
+    return trdb_d5m_shm_ring_publish(&ring, &frame);
+}
+
+/*
+ * expect_timeout
+ *
+ * Reads with the given timeout, and checks that no frame is returned and that
+ * the call took about timeout_ms milliseconds.
+ */
+static void expect_timeout(const char *name, trdb_d5m_shm_ring_consumer *consumer, int timeout_ms) {
+    const void *data;
+    trdb_d5m_shm_ring_frame frame;
+    uint64_t start = now_ms();
+    bool read = trdb_d5m_shm_ring_consumer_read(consumer, timeout_ms, &data, &frame);
+    uint64_t elapsed = now_ms() - start;
+
+    printf("%s, timeout %d ms: %s after %llu ms\n", name, timeout_ms, read ? "frame" : "no frame", (unsigned long long) elapsed);
+
+    if (read) {
+        fprintf(stderr, "%s: unexpected frame %u\n", name, frame.sequence);
+        failed++;
+    }
+
+    /* generous upper bound, the host may be loaded */
+    if (elapsed + 1 < (uint64_t) timeout_ms || elapsed > (uint64_t) timeout_ms + 500) {
+        fprintf(stderr, "%s: returned after %llu ms instead of %d ms\n", name, (unsigned long long) elapsed, timeout_ms);
+        failed++;
+    }
+}
+
+/*
+ * expect_frame
+ *
+ * Reads with the given timeout, and checks the frame returned.
+ */
+static void expect_frame(const char *name, trdb_d5m_shm_ring_consumer *consumer, int timeout_ms, uint32_t sequence, uint32_t dropped) {
+    const void *data;
+    trdb_d5m_shm_ring_frame frame;
+
+    if (!trdb_d5m_shm_ring_consumer_read(consumer, timeout_ms, &data, &frame)) {
+        fprintf(stderr, "%s: no frame\n", name);
+        failed++;
+        return;
+    }
+
+    printf("%s: frame %u, %u dropped\n", name, frame.sequence, frame.dropped);
+
+    if (frame.sequence != sequence || frame.dropped != dropped || frame.size != SLOT_SIZE) {
+        fprintf(stderr, "%s: got frame %u (%u dropped), expected frame %u (%u dropped)\n", name, frame.sequence, frame.dropped, sequence, dropped);
+        failed++;
+    }
+
+    const uint8_t *bytes = data;
+    for (uint32_t i = 0; i < SLOT_SIZE; i++) {
+        if (bytes[i] != (sequence & 0xff)) {
+            fprintf(stderr, "%s: frame %u corrupted at byte %u\n", name, frame.sequence, i);
+            failed++;
+            break;
+        }
+    }
+
+    trdb_d5m_shm_ring_consumer_done(consumer);
+}
+
+/*
+ * late_publisher
+ *
+ * Publishes frame 2 after a while.
+ */
+static void *late_publisher(void *context) {
+    (void) context;
+
+    usleep(20000);
+    if (!publish(2)) {
+        fprintf(stderr, "late publisher: publish failed\n");
+        failed++;
+    }
+
+    return NULL;
+}
+
+int main(void) {
+    char name[64];
+    trdb_d5m_shm_ring_consumer consumer;
+    pthread_t thread;
+
+    /* a read which spins forever never gets here */
+    alarm(WATCHDOG_S);
+
+    snprintf(name, sizeof(name), "/tb_trdb_d5m_shm_ring_%d", (int) getpid());
+    if (!trdb_d5m_shm_ring_create(&ring, name, SLOT_COUNT, SLOT_SIZE) ||
+        !trdb_d5m_shm_ring_consumer_open(&consumer, &ring)) {
+        fprintf(stderr, "setup failed\n");
+        return EXIT_FAILURE;
+    }
+
+    /* empty ring */
+    expect_timeout("empty ring", &consumer, 0);
+    expect_timeout("empty ring", &consumer, TIMEOUT_MS);
+
+    /* frames 0 and 1, read in order */
+    if (!publish(0) || !publish(1)) {
+        fprintf(stderr, "publish failed\n");
+        return EXIT_FAILURE;
+    }
+    expect_frame("published", &consumer, 0, 0, 0);
+
+    /* the producer takes frame 1's slot back and dies before clearing its
+     * sequence: the slot stays a candidate which cannot be pinned */
+    trdb_d5m_shm_ring_slot *slot = &ring.slots[1];
+    __atomic_or_fetch(&slot->pins, SLOT_WRITER, __ATOMIC_SEQ_CST);
+    expect_timeout("slot held by the producer", &consumer, 0);
+    expect_timeout("slot held by the producer", &consumer, TIMEOUT_MS);
+
+    /* same, once the sequence is cleared: no candidate slot, but the head is
+     * still ahead of the consumer */
+    __atomic_store_n(&slot->published, 0, __ATOMIC_SEQ_CST);
+    expect_timeout("frame overwritten", &consumer, 0);
+    expect_timeout("frame overwritten", &consumer, TIMEOUT_MS);
+
+    /* the producer comes back: frame 1 is lost, frame 2 wakes up a read
+     * without timeout */
+    __atomic_and_fetch(&slot->pins, ~SLOT_WRITER, __ATOMIC_SEQ_CST);
+    if (pthread_create(&thread, NULL, late_publisher, NULL) != 0) {
+        fprintf(stderr, "thread creation failed\n");
+        return EXIT_FAILURE;
+    }
+    expect_frame("late frame", &consumer, -1, 2, 1);
+    pthread_join(thread, NULL);
+
+    trdb_d5m_shm_ring_consumer_close(&consumer);
+    trdb_d5m_shm_ring_close(&ring);
+
+    if (failed != 0) {
+        printf("FAILED\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("PASSED\n");
+    return EXIT_SUCCESS;
+}
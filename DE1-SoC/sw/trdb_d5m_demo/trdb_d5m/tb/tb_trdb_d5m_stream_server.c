@@ -0,0 +1,384 @@
+/*
+ * tb_trdb_d5m_stream_server.c
+ *
+ * Host test of trdb_d5m_stream_server.c over the loopback interface. The
+ * server publishes synthetic frames from trdb_d5m_replay.c to a TCP client and
+ * to a UDP destination, both on 127.0.0.1. Checks every field of the TCP frame
+ * headers and of the RTP and chunk headers of the datagrams, that both
+ * transports deliver the exact bytes of every frame, and that every frame is
+ * released once and only once.
+ *
+ * Build and run from this directory:
+ *
+ *   gcc -std=gnu99 -Wall -Wno-unused-function -ffunction-sections -Wl,--gc-sections -I.. -I../../cmos_sensor_acquisition -I../../cmos_sensor_input -I../../msgdma -I../../i2c -o tb_trdb_d5m_stream_server tb_trdb_d5m_stream_server.c ../trdb_d5m_stream_server.c ../trdb_d5m_replay.c ../trdb_d5m_recording.c ../../cmos_sensor_acquisition/cmos_sensor_acquisition_raw_codec.c
+ *   ./tb_trdb_d5m_stream_server
+ *
+ * The replay only needs the reader side of trdb_d5m_recording.c, the
+ * --gc-sections drop the parts which talk to the camera. A frame which never
+ * arrives is caught by a timeout, and a test which hangs by a watchdog.
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trdb_d5m_replay.h"
+#include "trdb_d5m_stream_server.h"
+
+#define FRAME_COUNT  (8)
+#define FRAME_WIDTH  (40)
+#define FRAME_HEIGHT (30)
+#define PIX_DEPTH    (12)
+#define SEED         (5)
+#define FORMAT       (0x1234)
+
+/* 512 byte chunks, the last chunk of a frame is a partial one */
+#define CHUNK_SIZE   (512)
+#define UDP_PAYLOAD  (TRDB_D5M_STREAM_SERVER_RTP_HEADER_SIZE + TRDB_D5M_STREAM_SERVER_CHUNK_HEADER_SIZE + CHUNK_SIZE)
+
+#define FRAME_SIZE   (FRAME_WIDTH * FRAME_HEIGHT * sizeof(uint16_t))
+#define CHUNK_COUNT  ((FRAME_SIZE + CHUNK_SIZE - 1) / CHUNK_SIZE)
+
+#define TIMEOUT_MS   (2000)
+#define WATCHDOG_S   (10)
+
+/* frames published by the server, released by its callback */
+static uint8_t frames[FRAME_COUNT][FRAME_SIZE];
+static uint32_t releases[FRAME_COUNT];
+
+static uint32_t failed = 0;
+
+/* state of the receiving side */
+typedef struct receiver {
+    int      tcp_fd;
+    int      udp_fd;
+    uint8_t  tcp_buffer[TRDB_D5M_STREAM_SERVER_TCP_HEADER_SIZE + FRAME_SIZE];
+    size_t   tcp_received;                  /* Bytes of the current TCP frame received so far */
+    uint8_t  udp_frame[FRAME_SIZE];         /* Frame reassembled from the datagrams */
+    uint32_t udp_chunks;                    /* Datagrams of the current frame received so far */
+    bool     rtp_started;                   /* rtp_sequence and ssrc are valid */
+    uint16_t rtp_sequence;                  /* Expected RTP sequence number */
+    uint32_t ssrc;                          /* RTP synchronization source of the first datagram */
+} receiver;
+
+/*
+ * now_ms
+ *
+ * Returns the monotonic time in milliseconds.
+ */
+static uint64_t now_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * read_le
+ *
+ * Reads size bytes at bytes, least significant byte first.
+ */
+static uint64_t read_le(const uint8_t *bytes, uint32_t size) {
+    uint64_t value = 0;
+
+    for (uint32_t i = 0; i < size; i++) {
+        value |= ((uint64_t) bytes[i]) << (8 * i);
+    }
+
+    return value;
+}
+
+/*
+ * read_be
+ *
+ * Reads size bytes at bytes, most significant byte first.
+ */
+static uint64_t read_be(const uint8_t *bytes, uint32_t size) {
+    uint64_t value = 0;
+
+    for (uint32_t i = 0; i < size; i++) {
+        value = (value << 8) | bytes[i];
+    }
+
+    return value;
+}
+
+/*
+ * check
+ *
+ * Counts a failed check, and reports it.
+ */
+static void check(bool condition, const char *what, uint32_t sequence, uint64_t got, uint64_t expected) {
+    if (!condition) {
+        fprintf(stderr, "frame %u: %s is %llu, expected %llu\n", sequence, what, (unsigned long long) got, (unsigned long long) expected);
+        failed++;
+    }
+}
+
+/*
+ * release
+ *
+ * Release callback of the server.
+ */
+static void release(void *frame, void *context) {
+    (void) context;
+
+    for (uint32_t i = 0; i < FRAME_COUNT; i++) {
+        if (frame == frames[i]) {
+            releases[i]++;
+            return;
+        }
+    }
+
+    fprintf(stderr, "release of an unknown frame %p\n", frame);
+    failed++;
+}
+
+/*
+ * check_tcp_frame
+ *
+ * Checks the header and payload of a frame received over TCP.
+ */
+static void check_tcp_frame(const receiver *rx, uint32_t sequence, const uint8_t *expected) {
+    const uint8_t *header = rx->tcp_buffer;
+
+    if (memcmp(header, "TD5F", 4) != 0) {
+        fprintf(stderr, "frame %u: bad TCP magic\n", sequence);
+        failed++;
+    }
+
+    check(read_le(header + 4, 4) == TRDB_D5M_STREAM_SERVER_TCP_HEADER_SIZE, "TCP header size", sequence, read_le(header + 4, 4), TRDB_D5M_STREAM_SERVER_TCP_HEADER_SIZE);
+    check(read_le(header + 8, 4) == sequence, "TCP sequence", sequence, read_le(header + 8, 4), sequence);
+    check(read_le(header + 12, 4) == FRAME_SIZE, "TCP payload size", sequence, read_le(header + 12, 4), FRAME_SIZE);
+    check(read_le(header + 16, 8) == sequence, "TCP timestamp", sequence, read_le(header + 16, 8), sequence);
+    check(read_le(header + 24, 2) == FRAME_WIDTH, "TCP width", sequence, read_le(header + 24, 2), FRAME_WIDTH);
+    check(read_le(header + 26, 2) == FRAME_HEIGHT, "TCP height", sequence, read_le(header + 26, 2), FRAME_HEIGHT);
+    check(read_le(header + 28, 2) == FORMAT, "TCP format", sequence, read_le(header + 28, 2), FORMAT);
+    check(read_le(header + 30, 2) == 0, "TCP reserved field", sequence, read_le(header + 30, 2), 0);
+
+    if (memcmp(header + TRDB_D5M_STREAM_SERVER_TCP_HEADER_SIZE, expected, FRAME_SIZE) != 0) {
+        fprintf(stderr, "frame %u: TCP payload differs from the replayed frame\n", sequence);
+        failed++;
+    }
+}
+
+/*
+ * receive_datagram
+ *
+ * Checks the headers of a datagram of frame sequence, and copies its chunk to
+ * the reassembled frame.
+ */
+static void receive_datagram(receiver *rx, const uint8_t *datagram, size_t size, uint32_t sequence) {
+    const uint8_t *rtp = datagram;
+    const uint8_t *chunk = datagram + TRDB_D5M_STREAM_SERVER_RTP_HEADER_SIZE;
+    const uint8_t *payload = chunk + TRDB_D5M_STREAM_SERVER_CHUNK_HEADER_SIZE;
+    uint32_t n = rx->udp_chunks;
+    uint32_t offset = n * CHUNK_SIZE;
+    size_t chunk_size = (n == CHUNK_COUNT - 1) ? FRAME_SIZE - offset : CHUNK_SIZE;
+    bool last = n == CHUNK_COUNT - 1;
+
+    rx->udp_chunks++;
+
+    if (n >= CHUNK_COUNT || size != UDP_PAYLOAD - CHUNK_SIZE + chunk_size) {
+        fprintf(stderr, "frame %u: datagram %u has %zu bytes\n", sequence, n, size);
+        failed++;
+        return;
+    }
+
+    if (!rx->rtp_started) {
+        rx->rtp_started = true;
+        rx->rtp_sequence = (uint16_t) read_be(rtp + 2, 2);
+        rx->ssrc = (uint32_t) read_be(rtp + 8, 4);
+    }
+
+    check(rtp[0] == 0x80, "RTP version byte", sequence, rtp[0], 0x80);
+    check(rtp[1] == (TRDB_D5M_STREAM_SERVER_RTP_PAYLOAD_TYPE | (last ? 0x80 : 0)), "RTP marker and payload type", sequence, rtp[1], TRDB_D5M_STREAM_SERVER_RTP_PAYLOAD_TYPE | (last ? 0x80 : 0));
+    check(read_be(rtp + 2, 2) == rx->rtp_sequence, "RTP sequence", sequence, read_be(rtp + 2, 2), rx->rtp_sequence);
+    check(read_be(rtp + 4, 4) == sequence, "RTP timestamp", sequence, read_be(rtp + 4, 4), sequence);
+    check(read_be(rtp + 8, 4) == rx->ssrc, "RTP SSRC", sequence, read_be(rtp + 8, 4), rx->ssrc);
+    check(read_be(chunk + 0, 4) == sequence, "chunk sequence", sequence, read_be(chunk + 0, 4), sequence);
+    check(read_be(chunk + 4, 4) == FRAME_SIZE, "chunk frame size", sequence, read_be(chunk + 4, 4), FRAME_SIZE);
+    check(read_be(chunk + 8, 4) == offset, "chunk offset", sequence, read_be(chunk + 8, 4), offset);
+    check(read_be(chunk + 12, 2) == FRAME_WIDTH, "chunk width", sequence, read_be(chunk + 12, 2), FRAME_WIDTH);
+    check(read_be(chunk + 14, 2) == FRAME_HEIGHT, "chunk height", sequence, read_be(chunk + 14, 2), FRAME_HEIGHT);
+
+    rx->rtp_sequence++;
+    memcpy(rx->udp_frame + offset, payload, chunk_size);
+}
+
+/*
+ * receive_frame
+ *
+ * Runs the server and receives from both sockets until the whole frame
+ * sequence arrived over TCP and over UDP, then checks it.
+ *
+ * Returns false if the frame did not arrive in time.
+ */
+static bool receive_frame(trdb_d5m_stream_server *server, receiver *rx, uint32_t sequence, const uint8_t *expected) {
+    uint64_t deadline = now_ms() + TIMEOUT_MS;
+    uint8_t datagram[UDP_PAYLOAD + 1];
+
+    rx->tcp_received = 0;
+    rx->udp_chunks = 0;
+
+    while (rx->tcp_received < sizeof(rx->tcp_buffer) || rx->udp_chunks < CHUNK_COUNT) {
+        if (now_ms() > deadline) {
+            fprintf(stderr, "frame %u: timeout with %zu TCP bytes and %u datagrams\n", sequence, rx->tcp_received, rx->udp_chunks);
+            failed++;
+            return false;
+        }
+
+        if (!trdb_d5m_stream_server_poll(server, 1)) {
+            fprintf(stderr, "poll failed\n");
+            failed++;
+            return false;
+        }
+
+        ssize_t received = recv(rx->tcp_fd, rx->tcp_buffer + rx->tcp_received, sizeof(rx->tcp_buffer) - rx->tcp_received, MSG_DONTWAIT);
+        if (received > 0) {
+            rx->tcp_received += (size_t) received;
+        } else if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            fprintf(stderr, "frame %u: TCP connection lost\n", sequence);
+            failed++;
+            return false;
+        }
+
+        for (;;) {
+            received = recv(rx->udp_fd, datagram, sizeof(datagram), MSG_DONTWAIT);
+            if (received < 0) {
+                break;
+            }
+            receive_datagram(rx, datagram, (size_t) received, sequence);
+        }
+    }
+
+    check_tcp_frame(rx, sequence, expected);
+
+    if (memcmp(rx->udp_frame, expected, FRAME_SIZE) != 0) {
+        fprintf(stderr, "frame %u: UDP payload differs from the replayed frame\n", sequence);
+        failed++;
+    }
+
+    return true;
+}
+
+int main(void) {
+    trdb_d5m_stream_server server;
+    trdb_d5m_replay replay;
+    trdb_d5m_replay reference;
+    receiver rx;
+    struct sockaddr_in addr;
+    socklen_t addr_size = sizeof(addr);
+
+    /* a test which blocks forever never gets here */
+    alarm(WATCHDOG_S);
+
+    memset(&rx, 0, sizeof(rx));
+
+    /* two synthetic sources with the same arguments serve identical frames */
+    if (!trdb_d5m_replay_open_synthetic(&replay, FRAME_WIDTH, FRAME_HEIGHT, PIX_DEPTH, GRBG, SEED) ||
+        !trdb_d5m_replay_open_synthetic(&reference, FRAME_WIDTH, FRAME_HEIGHT, PIX_DEPTH, GRBG, SEED) ||
+        trdb_d5m_replay_frame_size(&replay) != FRAME_SIZE) {
+        fprintf(stderr, "replay setup failed\n");
+        return EXIT_FAILURE;
+    }
+
+    if (!trdb_d5m_stream_server_open(&server, "127.0.0.1", 0, release, NULL)) {
+        fprintf(stderr, "server setup failed\n");
+        return EXIT_FAILURE;
+    }
+
+    /* UDP destination on a free port */
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    rx.udp_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (rx.udp_fd < 0 ||
+        bind(rx.udp_fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+        getsockname(rx.udp_fd, (struct sockaddr *) &addr, &addr_size) != 0 ||
+        !trdb_d5m_stream_server_add_udp_destination(&server, "127.0.0.1", ntohs(addr.sin_port), UDP_PAYLOAD)) {
+        fprintf(stderr, "UDP setup failed\n");
+        return EXIT_FAILURE;
+    }
+
+    /* TCP client, accepted by the server's poll */
+    addr.sin_port = htons(trdb_d5m_stream_server_tcp_port(&server));
+    rx.tcp_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (addr.sin_port == 0 || rx.tcp_fd < 0 || connect(rx.tcp_fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "TCP setup failed\n");
+        return EXIT_FAILURE;
+    }
+
+    uint64_t deadline = now_ms() + TIMEOUT_MS;
+    while (trdb_d5m_stream_server_client_count(&server) == 0 && now_ms() < deadline) {
+        trdb_d5m_stream_server_poll(&server, 1);
+    }
+    if (trdb_d5m_stream_server_client_count(&server) != 1) {
+        fprintf(stderr, "client not accepted\n");
+        return EXIT_FAILURE;
+    }
+
+    /* each frame is received in full before the next one is published, so the
+     * client is never busy and skips none */
+    for (uint32_t i = 0; i < FRAME_COUNT; i++) {
+        const void *expected;
+        trdb_d5m_recording_frame metadata;
+
+        if (!trdb_d5m_replay_snapshot(&replay, frames[i], sizeof(frames[i])) ||
+            !trdb_d5m_replay_next_frame(&reference, &expected, &metadata)) {
+            fprintf(stderr, "frame %u: replay failed\n", i);
+            failed++;
+            break;
+        }
+
+        trdb_d5m_stream_frame_info info = {
+            .sequence = metadata.sequence,
+            .timestamp = metadata.timestamp,
+            .width = (uint16_t) metadata.width,
+            .height = (uint16_t) metadata.height,
+            .format = FORMAT
+        };
+
+        if (!trdb_d5m_stream_server_publish(&server, frames[i], sizeof(frames[i]), &info)) {
+            fprintf(stderr, "frame %u: not published\n", i);
+            failed++;
+            break;
+        }
+
+        if (!receive_frame(&server, &rx, i, expected)) {
+            break;
+        }
+
+        printf("frame %u: %zu TCP bytes, %u datagrams\n", i, rx.tcp_received, rx.udp_chunks);
+    }
+
+    /* frames still waiting for their zero-copy completion are released here */
+    trdb_d5m_stream_server_close(&server);
+
+    for (uint32_t i = 0; i < FRAME_COUNT; i++) {
+        if (releases[i] != 1) {
+            fprintf(stderr, "frame %u released %u times\n", i, releases[i]);
+            failed++;
+        }
+    }
+
+    close(rx.tcp_fd);
+    close(rx.udp_fd);
+    trdb_d5m_replay_close(&reference);
+    trdb_d5m_replay_close(&replay);
+
+    if (failed != 0) {
+        printf("FAILED\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("PASSED\n");
+    return EXIT_SUCCESS;
+}
@@ -9,8 +9,18 @@ trdb_d5m_dev trdb_d5m_inst(void     *cmos_sensor_acquisition_cmos_sensor_input_b
                            uint32_t cmos_sensor_acquisition_cmos_sensor_Input_max_height,
                            uint32_t cmos_sensor_acquisition_cmos_sensor_input_output_width,
                            uint32_t cmos_sensor_acquisition_cmos_sensor_input_fifo_depth,
+                           bool     cmos_sensor_acquisition_cmos_sensor_input_downscaler_enable,
+                           bool     cmos_sensor_acquisition_cmos_sensor_input_preview_enable,
+                           bool     cmos_sensor_acquisition_cmos_sensor_input_planar_enable,
+                           bool     cmos_sensor_acquisition_cmos_sensor_input_depth_reducer_enable,
+                           uint8_t  cmos_sensor_acquisition_cmos_sensor_input_reduced_pix_depth,
                            bool     cmos_sensor_acquisition_cmos_sensor_input_debayer_enable,
+                           bool     cmos_sensor_acquisition_cmos_sensor_input_color_converter_enable,
                            bool     cmos_sensor_acquisition_cmos_sensor_input_pack_enable,
+                           uint8_t  cmos_sensor_acquisition_cmos_sensor_input_stage_count,
+                           uint8_t  cmos_sensor_acquisition_cmos_sensor_input_blob_count,
+                           bool     cmos_sensor_acquisition_cmos_sensor_input_sparse_enable,
+                           bool     cmos_sensor_acquisition_cmos_sensor_input_compressor_enable,
                            void     *cmos_sensor_acquisiton_sgdma_csr_base,
                            void     *cmos_sensor_acquisiton_sgdma_descriptor_base,
                            uint32_t cmos_sensor_acquisition_msgdma_descriptor_fifo_depth,
@@ -35,8 +45,18 @@ trdb_d5m_dev trdb_d5m_inst(void     *cmos_sensor_acquisition_cmos_sensor_input_b
                                                                cmos_sensor_acquisition_cmos_sensor_Input_max_height,
                                                                cmos_sensor_acquisition_cmos_sensor_input_output_width,
                                                                cmos_sensor_acquisition_cmos_sensor_input_fifo_depth,
+                                                               cmos_sensor_acquisition_cmos_sensor_input_downscaler_enable,
+                                                               cmos_sensor_acquisition_cmos_sensor_input_preview_enable,
+                                                               cmos_sensor_acquisition_cmos_sensor_input_planar_enable,
+                                                               cmos_sensor_acquisition_cmos_sensor_input_depth_reducer_enable,
+                                                               cmos_sensor_acquisition_cmos_sensor_input_reduced_pix_depth,
                                                                cmos_sensor_acquisition_cmos_sensor_input_debayer_enable,
+                                                               cmos_sensor_acquisition_cmos_sensor_input_color_converter_enable,
                                                                cmos_sensor_acquisition_cmos_sensor_input_pack_enable,
+                                                               cmos_sensor_acquisition_cmos_sensor_input_stage_count,
+                                                               cmos_sensor_acquisition_cmos_sensor_input_blob_count,
+                                                               cmos_sensor_acquisition_cmos_sensor_input_sparse_enable,
+                                                               cmos_sensor_acquisition_cmos_sensor_input_compressor_enable,
                                                                cmos_sensor_acquisiton_sgdma_csr_base,
                                                                cmos_sensor_acquisiton_sgdma_descriptor_base,
                                                                cmos_sensor_acquisition_msgdma_descriptor_fifo_depth,
@@ -134,6 +154,41 @@ bool trdb_d5m_snapshot(trdb_d5m_dev *dev, void *frame, size_t frame_size) {
     return cmos_sensor_acquisition_snapshot(&dev->cmos_sensor_acquisition, frame, frame_size);
 }
 
+/*
+ * trdb_d5m_snapshot_enqueue
+ *
+ * Queues a snapshot which saves a frame in frame, without waiting for it.
+ * Captures queued back to back are taken on consecutive frames (see
+ * cmos_sensor_acquisition_snapshot_enqueue()).
+ *
+ * Returns true if the capture was queued, and false if the camera unit cannot
+ * take another one.
+ */
+bool trdb_d5m_snapshot_enqueue(trdb_d5m_dev *dev, void *frame, size_t frame_size) {
+    return cmos_sensor_acquisition_snapshot_enqueue(&dev->cmos_sensor_acquisition, frame, frame_size);
+}
+
+/*
+ * trdb_d5m_snapshot_pending
+ *
+ * Returns the number of queued captures whose frame has not landed in memory
+ * yet.
+ */
+uint32_t trdb_d5m_snapshot_pending(trdb_d5m_dev *dev) {
+    return cmos_sensor_acquisition_snapshot_pending(&dev->cmos_sensor_acquisition);
+}
+
+/*
+ * trdb_d5m_wait_snapshots
+ *
+ * Waits until every queued capture has completed.
+ *
+ * Returns true if all frames were successfully saved, and false otherwise.
+ */
+bool trdb_d5m_wait_snapshots(trdb_d5m_dev *dev) {
+    return cmos_sensor_acquisition_wait_snapshots(&dev->cmos_sensor_acquisition);
+}
+
 /*
  * trdb_d5m_frame_size
  *
@@ -161,3 +216,78 @@ uint32_t trdb_d5m_frame_width(trdb_d5m_dev *dev) {
 uint32_t trdb_d5m_frame_height(trdb_d5m_dev *dev) {
     return cmos_sensor_acquisition_frame_height(&dev->cmos_sensor_acquisition);
 }
+
+/*
+ * trdb_d5m_snapshot_pitched
+ *
+ * Performs a blocking snapshot operation in which row i of the frame is saved
+ * at (base + i * pitch).
+ *
+ * Returns true if the frame was successfully saved, and false otherwise.
+ */
+bool trdb_d5m_snapshot_pitched(trdb_d5m_dev *dev, void *base, size_t pitch) {
+    return cmos_sensor_acquisition_snapshot_pitched(&dev->cmos_sensor_acquisition, base, pitch);
+}
+
+/*
+ * trdb_d5m_strip_size
+ *
+ * Returns the size in bytes of a strip of the given number of lines of a frame.
+ */
+size_t trdb_d5m_strip_size(trdb_d5m_dev *dev, uint32_t lines) {
+    return cmos_sensor_acquisition_strip_size(&dev->cmos_sensor_acquisition, lines);
+}
+
+/*
+ * trdb_d5m_snapshot_strips
+ *
+ * Performs a blocking snapshot operation in which the frame is saved strip by
+ * strip in a ring of ring_strips buffers of strip_size bytes, and callback is
+ * called as soon as each strip has landed in memory.
+ *
+ * Returns true if the whole frame was successfully saved, and false otherwise.
+ */
+bool trdb_d5m_snapshot_strips(trdb_d5m_dev *dev, void *ring, uint32_t ring_strips, size_t strip_size, cmos_sensor_acquisition_strip_callback callback, void *context) {
+    return cmos_sensor_acquisition_snapshot_strips(&dev->cmos_sensor_acquisition, ring, ring_strips, strip_size, callback, context);
+}
+
+/*
+ * trdb_d5m_snapshot_dual
+ *
+ * Performs a blocking snapshot operation which saves the full resolution frame
+ * and its downscaled preview in 2 separate buffers. Requires the preview msgdma
+ * to have been attached with CMOS_SENSOR_ACQUISITION_ATTACH_PREVIEW_MSGDMA().
+ *
+ * Returns true if both frames were successfully saved, and false otherwise.
+ */
+bool trdb_d5m_snapshot_dual(trdb_d5m_dev *dev, void *frame, size_t frame_size, void *preview, size_t preview_size) {
+    return cmos_sensor_acquisition_snapshot_dual(&dev->cmos_sensor_acquisition, frame, frame_size, preview, preview_size);
+}
+
+/*
+ * trdb_d5m_preview_frame_size
+ *
+ * Returns the total size of a preview frame in bytes outputted by the camera
+ * unit in its current configuration.
+ */
+size_t trdb_d5m_preview_frame_size(trdb_d5m_dev *dev) {
+    return cmos_sensor_acquisition_preview_frame_size(&dev->cmos_sensor_acquisition);
+}
+
+/*
+ * trdb_d5m_preview_frame_width
+ *
+ * Returns the width of a preview frame in pixels.
+ */
+uint32_t trdb_d5m_preview_frame_width(trdb_d5m_dev *dev) {
+    return cmos_sensor_acquisition_preview_frame_width(&dev->cmos_sensor_acquisition);
+}
+
+/*
+ * trdb_d5m_preview_frame_height
+ *
+ * Returns the height of a preview frame in pixels.
+ */
+uint32_t trdb_d5m_preview_frame_height(trdb_d5m_dev *dev) {
+    return cmos_sensor_acquisition_preview_frame_height(&dev->cmos_sensor_acquisition);
+}
@@ -0,0 +1,95 @@
+#ifndef __TRDB_D5M_RECORDING_H__
+#define __TRDB_D5M_RECORDING_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "trdb_d5m.h"
+
+#define TRDB_D5M_RECORDING_VERSION            (1)
+
+/* Default alignment of all writes (the logical block size of most disks) */
+#define TRDB_D5M_RECORDING_DEFAULT_ALIGNMENT  (4096)
+
+/* Size of the staging buffer used to merge small writes */
+#define TRDB_D5M_RECORDING_STAGING_SIZE       (64 * 1024)
+
+/* Size of the file header, of a frame record header, of an index entry and of the footer */
+#define TRDB_D5M_RECORDING_FILE_HEADER_SIZE   (32)
+#define TRDB_D5M_RECORDING_RECORD_HEADER_SIZE (512)
+#define TRDB_D5M_RECORDING_INDEX_ENTRY_SIZE   (24)
+#define TRDB_D5M_RECORDING_FOOTER_SIZE        (32)
+
+/* Maximum number of sensor registers saved with each frame */
+#define TRDB_D5M_RECORDING_MAX_REGISTERS      (64)
+
+/* Encoding of the payload of a frame */
+typedef enum trdb_d5m_recording_payload_format {
+    PAYLOAD_RAW,             /* Frame as written by the msgdma */
+    PAYLOAD_RAW_CODEC,       /* cmos_sensor_acquisition_raw_codec stream */
+    PAYLOAD_HW_COMPRESSED    /* cmos_sensor_input compressor bitstream */
+} trdb_d5m_recording_payload_format;
+
+/* Metadata of a recorded frame */
+typedef struct trdb_d5m_recording_frame {
+    uint32_t   sequence;                                       /* Frame number, from 0 */
+    uint64_t   timestamp;                                      /* Capture time, in ticks of the file's timestamp frequency */
+    trdb_d5m_recording_payload_format payload_format;
+    uint32_t   width;                                          /* Frame width in pixels */
+    uint32_t   height;                                         /* Frame height in pixels */
+    uint8_t    pix_depth;                                      /* Depth of each pixel sample */
+    cmos_sensor_input_debayer_pattern pattern;                 /* Bayer pattern */
+    uint32_t   exposure;                                       /* Shutter width in rows */
+    uint16_t   green_1_gain;
+    uint16_t   blue_gain;
+    uint16_t   red_gain;
+    uint16_t   green_2_gain;
+    uint16_t   global_gain;
+    uint32_t   register_count;                                 /* Number of valid registers entries */
+    uint8_t    register_offsets[TRDB_D5M_RECORDING_MAX_REGISTERS];
+    uint16_t   register_values[TRDB_D5M_RECORDING_MAX_REGISTERS];
+    const void *payload;                                       /* Payload (reader only) */
+    size_t     payload_size;                                   /* Payload size in bytes */
+} trdb_d5m_recording_frame;
+
+/* Recording writer */
+typedef struct trdb_d5m_recording {
+    int      fd;                  /* Output file */
+    uint32_t alignment;           /* Alignment of all writes, in bytes */
+    uint64_t offset;              /* File offset of the first staged byte */
+    void     *memory;             /* Backing allocation of the staging buffer */
+    uint8_t  *staging;            /* Aligned staging buffer */
+    size_t   staging_used;        /* Number of staged bytes */
+    uint64_t timestamp_frequency; /* Timestamp ticks per second */
+    uint32_t sequence;            /* Sequence number of the next frame */
+    uint8_t  *index;              /* Index entries of the recorded frames */
+    uint32_t index_capacity;      /* Number of entries index can hold */
+    uint32_t register_count;      /* Number of registers in the last register snapshot */
+    uint8_t  register_offsets[TRDB_D5M_RECORDING_MAX_REGISTERS];
+    uint16_t register_values[TRDB_D5M_RECORDING_MAX_REGISTERS];
+    bool     error;               /* A write failed, the recording is unusable */
+} trdb_d5m_recording;
+
+/* Recording reader, over the whole file mapped (or loaded) in memory */
+typedef struct trdb_d5m_recording_reader {
+    const uint8_t *data;                /* File contents */
+    size_t        size;                 /* File size in bytes */
+    uint32_t      alignment;            /* Alignment of the records */
+    uint64_t      timestamp_frequency;  /* Timestamp ticks per second */
+    uint32_t      frame_count;          /* Number of frames */
+    const uint8_t *index;               /* Trailing index, or NULL if the recording was not closed */
+} trdb_d5m_recording_reader;
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+bool trdb_d5m_recording_open(trdb_d5m_recording *rec, const char *filename, uint32_t alignment, uint64_t timestamp_frequency);
+bool trdb_d5m_recording_snapshot_registers(trdb_d5m_recording *rec, trdb_d5m_dev *dev);
+bool trdb_d5m_recording_write_frame(trdb_d5m_recording *rec, trdb_d5m_dev *dev, const void *payload, size_t payload_size, trdb_d5m_recording_payload_format format, uint64_t timestamp);
+bool trdb_d5m_recording_close(trdb_d5m_recording *rec);
+
+bool trdb_d5m_recording_reader_open(trdb_d5m_recording_reader *reader, const void *data, size_t size);
+bool trdb_d5m_recording_reader_frame(const trdb_d5m_recording_reader *reader, uint32_t n, trdb_d5m_recording_frame *frame);
+
+#endif /* __TRDB_D5M_RECORDING_H__ */
@@ -0,0 +1,599 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "trdb_d5m_shm_ring.h"
+
+/*
+ * Shared memory layout: the ring header, the consumer table
+ * (TRDB_D5M_SHM_RING_MAX_CONSUMERS entries), the slot table, then the frame
+ * slots, each starting on a TRDB_D5M_SHM_RING_SLOT_ALIGNMENT boundary.
+ *
+ * The producer fills a slot in place and publishes it by bumping head, so
+ * consumers read frames straight from the shared memory. Every slot has a pin
+ * word holding one bit per consumer reading it, and SLOT_WRITER while the
+ * producer fills it. The producer only takes slots without pins (the oldest
+ * one first), and a consumer only pins a slot which is not being filled, so a
+ * frame never changes under a consumer, however late it is. When a consumer
+ * falls behind by more than the ring size, it skips to the oldest frame still
+ * in the ring and is told how many frames it missed. When all slots are
+ * pinned, the producer drops the frame rather than waiting.
+ *
+ * Consumers sleep on head with a futex, and the producer only wakes them up
+ * when one of them is sleeping.
+ */
+#define RING_MAGIC             "TD5MRNG\0"
+#define RING_VERSION           (1)
+
+#define SLOT_WRITER            (0x80000000u)
+
+/* Largest number of slots of a ring */
+#define MAX_SLOT_COUNT         (1024)
+
+/* Longest sleep of a consumer whose candidate slot is being rewritten */
+#define RETRY_MS               (1)
+
+/*******************************************************************************
+ *  Private API
+ ******************************************************************************/
+static size_t round_up(size_t x, size_t alignment);
+static size_t data_offset(uint32_t slot_count);
+static void map_tables(trdb_d5m_shm_ring *ring);
+static uint64_t now_us(void);
+static void wait_for_frame(trdb_d5m_shm_ring *ring, uint32_t head, int timeout_ms);
+static void wake_consumers(trdb_d5m_shm_ring *ring);
+static bool pin_slot(trdb_d5m_shm_ring_slot *slot, uint32_t bit);
+static void unpin_slot(trdb_d5m_shm_ring_slot *slot, uint32_t bit);
+
+/*
+ * round_up
+ *
+ * Rounds x up to the next multiple of alignment (which must be a power of 2).
+ */
+static size_t round_up(size_t x, size_t alignment) {
+    return (x + alignment - 1) & ~(alignment - 1);
+}
+
+/*
+ * data_offset
+ *
+ * Returns the offset of the first frame slot of a ring of slot_count slots.
+ */
+static size_t data_offset(uint32_t slot_count) {
+    size_t tables = sizeof(trdb_d5m_shm_ring_header) +
+                    TRDB_D5M_SHM_RING_MAX_CONSUMERS * sizeof(trdb_d5m_shm_ring_consumer_entry) +
+                    slot_count * sizeof(trdb_d5m_shm_ring_slot);
+
+    return round_up(tables, TRDB_D5M_SHM_RING_SLOT_ALIGNMENT);
+}
+
+/*
+ * map_tables
+ *
+ * Points the ring's tables into its mapped shared memory.
+ */
+static void map_tables(trdb_d5m_shm_ring *ring) {
+    uint8_t *base = (uint8_t *) ring->header;
+
+    ring->consumers = (trdb_d5m_shm_ring_consumer_entry *) (base + sizeof(trdb_d5m_shm_ring_header));
+    ring->slots = (trdb_d5m_shm_ring_slot *) (ring->consumers + TRDB_D5M_SHM_RING_MAX_CONSUMERS);
+    ring->data = base + ring->header->data_offset;
+}
+
+/*
+ * now_us
+ *
+ * Returns the monotonic time in microseconds.
+ */
+static uint64_t now_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+ * wait_for_frame
+ *
+ * Sleeps until head moves away from the given value, or for at most
+ * timeout_ms milliseconds (forever if negative). May return early.
+ */
+static void wait_for_frame(trdb_d5m_shm_ring *ring, uint32_t head, int timeout_ms) {
+    __atomic_add_fetch(&ring->header->waiters, 1, __ATOMIC_SEQ_CST);
+
+#if defined(__linux__)
+    struct timespec ts;
+    struct timespec *timeout = NULL;
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+        timeout = &ts;
+    }
+
+    /* the ring is shared between processes, so no FUTEX_PRIVATE_FLAG */
+    syscall(SYS_futex, &ring->header->head, FUTEX_WAIT, head, timeout, NULL, 0);
+#else
+    /* no futexes: poll every millisecond */
+    if (__atomic_load_n(&ring->header->head, __ATOMIC_SEQ_CST) == head) {
+        usleep(1000);
+    }
+#endif
+
+    __atomic_sub_fetch(&ring->header->waiters, 1, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * wake_consumers
+ *
+ * Wakes up all consumers sleeping on head.
+ */
+static void wake_consumers(trdb_d5m_shm_ring *ring) {
+#if defined(__linux__)
+    if (__atomic_load_n(&ring->header->waiters, __ATOMIC_SEQ_CST) != 0) {
+        syscall(SYS_futex, &ring->header->head, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+#else
+    (void) ring;
+#endif
+}
+
+/*
+ * pin_slot
+ *
+ * Sets a consumer's bit in a slot's pin word, unless the producer is filling
+ * the slot.
+ *
+ * Returns true if the slot was pinned, and false otherwise.
+ */
+static bool pin_slot(trdb_d5m_shm_ring_slot *slot, uint32_t bit) {
+    uint32_t pins = __atomic_load_n(&slot->pins, __ATOMIC_RELAXED);
+
+    do {
+        if (pins & SLOT_WRITER) {
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&slot->pins, &pins, pins | bit, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    return true;
+}
+
+/*
+ * unpin_slot
+ *
+ * Clears a consumer's bit in a slot's pin word.
+ */
+static void unpin_slot(trdb_d5m_shm_ring_slot *slot, uint32_t bit) {
+    __atomic_and_fetch(&slot->pins, ~bit, __ATOMIC_RELEASE);
+}
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+
+/*
+ * trdb_d5m_shm_ring_create
+ *
+ * Creates the shared memory object name (such as "/trdb_d5m_frames", replacing
+ * any previous one) holding slot_count frame slots of slot_size bytes each, and
+ * makes the calling process its producer. There should be at least 2 more
+ * slots than consumers, so that the producer finds a free slot even when every
+ * consumer holds a frame.
+ *
+ * Returns true if the ring was created, and false otherwise.
+ */
+bool trdb_d5m_shm_ring_create(trdb_d5m_shm_ring *ring, const char *name, uint32_t slot_count, uint32_t slot_size) {
+    memset(ring, 0, sizeof(*ring));
+    ring->writing = -1;
+
+    if (slot_count < 2 || slot_count > MAX_SLOT_COUNT || slot_size == 0 ||
+        strlen(name) >= sizeof(ring->name)) {
+        return false;
+    }
+
+    size_t slot_stride = round_up(slot_size, TRDB_D5M_SHM_RING_SLOT_ALIGNMENT);
+    size_t size = data_offset(slot_count) + slot_count * slot_stride;
+    if (slot_stride > UINT32_MAX) {
+        return false;
+    }
+
+    shm_unlink(name);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        return false;
+    }
+
+    if (ftruncate(fd, (off_t) size) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return false;
+    }
+
+    void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        shm_unlink(name);
+        return false;
+    }
+
+    /* ftruncate() zeroed everything: no consumers, no published slots */
+    ring->header = memory;
+    ring->size = size;
+    ring->producer = true;
+    strcpy(ring->name, name);
+
+    trdb_d5m_shm_ring_header *header = ring->header;
+    header->version = RING_VERSION;
+    header->slot_count = slot_count;
+    header->slot_size = slot_size;
+    header->slot_stride = (uint32_t) slot_stride;
+    header->data_offset = data_offset(slot_count);
+    header->size = size;
+    header->producer_pid = (uint32_t) getpid();
+    map_tables(ring);
+
+    /* consumers check the magic last, once everything else is in place */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(header->magic, RING_MAGIC, sizeof(header->magic));
+
+    return true;
+}
+
+/*
+ * trdb_d5m_shm_ring_attach
+ *
+ * Maps the ring created by a producer under the given name, typically to open
+ * consumers on it.
+ *
+ * Returns true if the ring was attached, and false otherwise.
+ */
+bool trdb_d5m_shm_ring_attach(trdb_d5m_shm_ring *ring, const char *name) {
+    struct stat st;
+
+    memset(ring, 0, sizeof(*ring));
+    ring->writing = -1;
+
+    if (strlen(name) >= sizeof(ring->name)) {
+        return false;
+    }
+
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(trdb_d5m_shm_ring_header)) {
+        close(fd);
+        return false;
+    }
+
+    void *memory = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+
+    ring->header = memory;
+    ring->size = (size_t) st.st_size;
+    strcpy(ring->name, name);
+
+    trdb_d5m_shm_ring_header *header = ring->header;
+    bool valid = memcmp(header->magic, RING_MAGIC, sizeof(header->magic)) == 0;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    if (!valid ||
+        header->version != RING_VERSION ||
+        header->size != ring->size ||
+        header->slot_count < 2 || header->slot_count > MAX_SLOT_COUNT ||
+        header->data_offset != data_offset(header->slot_count) ||
+        header->data_offset + (uint64_t) header->slot_count * header->slot_stride > header->size) {
+        munmap(memory, ring->size);
+        ring->header = NULL;
+        return false;
+    }
+
+    map_tables(ring);
+
+    return true;
+}
+
+/*
+ * trdb_d5m_shm_ring_close
+ *
+ * Unmaps the ring. The producer also removes the shared memory object: mapped
+ * rings stay valid until their consumers close them, but no process can attach
+ * anymore.
+ */
+void trdb_d5m_shm_ring_close(trdb_d5m_shm_ring *ring) {
+    if (ring->header == NULL) {
+        return;
+    }
+
+    if (ring->producer) {
+        trdb_d5m_shm_ring_cancel(ring);
+        shm_unlink(ring->name);
+    }
+
+    munmap(ring->header, ring->size);
+    ring->header = NULL;
+}
+
+/*
+ * trdb_d5m_shm_ring_acquire
+ *
+ * Takes the oldest slot no consumer is reading, for the producer to fill the
+ * next frame in place (up to slot_size bytes, the slot is aligned on
+ * TRDB_D5M_SHM_RING_SLOT_ALIGNMENT bytes). The slot's previous frame
+ * disappears from the ring. Consumers which died while holding a frame are
+ * reaped when no slot is free.
+ *
+ * Returns the slot, or NULL if all slots are pinned by consumers (the frame
+ * should be dropped, which is counted as an overrun).
+ */
+void *trdb_d5m_shm_ring_acquire(trdb_d5m_shm_ring *ring) {
+    trdb_d5m_shm_ring_header *header = ring->header;
+    uint32_t slot_count = header->slot_count;
+
+    if (!ring->producer) {
+        return NULL;
+    }
+
+    if (ring->writing >= 0) {
+        return ring->data + (size_t) ring->writing * header->slot_stride;
+    }
+
+    for (uint32_t attempt = 0; attempt < 2; attempt++) {
+        for (uint32_t i = 0; i < slot_count; i++) {
+            uint32_t n = (header->next_slot + i) % slot_count;
+            uint32_t pins = 0;
+
+            if (__atomic_compare_exchange_n(&ring->slots[n].pins, &pins, SLOT_WRITER, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                __atomic_store_n(&ring->slots[n].published, 0, __ATOMIC_RELAXED);
+                header->next_slot = (n + 1) % slot_count;
+                ring->writing = (int32_t) n;
+                return ring->data + (size_t) n * header->slot_stride;
+            }
+        }
+
+        if (trdb_d5m_shm_ring_reap(ring) == 0) {
+            break;
+        }
+    }
+
+    __atomic_add_fetch(&header->overruns, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+/*
+ * trdb_d5m_shm_ring_publish
+ *
+ * Publishes the frame filled in the slot returned by
+ * trdb_d5m_shm_ring_acquire(), and wakes up the consumers waiting for it. The
+ * frame's sequence is assigned by the ring.
+ *
+ * Returns true if the frame was published, and false if no slot was acquired
+ * or the frame does not fit in it.
+ */
+bool trdb_d5m_shm_ring_publish(trdb_d5m_shm_ring *ring, const trdb_d5m_shm_ring_frame *frame) {
+    trdb_d5m_shm_ring_header *header = ring->header;
+
+    if (ring->writing < 0 || frame->size > header->slot_size) {
+        return false;
+    }
+
+    trdb_d5m_shm_ring_slot *slot = &ring->slots[ring->writing];
+    uint32_t sequence = header->head;
+
+    slot->frame = *frame;
+    slot->frame.sequence = sequence;
+    slot->frame.dropped = 0;
+
+    __atomic_store_n(&slot->published, sequence + 1, __ATOMIC_RELEASE);
+    __atomic_and_fetch(&slot->pins, ~SLOT_WRITER, __ATOMIC_RELEASE);
+    ring->writing = -1;
+
+    __atomic_store_n(&header->head, sequence + 1, __ATOMIC_SEQ_CST);
+    wake_consumers(ring);
+
+    return true;
+}
+
+/*
+ * trdb_d5m_shm_ring_cancel
+ *
+ * Gives back the slot returned by trdb_d5m_shm_ring_acquire() without
+ * publishing anything, for instance after a failed capture.
+ */
+void trdb_d5m_shm_ring_cancel(trdb_d5m_shm_ring *ring) {
+    if (ring->writing < 0) {
+        return;
+    }
+
+    __atomic_and_fetch(&ring->slots[ring->writing].pins, ~SLOT_WRITER, __ATOMIC_RELEASE);
+    ring->writing = -1;
+}
+
+/*
+ * trdb_d5m_shm_ring_reap
+ *
+ * Unregisters the consumers whose process exited without closing them, and
+ * drops their pins.
+ *
+ * Returns the number of consumers reaped.
+ */
+uint32_t trdb_d5m_shm_ring_reap(trdb_d5m_shm_ring *ring) {
+    uint32_t reaped = 0;
+
+    for (uint32_t i = 0; i < TRDB_D5M_SHM_RING_MAX_CONSUMERS; i++) {
+        uint32_t pid = __atomic_load_n(&ring->consumers[i].pid, __ATOMIC_ACQUIRE);
+
+        if (pid == 0 || kill((pid_t) pid, 0) == 0 || errno != ESRCH) {
+            continue;
+        }
+
+        for (uint32_t n = 0; n < ring->header->slot_count; n++) {
+            unpin_slot(&ring->slots[n], 1u << i);
+        }
+
+        /* another process may have reaped it in the meantime */
+        if (__atomic_compare_exchange_n(&ring->consumers[i].pid, &pid, 0, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            reaped++;
+        }
+    }
+
+    return reaped;
+}
+
+/*
+ * trdb_d5m_shm_ring_consumer_open
+ *
+ * Registers a consumer on a ring. The consumer starts with the next published
+ * frame.
+ *
+ * Returns true if the consumer was registered, and false if the consumer table
+ * is full.
+ */
+bool trdb_d5m_shm_ring_consumer_open(trdb_d5m_shm_ring_consumer *consumer, trdb_d5m_shm_ring *ring) {
+    uint32_t pid = (uint32_t) getpid();
+
+    for (uint32_t i = 0; i < TRDB_D5M_SHM_RING_MAX_CONSUMERS; i++) {
+        trdb_d5m_shm_ring_consumer_entry *entry = &ring->consumers[i];
+        uint32_t free_pid = 0;
+
+        if (__atomic_compare_exchange_n(&entry->pid, &free_pid, pid, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&entry->cursor, __atomic_load_n(&ring->header->head, __ATOMIC_ACQUIRE), __ATOMIC_RELAXED);
+            __atomic_store_n(&entry->dropped, 0, __ATOMIC_RELAXED);
+
+            consumer->ring = ring;
+            consumer->index = i;
+            consumer->slot = -1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * trdb_d5m_shm_ring_consumer_read
+ *
+ * Gets the consumer's next frame, waiting up to timeout_ms milliseconds (0 to
+ * return immediately, -1 to wait indefinitely) for it to be published. The
+ * frame is read in place and stays valid until
+ * trdb_d5m_shm_ring_consumer_done(), which must be called before the next
+ * read. A consumer which fell behind gets the oldest frame still in the ring,
+ * and frame->dropped tells how many it missed.
+ *
+ * The deadline also bounds the retries when the producer is rewriting the slot
+ * of the frame found, so the call returns even if the producer died while
+ * holding it.
+ *
+ * Returns true if a frame was read, and false on timeout.
+ */
+bool trdb_d5m_shm_ring_consumer_read(trdb_d5m_shm_ring_consumer *consumer, int timeout_ms, const void **data, trdb_d5m_shm_ring_frame *frame) {
+    trdb_d5m_shm_ring *ring = consumer->ring;
+    trdb_d5m_shm_ring_consumer_entry *entry = &ring->consumers[consumer->index];
+    uint32_t slot_count = ring->header->slot_count;
+    uint32_t bit = 1u << consumer->index;
+    uint64_t deadline = timeout_ms > 0 ? now_us() + (uint64_t) timeout_ms * 1000 : 0;
+
+    trdb_d5m_shm_ring_consumer_done(consumer);
+
+    uint32_t cursor = __atomic_load_n(&entry->cursor, __ATOMIC_RELAXED);
+
+    for (;;) {
+        uint32_t head = __atomic_load_n(&ring->header->head, __ATOMIC_ACQUIRE);
+
+        if (head != cursor) {
+            /* oldest frame not older than the cursor */
+            int32_t best = -1;
+            uint32_t best_distance = 0;
+            for (uint32_t n = 0; n < slot_count; n++) {
+                uint32_t published = __atomic_load_n(&ring->slots[n].published, __ATOMIC_ACQUIRE);
+                uint32_t distance = published - 1 - cursor;
+
+                if (published == 0 || distance >= head - cursor) {
+                    continue;
+                }
+                if (best < 0 || distance < best_distance) {
+                    best = (int32_t) n;
+                    best_distance = distance;
+                }
+            }
+
+            /* the producer may be overwriting it: if so, look again below */
+            if (best >= 0 && pin_slot(&ring->slots[best], bit)) {
+                trdb_d5m_shm_ring_slot *slot = &ring->slots[best];
+
+                if (__atomic_load_n(&slot->published, __ATOMIC_ACQUIRE) == cursor + best_distance + 1) {
+                    *frame = slot->frame;
+                    frame->dropped = best_distance;
+                    *data = ring->data + (size_t) best * ring->header->slot_stride;
+
+                    consumer->slot = best;
+                    __atomic_store_n(&entry->cursor, cursor + best_distance + 1, __ATOMIC_RELAXED);
+                    __atomic_add_fetch(&entry->dropped, best_distance, __ATOMIC_RELAXED);
+
+                    return true;
+                }
+
+                unpin_slot(slot, bit);
+            }
+        }
+
+        int remaining_ms = timeout_ms;
+
+        if (timeout_ms == 0) {
+            return false;
+        }
+        if (timeout_ms > 0) {
+            uint64_t now = now_us();
+            if (now >= deadline) {
+                return false;
+            }
+            remaining_ms = (int) ((deadline - now + 999) / 1000);
+        }
+
+        /* a slot being rewritten is given up by its producer without moving
+         * head (or never, if the producer died), so only sleep a little */
+        if (head != cursor && (remaining_ms < 0 || remaining_ms > RETRY_MS)) {
+            remaining_ms = RETRY_MS;
+        }
+
+        wait_for_frame(ring, head, remaining_ms);
+    }
+}
+
+/*
+ * trdb_d5m_shm_ring_consumer_done
+ *
+ * Lets the producer reuse the slot of the last frame read.
+ */
+void trdb_d5m_shm_ring_consumer_done(trdb_d5m_shm_ring_consumer *consumer) {
+    if (consumer->slot < 0) {
+        return;
+    }
+
+    unpin_slot(&consumer->ring->slots[consumer->slot], 1u << consumer->index);
+    consumer->slot = -1;
+}
+
+/*
+ * trdb_d5m_shm_ring_consumer_close
+ *
+ * Unregisters a consumer.
+ */
+void trdb_d5m_shm_ring_consumer_close(trdb_d5m_shm_ring_consumer *consumer) {
+    trdb_d5m_shm_ring_consumer_done(consumer);
+    __atomic_store_n(&consumer->ring->consumers[consumer->index].pid, 0, __ATOMIC_RELEASE);
+}
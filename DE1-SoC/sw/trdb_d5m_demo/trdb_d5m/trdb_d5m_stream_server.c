@@ -0,0 +1,836 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* sendmmsg() */
+#endif
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/errqueue.h>
+#endif
+
+#include "trdb_d5m_stream_server.h"
+
+/*
+ * Wire formats (multi-byte TCP fields are little-endian like the recording
+ * format, multi-byte UDP fields are big-endian like the RTP header):
+ *
+ *   TCP   every frame is preceded by a 32 byte header: magic "TD5F", header
+ *         size (4 bytes), sequence (4 bytes), payload size (4 bytes),
+ *         timestamp (8 bytes), width (2 bytes), height (2 bytes), format (2
+ *         bytes), reserved (2 bytes)
+ *   UDP   every datagram is a 12 byte RTP header (version 2, marker set on the
+ *         last datagram of a frame, payload type 96, timestamp = low 32 bits
+ *         of the frame timestamp), a 16 byte chunk header: sequence (4 bytes),
+ *         frame size (4 bytes), offset of the chunk in the frame (4 bytes),
+ *         width (2 bytes), height (2 bytes), then the chunk itself
+ *
+ * TCP clients always receive whole frames. A client which is still busy with
+ * an earlier frame when a new one is published skips the new one, so a slow
+ * client never holds back the publisher nor the other clients. UDP datagrams
+ * which do not fit in the socket's send buffer are dropped with the rest of
+ * their frame.
+ */
+#define FRAME_MAGIC            "TD5F"
+
+#define RTP_VERSION            (0x80)
+#define RTP_MARKER             (0x80)
+
+/* Maximum number of datagrams handed to the kernel at once */
+#define UDP_BATCH_SIZE         (32)
+
+/* Largest UDP payload over IPv4 */
+#define UDP_MAX_PAYLOAD        (65507)
+
+#define UDP_HEADERS_SIZE       (TRDB_D5M_STREAM_SERVER_RTP_HEADER_SIZE + TRDB_D5M_STREAM_SERVER_CHUNK_HEADER_SIZE)
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL           (0)
+#endif
+
+/*******************************************************************************
+ *  Private API
+ ******************************************************************************/
+static void write_le(uint8_t *bytes, uint64_t value, uint32_t size);
+static void write_be(uint8_t *bytes, uint64_t value, uint32_t size);
+static bool set_nonblocking(int fd);
+static bool parse_address(const char *address, uint16_t port, struct sockaddr_in *addr);
+static void unref_slot(trdb_d5m_stream_server *server, uint32_t slot);
+static void accept_clients(trdb_d5m_stream_server *server);
+static void disconnect_client(trdb_d5m_stream_server *server, trdb_d5m_stream_client *client);
+static void reap_completions(trdb_d5m_stream_server *server, trdb_d5m_stream_client *client);
+static bool read_completions(trdb_d5m_stream_server *server, trdb_d5m_stream_client *client);
+static void finish_frame(trdb_d5m_stream_server *server, trdb_d5m_stream_client *client);
+static bool send_client(trdb_d5m_stream_server *server, trdb_d5m_stream_client *client);
+static bool drain_client(trdb_d5m_stream_client *client);
+static bool send_datagrams(trdb_d5m_stream_server *server, const struct sockaddr_in *destination, struct iovec (*iov)[3], uint32_t count);
+static void send_udp(trdb_d5m_stream_server *server, const trdb_d5m_stream_slot *slot, const trdb_d5m_stream_frame_info *info);
+
+/*
+ * write_le
+ *
+ * Writes the size low bytes of value at bytes, least significant byte first.
+ */
+static void write_le(uint8_t *bytes, uint64_t value, uint32_t size) {
+    for (uint32_t i = 0; i < size; i++) {
+        bytes[i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+/*
+ * write_be
+ *
+ * Writes the size low bytes of value at bytes, most significant byte first.
+ */
+static void write_be(uint8_t *bytes, uint64_t value, uint32_t size) {
+    for (uint32_t i = 0; i < size; i++) {
+        bytes[size - 1 - i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+/*
+ * set_nonblocking
+ *
+ * Puts a socket in non-blocking mode.
+ */
+static bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+/*
+ * parse_address
+ *
+ * Fills addr with a dotted IPv4 address (NULL for any address) and a port.
+ */
+static bool parse_address(const char *address, uint16_t port, struct sockaddr_in *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(port);
+
+    if (address == NULL) {
+        addr->sin_addr.s_addr = htonl(INADDR_ANY);
+        return true;
+    }
+
+    return inet_pton(AF_INET, address, &addr->sin_addr) == 1;
+}
+
+/*
+ * unref_slot
+ *
+ * Drops one reference to a slot, and releases its frame with the last one.
+ */
+static void unref_slot(trdb_d5m_stream_server *server, uint32_t slot) {
+    trdb_d5m_stream_slot *s = &server->slots[slot];
+
+    s->refs--;
+    if (s->refs == 0) {
+        if (server->release != NULL) {
+            server->release(s->frame, server->context);
+        }
+        s->frame = NULL;
+        s->size = 0;
+    }
+}
+
+/*
+ * accept_clients
+ *
+ * Accepts all pending connections. Connections beyond the maximum number of
+ * clients are closed right away.
+ */
+static void accept_clients(trdb_d5m_stream_server *server) {
+    for (;;) {
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            /* EAGAIN once the backlog is empty, other errors are per connection */
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return;
+        }
+
+        trdb_d5m_stream_client *client = NULL;
+        for (uint32_t i = 0; i < TRDB_D5M_STREAM_SERVER_MAX_CLIENTS; i++) {
+            if (server->clients[i].fd < 0) {
+                client = &server->clients[i];
+                break;
+            }
+        }
+
+        if (client == NULL || !set_nonblocking(fd)) {
+            close(fd);
+            continue;
+        }
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        memset(client, 0, sizeof(*client));
+        client->fd = fd;
+        client->slot = -1;
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+        /* kernels without zero-copy support refuse the option, sends then copy */
+        client->zerocopy = setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+#endif
+    }
+}
+
+/*
+ * disconnect_client
+ *
+ * Closes a client's connection and drops its references to the slots. The
+ * connection is reset rather than shut down gracefully, so the kernel frees
+ * the buffers of pending zero-copy sends instead of transmitting them after
+ * their frame was released.
+ */
+static void disconnect_client(trdb_d5m_stream_server *server, trdb_d5m_stream_client *client) {
+    struct linger linger = {.l_onoff = 1, .l_linger = 0};
+    setsockopt(client->fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+    close(client->fd);
+    client->fd = -1;
+
+    if (client->slot >= 0) {
+        server->frames_dropped++;
+        unref_slot(server, (uint32_t) client->slot);
+        client->slot = -1;
+    }
+
+    while (client->awaiting_count > 0) {
+        unref_slot(server, client->awaiting[client->awaiting_head].slot);
+        client->awaiting_head = (client->awaiting_head + 1) % TRDB_D5M_STREAM_SERVER_MAX_AWAITING;
+        client->awaiting_count--;
+    }
+}
+
+/*
+ * reap_completions
+ *
+ * Drops the references of the frames whose zero-copy sends all completed.
+ * TCP completes send calls in order, so the awaiting frames are completed
+ * oldest first.
+ */
+static void reap_completions(trdb_d5m_stream_server *server, trdb_d5m_stream_client *client) {
+    while (client->awaiting_count > 0) {
+        trdb_d5m_stream_awaiting *awaiting = &client->awaiting[client->awaiting_head];
+
+        if ((int32_t) (awaiting->id - client->zerocopy_completed) >= 0) {
+            return;
+        }
+
+        unref_slot(server, awaiting->slot);
+        client->awaiting_head = (client->awaiting_head + 1) % TRDB_D5M_STREAM_SERVER_MAX_AWAITING;
+        client->awaiting_count--;
+    }
+}
+
+/*
+ * read_completions
+ *
+ * Reads the zero-copy completion notifications queued on a client's error
+ * queue.
+ *
+ * Returns false if the connection failed.
+ */
+static bool read_completions(trdb_d5m_stream_server *server, trdb_d5m_stream_client *client) {
+#if defined(MSG_ERRQUEUE) && defined(SO_EE_ORIGIN_ZEROCOPY)
+    if (!client->zerocopy) {
+        return true;
+    }
+
+    for (;;) {
+        uint8_t control[CMSG_SPACE(sizeof(struct sock_extended_err)) + 64];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(client->fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return false;
+        }
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                  (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))) {
+                continue;
+            }
+
+            struct sock_extended_err err;
+            memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+            if (err.ee_errno == 0 && err.ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+                /* calls ee_info to ee_data (inclusive) completed */
+                client->zerocopy_completed = err.ee_data + 1;
+            }
+        }
+    }
+
+    reap_completions(server, client);
+#endif
+    return true;
+}
+
+/*
+ * finish_frame
+ *
+ * Called once the last byte of a client's frame was handed to the kernel.
+ * Copied sends are done with the frame, zero-copy sends keep their reference
+ * until the kernel notifies their completion.
+ */
+static void finish_frame(trdb_d5m_stream_server *server, trdb_d5m_stream_client *client) {
+    uint32_t slot = (uint32_t) client->slot;
+
+    client->slot = -1;
+    client->sent = 0;
+    server->frames_sent++;
+
+    if (!client->zerocopy) {
+        unref_slot(server, slot);
+        return;
+    }
+
+    uint32_t tail = (client->awaiting_head + client->awaiting_count) % TRDB_D5M_STREAM_SERVER_MAX_AWAITING;
+    client->awaiting[tail].id = client->zerocopy_calls - 1;
+    client->awaiting[tail].slot = slot;
+    client->awaiting_count++;
+
+    reap_completions(server, client);
+}
+
+/*
+ * send_client
+ *
+ * Sends as much of a client's frame as its socket accepts without blocking.
+ *
+ * Returns false if the connection failed.
+ */
+static bool send_client(trdb_d5m_stream_server *server, trdb_d5m_stream_client *client) {
+    while (client->slot >= 0) {
+        trdb_d5m_stream_slot *slot = &server->slots[client->slot];
+        struct iovec iov[2];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+
+        if (client->sent < TRDB_D5M_STREAM_SERVER_TCP_HEADER_SIZE) {
+            iov[0].iov_base = slot->header + client->sent;
+            iov[0].iov_len = TRDB_D5M_STREAM_SERVER_TCP_HEADER_SIZE - client->sent;
+            iov[1].iov_base = slot->frame;
+            iov[1].iov_len = slot->size;
+            msg.msg_iovlen = 2;
+        } else {
+            size_t offset = client->sent - TRDB_D5M_STREAM_SERVER_TCP_HEADER_SIZE;
+            iov[0].iov_base = (uint8_t *) slot->frame + offset;
+            iov[0].iov_len = slot->size - offset;
+            msg.msg_iovlen = 1;
+        }
+
+        int flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+#if defined(MSG_ZEROCOPY)
+        if (client->zerocopy) {
+            flags |= MSG_ZEROCOPY;
+        }
+#endif
+
+        ssize_t sent = sendmsg(client->fd, &msg, flags);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            }
+#if defined(MSG_ZEROCOPY)
+            if (errno == ENOBUFS && (flags & MSG_ZEROCOPY)) {
+                /*
+                 * Out of memory to pin more pages. Copying this part keeps the
+                 * client going, the frame still waits for its earlier
+                 * zero-copy parts to complete.
+                 */
+                sent = sendmsg(client->fd, &msg, flags & ~MSG_ZEROCOPY);
+                if (sent < 0) {
+                    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+                }
+                flags &= ~MSG_ZEROCOPY;
+            } else
+#endif
+            {
+                return false;
+            }
+        }
+
+#if defined(MSG_ZEROCOPY)
+        if (flags & MSG_ZEROCOPY) {
+            client->zerocopy_calls++;
+        }
+#endif
+
+        client->sent += (size_t) sent;
+        if (client->sent == TRDB_D5M_STREAM_SERVER_TCP_HEADER_SIZE + slot->size) {
+            finish_frame(server, client);
+        }
+    }
+
+    return true;
+}
+
+/*
+ * drain_client
+ *
+ * Discards whatever a client sent.
+ *
+ * Returns false once the client closed its connection or it failed.
+ */
+static bool drain_client(trdb_d5m_stream_client *client) {
+    uint8_t buffer[256];
+
+    for (;;) {
+        ssize_t received = recv(client->fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (received > 0) {
+            continue;
+        }
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        return received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+}
+
+/*
+ * send_datagrams
+ *
+ * Sends count datagrams to a destination without blocking, in batches on
+ * systems which have sendmmsg().
+ *
+ * Returns false if not all datagrams could be sent.
+ */
+static bool send_datagrams(trdb_d5m_stream_server *server, const struct sockaddr_in *destination, struct iovec (*iov)[3], uint32_t count) {
+#if defined(__linux__)
+    struct mmsghdr msgs[UDP_BATCH_SIZE];
+    memset(msgs, 0, sizeof(msgs));
+
+    for (uint32_t i = 0; i < count; i++) {
+        msgs[i].msg_hdr.msg_name = (void *) destination;
+        msgs[i].msg_hdr.msg_namelen = sizeof(*destination);
+        msgs[i].msg_hdr.msg_iov = iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 3;
+    }
+
+    uint32_t done = 0;
+    while (done < count) {
+        int sent = sendmmsg(server->udp_fd, msgs + done, count - done, MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        done += (uint32_t) sent;
+    }
+#else
+    for (uint32_t i = 0; i < count; i++) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = (void *) destination;
+        msg.msg_namelen = sizeof(*destination);
+        msg.msg_iov = iov[i];
+        msg.msg_iovlen = 3;
+
+        while (sendmsg(server->udp_fd, &msg, MSG_DONTWAIT) < 0) {
+            if (errno != EINTR) {
+                return false;
+            }
+        }
+    }
+#endif
+    return true;
+}
+
+/*
+ * send_udp
+ *
+ * Sends a frame to every UDP destination.
+ */
+static void send_udp(trdb_d5m_stream_server *server, const trdb_d5m_stream_slot *slot, const trdb_d5m_stream_frame_info *info) {
+    size_t chunk_size = server->udp_payload - UDP_HEADERS_SIZE;
+    uint32_t chunk_count = slot->size == 0 ? 1 : (uint32_t) ((slot->size + chunk_size - 1) / chunk_size);
+
+    uint8_t rtp[UDP_BATCH_SIZE][TRDB_D5M_STREAM_SERVER_RTP_HEADER_SIZE];
+    uint8_t chunk[UDP_BATCH_SIZE][TRDB_D5M_STREAM_SERVER_CHUNK_HEADER_SIZE];
+    struct iovec iov[UDP_BATCH_SIZE][3];
+
+    bool sent[TRDB_D5M_STREAM_SERVER_MAX_DESTINATIONS];
+    for (uint32_t d = 0; d < server->destination_count; d++) {
+        sent[d] = true;
+    }
+
+    /* every destination receives the same packets, so the headers of a batch are shared */
+    for (uint32_t first = 0; first < chunk_count; first += UDP_BATCH_SIZE) {
+        uint32_t count = chunk_count - first < UDP_BATCH_SIZE ? chunk_count - first : UDP_BATCH_SIZE;
+
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t n = first + i;
+            size_t offset = (size_t) n * chunk_size;
+            size_t size = slot->size - offset < chunk_size ? slot->size - offset : chunk_size;
+
+            rtp[i][0] = RTP_VERSION;
+            rtp[i][1] = TRDB_D5M_STREAM_SERVER_RTP_PAYLOAD_TYPE | (n == chunk_count - 1 ? RTP_MARKER : 0);
+            write_be(rtp[i] + 2, (uint16_t) (server->rtp_sequence + n), 2);
+            write_be(rtp[i] + 4, (uint32_t) info->timestamp, 4);
+            write_be(rtp[i] + 8, server->ssrc, 4);
+
+            write_be(chunk[i] + 0, info->sequence, 4);
+            write_be(chunk[i] + 4, slot->size, 4);
+            write_be(chunk[i] + 8, offset, 4);
+            write_be(chunk[i] + 12, info->width, 2);
+            write_be(chunk[i] + 14, info->height, 2);
+
+            iov[i][0].iov_base = rtp[i];
+            iov[i][0].iov_len = sizeof(rtp[i]);
+            iov[i][1].iov_base = chunk[i];
+            iov[i][1].iov_len = sizeof(chunk[i]);
+            iov[i][2].iov_base = (uint8_t *) slot->frame + offset;
+            iov[i][2].iov_len = size;
+        }
+
+        for (uint32_t d = 0; d < server->destination_count; d++) {
+            if (sent[d] && !send_datagrams(server, &server->destinations[d], iov, count)) {
+                /* the rest of the frame is useless to the receiver */
+                sent[d] = false;
+            }
+        }
+    }
+
+    for (uint32_t d = 0; d < server->destination_count; d++) {
+        if (sent[d]) {
+            server->frames_sent++;
+        } else {
+            server->frames_dropped++;
+        }
+    }
+
+    server->rtp_sequence += (uint16_t) chunk_count;
+}
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+
+/*
+ * trdb_d5m_stream_server_open
+ *
+ * Starts listening for TCP clients on address (a dotted IPv4 address, or NULL
+ * for all interfaces) and tcp_port (0 picks a free port, see
+ * trdb_d5m_stream_server_tcp_port()).
+ *
+ * The server sends published frames straight from the caller's buffers, and
+ * calls release once it does not need a frame anymore. With zero-copy sends
+ * this is only after the kernel transmitted the frame, so frames must not be
+ * modified nor reused before their release.
+ *
+ * Returns true if the server is listening, and false otherwise.
+ */
+bool trdb_d5m_stream_server_open(trdb_d5m_stream_server *server, const char *address, uint16_t tcp_port, trdb_d5m_stream_server_release_callback release, void *context) {
+    struct sockaddr_in addr;
+
+    memset(server, 0, sizeof(*server));
+    server->listen_fd = -1;
+    server->udp_fd = -1;
+    server->release = release;
+    server->context = context;
+    for (uint32_t i = 0; i < TRDB_D5M_STREAM_SERVER_MAX_CLIENTS; i++) {
+        server->clients[i].fd = -1;
+        server->clients[i].slot = -1;
+    }
+    server->ssrc = (uint32_t) time(NULL) ^ ((uint32_t) getpid() << 16);
+
+    if (!parse_address(address, tcp_port, &addr)) {
+        return false;
+    }
+
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (server->listen_fd < 0) {
+        return false;
+    }
+
+    int one = 1;
+    setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    if (bind(server->listen_fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+        listen(server->listen_fd, TRDB_D5M_STREAM_SERVER_MAX_CLIENTS) != 0 ||
+        !set_nonblocking(server->listen_fd)) {
+        close(server->listen_fd);
+        server->listen_fd = -1;
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * trdb_d5m_stream_server_tcp_port
+ *
+ * Returns the port the server listens on, or 0 on error.
+ */
+uint16_t trdb_d5m_stream_server_tcp_port(trdb_d5m_stream_server *server) {
+    struct sockaddr_in addr;
+    socklen_t addr_size = sizeof(addr);
+
+    if (getsockname(server->listen_fd, (struct sockaddr *) &addr, &addr_size) != 0) {
+        return 0;
+    }
+
+    return ntohs(addr.sin_port);
+}
+
+/*
+ * trdb_d5m_stream_server_add_udp_destination
+ *
+ * Sends all following frames as RTP datagrams to a dotted IPv4 address (which
+ * can be a multicast group) and port. udp_payload is the maximum size of the
+ * datagrams' payload, headers included (0 for
+ * TRDB_D5M_STREAM_SERVER_DEFAULT_UDP_PAYLOAD). All destinations receive the
+ * same datagrams, sized for the smallest udp_payload.
+ *
+ * Returns true if the destination was added, and false otherwise.
+ */
+bool trdb_d5m_stream_server_add_udp_destination(trdb_d5m_stream_server *server, const char *address, uint16_t port, size_t udp_payload) {
+    struct sockaddr_in addr;
+
+    if (udp_payload == 0) {
+        udp_payload = TRDB_D5M_STREAM_SERVER_DEFAULT_UDP_PAYLOAD;
+    }
+
+    if (server->destination_count == TRDB_D5M_STREAM_SERVER_MAX_DESTINATIONS ||
+        address == NULL ||
+        udp_payload <= UDP_HEADERS_SIZE ||
+        udp_payload > UDP_MAX_PAYLOAD ||
+        !parse_address(address, port, &addr)) {
+        return false;
+    }
+
+    if (server->udp_fd < 0) {
+        server->udp_fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (server->udp_fd < 0) {
+            return false;
+        }
+        if (!set_nonblocking(server->udp_fd)) {
+            close(server->udp_fd);
+            server->udp_fd = -1;
+            return false;
+        }
+    }
+
+    if (server->udp_payload == 0 || udp_payload < server->udp_payload) {
+        server->udp_payload = udp_payload;
+    }
+
+    server->destinations[server->destination_count] = addr;
+    server->destination_count++;
+
+    return true;
+}
+
+/*
+ * trdb_d5m_stream_server_publish
+ *
+ * Publishes a frame to all UDP destinations, and to all TCP clients which are
+ * done with their previous frame. Busy clients skip the frame. Nothing blocks:
+ * UDP datagrams are sent right away, and TCP clients are sent what their
+ * socket accepts now, the rest being sent by trdb_d5m_stream_server_poll().
+ *
+ * The frame is released as soon as nobody needs it, possibly before this
+ * function returns.
+ *
+ * Returns true if the frame was published, and false if it was dropped because
+ * all slots are in use (it is then already released).
+ */
+bool trdb_d5m_stream_server_publish(trdb_d5m_stream_server *server, void *frame, size_t size, const trdb_d5m_stream_frame_info *info) {
+    uint32_t slot = TRDB_D5M_STREAM_SERVER_MAX_FRAMES;
+
+    for (uint32_t i = 0; i < TRDB_D5M_STREAM_SERVER_MAX_FRAMES; i++) {
+        if (server->slots[i].refs == 0) {
+            slot = i;
+            break;
+        }
+    }
+
+    if (slot == TRDB_D5M_STREAM_SERVER_MAX_FRAMES || size > UINT32_MAX) {
+        server->frames_dropped++;
+        if (server->release != NULL) {
+            server->release(frame, server->context);
+        }
+        return false;
+    }
+
+    trdb_d5m_stream_slot *s = &server->slots[slot];
+    s->frame = frame;
+    s->size = size;
+    s->refs = 1; /* held until the end of this function */
+
+    memset(s->header, 0, sizeof(s->header));
+    memcpy(s->header, FRAME_MAGIC, 4);
+    write_le(s->header + 4, TRDB_D5M_STREAM_SERVER_TCP_HEADER_SIZE, 4);
+    write_le(s->header + 8, info->sequence, 4);
+    write_le(s->header + 12, size, 4);
+    write_le(s->header + 16, info->timestamp, 8);
+    write_le(s->header + 24, info->width, 2);
+    write_le(s->header + 26, info->height, 2);
+    write_le(s->header + 28, info->format, 2);
+
+    if (server->destination_count > 0) {
+        send_udp(server, s, info);
+    }
+
+    for (uint32_t i = 0; i < TRDB_D5M_STREAM_SERVER_MAX_CLIENTS; i++) {
+        trdb_d5m_stream_client *client = &server->clients[i];
+
+        if (client->fd < 0) {
+            continue;
+        }
+
+        if (client->slot >= 0 || client->awaiting_count == TRDB_D5M_STREAM_SERVER_MAX_AWAITING) {
+            server->frames_dropped++;
+            continue;
+        }
+
+        s->refs++;
+        client->slot = (int32_t) slot;
+        client->sent = 0;
+
+        if (!send_client(server, client)) {
+            disconnect_client(server, client);
+        }
+    }
+
+    unref_slot(server, slot);
+
+    return true;
+}
+
+/*
+ * trdb_d5m_stream_server_poll
+ *
+ * Waits up to timeout_ms milliseconds (0 to return immediately, -1 to wait
+ * indefinitely) for network events, then accepts new clients, continues the
+ * pending sends, releases the frames whose zero-copy sends completed, and
+ * drops the clients which disconnected. Call it regularly, for instance once
+ * per frame with a 0 timeout.
+ *
+ * Returns true on success, and false if waiting for events failed.
+ */
+bool trdb_d5m_stream_server_poll(trdb_d5m_stream_server *server, int timeout_ms) {
+    struct pollfd fds[1 + TRDB_D5M_STREAM_SERVER_MAX_CLIENTS];
+    trdb_d5m_stream_client *clients[1 + TRDB_D5M_STREAM_SERVER_MAX_CLIENTS];
+    nfds_t count = 0;
+
+    fds[count].fd = server->listen_fd;
+    fds[count].events = POLLIN;
+    clients[count] = NULL;
+    count++;
+
+    for (uint32_t i = 0; i < TRDB_D5M_STREAM_SERVER_MAX_CLIENTS; i++) {
+        trdb_d5m_stream_client *client = &server->clients[i];
+
+        if (client->fd < 0) {
+            continue;
+        }
+
+        /* POLLERR, raised by zero-copy completions, is always reported */
+        fds[count].fd = client->fd;
+        fds[count].events = POLLIN | (client->slot >= 0 ? POLLOUT : 0);
+        clients[count] = client;
+        count++;
+    }
+
+    int ready = poll(fds, count, timeout_ms);
+    if (ready < 0) {
+        return errno == EINTR;
+    }
+
+    for (nfds_t i = 1; i < count; i++) {
+        trdb_d5m_stream_client *client = clients[i];
+        short revents = fds[i].revents;
+
+        if (revents == 0) {
+            continue;
+        }
+
+        bool alive = !(revents & POLLNVAL);
+        if (alive && (revents & POLLERR)) {
+            alive = read_completions(server, client);
+        }
+        if (alive && (revents & (POLLIN | POLLHUP))) {
+            alive = drain_client(client);
+        }
+        if (alive && (revents & POLLOUT)) {
+            alive = send_client(server, client);
+        }
+
+        if (!alive) {
+            disconnect_client(server, client);
+        }
+    }
+
+    if (fds[0].revents & POLLIN) {
+        accept_clients(server);
+    }
+
+    return true;
+}
+
+/*
+ * trdb_d5m_stream_server_client_count
+ *
+ * Returns the number of connected TCP clients.
+ */
+uint32_t trdb_d5m_stream_server_client_count(trdb_d5m_stream_server *server) {
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < TRDB_D5M_STREAM_SERVER_MAX_CLIENTS; i++) {
+        if (server->clients[i].fd >= 0) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/*
+ * trdb_d5m_stream_server_close
+ *
+ * Disconnects all clients, releases all frames still in use, and stops
+ * listening.
+ */
+void trdb_d5m_stream_server_close(trdb_d5m_stream_server *server) {
+    for (uint32_t i = 0; i < TRDB_D5M_STREAM_SERVER_MAX_CLIENTS; i++) {
+        if (server->clients[i].fd >= 0) {
+            disconnect_client(server, &server->clients[i]);
+        }
+    }
+
+    if (server->udp_fd >= 0) {
+        close(server->udp_fd);
+        server->udp_fd = -1;
+    }
+
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+        server->listen_fd = -1;
+    }
+}
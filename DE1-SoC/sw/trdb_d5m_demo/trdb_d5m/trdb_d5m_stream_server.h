@@ -0,0 +1,98 @@
+#ifndef __TRDB_D5M_STREAM_SERVER_H__
+#define __TRDB_D5M_STREAM_SERVER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <netinet/in.h>
+
+/* Maximum number of TCP clients, of UDP destinations, and of frames being sent */
+#define TRDB_D5M_STREAM_SERVER_MAX_CLIENTS      (8)
+#define TRDB_D5M_STREAM_SERVER_MAX_DESTINATIONS (4)
+#define TRDB_D5M_STREAM_SERVER_MAX_FRAMES       (32)
+
+/* Maximum number of frames of a client waiting for their zero-copy completion */
+#define TRDB_D5M_STREAM_SERVER_MAX_AWAITING     (8)
+
+/* Size of the header preceding each frame on TCP connections */
+#define TRDB_D5M_STREAM_SERVER_TCP_HEADER_SIZE  (32)
+
+/* Size of the RTP header and of the chunk header of each UDP datagram */
+#define TRDB_D5M_STREAM_SERVER_RTP_HEADER_SIZE   (12)
+#define TRDB_D5M_STREAM_SERVER_CHUNK_HEADER_SIZE (16)
+
+/* RTP payload type of the UDP datagrams (dynamic range) */
+#define TRDB_D5M_STREAM_SERVER_RTP_PAYLOAD_TYPE (96)
+
+/* Default maximum size of a UDP datagram's payload (fits a 1500 byte MTU) */
+#define TRDB_D5M_STREAM_SERVER_DEFAULT_UDP_PAYLOAD (1400)
+
+/* Called once the server does not reference a published frame anymore */
+typedef void (*trdb_d5m_stream_server_release_callback)(void *frame, void *context);
+
+/* Description of a published frame */
+typedef struct trdb_d5m_stream_frame_info {
+    uint32_t sequence;  /* Frame number */
+    uint64_t timestamp; /* Capture time (the RTP timestamp is its low 32 bits) */
+    uint16_t width;     /* Frame width in pixels */
+    uint16_t height;    /* Frame height in pixels */
+    uint16_t format;    /* Payload format, defined by the application */
+} trdb_d5m_stream_frame_info;
+
+/* Frame being sent */
+typedef struct trdb_d5m_stream_slot {
+    void     *frame;                                           /* Frame contents */
+    size_t   size;                                             /* Frame size in bytes */
+    uint8_t  header[TRDB_D5M_STREAM_SERVER_TCP_HEADER_SIZE];   /* TCP header of the frame */
+    uint32_t refs;                                             /* Number of pending uses (0 if the slot is free) */
+} trdb_d5m_stream_slot;
+
+/* Frame of a client waiting for its zero-copy completion */
+typedef struct trdb_d5m_stream_awaiting {
+    uint32_t id;   /* Zero-copy id of the last send call of the frame */
+    uint32_t slot; /* Slot of the frame */
+} trdb_d5m_stream_awaiting;
+
+/* TCP client */
+typedef struct trdb_d5m_stream_client {
+    int                      fd;                                            /* Socket, or -1 if unused */
+    bool                     zerocopy;                                      /* Sends use MSG_ZEROCOPY */
+    int32_t                  slot;                                          /* Slot being sent, or -1 */
+    size_t                   sent;                                          /* Bytes of the slot (header included) sent so far */
+    uint32_t                 zerocopy_calls;                                /* Number of zero-copy send calls so far */
+    uint32_t                 zerocopy_completed;                            /* Number of zero-copy send calls completed */
+    trdb_d5m_stream_awaiting awaiting[TRDB_D5M_STREAM_SERVER_MAX_AWAITING]; /* Ring of frames waiting for completion */
+    uint32_t                 awaiting_head;                                 /* Index of the oldest awaiting frame */
+    uint32_t                 awaiting_count;                                /* Number of awaiting frames */
+} trdb_d5m_stream_client;
+
+/* Frame streaming server */
+typedef struct trdb_d5m_stream_server {
+    int                                     listen_fd;                                             /* TCP listening socket */
+    int                                     udp_fd;                                                /* UDP socket, or -1 if there is no destination */
+    trdb_d5m_stream_client                  clients[TRDB_D5M_STREAM_SERVER_MAX_CLIENTS];
+    struct sockaddr_in                      destinations[TRDB_D5M_STREAM_SERVER_MAX_DESTINATIONS]; /* UDP destinations */
+    uint32_t                                destination_count;                                     /* Number of UDP destinations */
+    size_t                                  udp_payload;                                           /* Maximum size of a UDP datagram's payload */
+    uint16_t                                rtp_sequence;                                          /* Sequence number of the next RTP packet */
+    uint32_t                                ssrc;                                                  /* RTP synchronization source */
+    trdb_d5m_stream_slot                    slots[TRDB_D5M_STREAM_SERVER_MAX_FRAMES];
+    trdb_d5m_stream_server_release_callback release;                                               /* Frame release callback */
+    void                                    *context;                                              /* Context of the release callback */
+    uint64_t                                frames_sent;                                           /* Frames completely sent to a client or destination */
+    uint64_t                                frames_dropped;                                        /* Frames skipped for a client or destination */
+} trdb_d5m_stream_server;
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+bool trdb_d5m_stream_server_open(trdb_d5m_stream_server *server, const char *address, uint16_t tcp_port, trdb_d5m_stream_server_release_callback release, void *context);
+uint16_t trdb_d5m_stream_server_tcp_port(trdb_d5m_stream_server *server);
+bool trdb_d5m_stream_server_add_udp_destination(trdb_d5m_stream_server *server, const char *address, uint16_t port, size_t udp_payload);
+bool trdb_d5m_stream_server_publish(trdb_d5m_stream_server *server, void *frame, size_t size, const trdb_d5m_stream_frame_info *info);
+bool trdb_d5m_stream_server_poll(trdb_d5m_stream_server *server, int timeout_ms);
+uint32_t trdb_d5m_stream_server_client_count(trdb_d5m_stream_server *server);
+void trdb_d5m_stream_server_close(trdb_d5m_stream_server *server);
+
+#endif /* __TRDB_D5M_STREAM_SERVER_H__ */